@@ -0,0 +1,100 @@
+#ifndef AJIS_ABI_H
+#define AJIS_ABI_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   libajis C ABI
+
+   The entry points of libajis.so for managed hosts (P/Invoke,
+   JNI, ctypes). Every call handles a whole buffer, so a document
+   costs a fixed number of calls whatever its token count:
+
+     ajis_abi_tokenize()   tokens into a caller-pinned array,
+                           resumable when the array fills up
+     ajis_abi_validate()   one well-formed value?
+     ajis_abi_to_auv()     transcode to AUV Wire v1; call once with
+                           cap 0 to size the buffer, once to fill it
+
+   Only fixed-width integers and flat structs cross the boundary;
+   the library keeps no state between calls and may be called from
+   any number of threads at once.
+
+   Versioning: AJIS_ABI_VERSION is (major << 16) | minor. Minor
+   releases only add entry points and flags; a host checks that the
+   major of ajis_abi_version() equals the one it was built for.
+   Status codes are ajis_error_code values (ajis_error.h) and token
+   types ajis_token_type values (ajis_token.h); both are frozen for
+   major 1.
+   ============================================================ */
+
+#if defined(_WIN32)
+#define AJIS_API __declspec(dllexport)
+#elif defined(__GNUC__)
+#define AJIS_API __attribute__((visibility("default")))
+#else
+#define AJIS_API
+#endif
+
+#define AJIS_ABI_VERSION_MAJOR 1
+#define AJIS_ABI_VERSION_MINOR 0
+#define AJIS_ABI_VERSION ((AJIS_ABI_VERSION_MAJOR << 16) | AJIS_ABI_VERSION_MINOR)
+
+#define AJIS_ABI_OK 0
+
+/* flags */
+#define AJIS_ABI_MULTILINE_STRINGS   0x1u
+#define AJIS_ABI_NO_NUMBER_SEPARATORS 0x2u
+#define AJIS_ABI_REJECT_DUPLICATE_KEYS 0x4u     /* validate (to_auv always rejects them) */
+#define AJIS_ABI_CANONICAL           0x8u       /* to_auv: sort object keys */
+
+/* 16 bytes, no padding. */
+typedef struct ajis_abi_token {
+    uint64_t offset;            /* string bodies exclude the quotes */
+    uint32_t length;
+    uint32_t type;              /* ajis_token_type */
+} ajis_abi_token;
+
+/* 40 bytes, no padding. */
+typedef struct ajis_abi_result {
+    int32_t status;             /* AJIS_ABI_OK or an ajis_error_code */
+    uint32_t more;              /* tokenize: array full, call again from `next`; to_auv: needs `next` bytes */
+    uint64_t written;           /* tokens or bytes stored */
+    uint64_t next;              /* tokenize: input offset to resume at; to_auv: AUV size */
+    uint64_t error_offset;
+    uint32_t error_line;        /* 1-based */
+    uint32_t error_column;
+} ajis_abi_result;
+
+AJIS_API uint32_t ajis_abi_version(void);
+
+/* Static, NUL-terminated name of a status code. */
+AJIS_API const char *ajis_abi_status_name(int32_t status);
+
+/*
+ * Tokens of data[start..len) into out[0..cap), EOF not included.
+ * Stops when `out` is full (more = 1, next = offset after the last
+ * token stored); pass `next` as `start` to continue. Offsets are from
+ * the start of `data`. A token longer than 4 GiB is AJIS_ERR_SIZE_LIMIT.
+ */
+AJIS_API int32_t ajis_abi_tokenize(const uint8_t *data, uint64_t len, uint64_t start, uint32_t flags,
+                                   ajis_abi_token *out, uint64_t cap, ajis_abi_result *res);
+
+AJIS_API int32_t ajis_abi_validate(const uint8_t *data, uint64_t len, uint32_t flags, ajis_abi_result *res);
+
+/*
+ * AUV record of the document into out[0..cap). When it does not fit,
+ * nothing is written: more = 1 and next = the size needed.
+ */
+AJIS_API int32_t ajis_abi_to_auv(const uint8_t *data, uint64_t len, uint32_t flags, uint8_t *out, uint64_t cap,
+                                 ajis_abi_result *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_ABI_H */
@@ -0,0 +1,125 @@
+#ifndef AJIS_ALLOC_H
+#define AJIS_ALLOC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Pluggable allocators
+
+   Every AJIS/AUV C API that needs memory takes an ajis_allocator
+   (an options field or a `_with` variant); NULL always means the
+   C library heap, so existing call sites keep working.
+
+   realloc and free receive the size the block was requested with,
+   so arenas and pools need no per-block header. Every block is
+   aligned to AJIS_ALLOC_ALIGN.
+
+   Two allocators are provided:
+
+   - ajis_arena: bump-pointer arena. Individual frees are no-ops
+     (except for the most recent block), ajis_arena_reset() makes
+     the memory reusable for the next document. When a document
+     needed more than one chunk, reset folds them into a single
+     chunk of the combined size, so the next document of the same
+     size costs no system allocation at all.
+
+   - ajis_slab_pool: size-class pool (16 .. 4096 bytes, powers of
+     two) with one free list per class, carved from 64 KiB slabs.
+     For long-lived structures with mixed lifetimes. Larger blocks
+     go to the parent allocator.
+
+   Neither is thread-safe: use one per thread (or per worker).
+   Both keep a pointer to themselves in `allocator.ctx`, so they
+   must not be moved after init.
+   ============================================================ */
+
+#define AJIS_ALLOC_ALIGN 16u
+
+typedef struct ajis_allocator {
+    void *(*alloc)(void *ctx, size_t size);
+    void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+    void (*free)(void *ctx, void *ptr, size_t size);
+    void *ctx;
+} ajis_allocator;
+
+/* malloc/realloc/free. */
+const ajis_allocator *ajis_allocator_malloc(void);
+
+static inline const ajis_allocator *ajis_allocator_or_default(const ajis_allocator *a) {
+    return a ? a : ajis_allocator_malloc();
+}
+
+static inline void *ajis_alloc(const ajis_allocator *a, size_t size) {
+    a = ajis_allocator_or_default(a);
+    return a->alloc(a->ctx, size);
+}
+
+static inline void *ajis_realloc(const ajis_allocator *a, void *ptr, size_t old_size, size_t new_size) {
+    a = ajis_allocator_or_default(a);
+    return a->realloc(a->ctx, ptr, old_size, new_size);
+}
+
+static inline void ajis_free(const ajis_allocator *a, void *ptr, size_t size) {
+    if (!ptr) return;
+    a = ajis_allocator_or_default(a);
+    a->free(a->ctx, ptr, size);
+}
+
+/* ---------- bump arena ---------- */
+
+#define AJIS_ARENA_DEFAULT_CHUNK (64u * 1024u)
+
+typedef struct ajis_arena_chunk ajis_arena_chunk;
+
+typedef struct ajis_arena {
+    ajis_allocator allocator;       /* pass &arena.allocator to the APIs */
+    const ajis_allocator *parent;
+    ajis_arena_chunk *chunks;       /* newest first; bumping happens in the newest */
+    uint8_t *ptr;
+    uint8_t *end;
+    uint8_t *last;                  /* most recent block (grown/freed in place) */
+    size_t chunk_size;              /* size of the next chunk */
+    size_t chunk_count;
+} ajis_arena;
+
+/* `parent` NULL = malloc; `chunk_size` 0 = AJIS_ARENA_DEFAULT_CHUNK. No memory is taken until first use. */
+void ajis_arena_init(ajis_arena *arena, const ajis_allocator *parent, size_t chunk_size);
+
+/* Forget every block; keeps (at most) one chunk sized for what the last cycle used. */
+void ajis_arena_reset(ajis_arena *arena);
+
+/* Total chunk bytes currently held. */
+size_t ajis_arena_capacity(const ajis_arena *arena);
+
+void ajis_arena_destroy(ajis_arena *arena);
+
+/* ---------- size-class pool ---------- */
+
+#define AJIS_SLAB_MIN_CLASS 16u
+#define AJIS_SLAB_MAX_CLASS 4096u
+#define AJIS_SLAB_CLASSES 9         /* 16, 32, ... 4096 */
+#define AJIS_SLAB_SIZE (64u * 1024u)
+
+typedef struct ajis_slab_pool {
+    ajis_allocator allocator;
+    const ajis_allocator *parent;
+    void *free_lists[AJIS_SLAB_CLASSES];
+    void *slabs;                    /* singly linked through their first word */
+    size_t slab_count;
+} ajis_slab_pool;
+
+void ajis_slab_pool_init(ajis_slab_pool *pool, const ajis_allocator *parent);
+
+/* Returns every slab to the parent; blocks above AJIS_SLAB_MAX_CLASS must have been freed by the caller. */
+void ajis_slab_pool_destroy(ajis_slab_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_ALLOC_H */
@@ -0,0 +1,73 @@
+#ifndef AJIS_AUV_H
+#define AJIS_AUV_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AJIS -> AUV Wire v1 (Specs/AUV.Spec.md, section 6)
+
+   Transcodes one AJIS value to one AUV record:
+     null / true / false   Null / Bool
+     numbers               Int64; Float64 when written with a
+                           fraction or exponent, or past int64
+                           (ajis_number_parse())
+     strings               String, decoded; must be valid UTF-8
+     hex"..." / b64"..."   Binary
+     [ ... ] / { ... }     Array / Object
+
+   Object keys keep document order, or are sorted by UTF-8 bytes
+   with `canonical`. A duplicate key is an error (AUV keys are
+   unique), as is anything past the spec limits (section 4). With
+   an `intern` table (ajis_intern.h) every key is interned: keys
+   are compared as symbols, and canonical sorting compares the
+   byte-order ranks of the document's own keys
+   (ajis_intern_rank_symbols()), integers instead of key bytes.
+
+   The input is read twice: the first pass measures every
+   container, so the second writes each header once, with its
+   minimal VarUInt length, and never moves bytes.
+   ============================================================ */
+
+struct ajis_intern_table;
+
+#define AJIS_AUV_MAX_STRING (64u * 1024u * 1024u)
+#define AJIS_AUV_MAX_BINARY (1024u * 1024u * 1024u)
+#define AJIS_AUV_MAX_ITEMS 10000000u        /* array elements, object keys */
+#define AJIS_AUV_MAX_KEY 4096u
+
+typedef struct ajis_auv_options {
+    ajis_lexer_options lexer;
+    int canonical;                          /* sort object keys */
+    const ajis_allocator *allocator;        /* work buffers; NULL = malloc */
+    struct ajis_intern_table *intern;       /* key symbols (ajis_intern.h); NULL = compare bytes */
+} ajis_auv_options;
+
+static inline ajis_auv_options ajis_auv_options_default(void) {
+    ajis_auv_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.canonical = 0;
+    o.allocator = NULL;
+    o.intern = NULL;
+    return o;
+}
+
+/*
+ * Transcode the document `data`. On AJIS_OK, `*needed` is the size of
+ * the AUV record; it is written to `out` only when it fits in `cap`
+ * bytes (pass out = NULL, cap = 0 to measure). Errors are located in
+ * the document; `opt` and `err` may be NULL.
+ */
+ajis_error_code ajis_to_auv(const void *data, size_t len, const ajis_auv_options *opt, uint8_t *out, size_t cap,
+                            size_t *needed, ajis_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_AUV_H */
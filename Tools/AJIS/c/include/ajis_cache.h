@@ -0,0 +1,103 @@
+#ifndef AJIS_CACHE_H
+#define AJIS_CACHE_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+#include "auv_seek.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AUV sidecar cache
+
+   Large configuration and catalog files are read at every start.
+   ajis_cache_load() keeps their AUV Wire v1 form (ajis_to_auv())
+   in a sidecar file, by default `<path>.auvc`, together with a
+   content hash of the source. A later load hashes the source and,
+   when it matches, maps the sidecar and returns the wire bytes in
+   place: one pass of auv_hash_bytes() instead of lexing and
+   transcoding. On a miss the source is transcoded and the sidecar
+   rewritten (a private mkstemp() file, fsync, rename), so readers
+   never see a partial file and concurrent writers, threads or
+   processes, simply race to the same content.
+
+     "AJSC" | version u8 | flags u8 | reserved u16
+     lexer u32 | seek_stride u32
+     source_length u64 | source_hash u64
+     auv_length u64 | seek_length u64 | auv_hash u64
+     check u64 = auv_hash_bytes(the 56 bytes above, seed 0);
+                 covers the header only
+     auv       auv_length bytes at offset 64
+     seek      auv_seek index at 64 + auv_length rounded up to 8
+
+   All integers little-endian; hashes are auv_hash_bytes(), seed 0.
+   A sidecar written with other options (lexer, canonical, seek
+   index) counts as a miss. The AUV bytes are not checked on a
+   hit, only the header: a sidecar damaged after it was written is
+   served as it is unless AJIS_CACHE_VERIFY, which rehashes them
+   against auv_hash (one more pass, over the AUV bytes).
+   ============================================================ */
+
+#define AJIS_CACHE_SUFFIX ".auvc"
+
+/* ajis_cache_options.flags */
+#define AJIS_CACHE_CANONICAL 0x1u   /* sort object keys (ajis_auv_options.canonical) */
+#define AJIS_CACHE_SEEK 0x2u        /* keep an auv_seek index of the root container */
+#define AJIS_CACHE_VERIFY 0x4u      /* check auv_hash on a hit */
+#define AJIS_CACHE_READ_ONLY 0x8u   /* never write the sidecar */
+
+typedef struct ajis_cache_options {
+    ajis_lexer_options lexer;
+    unsigned flags;
+    uint32_t seek_stride;                   /* 0 = AUV_SEEK_DEFAULT_STRIDE */
+    const char *cache_path;                 /* NULL = source path + AJIS_CACHE_SUFFIX */
+    const ajis_allocator *allocator;        /* NULL = malloc */
+} ajis_cache_options;
+
+static inline ajis_cache_options ajis_cache_options_default(void) {
+    ajis_cache_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.flags = 0;
+    o.seek_stride = 0;
+    o.cache_path = NULL;
+    o.allocator = NULL;
+    return o;
+}
+
+typedef struct ajis_cached {
+    const uint8_t *auv;         /* one AUV Wire v1 record */
+    size_t auv_length;
+    auv_seek_index seek;        /* valid when has_seek */
+    int has_seek;               /* AJIS_CACHE_SEEK and the root is an array or object */
+
+    int hit;                    /* served from the sidecar */
+    int stored;                 /* miss: the sidecar was rewritten */
+    int io_error;               /* errno behind AJIS_ERR_UNKNOWN, else 0 */
+
+    /* internal */
+    void *map;                  /* sidecar mapping on a hit */
+    size_t map_length;
+    uint8_t *owned;             /* transcoded bytes on a miss */
+    size_t owned_size;
+    const ajis_allocator *allocator;
+} ajis_cached;
+
+/*
+ * AUV form of the AJIS file at `path`, from the sidecar when it is
+ * current. Document errors are located in the source; failing to
+ * read the source is AJIS_ERR_UNKNOWN with `out->io_error` set.
+ * Failing to write the sidecar is not an error (`out->stored` = 0).
+ * Release with ajis_cached_close(); `opt` and `err` may be NULL.
+ */
+ajis_error_code ajis_cache_load(const char *path, const ajis_cache_options *opt, ajis_cached *out, ajis_error *err);
+
+void ajis_cached_close(ajis_cached *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_CACHE_H */
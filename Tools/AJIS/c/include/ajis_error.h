@@ -97,6 +97,39 @@ static inline int ajis_error_is_ok(const ajis_error *err) {
     return err && err->code == AJIS_OK;
 }
 
+
+/* ============================================================
+   Diagnostics List (bounded, caller-owned storage)
+
+   Collects many errors from one pass (see ajis_lexer_next_recover).
+   Once `capacity` is reached further errors are only counted, so a
+   badly broken 100 MB input cannot grow the report without bound.
+   ============================================================ */
+
+typedef struct ajis_diagnostics {
+    ajis_error *items;
+    size_t capacity;
+    size_t count;       /* stored, <= capacity */
+    size_t total;       /* seen, including the ones that did not fit */
+} ajis_diagnostics;
+
+static inline void ajis_diagnostics_init(ajis_diagnostics *d, ajis_error *storage, size_t capacity) {
+    d->items = storage;
+    d->capacity = storage ? capacity : 0;
+    d->count = 0;
+    d->total = 0;
+}
+
+static inline void ajis_diagnostics_add(ajis_diagnostics *d, const ajis_error *err) {
+    if (!d || !err) return;
+    if (d->count < d->capacity) d->items[d->count++] = *err;
+    d->total++;
+}
+
+static inline size_t ajis_diagnostics_dropped(const ajis_diagnostics *d) {
+    return d->total - d->count;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -97,48 +97,122 @@ static inline size_t ajis__visual_col(const char* s, size_t line_start, size_t e
     return col;
 }
 
-/* Print [start,end) but expand tabs to spaces so caret alignment matches. */
-static inline void ajis__fwrite_expand_tabs(FILE* out, const char* s, size_t start, size_t end) {
+
+/* ============================================================
+   Buffered writer
+
+   Reports are assembled in a stack buffer and handed to the FILE
+   in large fwrite() calls (one or a few per report, or per batch),
+   instead of one stdio call per character.
+   ============================================================ */
+
+#ifndef AJIS_PRINT_BUFFER
+#define AJIS_PRINT_BUFFER 4096
+#endif
+
+typedef struct ajis__writer {
+    FILE* out;
+    size_t len;
+    char buf[AJIS_PRINT_BUFFER];
+} ajis__writer;
+
+static inline void ajis__w_init(ajis__writer* w, FILE* out) {
+    w->out = out;
+    w->len = 0;
+}
+
+static inline void ajis__w_flush(ajis__writer* w) {
+    if (w->len) fwrite(w->buf, 1, w->len, w->out);
+    w->len = 0;
+}
+
+static inline void ajis__w_put(ajis__writer* w, const char* s, size_t n) {
+    if (w->len + n > sizeof(w->buf)) {
+        ajis__w_flush(w);
+        if (n > sizeof(w->buf)) {
+            fwrite(s, 1, n, w->out);
+            return;
+        }
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+static inline void ajis__w_str(ajis__writer* w, const char* s) {
+    ajis__w_put(w, s, strlen(s));
+}
+
+static inline void ajis__w_fill(ajis__writer* w, char c, size_t n) {
+    while (n > 0) {
+        if (w->len == sizeof(w->buf)) ajis__w_flush(w);
+        size_t k = sizeof(w->buf) - w->len;
+        if (k > n) k = n;
+        memset(w->buf + w->len, c, k);
+        w->len += k;
+        n -= k;
+    }
+}
+
+/* Gutter: " " + width-padded text (or spaces) + " |" */
+static inline void ajis__w_gutter(ajis__writer* w, int width, const char* num) {
+    size_t n = num ? strlen(num) : 0;
+    ajis__w_put(w, " ", 1);
+    if (num) ajis__w_str(w, AJIS_C_BLUE_B);
+    if ((size_t)width > n) ajis__w_fill(w, ' ', (size_t)width - n);
+    if (num) ajis__w_put(w, num, n);
+    if (!num) ajis__w_str(w, " " AJIS_C_BLUE_B "|" AJIS_C_RESET);
+    else ajis__w_str(w, " |" AJIS_C_RESET);
+}
+
+/* Write [start,end) with tabs expanded to spaces so caret alignment matches. */
+static inline void ajis__w_expand_tabs(ajis__writer* w, const char* s, size_t start, size_t end) {
     size_t col = 0;
+    size_t run = start;
     for (size_t i = start; i < end; i++) {
-        char c = s[i];
-        if (c == '\t') {
-            size_t w = AJIS_TAB_WIDTH ? (size_t)AJIS_TAB_WIDTH : 4;
-            size_t next = ((col / w) + 1) * w;
-            while (col < next) {
-                fputc(' ', out);
-                col++;
-            }
-        } else {
-            fputc(c, out);
-            col++;
-        }
+        if (s[i] != '\t') continue;
+        ajis__w_put(w, s + run, i - run);
+        col += i - run;
+        size_t tw = AJIS_TAB_WIDTH ? (size_t)AJIS_TAB_WIDTH : 4;
+        size_t next = ((col / tw) + 1) * tw;
+        ajis__w_fill(w, ' ', next - col);
+        col = next;
+        run = i + 1;
     }
+    ajis__w_put(w, s + run, end - run);
 }
 
-static inline void ajis_error_print_pretty(
-    FILE* out,
+/* Print [start,end) but expand tabs to spaces so caret alignment matches. */
+static inline void ajis__fwrite_expand_tabs(FILE* out, const char* s, size_t start, size_t end) {
+    ajis__writer w;
+    ajis__w_init(&w, out);
+    ajis__w_expand_tabs(&w, s, start, end);
+    ajis__w_flush(&w);
+}
+
+static inline void ajis__w_report(
+    ajis__writer* w,
     const char* filename,
     const char* source,
     size_t source_len,
     const ajis_error* err
 ) {
-    if (!out || !err || err->code == AJIS_OK) return;
+    char num[32];
 
     /* Header */
-    fprintf(out, "%sError:%s %s", AJIS_C_RED_B, AJIS_C_RESET, ajis_error_code_name(err->code));
+    ajis__w_str(w, AJIS_C_RED_B "Error:" AJIS_C_RESET " ");
+    ajis__w_str(w, ajis_error_code_name(err->code));
     if (err->context && err->context[0] != '\0') {
-        fprintf(out, " (%s)", err->context);
+        ajis__w_str(w, " (");
+        ajis__w_str(w, err->context);
+        ajis__w_str(w, ")");
     }
-    fprintf(out, "\n");
+    ajis__w_str(w, "\n");
 
     /* Location */
-    fprintf(out, "  %s-->%s %s:%u:%u\n",
-        AJIS_C_BLUE_B, AJIS_C_RESET,
-        filename ? filename : "<input>",
-        err->location.line,
-        err->location.column
-    );
+    ajis__w_str(w, "  " AJIS_C_BLUE_B "-->" AJIS_C_RESET " ");
+    ajis__w_str(w, filename ? filename : "<input>");
+    snprintf(num, sizeof(num), ":%u:%u\n", err->location.line, err->location.column);
+    ajis__w_str(w, num);
 
     /*
        Offsets can legitimately point to EOF (offset == source_len), e.g. unterminated
@@ -153,31 +227,38 @@ static inline void ajis_error_print_pretty(
         view_off = source_len - 1;
     }
 
-    /* Find the logical line [line_start, line_end) containing the error offset */
+    /*
+       Find the logical line [line_start, line_end) containing the error offset.
+       Only the neighbourhood that can be printed is searched: beyond `reach`
+       bytes the line is cropped anyway, so a huge single-line document costs
+       the same per error as a short line.
+     */
+    size_t ctx = (size_t)AJIS_ERROR_CONTEXT_CHARS;
+    size_t reach = ctx * 2 + 41;
+
     size_t line_start = view_off;
-    while (line_start > 0 && !ajis__is_linebreak(source[line_start - 1])) {
+    while (line_start > 0 && view_off - line_start < reach && !ajis__is_linebreak(source[line_start - 1])) {
         line_start--;
     }
+    int long_left = line_start > 0 && !ajis__is_linebreak(source[line_start - 1]);
 
     size_t line_end = view_off;
-    while (line_end < source_len && !ajis__is_linebreak(source[line_end])) {
+    while (line_end < source_len && line_end - view_off < reach && !ajis__is_linebreak(source[line_end])) {
         line_end++;
     }
+    int long_right = line_end < source_len && !ajis__is_linebreak(source[line_end]);
 
     /* If we are on CRLF and offset points at '\n', shift back to '\r' line end */
-    if (line_end > line_start && source[line_end - 1] == '\r') {
+    if (!long_right && line_end > line_start && source[line_end - 1] == '\r') {
         line_end--;
     }
 
     /* Line-number gutter width */
-    int line_num_width = snprintf(NULL, 0, "%u", err->location.line);
+    snprintf(num, sizeof(num), "%u", err->location.line);
+    int line_num_width = (int)strlen(num);
     if (line_num_width < 2) line_num_width = 2;
 
-    /* Visual caret column in the full line */
-    size_t caret_vis_col = ajis__visual_col(source, line_start, view_off);
-
     /* Crop long lines around the caret (context on each side, in bytes) */
-    size_t ctx = (size_t)AJIS_ERROR_CONTEXT_CHARS;
     size_t slice_start = line_start;
     size_t slice_end = line_end;
     int left_ellipsis = 0;
@@ -186,15 +267,15 @@ static inline void ajis_error_print_pretty(
     /* Byte-based cropping, but caret alignment is computed visually. */
     size_t err_byte_in_line = view_off - line_start;
 
-    if (line_end - line_start > (ctx * 2 + 40)) {
-        size_t want_start = (err_byte_in_line > ctx) ? (view_off - ctx) : line_start;
+    if (long_left || long_right || line_end - line_start > (ctx * 2 + 40)) {
+        size_t want_start = (long_left || err_byte_in_line > ctx) ? (view_off - ctx) : line_start;
         size_t want_end = view_off + ctx;
 
-        if (want_start > line_start) {
+        if (want_start > line_start || long_left) {
             slice_start = want_start;
             left_ellipsis = 1;
         }
-        if (want_end < line_end) {
+        if (want_end < line_end || long_right) {
             slice_end = want_end;
             right_ellipsis = 1;
         }
@@ -209,26 +290,28 @@ static inline void ajis_error_print_pretty(
     }
 
     /* Print empty gutter */
-    fprintf(out, " %*s %s|%s\n", line_num_width, "", AJIS_C_BLUE_B, AJIS_C_RESET);
+    ajis__w_gutter(w, line_num_width, NULL);
+    ajis__w_str(w, "\n");
 
     /* Print the source line (cropped) */
-    fprintf(out, " %s%*u |%s ", AJIS_C_BLUE_B, line_num_width, err->location.line, AJIS_C_RESET);
+    ajis__w_gutter(w, line_num_width, num);
+    ajis__w_str(w, " ");
     if (left_ellipsis) {
-        fprintf(out, "%s...%s", AJIS_C_DIM, AJIS_C_RESET);
+        ajis__w_str(w, AJIS_C_DIM "..." AJIS_C_RESET);
     }
-    ajis__fwrite_expand_tabs(out, source, slice_start, slice_end);
+    ajis__w_expand_tabs(w, source, slice_start, slice_end);
     if (right_ellipsis) {
-        fprintf(out, "%s...%s", AJIS_C_DIM, AJIS_C_RESET);
+        ajis__w_str(w, AJIS_C_DIM "..." AJIS_C_RESET);
     }
-    fprintf(out, "\n");
+    ajis__w_str(w, "\n");
 
     /* Pointer line */
-    fprintf(out, " %*s %s|%s ", line_num_width, "", AJIS_C_BLUE_B, AJIS_C_RESET);
+    ajis__w_gutter(w, line_num_width, NULL);
+    ajis__w_str(w, " ");
 
     /* If we printed a left ellipsis, the caret must be shifted by 3 chars. */
     size_t caret_pad = slice_caret_vis_col + (left_ellipsis ? 3 : 0);
-
-    for (size_t i = 0; i < caret_pad; i++) fputc(' ', out);
+    ajis__w_fill(w, ' ', caret_pad);
 
     /* Highlight length heuristic: default 1, extend to 2 for common "range" errors */
     size_t highlight_len = 1;
@@ -241,20 +324,65 @@ static inline void ajis_error_print_pretty(
         }
     }
 
-    fprintf(out, "%s^", AJIS_C_RED_B);
-    for (size_t i = 1; i < highlight_len; i++) fputc('^', out);
-    fprintf(out, "%s", AJIS_C_RESET);
+    ajis__w_str(w, AJIS_C_RED_B);
+    ajis__w_fill(w, '^', highlight_len);
+    ajis__w_str(w, AJIS_C_RESET);
 
     if (err->context && err->context[0] != '\0') {
-        fprintf(out, " %s", err->context);
+        ajis__w_str(w, " ");
+        ajis__w_str(w, err->context);
     }
-    fprintf(out, "\n");
+    ajis__w_str(w, "\n");
 
     /* Closing gutter */
-    fprintf(out, " %*s %s|%s\n", line_num_width, "", AJIS_C_BLUE_B, AJIS_C_RESET);
+    ajis__w_gutter(w, line_num_width, NULL);
+    ajis__w_str(w, "\n");
+}
+
+static inline void ajis_error_print_pretty(
+    FILE* out,
+    const char* filename,
+    const char* source,
+    size_t source_len,
+    const ajis_error* err
+) {
+    if (!out || !err || err->code == AJIS_OK) return;
+
+    ajis__writer w;
+    ajis__w_init(&w, out);
+    ajis__w_report(&w, filename, source, source_len, err);
+    ajis__w_flush(&w);
+}
 
-    /* Optional extra hint: show absolute caret visual column for debugging */
-    (void)caret_vis_col;
+/*
+ * Print many errors (e.g. ajis_diagnostics.items) through one buffered
+ * writer, separated by blank lines. `dropped` > 0 adds a final note
+ * about errors that did not fit into the diagnostics list.
+ */
+static inline void ajis_error_print_pretty_batch(
+    FILE* out,
+    const char* filename,
+    const char* source,
+    size_t source_len,
+    const ajis_error* errs,
+    size_t count,
+    size_t dropped
+) {
+    if (!out || (!errs && count)) return;
+
+    ajis__writer w;
+    ajis__w_init(&w, out);
+    for (size_t i = 0; i < count; i++) {
+        if (errs[i].code == AJIS_OK) continue;
+        if (i) ajis__w_str(&w, "\n");
+        ajis__w_report(&w, filename, source, source_len, &errs[i]);
+    }
+    if (dropped) {
+        char note[96];
+        snprintf(note, sizeof(note), "\n%s... and %zu more error(s) not shown%s\n", AJIS_C_DIM, dropped, AJIS_C_RESET);
+        ajis__w_str(&w, note);
+    }
+    ajis__w_flush(&w);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,72 @@
+#ifndef AJIS_FILE_H
+#define AJIS_FILE_H
+
+#include "ajis_alloc.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Zero-copy file input
+
+   ajis_file_open() returns a read-only view of a whole file with
+   at least AJIS_FILE_PADDING zero bytes readable after the last
+   byte, so scanning kernels may load whole words past the end.
+
+   Large files are mmap'ed when the tail of the last page already
+   provides the padding (the kernel zero-fills it). Small files,
+   and files whose size leaves too little room in the last page,
+   are read into a caller-owned scratch buffer that is reused from
+   file to file (one per thread), so a batch run does not malloc
+   per file.
+
+   The view is valid until ajis_file_close() or the next open with
+   the same scratch buffer. Truncating a file while it is mapped
+   raises SIGBUS, as with any mmap reader.
+   ============================================================ */
+
+#define AJIS_FILE_PADDING 64
+
+/* Files below this size are read rather than mapped (map + unmap costs more). */
+#define AJIS_FILE_MMAP_MIN (64u * 1024u)
+
+typedef struct ajis_file_buffer {
+    uint8_t *data;
+    size_t capacity;
+    const ajis_allocator *allocator;    /* NULL = malloc */
+} ajis_file_buffer;
+
+typedef struct ajis_file_view {
+    const uint8_t *data;   /* length bytes + AJIS_FILE_PADDING zero bytes */
+    size_t length;
+
+    void *map;             /* mapping base, NULL when read into scratch */
+    size_t map_length;
+} ajis_file_view;
+
+static inline void ajis_file_buffer_init_with(ajis_file_buffer *buf, const ajis_allocator *alloc) {
+    buf->data = NULL;
+    buf->capacity = 0;
+    buf->allocator = alloc;
+}
+
+static inline void ajis_file_buffer_init(ajis_file_buffer *buf) {
+    ajis_file_buffer_init_with(buf, NULL);
+}
+
+void ajis_file_buffer_free(ajis_file_buffer *buf);
+
+/* Returns 0 or an errno value. */
+int ajis_file_open(ajis_file_view *view, const char *path, ajis_file_buffer *scratch);
+
+void ajis_file_close(ajis_file_view *view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_FILE_H */
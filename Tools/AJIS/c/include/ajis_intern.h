@@ -0,0 +1,134 @@
+#ifndef AJIS_INTERN_H
+#define AJIS_INTERN_H
+
+#include "ajis_alloc.h"
+#include "ajis_error.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Key interning
+
+   Record streams repeat the same few hundred object keys millions
+   of times. An intern table maps each distinct (decoded) key to a
+   small integer symbol, so a DOM or a transcoder stores 4 bytes per
+   key instead of a copy, and key equality is an integer compare.
+
+   - keys are looked up by a hash of the raw token span; a span
+     without a backslash is its own decoding and is interned as is,
+     only spans with escapes are decoded first (ajis_string.h), so
+     "\u0061" and "a" are one symbol
+   - symbols are dense, assigned in first-seen order from 1, and
+     stay valid (with the same bytes) until the table is destroyed;
+     AJIS_SYMBOL_NONE (0) is never a key
+   - symbol order is not key order: ajis_intern_ranks() produces a
+     rank per symbol, and ajis_intern_rank_symbols() one for just the
+     symbols a document uses, so canonical (byte-order) sorting
+     compares integers too
+
+   Per-thread use needs no locking. A table created `shared` takes
+   a mutex on insertion and around every call into its allocator
+   (arena and pool allocators are not thread-safe); put an
+   ajis_intern_cache in front of it on each thread so repeated keys
+   are resolved without the lock.
+   The table must not be moved after init.
+   ============================================================ */
+
+typedef uint32_t ajis_symbol;
+
+#define AJIS_SYMBOL_NONE 0u
+
+#define AJIS_INTERN_PAGE_BITS 12
+#define AJIS_INTERN_MAX_SYMBOLS (1u << 24)
+
+typedef struct ajis_intern_entry {
+    const uint8_t *bytes;       /* decoded key, NUL-terminated */
+    uint32_t length;
+    uint32_t hash;              /* low bits of the 64-bit key hash */
+} ajis_intern_entry;
+
+typedef struct ajis_intern_table {
+    const ajis_allocator *allocator;
+    ajis_arena strings;         /* key bytes; chunks never move */
+
+    ajis_intern_entry **pages;  /* fixed directory, pages added as symbols grow */
+    uint32_t count;             /* symbols assigned so far */
+
+    uint32_t *index;            /* open addressing: symbol per slot, 0 = empty */
+    size_t index_cap;           /* power of two */
+
+    int shared;
+    pthread_mutex_t lock;
+} ajis_intern_table;
+
+/* Returns AJIS_OK or AJIS_ERR_SIZE_LIMIT (out of memory). `alloc` NULL = malloc. */
+ajis_error_code ajis_intern_init(ajis_intern_table *t, const ajis_allocator *alloc, int shared);
+void ajis_intern_destroy(ajis_intern_table *t);
+
+/* Symbol for decoded key bytes; inserted when new. AJIS_SYMBOL_NONE on out of memory or table full. */
+ajis_symbol ajis_intern_bytes(ajis_intern_table *t, const uint8_t *key, size_t len);
+
+/* Lookup only: AJIS_SYMBOL_NONE when the key was never interned. */
+ajis_symbol ajis_intern_find(ajis_intern_table *t, const uint8_t *key, size_t len);
+
+/*
+ * Symbol for a string token body as written (lexer span, no quotes).
+ * `unescape_flags` as for ajis_string_unescape(). Returns AJIS_OK,
+ * AJIS_ERR_INVALID_ESCAPE, or AJIS_ERR_SIZE_LIMIT.
+ */
+ajis_error_code ajis_intern_raw(ajis_intern_table *t, const uint8_t *raw, size_t len, unsigned unescape_flags,
+                                ajis_symbol *out);
+
+/* Bytes of a symbol (NUL-terminated); NULL for AJIS_SYMBOL_NONE or an unknown symbol. */
+const uint8_t *ajis_intern_str(const ajis_intern_table *t, ajis_symbol sym, size_t *len);
+
+/* Number of symbols (the largest symbol). */
+uint32_t ajis_intern_count(ajis_intern_table *t);
+
+/*
+ * Fill ranks[sym] (sym in 0..count) with the byte-order rank of each
+ * key, 1-based (ranks[0] = 0), so that comparing ranks compares keys.
+ * Returns count + 1, the number of entries needed; nothing is written
+ * when that exceeds `cap`. Returns 0 on out of memory.
+ */
+size_t ajis_intern_ranks(ajis_intern_table *t, uint32_t *ranks, size_t cap);
+
+/*
+ * Replace each of the `n` symbols in `syms` (all valid, repeats
+ * allowed) with its byte-order rank among them, 1-based; a repeated
+ * symbol gets the same rank. Costs O(n log n) whatever the table's
+ * size. Returns AJIS_OK or AJIS_ERR_SIZE_LIMIT (out of memory).
+ */
+ajis_error_code ajis_intern_rank_symbols(ajis_intern_table *t, uint32_t *syms, size_t n);
+
+/* ---------- per-thread cache for shared tables ---------- */
+
+#define AJIS_INTERN_CACHE_SLOTS 512
+
+typedef struct ajis_intern_cache {
+    ajis_intern_table *table;
+    struct {
+        uint64_t hash;
+        ajis_symbol sym;
+    } slots[AJIS_INTERN_CACHE_SLOTS];
+    size_t hits;
+    size_t misses;
+} ajis_intern_cache;
+
+void ajis_intern_cache_init(ajis_intern_cache *c, ajis_intern_table *t);
+
+/* Same contract as ajis_intern_raw(); takes the table lock only on a cache miss. */
+ajis_error_code ajis_intern_cache_raw(ajis_intern_cache *c, const uint8_t *raw, size_t len, unsigned unescape_flags,
+                                      ajis_symbol *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_INTERN_H */
@@ -33,6 +33,20 @@ int ajis_input_peek_ahead(const ajis_input *in, size_t ahead);
  */
 ajis_error_code ajis_lexer_next(ajis_lexer *lx, ajis_token *out_tok, ajis_error *err);
 
+/*
+ * Error-recovering variant: never stops at a bad token. Each error is
+ * added to `diag` (may be NULL), the input is resynchronized at the
+ * next safe boundary, and an AJIS_TOKEN_INVALID token spanning the
+ * skipped bytes is returned so the caller keeps its position. Loop
+ * until AJIS_TOKEN_EOF to get every diagnostic in one scan.
+ *
+ * Resync points: inside a string or binary literal, the closing quote
+ * or the end of the line; elsewhere, the next whitespace, quote or
+ * structural byte ({ } [ ] : ,). An unterminated block comment runs
+ * to EOF. Returns AJIS_OK unless the arguments are invalid.
+ */
+ajis_error_code ajis_lexer_next_recover(ajis_lexer *lx, ajis_token *out_tok, ajis_diagnostics *diag);
+
 #ifdef __cplusplus
 }
 #endif
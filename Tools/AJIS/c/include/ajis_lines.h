@@ -0,0 +1,144 @@
+#ifndef AJIS_LINES_H
+#define AJIS_LINES_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+#include "ajis_validate.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AJIS-lines: one value per line
+
+   A stream of independent AJIS values separated by newlines (logs,
+   event pipelines). Records are framed without lexing them:
+
+   - a newline ends a record unless it is inside a block comment, or
+     inside a string when allow_multiline_strings is set
+   - a "//" comment runs to the newline, which still ends the record
+   - lines holding only whitespace and comments are not records
+   - a block comment that is never closed is read as a line comment,
+     so one unclosed comment cannot swallow the rest of the stream;
+     with multiline strings off (the default) a stray quote cannot
+     either
+
+   Framing looks only for '\n', '"', '/', '\\' and '*', 16 bytes at a
+   time (SSE2) or 8 (SWAR).
+
+   ajis_lines_run() frames a window of records, processes the records
+   on a work-stealing pool (ajis_pool.h), then reports them in input
+   order on the calling thread, window after window. Every record has
+   its own result: a failing record is reported and the run goes on.
+   ============================================================ */
+
+typedef struct ajis_lines_record {
+    size_t index;       /* 0-based among records (blank lines not counted) */
+    size_t offset;      /* first byte in the stream */
+    size_t length;      /* without the newline and a trailing '\r' */
+    size_t line;        /* 1-based line of the first byte */
+} ajis_lines_record;
+
+/* ---------- framing ---------- */
+
+typedef struct ajis_lines_framer {
+    const uint8_t *data;
+    size_t length;
+    size_t pos;
+    size_t line;
+    size_t index;
+    size_t no_close_from;   /* no comment close starts at or after this offset */
+    int multiline;
+} ajis_lines_framer;
+
+void ajis_lines_framer_init(ajis_lines_framer *fr, const void *data, size_t len, ajis_lexer_options options);
+
+/* Next record; returns 0 at the end of the stream. */
+int ajis_lines_next(ajis_lines_framer *fr, ajis_lines_record *rec);
+
+/* ---------- parallel processing ---------- */
+
+/* Growable byte buffer for per-record output. */
+typedef struct ajis_lines_buffer {
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    const ajis_allocator *allocator;
+} ajis_lines_buffer;
+
+/* Returns AJIS_OK, or AJIS_ERR_SIZE_LIMIT when out of memory. */
+ajis_error_code ajis_lines_buffer_append(ajis_lines_buffer *buf, const void *bytes, size_t len);
+
+typedef struct ajis_lines_task {
+    const uint8_t *data;        /* the record's bytes */
+    ajis_lines_record record;
+    unsigned worker;
+    ajis_arena *arena;          /* per worker, reset after each record */
+    ajis_lines_buffer *out;     /* per worker; what is appended is this record's output */
+} ajis_lines_task;
+
+/*
+ * Process one record (any thread). Error locations are relative to
+ * the record; they are moved to stream lines and offsets before the
+ * record is reported.
+ */
+typedef ajis_error_code (*ajis_lines_process_fn)(ajis_lines_task *task, ajis_error *err, void *ctx);
+
+/*
+ * Called for every record in input order, on the thread that called
+ * ajis_lines_run(). `out` holds what process appended. Return 0 to
+ * continue, anything else to stop after this record.
+ */
+typedef int (*ajis_lines_report_fn)(const ajis_lines_record *rec, ajis_error_code rc, const ajis_error *err,
+                                    const uint8_t *out, size_t out_len, void *ctx);
+
+#define AJIS_LINES_DEFAULT_WINDOW (16u * 1024u * 1024u)
+
+typedef struct ajis_lines_options {
+    ajis_lexer_options lexer;       /* framing follows allow_multiline_strings */
+    unsigned threads;               /* 0 = online CPUs */
+    size_t window_bytes;            /* input framed per round; 0 = AJIS_LINES_DEFAULT_WINDOW */
+    const ajis_allocator *allocator; /* NULL = malloc */
+} ajis_lines_options;
+
+static inline ajis_lines_options ajis_lines_options_default(void) {
+    ajis_lines_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.threads = 0;
+    o.window_bytes = 0;
+    o.allocator = NULL;
+    return o;
+}
+
+typedef struct ajis_lines_stats {
+    size_t records;
+    size_t failed;
+    size_t bytes;       /* input consumed */
+    int stopped;        /* report asked to stop */
+} ajis_lines_stats;
+
+/*
+ * Frame, process and report every record. `opt` and `stats` may be
+ * NULL. Returns AJIS_OK (also when report stopped the run, see
+ * stats->stopped) or AJIS_ERR_SIZE_LIMIT when out of memory.
+ */
+ajis_error_code ajis_lines_run(const void *data, size_t len, const ajis_lines_options *opt,
+                               ajis_lines_process_fn process, ajis_lines_report_fn report, void *ctx,
+                               ajis_lines_stats *stats);
+
+/*
+ * ajis_lines_run() with ajis_validate() on each record (per-worker
+ * arena as its allocator). vopt->lexer is used for framing too;
+ * `vopt` may be NULL for the defaults.
+ */
+ajis_error_code ajis_lines_validate(const void *data, size_t len, const ajis_lines_options *opt,
+                                    const ajis_validate_options *vopt, ajis_lines_report_fn report, void *ctx,
+                                    ajis_lines_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_LINES_H */
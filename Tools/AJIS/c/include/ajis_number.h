@@ -0,0 +1,51 @@
+#ifndef AJIS_NUMBER_H
+#define AJIS_NUMBER_H
+
+#include "ajis_error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Number values
+
+   Converts the raw bytes of a NUMBER token (as the lexer accepted
+   them) to a value:
+
+   - digit separators (' ', '_', ',') are skipped
+   - 0x / 0b / 0o literals and decimals without fraction or
+     exponent are integers; they must fit in int64
+   - everything else is a double, exact for up to 15 significant
+     digits and exponents within +-22 (the common case), otherwise
+     correctly rounded by strtod() (assumes the "C" numeric locale)
+
+   Decimal integers beyond int64 become doubles, like JSON readers
+   do; base-prefixed literals beyond int64 are an error.
+   ============================================================ */
+
+typedef enum ajis_number_kind {
+    AJIS_NUMBER_INT = 0,
+    AJIS_NUMBER_FLOAT
+} ajis_number_kind;
+
+typedef struct ajis_number {
+    ajis_number_kind kind;
+    int64_t i;          /* AJIS_NUMBER_INT */
+    double f;           /* the value as a double, for both kinds */
+} ajis_number;
+
+/*
+ * Returns AJIS_OK, AJIS_ERR_INVALID_NUMBER for bytes that are not a
+ * number, or AJIS_ERR_SIZE_LIMIT when the value is out of range.
+ */
+ajis_error_code ajis_number_parse(const uint8_t *raw, size_t len, ajis_number *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_NUMBER_H */
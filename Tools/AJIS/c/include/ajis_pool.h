@@ -0,0 +1,50 @@
+#ifndef AJIS_POOL_H
+#define AJIS_POOL_H
+
+#include "ajis_alloc.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Work-stealing task pool
+
+   Runs fn(i) for every i in [0, count) on `threads` workers.
+   Each worker starts with a contiguous slice of the index range
+   and takes items from the front of its own slice; a worker whose
+   slice is empty steals the back half of another worker's slice.
+   Slices are a single packed 64-bit atomic (lo, hi), so taking
+   and stealing are both one CAS and no index runs twice.
+
+   Uneven tasks (one 200 MB file among thousands of 2 KB files)
+   therefore never leave workers idle while work remains.
+
+   POSIX threads + C11 atomics.
+   ============================================================ */
+
+/* `worker` is in [0, threads) and stable for the calling thread. */
+typedef void (*ajis_pool_task_fn)(size_t index, unsigned worker, void *ctx);
+
+/* Number of online CPUs (at least 1). */
+unsigned ajis_pool_default_threads(void);
+
+/*
+ * Run all tasks and wait for them; the calling thread is worker 0.
+ * `threads` 0 selects ajis_pool_default_threads(). Returns 0, EINVAL
+ * if count does not fit in 32 bits, or the pthread_create() error if
+ * a worker could not be started (the workers that did start steal
+ * its slice, so every task still runs).
+ */
+int ajis_pool_run(size_t count, unsigned threads, ajis_pool_task_fn fn, void *ctx);
+
+/* Same, with the per-run bookkeeping (one block) taken from `alloc`. */
+int ajis_pool_run_with(size_t count, unsigned threads, ajis_pool_task_fn fn, void *ctx, const ajis_allocator *alloc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_POOL_H */
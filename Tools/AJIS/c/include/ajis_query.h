@@ -0,0 +1,114 @@
+#ifndef AJIS_QUERY_H
+#define AJIS_QUERY_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+#include "ajis_number.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Path queries
+
+   Extracts the values at a path without building a tree:
+
+     $.items[*].price      $["odd key"][0]      $.*.id
+
+   Steps: .name, ["name"] / ['name'] (\" \' \\ escapes), [N], [*]
+   and .* ; the leading $ is optional.
+
+   A compiled query is matched against the token stream while the
+   document is read. Only containers on a matching path are lexed;
+   any other value is skipped whole: strings and comments are
+   stepped over and brackets counted, 16 (SSE2) or 8 (SWAR) bytes at
+   a time, with no tokens and no grammar checks. A skipped subtree
+   is therefore not validated, only required to be balanced (pair
+   with ajis_validate() when that matters).
+
+   Each match is reported as a span and, with AJIS_QUERY_DECODE, as
+   a decoded scalar. For a stream of values (AJIS-lines), run the
+   query on each record from an ajis_lines_run() process callback.
+   ============================================================ */
+
+#define AJIS_QUERY_MAX_STEPS 32
+#define AJIS_QUERY_MAX_NAMES 512    /* bytes for all decoded step names */
+
+typedef enum ajis_query_step_kind {
+    AJIS_QUERY_FIELD = 0,
+    AJIS_QUERY_INDEX,
+    AJIS_QUERY_ANY_FIELD,           /* .* */
+    AJIS_QUERY_ANY_INDEX            /* [*] */
+} ajis_query_step_kind;
+
+typedef struct ajis_query_step {
+    ajis_query_step_kind kind;
+    uint32_t name_offset;           /* FIELD: decoded name in `names` */
+    uint32_t name_length;
+    size_t index;                   /* INDEX */
+} ajis_query_step;
+
+/* A compiled path; plain data, no cleanup needed. */
+typedef struct ajis_query {
+    ajis_query_step steps[AJIS_QUERY_MAX_STEPS];
+    size_t count;
+    uint8_t names[AJIS_QUERY_MAX_NAMES];
+    size_t names_used;
+} ajis_query;
+
+/*
+ * Compile `path` (NUL-terminated). Returns AJIS_OK, AJIS_ERR_INVALID_SYNTAX
+ * with the column in err->location, or AJIS_ERR_SIZE_LIMIT when the path
+ * has too many steps or too long names. `err` may be NULL.
+ */
+ajis_error_code ajis_query_compile(ajis_query *q, const char *path, ajis_error *err);
+
+/* Decode matched scalars (numbers, strings, booleans) into the match. */
+#define AJIS_QUERY_DECODE 0x1u
+
+typedef struct ajis_query_options {
+    ajis_lexer_options lexer;
+    unsigned flags;
+    const ajis_allocator *allocator;    /* decode buffer for long strings; NULL = malloc */
+} ajis_query_options;
+
+static inline ajis_query_options ajis_query_options_default(void) {
+    ajis_query_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.flags = 0;
+    o.allocator = NULL;
+    return o;
+}
+
+typedef struct ajis_query_match {
+    ajis_token_type type;       /* value token; LBRACE / LBRACKET for containers */
+    ajis_span span;             /* token span (string bodies without quotes), or the whole container */
+    ajis_span key;              /* raw member name for object members, else empty */
+    size_t index;               /* array index, or position of the member in its object */
+
+    /* AJIS_QUERY_DECODE */
+    ajis_number number;         /* NUMBER */
+    const uint8_t *text;        /* STRING: decoded, valid during the callback */
+    size_t text_length;
+    int boolean;                /* TRUE / FALSE */
+} ajis_query_match;
+
+/* Return 0 to continue, anything else to stop the run. */
+typedef int (*ajis_query_fn)(const ajis_query_match *m, void *ctx);
+
+/*
+ * Report every value of the document `data` at the path of `q`, in
+ * document order. `opt` and `err` may be NULL. Returns AJIS_OK (also
+ * when `fn` stopped the run) or the first error met on a matching path
+ * (lexing, grammar, undecodable scalar, unbalanced skipped subtree).
+ */
+ajis_error_code ajis_query_run(const ajis_query *q, const void *data, size_t len, const ajis_query_options *opt,
+                               ajis_query_fn fn, void *ctx, ajis_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_QUERY_H */
@@ -0,0 +1,100 @@
+#ifndef AJIS_RELEX_H
+#define AJIS_RELEX_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Incremental re-lexing
+
+   An ajis_token_list holds the token stream of a document (as
+   ajis_lexer_next_recover() produces it, ending with EOF) and keeps
+   it current across edits:
+
+   - every token owns the bytes from the end of the previous token to
+     its own end (leading whitespace and comments included), so the
+     tokens tile the document
+   - the lexer has no state between tokens and reads at most
+     AJIS_RELEX_LOOKAHEAD bytes past a token's end (number separator
+     disambiguation peeks 4 digits ahead), so tokens ending that far
+     before the edit are unaffected; lexing restarts at the end of the
+     last of them
+   - lexing stops as soon as a new token ends where an old token ended
+     (shifted by the edit), past the edited bytes: everything after
+     that boundary was lexed from identical bytes, so it is kept
+
+   Tokens are stored in a gap buffer, and tokens after the gap keep
+   their offsets relative to the end of the document, so neither the
+   shift nor the splice touches the rest of the list. An edit costs
+   the bytes re-lexed plus the distance from the previous edit.
+
+   The result is exactly what a full ajis_token_list_lex() of the new
+   text gives. No diagnostics are kept: INVALID tokens mark errors,
+   and ajis_lexer_next() from the token start reproduces the message.
+   ============================================================ */
+
+#define AJIS_RELEX_LOOKAHEAD 8
+
+typedef struct ajis_token_entry {
+    ajis_token token;
+    size_t end;             /* offset after the token */
+} ajis_token_entry;
+
+typedef struct ajis_token_list {
+    ajis_token_entry *items;    /* [0, gap_start) absolute; [gap_end, capacity) relative to doc end */
+    size_t gap_start;
+    size_t gap_end;
+    size_t capacity;
+    size_t doc_length;
+    ajis_lexer_options options;
+    const ajis_allocator *allocator;
+} ajis_token_list;
+
+/* One edit: `removed` bytes at `offset` were replaced by `inserted` bytes. */
+typedef struct ajis_edit {
+    size_t offset;
+    size_t removed;
+    size_t inserted;
+} ajis_edit;
+
+typedef struct ajis_relex_stats {
+    size_t restart_offset;      /* where lexing resumed */
+    size_t resync_offset;       /* where it stopped (new coordinates) */
+    size_t tokens_lexed;
+    size_t tokens_dropped;      /* old tokens replaced */
+} ajis_relex_stats;
+
+void ajis_token_list_init(ajis_token_list *list, ajis_lexer_options options, const ajis_allocator *alloc);
+void ajis_token_list_free(ajis_token_list *list);
+
+/* Lex a whole document. Returns AJIS_OK or AJIS_ERR_SIZE_LIMIT (out of memory). */
+ajis_error_code ajis_token_list_lex(ajis_token_list *list, const void *data, size_t len);
+
+/*
+ * Bring the list up to date after `edit`. `data`/`len` is the whole
+ * document after the edit. `stats` may be NULL. Returns AJIS_OK,
+ * AJIS_ERR_SIZE_LIMIT, or AJIS_ERR_UNKNOWN when the edit does not
+ * fit the previous length.
+ */
+ajis_error_code ajis_token_list_apply(ajis_token_list *list, const void *data, size_t len,
+                                      const ajis_edit *edit, ajis_relex_stats *stats);
+
+static inline size_t ajis_token_list_count(const ajis_token_list *list) {
+    return list->capacity - (list->gap_end - list->gap_start);
+}
+
+/* Token `i` with absolute offsets; `end` may be NULL. */
+ajis_token ajis_token_list_get(const ajis_token_list *list, size_t i, size_t *end);
+
+/* Index of the token whose bytes include `offset` (the EOF token for offset >= length). */
+size_t ajis_token_list_find(const ajis_token_list *list, size_t offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_RELEX_H */
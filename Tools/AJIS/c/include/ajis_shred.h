@@ -0,0 +1,171 @@
+#ifndef AJIS_SHRED_H
+#define AJIS_SHRED_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Columnar shredding
+
+   Turns an array of similarly shaped objects (row records) into one
+   contiguous buffer per field:
+
+     [ {"id": 1, "name": "a", "price": 2.5},      id     INT64    1  2
+       {"id": 2, "name": "b", "price": null} ]    name   STRING   a  b
+                                                  price  FLOAT64  2.5 -
+
+   The schema is inferred from the first `infer_records` records:
+   columns in order of first appearance, each typed by the values
+   seen (int + float -> FLOAT64, unless an int is one a double does
+   not hold exactly; anything else mixed -> RAW). After that, every
+   record becomes one row of every column; a missing member or null
+   is a cleared validity bit.
+
+   A later record that does not fit widens its column where that
+   loses nothing the column holds (INT64 -> FLOAT64 while every int
+   in it is exact as a double, an all-null column takes the first
+   type it meets) and otherwise goes whole, as AJIS text, to the
+   fallback blob: a type the column cannot hold (a float beside ints
+   past 2^53, an int past 2^53 in a FLOAT64 column), a member the
+   schema lacks (unless AJIS_SHRED_ADD_COLUMNS), a duplicate member,
+   or a value that is not an object.
+
+   Rows are kept to records that fit; fallback.records[] gives the
+   original positions of the others.
+   ============================================================ */
+
+typedef enum ajis_column_type {
+    AJIS_COLUMN_NULL = 0,       /* only nulls so far: no value buffer */
+    AJIS_COLUMN_BOOL,           /* values.boolean: 0 / 1 */
+    AJIS_COLUMN_INT64,          /* values.i64 */
+    AJIS_COLUMN_FLOAT64,        /* values.f64 */
+    AJIS_COLUMN_STRING,         /* decoded UTF-8 in bytes[offsets[r] .. offsets[r + 1]) */
+    AJIS_COLUMN_RAW             /* AJIS text of each value (containers, binary, mixed types), same layout */
+} ajis_column_type;
+
+/*
+ * One field. Row r has a value when bit (r % 64) of validity[r / 64]
+ * is set. Slots of missing values hold 0 (an empty string for
+ * STRING / RAW), so sums run over the whole buffer without masking.
+ */
+typedef struct ajis_column {
+    uint8_t *name;              /* decoded member name, NUL-terminated */
+    size_t name_length;
+    ajis_column_type type;
+    union {
+        uint8_t *boolean;
+        int64_t *i64;
+        double *f64;
+        void *data;
+    } values;
+    uint64_t *offsets;          /* STRING / RAW: rows + 1 entries */
+    uint8_t *bytes;
+    size_t bytes_length;
+    size_t bytes_capacity;
+    uint64_t *validity;
+    size_t null_count;
+    size_t capacity;            /* rows the buffers hold */
+} ajis_column;
+
+/* Records that did not fit, as AJIS text: record i is bytes[offsets[i] .. offsets[i + 1]). */
+typedef struct ajis_shred_fallback {
+    uint8_t *bytes;
+    size_t bytes_length;
+    size_t bytes_capacity;
+    uint64_t *offsets;          /* count + 1 entries */
+    size_t *records;            /* position of each among all records */
+    size_t count;
+    size_t capacity;
+} ajis_shred_fallback;
+
+#define AJIS_SHRED_DEFAULT_INFER 1024
+
+/* Give members missing from the schema a new column (null in earlier rows). */
+#define AJIS_SHRED_ADD_COLUMNS 0x1u
+
+typedef struct ajis_shred_options {
+    ajis_lexer_options lexer;
+    size_t infer_records;                   /* 0 = AJIS_SHRED_DEFAULT_INFER */
+    size_t max_columns;                     /* 0 = no limit; members past it fall back */
+    unsigned flags;
+    const ajis_allocator *allocator;        /* NULL = malloc */
+} ajis_shred_options;
+
+static inline ajis_shred_options ajis_shred_options_default(void) {
+    ajis_shred_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.infer_records = AJIS_SHRED_DEFAULT_INFER;
+    o.max_columns = 0;
+    o.flags = 0;
+    o.allocator = NULL;
+    return o;
+}
+
+typedef struct ajis_shredder {
+    ajis_shred_options opt;
+    ajis_column *columns;
+    size_t column_count;
+    size_t rows;
+    size_t records;                         /* rows + fallback.count */
+    ajis_shred_fallback fallback;
+
+    /* internal */
+    size_t column_capacity;
+    size_t row_capacity;
+    int inferring;
+    uint8_t *seen;                          /* per column: value kinds met while inferring, inexact ints */
+    ajis_shred_fallback pending;            /* records held back while inferring */
+    void *entries;                          /* members of the record being added */
+    size_t entry_capacity;
+    int32_t *slots;                         /* per column: its member in `entries`, or -1 */
+    uint8_t *scratch;                       /* decoded keys and strings of that record */
+    size_t scratch_length;
+    size_t scratch_capacity;
+} ajis_shredder;
+
+/* `opt` may be NULL. */
+void ajis_shredder_init(ajis_shredder *s, const ajis_shred_options *opt);
+void ajis_shredder_destroy(ajis_shredder *s);
+
+/*
+ * Add one record: `len` bytes holding exactly one value (e.g. an
+ * AJIS-lines record). Returns AJIS_OK (also when the record went to
+ * the fallback blob), a lexing / grammar error located within `data`,
+ * or AJIS_ERR_SIZE_LIMIT when out of memory. A record that failed is
+ * not counted.
+ */
+ajis_error_code ajis_shred_add(ajis_shredder *s, const void *data, size_t len, ajis_error *err);
+
+/*
+ * Add every element of the array that is the document `data`. Stops at
+ * the first error, located within the document; the elements before it
+ * stay added.
+ */
+ajis_error_code ajis_shred_array(ajis_shredder *s, const void *data, size_t len, ajis_error *err);
+
+/*
+ * Settle the schema when fewer than `infer_records` records came in.
+ * Columns are complete only after this (ajis_shred_array() calls it).
+ */
+ajis_error_code ajis_shred_finish(ajis_shredder *s);
+
+/* Column named `name` (decoded), or NULL. */
+const ajis_column *ajis_shred_column(const ajis_shredder *s, const char *name);
+
+static inline int ajis_column_valid(const ajis_column *c, size_t row) {
+    return (int)((c->validity[row / 64] >> (row % 64)) & 1u);
+}
+
+/* Sum of an INT64 / FLOAT64 / BOOL column over `rows` rows; 0 for other types. */
+double ajis_column_sum(const ajis_column *c, size_t rows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_SHRED_H */
@@ -0,0 +1,50 @@
+#ifndef AJIS_STRING_H
+#define AJIS_STRING_H
+
+#include "ajis_error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   String escapes
+
+   Decodes the body of a string token (the lexer's span: the bytes
+   between the quotes) into UTF-8. Escapes:
+     \"  \\  \/  \b  \f  \n  \r  \t  \uXXXX
+   \uD800-\uDBFF followed by \uDC00-\uDFFF is one code point; a lone
+   surrogate is an error.
+
+   Every escape is at least as long as what it decodes to, so the
+   output never exceeds the input: an `out` of `len` bytes always
+   suffices, and decoding in place (out == raw) is allowed.
+   ============================================================ */
+
+/* Copy unknown escapes (\U, \D, ...) through unchanged instead of failing. */
+#define AJIS_UNESCAPE_KEEP_UNKNOWN 0x1u
+
+/* Non-zero when `raw` contains no backslash, i.e. it is already its own decoding. */
+static inline int ajis_string_is_plain(const uint8_t *raw, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (raw[i] == '\\') return 0;
+    }
+    return 1;
+}
+
+/*
+ * Decode `len` raw bytes into `out` (capacity >= len).
+ * Returns AJIS_OK, or AJIS_ERR_INVALID_ESCAPE with `*err_offset`
+ * (may be NULL) set to the backslash of the bad escape.
+ */
+ajis_error_code ajis_string_unescape(const uint8_t *raw, size_t len, unsigned flags,
+                                     uint8_t *out, size_t *out_len, size_t *err_offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_STRING_H */
@@ -0,0 +1,68 @@
+#ifndef AJIS_VALIDATE_H
+#define AJIS_VALIDATE_H
+
+#include "ajis_alloc.h"
+#include "ajis_lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Validate-only mode
+
+   ajis_validate() answers "is this one well-formed AJIS value?"
+   and reports the first error. Lexing and grammar checking run
+   in a single loop over the bytes:
+
+   - no ajis_token is produced; only offsets are tracked, and
+     line/column are computed once, for the error being reported
+   - string bodies are scanned 16 (SSE2) or 8 (SWAR) bytes at a
+     time; escapes are checked (\" \\ \/ \b \f \n \r \t \uXXXX)
+   - numbers and hex"/b64" literals are checked inline; digit
+     separators and every malformed literal go through the regular
+     lexer, so both agree on what a literal is and on its error
+
+   Grammar errors use the structural codes: AJIS_ERR_MISSING_COMMA,
+   AJIS_ERR_MISSING_COLON, AJIS_ERR_TRAILING_COMMA, AJIS_ERR_DEPTH_LIMIT,
+   AJIS_ERR_DUPLICATE_KEY, and AJIS_ERR_INVALID_SYNTAX for the rest
+   (mismatched brackets, missing values, content after the value).
+   ============================================================ */
+
+struct ajis_intern_table;
+
+/* Same limit as AUV Wire, so anything that validates can be transcoded. */
+#define AJIS_VALIDATE_DEFAULT_MAX_DEPTH 256
+
+typedef struct ajis_validate_options {
+    ajis_lexer_options lexer;
+    uint32_t max_depth;             /* 0 = AJIS_VALIDATE_DEFAULT_MAX_DEPTH */
+    int reject_duplicate_keys;      /* compares raw key bytes as written, unless `intern` is set */
+    int allow_unknown_escapes;      /* accept any "\x" like the lexer does */
+    const ajis_allocator *allocator; /* depth stack and key table; NULL = malloc */
+    struct ajis_intern_table *intern; /* duplicate keys compare decoded, as symbols (ajis_intern.h) */
+} ajis_validate_options;
+
+static inline ajis_validate_options ajis_validate_options_default(void) {
+    ajis_validate_options o;
+    o.lexer.allow_multiline_strings = 0;
+    o.lexer.allow_number_separators = 1;
+    o.max_depth = 0;
+    o.reject_duplicate_keys = 0;
+    o.allow_unknown_escapes = 0;
+    o.allocator = NULL;
+    o.intern = NULL;
+    return o;
+}
+
+/*
+ * Validate a whole document. `opt` may be NULL for the defaults.
+ * Returns AJIS_OK or the first error code, and fills `err`.
+ */
+ajis_error_code ajis_validate(const void *data, size_t len, const ajis_validate_options *opt, ajis_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AJIS_VALIDATE_H */
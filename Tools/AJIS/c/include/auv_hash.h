@@ -0,0 +1,57 @@
+#ifndef AUV_HASH_H
+#define AUV_HASH_H
+
+#include "ajis_alloc.h"
+#include "auv_wire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Semantic hashing and equality over AUV Wire v1 bytes
+
+   Both walk the wire buffer in place (no decoded tree, no sorted
+   copies) and follow spec section 3.1:
+
+   - +0.0 and -0.0 hash and compare equal, all NaNs are one value
+   - object key order is irrelevant: pair hashes are combined with
+     a commutative sum, equality looks keys up when the two objects
+     disagree on order
+   - byte-identical subtrees are accepted with one memcmp
+
+   The hash is stable across platforms and releases (it is meant
+   for persisted content-hash indexes). Inputs are assumed to be
+   valid AUV (unique keys, valid UTF-8); framing errors are still
+   reported.
+   ============================================================ */
+
+/* Flags for auv_equal() */
+#define AUV_EQ_CANONICAL 0x1u   /* both inputs have key-sorted objects: no lookups needed */
+
+/* Fast, stable 64-bit hash of a byte range (also used for String/Binary payloads). */
+uint64_t auv_hash_bytes(const void *data, size_t len, uint64_t seed);
+
+/*
+ * Semantic hash of one AUV Wire value occupying exactly [wire, wire+len).
+ * Semantically equal values produce the same hash for the same seed.
+ */
+auv_error_code auv_hash_value(const uint8_t *wire, size_t len, uint64_t seed, uint64_t *out_hash, auv_error *err);
+
+/*
+ * Semantic equality of two AUV Wire values.
+ * `*out_equal` is set to 1 or 0; `err` offsets refer to `a` or `b`
+ * (whichever failed to decode).
+ */
+auv_error_code auv_equal(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len,
+                         unsigned flags, int *out_equal, auv_error *err);
+
+/* Same, taking the key lookup table (objects whose key order differs) from `alloc`. */
+auv_error_code auv_equal_with(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len,
+                              unsigned flags, const ajis_allocator *alloc, int *out_equal, auv_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUV_HASH_H */
@@ -0,0 +1,92 @@
+#ifndef AUV_KEY_H
+#define AUV_KEY_H
+
+#include "ajis_alloc.h"
+#include "auv_wire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Order-preserving AUV keys
+
+   Maps AUV values to byte strings such that
+
+       memcmp order of keys == AUV total order (spec section 3.2)
+
+   so index lookups and external sorts can compare with plain
+   memcmp (or radix sort) instead of decoding both values.
+
+   Layout (big-endian everywhere, so bytes compare like numbers):
+
+     value    := type payload
+     type     := 1 byte, AUV precedence rank 0x01 (Null) .. 0x09 (Object)
+     Null     := (nothing)
+     Bool     := 0x00 | 0x01
+     Int64    := 8 bytes, value XOR 0x8000000000000000
+     Float64  := 8 bytes, IEEE bits with sign flip / full inversion
+                 (-0.0 folded to +0.0, every NaN folded to canonical NaN)
+     Char     := 4 bytes code point
+     String   := escaped bytes, 0x00 -> 0x00 0xFF, terminated by 0x00 0x01
+     Binary   := same as String
+     Array    := value* 0x00
+     Object   := (0x01 String)* 0x00 value*   keys sorted, then values
+                                              in key order
+
+   Every encoding is prefix-free, so keys can be concatenated to
+   build composite (multi-column) keys.
+   ============================================================ */
+
+typedef struct auv_key_buf {
+    uint8_t *data;      /* caller-owned output, may be NULL to measure */
+    size_t capacity;
+    size_t length;      /* bytes produced so far; may exceed capacity */
+    const ajis_allocator *allocator;    /* scratch for unsorted objects; NULL = malloc */
+} auv_key_buf;
+
+static inline void auv_key_buf_init(auv_key_buf *kb, uint8_t *data, size_t capacity) {
+    kb->data = data;
+    kb->capacity = data ? capacity : 0;
+    kb->length = 0;
+    kb->allocator = NULL;
+}
+
+/* Non-zero if everything appended so far fit into the buffer. */
+static inline int auv_key_buf_fits(const auv_key_buf *kb) {
+    return kb->length <= kb->capacity;
+}
+
+/* Scalar appenders (for building keys from native values). */
+void auv_key_append_null(auv_key_buf *kb);
+void auv_key_append_bool(auv_key_buf *kb, int value);
+void auv_key_append_int64(auv_key_buf *kb, int64_t value);
+void auv_key_append_float64(auv_key_buf *kb, double value);
+void auv_key_append_char(auv_key_buf *kb, uint32_t code_point);
+void auv_key_append_string(auv_key_buf *kb, const uint8_t *utf8, size_t len);
+void auv_key_append_binary(auv_key_buf *kb, const uint8_t *bytes, size_t len);
+
+/*
+ * Append the key of one AUV Wire v1 value read from [wire, wire+len).
+ * The value must be exactly `len` bytes long.
+ * Rejects malformed records and objects with duplicate keys.
+ */
+auv_error_code auv_key_append_value(auv_key_buf *kb, const uint8_t *wire, size_t len, auv_error *err);
+
+/*
+ * Convenience: encode one wire value into `out`.
+ * `*out_len` always receives the full key length; if it exceeds
+ * `out_cap` the call returns AUV_ERR_BUFFER_TOO_SMALL (pass
+ * out = NULL to size the buffer first).
+ */
+auv_error_code auv_key_encode(const uint8_t *wire, size_t len, uint8_t *out, size_t out_cap, size_t *out_len, auv_error *err);
+
+/* Same, taking the key-sort scratch from `alloc`. */
+auv_error_code auv_key_encode_with(const uint8_t *wire, size_t len, uint8_t *out, size_t out_cap, size_t *out_len,
+                                   const ajis_allocator *alloc, auv_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUV_KEY_H */
@@ -0,0 +1,95 @@
+#ifndef AUV_SEEK_H
+#define AUV_SEEK_H
+
+#include "ajis_alloc.h"
+#include "auv_wire.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Seek index for large AUV Wire containers
+
+   Array and object payloads are plain concatenations, so reaching
+   child i means skipping i records. A seek index samples the
+   payload offset of every K-th child (and, for objects, the first
+   bytes of the sampled key) in one scan, giving
+
+     at(i)        : jump to sample i/K, skip at most K-1 records
+     find(key)    : binary search over samples, then scan <= K pairs
+                    (key-sorted objects only; others scan linearly)
+
+   The index is a SIDECAR: the wire bytes are untouched, so every
+   v1 decoder still reads the value. It can be built lazily on the
+   first random access, or persisted next to the value:
+
+     "AUVS" | version u8 | tag u8 | flags u16 | stride u32 | reserved u32
+     count u64 | payload_length u64 | sample_count u64
+     offsets   sample_count * u64                (payload-relative)
+     prefixes  sample_count * 8 bytes            (objects only)
+     check     u64 = auv_hash_bytes(all bytes above, seed 0)
+
+   All integers little-endian. Loading is zero-copy.
+   ============================================================ */
+
+#define AUV_SEEK_DEFAULT_STRIDE 64
+#define AUV_SEEK_PREFIX_LEN 8
+
+/* auv_seek_index.flags */
+#define AUV_SEEK_SORTED_KEYS 0x1u   /* object keys strictly ascending (canonical) */
+
+typedef struct auv_seek_index {
+    auv_tag tag;                /* AUV_TAG_ARRAY or AUV_TAG_OBJECT */
+    uint32_t flags;
+    uint32_t stride;            /* K */
+    uint64_t count;             /* elements (arrays) or pairs (objects) */
+    uint64_t payload_length;    /* guards against use with a different value */
+    uint64_t sample_count;      /* ceil(count / K) */
+
+    const uint8_t *offsets;     /* sample_count little-endian u64 */
+    const uint8_t *prefixes;    /* sample_count * AUV_SEEK_PREFIX_LEN, or NULL */
+
+    void *owned;                /* storage owned by the index (built, not loaded) */
+    size_t owned_size;
+    const ajis_allocator *allocator;    /* that `owned` came from */
+} auv_seek_index;
+
+/*
+ * Build an index for the container record occupying exactly
+ * [wire, wire+len) in one scan. `stride` 0 selects the default.
+ * Release with auv_seek_free().
+ */
+auv_error_code auv_seek_build(const uint8_t *wire, size_t len, uint32_t stride, auv_seek_index *out, auv_error *err);
+
+/* Same, with the samples (and the scratch used to collect them) taken from `alloc`. */
+auv_error_code auv_seek_build_with(const uint8_t *wire, size_t len, uint32_t stride, const ajis_allocator *alloc,
+                                   auv_seek_index *out, auv_error *err);
+
+void auv_seek_free(auv_seek_index *idx);
+
+/* Child `i` of the container (element for arrays, value of pair `i` for objects). */
+auv_error_code auv_seek_at(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                           uint64_t i, auv_record *out, auv_error *err);
+
+/* Key of pair `i` (objects only). */
+auv_error_code auv_seek_key_at(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                               uint64_t i, auv_record *out, auv_error *err);
+
+/*
+ * Look up `key` in an object; `*found` is set to 0 or 1 and `out`
+ * receives the value record when found.
+ */
+auv_error_code auv_seek_find(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                             const uint8_t *key, size_t key_len, int *found, auv_record *out, auv_error *err);
+
+/* Persisted form: size, write, and zero-copy load (bytes must outlive `out`). */
+size_t auv_seek_serialized_size(const auv_seek_index *idx);
+auv_error_code auv_seek_serialize(const auv_seek_index *idx, uint8_t *out, size_t cap, size_t *out_len, auv_error *err);
+auv_error_code auv_seek_load(const uint8_t *bytes, size_t len, auv_seek_index *out, auv_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUV_SEEK_H */
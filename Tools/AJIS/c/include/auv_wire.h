@@ -0,0 +1,174 @@
+#ifndef AUV_WIRE_H
+#define AUV_WIRE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AUV Wire v1 (Specs/AUV.Spec.md, section 6)
+
+   Every value is a record:
+     TypeTag (1 byte) | Length (VarUInt) | Payload (Length bytes)
+
+   This header only covers reading single records. Containers
+   are walked by reading records back to back from the payload.
+   ============================================================ */
+
+typedef enum auv_tag {
+    AUV_TAG_NULL    = 0x00,
+    AUV_TAG_BOOL    = 0x01,
+    AUV_TAG_INT64   = 0x02,
+    AUV_TAG_FLOAT64 = 0x03,
+    AUV_TAG_CHAR    = 0x04,
+    AUV_TAG_STRING  = 0x05,
+    AUV_TAG_BINARY  = 0x06,
+    AUV_TAG_ARRAY   = 0x07,
+    AUV_TAG_OBJECT  = 0x08
+} auv_tag;
+
+/* Limits (spec section 4) */
+#define AUV_MAX_DEPTH 256
+
+/* Canonical quiet-NaN bit pattern (spec section 2.4) */
+#define AUV_CANONICAL_NAN_BITS 0x7FF8000000000000ull
+
+
+/* ============================================================
+   AUV Error Codes
+   ============================================================ */
+
+typedef enum auv_error_code {
+    AUV_OK = 0,
+
+    AUV_ERR_TRUNCATED,          /* record or VarUInt runs past the buffer */
+    AUV_ERR_UNKNOWN_TAG,
+    AUV_ERR_INVALID_LENGTH,     /* fixed-size payload with wrong length */
+    AUV_ERR_NONMINIMAL_VARUINT,
+    AUV_ERR_INVALID_BOOL,
+    AUV_ERR_INVALID_CHAR,
+    AUV_ERR_KEY_NOT_STRING,
+    AUV_ERR_MISSING_VALUE,      /* object payload ends after a key */
+    AUV_ERR_DUPLICATE_KEY,
+    AUV_ERR_DEPTH_LIMIT,
+    AUV_ERR_OUT_OF_MEMORY,
+    AUV_ERR_BUFFER_TOO_SMALL,
+    AUV_ERR_OUT_OF_RANGE,       /* element index past the end */
+    AUV_ERR_INDEX_MISMATCH      /* sidecar data does not belong to this value */
+
+} auv_error_code;
+
+typedef struct auv_error {
+    auv_error_code code;
+    size_t offset;          /* byte offset into the wire buffer */
+
+    /* Optional short context (non-owning) */
+    const char *context;
+} auv_error;
+
+static inline void auv_error_reset(auv_error *err) {
+    if (!err) return;
+    err->code = AUV_OK;
+    err->offset = 0;
+    err->context = NULL;
+}
+
+
+/* ============================================================
+   Records
+   ============================================================ */
+
+typedef struct auv_record {
+    auv_tag tag;
+    const uint8_t *payload;   /* points into the wire buffer */
+    size_t length;            /* payload length in bytes */
+    size_t size;              /* header + payload, i.e. bytes to skip */
+} auv_record;
+
+/* Number of bytes the shortest VarUInt encoding of `v` takes (1..10). */
+static inline size_t auv_varuint_size(uint64_t v) {
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* Write the shortest VarUInt encoding of `v`; returns bytes written. */
+static inline size_t auv_varuint_write(uint8_t *out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline uint64_t auv_load_u64le(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static inline uint32_t auv_load_u32le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/*
+ * Decode a VarUInt from [p, p+n).
+ * Rejects truncated, overlong (> 64 bits) and non-minimal encodings.
+ */
+auv_error_code auv_varuint_read(const uint8_t *p, size_t n, uint64_t *out_value, size_t *out_used);
+
+/*
+ * Read one record header from [p, p+n) and bounds-check its payload.
+ * Fixed-size payloads (Null/Bool/Int64/Float64/Char) are validated here;
+ * container payloads are not descended into.
+ * `base` is only used to report offsets relative to the start of the
+ * whole wire buffer (pass `p` when reading a top-level value).
+ */
+auv_error_code auv_record_read(const uint8_t *base, const uint8_t *p, size_t n, auv_record *out, auv_error *err);
+
+/* Start of the encoded record (its type tag). */
+static inline const uint8_t *auv_record_start(const auv_record *rec) {
+    return rec->payload + rec->length - rec->size;
+}
+
+
+/* ============================================================
+   Container iteration
+   ============================================================ */
+
+typedef struct auv_iter {
+    const uint8_t *base;    /* start of the whole wire buffer (for offsets) */
+    const uint8_t *p;       /* next child record */
+    const uint8_t *end;     /* end of the container payload */
+} auv_iter;
+
+static inline void auv_iter_init(auv_iter *it, const uint8_t *base, const auv_record *container) {
+    it->base = base;
+    it->p = container->payload;
+    it->end = container->payload + container->length;
+}
+
+static inline int auv_iter_done(const auv_iter *it) {
+    return it->p >= it->end;
+}
+
+/* Read the next array element. */
+auv_error_code auv_iter_next(auv_iter *it, auv_record *out, auv_error *err);
+
+/* Read the next object pair; rejects non-string keys and dangling keys. */
+auv_error_code auv_iter_next_pair(auv_iter *it, auv_record *key, auv_record *value, auv_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUV_WIRE_H */
@@ -0,0 +1,141 @@
+#include "../include/ajis_abi.h"
+#include "../include/ajis_auv.h"
+#include "../include/ajis_error_print.h"
+#include "../include/ajis_validate.h"
+
+#include <string.h>
+
+/* The layout hosts declare on their side. */
+_Static_assert(sizeof(ajis_abi_token) == 16, "ajis_abi_token is 16 bytes");
+_Static_assert(sizeof(ajis_abi_result) == 40, "ajis_abi_result is 40 bytes");
+_Static_assert(AJIS_TOKEN_INVALID == 14 && AJIS_ERR_SIZE_LIMIT == 17, "token types and status codes are frozen for ABI 1");
+
+/* ---------- helpers ---------- */
+
+static ajis_lexer_options lexer_options(uint32_t flags) {
+    ajis_lexer_options o;
+    o.allow_multiline_strings = (flags & AJIS_ABI_MULTILINE_STRINGS) != 0;
+    o.allow_number_separators = (flags & AJIS_ABI_NO_NUMBER_SEPARATORS) == 0;
+    return o;
+}
+
+static int32_t finish(ajis_abi_result *res, ajis_error_code rc, const ajis_error *err) {
+    if (res) {
+        res->status = (int32_t)rc;
+        if (rc != AJIS_OK && err) {
+            res->error_offset = err->location.offset;
+            res->error_line = err->location.line;
+            res->error_column = err->location.column;
+        }
+    }
+    return (int32_t)rc;
+}
+
+/* Line/column of `offset`, for lexer errors met after a resume. */
+static void locate(const uint8_t *data, size_t offset, ajis_error *err) {
+    uint32_t line = 1;
+    size_t line_start = 0;
+    for (size_t i = 0; i < offset; i++) {
+        if (data[i] == '\n') {
+            line++;
+            line_start = i + 1;
+        }
+    }
+    err->location.line = line;
+    err->location.column = (uint32_t)(offset - line_start) + 1;
+}
+
+/* ---------- entry points ---------- */
+
+AJIS_API uint32_t ajis_abi_version(void) {
+    return AJIS_ABI_VERSION;
+}
+
+AJIS_API const char *ajis_abi_status_name(int32_t status) {
+    return ajis_error_code_name((ajis_error_code)status);
+}
+
+AJIS_API int32_t ajis_abi_tokenize(const uint8_t *data, uint64_t len, uint64_t start, uint32_t flags,
+                                   ajis_abi_token *out, uint64_t cap, ajis_abi_result *res) {
+    ajis_abi_result local;
+    if (!res) res = &local;
+    memset(res, 0, sizeof(*res));
+    ajis_error err = ajis_error_ok();
+    if ((!data && len) || start > len || (!out && cap)) return finish(res, AJIS_ERR_UNKNOWN, NULL);
+
+    ajis_input in;
+    ajis_input_init(&in, data ? data : (const uint8_t *)"", (size_t)len);
+    in.offset = (size_t)start;
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, lexer_options(flags));
+
+    uint64_t n = 0;
+    res->next = start;
+    for (;;) {
+        if (n == cap) {
+            /* full: stop here unless only EOF is left */
+            ajis_input probe = in;
+            ajis_lexer plx;
+            ajis_lexer_init(&plx, &probe, lx.opt);
+            ajis_token t;
+            if (ajis_lexer_next(&plx, &t, NULL) == AJIS_OK && t.type == AJIS_TOKEN_EOF) break;
+            res->more = 1;
+            break;
+        }
+        ajis_token t;
+        ajis_error_code rc = ajis_lexer_next(&lx, &t, &err);
+        if (rc != AJIS_OK) {
+            if (start) locate(in.data, err.location.offset, &err);
+            res->written = n;
+            return finish(res, rc, &err);
+        }
+        if (t.type == AJIS_TOKEN_EOF) break;
+        if (t.span.length > UINT32_MAX) {
+            err.location.offset = t.span.offset;
+            locate(in.data, t.span.offset, &err);
+            res->written = n;
+            return finish(res, AJIS_ERR_SIZE_LIMIT, &err);
+        }
+        out[n].offset = t.span.offset;
+        out[n].length = (uint32_t)t.span.length;
+        out[n].type = (uint32_t)t.type;
+        n++;
+        res->next = in.offset;
+    }
+    res->written = n;
+    return finish(res, AJIS_OK, NULL);
+}
+
+AJIS_API int32_t ajis_abi_validate(const uint8_t *data, uint64_t len, uint32_t flags, ajis_abi_result *res) {
+    if (res) memset(res, 0, sizeof(*res));
+    if (!data && len) return finish(res, AJIS_ERR_UNKNOWN, NULL);
+
+    ajis_validate_options o = ajis_validate_options_default();
+    o.lexer = lexer_options(flags);
+    o.reject_duplicate_keys = (flags & AJIS_ABI_REJECT_DUPLICATE_KEYS) != 0;
+    ajis_error err;
+    ajis_error_code rc = ajis_validate(data ? data : (const uint8_t *)"", (size_t)len, &o, &err);
+    return finish(res, rc, &err);
+}
+
+AJIS_API int32_t ajis_abi_to_auv(const uint8_t *data, uint64_t len, uint32_t flags, uint8_t *out, uint64_t cap,
+                                 ajis_abi_result *res) {
+    if (res) memset(res, 0, sizeof(*res));
+    if ((!data && len) || (!out && cap)) return finish(res, AJIS_ERR_UNKNOWN, NULL);
+
+    ajis_auv_options o = ajis_auv_options_default();
+    o.lexer = lexer_options(flags);
+    o.canonical = (flags & AJIS_ABI_CANONICAL) != 0;
+    ajis_error err;
+    size_t needed = 0;
+    ajis_error_code rc = ajis_to_auv(data ? data : (const uint8_t *)"", (size_t)len, &o, out, (size_t)cap, &needed, &err);
+    if (res && rc == AJIS_OK) {
+        res->next = needed;
+        if (needed > cap) {
+            res->more = 1;
+        } else {
+            res->written = needed;
+        }
+    }
+    return finish(res, rc, &err);
+}
@@ -0,0 +1,243 @@
+#include "../include/ajis_alloc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- helpers ---------- */
+
+static size_t round_up(size_t n) {
+    return (n + (AJIS_ALLOC_ALIGN - 1)) & ~(size_t)(AJIS_ALLOC_ALIGN - 1);
+}
+
+/* ---------- malloc ---------- */
+
+static void *heap_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size ? size : 1);
+}
+
+static void *heap_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size ? new_size : 1);
+}
+
+static void heap_free(void *ctx, void *ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static const ajis_allocator k_heap = { heap_alloc, heap_realloc, heap_free, NULL };
+
+const ajis_allocator *ajis_allocator_malloc(void) {
+    return &k_heap;
+}
+
+/* ---------- bump arena ---------- */
+
+struct ajis_arena_chunk {
+    ajis_arena_chunk *next;
+    size_t size;                    /* usable bytes after the header */
+};
+
+#define CHUNK_HEADER round_up(sizeof(ajis_arena_chunk))
+
+static uint8_t *chunk_data(ajis_arena_chunk *c) {
+    return (uint8_t *)c + CHUNK_HEADER;
+}
+
+static int arena_push_chunk(ajis_arena *a, size_t need) {
+    size_t usable = a->chunk_size > need ? a->chunk_size : need;
+    if (usable > SIZE_MAX - CHUNK_HEADER) return 0;
+
+    ajis_arena_chunk *c = (ajis_arena_chunk *)ajis_alloc(a->parent, CHUNK_HEADER + usable);
+    if (!c) return 0;
+    c->next = a->chunks;
+    c->size = usable;
+    a->chunks = c;
+    a->chunk_count++;
+    a->ptr = chunk_data(c);
+    a->end = a->ptr + usable;
+    a->last = NULL;
+    if (a->chunk_size <= SIZE_MAX / 2) a->chunk_size *= 2;
+    return 1;
+}
+
+static void arena_release_chunks(ajis_arena *a) {
+    ajis_arena_chunk *c = a->chunks;
+    while (c) {
+        ajis_arena_chunk *next = c->next;
+        ajis_free(a->parent, c, CHUNK_HEADER + c->size);
+        c = next;
+    }
+    a->chunks = NULL;
+    a->chunk_count = 0;
+    a->ptr = a->end = a->last = NULL;
+}
+
+static void *arena_alloc(void *ctx, size_t size) {
+    ajis_arena *a = (ajis_arena *)ctx;
+    if (size > SIZE_MAX - AJIS_ALLOC_ALIGN) return NULL;
+    size = size ? round_up(size) : AJIS_ALLOC_ALIGN;
+    if ((size_t)(a->end - a->ptr) < size && !arena_push_chunk(a, size)) return NULL;
+    uint8_t *p = a->ptr;
+    a->ptr += size;
+    a->last = p;
+    return p;
+}
+
+static void *arena_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    ajis_arena *a = (ajis_arena *)ctx;
+    if (!ptr) return arena_alloc(ctx, new_size);
+    if (new_size > SIZE_MAX - AJIS_ALLOC_ALIGN) return NULL;
+
+    size_t want = new_size ? round_up(new_size) : AJIS_ALLOC_ALIGN;
+    uint8_t *p = (uint8_t *)ptr;
+    if (p == a->last && (size_t)(a->end - p) >= want) {
+        a->ptr = p + want;      /* most recent block: grow or shrink in place */
+        return p;
+    }
+    if (want <= round_up(old_size)) return p;
+
+    void *q = arena_alloc(ctx, new_size);
+    if (q) memcpy(q, p, old_size);
+    return q;
+}
+
+static void arena_free(void *ctx, void *ptr, size_t size) {
+    ajis_arena *a = (ajis_arena *)ctx;
+    (void)size;
+    if ((uint8_t *)ptr == a->last) {
+        a->ptr = a->last;
+        a->last = NULL;
+    }
+}
+
+void ajis_arena_init(ajis_arena *arena, const ajis_allocator *parent, size_t chunk_size) {
+    memset(arena, 0, sizeof(*arena));
+    arena->allocator.alloc = arena_alloc;
+    arena->allocator.realloc = arena_realloc;
+    arena->allocator.free = arena_free;
+    arena->allocator.ctx = arena;
+    arena->parent = ajis_allocator_or_default(parent);
+    arena->chunk_size = chunk_size ? round_up(chunk_size) : AJIS_ARENA_DEFAULT_CHUNK;
+}
+
+void ajis_arena_reset(ajis_arena *arena) {
+    if (arena->chunk_count == 0) return;
+    if (arena->chunk_count == 1) {
+        arena->ptr = chunk_data(arena->chunks);
+        arena->last = NULL;
+        return;
+    }
+
+    /* several chunks: replace them with one that holds the whole cycle */
+    size_t total = ajis_arena_capacity(arena);
+    arena_release_chunks(arena);
+    arena->chunk_size = total;
+    (void)arena_push_chunk(arena, total);   /* on failure the next alloc retries */
+    arena->chunk_size = total;
+}
+
+size_t ajis_arena_capacity(const ajis_arena *arena) {
+    size_t total = 0;
+    for (const ajis_arena_chunk *c = arena->chunks; c; c = c->next) total += c->size;
+    return total;
+}
+
+void ajis_arena_destroy(ajis_arena *arena) {
+    if (!arena) return;
+    arena_release_chunks(arena);
+}
+
+/* ---------- size-class pool ---------- */
+
+#define SLAB_HEADER AJIS_ALLOC_ALIGN
+
+static unsigned size_class(size_t size) {
+    unsigned c = 0;
+    size_t block = AJIS_SLAB_MIN_CLASS;
+    while (block < size) {
+        block <<= 1;
+        c++;
+    }
+    return c;
+}
+
+static int pool_refill(ajis_slab_pool *p, unsigned c) {
+    uint8_t *slab = (uint8_t *)ajis_alloc(p->parent, AJIS_SLAB_SIZE);
+    if (!slab) return 0;
+    *(void **)slab = p->slabs;
+    p->slabs = slab;
+    p->slab_count++;
+
+    /* push in reverse so blocks are handed out in address order */
+    size_t block = (size_t)AJIS_SLAB_MIN_CLASS << c;
+    size_t n = (AJIS_SLAB_SIZE - SLAB_HEADER) / block;
+    for (size_t i = n; i-- > 0;) {
+        void **b = (void **)(slab + SLAB_HEADER + i * block);
+        *b = p->free_lists[c];
+        p->free_lists[c] = b;
+    }
+    return 1;
+}
+
+static void *pool_alloc(void *ctx, size_t size) {
+    ajis_slab_pool *p = (ajis_slab_pool *)ctx;
+    if (size > AJIS_SLAB_MAX_CLASS) return ajis_alloc(p->parent, size);
+
+    unsigned c = size_class(size);
+    if (!p->free_lists[c] && !pool_refill(p, c)) return NULL;
+    void **b = (void **)p->free_lists[c];
+    p->free_lists[c] = *b;
+    return b;
+}
+
+static void pool_free(void *ctx, void *ptr, size_t size) {
+    ajis_slab_pool *p = (ajis_slab_pool *)ctx;
+    if (size > AJIS_SLAB_MAX_CLASS) {
+        ajis_free(p->parent, ptr, size);
+        return;
+    }
+    unsigned c = size_class(size);
+    *(void **)ptr = p->free_lists[c];
+    p->free_lists[c] = ptr;
+}
+
+static void *pool_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+    ajis_slab_pool *p = (ajis_slab_pool *)ctx;
+    if (!ptr) return pool_alloc(ctx, new_size);
+
+    int old_small = old_size <= AJIS_SLAB_MAX_CLASS, new_small = new_size <= AJIS_SLAB_MAX_CLASS;
+    if (old_small && new_small && size_class(old_size) == size_class(new_size)) return ptr;
+    if (!old_small && !new_small) return ajis_realloc(p->parent, ptr, old_size, new_size);
+
+    void *q = pool_alloc(ctx, new_size);
+    if (!q) return NULL;
+    memcpy(q, ptr, old_size < new_size ? old_size : new_size);
+    pool_free(ctx, ptr, old_size);
+    return q;
+}
+
+void ajis_slab_pool_init(ajis_slab_pool *pool, const ajis_allocator *parent) {
+    memset(pool, 0, sizeof(*pool));
+    pool->allocator.alloc = pool_alloc;
+    pool->allocator.realloc = pool_realloc;
+    pool->allocator.free = pool_free;
+    pool->allocator.ctx = pool;
+    pool->parent = ajis_allocator_or_default(parent);
+}
+
+void ajis_slab_pool_destroy(ajis_slab_pool *pool) {
+    if (!pool) return;
+    void *s = pool->slabs;
+    while (s) {
+        void *next = *(void **)s;
+        ajis_free(pool->parent, s, AJIS_SLAB_SIZE);
+        s = next;
+    }
+    memset(pool->free_lists, 0, sizeof(pool->free_lists));
+    pool->slabs = NULL;
+    pool->slab_count = 0;
+}
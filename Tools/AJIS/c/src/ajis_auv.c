@@ -0,0 +1,543 @@
+#include "../include/ajis_auv.h"
+#include "../include/ajis_intern.h"
+#include "../include/ajis_number.h"
+#include "../include/ajis_string.h"
+#include "../include/auv_wire.h"
+
+#include <string.h>
+
+/* ---------- helpers ---------- */
+
+/* Non-zero when [p, p+n) is well-formed UTF-8 (no overlongs, surrogates or code points past U+10FFFF). */
+static int utf8_valid(const uint8_t *p, size_t n) {
+    const uint8_t *end = p + n;
+    while (p < end) {
+        if (end - p >= 8) {
+            uint64_t x;
+            memcpy(&x, p, 8);
+            if (!(x & 0x8080808080808080ull)) {
+                p += 8;
+                continue;
+            }
+        }
+        uint8_t b = *p;
+        if (b < 0x80) {
+            p++;
+            continue;
+        }
+        size_t k;
+        uint32_t cp, min;
+        if ((b & 0xE0) == 0xC0) { k = 1; cp = b & 0x1Fu; min = 0x80; }
+        else if ((b & 0xF0) == 0xE0) { k = 2; cp = b & 0x0Fu; min = 0x800; }
+        else if ((b & 0xF8) == 0xF0) { k = 3; cp = b & 0x07u; min = 0x10000; }
+        else return 0;
+        if ((size_t)(end - p) <= k) return 0;
+        for (size_t i = 1; i <= k; i++) {
+            if ((p[i] & 0xC0) != 0x80) return 0;
+            cp = (cp << 6) | (p[i] & 0x3Fu);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) return 0;
+        p += k + 1;
+    }
+    return 1;
+}
+
+static int hex_value(int b) {
+    if (b >= '0' && b <= '9') return b - '0';
+    if (b >= 'a' && b <= 'f') return b - 'a' + 10;
+    return b - 'A' + 10;
+}
+
+static int b64_value(int b) {
+    if (b >= 'A' && b <= 'Z') return b - 'A';
+    if (b >= 'a' && b <= 'z') return b - 'a' + 26;
+    if (b >= '0' && b <= '9') return b - '0' + 52;
+    if (b == '+') return 62;
+    if (b == '/') return 63;
+    return -1;
+}
+
+/* Decoded size of a b64"..." body, or -1 when it is malformed. */
+static long long b64_size(const uint8_t *p, size_t n) {
+    size_t pad = 0;
+    while (pad < 2 && n > pad && p[n - 1 - pad] == '=') pad++;
+    size_t body = n - pad;
+    for (size_t i = 0; i < body; i++) {
+        if (b64_value(p[i]) < 0) return -1;
+    }
+    if (body % 4 == 1 || (pad && (body + pad) % 4 != 0)) return -1;
+    return (long long)(body / 4 * 3 + (body % 4 ? body % 4 - 1 : 0));
+}
+
+static void b64_decode(const uint8_t *p, size_t n, uint8_t *out) {
+    while (n && p[n - 1] == '=') n--;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < n; i++) {
+        acc = (acc << 6) | (uint32_t)b64_value(p[i]);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            *out++ = (uint8_t)(acc >> bits);
+        }
+    }
+}
+
+static void store_u64le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)v;
+        v >>= 8;
+    }
+}
+
+/* ---------- transcoding ---------- */
+
+typedef struct key_ref {
+    const uint8_t *p;       /* decoded key (set before sorting) */
+    size_t offset;          /* in the input, or in `keys` when `decoded` */
+    size_t length;
+    size_t at;              /* input offset, for the error */
+    int decoded;
+    ajis_symbol sym;        /* with an intern table */
+} key_ref;
+
+typedef struct trun {
+    const uint8_t *data;
+    size_t len;
+    ajis_input in;
+    ajis_lexer lx;
+    ajis_token tok;
+    ajis_auv_options opt;
+    ajis_error *err;
+    ajis_error_code rc;
+
+    int writing;
+    uint64_t *sizes;        /* container payload sizes, in order of opening */
+    size_t size_count;
+    size_t size_cap;
+    size_t next_size;
+
+    key_ref *refs;          /* keys of the open objects */
+    size_t ref_count;
+    size_t ref_cap;
+    key_ref *sort_tmp;
+    size_t sort_cap;
+    uint8_t *keys;          /* decoded escaped keys */
+    size_t keys_length;
+    size_t keys_cap;
+
+    uint8_t *tmp;           /* escaped strings, canonical reordering */
+    size_t tmp_cap;
+
+    ajis_symbol *syms;      /* canonical with an intern table: every key's symbol, in document order; */
+    size_t sym_count;       /* then its byte-order rank among them, for the write pass */
+    size_t sym_cap;
+    size_t next_sym;
+
+    uint8_t *out;
+    size_t pos;
+} trun;
+
+/* Records the error; line/column are counted once, here. */
+static int fail(trun *r, ajis_error_code code, size_t offset, const char *ctx) {
+    r->rc = code;
+    if (r->err) {
+        uint32_t line = 1;
+        size_t line_start = 0;
+        const uint8_t *p = r->data, *stop = r->data + offset;
+        while ((p = (const uint8_t *)memchr(p, '\n', (size_t)(stop - p))) != NULL) {
+            line++;
+            p++;
+            line_start = (size_t)(p - r->data);
+        }
+        r->err->code = code;
+        r->err->location.line = line;
+        r->err->location.column = (uint32_t)(offset - line_start) + 1;
+        r->err->location.offset = offset;
+        r->err->context = ctx;
+    }
+    return 0;
+}
+
+static int next(trun *r) {
+    ajis_error e = ajis_error_ok();
+    ajis_error_code rc = ajis_lexer_next(&r->lx, &r->tok, &e);
+    if (rc != AJIS_OK) {
+        r->rc = rc;
+        if (r->err) *r->err = e;
+        return 0;
+    }
+    if (r->tok.type == AJIS_TOKEN_INVALID) return fail(r, AJIS_ERR_INVALID_TOKEN, r->tok.span.offset, "invalid token");
+    return 1;
+}
+
+static int grow(trun *r, void **p, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 1;
+    size_t n = *cap ? *cap : 64;
+    while (n < need) n *= 2;
+    void *q = ajis_realloc(r->opt.allocator, *p, *cap * elem, n * elem);
+    if (!q) return fail(r, AJIS_ERR_SIZE_LIMIT, r->tok.span.offset, "out of memory");
+    *p = q;
+    *cap = n;
+    return 1;
+}
+
+/* After a member or element: ',' or `close`. Returns 1 more, 2 closed, 0 error. */
+static int separator(trun *r, ajis_token_type close) {
+    if (!next(r)) return 0;
+    if (r->tok.type == close) return 2;
+    if (r->tok.type != AJIS_TOKEN_COMMA) {
+        if (r->tok.type == AJIS_TOKEN_EOF) return fail(r, AJIS_ERR_UNEXPECTED_EOF, r->tok.span.offset, "unterminated container");
+        return fail(r, AJIS_ERR_MISSING_COMMA, r->tok.span.offset, "expected ',' or a closing bracket");
+    }
+    if (!next(r)) return 0;
+    if (r->tok.type == close) return fail(r, AJIS_ERR_TRAILING_COMMA, r->tok.span.offset, "trailing comma");
+    return 1;
+}
+
+static void put_header(trun *r, auv_tag tag, uint64_t length) {
+    r->out[r->pos++] = (uint8_t)tag;
+    r->pos += auv_varuint_write(r->out + r->pos, length);
+}
+
+static uint64_t record_size(uint64_t payload) {
+    return 1 + auv_varuint_size(payload) + payload;
+}
+
+/* Measure pass: the key's symbol, kept in document order for the write pass when canonical. */
+static int intern_key(trun *r, const uint8_t *raw, size_t len, ajis_symbol *sym) {
+    /* the escapes were checked by string_body() */
+    if (ajis_intern_raw(r->opt.intern, raw, len, 0, sym) != AJIS_OK) {
+        return fail(r, AJIS_ERR_SIZE_LIMIT, (size_t)(raw - r->data) - 1, "intern table full");
+    }
+    if (!r->opt.canonical) return 1;
+    if (!grow(r, (void **)&r->syms, &r->sym_cap, r->sym_count + 1, sizeof(ajis_symbol))) return 0;
+    r->syms[r->sym_count++] = *sym;
+    return 1;
+}
+
+/* Write pass, canonical: rank only the symbols the document uses, not the whole table. */
+static int load_ranks(trun *r) {
+    if (ajis_intern_rank_symbols(r->opt.intern, r->syms, r->sym_count) != AJIS_OK) {
+        return fail(r, AJIS_ERR_SIZE_LIMIT, 0, "out of memory");
+    }
+    return 1;
+}
+
+/*
+ * String body at `offset`: decoded into r->tmp when it has escapes.
+ * Checks UTF-8 and the length limit; those errors point at the
+ * opening quote, as ajis_validate() does.
+ */
+static int string_body(trun *r, size_t offset, size_t len, size_t limit, const uint8_t **text, size_t *text_len) {
+    const uint8_t *raw = r->data + offset;
+    if (ajis_string_is_plain(raw, len)) {
+        *text = raw;
+        *text_len = len;
+    } else {
+        if (!grow(r, (void **)&r->tmp, &r->tmp_cap, len, 1)) return 0;
+        size_t bad = 0;
+        if (ajis_string_unescape(raw, len, 0, r->tmp, text_len, &bad) != AJIS_OK) {
+            return fail(r, AJIS_ERR_INVALID_ESCAPE, offset + bad, "invalid escape");
+        }
+        *text = r->tmp;
+    }
+    if (*text_len > limit) return fail(r, AJIS_ERR_SIZE_LIMIT, offset - 1, "longer than the AUV limit");
+    if (!r->writing && !utf8_valid(*text, *text_len)) return fail(r, AJIS_ERR_INVALID_STRING, offset - 1, "invalid UTF-8");
+    return 1;
+}
+
+/*
+ * With an intern table keys compare as integers: symbols in the
+ * measure pass (only equality matters there), ranks in the write
+ * pass (byte order, see load_ranks()); without one, as bytes.
+ */
+static int key_less(const trun *r, const key_ref *a, const key_ref *b) {
+    if (r->opt.intern) return a->sym < b->sym;
+    size_t n = a->length < b->length ? a->length : b->length;
+    int c = memcmp(a->p, b->p, n);
+    return c < 0 || (c == 0 && a->length < b->length);
+}
+
+/* Stable merge sort of v[0..n) by key_less(), with `tmp` of n entries. */
+static void sort_keys(const trun *r, key_ref *v, key_ref *tmp, size_t n) {
+    for (size_t width = 1; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            size_t i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) tmp[k++] = key_less(r, &v[j], &v[i]) ? v[j++] : v[i++];
+            while (i < mid) tmp[k++] = v[i++];
+            while (j < hi) tmp[k++] = v[j++];
+        }
+        memcpy(v, tmp, n * sizeof(key_ref));
+    }
+}
+
+/* Measure pass: keys [base, ref_count) of one object must be unique. */
+static int unique_keys(trun *r, size_t base) {
+    size_t n = r->ref_count - base;
+    key_ref *v = r->refs + base;
+    if (n < 2) return 1;
+    for (size_t i = 0; i < n; i++) v[i].p = (v[i].decoded ? r->keys : r->data) + v[i].offset;
+    if (!grow(r, (void **)&r->sort_tmp, &r->sort_cap, n, sizeof(key_ref))) return 0;
+    sort_keys(r, v, r->sort_tmp, n);
+    for (size_t i = 1; i < n; i++) {
+        int same = r->opt.intern ? v[i].sym == v[i - 1].sym
+                                 : v[i].length == v[i - 1].length && memcmp(v[i].p, v[i - 1].p, v[i].length) == 0;
+        if (same) {
+            size_t at = v[i].at > v[i - 1].at ? v[i].at : v[i - 1].at;
+            return fail(r, AJIS_ERR_DUPLICATE_KEY, at, "duplicate key");
+        }
+    }
+    return 1;
+}
+
+/*
+ * Write pass, canonical: reorders the pairs written at [start, r->pos)
+ * by key. refs[base, base + pairs) hold their symbols (intern table).
+ */
+static int sort_pairs(trun *r, size_t start, size_t pairs, size_t base) {
+    if (pairs < 2) return 1;
+    if (!grow(r, (void **)&r->refs, &r->ref_cap, base + pairs, sizeof(key_ref))) return 0;
+    if (!grow(r, (void **)&r->sort_tmp, &r->sort_cap, pairs, sizeof(key_ref))) return 0;
+    key_ref *refs = r->refs + base;
+
+    /* each pair: String key record, then the value record */
+    size_t p = start;
+    for (size_t i = 0; i < pairs; i++) {
+        key_ref *k = &refs[i];
+        uint64_t klen, vlen;
+        size_t used;
+        (void)auv_varuint_read(r->out + p + 1, 10, &klen, &used);
+        k->offset = p;
+        k->p = r->out + p + 1 + used;
+        k->length = (size_t)klen;
+        size_t v = p + 1 + used + (size_t)klen;
+        (void)auv_varuint_read(r->out + v + 1, 10, &vlen, &used);
+        p = v + 1 + used + (size_t)vlen;
+        k->at = p;                              /* end of the pair */
+    }
+    sort_keys(r, refs, r->sort_tmp, pairs);
+
+    size_t total = r->pos - start;
+    if (!grow(r, (void **)&r->tmp, &r->tmp_cap, total, 1)) return 0;
+    size_t n = 0;
+    for (size_t i = 0; i < pairs; i++) {
+        memcpy(r->tmp + n, r->out + refs[i].offset, refs[i].at - refs[i].offset);
+        n += refs[i].at - refs[i].offset;
+    }
+    memcpy(r->out + start, r->tmp, total);
+    return 1;
+}
+
+static int string_record(trun *r, size_t limit, uint64_t *size) {
+    const uint8_t *text = NULL;
+    size_t n = 0;
+    if (!string_body(r, r->tok.span.offset, r->tok.span.length, limit, &text, &n)) return 0;
+    if (r->writing) {
+        put_header(r, AUV_TAG_STRING, n);
+        memcpy(r->out + r->pos, text, n);
+        r->pos += n;
+    }
+    *size = record_size(n);
+    return 1;
+}
+
+static int value(trun *r, size_t depth, uint64_t *size);
+
+static int scalar(trun *r, uint64_t *size) {
+    ajis_token t = r->tok;
+    switch (t.type) {
+        case AJIS_TOKEN_NULL:
+            if (r->writing) put_header(r, AUV_TAG_NULL, 0);
+            *size = 2;
+            return 1;
+        case AJIS_TOKEN_TRUE:
+        case AJIS_TOKEN_FALSE:
+            if (r->writing) {
+                put_header(r, AUV_TAG_BOOL, 1);
+                r->out[r->pos++] = t.type == AJIS_TOKEN_TRUE;
+            }
+            *size = 3;
+            return 1;
+        case AJIS_TOKEN_NUMBER: {
+            ajis_number n;
+            ajis_error_code rc = ajis_number_parse(r->data + t.span.offset, t.span.length, &n);
+            if (rc != AJIS_OK) return fail(r, rc, t.span.offset, "number out of range");
+            if (r->writing) {
+                uint64_t bits;
+                if (n.kind == AJIS_NUMBER_INT) {
+                    bits = (uint64_t)n.i;
+                } else {
+                    memcpy(&bits, &n.f, 8);
+                }
+                put_header(r, n.kind == AJIS_NUMBER_INT ? AUV_TAG_INT64 : AUV_TAG_FLOAT64, 8);
+                store_u64le(r->out + r->pos, bits);
+                r->pos += 8;
+            }
+            *size = 10;
+            return 1;
+        }
+        case AJIS_TOKEN_STRING:
+            return string_record(r, AJIS_AUV_MAX_STRING, size);
+        case AJIS_TOKEN_HEX_BINARY:
+        case AJIS_TOKEN_B64_BINARY: {
+            /* body between hex" / b64" and the closing quote */
+            const uint8_t *body = r->data + t.span.offset + 4;
+            size_t len = t.span.length - 5;
+            uint64_t n;
+            if (t.type == AJIS_TOKEN_HEX_BINARY) {
+                n = len / 2;
+            } else {
+                long long b = b64_size(body, len);
+                if (b < 0) return fail(r, AJIS_ERR_INVALID_BINARY, t.span.offset, "malformed base64");
+                n = (uint64_t)b;
+            }
+            if (n > AJIS_AUV_MAX_BINARY) return fail(r, AJIS_ERR_SIZE_LIMIT, t.span.offset, "binary longer than the AUV limit");
+            if (r->writing) {
+                put_header(r, AUV_TAG_BINARY, n);
+                if (t.type == AJIS_TOKEN_HEX_BINARY) {
+                    for (size_t i = 0; i < n; i++) {
+                        r->out[r->pos + i] = (uint8_t)(hex_value(body[2 * i]) << 4 | hex_value(body[2 * i + 1]));
+                    }
+                } else {
+                    b64_decode(body, len, r->out + r->pos);
+                }
+                r->pos += n;
+            }
+            *size = record_size(n);
+            return 1;
+        }
+        default:
+            return fail(r, t.type == AJIS_TOKEN_EOF ? AJIS_ERR_UNEXPECTED_EOF : AJIS_ERR_INVALID_SYNTAX, t.span.offset,
+                        "expected a value");
+    }
+}
+
+static int container(trun *r, size_t depth, uint64_t *size) {
+    int is_object = r->tok.type == AJIS_TOKEN_LBRACE;
+    ajis_token_type close = is_object ? AJIS_TOKEN_RBRACE : AJIS_TOKEN_RBRACKET;
+    size_t open_at = r->tok.span.offset;
+    if (depth >= AUV_MAX_DEPTH) return fail(r, AJIS_ERR_DEPTH_LIMIT, open_at, "nesting depth limit exceeded");
+
+    /* measure: reserve this container's slot; write: its header from that slot */
+    size_t slot = r->writing ? r->next_size++ : r->size_count;
+    if (!r->writing) {
+        if (!grow(r, (void **)&r->sizes, &r->size_cap, r->size_count + 1, sizeof(uint64_t))) return 0;
+        r->size_count++;
+    } else {
+        put_header(r, is_object ? AUV_TAG_OBJECT : AUV_TAG_ARRAY, r->sizes[slot]);
+    }
+    size_t start = r->pos;
+    size_t ref_base = r->ref_count, keys_base = r->keys_length;
+
+    uint64_t payload = 0, items = 0;
+    if (!next(r)) return 0;
+    if (r->tok.type != close) {
+        for (;;) {
+            if (++items > AJIS_AUV_MAX_ITEMS) return fail(r, AJIS_ERR_SIZE_LIMIT, r->tok.span.offset, "more items than the AUV limit");
+            uint64_t n;
+            if (is_object) {
+                if (r->tok.type != AJIS_TOKEN_STRING) return fail(r, AJIS_ERR_INVALID_SYNTAX, r->tok.span.offset, "expected a member name");
+                size_t key_at = r->tok.span.offset;
+                if (!string_record(r, AJIS_AUV_MAX_KEY, &n)) return 0;
+                payload += n;
+
+                if (!r->writing) {
+                    if (!grow(r, (void **)&r->refs, &r->ref_cap, r->ref_count + 1, sizeof(key_ref))) return 0;
+                    key_ref *k = &r->refs[r->ref_count++];
+                    const uint8_t *raw = r->data + key_at;
+                    if (r->opt.intern && !intern_key(r, raw, r->tok.span.length, &k->sym)) return 0;
+                    k->at = key_at - 1;
+                    k->decoded = !ajis_string_is_plain(raw, r->tok.span.length);
+                    if (k->decoded) {
+                        if (!grow(r, (void **)&r->keys, &r->keys_cap, r->keys_length + r->tok.span.length, 1)) return 0;
+                        (void)ajis_string_unescape(raw, r->tok.span.length, 0, r->keys + r->keys_length, &k->length, NULL);
+                        k->offset = r->keys_length;
+                        r->keys_length += k->length;
+                    } else {
+                        k->offset = key_at;
+                        k->length = r->tok.span.length;
+                    }
+                } else if (r->opt.canonical && r->opt.intern) {
+                    /* the ranks load_ranks() put in place of the measure pass's symbols, in the same order */
+                    if (!grow(r, (void **)&r->refs, &r->ref_cap, r->ref_count + 1, sizeof(key_ref))) return 0;
+                    r->refs[r->ref_count++].sym = r->syms[r->next_sym++];
+                }
+
+                if (!next(r)) return 0;
+                if (r->tok.type != AJIS_TOKEN_COLON) return fail(r, AJIS_ERR_MISSING_COLON, r->tok.span.offset, "expected ':'");
+                if (!next(r)) return 0;
+            }
+            if (!value(r, depth + 1, &n)) return 0;
+            payload += n;
+
+            int sep = separator(r, close);
+            if (sep == 0) return 0;
+            if (sep == 2) break;
+        }
+    }
+
+    if (!r->writing) {
+        r->sizes[slot] = payload;
+        if (is_object && !unique_keys(r, ref_base)) return 0;
+        r->ref_count = ref_base;
+        r->keys_length = keys_base;
+    } else if (is_object && r->opt.canonical) {
+        if (!sort_pairs(r, start, (size_t)items, ref_base)) return 0;
+        r->ref_count = ref_base;
+    }
+    *size = record_size(payload);
+    return 1;
+}
+
+static int value(trun *r, size_t depth, uint64_t *size) {
+    if (r->tok.type == AJIS_TOKEN_LBRACE || r->tok.type == AJIS_TOKEN_LBRACKET) return container(r, depth, size);
+    return scalar(r, size);
+}
+
+/* One pass over the document; *size is the record size. */
+static int run(trun *r, uint64_t *size) {
+    ajis_input_init(&r->in, r->data, r->len);
+    ajis_lexer_init(&r->lx, &r->in, r->opt.lexer);
+    if (!next(r)) return 0;
+    if (r->tok.type == AJIS_TOKEN_EOF) return fail(r, AJIS_ERR_UNEXPECTED_EOF, r->tok.span.offset, "empty document");
+    if (!value(r, 0, size)) return 0;
+    if (!next(r)) return 0;
+    if (r->tok.type != AJIS_TOKEN_EOF) return fail(r, AJIS_ERR_INVALID_SYNTAX, r->tok.span.offset, "content after the value");
+    return 1;
+}
+
+ajis_error_code ajis_to_auv(const void *data, size_t len, const ajis_auv_options *opt, uint8_t *out, size_t cap,
+                            size_t *needed, ajis_error *err) {
+    trun r;
+    memset(&r, 0, sizeof(r));
+    r.data = (const uint8_t *)(data ? data : "");
+    r.len = data ? len : 0;
+    r.opt = opt ? *opt : ajis_auv_options_default();
+    r.err = err;
+    r.rc = AJIS_OK;
+    if (err) *err = ajis_error_ok();
+    if (needed) *needed = 0;
+
+    uint64_t size = 0;
+    if (run(&r, &size)) {
+        if (needed) *needed = (size_t)size;
+        if (out && size <= cap && (!r.opt.canonical || !r.opt.intern || load_ranks(&r))) {
+            r.writing = 1;
+            r.out = out;
+            r.pos = 0;
+            (void)run(&r, &size);
+        }
+    }
+
+    const ajis_allocator *a = r.opt.allocator;
+    ajis_free(a, r.sizes, r.size_cap * sizeof(uint64_t));
+    ajis_free(a, r.refs, r.ref_cap * sizeof(key_ref));
+    ajis_free(a, r.sort_tmp, r.sort_cap * sizeof(key_ref));
+    ajis_free(a, r.keys, r.keys_cap);
+    ajis_free(a, r.tmp, r.tmp_cap);
+    ajis_free(a, r.syms, r.sym_cap * sizeof(ajis_symbol));
+    return r.rc;
+}
@@ -0,0 +1,299 @@
+#define _DEFAULT_SOURCE
+#include "../include/ajis_cache.h"
+#include "../include/ajis_auv.h"
+#include "../include/ajis_file.h"
+#include "../include/auv_hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_HEADER_SIZE 64
+#define CACHE_VERSION 1
+
+/* header flags */
+#define HDR_CANONICAL 0x1u
+#define HDR_SEEK 0x2u
+
+/* ---------- helpers ---------- */
+
+typedef struct header {
+    uint8_t flags;
+    uint32_t lexer;
+    uint32_t seek_stride;
+    uint64_t source_length;
+    uint64_t source_hash;
+    uint64_t auv_length;
+    uint64_t seek_length;
+    uint64_t auv_hash;
+} header;
+
+static ajis_error_code fail(ajis_error *err, ajis_error_code code, const char *ctx) {
+    if (err) {
+        *err = ajis_error_ok();
+        err->code = code;
+        err->context = ctx;
+    }
+    return code;
+}
+
+static void store_u32le(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void store_u64le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t round8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+static uint32_t lexer_bits(const ajis_lexer_options *o) {
+    return (o->allow_multiline_strings ? 0x1u : 0) | (o->allow_number_separators ? 0x2u : 0);
+}
+
+/* The header this load expects, source fields aside. */
+static header expected(const ajis_cache_options *o) {
+    header h;
+    memset(&h, 0, sizeof(h));
+    h.flags = (uint8_t)(((o->flags & AJIS_CACHE_CANONICAL) ? HDR_CANONICAL : 0) | ((o->flags & AJIS_CACHE_SEEK) ? HDR_SEEK : 0));
+    h.lexer = lexer_bits(&o->lexer);
+    h.seek_stride = (o->flags & AJIS_CACHE_SEEK) ? (o->seek_stride ? o->seek_stride : AUV_SEEK_DEFAULT_STRIDE) : 0;
+    return h;
+}
+
+static void header_write(uint8_t *p, const header *h) {
+    memcpy(p, "AJSC", 4);
+    p[4] = CACHE_VERSION;
+    p[5] = h->flags;
+    p[6] = p[7] = 0;
+    store_u32le(p + 8, h->lexer);
+    store_u32le(p + 12, h->seek_stride);
+    store_u64le(p + 16, h->source_length);
+    store_u64le(p + 24, h->source_hash);
+    store_u64le(p + 32, h->auv_length);
+    store_u64le(p + 40, h->seek_length);
+    store_u64le(p + 48, h->auv_hash);
+    store_u64le(p + 56, auv_hash_bytes(p, 56, 0));
+}
+
+/* Zero when [p, p+len) does not start with a well-formed header. */
+static int header_read(const uint8_t *p, size_t len, header *h) {
+    if (len < CACHE_HEADER_SIZE || memcmp(p, "AJSC", 4) != 0 || p[4] != CACHE_VERSION) return 0;
+    if (auv_load_u64le(p + 56) != auv_hash_bytes(p, 56, 0)) return 0;
+    h->flags = p[5];
+    h->lexer = auv_load_u32le(p + 8);
+    h->seek_stride = auv_load_u32le(p + 12);
+    h->source_length = auv_load_u64le(p + 16);
+    h->source_hash = auv_load_u64le(p + 24);
+    h->auv_length = auv_load_u64le(p + 32);
+    h->seek_length = auv_load_u64le(p + 40);
+    h->auv_hash = auv_load_u64le(p + 48);
+
+    uint64_t room = len - CACHE_HEADER_SIZE;
+    if (h->auv_length > room) return 0;
+    if (h->seek_length && (round8(h->auv_length) > room || h->seek_length != room - round8(h->auv_length))) return 0;
+    if (!h->seek_length && h->auv_length != room) return 0;
+    return 1;
+}
+
+/* Maps the whole sidecar; NULL when it is missing or empty. */
+static const uint8_t *map_file(const char *path, size_t *len) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        *len = (size_t)st.st_size;
+        m = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    return m == MAP_FAILED ? NULL : (const uint8_t *)m;
+}
+
+/* Seek index of the root container, checked against it. */
+static int seek_matches(const auv_seek_index *idx, const uint8_t *auv, size_t len) {
+    auv_record root;
+    return auv_record_read(auv, auv, len, &root, NULL) == AUV_OK && root.tag == idx->tag &&
+           root.length == idx->payload_length;
+}
+
+/* Serves `out` from the sidecar when it matches the source; zero on a miss. */
+static int try_hit(const char *cache_path, const header *want, const ajis_cache_options *o, ajis_cached *out) {
+    size_t len = 0;
+    const uint8_t *m = map_file(cache_path, &len);
+    if (!m) return 0;
+
+    header h;
+    int ok = header_read(m, len, &h) && h.flags == want->flags && h.lexer == want->lexer &&
+             h.seek_stride == want->seek_stride && h.source_length == want->source_length &&
+             h.source_hash == want->source_hash;
+    const uint8_t *auv = m + CACHE_HEADER_SIZE;
+    if (ok && (o->flags & AJIS_CACHE_VERIFY)) ok = auv_hash_bytes(auv, (size_t)h.auv_length, 0) == h.auv_hash;
+    if (ok && h.seek_length) {
+        ok = auv_seek_load(auv + round8(h.auv_length), (size_t)h.seek_length, &out->seek, NULL) == AUV_OK &&
+             seek_matches(&out->seek, auv, (size_t)h.auv_length);
+        out->has_seek = ok;
+    }
+    if (!ok) {
+        memset(&out->seek, 0, sizeof(out->seek));
+        out->has_seek = 0;
+        munmap((void *)m, len);
+        return 0;
+    }
+    out->auv = auv;
+    out->auv_length = (size_t)h.auv_length;
+    out->map = (void *)m;
+    out->map_length = len;
+    out->hit = 1;
+    return 1;
+}
+
+static int write_all(int fd, const uint8_t *p, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+/*
+ * Writes the sidecar through a temp file and rename; zero on failure.
+ * mkstemp() gives each writer its own temp file, so threads of one
+ * process racing on a cold sidecar never write into each other's.
+ */
+static int store(const char *cache_path, const header *h, const uint8_t *auv, const uint8_t *seek, size_t seek_len,
+                 const ajis_allocator *alloc) {
+    size_t tlen = strlen(cache_path) + sizeof(".tmp.XXXXXX");
+    char *tmp = (char *)ajis_alloc(alloc, tlen);
+    if (!tmp) return 0;
+    snprintf(tmp, tlen, "%s.tmp.XXXXXX", cache_path);
+
+    int ok = 0;
+    int fd = mkstemp(tmp);
+    if (fd >= 0) {
+        uint8_t hdr[CACHE_HEADER_SIZE];
+        static const uint8_t pad[8];
+        header_write(hdr, h);
+        ok = fchmod(fd, 0644) == 0;     /* mkstemp() creates 0600 */
+        ok = ok && write_all(fd, hdr, sizeof(hdr)) && write_all(fd, auv, (size_t)h->auv_length);
+        if (ok && seek_len) {
+            ok = write_all(fd, pad, (size_t)(round8(h->auv_length) - h->auv_length)) && write_all(fd, seek, seek_len);
+        }
+        /* the data must be durable before the name points at it */
+        ok = ok && fsync(fd) == 0;
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(tmp, cache_path) == 0;
+        if (!ok) unlink(tmp);
+    }
+    ajis_free(alloc, tmp, tlen);
+    return ok;
+}
+
+/* Miss: transcode the source, build the seek index, rewrite the sidecar. */
+static ajis_error_code rebuild(const uint8_t *src, size_t src_len, const char *cache_path, header *h,
+                               const ajis_cache_options *o, ajis_cached *out, ajis_error *err) {
+    ajis_auv_options ao = ajis_auv_options_default();
+    ao.lexer = o->lexer;
+    ao.canonical = (o->flags & AJIS_CACHE_CANONICAL) != 0;
+    ao.allocator = o->allocator;
+
+    size_t need = 0;
+    ajis_error_code rc = ajis_to_auv(src, src_len, &ao, NULL, 0, &need, err);
+    if (rc != AJIS_OK) return rc;
+    out->owned = (uint8_t *)ajis_alloc(o->allocator, need ? need : 1);
+    if (!out->owned) return fail(err, AJIS_ERR_SIZE_LIMIT, "out of memory");
+    out->owned_size = need ? need : 1;
+    rc = ajis_to_auv(src, src_len, &ao, out->owned, need, &need, err);
+    if (rc != AJIS_OK) return rc;
+    out->auv = out->owned;
+    out->auv_length = need;
+
+    uint8_t *seek = NULL;
+    size_t seek_len = 0, seek_cap = 0;
+    if (h->seek_stride && (out->owned[0] == AUV_TAG_ARRAY || out->owned[0] == AUV_TAG_OBJECT)) {
+        if (auv_seek_build_with(out->owned, need, h->seek_stride, o->allocator, &out->seek, NULL) != AUV_OK) {
+            return fail(err, AJIS_ERR_SIZE_LIMIT, "out of memory");
+        }
+        out->has_seek = 1;
+        seek_cap = auv_seek_serialized_size(&out->seek);
+        seek = (uint8_t *)ajis_alloc(o->allocator, seek_cap);
+        if (seek && auv_seek_serialize(&out->seek, seek, seek_cap, &seek_len, NULL) != AUV_OK) seek_len = 0;
+    }
+
+    if (!(o->flags & AJIS_CACHE_READ_ONLY) && (!out->has_seek || seek_len)) {
+        h->auv_length = need;
+        h->seek_length = seek_len;
+        h->auv_hash = auv_hash_bytes(out->owned, need, 0);
+        out->stored = store(cache_path, h, out->owned, seek, seek_len, o->allocator);
+    }
+    ajis_free(o->allocator, seek, seek_cap);
+    return AJIS_OK;
+}
+
+/* ---------- public API ---------- */
+
+ajis_error_code ajis_cache_load(const char *path, const ajis_cache_options *opt, ajis_cached *out, ajis_error *err) {
+    if (err) *err = ajis_error_ok();
+    if (!out) return fail(err, AJIS_ERR_UNKNOWN, "no output");
+    memset(out, 0, sizeof(*out));
+    if (!path) return fail(err, AJIS_ERR_UNKNOWN, "no path");
+
+    ajis_cache_options o = opt ? *opt : ajis_cache_options_default();
+    out->allocator = o.allocator;
+
+    char *owned_path = NULL;
+    size_t owned_path_size = 0;
+    const char *cache_path = o.cache_path;
+    if (!cache_path) {
+        owned_path_size = strlen(path) + sizeof(AJIS_CACHE_SUFFIX);
+        owned_path = (char *)ajis_alloc(o.allocator, owned_path_size);
+        if (!owned_path) return fail(err, AJIS_ERR_SIZE_LIMIT, "out of memory");
+        memcpy(owned_path, path, owned_path_size - sizeof(AJIS_CACHE_SUFFIX));
+        memcpy(owned_path + owned_path_size - sizeof(AJIS_CACHE_SUFFIX), AJIS_CACHE_SUFFIX, sizeof(AJIS_CACHE_SUFFIX));
+        cache_path = owned_path;
+    }
+
+    ajis_file_buffer scratch;
+    ajis_file_buffer_init_with(&scratch, o.allocator);
+    ajis_file_view src;
+    ajis_error_code rc = AJIS_OK;
+    int e = ajis_file_open(&src, path, &scratch);
+    if (e != 0) {
+        out->io_error = e;
+        rc = fail(err, AJIS_ERR_UNKNOWN, "cannot read the source");
+    } else {
+        header h = expected(&o);
+        h.source_length = src.length;
+        h.source_hash = auv_hash_bytes(src.data, src.length, 0);
+        if (!try_hit(cache_path, &h, &o, out)) {
+            rc = rebuild(src.data, src.length, cache_path, &h, &o, out, err);
+            if (rc != AJIS_OK) ajis_cached_close(out);
+        }
+        ajis_file_close(&src);
+    }
+    ajis_file_buffer_free(&scratch);
+    ajis_free(o.allocator, owned_path, owned_path_size);
+    return rc;
+}
+
+void ajis_cached_close(ajis_cached *c) {
+    if (!c) return;
+    auv_seek_free(&c->seek);
+    if (c->map) munmap(c->map, c->map_length);
+    ajis_free(c->allocator, c->owned, c->owned_size);
+    const ajis_allocator *alloc = c->allocator;
+    memset(c, 0, sizeof(*c));
+    c->allocator = alloc;
+}
@@ -0,0 +1,111 @@
+#define _DEFAULT_SOURCE
+#include "../include/ajis_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* ---------- helpers ---------- */
+
+static const uint8_t k_empty[AJIS_FILE_PADDING];
+
+static int reserve(ajis_file_buffer *buf, size_t need) {
+    if (need <= buf->capacity) return 0;
+    size_t cap = buf->capacity ? buf->capacity : 64 * 1024;
+    while (cap < need) cap *= 2;
+    /* contents are not preserved: no realloc copy */
+    ajis_free(buf->allocator, buf->data, buf->capacity);
+    buf->data = (uint8_t *)ajis_alloc(buf->allocator, cap);
+    buf->capacity = buf->data ? cap : 0;
+    return buf->data ? 0 : ENOMEM;
+}
+
+static int read_all(int fd, uint8_t *dst, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, dst + got, len - got);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno;
+        }
+        if (n == 0) return EIO; /* file shrank under us */
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+/* ---------- public API ---------- */
+
+void ajis_file_buffer_free(ajis_file_buffer *buf) {
+    if (!buf) return;
+    ajis_free(buf->allocator, buf->data, buf->capacity);
+    buf->data = NULL;
+    buf->capacity = 0;
+}
+
+int ajis_file_open(ajis_file_view *view, const char *path, ajis_file_buffer *scratch) {
+    view->data = NULL;
+    view->length = 0;
+    view->map = NULL;
+    view->map_length = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int e = errno;
+        close(fd);
+        return e;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return EISDIR;
+    }
+
+    size_t len = (size_t)st.st_size;
+    if (len == 0) {
+        close(fd);
+        view->data = k_empty;
+        return 0;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t tail = len % page;
+    if (len >= AJIS_FILE_MMAP_MIN && tail != 0 && page - tail >= AJIS_FILE_PADDING) {
+        void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            (void)madvise(m, len, MADV_SEQUENTIAL);
+            close(fd);
+            view->data = (const uint8_t *)m;
+            view->length = len;
+            view->map = m;
+            view->map_length = len;
+            return 0;
+        }
+        /* fall through to the buffered path */
+    }
+
+    int e = reserve(scratch, len + AJIS_FILE_PADDING);
+    if (e == 0) e = read_all(fd, scratch->data, len);
+    close(fd);
+    if (e != 0) return e;
+
+    memset(scratch->data + len, 0, AJIS_FILE_PADDING);
+    view->data = scratch->data;
+    view->length = len;
+    return 0;
+}
+
+void ajis_file_close(ajis_file_view *view) {
+    if (!view) return;
+    if (view->map) munmap(view->map, view->map_length);
+    view->data = NULL;
+    view->length = 0;
+    view->map = NULL;
+    view->map_length = 0;
+}
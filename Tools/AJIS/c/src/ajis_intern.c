@@ -0,0 +1,310 @@
+#include "../include/ajis_intern.h"
+#include "../include/ajis_string.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- helpers ---------- */
+
+#define PAGE_SIZE (1u << AJIS_INTERN_PAGE_BITS)
+#define PAGE_MASK (PAGE_SIZE - 1u)
+#define DIR_SIZE (AJIS_INTERN_MAX_SYMBOLS >> AJIS_INTERN_PAGE_BITS)
+
+static uint64_t load_le(const uint8_t *p, size_t n) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+/* Word-at-a-time multiplicative hash; keys are short, so no block loop tricks. */
+static uint64_t key_hash(const uint8_t *p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ ((uint64_t)n * 0xC2B2AE3D27D4EB4Full);
+    while (n >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+        p += 8;
+        n -= 8;
+    }
+    if (n) {
+        h = (h ^ load_le(p, n)) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    h *= 0xC4CEB9FE1A85EC53ull;
+    return h ^ (h >> 29);
+}
+
+static const ajis_intern_entry *entry_of(const ajis_intern_table *t, ajis_symbol sym) {
+    uint32_t i = sym - 1;
+    return &t->pages[i >> AJIS_INTERN_PAGE_BITS][i & PAGE_MASK];
+}
+
+static void lock(ajis_intern_table *t) {
+    if (t->shared) pthread_mutex_lock(&t->lock);
+}
+
+static void unlock(ajis_intern_table *t) {
+    if (t->shared) pthread_mutex_unlock(&t->lock);
+}
+
+/* Scratch from the table's allocator, which need not be thread-safe: taken under the lock too. */
+static void *scratch_alloc(ajis_intern_table *t, size_t size) {
+    lock(t);
+    void *p = ajis_alloc(t->allocator, size);
+    unlock(t);
+    return p;
+}
+
+static void scratch_free(ajis_intern_table *t, void *p, size_t size) {
+    lock(t);
+    ajis_free(t->allocator, p, size);
+    unlock(t);
+}
+
+/* ---------- index ---------- */
+
+static ajis_symbol lookup(const ajis_intern_table *t, const uint8_t *key, size_t len, uint64_t h) {
+    if (t->index_cap == 0) return AJIS_SYMBOL_NONE;
+    size_t mask = t->index_cap - 1;
+    for (size_t j = (size_t)h & mask;; j = (j + 1) & mask) {
+        ajis_symbol s = t->index[j];
+        if (s == AJIS_SYMBOL_NONE) return AJIS_SYMBOL_NONE;
+        const ajis_intern_entry *e = entry_of(t, s);
+        if (e->hash == (uint32_t)h && e->length == len && memcmp(e->bytes, key, len) == 0) return s;
+    }
+}
+
+static void index_place(uint32_t *index, size_t cap, uint32_t hash, ajis_symbol sym) {
+    size_t j = (size_t)hash & (cap - 1);
+    while (index[j] != AJIS_SYMBOL_NONE) j = (j + 1) & (cap - 1);
+    index[j] = sym;
+}
+
+static int index_grow(ajis_intern_table *t) {
+    size_t cap = t->index_cap ? t->index_cap * 2 : 1024;
+    uint32_t *index = (uint32_t *)ajis_alloc(t->allocator, cap * sizeof(uint32_t));
+    if (!index) return 0;
+    memset(index, 0, cap * sizeof(uint32_t));
+    for (ajis_symbol s = 1; s <= t->count; s++) index_place(index, cap, entry_of(t, s)->hash, s);
+    ajis_free(t->allocator, t->index, t->index_cap * sizeof(uint32_t));
+    t->index = index;
+    t->index_cap = cap;
+    return 1;
+}
+
+/* Caller holds the lock (shared tables). */
+static ajis_symbol insert(ajis_intern_table *t, const uint8_t *key, size_t len, uint64_t h) {
+    if (t->count >= AJIS_INTERN_MAX_SYMBOLS || len >= UINT32_MAX) return AJIS_SYMBOL_NONE;
+    if ((size_t)(t->count + 1) * 2 > t->index_cap && !index_grow(t)) return AJIS_SYMBOL_NONE;
+
+    uint32_t i = t->count;
+    ajis_intern_entry **page = &t->pages[i >> AJIS_INTERN_PAGE_BITS];
+    if (!*page) {
+        *page = (ajis_intern_entry *)ajis_alloc(t->allocator, PAGE_SIZE * sizeof(ajis_intern_entry));
+        if (!*page) return AJIS_SYMBOL_NONE;
+    }
+
+    uint8_t *bytes = (uint8_t *)ajis_alloc(&t->strings.allocator, len + 1);
+    if (!bytes) return AJIS_SYMBOL_NONE;
+    if (len) memcpy(bytes, key, len);
+    bytes[len] = 0;
+
+    ajis_intern_entry *e = &(*page)[i & PAGE_MASK];
+    e->bytes = bytes;
+    e->length = (uint32_t)len;
+    e->hash = (uint32_t)h;
+
+    ajis_symbol sym = i + 1;
+    index_place(t->index, t->index_cap, e->hash, sym);
+    /* publish: readers that see the new count also see the entry */
+    __atomic_store_n(&t->count, sym, __ATOMIC_RELEASE);
+    return sym;
+}
+
+static ajis_symbol intern_hashed(ajis_intern_table *t, const uint8_t *key, size_t len, uint64_t h) {
+    lock(t);
+    ajis_symbol sym = lookup(t, key, len, h);
+    if (sym == AJIS_SYMBOL_NONE) sym = insert(t, key, len, h);
+    unlock(t);
+    return sym;
+}
+
+static ajis_error_code intern_escaped(ajis_intern_table *t, const uint8_t *raw, size_t len, unsigned flags,
+                                      ajis_symbol *out) {
+    uint8_t local[256];
+    uint8_t *buf = local;
+    if (len > sizeof(local)) {
+        buf = (uint8_t *)scratch_alloc(t, len);
+        if (!buf) return AJIS_ERR_SIZE_LIMIT;
+    }
+
+    size_t n = 0;
+    ajis_error_code rc = ajis_string_unescape(raw, len, flags, buf, &n, NULL);
+    if (rc == AJIS_OK) {
+        *out = intern_hashed(t, buf, n, key_hash(buf, n));
+        if (*out == AJIS_SYMBOL_NONE) rc = AJIS_ERR_SIZE_LIMIT;
+    }
+
+    if (buf != local) scratch_free(t, buf, len);
+    return rc;
+}
+
+/* ---------- public API ---------- */
+
+ajis_error_code ajis_intern_init(ajis_intern_table *t, const ajis_allocator *alloc, int shared) {
+    memset(t, 0, sizeof(*t));
+    t->allocator = ajis_allocator_or_default(alloc);
+    ajis_arena_init(&t->strings, t->allocator, 0);
+
+    t->pages = (ajis_intern_entry **)ajis_alloc(t->allocator, DIR_SIZE * sizeof(ajis_intern_entry *));
+    if (!t->pages) return AJIS_ERR_SIZE_LIMIT;
+    memset(t->pages, 0, DIR_SIZE * sizeof(ajis_intern_entry *));
+
+    t->shared = shared;
+    if (shared && pthread_mutex_init(&t->lock, NULL) != 0) {
+        ajis_free(t->allocator, t->pages, DIR_SIZE * sizeof(ajis_intern_entry *));
+        t->pages = NULL;
+        return AJIS_ERR_SIZE_LIMIT;
+    }
+    return AJIS_OK;
+}
+
+void ajis_intern_destroy(ajis_intern_table *t) {
+    if (!t || !t->pages) return;
+    for (size_t p = 0; p < DIR_SIZE && t->pages[p]; p++) {
+        ajis_free(t->allocator, t->pages[p], PAGE_SIZE * sizeof(ajis_intern_entry));
+    }
+    ajis_free(t->allocator, t->pages, DIR_SIZE * sizeof(ajis_intern_entry *));
+    ajis_free(t->allocator, t->index, t->index_cap * sizeof(uint32_t));
+    ajis_arena_destroy(&t->strings);
+    if (t->shared) pthread_mutex_destroy(&t->lock);
+    memset(t, 0, sizeof(*t));
+}
+
+ajis_symbol ajis_intern_bytes(ajis_intern_table *t, const uint8_t *key, size_t len) {
+    return intern_hashed(t, key, len, key_hash(key, len));
+}
+
+ajis_symbol ajis_intern_find(ajis_intern_table *t, const uint8_t *key, size_t len) {
+    uint64_t h = key_hash(key, len);
+    lock(t);
+    ajis_symbol sym = lookup(t, key, len, h);
+    unlock(t);
+    return sym;
+}
+
+ajis_error_code ajis_intern_raw(ajis_intern_table *t, const uint8_t *raw, size_t len, unsigned unescape_flags,
+                                ajis_symbol *out) {
+    *out = AJIS_SYMBOL_NONE;
+    if (len && memchr(raw, '\\', len)) return intern_escaped(t, raw, len, unescape_flags, out);
+    *out = intern_hashed(t, raw, len, key_hash(raw, len));
+    return *out == AJIS_SYMBOL_NONE ? AJIS_ERR_SIZE_LIMIT : AJIS_OK;
+}
+
+const uint8_t *ajis_intern_str(const ajis_intern_table *t, ajis_symbol sym, size_t *len) {
+    if (sym == AJIS_SYMBOL_NONE || sym > __atomic_load_n(&t->count, __ATOMIC_ACQUIRE)) return NULL;
+    const ajis_intern_entry *e = entry_of(t, sym);
+    if (len) *len = e->length;
+    return e->bytes;
+}
+
+uint32_t ajis_intern_count(ajis_intern_table *t) {
+    return __atomic_load_n(&t->count, __ATOMIC_ACQUIRE);
+}
+
+typedef struct rank_item {
+    const uint8_t *bytes;
+    uint32_t length;
+    ajis_symbol sym;
+    size_t at;                  /* ajis_intern_rank_symbols(): position in the caller's array */
+} rank_item;
+
+static int rank_item_cmp(const void *pa, const void *pb) {
+    const rank_item *a = (const rank_item *)pa, *b = (const rank_item *)pb;
+    size_t n = a->length < b->length ? a->length : b->length;
+    int c = n ? memcmp(a->bytes, b->bytes, n) : 0;
+    if (c != 0) return c;
+    return (a->length > b->length) - (a->length < b->length);
+}
+
+size_t ajis_intern_ranks(ajis_intern_table *t, uint32_t *ranks, size_t cap) {
+    uint32_t n = ajis_intern_count(t);
+    if ((size_t)n + 1 > cap) return (size_t)n + 1;
+
+    rank_item *items = (rank_item *)scratch_alloc(t, (size_t)n * sizeof(rank_item));
+    if (!items && n) return 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const ajis_intern_entry *e = entry_of(t, i + 1);
+        items[i].bytes = e->bytes;
+        items[i].length = e->length;
+        items[i].sym = i + 1;
+    }
+    if (n > 1) qsort(items, n, sizeof(rank_item), rank_item_cmp);
+
+    ranks[0] = 0;
+    for (uint32_t i = 0; i < n; i++) ranks[items[i].sym] = i + 1;
+    scratch_free(t, items, (size_t)n * sizeof(rank_item));
+    return (size_t)n + 1;
+}
+
+ajis_error_code ajis_intern_rank_symbols(ajis_intern_table *t, uint32_t *syms, size_t n) {
+    if (n == 0) return AJIS_OK;
+    if (n > SIZE_MAX / sizeof(rank_item)) return AJIS_ERR_SIZE_LIMIT;
+    rank_item *items = (rank_item *)scratch_alloc(t, n * sizeof(rank_item));
+    if (!items) return AJIS_ERR_SIZE_LIMIT;
+    for (size_t i = 0; i < n; i++) {
+        const ajis_intern_entry *e = entry_of(t, syms[i]);
+        items[i].bytes = e->bytes;
+        items[i].length = e->length;
+        items[i].sym = syms[i];
+        items[i].at = i;
+    }
+    if (n > 1) qsort(items, n, sizeof(rank_item), rank_item_cmp);
+
+    /* distinct symbols are distinct keys, so a new symbol is the next rank */
+    uint32_t rank = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || items[i].sym != items[i - 1].sym) rank++;
+        syms[items[i].at] = rank;
+    }
+    scratch_free(t, items, n * sizeof(rank_item));
+    return AJIS_OK;
+}
+
+/* ---------- per-thread cache ---------- */
+
+void ajis_intern_cache_init(ajis_intern_cache *c, ajis_intern_table *t) {
+    memset(c, 0, sizeof(*c));
+    c->table = t;
+}
+
+ajis_error_code ajis_intern_cache_raw(ajis_intern_cache *c, const uint8_t *raw, size_t len, unsigned unescape_flags,
+                                      ajis_symbol *out) {
+    /* escaped spans differ from their decoding; they skip the cache */
+    if (len && memchr(raw, '\\', len)) {
+        c->misses++;
+        return ajis_intern_raw(c->table, raw, len, unescape_flags, out);
+    }
+
+    uint64_t h = key_hash(raw, len);
+    size_t slot = (size_t)h & (AJIS_INTERN_CACHE_SLOTS - 1);
+    ajis_symbol sym = c->slots[slot].sym;
+    if (sym != AJIS_SYMBOL_NONE && c->slots[slot].hash == h) {
+        /* the symbol came through this thread's locked path, so its entry is visible */
+        const ajis_intern_entry *e = entry_of(c->table, sym);
+        if (e->length == len && memcmp(e->bytes, raw, len) == 0) {
+            c->hits++;
+            *out = sym;
+            return AJIS_OK;
+        }
+    }
+
+    c->misses++;
+    sym = intern_hashed(c->table, raw, len, h);
+    *out = sym;
+    if (sym == AJIS_SYMBOL_NONE) return AJIS_ERR_SIZE_LIMIT;
+    c->slots[slot].hash = h;
+    c->slots[slot].sym = sym;
+    return AJIS_OK;
+}
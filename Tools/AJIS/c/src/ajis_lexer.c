@@ -679,3 +679,71 @@ ajis_error_code ajis_lexer_next(ajis_lexer *lx, ajis_token *out_tok, ajis_error
     set_tok(out_tok, AJIS_TOKEN_INVALID, lx->in->offset, 0);
     return AJIS_ERR_INVALID_TOKEN;
 }
+
+/* ---------- error recovery ---------- */
+
+static int is_resync_byte(int b) {
+    return is_ws(b) || b == '"' || b == '{' || b == '}' || b == '[' || b == ']' || b == ':' || b == ',';
+}
+
+ajis_error_code ajis_lexer_next_recover(ajis_lexer *lx, ajis_token *out_tok, ajis_diagnostics *diag) {
+    if (!lx || !lx->in || !out_tok) return AJIS_ERR_UNKNOWN;
+
+    ajis_input *in = lx->in;
+    ajis_input before = *in;
+
+    ajis_error err;
+    ajis_error_code rc = ajis_lexer_next(lx, out_tok, &err);
+    if (rc == AJIS_OK) return AJIS_OK;
+    ajis_diagnostics_add(diag, &err);
+
+    if (rc == AJIS_ERR_UNTERMINATED_COMMENT) {
+        /* skip_ignored ran to EOF; nothing left to resync on */
+        set_tok(out_tok, AJIS_TOKEN_INVALID, before.offset, in->length - before.offset);
+        return AJIS_OK;
+    }
+
+    /* where the bad token started (whitespace and comments lex cleanly again) */
+    ajis_input probe = before;
+    ajis_lexer plx;
+    ajis_lexer_init(&plx, &probe, lx->opt);
+    (void)skip_ignored(&plx, NULL);
+    size_t start = probe.offset;
+
+    int b0 = ajis_input_peek(&probe);
+    size_t open_quote = (size_t)-1;
+    if (b0 == '"') open_quote = start;
+    else if ((b0 == 'h' || b0 == 'b') && ajis_input_peek_ahead(&probe, 3) == '"') open_quote = start + 3;
+
+    if (open_quote != (size_t)-1) {
+        /* string or binary literal: resume after its closing quote, or at the end of the line */
+        int closed = in->offset > open_quote + 1 && in->data[in->offset - 1] == '"';
+        while (!closed) {
+            int c = ajis_input_peek(in);
+            if (c < 0 || c == '\n') break;
+            (void)ajis_input_next(in, NULL);
+            if (c == '"') closed = 1;
+            else if (c == '\\' && ajis_input_peek(in) >= 0 && ajis_input_peek(in) != '\n') (void)ajis_input_next(in, NULL);
+        }
+    } else {
+        /* number, identifier or stray byte: always make progress, then run to a boundary */
+        if (in->offset <= start) {
+            in->offset = start;
+            in->line = probe.line;
+            in->column = probe.column;
+            (void)ajis_input_next(in, NULL);
+        }
+        for (;;) {
+            int c = ajis_input_peek(in);
+            if (c < 0 || is_resync_byte(c)) break;
+            if (c == '/') {
+                int c2 = ajis_input_peek_ahead(in, 1);
+                if (c2 == '/' || c2 == '*') break;
+            }
+            (void)ajis_input_next(in, NULL);
+        }
+    }
+
+    set_tok(out_tok, AJIS_TOKEN_INVALID, start, in->offset - start);
+    return AJIS_OK;
+}
@@ -0,0 +1,392 @@
+#include "../include/ajis_lines.h"
+#include "../include/ajis_pool.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ---------- byte search ---------- */
+
+#define SWAR_ONES  0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+
+static uint64_t swar_has(uint64_t x, uint8_t c) {
+    uint64_t y = x ^ (SWAR_ONES * c);
+    return (y - SWAR_ONES) & ~y & SWAR_HIGHS;
+}
+
+/* First '\n', `a` or `b` in [p, end), or end. */
+static const uint8_t *find_stop(const uint8_t *p, const uint8_t *end, uint8_t a, uint8_t b) {
+#if defined(__SSE2__)
+    const __m128i vn = _mm_set1_epi8('\n');
+    const __m128i va = _mm_set1_epi8((char)a);
+    const __m128i vb = _mm_set1_epi8((char)b);
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, vn), _mm_cmpeq_epi8(x, va)), _mm_cmpeq_epi8(x, vb));
+        int mask = _mm_movemask_epi8(m);
+        if (mask) return p + __builtin_ctz((unsigned)mask);
+        p += 16;
+    }
+#endif
+    while (end - p >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        if (swar_has(x, '\n') | swar_has(x, a) | swar_has(x, b)) break;
+        p += 8;
+    }
+    while (p < end && *p != '\n' && *p != a && *p != b) p++;
+    return p;
+}
+
+/* ---------- framing ---------- */
+
+void ajis_lines_framer_init(ajis_lines_framer *fr, const void *data, size_t len, ajis_lexer_options options) {
+    fr->data = (const uint8_t *)data;
+    fr->length = data ? len : 0;
+    fr->pos = 0;
+    fr->line = 1;
+    fr->index = 0;
+    fr->no_close_from = SIZE_MAX;
+    fr->multiline = options.allow_multiline_strings;
+}
+
+/* `p` is after the opening quote; returns the byte after the closing quote, the ending newline, or end. */
+static const uint8_t *skip_string(ajis_lines_framer *fr, const uint8_t *p, const uint8_t *end) {
+    for (;;) {
+        p = find_stop(p, end, '"', '\\');
+        if (p >= end) return end;
+        if (*p == '"') return p + 1;
+        if (*p == '\n') {
+            if (!fr->multiline) return p;
+            fr->line++;
+            p++;
+            continue;
+        }
+        /* escape: the escaped byte is never a stop, except a newline the lexer will reject */
+        if (end - p < 2) return end;
+        if (p[1] == '\n') {
+            p++;
+            continue;
+        }
+        p += 2;
+    }
+}
+
+/*
+ * `p` is at a block comment opener. Returns the byte after the close,
+ * or NULL when the comment is never closed (newlines are then not
+ * counted: the caller reads it as a line comment).
+ */
+static const uint8_t *skip_block(ajis_lines_framer *fr, const uint8_t *p, const uint8_t *end) {
+    const uint8_t *q = p + 2;
+    if ((size_t)(q - fr->data) >= fr->no_close_from) return NULL;
+
+    size_t lines = 0;
+    for (;;) {
+        q = find_stop(q, end, '*', '*');
+        if (q >= end) {
+            /* nothing after here closes a comment: later openers fail at once */
+            fr->no_close_from = (size_t)(p + 2 - fr->data);
+            return NULL;
+        }
+        if (*q == '\n') {
+            lines++;
+            q++;
+            continue;
+        }
+        if (end - q >= 2 && q[1] == '/') {
+            fr->line += lines;
+            return q + 2;
+        }
+        q++;
+    }
+}
+
+/* Returns the newline that ends the record starting at `p`, or end. */
+static const uint8_t *frame(ajis_lines_framer *fr, const uint8_t *p, const uint8_t *end) {
+    for (;;) {
+        p = find_stop(p, end, '"', '/');
+        if (p >= end || *p == '\n') return p;
+        if (*p == '"') {
+            p = skip_string(fr, p + 1, end);
+            continue;
+        }
+        if (end - p >= 2 && p[1] == '*') {
+            const uint8_t *q = skip_block(fr, p, end);
+            if (q) {
+                p = q;
+                continue;
+            }
+        } else if (end - p < 2 || p[1] != '/') {
+            p++;
+            continue;
+        }
+        /* line comment, or a block comment that is never closed */
+        const uint8_t *nl = (const uint8_t *)memchr(p + 2, '\n', (size_t)(end - p - 2));
+        return nl ? nl : end;
+    }
+}
+
+/* Anything besides whitespace and comments (an unclosed comment counts: it is an error to report). */
+static int has_value(const uint8_t *p, const uint8_t *end) {
+    for (;;) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+        if (p >= end) return 0;
+        if (end - p < 2 || *p != '/') return 1;
+        if (p[1] == '/') {
+            const uint8_t *nl = (const uint8_t *)memchr(p + 2, '\n', (size_t)(end - p - 2));
+            if (!nl) return 0;
+            p = nl + 1;
+        } else if (p[1] == '*') {
+            const uint8_t *q = p + 2;
+            for (;;) {
+                q = (const uint8_t *)memchr(q, '*', (size_t)(end - q));
+                if (!q || end - q < 2) return 1;
+                if (q[1] == '/') break;
+                q++;
+            }
+            p = q + 2;
+        } else {
+            return 1;
+        }
+    }
+}
+
+int ajis_lines_next(ajis_lines_framer *fr, ajis_lines_record *rec) {
+    const uint8_t *end = fr->data + fr->length;
+    while (fr->pos < fr->length) {
+        const uint8_t *start = fr->data + fr->pos;
+        size_t line = fr->line;
+        const uint8_t *stop = frame(fr, start, end);
+
+        if (stop < end) {
+            fr->pos = (size_t)(stop - fr->data) + 1;
+            fr->line++;
+        } else {
+            fr->pos = fr->length;
+        }
+        if (stop > start && stop[-1] == '\r') stop--;
+        if (!has_value(start, stop)) continue;
+
+        rec->index = fr->index++;
+        rec->offset = (size_t)(start - fr->data);
+        rec->length = (size_t)(stop - start);
+        rec->line = line;
+        return 1;
+    }
+    return 0;
+}
+
+/* ---------- output buffer ---------- */
+
+ajis_error_code ajis_lines_buffer_append(ajis_lines_buffer *buf, const void *bytes, size_t len) {
+    if (len > buf->capacity - buf->length) {
+        size_t cap = buf->capacity ? buf->capacity : 4096;
+        while (cap - buf->length < len) {
+            if (cap > SIZE_MAX / 2) return AJIS_ERR_SIZE_LIMIT;
+            cap *= 2;
+        }
+        uint8_t *data = (uint8_t *)ajis_realloc(buf->allocator, buf->data, buf->capacity, cap);
+        if (!data) return AJIS_ERR_SIZE_LIMIT;
+        buf->data = data;
+        buf->capacity = cap;
+    }
+    if (len) memcpy(buf->data + buf->length, bytes, len);
+    buf->length += len;
+    return AJIS_OK;
+}
+
+/* ---------- parallel run ---------- */
+
+/* Records per pool task: enough to amortize the steal, few enough to balance. */
+#define BATCH 64
+
+/* Caps the per-window bookkeeping when records are tiny. */
+#define WINDOW_RECORDS (256u * 1024u)
+
+typedef struct lines_slot {
+    ajis_lines_record record;
+    ajis_error_code rc;
+    ajis_error err;
+    unsigned worker;
+    size_t out_offset;
+    size_t out_length;
+} lines_slot;
+
+typedef struct lines_worker {
+    ajis_arena arena;
+    ajis_lines_buffer out;
+} __attribute__((aligned(64))) lines_worker;
+
+typedef struct lines_run {
+    const uint8_t *data;
+    lines_slot *slots;
+    size_t count;
+    lines_worker *workers;
+    ajis_lines_process_fn process;
+    void *ctx;
+} lines_run;
+
+static void run_batch(size_t index, unsigned worker, void *ctx) {
+    lines_run *run = (lines_run *)ctx;
+    lines_worker *w = &run->workers[worker];
+    size_t last = (index + 1) * BATCH < run->count ? (index + 1) * BATCH : run->count;
+
+    for (size_t i = index * BATCH; i < last; i++) {
+        lines_slot *s = &run->slots[i];
+        ajis_lines_task task;
+        task.record = s->record;
+        task.data = run->data + s->record.offset;
+        task.worker = worker;
+        task.arena = &w->arena;
+        task.out = &w->out;
+
+        size_t before = w->out.length;
+        s->err = ajis_error_ok();
+        s->rc = run->process(&task, &s->err, run->ctx);
+        ajis_arena_reset(&w->arena);
+        s->worker = worker;
+        s->out_offset = before;
+        s->out_length = w->out.length - before;
+
+        /* record-relative -> stream position (records start at column 1) */
+        if (s->rc != AJIS_OK) {
+            s->err.code = s->rc;
+            s->err.location.offset += s->record.offset;
+            if (s->err.location.line == 0) s->err.location.line = 1;
+            s->err.location.line += (uint32_t)(s->record.line - 1);
+        }
+    }
+}
+
+ajis_error_code ajis_lines_run(const void *data, size_t len, const ajis_lines_options *opt,
+                               ajis_lines_process_fn process, ajis_lines_report_fn report, void *ctx,
+                               ajis_lines_stats *stats) {
+    ajis_lines_options o = opt ? *opt : ajis_lines_options_default();
+    size_t window = o.window_bytes ? o.window_bytes : AJIS_LINES_DEFAULT_WINDOW;
+    unsigned threads = o.threads ? o.threads : ajis_pool_default_threads();
+    const ajis_allocator *alloc = o.allocator;
+
+    ajis_lines_stats st;
+    memset(&st, 0, sizeof(st));
+    ajis_error_code rc = AJIS_OK;
+
+    /* workers on their own cache lines */
+    size_t block_size = (size_t)threads * sizeof(lines_worker) + 64;
+    void *block = ajis_alloc(alloc, block_size);
+    if (!block) {
+        if (stats) *stats = st;
+        return AJIS_ERR_SIZE_LIMIT;
+    }
+    lines_worker *workers = (lines_worker *)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+    for (unsigned t = 0; t < threads; t++) {
+        ajis_arena_init(&workers[t].arena, alloc, 0);
+        memset(&workers[t].out, 0, sizeof(workers[t].out));
+        workers[t].out.allocator = alloc;
+    }
+
+    lines_slot *slots = NULL;
+    size_t cap = 0;
+
+    ajis_lines_framer fr;
+    ajis_lines_framer_init(&fr, data, len, o.lexer);
+
+    while (!st.stopped) {
+        /* frame one window */
+        size_t n = 0, bytes = 0;
+        ajis_lines_record rec;
+        while (bytes < window && n < WINDOW_RECORDS && ajis_lines_next(&fr, &rec)) {
+            if (n == cap) {
+                size_t ncap = cap ? cap * 2 : 1024;
+                lines_slot *ns = (lines_slot *)ajis_realloc(alloc, slots, cap * sizeof(lines_slot), ncap * sizeof(lines_slot));
+                if (!ns) {
+                    rc = AJIS_ERR_SIZE_LIMIT;
+                    goto done;
+                }
+                slots = ns;
+                cap = ncap;
+            }
+            slots[n++].record = rec;
+            bytes += rec.length + 1;
+        }
+        if (n == 0) break;
+
+        for (unsigned t = 0; t < threads; t++) workers[t].out.length = 0;
+
+        lines_run run;
+        run.data = (const uint8_t *)data;
+        run.slots = slots;
+        run.count = n;
+        run.workers = workers;
+        run.process = process;
+        run.ctx = ctx;
+        size_t batches = (n + BATCH - 1) / BATCH;
+        if (ajis_pool_run_with(batches, threads, run_batch, &run, alloc) == ENOMEM) {
+            /* no room for the pool's bookkeeping: run the window here, as worker 0 */
+            for (size_t b = 0; b < batches; b++) run_batch(b, 0, &run);
+        }
+
+        /* report in input order */
+        for (size_t i = 0; i < n; i++) {
+            const lines_slot *s = &slots[i];
+            st.records++;
+            if (s->rc != AJIS_OK) st.failed++;
+            st.bytes = s->record.offset + s->record.length;
+            const uint8_t *out = s->out_length ? workers[s->worker].out.data + s->out_offset : NULL;
+            if (report && report(&s->record, s->rc, &s->err, out, s->out_length, ctx) != 0) {
+                st.stopped = 1;
+                break;
+            }
+        }
+    }
+    if (!st.stopped) st.bytes = fr.length;
+
+done:
+    for (unsigned t = 0; t < threads; t++) {
+        ajis_arena_destroy(&workers[t].arena);
+        ajis_free(alloc, workers[t].out.data, workers[t].out.capacity);
+    }
+    ajis_free(alloc, block, block_size);
+    ajis_free(alloc, slots, cap * sizeof(lines_slot));
+    if (stats) *stats = st;
+    return rc;
+}
+
+/* ---------- validation ---------- */
+
+typedef struct validate_ctx {
+    ajis_validate_options vopt;
+    ajis_lines_report_fn report;
+    void *ctx;
+} validate_ctx;
+
+static ajis_error_code validate_record(ajis_lines_task *task, ajis_error *err, void *ctx) {
+    const validate_ctx *v = (const validate_ctx *)ctx;
+    ajis_validate_options vopt = v->vopt;
+    vopt.allocator = &task->arena->allocator;
+    return ajis_validate(task->data, task->record.length, &vopt, err);
+}
+
+static int validate_report(const ajis_lines_record *rec, ajis_error_code rc, const ajis_error *err,
+                           const uint8_t *out, size_t out_len, void *ctx) {
+    const validate_ctx *v = (const validate_ctx *)ctx;
+    return v->report ? v->report(rec, rc, err, out, out_len, v->ctx) : 0;
+}
+
+ajis_error_code ajis_lines_validate(const void *data, size_t len, const ajis_lines_options *opt,
+                                    const ajis_validate_options *vopt, ajis_lines_report_fn report, void *ctx,
+                                    ajis_lines_stats *stats) {
+    validate_ctx v;
+    v.vopt = vopt ? *vopt : ajis_validate_options_default();
+    v.report = report;
+    v.ctx = ctx;
+
+    ajis_lines_options o = opt ? *opt : ajis_lines_options_default();
+    o.lexer = v.vopt.lexer;
+    return ajis_lines_run(data, len, &o, validate_record, validate_report, &v, stats);
+}
@@ -0,0 +1,164 @@
+#include "../include/ajis_number.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------- helpers ---------- */
+
+static int is_sep(int b) { return b == ' ' || b == '_' || b == ','; }
+
+static int digit_value(int b, int base) {
+    int d;
+    if (b >= '0' && b <= '9') d = b - '0';
+    else if (b >= 'a' && b <= 'f') d = b - 'a' + 10;
+    else if (b >= 'A' && b <= 'F') d = b - 'A' + 10;
+    else return -1;
+    return d < base ? d : -1;
+}
+
+static const double k_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Magnitude `mag` with sign -> int64, when it fits. */
+static int to_int64(uint64_t mag, int neg, int64_t *out) {
+    if (neg) {
+        if (mag > (uint64_t)INT64_MAX + 1u) return 0;
+        *out = mag == (uint64_t)INT64_MAX + 1u ? INT64_MIN : -(int64_t)mag;
+    } else {
+        if (mag > (uint64_t)INT64_MAX) return 0;
+        *out = (int64_t)mag;
+    }
+    return 1;
+}
+
+static ajis_error_code set_int(ajis_number *out, int64_t v) {
+    out->kind = AJIS_NUMBER_INT;
+    out->i = v;
+    out->f = (double)v;
+    return AJIS_OK;
+}
+
+static ajis_error_code set_float(ajis_number *out, double v) {
+    if (isinf(v)) return AJIS_ERR_SIZE_LIMIT;
+    out->kind = AJIS_NUMBER_FLOAT;
+    out->i = 0;
+    out->f = v;
+    return AJIS_OK;
+}
+
+static ajis_error_code parse_base(const uint8_t *p, const uint8_t *end, int base, int neg, ajis_number *out) {
+    uint64_t mag = 0;
+    int digits = 0;
+    for (; p < end; p++) {
+        if (is_sep(*p)) continue;
+        int d = digit_value(*p, base);
+        if (d < 0) return AJIS_ERR_INVALID_NUMBER;
+        if (mag > (UINT64_MAX - (uint64_t)d) / (uint64_t)base) return AJIS_ERR_SIZE_LIMIT;
+        mag = mag * (uint64_t)base + (uint64_t)d;
+        digits++;
+    }
+    if (!digits) return AJIS_ERR_INVALID_NUMBER;
+
+    int64_t v;
+    if (!to_int64(mag, neg, &v)) return AJIS_ERR_SIZE_LIMIT;
+    return set_int(out, v);
+}
+
+/* strtod() on the literal without its separators. */
+static ajis_error_code slow_float(const uint8_t *raw, size_t len, ajis_number *out) {
+    char local[128];
+    char *buf = len < sizeof(local) ? local : (char *)malloc(len + 1);
+    if (!buf) return AJIS_ERR_SIZE_LIMIT;
+
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!is_sep(raw[i])) buf[n++] = (char)raw[i];
+    }
+    buf[n] = '\0';
+
+    char *stop = NULL;
+    double v = strtod(buf, &stop);
+    ajis_error_code rc = stop == buf + n ? set_float(out, v) : AJIS_ERR_INVALID_NUMBER;
+    if (buf != local) free(buf);
+    return rc;
+}
+
+/* ---------- public API ---------- */
+
+ajis_error_code ajis_number_parse(const uint8_t *raw, size_t len, ajis_number *out) {
+    const uint8_t *p = raw, *end = raw + len;
+    int neg = 0;
+    if (p < end && *p == '-') {
+        neg = 1;
+        p++;
+    }
+    if (p >= end) return AJIS_ERR_INVALID_NUMBER;
+
+    if (end - p > 2 && p[0] == '0') {
+        int b = p[1] | 0x20;
+        if (b == 'x') return parse_base(p + 2, end, 16, neg, out);
+        if (b == 'b') return parse_base(p + 2, end, 2, neg, out);
+        if (b == 'o') return parse_base(p + 2, end, 8, neg, out);
+    }
+
+    /* decimal: up to 19 significant digits in `mant`, the rest only scales */
+    uint64_t mant = 0;
+    int sig = 0, dropped = 0, digits = 0, frac_digits = 0, is_float = 0;
+    for (; p < end && (digit_value(*p, 10) >= 0 || is_sep(*p)); p++) {
+        if (is_sep(*p)) continue;
+        digits++;
+        if (sig < 19) {
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            if (mant) sig++;
+        } else {
+            dropped++;
+        }
+    }
+    if (!digits) return AJIS_ERR_INVALID_NUMBER;
+
+    if (p < end && *p == '.') {
+        is_float = 1;
+        p++;
+        const uint8_t *f = p;
+        for (; p < end && digit_value(*p, 10) >= 0; p++) {
+            if (sig < 19) {
+                mant = mant * 10 + (uint64_t)(*p - '0');
+                frac_digits++;
+                if (mant) sig++;
+            }
+        }
+        if (p == f) return AJIS_ERR_INVALID_NUMBER;
+    }
+
+    long exp10 = 0;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        is_float = 1;
+        p++;
+        int eneg = 0;
+        if (p < end && (*p == '+' || *p == '-')) eneg = *p++ == '-';
+        const uint8_t *e = p;
+        for (; p < end && digit_value(*p, 10) >= 0; p++) {
+            if (exp10 < 100000) exp10 = exp10 * 10 + (*p - '0');
+        }
+        if (p == e) return AJIS_ERR_INVALID_NUMBER;
+        if (eneg) exp10 = -exp10;
+    }
+    if (p != end) return AJIS_ERR_INVALID_NUMBER;
+
+    if (!is_float && !dropped) {
+        int64_t v;
+        if (to_int64(mant, neg, &v)) return set_int(out, v);
+    }
+
+    /* exact when the mantissa and the power of ten are both exact doubles */
+    long scale = exp10 + dropped - frac_digits;
+    if (mant < (1ull << 53) && scale >= -22 && scale <= 22) {
+        double v = (double)mant;
+        v = scale < 0 ? v / k_pow10[-scale] : v * k_pow10[scale];
+        return set_float(out, neg ? -v : v);
+    }
+    return slow_float(raw, len, out);
+}
@@ -0,0 +1,163 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/ajis_pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* ---------- slices ---------- */
+
+/* One slice per worker, padded to its own cache line. */
+typedef struct pool_slice {
+    _Atomic uint64_t range;             /* lo in the high half, hi in the low half */
+    char pad[64 - sizeof(uint64_t)];
+} pool_slice;
+
+typedef struct pool_state {
+    pool_slice *slices;
+    unsigned threads;
+    ajis_pool_task_fn fn;
+    void *ctx;
+} pool_state;
+
+typedef struct pool_worker {
+    pool_state *pool;
+    unsigned id;
+} pool_worker;
+
+static uint64_t pack(uint32_t lo, uint32_t hi) { return ((uint64_t)lo << 32) | hi; }
+static uint32_t lo_of(uint64_t r) { return (uint32_t)(r >> 32); }
+static uint32_t hi_of(uint64_t r) { return (uint32_t)r; }
+
+/* Take the front item of a slice. Returns 0 when the slice is empty. */
+static int take_front(pool_slice *s, uint32_t *out) {
+    uint64_t r = atomic_load_explicit(&s->range, memory_order_acquire);
+    for (;;) {
+        uint32_t lo = lo_of(r), hi = hi_of(r);
+        if (lo >= hi) return 0;
+        if (atomic_compare_exchange_weak_explicit(&s->range, &r, pack(lo + 1, hi),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *out = lo;
+            return 1;
+        }
+    }
+}
+
+/* Steal the back half of a victim's slice into [*lo, *hi). */
+static int steal_half(pool_slice *victim, uint32_t *out_lo, uint32_t *out_hi) {
+    uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+    for (;;) {
+        uint32_t lo = lo_of(r), hi = hi_of(r);
+        if (lo >= hi) return 0;
+        uint32_t mid = lo + (hi - lo) / 2; /* a single item is stolen whole */
+        if (atomic_compare_exchange_weak_explicit(&victim->range, &r, pack(lo, mid),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *out_lo = mid;
+            *out_hi = hi;
+            return 1;
+        }
+    }
+}
+
+/* ---------- workers ---------- */
+
+static void *worker_main(void *arg) {
+    pool_worker *w = (pool_worker *)arg;
+    pool_state *p = w->pool;
+    pool_slice *own = &p->slices[w->id];
+
+    for (;;) {
+        uint32_t i;
+        while (take_front(own, &i)) p->fn(i, w->id, p->ctx);
+
+        /* own slice drained: look for a victim, starting at the next worker */
+        int stole = 0;
+        for (unsigned k = 1; k < p->threads && !stole; k++) {
+            uint32_t lo, hi;
+            if (steal_half(&p->slices[(w->id + k) % p->threads], &lo, &hi)) {
+                atomic_store_explicit(&own->range, pack(lo, hi), memory_order_release);
+                stole = 1;
+            }
+        }
+        /*
+         * Nothing to steal: every remaining item is already owned by a
+         * worker that will run it (including ranges in flight between a
+         * steal and its store), so this worker can leave.
+         */
+        if (!stole) return NULL;
+    }
+}
+
+/* ---------- public API ---------- */
+
+unsigned ajis_pool_default_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1u;
+}
+
+int ajis_pool_run(size_t count, unsigned threads, ajis_pool_task_fn fn, void *ctx) {
+    return ajis_pool_run_with(count, threads, fn, ctx, NULL);
+}
+
+int ajis_pool_run_with(size_t count, unsigned threads, ajis_pool_task_fn fn, void *ctx, const ajis_allocator *alloc) {
+    if (!fn || count > UINT32_MAX) return EINVAL;
+    if (count == 0) return 0;
+    if (threads == 0) threads = ajis_pool_default_threads();
+    if ((size_t)threads > count) threads = (unsigned)count;
+
+    if (threads == 1) {
+        for (size_t i = 0; i < count; i++) fn(i, 0, ctx);
+        return 0;
+    }
+
+    /* one block: cache-line aligned slices, then workers, then thread ids */
+    size_t block_size = 63 + sizeof(pool_slice) * threads + sizeof(pool_worker) * threads + sizeof(pthread_t) * threads;
+    uint8_t *block = (uint8_t *)ajis_alloc(alloc, block_size);
+    if (!block) return ENOMEM;
+    pool_slice *slices = (pool_slice *)(((uintptr_t)block + 63) & ~(uintptr_t)63);
+    pool_worker *workers = (pool_worker *)(slices + threads);
+    pthread_t *tids = (pthread_t *)(workers + threads);
+
+    pool_state p;
+    p.slices = slices;
+    p.threads = threads;
+    p.fn = fn;
+    p.ctx = ctx;
+
+    for (unsigned t = 0; t < threads; t++) {
+        uint32_t lo = (uint32_t)(count * t / threads);
+        uint32_t hi = (uint32_t)(count * (t + 1) / threads);
+        atomic_init(&slices[t].range, pack(lo, hi));
+        workers[t].pool = &p;
+        workers[t].id = t;
+    }
+
+    int rc = 0;
+    unsigned started = 1;
+    for (unsigned t = 1; t < threads; t++) {
+        int e = pthread_create(&tids[t], NULL, worker_main, &workers[t]);
+        if (e != 0) {
+            rc = e;
+            break;
+        }
+        started++;
+    }
+
+    worker_main(&workers[0]);
+    for (unsigned t = 1; t < started; t++) pthread_join(tids[t], NULL);
+
+    /*
+     * A worker that failed to start never drained its slice, and the
+     * others may all have left before reaching it; finish it here.
+     */
+    for (unsigned t = started; t < threads; t++) {
+        uint32_t i;
+        while (take_front(&slices[t], &i)) fn(i, 0, ctx);
+    }
+
+    ajis_free(alloc, block, block_size);
+    return rc;
+}
@@ -0,0 +1,546 @@
+#include "../include/ajis_query.h"
+#include "../include/ajis_string.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ---------- compiling ---------- */
+
+static ajis_error_code path_error(ajis_error *err, ajis_error_code code, const char *path, const char *at,
+                                  const char *ctx) {
+    if (err) {
+        err->code = code;
+        err->location.line = 1;
+        err->location.column = (uint32_t)(at - path) + 1;
+        err->location.offset = (size_t)(at - path);
+        err->context = ctx;
+    }
+    return code;
+}
+
+static ajis_query_step *add_step(ajis_query *q, ajis_query_step_kind kind) {
+    if (q->count == AJIS_QUERY_MAX_STEPS) return NULL;
+    ajis_query_step *s = &q->steps[q->count++];
+    memset(s, 0, sizeof(*s));
+    s->kind = kind;
+    s->name_offset = (uint32_t)q->names_used;
+    return s;
+}
+
+static int add_name_byte(ajis_query *q, ajis_query_step *s, char c) {
+    if (q->names_used == AJIS_QUERY_MAX_NAMES) return 0;
+    q->names[q->names_used++] = (uint8_t)c;
+    s->name_length++;
+    return 1;
+}
+
+ajis_error_code ajis_query_compile(ajis_query *q, const char *path, ajis_error *err) {
+    memset(q, 0, sizeof(*q));
+    const char *p = path;
+    if (*p == '$') p++;
+
+    while (*p) {
+        const char *at = p;
+        ajis_query_step *s;
+
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                s = add_step(q, AJIS_QUERY_ANY_FIELD);
+                p++;
+            } else {
+                s = add_step(q, AJIS_QUERY_FIELD);
+                if (s && (*p == '\0' || *p == '.' || *p == '[')) {
+                    return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, p, "empty field name");
+                }
+                while (s && *p && *p != '.' && *p != '[') {
+                    if (!add_name_byte(q, s, *p++)) s = NULL;
+                }
+            }
+        } else if (*p == '[') {
+            p++;
+            if (p[0] == '*' && p[1] == ']') {
+                s = add_step(q, AJIS_QUERY_ANY_INDEX);
+                p += 2;
+            } else if (*p == '"' || *p == '\'') {
+                char quote = *p++;
+                s = add_step(q, AJIS_QUERY_FIELD);
+                while (s && *p && *p != quote) {
+                    if (*p == '\\' && p[1]) p++;
+                    if (!add_name_byte(q, s, *p++)) s = NULL;
+                }
+                if (s && (p[0] != quote || p[1] != ']')) {
+                    return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, p, "unterminated quoted name");
+                }
+                p += 2;
+            } else if (*p >= '0' && *p <= '9') {
+                s = add_step(q, AJIS_QUERY_INDEX);
+                size_t v = 0;
+                for (; *p >= '0' && *p <= '9'; p++) {
+                    if (v > (SIZE_MAX - 9) / 10) return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, at, "index too large");
+                    v = v * 10 + (size_t)(*p - '0');
+                }
+                if (*p != ']') return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, p, "expected ']'");
+                p++;
+                if (s) s->index = v;
+            } else {
+                return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, p, "expected an index, '*' or a quoted name");
+            }
+        } else {
+            return path_error(err, AJIS_ERR_INVALID_SYNTAX, path, p, "expected '.' or '['");
+        }
+
+        if (!s) return path_error(err, AJIS_ERR_SIZE_LIMIT, path, at, "too many steps or names too long");
+    }
+    return AJIS_OK;
+}
+
+/* ---------- byte search ---------- */
+
+#define SWAR_ONES  0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+
+static uint64_t swar_has(uint64_t x, uint8_t c) {
+    uint64_t y = x ^ (SWAR_ONES * c);
+    return (y - SWAR_ONES) & ~y & SWAR_HIGHS;
+}
+
+static int is_struct(uint8_t b) {
+    return b == '"' || b == '/' || b == '[' || b == ']' || b == '{' || b == '}';
+}
+
+/* First quote, slash or bracket in [p, end), or end. */
+static const uint8_t *find_struct(const uint8_t *p, const uint8_t *end) {
+#if defined(__SSE2__)
+    const __m128i q = _mm_set1_epi8('"');
+    const __m128i sl = _mm_set1_epi8('/');
+    /* '[' ']' '{' '}' all become 0x7F when or'ed with 0x26; filtered below */
+    const __m128i br = _mm_set1_epi8(0x7F);
+    const __m128i bits = _mm_set1_epi8(0x26);
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(x, q), _mm_cmpeq_epi8(x, sl)),
+                                 _mm_cmpeq_epi8(_mm_or_si128(x, bits), br));
+        unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        while (mask) {
+            const uint8_t *hit = p + __builtin_ctz(mask);
+            if (is_struct(*hit)) return hit;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+    while (end - p >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        if (swar_has(x, '"') | swar_has(x, '/') | swar_has(x | (SWAR_ONES * 0x26), 0x7F)) break;
+        p += 8;
+    }
+    while (p < end && !is_struct(*p)) p++;
+    return p;
+}
+
+/* First '"' or '\\' in [p, end), or end. */
+static const uint8_t *find_quote(const uint8_t *p, const uint8_t *end) {
+#if defined(__SSE2__)
+    const __m128i q = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)p);
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, q), _mm_cmpeq_epi8(x, bs)));
+        if (mask) return p + __builtin_ctz((unsigned)mask);
+        p += 16;
+    }
+#endif
+    while (end - p >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        if (swar_has(x, '"') | swar_has(x, '\\')) break;
+        p += 8;
+    }
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+/* ---------- running ---------- */
+
+typedef struct qrun {
+    const ajis_query *q;
+    const uint8_t *data;
+    const uint8_t *end;
+    size_t pos;
+    ajis_query_options opt;
+    ajis_query_fn fn;
+    void *ctx;
+
+    ajis_error_code rc;
+    ajis_error *err;
+    int stopped;
+
+    uint8_t *buf;           /* decode buffer beyond `local` */
+    size_t buf_cap;
+    uint8_t local[256];
+} qrun;
+
+/* Records the error; line/column are counted once, here. */
+static int fail(qrun *r, ajis_error_code code, size_t offset, const char *ctx) {
+    r->rc = code;
+    if (r->err) {
+        uint32_t line = 1;
+        size_t line_start = 0;
+        const uint8_t *p = r->data, *stop = r->data + offset;
+        while ((p = (const uint8_t *)memchr(p, '\n', (size_t)(stop - p))) != NULL) {
+            line++;
+            p++;
+            line_start = (size_t)(p - r->data);
+        }
+        r->err->code = code;
+        r->err->location.line = line;
+        r->err->location.column = (uint32_t)(offset - line_start) + 1;
+        r->err->location.offset = offset;
+        r->err->context = ctx;
+    }
+    return 0;
+}
+
+static int peek(const qrun *r) {
+    return r->data + r->pos < r->end ? r->data[r->pos] : -1;
+}
+
+/* Whitespace and comments. */
+static int skip_ws(qrun *r) {
+    const uint8_t *p = r->data + r->pos, *end = r->end;
+    for (;;) {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+        if (end - p < 2 || *p != '/') break;
+        if (p[1] == '/') {
+            const uint8_t *nl = (const uint8_t *)memchr(p + 2, '\n', (size_t)(end - p - 2));
+            p = nl ? nl + 1 : end;
+        } else if (p[1] == '*') {
+            const uint8_t *q = p + 2;
+            for (;;) {
+                q = (const uint8_t *)memchr(q, '*', (size_t)(end - q));
+                if (!q || end - q < 2) return fail(r, AJIS_ERR_UNTERMINATED_COMMENT, (size_t)(p - r->data), "unterminated block comment");
+                if (q[1] == '/') break;
+                q++;
+            }
+            p = q + 2;
+        } else {
+            break;
+        }
+    }
+    r->pos = (size_t)(p - r->data);
+    return 1;
+}
+
+/* String at r->pos (the opening quote); moves past the closing quote. */
+static int scan_string(qrun *r) {
+    const uint8_t *open = r->data + r->pos, *p = open + 1;
+    for (;;) {
+        p = find_quote(p, r->end);
+        if (p >= r->end) return fail(r, AJIS_ERR_UNEXPECTED_EOF, (size_t)(r->end - r->data), "unterminated string");
+        if (*p == '"') break;
+        p += 2;
+        if (p > r->end) p = r->end;
+    }
+    if (!r->opt.lexer.allow_multiline_strings && memchr(open, '\n', (size_t)(p - open))) {
+        const uint8_t *nl = (const uint8_t *)memchr(open, '\n', (size_t)(p - open));
+        return fail(r, AJIS_ERR_INVALID_STRING, (size_t)(nl - r->data), "newline in string (multiline disabled)");
+    }
+    r->pos = (size_t)(p + 1 - r->data);
+    return 1;
+}
+
+/*
+ * Skip to the bracket that closes `depth` open containers, starting
+ * at r->pos. Only strings and comments are recognised on the way.
+ */
+static int skip_to_close(qrun *r, size_t depth) {
+    const uint8_t *p = r->data + r->pos, *end = r->end;
+    for (;;) {
+        p = find_struct(p, end);
+        if (p >= end) return fail(r, AJIS_ERR_UNEXPECTED_EOF, (size_t)(end - r->data), "unterminated container");
+        switch (*p) {
+            case '"':
+                for (p++;;) {
+                    p = find_quote(p, end);
+                    if (p >= end) return fail(r, AJIS_ERR_UNEXPECTED_EOF, (size_t)(end - r->data), "unterminated string");
+                    if (*p == '"') break;
+                    p += 2;
+                    if (p > end) p = end;
+                }
+                p++;
+                break;
+            case '/':
+                if (end - p >= 2 && p[1] == '/') {
+                    const uint8_t *nl = (const uint8_t *)memchr(p + 2, '\n', (size_t)(end - p - 2));
+                    p = nl ? nl + 1 : end;
+                } else if (end - p >= 2 && p[1] == '*') {
+                    const uint8_t *q = p + 2;
+                    for (;;) {
+                        q = (const uint8_t *)memchr(q, '*', (size_t)(end - q));
+                        if (!q || end - q < 2) return fail(r, AJIS_ERR_UNTERMINATED_COMMENT, (size_t)(p - r->data), "unterminated block comment");
+                        if (q[1] == '/') break;
+                        q++;
+                    }
+                    p = q + 2;
+                } else {
+                    p++;
+                }
+                break;
+            case '[':
+            case '{':
+                depth++;
+                p++;
+                break;
+            default:
+                p++;
+                if (--depth == 0) {
+                    r->pos = (size_t)(p - r->data);
+                    return 1;
+                }
+        }
+    }
+}
+
+/* Scalar other than a string at r->pos, through the lexer (separators, keywords, binary literals). */
+static int lex_scalar(qrun *r, ajis_token *tok) {
+    ajis_input in;
+    ajis_input_init(&in, r->data, (size_t)(r->end - r->data));
+    in.offset = r->pos;
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, r->opt.lexer);
+
+    ajis_error e = ajis_error_ok();
+    ajis_error_code rc = ajis_lexer_next(&lx, tok, &e);
+    if (rc != AJIS_OK) return fail(r, rc, e.location.offset, e.context);
+    if (tok->type < AJIS_TOKEN_STRING || tok->type > AJIS_TOKEN_B64_BINARY) {
+        return fail(r, tok->type == AJIS_TOKEN_EOF ? AJIS_ERR_UNEXPECTED_EOF : AJIS_ERR_INVALID_SYNTAX, tok->span.offset,
+                    "expected a value");
+    }
+    r->pos = in.offset;
+    return 1;
+}
+
+/* Any value at r->pos, without looking inside. */
+static int skip_value(qrun *r) {
+    int c = peek(r);
+    if (c == '{' || c == '[') {
+        r->pos++;
+        return skip_to_close(r, 1);
+    }
+    if (c == '"') return scan_string(r);
+    ajis_token tok;
+    return lex_scalar(r, &tok);
+}
+
+/* Buffer of at least `n` bytes for decoding. */
+static uint8_t *decode_buffer(qrun *r, size_t n) {
+    if (n <= sizeof(r->local)) return r->local;
+    if (n > r->buf_cap) {
+        uint8_t *b = (uint8_t *)ajis_realloc(r->opt.allocator, r->buf, r->buf_cap, n);
+        if (!b) return NULL;
+        r->buf = b;
+        r->buf_cap = n;
+    }
+    return r->buf;
+}
+
+static int decode_string(qrun *r, size_t offset, size_t len, const uint8_t **out, size_t *out_len) {
+    const uint8_t *raw = r->data + offset;
+    if (ajis_string_is_plain(raw, len)) {
+        *out = raw;
+        *out_len = len;
+        return 1;
+    }
+    uint8_t *buf = decode_buffer(r, len);
+    if (!buf) return fail(r, AJIS_ERR_SIZE_LIMIT, offset, "out of memory");
+    size_t bad = 0;
+    if (ajis_string_unescape(raw, len, 0, buf, out_len, &bad) != AJIS_OK) {
+        return fail(r, AJIS_ERR_INVALID_ESCAPE, offset + bad, "invalid escape");
+    }
+    *out = buf;
+    return 1;
+}
+
+static int emit(qrun *r, ajis_span key, size_t index) {
+    ajis_query_match m;
+    memset(&m, 0, sizeof(m));
+    m.key = key;
+    m.index = index;
+    size_t start = r->pos;
+
+    int c = peek(r);
+    if (c == '{' || c == '[') {
+        r->pos++;
+        if (!skip_to_close(r, 1)) return 0;
+        m.type = c == '{' ? AJIS_TOKEN_LBRACE : AJIS_TOKEN_LBRACKET;
+        m.span.offset = start;
+        m.span.length = r->pos - start;
+    } else if (c == '"') {
+        if (!scan_string(r)) return 0;
+        m.type = AJIS_TOKEN_STRING;
+        m.span.offset = start + 1;
+        m.span.length = r->pos - start - 2;
+        if ((r->opt.flags & AJIS_QUERY_DECODE) && !decode_string(r, m.span.offset, m.span.length, &m.text, &m.text_length)) {
+            return 0;
+        }
+    } else {
+        ajis_token tok;
+        if (!lex_scalar(r, &tok)) return 0;
+        m.type = tok.type;
+        m.span = tok.span;
+        if (r->opt.flags & AJIS_QUERY_DECODE) {
+            if (tok.type == AJIS_TOKEN_NUMBER) {
+                ajis_error_code rc = ajis_number_parse(r->data + tok.span.offset, tok.span.length, &m.number);
+                if (rc != AJIS_OK) return fail(r, rc, tok.span.offset, "number out of range");
+            }
+            m.boolean = tok.type == AJIS_TOKEN_TRUE;
+        }
+    }
+
+    if (r->fn && r->fn(&m, r->ctx) != 0) {
+        r->stopped = 1;
+        return 0;
+    }
+    return 1;
+}
+
+static int key_matches(qrun *r, const ajis_query_step *s, ajis_span key, int *match) {
+    const uint8_t *name = r->q->names + s->name_offset;
+    const uint8_t *raw = r->data + key.offset;
+    if (ajis_string_is_plain(raw, key.length)) {
+        *match = key.length == s->name_length && memcmp(raw, name, key.length) == 0;
+        return 1;
+    }
+    const uint8_t *text;
+    size_t n;
+    if (!decode_string(r, key.offset, key.length, &text, &n)) return 0;
+    *match = n == s->name_length && memcmp(text, name, n) == 0;
+    return 1;
+}
+
+static int value(qrun *r, size_t depth, ajis_span key, size_t index);
+
+/* After a member or element: ',' or the closing bracket. Returns 1 more, 2 closed, 0 error. */
+static int separator(qrun *r, int close) {
+    if (!skip_ws(r)) return 0;
+    int c = peek(r);
+    if (c == close) {
+        r->pos++;
+        return 2;
+    }
+    if (c != ',') {
+        if (c < 0) return fail(r, AJIS_ERR_UNEXPECTED_EOF, r->pos, "unterminated container");
+        return fail(r, AJIS_ERR_MISSING_COMMA, r->pos, "expected ',' or a closing bracket");
+    }
+    r->pos++;
+    if (!skip_ws(r)) return 0;
+    if (peek(r) == close) return fail(r, AJIS_ERR_TRAILING_COMMA, r->pos, "trailing comma");
+    return 1;
+}
+
+static int object(qrun *r, size_t depth) {
+    const ajis_query_step *s = &r->q->steps[depth];
+    r->pos++;
+    if (!skip_ws(r)) return 0;
+    if (peek(r) == '}') {
+        r->pos++;
+        return 1;
+    }
+
+    for (size_t n = 0;; n++) {
+        if (peek(r) != '"') return fail(r, AJIS_ERR_INVALID_SYNTAX, r->pos, "expected a member name");
+        ajis_span key;
+        key.offset = r->pos + 1;
+        if (!scan_string(r)) return 0;
+        key.length = r->pos - key.offset - 1;
+
+        if (!skip_ws(r)) return 0;
+        if (peek(r) != ':') return fail(r, AJIS_ERR_MISSING_COLON, r->pos, "expected ':'");
+        r->pos++;
+        if (!skip_ws(r)) return 0;
+
+        int match = 1;
+        if (s->kind == AJIS_QUERY_FIELD && !key_matches(r, s, key, &match)) return 0;
+        if (!match) {
+            if (!skip_value(r)) return 0;
+        } else {
+            if (!value(r, depth + 1, key, n)) return 0;
+            /* a named field is taken once: the rest of the object is skipped */
+            if (s->kind == AJIS_QUERY_FIELD) return skip_to_close(r, 1);
+        }
+
+        int sep = separator(r, '}');
+        if (sep != 1) return sep != 0;
+    }
+}
+
+static int array(qrun *r, size_t depth) {
+    const ajis_query_step *s = &r->q->steps[depth];
+    ajis_span none = { 0, 0 };
+    r->pos++;
+    if (!skip_ws(r)) return 0;
+    if (peek(r) == ']') {
+        r->pos++;
+        return 1;
+    }
+
+    for (size_t n = 0;; n++) {
+        if (s->kind == AJIS_QUERY_ANY_INDEX) {
+            if (!value(r, depth + 1, none, n)) return 0;
+        } else if (n == s->index) {
+            if (!value(r, depth + 1, none, n)) return 0;
+            return skip_to_close(r, 1);
+        } else {
+            if (!skip_value(r)) return 0;
+        }
+
+        int sep = separator(r, ']');
+        if (sep != 1) return sep != 0;
+    }
+}
+
+/* Value at r->pos, reached with `depth` steps matched. */
+static int value(qrun *r, size_t depth, ajis_span key, size_t index) {
+    if (depth == r->q->count) return emit(r, key, index);
+
+    ajis_query_step_kind kind = r->q->steps[depth].kind;
+    int c = peek(r);
+    if (c == '{' && (kind == AJIS_QUERY_FIELD || kind == AJIS_QUERY_ANY_FIELD)) return object(r, depth);
+    if (c == '[' && (kind == AJIS_QUERY_INDEX || kind == AJIS_QUERY_ANY_INDEX)) return array(r, depth);
+    return skip_value(r);
+}
+
+ajis_error_code ajis_query_run(const ajis_query *q, const void *data, size_t len, const ajis_query_options *opt,
+                               ajis_query_fn fn, void *ctx, ajis_error *err) {
+    qrun r;
+    r.q = q;
+    r.data = (const uint8_t *)(data ? data : "");
+    r.end = r.data + (data ? len : 0);
+    r.pos = 0;
+    r.opt = opt ? *opt : ajis_query_options_default();
+    r.fn = fn;
+    r.ctx = ctx;
+    r.rc = AJIS_OK;
+    r.err = err;
+    r.stopped = 0;
+    r.buf = NULL;
+    r.buf_cap = 0;
+    if (err) *err = ajis_error_ok();
+
+    ajis_span none = { 0, 0 };
+    if (skip_ws(&r)) {
+        if (peek(&r) < 0) {
+            fail(&r, AJIS_ERR_UNEXPECTED_EOF, r.pos, "empty document");
+        } else if (value(&r, 0, none, 0) && skip_ws(&r) && peek(&r) >= 0) {
+            fail(&r, AJIS_ERR_INVALID_SYNTAX, r.pos, "content after the value");
+        }
+    }
+
+    ajis_free(r.opt.allocator, r.buf, r.buf_cap);
+    return r.stopped ? AJIS_OK : r.rc;
+}
@@ -0,0 +1,180 @@
+#include "../include/ajis_relex.h"
+
+#include <string.h>
+
+/* ---------- gap buffer ---------- */
+
+static size_t gap_len(const ajis_token_list *l) {
+    return l->gap_end - l->gap_start;
+}
+
+/* Absolute <-> end-relative: x -> doc_length - x, its own inverse. */
+static void flip(ajis_token_entry *e, size_t doc_length) {
+    e->token.span.offset = doc_length - e->token.span.offset;
+    e->end = doc_length - e->end;
+}
+
+static size_t end_at(const ajis_token_list *l, size_t i) {
+    if (i < l->gap_start) return l->items[i].end;
+    return l->doc_length - l->items[i + gap_len(l)].end;
+}
+
+/* Move the gap so that it starts at token index `k`; costs |k - gap_start|. */
+static void move_gap(ajis_token_list *l, size_t k) {
+    while (l->gap_start > k) {
+        ajis_token_entry e = l->items[--l->gap_start];
+        flip(&e, l->doc_length);
+        l->items[--l->gap_end] = e;
+    }
+    while (l->gap_start < k) {
+        ajis_token_entry e = l->items[l->gap_end++];
+        flip(&e, l->doc_length);
+        l->items[l->gap_start++] = e;
+    }
+}
+
+static int push(ajis_token_list *l, const ajis_token *tok, size_t end) {
+    if (l->gap_start == l->gap_end) {
+        size_t cap = l->capacity ? l->capacity * 2 : 256;
+        ajis_token_entry *items = (ajis_token_entry *)ajis_alloc(l->allocator, cap * sizeof(ajis_token_entry));
+        if (!items) return 0;
+        size_t tail = l->capacity - l->gap_end;
+        if (l->gap_start) memcpy(items, l->items, l->gap_start * sizeof(ajis_token_entry));
+        if (tail) memcpy(items + cap - tail, l->items + l->gap_end, tail * sizeof(ajis_token_entry));
+        ajis_free(l->allocator, l->items, l->capacity * sizeof(ajis_token_entry));
+        l->items = items;
+        l->gap_end = cap - tail;
+        l->capacity = cap;
+    }
+    ajis_token_entry *e = &l->items[l->gap_start++];
+    e->token = *tok;
+    e->end = end;
+    return 1;
+}
+
+/* First token whose end is greater than `offset` (count when none). */
+static size_t first_end_after(const ajis_token_list *l, size_t offset) {
+    size_t lo = 0, hi = ajis_token_list_count(l);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (end_at(l, mid) > offset) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+/* ---------- public API ---------- */
+
+void ajis_token_list_init(ajis_token_list *list, ajis_lexer_options options, const ajis_allocator *alloc) {
+    memset(list, 0, sizeof(*list));
+    list->options = options;
+    list->allocator = alloc;
+}
+
+void ajis_token_list_free(ajis_token_list *list) {
+    if (!list) return;
+    ajis_free(list->allocator, list->items, list->capacity * sizeof(ajis_token_entry));
+    list->items = NULL;
+    list->gap_start = list->gap_end = list->capacity = 0;
+    list->doc_length = 0;
+}
+
+ajis_error_code ajis_token_list_lex(ajis_token_list *list, const void *data, size_t len) {
+    list->gap_start = 0;
+    list->gap_end = list->capacity;
+    list->doc_length = len;
+
+    ajis_input in;
+    ajis_input_init(&in, data ? data : "", data ? len : 0);
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, list->options);
+    for (;;) {
+        ajis_token tok;
+        (void)ajis_lexer_next_recover(&lx, &tok, NULL);
+        if (!push(list, &tok, in.offset)) return AJIS_ERR_SIZE_LIMIT;
+        if (tok.type == AJIS_TOKEN_EOF) return AJIS_OK;
+    }
+}
+
+ajis_error_code ajis_token_list_apply(ajis_token_list *list, const void *data, size_t len,
+                                      const ajis_edit *edit, ajis_relex_stats *stats) {
+    if (!edit || edit->offset > list->doc_length || edit->removed > list->doc_length - edit->offset ||
+        len != list->doc_length - edit->removed + edit->inserted) {
+        return AJIS_ERR_UNKNOWN;
+    }
+    if (ajis_token_list_count(list) == 0) return ajis_token_list_lex(list, data, len);
+
+    /* tokens whose bytes and lookahead end before the edit stay */
+    size_t first = edit->offset >= AJIS_RELEX_LOOKAHEAD ? first_end_after(list, edit->offset - AJIS_RELEX_LOOKAHEAD) : 0;
+    size_t restart = first ? end_at(list, first - 1) : 0;
+
+    /* old tokens from `first` on now sit after the gap, relative to the end:
+       switching to the new length shifts them all by the edit delta */
+    move_gap(list, first);
+    list->doc_length = len;
+
+    ajis_input in;
+    ajis_input_init(&in, data ? data : "", data ? len : 0);
+    in.offset = restart;
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, list->options);
+
+    /* boundaries at or past the inserted bytes have at most this distance to the end */
+    size_t rel_edit = len - (edit->offset + edit->inserted);
+    size_t lexed = 0, dropped = 0;
+
+    for (;;) {
+        ajis_token tok;
+        (void)ajis_lexer_next_recover(&lx, &tok, NULL);
+        if (!push(list, &tok, in.offset)) return AJIS_ERR_SIZE_LIMIT;
+        lexed++;
+
+        if (tok.type == AJIS_TOKEN_EOF) {
+            dropped += list->capacity - list->gap_end;
+            list->gap_end = list->capacity;
+            break;
+        }
+
+        /* drop old tokens that end at or before the new boundary; stop on a shared boundary past the edit */
+        size_t rel_new = len - in.offset;
+        int synced = 0;
+        while (list->gap_end < list->capacity) {
+            const ajis_token_entry *old = &list->items[list->gap_end];
+            if (old->end < rel_new) break;
+            list->gap_end++;
+            dropped++;
+            if (old->end == rel_new && old->end <= rel_edit && old->token.type != AJIS_TOKEN_EOF) {
+                synced = 1;
+                break;
+            }
+        }
+        if (synced) break;
+    }
+
+    if (stats) {
+        stats->restart_offset = restart;
+        stats->resync_offset = in.offset;
+        stats->tokens_lexed = lexed;
+        stats->tokens_dropped = dropped;
+    }
+    return AJIS_OK;
+}
+
+ajis_token ajis_token_list_get(const ajis_token_list *list, size_t i, size_t *end) {
+    ajis_token_entry e;
+    if (i < list->gap_start) {
+        e = list->items[i];
+    } else {
+        e = list->items[i + gap_len(list)];
+        flip(&e, list->doc_length);
+    }
+    if (end) *end = e.end;
+    return e.token;
+}
+
+size_t ajis_token_list_find(const ajis_token_list *list, size_t offset) {
+    size_t n = ajis_token_list_count(list);
+    if (n == 0) return 0;
+    size_t i = first_end_after(list, offset);
+    return i < n ? i : n - 1;
+}
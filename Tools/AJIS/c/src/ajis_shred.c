@@ -0,0 +1,719 @@
+#include "../include/ajis_shred.h"
+#include "../include/ajis_number.h"
+#include "../include/ajis_string.h"
+#include "../include/ajis_validate.h"
+
+#include <string.h>
+
+/* ---------- records ---------- */
+
+/* Value kinds, also bit positions in ajis_shredder.seen. */
+enum { VK_NULL = 0, VK_BOOL, VK_INT, VK_FLOAT, VK_STRING, VK_OTHER };
+
+/* ajis_shredder.seen: an int met (held, once settled) that a double does not represent exactly */
+#define SEEN_INEXACT 0x80
+
+typedef struct shred_entry {
+    size_t key_offset;              /* in the record, or in scratch when key_scratch */
+    size_t key_length;
+    int key_scratch;
+    const uint8_t *key;             /* set once the record is read */
+
+    int kind;
+    size_t raw_offset;              /* AJIS text of the value */
+    size_t raw_length;
+    size_t text_offset;             /* STRING: decoded, like the key */
+    size_t text_length;
+    int text_scratch;
+    const uint8_t *text;
+    ajis_number number;
+    int inexact;                    /* INT: (double)number.i != number.i */
+    int boolean;
+
+    int32_t column;                 /* while placing: -1 = not in the schema */
+    ajis_column_type target;
+} shred_entry;
+
+typedef struct srun {
+    ajis_shredder *s;
+    const uint8_t *data;
+    size_t len;
+    ajis_input in;
+    ajis_lexer lx;
+    ajis_token tok;
+    size_t tok_end;                 /* offset just past `tok` */
+    ajis_error *err;
+    ajis_error_code rc;
+
+    size_t count;                   /* members read into s->entries */
+    int is_object;
+} srun;
+
+static void srun_init(srun *r, ajis_shredder *s, const void *data, size_t len, ajis_error *err) {
+    r->s = s;
+    r->data = (const uint8_t *)(data ? data : "");
+    r->len = data ? len : 0;
+    ajis_input_init(&r->in, r->data, r->len);
+    ajis_lexer_init(&r->lx, &r->in, s->opt.lexer);
+    r->tok_end = 0;
+    r->err = err;
+    r->rc = AJIS_OK;
+    r->count = 0;
+    r->is_object = 0;
+}
+
+/* Records the error; line/column are counted once, here. */
+static int fail(srun *r, ajis_error_code code, size_t offset, const char *ctx) {
+    r->rc = code;
+    if (r->err) {
+        uint32_t line = 1;
+        size_t line_start = 0;
+        const uint8_t *p = r->data, *stop = r->data + offset;
+        while ((p = (const uint8_t *)memchr(p, '\n', (size_t)(stop - p))) != NULL) {
+            line++;
+            p++;
+            line_start = (size_t)(p - r->data);
+        }
+        r->err->code = code;
+        r->err->location.line = line;
+        r->err->location.column = (uint32_t)(offset - line_start) + 1;
+        r->err->location.offset = offset;
+        r->err->context = ctx;
+    }
+    return 0;
+}
+
+static int next(srun *r) {
+    ajis_error e = ajis_error_ok();
+    ajis_error_code rc = ajis_lexer_next(&r->lx, &r->tok, &e);
+    if (rc != AJIS_OK) {
+        r->rc = rc;
+        if (r->err) *r->err = e;
+        return 0;
+    }
+    if (r->tok.type == AJIS_TOKEN_INVALID) return fail(r, AJIS_ERR_INVALID_TOKEN, r->tok.span.offset, "invalid token");
+    r->tok_end = r->in.offset;
+    return 1;
+}
+
+static size_t tok_start(const ajis_token *t) {
+    return t->type == AJIS_TOKEN_STRING ? t->span.offset - 1 : t->span.offset;
+}
+
+static int is_scalar(ajis_token_type t) {
+    return t >= AJIS_TOKEN_STRING && t <= AJIS_TOKEN_B64_BINARY;
+}
+
+static int expected_value(srun *r) {
+    return fail(r, r->tok.type == AJIS_TOKEN_EOF ? AJIS_ERR_UNEXPECTED_EOF : AJIS_ERR_INVALID_SYNTAX,
+                r->tok.span.offset, "expected a value");
+}
+
+/* After a member or element: ',' or `close`. Returns 1 more, 2 closed, 0 error. */
+static int separator(srun *r, ajis_token_type close) {
+    if (!next(r)) return 0;
+    if (r->tok.type == close) return 2;
+    if (r->tok.type != AJIS_TOKEN_COMMA) {
+        if (r->tok.type == AJIS_TOKEN_EOF) return fail(r, AJIS_ERR_UNEXPECTED_EOF, r->tok.span.offset, "unterminated container");
+        return fail(r, AJIS_ERR_MISSING_COMMA, r->tok.span.offset, "expected ',' or a closing bracket");
+    }
+    if (!next(r)) return 0;
+    if (r->tok.type == close) return fail(r, AJIS_ERR_TRAILING_COMMA, r->tok.span.offset, "trailing comma");
+    return 1;
+}
+
+/* The value starting at r->tok; leaves r->tok on its last token. */
+static int walk(srun *r, size_t depth) {
+    ajis_token_type t = r->tok.type;
+    if (is_scalar(t)) return 1;
+    if (t != AJIS_TOKEN_LBRACE && t != AJIS_TOKEN_LBRACKET) return expected_value(r);
+    if (depth >= AJIS_VALIDATE_DEFAULT_MAX_DEPTH) {
+        return fail(r, AJIS_ERR_DEPTH_LIMIT, r->tok.span.offset, "nesting depth limit exceeded");
+    }
+
+    ajis_token_type close = t == AJIS_TOKEN_LBRACE ? AJIS_TOKEN_RBRACE : AJIS_TOKEN_RBRACKET;
+    if (!next(r)) return 0;
+    if (r->tok.type == close) return 1;
+    for (;;) {
+        if (close == AJIS_TOKEN_RBRACE) {
+            if (r->tok.type != AJIS_TOKEN_STRING) return fail(r, AJIS_ERR_INVALID_SYNTAX, r->tok.span.offset, "expected a member name");
+            if (!next(r)) return 0;
+            if (r->tok.type != AJIS_TOKEN_COLON) return fail(r, AJIS_ERR_MISSING_COLON, r->tok.span.offset, "expected ':'");
+            if (!next(r)) return 0;
+        }
+        if (!walk(r, depth + 1)) return 0;
+        int sep = separator(r, close);
+        if (sep != 1) return sep != 0;
+    }
+}
+
+static int grow(const ajis_allocator *a, void **p, size_t *cap, size_t need, size_t elem) {
+    if (need <= *cap) return 1;
+    size_t n = *cap ? *cap : 16;
+    while (n < need) n *= 2;
+    void *q = ajis_realloc(a, *p, *cap * elem, n * elem);
+    if (!q) return 0;
+    *p = q;
+    *cap = n;
+    return 1;
+}
+
+/* Decodes the string body at `offset` into scratch when it has escapes. */
+static int decode(srun *r, size_t offset, size_t len, size_t *out_offset, size_t *out_len, int *in_scratch) {
+    const uint8_t *raw = r->data + offset;
+    if (ajis_string_is_plain(raw, len)) {
+        *out_offset = offset;
+        *out_len = len;
+        *in_scratch = 0;
+        return 1;
+    }
+    ajis_shredder *s = r->s;
+    if (!grow(s->opt.allocator, (void **)&s->scratch, &s->scratch_capacity, s->scratch_length + len, 1)) {
+        return fail(r, AJIS_ERR_SIZE_LIMIT, offset, "out of memory");
+    }
+    size_t bad = 0;
+    if (ajis_string_unescape(raw, len, 0, s->scratch + s->scratch_length, out_len, &bad) != AJIS_OK) {
+        return fail(r, AJIS_ERR_INVALID_ESCAPE, offset + bad, "invalid escape");
+    }
+    *out_offset = s->scratch_length;
+    *in_scratch = 1;
+    s->scratch_length += *out_len;
+    return 1;
+}
+
+/* Whether `v` survives a round trip through double (|v| <= 2^53, or enough trailing zero bits). */
+static int exact_double(int64_t v) {
+    double d = (double)v;
+    return d < 9223372036854775808.0 && (int64_t)d == v;
+}
+
+/* The value starting at r->tok, kept in s->entries when it is an object. */
+static int record(srun *r) {
+    ajis_shredder *s = r->s;
+    r->count = 0;
+    r->is_object = r->tok.type == AJIS_TOKEN_LBRACE;
+    s->scratch_length = 0;
+    if (!r->is_object) return walk(r, 0);
+
+    if (!next(r)) return 0;
+    if (r->tok.type == AJIS_TOKEN_RBRACE) return 1;
+    for (;;) {
+        if (!grow(s->opt.allocator, &s->entries, &s->entry_capacity, r->count + 1, sizeof(shred_entry))) {
+            return fail(r, AJIS_ERR_SIZE_LIMIT, r->tok.span.offset, "out of memory");
+        }
+        shred_entry *e = (shred_entry *)s->entries + r->count;
+        memset(e, 0, sizeof(*e));
+
+        if (r->tok.type != AJIS_TOKEN_STRING) return fail(r, AJIS_ERR_INVALID_SYNTAX, r->tok.span.offset, "expected a member name");
+        if (!decode(r, r->tok.span.offset, r->tok.span.length, &e->key_offset, &e->key_length, &e->key_scratch)) return 0;
+        if (!next(r)) return 0;
+        if (r->tok.type != AJIS_TOKEN_COLON) return fail(r, AJIS_ERR_MISSING_COLON, r->tok.span.offset, "expected ':'");
+        if (!next(r)) return 0;
+
+        e->raw_offset = tok_start(&r->tok);
+        switch (r->tok.type) {
+            case AJIS_TOKEN_STRING:
+                e->kind = VK_STRING;
+                if (!decode(r, r->tok.span.offset, r->tok.span.length, &e->text_offset, &e->text_length, &e->text_scratch)) {
+                    return 0;
+                }
+                break;
+            case AJIS_TOKEN_NUMBER:
+                /* out of range: kept as text, in a RAW column */
+                if (ajis_number_parse(r->data + r->tok.span.offset, r->tok.span.length, &e->number) != AJIS_OK) {
+                    e->kind = VK_OTHER;
+                } else {
+                    e->kind = e->number.kind == AJIS_NUMBER_INT ? VK_INT : VK_FLOAT;
+                    e->inexact = e->kind == VK_INT && !exact_double(e->number.i);
+                }
+                break;
+            case AJIS_TOKEN_TRUE:
+            case AJIS_TOKEN_FALSE:
+                e->kind = VK_BOOL;
+                e->boolean = r->tok.type == AJIS_TOKEN_TRUE;
+                break;
+            case AJIS_TOKEN_NULL:
+                e->kind = VK_NULL;
+                break;
+            default:
+                e->kind = VK_OTHER;
+                if (!walk(r, 1)) return 0;
+        }
+        e->raw_length = r->tok_end - e->raw_offset;
+        r->count++;
+
+        int sep = separator(r, AJIS_TOKEN_RBRACE);
+        if (sep == 0) return 0;
+        if (sep == 2) break;
+    }
+
+    /* scratch no longer moves */
+    shred_entry *entries = (shred_entry *)s->entries;
+    for (size_t i = 0; i < r->count; i++) {
+        shred_entry *e = &entries[i];
+        e->key = (e->key_scratch ? s->scratch : r->data) + e->key_offset;
+        e->text = (e->text_scratch ? s->scratch : r->data) + e->text_offset;
+    }
+    return 1;
+}
+
+/* ---------- columns ---------- */
+
+static size_t elem_size(ajis_column_type t) {
+    switch (t) {
+        case AJIS_COLUMN_BOOL: return 1;
+        case AJIS_COLUMN_INT64:
+        case AJIS_COLUMN_FLOAT64: return 8;
+        default: return 0;
+    }
+}
+
+static int has_offsets(ajis_column_type t) {
+    return t == AJIS_COLUMN_STRING || t == AJIS_COLUMN_RAW;
+}
+
+/* One block per column: validity, then values, then offsets (all 8-byte aligned). */
+static size_t block_size(ajis_column_type t, size_t cap) {
+    if (!cap) return 0;
+    return cap / 8 + cap * elem_size(t) + (has_offsets(t) ? (cap + 1) * sizeof(uint64_t) : 0);
+}
+
+/*
+ * Moves column `c` to a block for type `t` and `cap` rows (a multiple of
+ * 64), keeping its rows. On failure the column is left as it was.
+ */
+static int relayout(ajis_shredder *s, ajis_column *c, ajis_column_type t, size_t cap) {
+    size_t size = block_size(t, cap);
+    uint8_t *b = NULL;
+    if (size) {
+        b = (uint8_t *)ajis_alloc(s->opt.allocator, size);
+        if (!b) return 0;
+        memset(b, 0, size);
+    }
+    size_t es = elem_size(t);
+    uint8_t *values = b ? b + cap / 8 : NULL;
+    uint64_t *offsets = b && has_offsets(t) ? (uint64_t *)(values + cap * es) : NULL;
+
+    if (c->capacity && b) {
+        size_t keep = c->capacity < cap ? c->capacity : cap;
+        memcpy(b, c->validity, keep / 8);
+        if (t == c->type && es) memcpy(values, c->values.data, keep * es);
+        if (t == c->type && offsets) memcpy(offsets, c->offsets, (keep + 1) * sizeof(uint64_t));
+    }
+    ajis_free(s->opt.allocator, c->validity, block_size(c->type, c->capacity));
+
+    c->validity = (uint64_t *)b;
+    c->values.data = es ? values : NULL;
+    c->offsets = offsets;
+    c->capacity = cap;
+    c->type = t;
+    return 1;
+}
+
+static int ensure_rows(ajis_shredder *s, size_t need) {
+    if (need <= s->row_capacity) return 1;
+    size_t cap = s->row_capacity ? s->row_capacity : 64;
+    while (cap < need) cap *= 2;
+    for (size_t i = 0; i < s->column_count; i++) {
+        ajis_column *c = &s->columns[i];
+        if (c->capacity < cap && !relayout(s, c, c->type, cap)) return 0;
+    }
+    s->row_capacity = cap;
+    return 1;
+}
+
+static void column_free(ajis_shredder *s, ajis_column *c) {
+    const ajis_allocator *a = s->opt.allocator;
+    ajis_free(a, c->name, c->name_length + 1);
+    ajis_free(a, c->validity, block_size(c->type, c->capacity));
+    ajis_free(a, c->bytes, c->bytes_capacity);
+}
+
+/* New NULL column, null in every row so far. Returns its index or -1. */
+static int32_t column_add(ajis_shredder *s, const uint8_t *name, size_t len) {
+    const ajis_allocator *a = s->opt.allocator;
+    if (s->column_count == s->column_capacity) {
+        size_t cap = s->column_capacity;
+        size_t n = cap ? cap * 2 : 16;
+        ajis_column *cols = (ajis_column *)ajis_realloc(a, s->columns, cap * sizeof(ajis_column), n * sizeof(ajis_column));
+        if (!cols) return -1;
+        s->columns = cols;
+        int32_t *slots = (int32_t *)ajis_realloc(a, s->slots, cap * sizeof(int32_t), n * sizeof(int32_t));
+        if (!slots) return -1;
+        s->slots = slots;
+        uint8_t *seen = (uint8_t *)ajis_realloc(a, s->seen, cap, n);
+        if (!seen) return -1;
+        s->seen = seen;
+        s->column_capacity = n;
+    }
+
+    ajis_column *c = &s->columns[s->column_count];
+    memset(c, 0, sizeof(*c));
+    c->name = (uint8_t *)ajis_alloc(a, len + 1);
+    if (!c->name) return -1;
+    memcpy(c->name, name, len);
+    c->name[len] = '\0';
+    c->name_length = len;
+    c->type = AJIS_COLUMN_NULL;
+    if (!relayout(s, c, AJIS_COLUMN_NULL, s->row_capacity)) {
+        ajis_free(a, c->name, len + 1);
+        return -1;
+    }
+    c->null_count = s->rows;
+    s->seen[s->column_count] = 0;
+    return (int32_t)s->column_count++;
+}
+
+static int32_t column_find(const ajis_shredder *s, const uint8_t *name, size_t len, size_t hint) {
+    if (hint < s->column_count) {
+        const ajis_column *c = &s->columns[hint];
+        if (c->name_length == len && memcmp(c->name, name, len) == 0) return (int32_t)hint;
+    }
+    for (size_t i = 0; i < s->column_count; i++) {
+        const ajis_column *c = &s->columns[i];
+        if (c->name_length == len && memcmp(c->name, name, len) == 0) return (int32_t)i;
+    }
+    return -1;
+}
+
+static ajis_column_type type_of(int kind) {
+    switch (kind) {
+        case VK_BOOL: return AJIS_COLUMN_BOOL;
+        case VK_INT: return AJIS_COLUMN_INT64;
+        case VK_FLOAT: return AJIS_COLUMN_FLOAT64;
+        case VK_STRING: return AJIS_COLUMN_STRING;
+        case VK_NULL: return AJIS_COLUMN_NULL;
+        default: return AJIS_COLUMN_RAW;
+    }
+}
+
+/*
+ * Type a column of type `t` needs to hold value `e`; -1 when none does
+ * without loss. `held_inexact`: the column holds an int a double cannot.
+ */
+static int accepts(ajis_column_type t, const shred_entry *e, int held_inexact) {
+    int kind = e->kind;
+    if (kind == VK_NULL || t == AJIS_COLUMN_RAW) return (int)t;
+    if (t == AJIS_COLUMN_NULL) return (int)type_of(kind);
+    switch (t) {
+        case AJIS_COLUMN_BOOL: return kind == VK_BOOL ? (int)t : -1;
+        case AJIS_COLUMN_INT64:
+            if (kind == VK_INT) return (int)t;
+            return kind == VK_FLOAT && !held_inexact ? (int)AJIS_COLUMN_FLOAT64 : -1;
+        case AJIS_COLUMN_FLOAT64: return kind == VK_FLOAT || (kind == VK_INT && !e->inexact) ? (int)t : -1;
+        case AJIS_COLUMN_STRING: return kind == VK_STRING ? (int)t : -1;
+        default: return -1;
+    }
+}
+
+/* Type inferred from the value kinds met (bits of `seen`). */
+static ajis_column_type settle_type(uint8_t seen) {
+    unsigned m = seen & ~(1u << VK_NULL) & ~SEEN_INEXACT;
+    if (m == 0) return AJIS_COLUMN_NULL;
+    if (m == (1u << VK_BOOL)) return AJIS_COLUMN_BOOL;
+    if (m == (1u << VK_INT)) return AJIS_COLUMN_INT64;
+    if ((m & ~((1u << VK_INT) | (1u << VK_FLOAT))) == 0) return seen & SEEN_INEXACT ? AJIS_COLUMN_RAW : AJIS_COLUMN_FLOAT64;
+    if (m == (1u << VK_STRING)) return AJIS_COLUMN_STRING;
+    return AJIS_COLUMN_RAW;
+}
+
+static int widen(ajis_shredder *s, ajis_column *c, ajis_column_type to) {
+    if (c->type == AJIS_COLUMN_INT64 && to == AJIS_COLUMN_FLOAT64) {
+        /* same slot size: converted in place (accepts() saw every int is exact) */
+        for (size_t i = 0; i < s->rows; i++) c->values.f64[i] = (double)c->values.i64[i];
+        c->type = to;
+        return 1;
+    }
+    /* from NULL: every slot so far is a missing value */
+    return relayout(s, c, to, c->capacity);
+}
+
+/* ---------- placing records ---------- */
+
+static int fallback_add(ajis_shredder *s, ajis_shred_fallback *f, const uint8_t *text, size_t len, size_t rec) {
+    const ajis_allocator *a = s->opt.allocator;
+    if (f->count + 2 > f->capacity) {
+        size_t cap = f->capacity, n = cap ? cap * 2 : 64;
+        uint64_t *offs = (uint64_t *)ajis_realloc(a, f->offsets, cap * sizeof(uint64_t), n * sizeof(uint64_t));
+        if (!offs) return 0;
+        f->offsets = offs;
+        size_t *recs = (size_t *)ajis_realloc(a, f->records, cap * sizeof(size_t), n * sizeof(size_t));
+        if (!recs) return 0;
+        f->records = recs;
+        f->capacity = n;
+        if (!cap) f->offsets[0] = 0;
+    }
+    if (!grow(a, (void **)&f->bytes, &f->bytes_capacity, f->bytes_length + len, 1)) return 0;
+    memcpy(f->bytes + f->bytes_length, text, len);
+    f->bytes_length += len;
+    f->records[f->count] = rec;
+    f->offsets[++f->count] = f->bytes_length;
+    return 1;
+}
+
+static void fallback_free(ajis_shredder *s, ajis_shred_fallback *f) {
+    const ajis_allocator *a = s->opt.allocator;
+    ajis_free(a, f->bytes, f->bytes_capacity);
+    ajis_free(a, f->offsets, f->capacity * sizeof(uint64_t));
+    ajis_free(a, f->records, f->capacity * sizeof(size_t));
+    memset(f, 0, sizeof(*f));
+}
+
+/* Resolves columns and target types; 0 when the record has to fall back. */
+static int fits(ajis_shredder *s, shred_entry *entries, size_t count) {
+    for (size_t i = 0; i < s->column_count; i++) s->slots[i] = -1;
+
+    size_t added = 0;
+    for (size_t i = 0; i < count; i++) {
+        shred_entry *e = &entries[i];
+        e->column = column_find(s, e->key, e->key_length, i);
+        if (e->column < 0) {
+            if (!(s->opt.flags & AJIS_SHRED_ADD_COLUMNS)) return 0;
+            if (s->opt.max_columns && s->column_count + ++added > s->opt.max_columns) return 0;
+            for (size_t j = 0; j < i; j++) {
+                if (entries[j].column < 0 && entries[j].key_length == e->key_length &&
+                    memcmp(entries[j].key, e->key, e->key_length) == 0) {
+                    return 0;
+                }
+            }
+            e->target = type_of(e->kind);
+            continue;
+        }
+        if (s->slots[e->column] >= 0) return 0;
+        s->slots[e->column] = (int32_t)i;
+        int t = accepts(s->columns[e->column].type, e, s->seen[e->column] & SEEN_INEXACT);
+        if (t < 0) return 0;
+        e->target = (ajis_column_type)t;
+    }
+    return 1;
+}
+
+static ajis_error_code place(ajis_shredder *s, const srun *r, size_t start, size_t len) {
+    shred_entry *entries = (shred_entry *)s->entries;
+    size_t count = r->count;
+
+    if (!r->is_object || !fits(s, entries, count)) {
+        if (!fallback_add(s, &s->fallback, r->data + start, len, s->records)) return AJIS_ERR_SIZE_LIMIT;
+        s->records++;
+        return AJIS_OK;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        shred_entry *e = &entries[i];
+        if (e->column < 0) {
+            e->column = column_add(s, e->key, e->key_length);
+            if (e->column < 0) return AJIS_ERR_SIZE_LIMIT;
+            s->slots[e->column] = (int32_t)i;
+        }
+        ajis_column *c = &s->columns[e->column];
+        if (e->target != c->type && !widen(s, c, e->target)) return AJIS_ERR_SIZE_LIMIT;
+    }
+    if (!ensure_rows(s, s->rows + 1)) return AJIS_ERR_SIZE_LIMIT;
+    for (size_t i = 0; i < count; i++) {
+        shred_entry *e = &entries[i];
+        ajis_column *c = &s->columns[e->column];
+        size_t n = c->type == AJIS_COLUMN_STRING ? e->text_length : c->type == AJIS_COLUMN_RAW ? e->raw_length : 0;
+        if (n && !grow(s->opt.allocator, (void **)&c->bytes, &c->bytes_capacity, c->bytes_length + n, 1)) {
+            return AJIS_ERR_SIZE_LIMIT;
+        }
+    }
+
+    /* nothing fails past this point */
+    size_t row = s->rows;
+    for (size_t i = 0; i < s->column_count; i++) {
+        ajis_column *c = &s->columns[i];
+        int32_t slot = s->slots[i];
+        const shred_entry *e = slot >= 0 ? &entries[slot] : NULL;
+        if (!e || e->kind == VK_NULL) {
+            c->null_count++;
+            if (has_offsets(c->type)) c->offsets[row + 1] = c->bytes_length;
+            continue;
+        }
+        c->validity[row / 64] |= 1ull << (row % 64);
+        switch (c->type) {
+            case AJIS_COLUMN_BOOL: c->values.boolean[row] = (uint8_t)e->boolean; break;
+            case AJIS_COLUMN_INT64:
+                c->values.i64[row] = e->number.i;
+                if (e->inexact) s->seen[i] |= SEEN_INEXACT;
+                break;
+            case AJIS_COLUMN_FLOAT64: c->values.f64[row] = e->number.f; break;
+            case AJIS_COLUMN_STRING:
+                memcpy(c->bytes + c->bytes_length, e->text, e->text_length);
+                c->bytes_length += e->text_length;
+                c->offsets[row + 1] = c->bytes_length;
+                break;
+            case AJIS_COLUMN_RAW:
+                memcpy(c->bytes + c->bytes_length, r->data + e->raw_offset, e->raw_length);
+                c->bytes_length += e->raw_length;
+                c->offsets[row + 1] = c->bytes_length;
+                break;
+            default: break;
+        }
+    }
+    s->rows++;
+    s->records++;
+    return AJIS_OK;
+}
+
+/* While inferring: note the member types and hold the record back. */
+static ajis_error_code note(ajis_shredder *s, const srun *r, size_t start, size_t len) {
+    if (r->is_object) {
+        const shred_entry *entries = (const shred_entry *)s->entries;
+        for (size_t i = 0; i < r->count; i++) {
+            const shred_entry *e = &entries[i];
+            int32_t col = column_find(s, e->key, e->key_length, i);
+            if (col < 0) {
+                if (s->opt.max_columns && s->column_count >= s->opt.max_columns) continue;
+                col = column_add(s, e->key, e->key_length);
+                if (col < 0) return AJIS_ERR_SIZE_LIMIT;
+            }
+            s->seen[col] |= (uint8_t)(1u << e->kind | (e->inexact ? SEEN_INEXACT : 0));
+        }
+    }
+    if (!fallback_add(s, &s->pending, r->data + start, len, 0)) return AJIS_ERR_SIZE_LIMIT;
+    return AJIS_OK;
+}
+
+/* Fixes the column types and places the held-back records. */
+static ajis_error_code settle(ajis_shredder *s) {
+    s->inferring = 0;
+    for (size_t i = 0; i < s->column_count; i++) s->columns[i].type = settle_type(s->seen[i]);
+
+    ajis_error_code rc = AJIS_OK;
+    ajis_shred_fallback *p = &s->pending;
+    for (size_t i = 0; i < p->count && rc == AJIS_OK; i++) {
+        srun r;
+        srun_init(&r, s, p->bytes + p->offsets[i], (size_t)(p->offsets[i + 1] - p->offsets[i]), NULL);
+        /* read once already: only memory can run out */
+        if (!next(&r) || !record(&r)) {
+            rc = r.rc;
+            break;
+        }
+        rc = place(s, &r, 0, r.len);
+    }
+    fallback_free(s, p);
+    return rc;
+}
+
+static ajis_error_code add(ajis_shredder *s, srun *r, size_t start) {
+    size_t len = r->tok_end - start;
+    if (!s->inferring) return place(s, r, start, len);
+    ajis_error_code rc = note(s, r, start, len);
+    if (rc == AJIS_OK && s->pending.count >= s->opt.infer_records) rc = settle(s);
+    return rc;
+}
+
+/* ---------- public API ---------- */
+
+void ajis_shredder_init(ajis_shredder *s, const ajis_shred_options *opt) {
+    memset(s, 0, sizeof(*s));
+    s->opt = opt ? *opt : ajis_shred_options_default();
+    if (!s->opt.infer_records) s->opt.infer_records = AJIS_SHRED_DEFAULT_INFER;
+    s->inferring = 1;
+}
+
+void ajis_shredder_destroy(ajis_shredder *s) {
+    const ajis_allocator *a = s->opt.allocator;
+    for (size_t i = 0; i < s->column_count; i++) column_free(s, &s->columns[i]);
+    ajis_free(a, s->columns, s->column_capacity * sizeof(ajis_column));
+    ajis_free(a, s->slots, s->column_capacity * sizeof(int32_t));
+    ajis_free(a, s->seen, s->column_capacity);
+    ajis_free(a, s->entries, s->entry_capacity * sizeof(shred_entry));
+    ajis_free(a, s->scratch, s->scratch_capacity);
+    fallback_free(s, &s->pending);
+    fallback_free(s, &s->fallback);
+    memset(s, 0, sizeof(*s));
+}
+
+ajis_error_code ajis_shred_add(ajis_shredder *s, const void *data, size_t len, ajis_error *err) {
+    srun r;
+    srun_init(&r, s, data, len, err);
+    if (err) *err = ajis_error_ok();
+
+    if (!next(&r)) return r.rc;
+    if (r.tok.type == AJIS_TOKEN_EOF) {
+        fail(&r, AJIS_ERR_UNEXPECTED_EOF, r.tok.span.offset, "empty record");
+        return r.rc;
+    }
+    size_t start = tok_start(&r.tok);
+    if (!record(&r)) return r.rc;
+    size_t end = r.tok_end;
+
+    if (!next(&r)) return r.rc;
+    if (r.tok.type != AJIS_TOKEN_EOF) {
+        fail(&r, AJIS_ERR_INVALID_SYNTAX, r.tok.span.offset, "content after the value");
+        return r.rc;
+    }
+    r.tok_end = end;
+    return add(s, &r, start);
+}
+
+ajis_error_code ajis_shred_array(ajis_shredder *s, const void *data, size_t len, ajis_error *err) {
+    srun r;
+    srun_init(&r, s, data, len, err);
+    if (err) *err = ajis_error_ok();
+
+    if (!next(&r)) return r.rc;
+    if (r.tok.type != AJIS_TOKEN_LBRACKET) {
+        if (r.tok.type == AJIS_TOKEN_EOF) fail(&r, AJIS_ERR_UNEXPECTED_EOF, r.tok.span.offset, "empty document");
+        else fail(&r, AJIS_ERR_INVALID_SYNTAX, r.tok.span.offset, "expected an array of records");
+        return r.rc;
+    }
+
+    if (!next(&r)) return r.rc;
+    if (r.tok.type != AJIS_TOKEN_RBRACKET) {
+        for (;;) {
+            size_t start = tok_start(&r.tok);
+            if (!record(&r)) return r.rc;
+            ajis_error_code rc = add(s, &r, start);
+            if (rc != AJIS_OK) {
+                fail(&r, rc, start, "out of memory");
+                return rc;
+            }
+            int sep = separator(&r, AJIS_TOKEN_RBRACKET);
+            if (sep == 0) return r.rc;
+            if (sep == 2) break;
+        }
+    }
+
+    if (!next(&r)) return r.rc;
+    if (r.tok.type != AJIS_TOKEN_EOF) {
+        fail(&r, AJIS_ERR_INVALID_SYNTAX, r.tok.span.offset, "content after the value");
+        return r.rc;
+    }
+    return ajis_shred_finish(s);
+}
+
+ajis_error_code ajis_shred_finish(ajis_shredder *s) {
+    return s->inferring ? settle(s) : AJIS_OK;
+}
+
+const ajis_column *ajis_shred_column(const ajis_shredder *s, const char *name) {
+    int32_t i = column_find(s, (const uint8_t *)name, strlen(name), 0);
+    return i < 0 ? NULL : &s->columns[i];
+}
+
+double ajis_column_sum(const ajis_column *c, size_t rows) {
+    /* missing values are 0: no masking, the loops vectorize */
+    double sum = 0;
+    switch (c->type) {
+        case AJIS_COLUMN_INT64: {
+            uint64_t acc = 0;   /* wraps instead of overflowing */
+            for (size_t i = 0; i < rows; i++) acc += (uint64_t)c->values.i64[i];
+            sum = (double)(int64_t)acc;
+            break;
+        }
+        case AJIS_COLUMN_FLOAT64:
+            for (size_t i = 0; i < rows; i++) sum += c->values.f64[i];
+            break;
+        case AJIS_COLUMN_BOOL: {
+            size_t acc = 0;
+            for (size_t i = 0; i < rows; i++) acc += c->values.boolean[i];
+            sum = (double)acc;
+            break;
+        }
+        default:
+            break;
+    }
+    return sum;
+}
@@ -0,0 +1,109 @@
+#include "../include/ajis_string.h"
+
+#include <string.h>
+
+/* ---------- helpers ---------- */
+
+static int hex4(const uint8_t *p, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        uint8_t c = p[i];
+        uint32_t d;
+        if (c >= '0' && c <= '9') d = (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') d = (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') d = (uint32_t)(c - 'A' + 10);
+        else return 0;
+        v = (v << 4) | d;
+    }
+    *out = v;
+    return 1;
+}
+
+static size_t put_utf8(uint8_t *o, uint32_t cp) {
+    if (cp < 0x80) {
+        o[0] = (uint8_t)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        o[0] = (uint8_t)(0xC0 | (cp >> 6));
+        o[1] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        o[0] = (uint8_t)(0xE0 | (cp >> 12));
+        o[1] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+        o[2] = (uint8_t)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    o[0] = (uint8_t)(0xF0 | (cp >> 18));
+    o[1] = (uint8_t)(0x80 | ((cp >> 12) & 0x3F));
+    o[2] = (uint8_t)(0x80 | ((cp >> 6) & 0x3F));
+    o[3] = (uint8_t)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static ajis_error_code bad(size_t *err_offset, size_t at) {
+    if (err_offset) *err_offset = at;
+    return AJIS_ERR_INVALID_ESCAPE;
+}
+
+/* ---------- public API ---------- */
+
+ajis_error_code ajis_string_unescape(const uint8_t *raw, size_t len, unsigned flags,
+                                     uint8_t *out, size_t *out_len, size_t *err_offset) {
+    size_t i = 0, o = 0;
+    while (i < len) {
+        /* copy the run up to the next backslash in one go */
+        const uint8_t *bs = (const uint8_t *)memchr(raw + i, '\\', len - i);
+        size_t run = bs ? (size_t)(bs - (raw + i)) : len - i;
+        if (run) {
+            memmove(out + o, raw + i, run);
+            o += run;
+            i += run;
+        }
+        if (!bs) break;
+
+        if (i + 1 >= len) return bad(err_offset, i);
+        uint8_t e = raw[i + 1];
+        uint8_t c;
+        switch (e) {
+            case '"': c = '"'; break;
+            case '\\': c = '\\'; break;
+            case '/': c = '/'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'n': c = '\n'; break;
+            case 'r': c = '\r'; break;
+            case 't': c = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (len - i < 6 || !hex4(raw + i + 2, &cp)) return bad(err_offset, i);
+                size_t used = 6;
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t lo;
+                    if (len - i < 12 || raw[i + 6] != '\\' || raw[i + 7] != 'u' || !hex4(raw + i + 8, &lo) ||
+                        lo < 0xDC00 || lo > 0xDFFF) {
+                        return bad(err_offset, i);
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    used = 12;
+                } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                    return bad(err_offset, i);
+                }
+                o += put_utf8(out + o, cp);
+                i += used;
+                continue;
+            }
+            default:
+                if (!(flags & AJIS_UNESCAPE_KEEP_UNKNOWN)) return bad(err_offset, i);
+                out[o++] = '\\';
+                out[o++] = e;
+                i += 2;
+                continue;
+        }
+        out[o++] = c;
+        i += 2;
+    }
+    if (out_len) *out_len = o;
+    return AJIS_OK;
+}
@@ -0,0 +1,576 @@
+#include "../include/ajis_validate.h"
+#include "../include/ajis_intern.h"
+#include "../include/ajis_string.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ---------- state ---------- */
+
+typedef struct key_entry {
+    uint64_t hash;
+    size_t off;
+    uint32_t len;
+    uint32_t obj;       /* serial number of the owning object */
+} key_entry;
+
+typedef struct key_set {
+    const ajis_allocator *alloc;
+    key_entry *slots;
+    size_t cap;         /* power of two, 0 when unused */
+    size_t count;
+} key_set;
+
+typedef struct vstate {
+    const uint8_t *base;
+    const uint8_t *end;
+    const ajis_validate_options *opt;
+    ajis_error *err;
+    ajis_error_code code;       /* first error, also when err is NULL */
+
+    uint32_t depth;
+    uint32_t max_depth;
+    uint64_t *kinds;            /* bit per level: 1 = object */
+    uint64_t kinds_local[4];
+
+    uint32_t *serials;          /* object serial per level (duplicate keys only) */
+    uint32_t next_serial;
+    key_set keys;
+} vstate;
+
+typedef enum vphase {
+    PH_VALUE,           /* a value is required */
+    PH_ARRAY_FIRST,     /* after '[': value or ']' */
+    PH_ARRAY_NEXT,      /* after ',' in an array */
+    PH_KEY_FIRST,       /* after '{': key or '}' */
+    PH_KEY_NEXT,        /* after ',' in an object */
+    PH_COLON,           /* after a key */
+    PH_AFTER            /* after a value: ',' or a closer (or EOF at top level) */
+} vphase;
+
+/* ---------- helpers ---------- */
+
+/* Errors carry only an offset until here; line/column are derived once. */
+static ajis_error_code fail(vstate *v, ajis_error_code code, size_t off, const char *ctx) {
+    v->code = code;
+    if (!v->err) return code;
+    uint32_t line = 1;
+    size_t line_start = 0;
+    const uint8_t *p = v->base, *stop = v->base + off;
+    for (;;) {
+        const uint8_t *nl = (const uint8_t *)memchr(p, '\n', (size_t)(stop - p));
+        if (!nl) break;
+        line++;
+        p = nl + 1;
+        line_start = (size_t)(p - v->base);
+    }
+    v->err->code = code;
+    v->err->location.line = line;
+    v->err->location.column = (uint32_t)(off - line_start + 1);
+    v->err->location.offset = off;
+    v->err->context = ctx;
+    return code;
+}
+
+static size_t off_of(const vstate *v, const uint8_t *p) {
+    return (size_t)(p - v->base);
+}
+
+static int is_digit(int b) { return b >= '0' && b <= '9'; }
+
+static int is_hex_digit(int b) {
+    return (b >= '0' && b <= '9') || (b >= 'a' && b <= 'f') || (b >= 'A' && b <= 'F');
+}
+
+static int is_ident(int b) {
+    return (b >= 'a' && b <= 'z') || (b >= 'A' && b <= 'Z') || is_digit(b) || b == '_';
+}
+
+/*
+ * Run the regular lexer on the token at `p` (literals the fast paths
+ * do not handle, and error classification). Returns the end of the
+ * token, or NULL with the lexer's error (re-located) reported.
+ */
+static const uint8_t *lex_at(vstate *v, const uint8_t *p, ajis_token_type *type, ajis_error_code *rc) {
+    ajis_input in;
+    ajis_input_init(&in, v->base, (size_t)(v->end - v->base));
+    in.offset = off_of(v, p);
+
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, v->opt->lexer);
+
+    ajis_token tok;
+    ajis_error e = ajis_error_ok();
+    *rc = ajis_lexer_next(&lx, &tok, &e);
+    if (*rc != AJIS_OK) {
+        fail(v, *rc, e.location.offset, e.context);
+        return NULL;
+    }
+    if (type) *type = tok.type;
+    return v->base + in.offset;
+}
+
+/* ---------- whitespace and comments ---------- */
+
+static const uint8_t *skip_ignored(vstate *v, const uint8_t *p) {
+    const uint8_t *end = v->end;
+    for (;;) {
+        while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+        if (end - p < 2 || *p != '/') return p;
+
+        if (p[1] == '/') {
+            const uint8_t *nl = (const uint8_t *)memchr(p + 2, '\n', (size_t)(end - p - 2));
+            p = nl ? nl + 1 : end;
+            continue;
+        }
+        if (p[1] == '*') {
+            const uint8_t *q = p + 2;
+            for (;;) {
+                q = (const uint8_t *)memchr(q, '*', (size_t)(end - q));
+                if (!q || end - q < 2) {
+                    fail(v, AJIS_ERR_UNTERMINATED_COMMENT, off_of(v, end), "unterminated block comment");
+                    return NULL;
+                }
+                if (q[1] == '/') break;
+                q++;
+            }
+            p = q + 2;
+            continue;
+        }
+        return p; /* lone '/': reported by the caller */
+    }
+}
+
+/* ---------- strings ---------- */
+
+#define SWAR_ONES  0x0101010101010101ull
+#define SWAR_HIGHS 0x8080808080808080ull
+
+static uint64_t swar_has(uint64_t x, uint8_t c) {
+    uint64_t y = x ^ (SWAR_ONES * c);
+    return (y - SWAR_ONES) & ~y & SWAR_HIGHS;
+}
+
+/* First '"', '\\' or (when `stop_nl`) '\n' in [p, end), or end. */
+static const uint8_t *find_special(const uint8_t *p, const uint8_t *end, int stop_nl) {
+#if defined(__SSE2__)
+    const __m128i q = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i nl = _mm_set1_epi8(stop_nl ? '\n' : '"');
+    while (end - p >= 16) {
+        __m128i b = _mm_loadu_si128((const __m128i *)p);
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(b, q), _mm_cmpeq_epi8(b, bs)), _mm_cmpeq_epi8(b, nl));
+        int mask = _mm_movemask_epi8(m);
+        if (mask) return p + __builtin_ctz((unsigned)mask);
+        p += 16;
+    }
+#endif
+    while (end - p >= 8) {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        uint64_t hit = swar_has(x, '"') | swar_has(x, '\\');
+        if (stop_nl) hit |= swar_has(x, '\n');
+        if (hit) break; /* the byte loop below finds it within 8 bytes */
+        p += 8;
+    }
+    while (p < end && *p != '"' && *p != '\\' && !(stop_nl && *p == '\n')) p++;
+    return p;
+}
+
+/* `p` is at the opening quote; returns the byte after the closing quote. */
+static const uint8_t *scan_string(vstate *v, const uint8_t *p) {
+    const uint8_t *end = v->end;
+    int stop_nl = !v->opt->lexer.allow_multiline_strings;
+    p++;
+
+    for (;;) {
+        p = find_special(p, end, stop_nl);
+        if (p >= end) {
+            fail(v, AJIS_ERR_UNEXPECTED_EOF, off_of(v, end), "unterminated string");
+            return NULL;
+        }
+        if (*p == '"') return p + 1;
+        if (*p == '\n') {
+            fail(v, AJIS_ERR_INVALID_STRING, off_of(v, p), "newline in string (multiline disabled)");
+            return NULL;
+        }
+
+        /* escape */
+        if (end - p < 2) {
+            fail(v, AJIS_ERR_INVALID_ESCAPE, off_of(v, end), "escape at end of input");
+            return NULL;
+        }
+        if (v->opt->allow_unknown_escapes) {
+            p += 2;
+            continue;
+        }
+        switch (p[1]) {
+            case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+                p += 2;
+                continue;
+            case 'u':
+                if (end - p < 6 || !is_hex_digit(p[2]) || !is_hex_digit(p[3]) ||
+                    !is_hex_digit(p[4]) || !is_hex_digit(p[5])) {
+                    fail(v, AJIS_ERR_INVALID_ESCAPE, off_of(v, p), "\\u escape needs 4 hex digits");
+                    return NULL;
+                }
+                p += 6;
+                continue;
+            default:
+                fail(v, AJIS_ERR_INVALID_ESCAPE, off_of(v, p), "unknown escape sequence");
+                return NULL;
+        }
+    }
+}
+
+/* ---------- numbers ---------- */
+
+static int is_sep(int b) { return b == ' ' || b == '_' || b == ','; }
+
+static int is_base_digit(int b, int base) {
+    if (base == 16) return is_hex_digit(b);
+    if (base == 2) return b == '0' || b == '1';
+    return b >= '0' && b <= '7';
+}
+
+/*
+ * Decimals and base-prefixed integers without digit separators are
+ * checked here; separators and anything malformed (leading zeros, a
+ * lone '-', 0x with no digits) are handed to the lexer so both accept
+ * exactly the same literals.
+ */
+static const uint8_t *scan_number(vstate *v, const uint8_t *p) {
+    const uint8_t *start = p, *end = v->end;
+    int seps = v->opt->lexer.allow_number_separators;
+    ajis_error_code rc;
+
+    if (*p == '-') p++;
+    if (p >= end || !is_digit(*p)) return lex_at(v, start, NULL, &rc);
+
+    if (*p == '0') {
+        p++;
+        if (p < end && (*p == 'x' || *p == 'X' || *p == 'b' || *p == 'B' || *p == 'o' || *p == 'O')) {
+            /* base-prefixed integer without separators */
+            int base = (*p == 'x' || *p == 'X') ? 16 : (*p == 'b' || *p == 'B') ? 2 : 8;
+            const uint8_t *digits = ++p;
+            while (p < end && is_base_digit(*p, base)) p++;
+            if (p == digits || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) return lex_at(v, start, NULL, &rc);
+            /* a separator followed by a digit continues the literal */
+            if (seps && end - p >= 2 && is_sep(*p) && is_base_digit(p[1], base)) return lex_at(v, start, NULL, &rc);
+            return p;
+        }
+        if (p < end && is_digit(*p)) return lex_at(v, start, NULL, &rc);
+        if (seps && end - p >= 2 && is_sep(*p) && is_digit(p[1])) return lex_at(v, start, NULL, &rc);
+    } else {
+        while (p < end && is_digit(*p)) p++;
+        if (seps && p < end && is_sep(*p)) {
+            if (*p == '_') return lex_at(v, start, NULL, &rc);
+            /* ',' and ' ' separate digit groups only when exactly 3 digits follow */
+            int run = 0;
+            while (run < 4 && p + 1 + run < end && is_digit(p[1 + run])) run++;
+            if (run == 3) return lex_at(v, start, NULL, &rc);
+        }
+    }
+
+    if (p < end && *p == '.') {
+        p++;
+        if (p >= end || !is_digit(*p)) {
+            fail(v, AJIS_ERR_INVALID_NUMBER, off_of(v, p), "expected digit after '.'");
+            return NULL;
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || !is_digit(*p)) {
+            fail(v, AJIS_ERR_INVALID_NUMBER, off_of(v, p), "expected digit in exponent");
+            return NULL;
+        }
+        while (p < end && is_digit(*p)) p++;
+    }
+    return p;
+}
+
+/* ---------- keywords and other scalars ---------- */
+
+static const uint8_t *scan_word(vstate *v, const uint8_t *p, const char *kw, size_t n) {
+    if ((size_t)(v->end - p) >= n && memcmp(p, kw, n) == 0 && (v->end - p == (ptrdiff_t)n || !is_ident(p[n]))) {
+        return p + n;
+    }
+    ajis_error_code rc;
+    return lex_at(v, p, NULL, &rc); /* hex"/b64" literals, or the lexer's error */
+}
+
+static int is_base64_char(int b) {
+    return (b >= 'A' && b <= 'Z') || (b >= 'a' && b <= 'z') || is_digit(b) || b == '+' || b == '/' || b == '=';
+}
+
+/* hex"..." and b64"..." bodies; malformed ones are re-lexed for the exact error. */
+static const uint8_t *scan_binary(vstate *v, const uint8_t *p, int hex) {
+    const uint8_t *q = p + 4, *end = v->end;
+    if (hex) while (q < end && is_hex_digit(*q)) q++;
+    else while (q < end && is_base64_char(*q)) q++;
+    if (q < end && *q == '"' && (!hex || (q - p - 4) % 2 == 0)) return q + 1;
+    ajis_error_code rc;
+    return lex_at(v, p, NULL, &rc);
+}
+
+/* ---------- duplicate keys ---------- */
+
+static uint64_t key_hash(const uint8_t *p, size_t n, uint32_t obj) {
+    uint64_t h = 0xcbf29ce484222325ull ^ obj;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h ^ (h >> 29);
+}
+
+static int key_set_grow(key_set *s) {
+    size_t cap = s->cap ? s->cap * 2 : 64;
+    key_entry *slots = (key_entry *)ajis_alloc(s->alloc, cap * sizeof(key_entry));
+    if (!slots) return 0;
+    memset(slots, 0, cap * sizeof(key_entry));
+    for (size_t i = 0; i < s->cap; i++) {
+        key_entry *e = &s->slots[i];
+        if (e->obj == 0) continue;
+        size_t j = (size_t)e->hash & (cap - 1);
+        while (slots[j].obj != 0) j = (j + 1) & (cap - 1);
+        slots[j] = *e;
+    }
+    ajis_free(s->alloc, s->slots, s->cap * sizeof(key_entry));
+    s->slots = slots;
+    s->cap = cap;
+    return 1;
+}
+
+/* Returns 1 if inserted, 0 if the object already has this key, -1 on OOM, -2 if the key cannot be decoded. */
+static int key_set_insert(vstate *v, uint32_t obj, size_t off, size_t len) {
+    key_set *s = &v->keys;
+    if ((s->count + 1) * 2 > s->cap && !key_set_grow(s)) return -1;
+
+    const uint8_t *k = v->base + off;
+    ajis_intern_table *names = v->opt->intern;
+    uint64_t h;
+    if (names) {
+        /* decoded comparison: the entry holds the symbol instead of a span */
+        ajis_symbol sym;
+        unsigned flags = v->opt->allow_unknown_escapes ? AJIS_UNESCAPE_KEEP_UNKNOWN : 0;
+        ajis_error_code rc = ajis_intern_raw(names, k, len, flags, &sym);
+        if (rc != AJIS_OK) return rc == AJIS_ERR_INVALID_ESCAPE ? -2 : -1;
+        off = sym;
+        len = 0;
+        h = key_hash((const uint8_t *)&sym, sizeof(sym), obj);
+    } else {
+        h = key_hash(k, len, obj);
+    }
+
+    size_t j = (size_t)h & (s->cap - 1);
+    while (s->slots[j].obj != 0) {
+        const key_entry *e = &s->slots[j];
+        if (e->hash == h && e->obj == obj && e->len == len &&
+            (names ? e->off == off : memcmp(v->base + e->off, k, len) == 0)) return 0;
+        j = (j + 1) & (s->cap - 1);
+    }
+    s->slots[j].hash = h;
+    s->slots[j].off = off;
+    s->slots[j].len = (uint32_t)len;
+    s->slots[j].obj = obj;
+    s->count++;
+    return 1;
+}
+
+/* ---------- containers ---------- */
+
+static int top_is_object(const vstate *v) {
+    uint32_t d = v->depth - 1;
+    return (int)((v->kinds[d / 64] >> (d % 64)) & 1u);
+}
+
+static ajis_error_code push(vstate *v, const uint8_t *p, int is_object) {
+    if (v->depth >= v->max_depth) {
+        return fail(v, AJIS_ERR_DEPTH_LIMIT, off_of(v, p), "nesting depth limit exceeded");
+    }
+    uint32_t d = v->depth++;
+    uint64_t bit = 1ull << (d % 64);
+    if (is_object) v->kinds[d / 64] |= bit;
+    else v->kinds[d / 64] &= ~bit;
+    if (is_object && v->serials) v->serials[d] = ++v->next_serial;
+    return AJIS_OK;
+}
+
+/* Classify an unexpected byte: the lexer's error if it is not a token, else `code`. */
+static ajis_error_code unexpected(vstate *v, const uint8_t *p, ajis_error_code code, const char *ctx) {
+    ajis_error_code rc;
+    if (!lex_at(v, p, NULL, &rc)) return rc;
+    return fail(v, code, off_of(v, p), ctx);
+}
+
+/* ---------- main loop ---------- */
+
+static ajis_error_code run(vstate *v) {
+    const uint8_t *p = v->base;
+    const uint8_t *end = v->end;
+    vphase ph = PH_VALUE;
+
+    for (;;) {
+        p = skip_ignored(v, p);
+        if (!p) return v->code;
+
+        if (p >= end) {
+            if (ph == PH_AFTER && v->depth == 0) return AJIS_OK;
+            if (v->depth == 0) return fail(v, AJIS_ERR_UNEXPECTED_EOF, off_of(v, p), "expected a value");
+            return fail(v, AJIS_ERR_UNEXPECTED_EOF, off_of(v, p),
+                top_is_object(v) ? "unclosed object" : "unclosed array");
+        }
+
+        int c = *p;
+        ajis_error_code rc;
+
+        switch (ph) {
+            case PH_AFTER:
+                if (v->depth == 0) return unexpected(v, p, AJIS_ERR_INVALID_SYNTAX, "unexpected content after the value");
+                if (c == ',') {
+                    p++;
+                    ph = top_is_object(v) ? PH_KEY_NEXT : PH_ARRAY_NEXT;
+                    continue;
+                }
+                if (c == ']' || c == '}') {
+                    if ((c == '}') != top_is_object(v)) {
+                        return fail(v, AJIS_ERR_INVALID_SYNTAX, off_of(v, p), "mismatched closing bracket");
+                    }
+                    v->depth--;
+                    p++;
+                    continue;
+                }
+                if (c == ':') return fail(v, AJIS_ERR_INVALID_SYNTAX, off_of(v, p), "unexpected ':'");
+                return unexpected(v, p, AJIS_ERR_MISSING_COMMA, "expected ',' between values");
+
+            case PH_KEY_FIRST:
+            case PH_KEY_NEXT:
+                if (c == '}') {
+                    if (ph == PH_KEY_NEXT) return fail(v, AJIS_ERR_TRAILING_COMMA, off_of(v, p), "trailing comma in object");
+                    v->depth--;
+                    p++;
+                    ph = PH_AFTER;
+                    continue;
+                }
+                if (c != '"') {
+                    if (c == ',') return fail(v, AJIS_ERR_INVALID_SYNTAX, off_of(v, p), "expected a key");
+                    return unexpected(v, p, AJIS_ERR_INVALID_SYNTAX, "object key must be a string");
+                }
+                {
+                    const uint8_t *q = scan_string(v, p);
+                    if (!q) return v->code;
+                    if (v->serials) {
+                        int ins = key_set_insert(v, v->serials[v->depth - 1], off_of(v, p + 1), (size_t)(q - p - 2));
+                        if (ins == -2) return fail(v, AJIS_ERR_INVALID_ESCAPE, off_of(v, p), "key has a malformed \\u escape");
+                        if (ins < 0) return fail(v, AJIS_ERR_SIZE_LIMIT, off_of(v, p), "out of memory tracking keys");
+                        if (ins == 0) return fail(v, AJIS_ERR_DUPLICATE_KEY, off_of(v, p), "duplicate key");
+                    }
+                    p = q;
+                }
+                ph = PH_COLON;
+                continue;
+
+            case PH_COLON:
+                if (c != ':') return fail(v, AJIS_ERR_MISSING_COLON, off_of(v, p), "expected ':' after key");
+                p++;
+                ph = PH_VALUE;
+                continue;
+
+            case PH_VALUE:
+            case PH_ARRAY_FIRST:
+            case PH_ARRAY_NEXT:
+                break;
+        }
+
+        /* a value is expected */
+        const uint8_t *q = NULL;
+        switch (c) {
+            case '[':
+            case '{':
+                if ((rc = push(v, p, c == '{')) != AJIS_OK) return rc;
+                p++;
+                ph = c == '{' ? PH_KEY_FIRST : PH_ARRAY_FIRST;
+                continue;
+            case ']':
+                if (ph == PH_ARRAY_FIRST) {
+                    v->depth--;
+                    p++;
+                    ph = PH_AFTER;
+                    continue;
+                }
+                if (ph == PH_ARRAY_NEXT) return fail(v, AJIS_ERR_TRAILING_COMMA, off_of(v, p), "trailing comma in array");
+                return fail(v, AJIS_ERR_INVALID_SYNTAX, off_of(v, p), "expected a value");
+            case '}':
+            case ',':
+            case ':':
+                return fail(v, AJIS_ERR_INVALID_SYNTAX, off_of(v, p), "expected a value");
+            case '"':
+                q = scan_string(v, p);
+                break;
+            case 't': q = scan_word(v, p, "true", 4); break;
+            case 'f': q = scan_word(v, p, "false", 5); break;
+            case 'n': q = scan_word(v, p, "null", 4); break;
+            case 'h':
+            case 'b':
+                if (end - p >= 4 && memcmp(p, c == 'h' ? "hex\"" : "b64\"", 4) == 0) q = scan_binary(v, p, c == 'h');
+                else q = lex_at(v, p, NULL, &rc);
+                break;
+            default:
+                if (c == '-' || is_digit(c)) q = scan_number(v, p);
+                else q = lex_at(v, p, NULL, &rc); /* hex"/b64" literals, or the lexer's error */
+                break;
+        }
+        if (!q) return v->code;
+        p = q;
+        ph = PH_AFTER;
+    }
+}
+
+/* ---------- public API ---------- */
+
+ajis_error_code ajis_validate(const void *data, size_t len, const ajis_validate_options *opt, ajis_error *err) {
+    ajis_validate_options defaults = ajis_validate_options_default();
+    if (!opt) opt = &defaults;
+    ajis_error_reset(err);
+
+    vstate v;
+    memset(&v, 0, sizeof(v));
+    v.base = (const uint8_t *)(data ? data : "");
+    v.end = v.base + (data ? len : 0);
+    v.opt = opt;
+    v.err = err;
+    v.max_depth = opt->max_depth ? opt->max_depth : AJIS_VALIDATE_DEFAULT_MAX_DEPTH;
+
+    const ajis_allocator *alloc = opt->allocator;
+    v.keys.alloc = alloc;
+
+    size_t words = ((size_t)v.max_depth + 63) / 64;
+    v.kinds = v.kinds_local;
+    if (words > sizeof(v.kinds_local) / sizeof(v.kinds_local[0])) {
+        v.kinds = (uint64_t *)ajis_alloc(alloc, words * sizeof(uint64_t));
+        if (!v.kinds) return fail(&v, AJIS_ERR_SIZE_LIMIT, 0, "out of memory");
+    }
+    if (opt->reject_duplicate_keys) {
+        v.serials = (uint32_t *)ajis_alloc(alloc, (size_t)v.max_depth * sizeof(uint32_t));
+        if (!v.serials) {
+            if (v.kinds != v.kinds_local) ajis_free(alloc, v.kinds, words * sizeof(uint64_t));
+            return fail(&v, AJIS_ERR_SIZE_LIMIT, 0, "out of memory");
+        }
+    }
+
+    ajis_error_code rc = run(&v);
+
+    /* reverse order, so an arena can take each block back */
+    ajis_free(alloc, v.keys.slots, v.keys.cap * sizeof(key_entry));
+    ajis_free(alloc, v.serials, (size_t)v.max_depth * sizeof(uint32_t));
+    if (v.kinds != v.kinds_local) ajis_free(alloc, v.kinds, words * sizeof(uint64_t));
+    return rc;
+}
@@ -0,0 +1,448 @@
+#include "../include/auv_hash.h"
+
+#include <stdlib.h>
+
+/* ---------- mixing primitives ---------- */
+
+/* Constants and structure follow the public-domain wyhash family; the
+   exact sequence below is frozen because hashes are persisted. */
+static const uint64_t P0 = 0xa0761d6478bd642full;
+static const uint64_t P1 = 0xe7037ed1a0b428dbull;
+static const uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+static const uint64_t P3 = 0x589965cc75374cc3ull;
+
+static void mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+static uint64_t mix(uint64_t a, uint64_t b) {
+    mum(&a, &b);
+    return a ^ b;
+}
+
+static uint64_t r8(const uint8_t *p) { return auv_load_u64le(p); }
+static uint64_t r4(const uint8_t *p) { return auv_load_u32le(p); }
+static uint64_t r3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+/* ---------- helpers ---------- */
+
+static auv_error_code set_err(auv_error *err, auv_error_code code, size_t offset, const char *ctx) {
+    if (err) {
+        err->code = code;
+        err->offset = offset;
+        err->context = ctx;
+    }
+    return code;
+}
+
+/* Float64 bits with -0.0 folded to +0.0 and every NaN folded to canonical NaN. */
+static uint64_t float_semantic_bits(uint64_t bits) {
+    if ((bits & 0x7FF0000000000000ull) == 0x7FF0000000000000ull && (bits & 0x000FFFFFFFFFFFFFull) != 0) {
+        return AUV_CANONICAL_NAN_BITS;
+    }
+    if (bits == 0x8000000000000000ull) return 0;
+    return bits;
+}
+
+static uint64_t tag_seed(uint64_t seed, auv_tag tag) {
+    return mix(seed ^ ((uint64_t)tag + 1), P3);
+}
+
+/* ---------- hashing ---------- */
+
+uint64_t auv_hash_bytes(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t a, b;
+
+    seed ^= mix(seed ^ P0, P1);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t mid = (len >> 3) << 2;
+            a = (r4(p) << 32) | r4(p + mid);
+            b = (r4(p + len - 4) << 32) | r4(p + len - 4 - mid);
+        } else if (len > 0) {
+            a = r3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            /* three independent lanes keep the multipliers busy */
+            uint64_t s1 = seed, s2 = seed;
+            do {
+                seed = mix(r8(p) ^ P1, r8(p + 8) ^ seed);
+                s1 = mix(r8(p + 16) ^ P2, r8(p + 24) ^ s1);
+                s2 = mix(r8(p + 32) ^ P3, r8(p + 40) ^ s2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= s1 ^ s2;
+        }
+        while (i > 16) {
+            seed = mix(r8(p) ^ P1, r8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = r8(p + i - 16);
+        b = r8(p + i - 8);
+    }
+
+    a ^= P1;
+    b ^= seed;
+    mum(&a, &b);
+    return mix(a ^ P0 ^ (uint64_t)len, b ^ P1);
+}
+
+static auv_error_code hash_value(const uint8_t *base, const uint8_t *p, size_t n, uint64_t seed,
+                                 int depth, uint64_t *out, size_t *used, auv_error *err) {
+    if (depth > AUV_MAX_DEPTH) return set_err(err, AUV_ERR_DEPTH_LIMIT, (size_t)(p - base), "nesting depth limit exceeded");
+
+    auv_record rec;
+    auv_error_code rc = auv_record_read(base, p, n, &rec, err);
+    if (rc != AUV_OK) return rc;
+    *used = rec.size;
+
+    uint64_t ts = tag_seed(seed, rec.tag);
+
+    switch (rec.tag) {
+        case AUV_TAG_NULL:
+            *out = mix(ts, P0);
+            return AUV_OK;
+
+        case AUV_TAG_BOOL:
+            *out = mix((uint64_t)rec.payload[0] ^ P1, ts);
+            return AUV_OK;
+
+        case AUV_TAG_INT64:
+            *out = mix(auv_load_u64le(rec.payload) ^ P1, ts);
+            return AUV_OK;
+
+        case AUV_TAG_FLOAT64:
+            *out = mix(float_semantic_bits(auv_load_u64le(rec.payload)) ^ P1, ts);
+            return AUV_OK;
+
+        case AUV_TAG_CHAR:
+            *out = mix((uint64_t)auv_load_u32le(rec.payload) ^ P1, ts);
+            return AUV_OK;
+
+        case AUV_TAG_STRING:
+        case AUV_TAG_BINARY:
+            *out = auv_hash_bytes(rec.payload, rec.length, ts);
+            return AUV_OK;
+
+        case AUV_TAG_ARRAY: {
+            /* order-dependent chain */
+            uint64_t h = ts;
+            uint64_t count = 0;
+            const uint8_t *q = rec.payload;
+            const uint8_t *end = rec.payload + rec.length;
+            while (q < end) {
+                uint64_t ch;
+                size_t cu;
+                rc = hash_value(base, q, (size_t)(end - q), seed, depth + 1, &ch, &cu, err);
+                if (rc != AUV_OK) return rc;
+                h = mix(h ^ ch, P1);
+                q += cu;
+                count++;
+            }
+            *out = mix(h ^ count, P2);
+            return AUV_OK;
+        }
+
+        case AUV_TAG_OBJECT: {
+            /* order-independent: wrapping sum of well-mixed pair hashes */
+            uint64_t sum = 0;
+            uint64_t count = 0;
+            auv_iter it;
+            auv_record k, v;
+            auv_iter_init(&it, base, &rec);
+            while (!auv_iter_done(&it)) {
+                rc = auv_iter_next_pair(&it, &k, &v, err);
+                if (rc != AUV_OK) return rc;
+
+                uint64_t hk = auv_hash_bytes(k.payload, k.length, tag_seed(seed, AUV_TAG_STRING));
+                uint64_t hv;
+                size_t vu;
+                rc = hash_value(base, auv_record_start(&v), v.size, seed, depth + 1, &hv, &vu, err);
+                if (rc != AUV_OK) return rc;
+
+                sum += mix(hk ^ P2, hv ^ P3);
+                count++;
+            }
+            *out = mix(sum ^ count, ts ^ P0);
+            return AUV_OK;
+        }
+    }
+
+    return set_err(err, AUV_ERR_UNKNOWN_TAG, (size_t)(p - base), "unknown type tag");
+}
+
+auv_error_code auv_hash_value(const uint8_t *wire, size_t len, uint64_t seed, uint64_t *out_hash, auv_error *err) {
+    auv_error_reset(err);
+    if (!out_hash || (!wire && len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+
+    size_t used = 0;
+    auv_error_code rc = hash_value(wire, wire, len, seed, 1, out_hash, &used, err);
+    if (rc != AUV_OK) return rc;
+    if (used != len) return set_err(err, AUV_ERR_INVALID_LENGTH, used, "trailing bytes after value");
+    return AUV_OK;
+}
+
+/* ---------- equality ---------- */
+
+typedef struct eq_ctx {
+    const uint8_t *base_a;
+    const uint8_t *base_b;
+    unsigned flags;
+    const ajis_allocator *alloc;
+    auv_error *err;
+} eq_ctx;
+
+typedef struct pair_ref {
+    const uint8_t *key;
+    size_t key_len;
+    const uint8_t *value;   /* full value record */
+    size_t value_size;
+} pair_ref;
+
+static int bytes_cmp(const uint8_t *a, size_t an, const uint8_t *b, size_t bn) {
+    size_t n = an < bn ? an : bn;
+    int c = n ? memcmp(a, b, n) : 0;
+    if (c != 0) return c;
+    return (an > bn) - (an < bn);
+}
+
+static int pair_ref_cmp(const void *pa, const void *pb) {
+    const pair_ref *a = (const pair_ref *)pa;
+    const pair_ref *b = (const pair_ref *)pb;
+    return bytes_cmp(a->key, a->key_len, b->key, b->key_len);
+}
+
+static auv_error_code eq_value(eq_ctx *cx, const auv_record *ra, const auv_record *rb, int depth, int *eq);
+
+static auv_error_code count_pairs(const uint8_t *base, const auv_record *obj, size_t *count, auv_error *err) {
+    auv_iter it;
+    auv_record k, v;
+    size_t n = 0;
+    auv_iter_init(&it, base, obj);
+    while (!auv_iter_done(&it)) {
+        auv_error_code rc = auv_iter_next_pair(&it, &k, &v, err);
+        if (rc != AUV_OK) return rc;
+        n++;
+    }
+    *count = n;
+    return AUV_OK;
+}
+
+/* Values of a pair found by key lookup; records already framed. */
+static auv_error_code eq_pair_values(eq_ctx *cx, const uint8_t *va, size_t va_size,
+                                     const uint8_t *vb, size_t vb_size, int depth, int *eq) {
+    auv_record ra, rb;
+    (void)auv_record_read(cx->base_a, va, va_size, &ra, NULL);
+    (void)auv_record_read(cx->base_b, vb, vb_size, &rb, NULL);
+    return eq_value(cx, &ra, &rb, depth, eq);
+}
+
+static auv_error_code eq_object(eq_ctx *cx, const auv_record *ra, const auv_record *rb, int depth, int *eq) {
+    size_t na = 0, nb = 0;
+    auv_error_code rc = count_pairs(cx->base_a, ra, &na, cx->err);
+    if (rc != AUV_OK) return rc;
+    rc = count_pairs(cx->base_b, rb, &nb, cx->err);
+    if (rc != AUV_OK) return rc;
+    if (na != nb) {
+        *eq = 0;
+        return AUV_OK;
+    }
+
+    /* lockstep while both sides agree on key order (always the case for canonical input) */
+    auv_iter ia, ib;
+    auv_record ka, va, kb, vb;
+    auv_iter_init(&ia, cx->base_a, ra);
+    auv_iter_init(&ib, cx->base_b, rb);
+    size_t done = 0;
+    const uint8_t *rest_a = ia.p, *rest_b = ib.p;
+
+    while (done < na) {
+        rest_a = ia.p;
+        rest_b = ib.p;
+        (void)auv_iter_next_pair(&ia, &ka, &va, NULL);
+        (void)auv_iter_next_pair(&ib, &kb, &vb, NULL);
+
+        if (ka.length != kb.length || memcmp(ka.payload, kb.payload, ka.length) != 0) break;
+
+        rc = eq_value(cx, &va, &vb, depth + 1, eq);
+        if (rc != AUV_OK || !*eq) return rc;
+        done++;
+    }
+
+    if (done == na) {
+        *eq = 1;
+        return AUV_OK;
+    }
+
+    if (cx->flags & AUV_EQ_CANONICAL) {
+        /* both sorted and unique: first key mismatch means different key sets */
+        *eq = 0;
+        return AUV_OK;
+    }
+
+    /* key order diverged: look up the remaining keys of A among the remaining pairs of B */
+    size_t remaining = na - done;
+    pair_ref local[16];
+    pair_ref *tab = local;
+    if (remaining > sizeof(local) / sizeof(local[0])) {
+        tab = (pair_ref *)ajis_alloc(cx->alloc, remaining * sizeof(pair_ref));
+        if (!tab) return set_err(cx->err, AUV_ERR_OUT_OF_MEMORY, (size_t)(rest_b - cx->base_b), "object key table");
+    }
+
+    auv_record rest_rec;
+    rest_rec.tag = AUV_TAG_OBJECT;
+    rest_rec.payload = rest_b;
+    rest_rec.length = (size_t)(rb->payload + rb->length - rest_b);
+    rest_rec.size = rest_rec.length;
+    auv_iter_init(&ib, cx->base_b, &rest_rec);
+    for (size_t i = 0; i < remaining; i++) {
+        (void)auv_iter_next_pair(&ib, &kb, &vb, NULL);
+        tab[i].key = kb.payload;
+        tab[i].key_len = kb.length;
+        tab[i].value = auv_record_start(&vb);
+        tab[i].value_size = vb.size;
+    }
+    int sorted = remaining > 8;
+    if (sorted) qsort(tab, remaining, sizeof(pair_ref), pair_ref_cmp);
+
+    rest_rec.payload = rest_a;
+    rest_rec.length = (size_t)(ra->payload + ra->length - rest_a);
+    rest_rec.size = rest_rec.length;
+    auv_iter_init(&ia, cx->base_a, &rest_rec);
+
+    *eq = 1;
+    for (size_t i = 0; i < remaining && *eq; i++) {
+        (void)auv_iter_next_pair(&ia, &ka, &va, NULL);
+
+        const pair_ref *hit = NULL;
+        if (sorted) {
+            pair_ref probe;
+            probe.key = ka.payload;
+            probe.key_len = ka.length;
+            hit = (const pair_ref *)bsearch(&probe, tab, remaining, sizeof(pair_ref), pair_ref_cmp);
+        } else {
+            for (size_t j = 0; j < remaining; j++) {
+                if (tab[j].key_len == ka.length && memcmp(tab[j].key, ka.payload, ka.length) == 0) {
+                    hit = &tab[j];
+                    break;
+                }
+            }
+        }
+
+        if (!hit) {
+            *eq = 0;
+            break;
+        }
+        rc = eq_pair_values(cx, auv_record_start(&va), va.size, hit->value, hit->value_size, depth + 1, eq);
+        if (rc != AUV_OK) break;
+    }
+
+    if (tab != local) ajis_free(cx->alloc, tab, remaining * sizeof(pair_ref));
+    return rc;
+}
+
+static auv_error_code eq_value(eq_ctx *cx, const auv_record *ra, const auv_record *rb, int depth, int *eq) {
+    if (depth > AUV_MAX_DEPTH) {
+        return set_err(cx->err, AUV_ERR_DEPTH_LIMIT, (size_t)(auv_record_start(ra) - cx->base_a), "nesting depth limit exceeded");
+    }
+
+    /* identical bytes are always semantically equal */
+    if (ra->size == rb->size && memcmp(auv_record_start(ra), auv_record_start(rb), ra->size) == 0) {
+        *eq = 1;
+        return AUV_OK;
+    }
+
+    *eq = 0;
+    if (ra->tag != rb->tag) return AUV_OK;
+
+    switch (ra->tag) {
+        case AUV_TAG_FLOAT64:
+            *eq = float_semantic_bits(auv_load_u64le(ra->payload)) == float_semantic_bits(auv_load_u64le(rb->payload));
+            return AUV_OK;
+
+        case AUV_TAG_ARRAY: {
+            auv_iter ia, ib;
+            auv_record ca, cb;
+            auv_iter_init(&ia, cx->base_a, ra);
+            auv_iter_init(&ib, cx->base_b, rb);
+            for (;;) {
+                int da = auv_iter_done(&ia), db = auv_iter_done(&ib);
+                if (da || db) {
+                    *eq = da && db;
+                    return AUV_OK;
+                }
+                auv_error_code rc = auv_iter_next(&ia, &ca, cx->err);
+                if (rc != AUV_OK) return rc;
+                rc = auv_iter_next(&ib, &cb, cx->err);
+                if (rc != AUV_OK) return rc;
+                rc = eq_value(cx, &ca, &cb, depth + 1, eq);
+                if (rc != AUV_OK || !*eq) return rc;
+            }
+        }
+
+        case AUV_TAG_OBJECT:
+            return eq_object(cx, ra, rb, depth, eq);
+
+        default:
+            /* every other type is equal exactly when its payload bytes are */
+            return AUV_OK;
+    }
+}
+
+auv_error_code auv_equal(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len,
+                         unsigned flags, int *out_equal, auv_error *err) {
+    return auv_equal_with(a, a_len, b, b_len, flags, NULL, out_equal, err);
+}
+
+auv_error_code auv_equal_with(const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len,
+                              unsigned flags, const ajis_allocator *alloc, int *out_equal, auv_error *err) {
+    auv_error_reset(err);
+    if (!out_equal || (!a && a_len) || (!b && b_len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+
+    /* whole-buffer fast path */
+    if (a_len == b_len && memcmp(a, b, a_len) == 0) {
+        *out_equal = 1;
+        return AUV_OK;
+    }
+
+    auv_record ra, rb;
+    auv_error_code rc = auv_record_read(a, a, a_len, &ra, err);
+    if (rc != AUV_OK) return rc;
+    if (ra.size != a_len) return set_err(err, AUV_ERR_INVALID_LENGTH, ra.size, "trailing bytes after value");
+    rc = auv_record_read(b, b, b_len, &rb, err);
+    if (rc != AUV_OK) return rc;
+    if (rb.size != b_len) return set_err(err, AUV_ERR_INVALID_LENGTH, rb.size, "trailing bytes after value");
+
+    eq_ctx cx;
+    cx.base_a = a;
+    cx.base_b = b;
+    cx.flags = flags;
+    cx.alloc = alloc;
+    cx.err = err;
+    return eq_value(&cx, &ra, &rb, 1, out_equal);
+}
@@ -0,0 +1,274 @@
+#include "../include/auv_key.h"
+
+#include <stdlib.h>
+
+/* ---------- helpers ---------- */
+
+/* Key type bytes: AUV precedence rank, shifted up by one so 0x00 stays
+   free as the array / key-list terminator (shorter prefix sorts first). */
+static uint8_t type_byte(auv_tag tag) { return (uint8_t)(tag + 1); }
+
+static void put_byte(auv_key_buf *kb, uint8_t b) {
+    if (kb->length < kb->capacity) kb->data[kb->length] = b;
+    kb->length++;
+}
+
+static void put_u64be(auv_key_buf *kb, uint64_t v) {
+    for (int shift = 56; shift >= 0; shift -= 8) put_byte(kb, (uint8_t)(v >> shift));
+}
+
+static void put_u32be(auv_key_buf *kb, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) put_byte(kb, (uint8_t)(v >> shift));
+}
+
+/* 0x00 -> 0x00 0xFF, terminator 0x00 0x01 */
+static void put_escaped(auv_key_buf *kb, const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        put_byte(kb, p[i]);
+        if (p[i] == 0x00) put_byte(kb, 0xFF);
+    }
+    put_byte(kb, 0x00);
+    put_byte(kb, 0x01);
+}
+
+static uint64_t int64_bits(int64_t v) {
+    return (uint64_t)v ^ 0x8000000000000000ull;
+}
+
+static uint64_t float64_bits(uint64_t bits) {
+    uint64_t exp = bits & 0x7FF0000000000000ull;
+    uint64_t frac = bits & 0x000FFFFFFFFFFFFFull;
+
+    if (exp == 0x7FF0000000000000ull && frac != 0) bits = AUV_CANONICAL_NAN_BITS;
+    if (bits == 0x8000000000000000ull) bits = 0; /* -0.0 == +0.0 */
+
+    /* negative: invert everything (larger magnitude sorts lower);
+       positive: set the sign bit so it sorts above all negatives */
+    if (bits & 0x8000000000000000ull) return ~bits;
+    return bits | 0x8000000000000000ull;
+}
+
+static auv_error_code set_err(auv_error *err, auv_error_code code, size_t offset, const char *ctx) {
+    if (err) {
+        err->code = code;
+        err->offset = offset;
+        err->context = ctx;
+    }
+    return code;
+}
+
+typedef struct key_pair {
+    const uint8_t *key;     /* key payload (UTF-8 bytes) */
+    size_t key_len;
+    const uint8_t *value;   /* full value record */
+    size_t value_size;
+} key_pair;
+
+static int bytes_cmp(const uint8_t *a, size_t an, const uint8_t *b, size_t bn) {
+    size_t n = an < bn ? an : bn;
+    int c = n ? memcmp(a, b, n) : 0;
+    if (c != 0) return c;
+    return (an > bn) - (an < bn);
+}
+
+static int key_pair_cmp(const void *pa, const void *pb) {
+    const key_pair *a = (const key_pair *)pa;
+    const key_pair *b = (const key_pair *)pb;
+    return bytes_cmp(a->key, a->key_len, b->key, b->key_len);
+}
+
+static auv_error_code encode_value(auv_key_buf *kb, const uint8_t *base, const uint8_t *p, size_t n,
+                                   size_t *used, int depth, auv_error *err);
+
+static auv_error_code encode_object(auv_key_buf *kb, const uint8_t *base, const auv_record *rec,
+                                    int depth, auv_error *err) {
+    /* pass 1: count pairs and check framing */
+    auv_iter it;
+    auv_record k, v;
+    size_t count = 0;
+    auv_iter_init(&it, base, rec);
+    while (!auv_iter_done(&it)) {
+        auv_error_code rc = auv_iter_next_pair(&it, &k, &v, err);
+        if (rc != AUV_OK) return rc;
+        count++;
+    }
+
+    key_pair local[16];
+    key_pair *pairs = local;
+    if (count > sizeof(local) / sizeof(local[0])) {
+        pairs = (key_pair *)ajis_alloc(kb->allocator, count * sizeof(key_pair));
+        if (!pairs) return set_err(err, AUV_ERR_OUT_OF_MEMORY, (size_t)(rec->payload - base), "object key table");
+    }
+
+    /* pass 2: collect (framing already validated) */
+    auv_iter_init(&it, base, rec);
+    for (size_t i = 0; i < count; i++) {
+        (void)auv_iter_next_pair(&it, &k, &v, NULL);
+        pairs[i].key = k.payload;
+        pairs[i].key_len = k.length;
+        pairs[i].value = auv_record_start(&v);
+        pairs[i].value_size = v.size;
+    }
+
+    /* canonical objects are already sorted; only sort when needed */
+    int sorted = 1;
+    for (size_t i = 1; i < count && sorted; i++) {
+        if (key_pair_cmp(&pairs[i - 1], &pairs[i]) >= 0) sorted = 0;
+    }
+    if (!sorted) qsort(pairs, count, sizeof(key_pair), key_pair_cmp);
+
+    auv_error_code rc = AUV_OK;
+    for (size_t i = 1; i < count; i++) {
+        if (key_pair_cmp(&pairs[i - 1], &pairs[i]) == 0) {
+            rc = set_err(err, AUV_ERR_DUPLICATE_KEY, (size_t)(pairs[i].key - base), "duplicate object key");
+            goto done;
+        }
+    }
+
+    put_byte(kb, type_byte(AUV_TAG_OBJECT));
+    for (size_t i = 0; i < count; i++) {
+        put_byte(kb, 0x01);
+        put_escaped(kb, pairs[i].key, pairs[i].key_len);
+    }
+    put_byte(kb, 0x00);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t used = 0;
+        rc = encode_value(kb, base, pairs[i].value, pairs[i].value_size, &used, depth + 1, err);
+        if (rc != AUV_OK) goto done;
+    }
+
+done:
+    if (pairs != local) ajis_free(kb->allocator, pairs, count * sizeof(key_pair));
+    return rc;
+}
+
+static auv_error_code encode_value(auv_key_buf *kb, const uint8_t *base, const uint8_t *p, size_t n,
+                                   size_t *used, int depth, auv_error *err) {
+    if (depth > AUV_MAX_DEPTH) return set_err(err, AUV_ERR_DEPTH_LIMIT, (size_t)(p - base), "nesting depth limit exceeded");
+
+    auv_record rec;
+    auv_error_code rc = auv_record_read(base, p, n, &rec, err);
+    if (rc != AUV_OK) return rc;
+    *used = rec.size;
+
+    switch (rec.tag) {
+        case AUV_TAG_NULL:
+            put_byte(kb, type_byte(AUV_TAG_NULL));
+            return AUV_OK;
+
+        case AUV_TAG_BOOL:
+            put_byte(kb, type_byte(AUV_TAG_BOOL));
+            put_byte(kb, rec.payload[0]);
+            return AUV_OK;
+
+        case AUV_TAG_INT64:
+            put_byte(kb, type_byte(AUV_TAG_INT64));
+            put_u64be(kb, int64_bits((int64_t)auv_load_u64le(rec.payload)));
+            return AUV_OK;
+
+        case AUV_TAG_FLOAT64:
+            put_byte(kb, type_byte(AUV_TAG_FLOAT64));
+            put_u64be(kb, float64_bits(auv_load_u64le(rec.payload)));
+            return AUV_OK;
+
+        case AUV_TAG_CHAR:
+            put_byte(kb, type_byte(AUV_TAG_CHAR));
+            put_u32be(kb, auv_load_u32le(rec.payload));
+            return AUV_OK;
+
+        case AUV_TAG_STRING:
+        case AUV_TAG_BINARY:
+            put_byte(kb, type_byte(rec.tag));
+            put_escaped(kb, rec.payload, rec.length);
+            return AUV_OK;
+
+        case AUV_TAG_ARRAY: {
+            put_byte(kb, type_byte(AUV_TAG_ARRAY));
+            auv_iter it;
+            auv_record child;
+            auv_iter_init(&it, base, &rec);
+            while (!auv_iter_done(&it)) {
+                size_t child_used = 0;
+                rc = auv_iter_next(&it, &child, err);
+                if (rc != AUV_OK) return rc;
+                rc = encode_value(kb, base, auv_record_start(&child), child.size, &child_used, depth + 1, err);
+                if (rc != AUV_OK) return rc;
+            }
+            put_byte(kb, 0x00);
+            return AUV_OK;
+        }
+
+        case AUV_TAG_OBJECT:
+            return encode_object(kb, base, &rec, depth, err);
+    }
+
+    return set_err(err, AUV_ERR_UNKNOWN_TAG, (size_t)(p - base), "unknown type tag");
+}
+
+/* ---------- public API ---------- */
+
+void auv_key_append_null(auv_key_buf *kb) {
+    put_byte(kb, type_byte(AUV_TAG_NULL));
+}
+
+void auv_key_append_bool(auv_key_buf *kb, int value) {
+    put_byte(kb, type_byte(AUV_TAG_BOOL));
+    put_byte(kb, value ? 0x01 : 0x00);
+}
+
+void auv_key_append_int64(auv_key_buf *kb, int64_t value) {
+    put_byte(kb, type_byte(AUV_TAG_INT64));
+    put_u64be(kb, int64_bits(value));
+}
+
+void auv_key_append_float64(auv_key_buf *kb, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_byte(kb, type_byte(AUV_TAG_FLOAT64));
+    put_u64be(kb, float64_bits(bits));
+}
+
+void auv_key_append_char(auv_key_buf *kb, uint32_t code_point) {
+    put_byte(kb, type_byte(AUV_TAG_CHAR));
+    put_u32be(kb, code_point);
+}
+
+void auv_key_append_string(auv_key_buf *kb, const uint8_t *utf8, size_t len) {
+    put_byte(kb, type_byte(AUV_TAG_STRING));
+    put_escaped(kb, utf8, len);
+}
+
+void auv_key_append_binary(auv_key_buf *kb, const uint8_t *bytes, size_t len) {
+    put_byte(kb, type_byte(AUV_TAG_BINARY));
+    put_escaped(kb, bytes, len);
+}
+
+auv_error_code auv_key_append_value(auv_key_buf *kb, const uint8_t *wire, size_t len, auv_error *err) {
+    auv_error_reset(err);
+    if (!kb || (!wire && len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+
+    size_t used = 0;
+    auv_error_code rc = encode_value(kb, wire, wire, len, &used, 1, err);
+    if (rc != AUV_OK) return rc;
+    if (used != len) return set_err(err, AUV_ERR_INVALID_LENGTH, used, "trailing bytes after value");
+    return AUV_OK;
+}
+
+auv_error_code auv_key_encode(const uint8_t *wire, size_t len, uint8_t *out, size_t out_cap, size_t *out_len, auv_error *err) {
+    return auv_key_encode_with(wire, len, out, out_cap, out_len, NULL, err);
+}
+
+auv_error_code auv_key_encode_with(const uint8_t *wire, size_t len, uint8_t *out, size_t out_cap, size_t *out_len,
+                                   const ajis_allocator *alloc, auv_error *err) {
+    auv_key_buf kb;
+    auv_key_buf_init(&kb, out, out_cap);
+    kb.allocator = alloc;
+
+    auv_error_code rc = auv_key_append_value(&kb, wire, len, err);
+    if (out_len) *out_len = kb.length;
+    if (rc != AUV_OK) return rc;
+
+    if (!auv_key_buf_fits(&kb)) return set_err(err, AUV_ERR_BUFFER_TOO_SMALL, 0, "key buffer too small");
+    return AUV_OK;
+}
@@ -0,0 +1,376 @@
+#include "../include/auv_seek.h"
+#include "../include/auv_hash.h"
+
+#include <stdlib.h>
+
+#define SEEK_HEADER_SIZE 40   /* fixed part before offsets */
+
+/* ---------- helpers ---------- */
+
+static auv_error_code set_err(auv_error *err, auv_error_code code, size_t offset, const char *ctx) {
+    if (err) {
+        err->code = code;
+        err->offset = offset;
+        err->context = ctx;
+    }
+    return code;
+}
+
+static void store_u64le(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static void store_u32le(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static int bytes_cmp(const uint8_t *a, size_t an, const uint8_t *b, size_t bn) {
+    size_t n = an < bn ? an : bn;
+    int c = n ? memcmp(a, b, n) : 0;
+    if (c != 0) return c;
+    return (an > bn) - (an < bn);
+}
+
+static void make_prefix(uint8_t out[AUV_SEEK_PREFIX_LEN], const uint8_t *key, size_t key_len) {
+    size_t n = key_len < AUV_SEEK_PREFIX_LEN ? key_len : AUV_SEEK_PREFIX_LEN;
+    memset(out, 0, AUV_SEEK_PREFIX_LEN);
+    if (n) memcpy(out, key, n);
+}
+
+static uint64_t sample_offset(const auv_seek_index *idx, uint64_t s) {
+    return auv_load_u64le(idx->offsets + s * 8);
+}
+
+/* Growable byte buffer used while scanning. */
+typedef struct grow_buf {
+    const ajis_allocator *alloc;
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} grow_buf;
+
+static int grow_append(grow_buf *g, const uint8_t *bytes, size_t n) {
+    if (g->len + n > g->cap) {
+        size_t cap = g->cap ? g->cap * 2 : 1024;
+        while (cap < g->len + n) cap *= 2;
+        uint8_t *p = (uint8_t *)ajis_realloc(g->alloc, g->data, g->cap, cap);
+        if (!p) return 0;
+        g->data = p;
+        g->cap = cap;
+    }
+    memcpy(g->data + g->len, bytes, n);
+    g->len += n;
+    return 1;
+}
+
+/* Read the container header and make sure it is the one the index was built for. */
+static auv_error_code open_container(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                                     auv_record *rec, auv_error *err) {
+    auv_error_code rc = auv_record_read(wire, wire, len, rec, err);
+    if (rc != AUV_OK) return rc;
+    if (rec->tag != idx->tag || rec->length != idx->payload_length) {
+        return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "seek index does not match container");
+    }
+    return AUV_OK;
+}
+
+/* Iterator positioned at sample `s` of the container payload. */
+static auv_error_code iter_at_sample(const auv_seek_index *idx, const uint8_t *wire, const auv_record *rec,
+                                     uint64_t s, auv_iter *it, auv_error *err) {
+    uint64_t off = sample_offset(idx, s);
+    if (off >= rec->length) return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "seek sample past container end");
+    auv_iter_init(it, wire, rec);
+    it->p = rec->payload + off;
+    return AUV_OK;
+}
+
+/* ---------- build ---------- */
+
+auv_error_code auv_seek_build(const uint8_t *wire, size_t len, uint32_t stride, auv_seek_index *out, auv_error *err) {
+    return auv_seek_build_with(wire, len, stride, NULL, out, err);
+}
+
+auv_error_code auv_seek_build_with(const uint8_t *wire, size_t len, uint32_t stride, const ajis_allocator *alloc,
+                                   auv_seek_index *out, auv_error *err) {
+    auv_error_reset(err);
+    if (!out || (!wire && len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+    memset(out, 0, sizeof(*out));
+    if (stride == 0) stride = AUV_SEEK_DEFAULT_STRIDE;
+
+    auv_record rec;
+    auv_error_code rc = auv_record_read(wire, wire, len, &rec, err);
+    if (rc != AUV_OK) return rc;
+    if (rec.size != len) return set_err(err, AUV_ERR_INVALID_LENGTH, rec.size, "trailing bytes after value");
+    if (rec.tag != AUV_TAG_ARRAY && rec.tag != AUV_TAG_OBJECT) {
+        return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "seek index needs an array or object");
+    }
+
+    int is_object = rec.tag == AUV_TAG_OBJECT;
+    grow_buf offs = {0}, prefs = {0};
+    offs.alloc = prefs.alloc = alloc;
+    uint64_t count = 0;
+    uint32_t flags = is_object ? AUV_SEEK_SORTED_KEYS : 0;
+    const uint8_t *prev_key = NULL;
+    size_t prev_len = 0;
+
+    auv_iter it;
+    auv_record k, v;
+    auv_iter_init(&it, wire, &rec);
+    while (!auv_iter_done(&it)) {
+        const uint8_t *child = it.p;
+
+        if (is_object) rc = auv_iter_next_pair(&it, &k, &v, err);
+        else rc = auv_iter_next(&it, &v, err);
+        if (rc != AUV_OK) goto fail;
+
+        if (count % stride == 0) {
+            uint8_t le[8];
+            store_u64le(le, (uint64_t)(child - rec.payload));
+            if (!grow_append(&offs, le, 8)) goto oom;
+            if (is_object) {
+                uint8_t pfx[AUV_SEEK_PREFIX_LEN];
+                make_prefix(pfx, k.payload, k.length);
+                if (!grow_append(&prefs, pfx, AUV_SEEK_PREFIX_LEN)) goto oom;
+            }
+        }
+
+        if (is_object) {
+            if (prev_key && bytes_cmp(prev_key, prev_len, k.payload, k.length) >= 0) flags &= ~AUV_SEEK_SORTED_KEYS;
+            prev_key = k.payload;
+            prev_len = k.length;
+        }
+        count++;
+    }
+
+    /* one owned block: offsets followed by prefixes */
+    uint64_t samples = offs.len / 8;
+    size_t block_size = offs.len + prefs.len + 1;
+    uint8_t *block = (uint8_t *)ajis_alloc(alloc, block_size);
+    if (!block) goto oom;
+    if (offs.len) memcpy(block, offs.data, offs.len);
+    if (prefs.len) memcpy(block + offs.len, prefs.data, prefs.len);
+    ajis_free(alloc, prefs.data, prefs.cap);
+    ajis_free(alloc, offs.data, offs.cap);
+
+    out->tag = rec.tag;
+    out->flags = flags;
+    out->stride = stride;
+    out->count = count;
+    out->payload_length = rec.length;
+    out->sample_count = samples;
+    out->offsets = block;
+    out->prefixes = is_object ? block + samples * 8 : NULL;
+    out->owned = block;
+    out->owned_size = block_size;
+    out->allocator = alloc;
+    return AUV_OK;
+
+oom:
+    rc = set_err(err, AUV_ERR_OUT_OF_MEMORY, 0, "seek index samples");
+fail:
+    ajis_free(alloc, prefs.data, prefs.cap);
+    ajis_free(alloc, offs.data, offs.cap);
+    return rc;
+}
+
+void auv_seek_free(auv_seek_index *idx) {
+    if (!idx) return;
+    ajis_free(idx->allocator, idx->owned, idx->owned_size);
+    memset(idx, 0, sizeof(*idx));
+}
+
+/* ---------- queries ---------- */
+
+static auv_error_code seek_pair(const auv_seek_index *idx, const uint8_t *wire, size_t len, uint64_t i,
+                                auv_record *key, auv_record *value, auv_error *err) {
+    auv_error_reset(err);
+    if (!idx || !wire) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+    if (i >= idx->count) return set_err(err, AUV_ERR_OUT_OF_RANGE, 0, "index past container end");
+
+    auv_record rec;
+    auv_error_code rc = open_container(idx, wire, len, &rec, err);
+    if (rc != AUV_OK) return rc;
+
+    auv_iter it;
+    rc = iter_at_sample(idx, wire, &rec, i / idx->stride, &it, err);
+    if (rc != AUV_OK) return rc;
+
+    auv_record k = {AUV_TAG_NULL, NULL, 0, 0};
+    for (uint64_t skip = i % idx->stride; ; skip--) {
+        if (idx->tag == AUV_TAG_OBJECT) rc = auv_iter_next_pair(&it, &k, value, err);
+        else rc = auv_iter_next(&it, value, err);
+        if (rc != AUV_OK) return rc;
+        if (skip == 0) break;
+    }
+    if (key) *key = k;
+    return AUV_OK;
+}
+
+auv_error_code auv_seek_at(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                           uint64_t i, auv_record *out, auv_error *err) {
+    return seek_pair(idx, wire, len, i, NULL, out, err);
+}
+
+auv_error_code auv_seek_key_at(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                               uint64_t i, auv_record *out, auv_error *err) {
+    if (idx && idx->tag != AUV_TAG_OBJECT) return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "keys exist only on objects");
+    auv_record value;
+    return seek_pair(idx, wire, len, i, out, &value, err);
+}
+
+/* Compare sample `s` key against the probe: prefix first, full key only on a tie. */
+static auv_error_code sample_cmp(const auv_seek_index *idx, const uint8_t *wire, const auv_record *rec, uint64_t s,
+                                 const uint8_t *pfx, const uint8_t *key, size_t key_len, int *out, auv_error *err) {
+    int c = memcmp(idx->prefixes + s * AUV_SEEK_PREFIX_LEN, pfx, AUV_SEEK_PREFIX_LEN);
+    if (c != 0) {
+        *out = c;
+        return AUV_OK;
+    }
+
+    auv_iter it;
+    auv_record k;
+    auv_error_code rc = iter_at_sample(idx, wire, rec, s, &it, err);
+    if (rc != AUV_OK) return rc;
+    rc = auv_iter_next(&it, &k, err);
+    if (rc != AUV_OK) return rc;
+    *out = bytes_cmp(k.payload, k.length, key, key_len);
+    return AUV_OK;
+}
+
+auv_error_code auv_seek_find(const auv_seek_index *idx, const uint8_t *wire, size_t len,
+                             const uint8_t *key, size_t key_len, int *found, auv_record *out, auv_error *err) {
+    auv_error_reset(err);
+    if (!idx || !wire || !found || !out || (!key && key_len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+    *found = 0;
+    if (idx->tag != AUV_TAG_OBJECT) return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "key lookup needs an object");
+
+    auv_record rec;
+    auv_error_code rc = open_container(idx, wire, len, &rec, err);
+    if (rc != AUV_OK) return rc;
+    if (idx->count == 0) return AUV_OK;
+
+    auv_iter it;
+    auv_record k, v;
+    int sorted = (idx->flags & AUV_SEEK_SORTED_KEYS) != 0;
+
+    if (sorted) {
+        /* last sample whose key <= probe */
+        uint8_t pfx[AUV_SEEK_PREFIX_LEN];
+        make_prefix(pfx, key, key_len);
+
+        uint64_t lo = 0, hi = idx->sample_count; /* answer in [lo-1, hi) */
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            int c;
+            rc = sample_cmp(idx, wire, &rec, mid, pfx, key, key_len, &c, err);
+            if (rc != AUV_OK) return rc;
+            if (c == 0) {
+                lo = mid + 1;
+                hi = mid + 1;
+                break;
+            }
+            if (c < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        if (lo == 0) return AUV_OK; /* probe sorts below the first key */
+
+        rc = iter_at_sample(idx, wire, &rec, lo - 1, &it, err);
+        if (rc != AUV_OK) return rc;
+    } else {
+        auv_iter_init(&it, wire, &rec);
+    }
+
+    uint64_t budget = sorted ? idx->stride : idx->count;
+    while (budget-- > 0 && !auv_iter_done(&it)) {
+        rc = auv_iter_next_pair(&it, &k, &v, err);
+        if (rc != AUV_OK) return rc;
+
+        int c = bytes_cmp(k.payload, k.length, key, key_len);
+        if (c == 0) {
+            *found = 1;
+            *out = v;
+            return AUV_OK;
+        }
+        if (sorted && c > 0) break;
+    }
+    return AUV_OK;
+}
+
+/* ---------- persistence ---------- */
+
+size_t auv_seek_serialized_size(const auv_seek_index *idx) {
+    size_t per_sample = idx->prefixes ? 8 + AUV_SEEK_PREFIX_LEN : 8;
+    return SEEK_HEADER_SIZE + (size_t)idx->sample_count * per_sample + 8;
+}
+
+auv_error_code auv_seek_serialize(const auv_seek_index *idx, uint8_t *out, size_t cap, size_t *out_len, auv_error *err) {
+    auv_error_reset(err);
+    if (!idx) return set_err(err, AUV_ERR_TRUNCATED, 0, "no index");
+
+    size_t need = auv_seek_serialized_size(idx);
+    if (out_len) *out_len = need;
+    if (!out || cap < need) return set_err(err, AUV_ERR_BUFFER_TOO_SMALL, 0, "seek index buffer too small");
+
+    memcpy(out, "AUVS", 4);
+    out[4] = 1;
+    out[5] = (uint8_t)idx->tag;
+    out[6] = (uint8_t)idx->flags;
+    out[7] = (uint8_t)(idx->flags >> 8);
+    store_u32le(out + 8, idx->stride);
+    store_u32le(out + 12, 0);
+    store_u64le(out + 16, idx->count);
+    store_u64le(out + 24, idx->payload_length);
+    store_u64le(out + 32, idx->sample_count);
+
+    size_t at = SEEK_HEADER_SIZE;
+    size_t off_bytes = (size_t)idx->sample_count * 8;
+    if (off_bytes) memcpy(out + at, idx->offsets, off_bytes);
+    at += off_bytes;
+    if (idx->prefixes) {
+        size_t pfx_bytes = (size_t)idx->sample_count * AUV_SEEK_PREFIX_LEN;
+        if (pfx_bytes) memcpy(out + at, idx->prefixes, pfx_bytes);
+        at += pfx_bytes;
+    }
+    store_u64le(out + at, auv_hash_bytes(out, at, 0));
+    return AUV_OK;
+}
+
+auv_error_code auv_seek_load(const uint8_t *bytes, size_t len, auv_seek_index *out, auv_error *err) {
+    auv_error_reset(err);
+    if (!out || (!bytes && len)) return set_err(err, AUV_ERR_TRUNCATED, 0, "no input");
+    memset(out, 0, sizeof(*out));
+
+    if (len < SEEK_HEADER_SIZE + 8) return set_err(err, AUV_ERR_TRUNCATED, 0, "seek index too short");
+    if (memcmp(bytes, "AUVS", 4) != 0 || bytes[4] != 1) return set_err(err, AUV_ERR_INDEX_MISMATCH, 0, "not a v1 seek index");
+
+    auv_tag tag = (auv_tag)bytes[5];
+    if (tag != AUV_TAG_ARRAY && tag != AUV_TAG_OBJECT) return set_err(err, AUV_ERR_INDEX_MISMATCH, 5, "bad container tag");
+
+    uint32_t stride = auv_load_u32le(bytes + 8);
+    uint64_t count = auv_load_u64le(bytes + 16);
+    uint64_t samples = auv_load_u64le(bytes + 32);
+    if (stride == 0 || samples != (count + stride - 1) / stride) {
+        return set_err(err, AUV_ERR_INDEX_MISMATCH, 8, "inconsistent sample count");
+    }
+
+    uint64_t per_sample = tag == AUV_TAG_OBJECT ? 8 + AUV_SEEK_PREFIX_LEN : 8;
+    if (samples > (len - SEEK_HEADER_SIZE - 8) / per_sample || SEEK_HEADER_SIZE + samples * per_sample + 8 != len) {
+        return set_err(err, AUV_ERR_TRUNCATED, 32, "seek index length mismatch");
+    }
+
+    size_t body = len - 8;
+    if (auv_hash_bytes(bytes, body, 0) != auv_load_u64le(bytes + body)) {
+        return set_err(err, AUV_ERR_INDEX_MISMATCH, body, "seek index checksum mismatch");
+    }
+
+    out->tag = tag;
+    out->flags = (uint32_t)bytes[6] | ((uint32_t)bytes[7] << 8);
+    out->stride = stride;
+    out->count = count;
+    out->payload_length = auv_load_u64le(bytes + 24);
+    out->sample_count = samples;
+    out->offsets = bytes + SEEK_HEADER_SIZE;
+    out->prefixes = tag == AUV_TAG_OBJECT ? out->offsets + samples * 8 : NULL;
+    out->owned = NULL;
+    return AUV_OK;
+}
@@ -0,0 +1,106 @@
+#include "../include/auv_wire.h"
+
+/* ---------- helpers ---------- */
+
+static auv_error_code set_err(auv_error *err, auv_error_code code, size_t offset, const char *ctx) {
+    if (err) {
+        err->code = code;
+        err->offset = offset;
+        err->context = ctx;
+    }
+    return code;
+}
+
+/* ---------- public API ---------- */
+
+auv_error_code auv_varuint_read(const uint8_t *p, size_t n, uint64_t *out_value, size_t *out_used) {
+    uint64_t v = 0;
+    unsigned shift = 0;
+
+    for (size_t i = 0; i < n && i < 10; i++) {
+        uint8_t b = p[i];
+
+        /* the 10th byte may only carry the top bit of a 64-bit value */
+        if (i == 9 && b > 0x01) return AUV_ERR_INVALID_LENGTH;
+
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            /* shortest form: a trailing zero group is only allowed for the value 0 */
+            if (b == 0 && i > 0) return AUV_ERR_NONMINIMAL_VARUINT;
+            *out_value = v;
+            *out_used = i + 1;
+            return AUV_OK;
+        }
+        shift += 7;
+    }
+
+    return (n < 10) ? AUV_ERR_TRUNCATED : AUV_ERR_INVALID_LENGTH;
+}
+
+auv_error_code auv_record_read(const uint8_t *base, const uint8_t *p, size_t n, auv_record *out, auv_error *err) {
+    size_t at = (size_t)(p - base);
+
+    if (n == 0) return set_err(err, AUV_ERR_TRUNCATED, at, "missing type tag");
+
+    uint8_t tag = p[0];
+    if (tag > AUV_TAG_OBJECT) return set_err(err, AUV_ERR_UNKNOWN_TAG, at, "unknown type tag");
+
+    uint64_t len = 0;
+    size_t used = 0;
+    auv_error_code rc = auv_varuint_read(p + 1, n - 1, &len, &used);
+    if (rc != AUV_OK) return set_err(err, rc, at + 1, "bad record length");
+
+    size_t header = 1 + used;
+    if (len > (uint64_t)(n - header)) return set_err(err, AUV_ERR_TRUNCATED, at, "payload overruns buffer");
+
+    const uint8_t *payload = p + header;
+
+    switch ((auv_tag)tag) {
+        case AUV_TAG_NULL:
+            if (len != 0) return set_err(err, AUV_ERR_INVALID_LENGTH, at, "null must have length 0");
+            break;
+        case AUV_TAG_BOOL:
+            if (len != 1) return set_err(err, AUV_ERR_INVALID_LENGTH, at, "bool must have length 1");
+            if (payload[0] > 1) return set_err(err, AUV_ERR_INVALID_BOOL, at + header, "bool payload must be 0 or 1");
+            break;
+        case AUV_TAG_INT64:
+        case AUV_TAG_FLOAT64:
+            if (len != 8) return set_err(err, AUV_ERR_INVALID_LENGTH, at, "int64/float64 must have length 8");
+            break;
+        case AUV_TAG_CHAR: {
+            if (len != 4) return set_err(err, AUV_ERR_INVALID_LENGTH, at, "char must have length 4");
+            uint32_t cp = auv_load_u32le(payload);
+            if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                return set_err(err, AUV_ERR_INVALID_CHAR, at + header, "char is not a Unicode scalar value");
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    out->tag = (auv_tag)tag;
+    out->payload = payload;
+    out->length = (size_t)len;
+    out->size = header + (size_t)len;
+    return AUV_OK;
+}
+
+auv_error_code auv_iter_next(auv_iter *it, auv_record *out, auv_error *err) {
+    auv_error_code rc = auv_record_read(it->base, it->p, (size_t)(it->end - it->p), out, err);
+    if (rc != AUV_OK) return rc;
+    it->p += out->size;
+    return AUV_OK;
+}
+
+auv_error_code auv_iter_next_pair(auv_iter *it, auv_record *key, auv_record *value, auv_error *err) {
+    auv_error_code rc = auv_iter_next(it, key, err);
+    if (rc != AUV_OK) return rc;
+    if (key->tag != AUV_TAG_STRING) {
+        return set_err(err, AUV_ERR_KEY_NOT_STRING, (size_t)(auv_record_start(key) - it->base), "object key must be a string");
+    }
+    if (auv_iter_done(it)) {
+        return set_err(err, AUV_ERR_MISSING_VALUE, (size_t)(it->p - it->base), "object key without value");
+    }
+    return auv_iter_next(it, value, err);
+}
@@ -0,0 +1,263 @@
+/* Drives libajis.so the way a managed host does: dlopen, dlsym, flat buffers only. */
+
+#include "../include/ajis_abi.h"
+#include "../include/auv_wire.h"
+#include "test_common.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+typedef uint32_t (*version_fn)(void);
+typedef const char* (*status_name_fn)(int32_t);
+typedef int32_t (*tokenize_fn)(const uint8_t*, uint64_t, uint64_t, uint32_t, ajis_abi_token*, uint64_t, ajis_abi_result*);
+typedef int32_t (*validate_fn)(const uint8_t*, uint64_t, uint32_t, ajis_abi_result*);
+typedef int32_t (*to_auv_fn)(const uint8_t*, uint64_t, uint32_t, uint8_t*, uint64_t, ajis_abi_result*);
+
+static version_fn p_version;
+static status_name_fn p_status_name;
+static tokenize_fn p_tokenize;
+static validate_fn p_validate;
+static to_auv_fn p_to_auv;
+
+/* Both calls of the sizing protocol; returns a malloc'd record. */
+static uint8_t* to_auv(const char* doc, uint32_t flags, size_t* size, ajis_abi_result* res) {
+    const uint8_t* d = (const uint8_t*)doc;
+    if (p_to_auv(d, strlen(doc), flags, NULL, 0, res) != AJIS_ABI_OK) return NULL;
+    TEST_ASSERT(res->more == 1 && res->written == 0, "sizing call writes nothing");
+    uint8_t* out = (uint8_t*)malloc(res->next);
+    *size = (size_t)res->next;
+    TEST_ASSERT(p_to_auv(d, strlen(doc), flags, out, *size, res) == AJIS_ABI_OK && res->more == 0 && res->written == *size,
+                "second call fills the buffer");
+    return out;
+}
+
+static int is_string(const auv_record* r, const char* s) {
+    return r->tag == AUV_TAG_STRING && r->length == strlen(s) && memcmp(r->payload, s, r->length) == 0;
+}
+
+/* Member `name` of an object record. */
+static int member(const uint8_t* base, const auv_record* obj, const char* name, auv_record* out) {
+    auv_iter it;
+    auv_iter_init(&it, base, obj);
+    while (!auv_iter_done(&it)) {
+        auv_record k, v;
+        if (auv_iter_next_pair(&it, &k, &v, NULL) != AUV_OK) return 0;
+        if (is_string(&k, name)) {
+            *out = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int64_t as_i64(const auv_record* r) {
+    return (int64_t)auv_load_u64le(r->payload);
+}
+
+static double as_f64(const auv_record* r) {
+    uint64_t bits = auv_load_u64le(r->payload);
+    double d;
+    memcpy(&d, &bits, 8);
+    return d;
+}
+
+/* ---------------- Threads ---------------- */
+
+typedef struct Job {
+    const char* doc;
+    const uint8_t* want;
+    size_t want_size;
+    int ok;
+} Job;
+
+static void* job_run(void* arg) {
+    Job* j = (Job*)arg;
+    j->ok = 1;
+    for (int i = 0; i < 200 && j->ok; i++) {
+        ajis_abi_result res;
+        size_t n = 0;
+        uint8_t* out = to_auv(j->doc, AJIS_ABI_CANONICAL, &n, &res);
+        j->ok = out && n == j->want_size && memcmp(out, j->want, n) == 0;
+        free(out);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "./bin/libajis.so";
+    void* lib = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!lib) {
+        fprintf(stderr, "dlopen %s: %s\n", path, dlerror());
+        return 1;
+    }
+    p_version = (version_fn)dlsym(lib, "ajis_abi_version");
+    p_status_name = (status_name_fn)dlsym(lib, "ajis_abi_status_name");
+    p_tokenize = (tokenize_fn)dlsym(lib, "ajis_abi_tokenize");
+    p_validate = (validate_fn)dlsym(lib, "ajis_abi_validate");
+    p_to_auv = (to_auv_fn)dlsym(lib, "ajis_abi_to_auv");
+    TEST_ASSERT(p_version && p_status_name && p_tokenize && p_validate && p_to_auv, "entry points exported");
+    TEST_ASSERT(dlsym(lib, "ajis_lexer_next") == NULL, "internals stay hidden");
+    TEST_ASSERT(p_version() >> 16 == AJIS_ABI_VERSION_MAJOR, "ABI major");
+    TEST_ASSERT(strcmp(p_status_name(0), "OK") == 0, "status names");
+    g_checks += 4;
+    printf("[PASS] library loaded (ABI %u.%u)\n", p_version() >> 16, p_version() & 0xFFFF);
+
+    /* tokenize */
+    {
+        const char* doc = "{\"a\": [1, 2.5, true],\n \"b\": \"x\\ny\" /* c */, \"c\": hex\"00ff\"}";
+        const uint8_t* d = (const uint8_t*)doc;
+        size_t len = strlen(doc);
+        ajis_abi_token all[64];
+        ajis_abi_result res;
+        TEST_ASSERT(p_tokenize(d, len, 0, 0, all, 64, &res) == AJIS_ABI_OK && res.more == 0 && res.written == 19, "one call");
+        TEST_ASSERT(all[0].type == 1 && all[0].offset == 0 && all[1].type == 7 && all[1].offset == 2 && all[1].length == 1 &&
+                        all[18].type == 2, "packed tokens");
+        TEST_ASSERT(all[13].type == 7 && memcmp(doc + all[13].offset, "x\\ny", all[13].length) == 0, "string body");
+        TEST_ASSERT(all[17].type == 12 && all[17].length == 9, "binary literal");
+
+        /* a small array: resume until done */
+        ajis_abi_token part[5];
+        uint64_t start = 0, got = 0;
+        int calls = 0, same = 1;
+        do {
+            TEST_ASSERT(p_tokenize(d, len, start, 0, part, 5, &res) == AJIS_ABI_OK, "resumed call");
+            for (uint64_t i = 0; i < res.written; i++) {
+                same &= memcmp(&part[i], &all[got + i], sizeof(ajis_abi_token)) == 0;
+            }
+            got += res.written;
+            start = res.next;
+            calls++;
+        } while (res.more);
+        TEST_ASSERT(same && got == 19 && calls == 4, "resumed run equals one call");
+
+        TEST_ASSERT(p_tokenize(d, len, 0, 0, all, 19, &res) == AJIS_ABI_OK && res.more == 0, "exact fit is not 'more'");
+        TEST_ASSERT(p_tokenize((const uint8_t*)"[1,\n @]", 7, 3, 0, part, 5, &res) != AJIS_ABI_OK && res.error_line == 2 &&
+                        res.error_column == 2 && res.written == 0, "error after a resume, located");
+        g_checks += 7;
+        printf("[PASS] tokenize\n");
+    }
+
+    /* validate */
+    {
+        ajis_abi_result res;
+        const char* ok = "{\"a\": 1, \"a\": 2}";
+        TEST_ASSERT(p_validate((const uint8_t*)ok, strlen(ok), 0, &res) == AJIS_ABI_OK, "valid");
+        TEST_ASSERT(p_validate((const uint8_t*)ok, strlen(ok), AJIS_ABI_REJECT_DUPLICATE_KEYS, &res) != AJIS_ABI_OK,
+                    "duplicate keys on request");
+        const char* bad = "[1,\n 2,]";
+        int32_t rc = p_validate((const uint8_t*)bad, strlen(bad), 0, &res);
+        TEST_ASSERT(rc != AJIS_ABI_OK && rc == res.status && res.error_line == 2 && res.error_column == 4, "error located");
+        TEST_ASSERT(strcmp(p_status_name(rc), "Trailing comma") == 0, "status name");
+        g_checks += 4;
+        printf("[PASS] validate\n");
+    }
+
+    /* AJIS -> AUV */
+    {
+        const char* doc =
+            "{\"z\": 1_000, \"a\": [-7, 2.5, 1e400, 0xFF, null, true, \"\\u00e9\\t\"],\n"
+            " \"bin\": hex\"DEADbeef\", \"b64\": b64\"SGVsbG8=\", \"big\": 18446744073709551616, \"o\": {}}";
+        ajis_abi_result res;
+        size_t n = 0;
+        uint8_t* auv = to_auv(doc, 0, &n, &res);
+        TEST_ASSERT(auv == NULL && res.status != AJIS_ABI_OK && res.error_line == 1 && res.error_column == 29,
+                    "out-of-range float is an error");
+        doc =
+            "{\"z\": 1_000, \"a\": [-7, 2.5, 1e300, 0xFF, null, true, \"\\u00e9\\t\"],\n"
+            " \"bin\": hex\"DEADbeef\", \"b64\": b64\"SGVsbG8=\", \"big\": 18446744073709551616, \"o\": {}}";
+        auv = to_auv(doc, 0, &n, &res);
+        TEST_ASSERT(auv != NULL, "transcode");
+
+        auv_record root, v, e;
+        TEST_ASSERT(auv_record_read(auv, auv, n, &root, NULL) == AUV_OK && root.size == n && root.tag == AUV_TAG_OBJECT, "one object record");
+        auv_iter it;
+        auv_iter_init(&it, auv, &root);
+        auv_record k0, v0;
+        TEST_ASSERT(auv_iter_next_pair(&it, &k0, &v0, NULL) == AUV_OK && is_string(&k0, "z") && as_i64(&v0) == 1000, "document order, int64");
+
+        TEST_ASSERT(member(auv, &root, "a", &v) && v.tag == AUV_TAG_ARRAY, "array");
+        auv_iter_init(&it, auv, &v);
+        int64_t want_tags[] = { AUV_TAG_INT64, AUV_TAG_FLOAT64, AUV_TAG_FLOAT64, AUV_TAG_INT64, AUV_TAG_NULL, AUV_TAG_BOOL, AUV_TAG_STRING };
+        int elems_ok = 1;
+        for (int i = 0; i < 7; i++) {
+            elems_ok &= auv_iter_next(&it, &e, NULL) == AUV_OK && e.tag == (auv_tag)want_tags[i];
+            if (i == 0) elems_ok &= as_i64(&e) == -7;
+            if (i == 1) elems_ok &= as_f64(&e) == 2.5;
+            if (i == 3) elems_ok &= as_i64(&e) == 255;
+            if (i == 5) elems_ok &= e.payload[0] == 1;
+            if (i == 6) elems_ok &= is_string(&e, "\xc3\xa9\t");
+        }
+        TEST_ASSERT(elems_ok && auv_iter_done(&it), "scalars");
+        TEST_ASSERT(member(auv, &root, "bin", &v) && v.tag == AUV_TAG_BINARY && v.length == 4 && memcmp(v.payload, "\xde\xad\xbe\xef", 4) == 0,
+                    "hex binary");
+        TEST_ASSERT(member(auv, &root, "b64", &v) && v.tag == AUV_TAG_BINARY && v.length == 5 && memcmp(v.payload, "Hello", 5) == 0,
+                    "base64 binary");
+        TEST_ASSERT(member(auv, &root, "big", &v) && v.tag == AUV_TAG_FLOAT64 && as_f64(&v) == 18446744073709551616.0, "past int64: float64");
+        TEST_ASSERT(member(auv, &root, "o", &v) && v.tag == AUV_TAG_OBJECT && v.length == 0, "empty object");
+        free(auv);
+
+        /* canonical: keys sorted at every level, bytes otherwise equal */
+        const char* a = "{\"b\": 1, \"a\": {\"y\": [1, {\"d\": 0, \"c\": 0}], \"x\": 2}, \"\\u00e9\": 0, \"A\": 0}";
+        const char* b = "{\"A\": 0, \"a\": {\"x\": 2, \"y\": [1, {\"c\": 0, \"d\": 0}]}, \"b\": 1, \"\xc3\xa9\": 0}";
+        size_t na, nb;
+        uint8_t* ca = to_auv(a, AJIS_ABI_CANONICAL, &na, &res);
+        uint8_t* cb = to_auv(b, 0, &nb, &res);
+        TEST_ASSERT(ca && cb && na == nb && memcmp(ca, cb, na) == 0, "canonical key order");
+
+        /* errors */
+        struct { const char* doc; uint32_t column; } bad[] = {
+            { "{\"k\": 1, \"k\": 2}", 10 },
+            { "{\"k\": 1, \"\\u006b\": 2}", 10 },
+            { "[\"\xff\"]", 2 },
+            { "[\"\xed\xa0\x80\"]", 2 },
+            { "b64\"SGVsbG8=x\"", 1 },
+            { "[1, 2] 3", 8 },
+        };
+        int errs_ok = 1;
+        for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+            int32_t rc = p_to_auv((const uint8_t*)bad[i].doc, strlen(bad[i].doc), 0, NULL, 0, &res);
+            if (rc == AJIS_ABI_OK || res.error_column != bad[i].column) {
+                fprintf(stderr, "%s: %s at column %u\n", bad[i].doc, p_status_name(rc), res.error_column);
+                errs_ok = 0;
+            }
+        }
+        TEST_ASSERT(errs_ok, "duplicate keys, bad UTF-8, bad base64, trailing content");
+
+        /* nesting at the AUV limit */
+        char deep[600];
+        size_t d = 0;
+        for (int i = 0; i < 257; i++) deep[d++] = '[';
+        for (int i = 0; i < 257; i++) deep[d++] = ']';
+        TEST_ASSERT(p_to_auv((const uint8_t*)deep, d, 0, NULL, 0, &res) != AJIS_ABI_OK, "depth 257 rejected");
+        TEST_ASSERT(p_to_auv((const uint8_t*)deep + 1, d - 2, 0, NULL, 0, &res) == AJIS_ABI_OK, "depth 256 accepted");
+
+        /* the library is stateless: concurrent calls agree */
+        Job jobs[4];
+        pthread_t th[4];
+        for (int i = 0; i < 4; i++) {
+            jobs[i].doc = a;
+            jobs[i].want = ca;
+            jobs[i].want_size = na;
+            pthread_create(&th[i], NULL, job_run, &jobs[i]);
+        }
+        int threads_ok = 1;
+        for (int i = 0; i < 4; i++) {
+            pthread_join(th[i], NULL);
+            threads_ok &= jobs[i].ok;
+        }
+        TEST_ASSERT(threads_ok, "concurrent calls");
+        free(ca);
+        free(cb);
+        g_checks += 14;
+        printf("[PASS] to_auv\n");
+    }
+
+    dlclose(lib);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
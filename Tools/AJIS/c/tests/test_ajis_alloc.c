@@ -0,0 +1,318 @@
+#include "../include/ajis_alloc.h"
+#include "../include/ajis_file.h"
+#include "../include/ajis_pool.h"
+#include "../include/ajis_validate.h"
+#include "../include/auv_hash.h"
+#include "../include/auv_key.h"
+#include "../include/auv_seek.h"
+#include "test_auv_common.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+/* ---------------- Counting allocator ---------------- */
+
+typedef struct Counter {
+    size_t allocs;      /* alloc + growing realloc calls */
+    size_t frees;
+    size_t live_bytes;
+    int fail;           /* return NULL from alloc */
+} Counter;
+
+static void* c_alloc(void* ctx, size_t size) {
+    Counter* c = (Counter*)ctx;
+    if (c->fail) return NULL;
+    c->allocs++;
+    c->live_bytes += size;
+    return malloc(size ? size : 1);
+}
+
+static void* c_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    Counter* c = (Counter*)ctx;
+    if (c->fail) return NULL;
+    c->allocs++;
+    c->live_bytes += new_size - old_size;
+    return realloc(ptr, new_size ? new_size : 1);
+}
+
+static void c_free(void* ctx, void* ptr, size_t size) {
+    Counter* c = (Counter*)ctx;
+    c->frees++;
+    c->live_bytes -= size;
+    free(ptr);
+}
+
+static ajis_allocator counting(Counter* c) {
+    memset(c, 0, sizeof(*c));
+    ajis_allocator a = { c_alloc, c_realloc, c_free, c };
+    return a;
+}
+
+/* ---------------- Documents ---------------- */
+
+/* Object with `keys` members, nested `depth` arrays deep. */
+static char* make_doc(size_t keys, size_t depth, size_t* out_len) {
+    size_t cap = keys * 24 + depth * 2 + 16;
+    char* s = (char*)malloc(cap);
+    TEST_ASSERT(s != NULL, "out of memory");
+    size_t n = 0;
+    for (size_t i = 0; i < depth; i++) s[n++] = '[';
+    s[n++] = '{';
+    for (size_t i = 0; i < keys; i++) n += (size_t)snprintf(s + n, cap - n, "%s\"k%zu\": %zu", i ? ", " : "", i, i);
+    s[n++] = '}';
+    for (size_t i = 0; i < depth; i++) s[n++] = ']';
+    *out_len = n;
+    return s;
+}
+
+static void pool_task(size_t index, unsigned worker, void* ctx) {
+    (void)worker;
+    (void)index;
+    __atomic_fetch_add((size_t*)ctx, 1, __ATOMIC_RELAXED);
+}
+
+int main(void) {
+    /* arena basics */
+    {
+        Counter c;
+        ajis_allocator parent = counting(&c);
+        ajis_arena arena;
+        ajis_arena_init(&arena, &parent, 1024);
+        const ajis_allocator* a = &arena.allocator;
+
+        uint8_t* p = (uint8_t*)ajis_alloc(a, 10);
+        uint8_t* q = (uint8_t*)ajis_alloc(a, 1);
+        TEST_ASSERT(p && q && c.allocs == 1, "one chunk for small blocks");
+        TEST_ASSERT(((uintptr_t)p % AJIS_ALLOC_ALIGN) == 0 && ((uintptr_t)q % AJIS_ALLOC_ALIGN) == 0, "aligned");
+        TEST_ASSERT(q == p + AJIS_ALLOC_ALIGN, "bump");
+
+        /* most recent block grows in place */
+        memset(q, 0xAB, 1);
+        uint8_t* q2 = (uint8_t*)ajis_realloc(a, q, 1, 500);
+        TEST_ASSERT(q2 == q && q2[0] == 0xAB, "grow in place");
+
+        /* older block moves, contents kept */
+        memcpy(p, "0123456789", 10);
+        uint8_t* p2 = (uint8_t*)ajis_realloc(a, p, 10, 100);
+        TEST_ASSERT(p2 && p2 != p && memcmp(p2, "0123456789", 10) == 0, "grow by copy");
+
+        /* freeing the most recent block gives the space back */
+        ajis_free(a, p2, 100);
+        uint8_t* r = (uint8_t*)ajis_alloc(a, 100);
+        TEST_ASSERT(r == p2, "pop most recent");
+
+        /* overflow into more chunks, then reset folds them into one */
+        for (int i = 0; i < 40; i++) TEST_ASSERT(ajis_alloc(a, 200) != NULL, "alloc");
+        TEST_ASSERT(arena.chunk_count > 1, "several chunks");
+        size_t held = ajis_arena_capacity(&arena);
+        ajis_arena_reset(&arena);
+        TEST_ASSERT(arena.chunk_count == 1 && ajis_arena_capacity(&arena) == held, "one merged chunk");
+
+        size_t before = c.allocs;
+        uint8_t* first = NULL;
+        for (int round = 0; round < 100; round++) {
+            uint8_t* x = (uint8_t*)ajis_alloc(a, 10);
+            if (!first) first = x;
+            TEST_ASSERT(x == first, "reset reuses the same memory");
+            (void)ajis_realloc(a, ajis_alloc(a, 16), 16, 500);
+            for (int i = 0; i < 40; i++) (void)ajis_alloc(a, 200);
+            ajis_arena_reset(&arena);
+        }
+        TEST_ASSERT(c.allocs == before, "no system allocation after warm-up");
+
+        TEST_ASSERT(ajis_alloc(a, SIZE_MAX - 4) == NULL, "overflow rejected");
+        ajis_arena_destroy(&arena);
+        TEST_ASSERT(c.live_bytes == 0 && c.frees == c.allocs, "arena returns everything");
+        g_checks += 14;
+        printf("[PASS] arena: bump, in-place growth, reset and reuse\n");
+    }
+
+    /* size-class pool */
+    {
+        Counter c;
+        ajis_allocator parent = counting(&c);
+        ajis_slab_pool pool;
+        ajis_slab_pool_init(&pool, &parent);
+        const ajis_allocator* a = &pool.allocator;
+
+        void* x = ajis_alloc(a, 24);
+        void* y = ajis_alloc(a, 32);
+        TEST_ASSERT(x && y && (char*)y == (char*)x + 32, "same class, adjacent blocks");
+        TEST_ASSERT(((uintptr_t)x % AJIS_ALLOC_ALIGN) == 0, "aligned");
+        ajis_free(a, x, 24);
+        TEST_ASSERT(ajis_alloc(a, 20) == x, "freed block reused");
+
+        void* z = ajis_alloc(a, 100);
+        TEST_ASSERT(pool.slab_count == 2, "one slab per class");
+        memcpy(z, "pool", 4);
+        void* z2 = ajis_realloc(a, z, 100, 120);
+        TEST_ASSERT(z2 == z, "realloc within class stays");
+        void* z3 = ajis_realloc(a, z2, 120, 300);
+        TEST_ASSERT(z3 != z2 && memcmp(z3, "pool", 4) == 0, "realloc across classes copies");
+
+        size_t before = c.allocs;
+        void* big = ajis_alloc(a, 10000);
+        TEST_ASSERT(big && c.allocs == before + 1, "large blocks go to the parent");
+        big = ajis_realloc(a, big, 10000, 20000);
+        ajis_free(a, big, 20000);
+
+        /* churn stays inside the slabs */
+        before = c.allocs;
+        void* blocks[256];
+        for (int round = 0; round < 50; round++) {
+            for (int i = 0; i < 256; i++) blocks[i] = ajis_alloc(a, (size_t)(16 + (i * 37) % 2000));
+            for (int i = 0; i < 256; i++) ajis_free(a, blocks[i], (size_t)(16 + (i * 37) % 2000));
+        }
+        size_t after_first = c.allocs;
+        for (int round = 0; round < 50; round++) {
+            for (int i = 0; i < 256; i++) blocks[i] = ajis_alloc(a, (size_t)(16 + (i * 37) % 2000));
+            for (int i = 0; i < 256; i++) ajis_free(a, blocks[i], (size_t)(16 + (i * 37) % 2000));
+        }
+        TEST_ASSERT(c.allocs == after_first && after_first > before, "warm pool needs no new slabs");
+
+        ajis_slab_pool_destroy(&pool);
+        TEST_ASSERT(c.live_bytes == 0, "pool returns every slab");
+        g_checks += 9;
+        printf("[PASS] size-class pool\n");
+    }
+
+    /* validate: zero system allocations per document in steady state */
+    {
+        Counter c;
+        ajis_allocator parent = counting(&c);
+        ajis_arena arena;
+        ajis_arena_init(&arena, &parent, 0);
+
+        ajis_validate_options o = ajis_validate_options_default();
+        o.reject_duplicate_keys = 1;
+        o.max_depth = 4096;                 /* depth stack beyond the inline words */
+        o.allocator = &arena.allocator;
+
+        size_t len_small, len_big;
+        char* small = make_doc(50, 10, &len_small);
+        char* big = make_doc(20000, 1000, &len_big);
+
+        ajis_error err;
+        TEST_ASSERT(ajis_validate(big, len_big, &o, &err) == AJIS_OK, "big document valid");
+        ajis_arena_reset(&arena);
+        size_t warm = c.allocs;
+        TEST_ASSERT(warm >= 1, "arena took memory from the parent");
+
+        for (int i = 0; i < 200; i++) {
+            const char* doc = (i % 3) ? small : big;
+            size_t len = (i % 3) ? len_small : len_big;
+            TEST_ASSERT(ajis_validate(doc, len, &o, &err) == AJIS_OK, "document valid");
+            ajis_arena_reset(&arena);
+        }
+        TEST_ASSERT(c.allocs == warm, "steady state: no system allocation per document");
+
+        /* errors still surface through the arena path */
+        const char* dup = "{\"a\": 1, \"a\": 2}";
+        TEST_ASSERT(ajis_validate(dup, strlen(dup), &o, &err) == AJIS_ERR_DUPLICATE_KEY, "duplicate key");
+        ajis_arena_reset(&arena);
+
+        ajis_arena_destroy(&arena);
+        TEST_ASSERT(c.live_bytes == 0, "nothing leaked");
+
+        /* a failing allocator is reported, not crashed on */
+        Counter dead;
+        ajis_allocator none = counting(&dead);
+        dead.fail = 1;
+        o.allocator = &none;
+        TEST_ASSERT(ajis_validate(small, len_small, &o, &err) == AJIS_ERR_SIZE_LIMIT, "allocation failure reported");
+
+        /* default allocator still works */
+        o.allocator = NULL;
+        TEST_ASSERT(ajis_validate(small, len_small, &o, &err) == AJIS_OK, "malloc default");
+
+        free(small);
+        free(big);
+        g_checks += 7;
+        printf("[PASS] ajis_validate through an arena: %zu system allocation(s) total\n", warm);
+    }
+
+    /* AUV APIs route their scratch through the allocator */
+    {
+        Counter c;
+        ajis_allocator a = counting(&c);
+
+        /* unsorted object with more pairs than the inline tables hold */
+        Wire items[40];
+        for (int i = 0; i < 20; i++) {
+            char k[4] = { 'k', (char)('a' + (19 - i)), 0, 0 };
+            items[2 * i] = v_str(k, 2);
+            items[2 * i + 1] = v_int(i);
+        }
+        Wire obj = v_container(AUV_TAG_OBJECT, items, 40);
+
+        size_t key_len = 0;
+        uint8_t key[1024];
+        auv_error aerr;
+        TEST_ASSERT(auv_key_encode_with(obj.data, obj.len, key, sizeof(key), &key_len, &a, &aerr) == AUV_OK, "key encode");
+        TEST_ASSERT(c.allocs == 1 && c.live_bytes == 0, "key sort scratch from the allocator");
+
+        /* same pairs, reversed order */
+        Wire rev[40];
+        for (int i = 0; i < 20; i++) {
+            rev[2 * i] = items[2 * (19 - i)];
+            rev[2 * i + 1] = items[2 * (19 - i) + 1];
+        }
+        Wire obj2 = v_container(AUV_TAG_OBJECT, rev, 40);
+        int eq = 0;
+        TEST_ASSERT(auv_equal_with(obj.data, obj.len, obj2.data, obj2.len, 0, &a, &eq, &aerr) == AUV_OK && eq == 1, "equal");
+        TEST_ASSERT(c.allocs == 2 && c.live_bytes == 0, "lookup table from the allocator");
+
+        auv_seek_index idx;
+        TEST_ASSERT(auv_seek_build_with(obj.data, obj.len, 2, &a, &idx, &aerr) == AUV_OK, "seek build");
+        TEST_ASSERT(idx.count == 20 && c.live_bytes == idx.owned_size, "only the index block stays live");
+        auv_record rec;
+        TEST_ASSERT(auv_seek_at(&idx, obj.data, obj.len, 7, &rec, &aerr) == AUV_OK, "seek at");
+        auv_seek_free(&idx);
+        TEST_ASSERT(c.live_bytes == 0 && c.frees == c.allocs, "index freed through the allocator");
+
+        g_checks += 8;
+        printf("[PASS] auv key / equality / seek with a custom allocator\n");
+    }
+
+    /* file scratch and thread pool */
+    {
+        Counter c;
+        ajis_allocator a = counting(&c);
+
+        const char* path = "test_ajis_alloc.tmp";
+        FILE* f = fopen(path, "wb");
+        TEST_ASSERT(f != NULL, "create temp file");
+        fputs("[1, 2, 3]", f);
+        fclose(f);
+
+        ajis_file_buffer scratch;
+        ajis_file_buffer_init_with(&scratch, &a);
+        for (int i = 0; i < 10; i++) {
+            ajis_file_view view;
+            TEST_ASSERT(ajis_file_open(&view, path, &scratch) == 0, "open");
+            TEST_ASSERT(view.length == 9 && memcmp(view.data, "[1, 2, 3]", 9) == 0, "contents");
+            ajis_file_close(&view);
+        }
+        TEST_ASSERT(c.allocs == 1, "scratch allocated once");
+        ajis_file_buffer_free(&scratch);
+        TEST_ASSERT(c.live_bytes == 0, "scratch freed through the allocator");
+        remove(path);
+
+        size_t ran = 0;
+        TEST_ASSERT(ajis_pool_run_with(1000, 4, pool_task, &ran, &a) == 0 && ran == 1000, "pool run");
+        TEST_ASSERT(c.allocs == 2 && c.live_bytes == 0, "pool bookkeeping is one block");
+
+        c.fail = 1;
+        TEST_ASSERT(ajis_pool_run_with(1000, 4, pool_task, &ran, &a) != 0, "pool reports allocation failure");
+
+        g_checks += 7;
+        printf("[PASS] file scratch and thread pool with a custom allocator\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
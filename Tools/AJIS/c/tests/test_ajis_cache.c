@@ -0,0 +1,278 @@
+#include "../include/ajis_cache.h"
+#include "../include/ajis_auv.h"
+#include "test_common.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static const char *k_src = "ajis_cache_test.ajis";
+static const char *k_side = "ajis_cache_test.ajis.auvc";
+
+static void write_bytes(const char *path, const void *data, size_t len) {
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT(f != NULL, "cannot create temp file");
+    TEST_ASSERT(fwrite(data, 1, len, f) == len, "write temp file");
+    fclose(f);
+}
+
+static long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n;
+}
+
+/* XORs `mask` into the byte at `at` of `path`. */
+static void flip(const char *path, long at, int mask) {
+    FILE *f = fopen(path, "r+b");
+    TEST_ASSERT(f != NULL, "open for patching");
+    fseek(f, at, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, at, SEEK_SET);
+    fputc(c ^ mask, f);
+    fclose(f);
+}
+
+/* Reference AUV bytes of `doc`. */
+static uint8_t *transcode(const char *doc, int canonical, size_t *len) {
+    ajis_auv_options o = ajis_auv_options_default();
+    o.canonical = canonical;
+    size_t need = 0;
+    TEST_ASSERT(ajis_to_auv(doc, strlen(doc), &o, NULL, 0, &need, NULL) == AJIS_OK, "reference transcode");
+    uint8_t *p = (uint8_t *)malloc(need);
+    TEST_ASSERT(ajis_to_auv(doc, strlen(doc), &o, p, need, len, NULL) == AJIS_OK, "reference transcode");
+    return p;
+}
+
+/* Loads k_src and checks it against `doc`; returns `hit`. */
+static int load_check(const char *doc, const ajis_cache_options *o, int *stored) {
+    ajis_cached c;
+    ajis_error err;
+    TEST_ASSERT(ajis_cache_load(k_src, o, &c, &err) == AJIS_OK, "load");
+    size_t n;
+    uint8_t *want = transcode(doc, (o->flags & AJIS_CACHE_CANONICAL) != 0, &n);
+    TEST_ASSERT(c.auv_length == n && memcmp(c.auv, want, n) == 0, "same bytes as ajis_to_auv()");
+    free(want);
+    int hit = c.hit;
+    if (stored) *stored = c.stored;
+    ajis_cached_close(&c);
+    return hit;
+}
+
+/* ---------------- Threads missing on one cold sidecar ---------------- */
+
+#define RACERS 8
+
+typedef struct Race {
+    pthread_barrier_t start;
+    const uint8_t *want;
+    size_t want_len;
+    int missed;
+    int stored;
+    int failed;
+} Race;
+
+/* One cold load, then hits while the other racers may still be writing: every one must be whole. */
+static void *race_worker(void *arg) {
+    Race *r = (Race *)arg;
+    ajis_cache_options o = ajis_cache_options_default();
+    pthread_barrier_wait(&r->start);
+    for (int i = 0; i < 20; i++) {
+        ajis_cached c;
+        if (ajis_cache_load(k_src, &o, &c, NULL) != AJIS_OK) {
+            __atomic_store_n(&r->failed, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        if (c.auv_length != r->want_len || memcmp(c.auv, r->want, r->want_len) != 0) {
+            __atomic_store_n(&r->failed, 1, __ATOMIC_RELAXED);
+        }
+        if (!c.hit) __atomic_add_fetch(&r->missed, 1, __ATOMIC_RELAXED);
+        if (c.stored) __atomic_add_fetch(&r->stored, 1, __ATOMIC_RELAXED);
+        ajis_cached_close(&c);
+    }
+    return NULL;
+}
+
+/* Temp files left next to the sidecar. */
+static int temp_files(void) {
+    DIR *d = opendir(".");
+    if (!d) return -1;
+    size_t n = strlen(k_side);
+    int count = 0;
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        if (strncmp(e->d_name, k_side, n) == 0 && strncmp(e->d_name + n, ".tmp.", 5) == 0) count++;
+    }
+    closedir(d);
+    return count;
+}
+
+int main(void) {
+    const char *doc = "{\"name\": \"catalog\", \"items\": [1, 2.5, \"x\", hex\"00ff\", null], \"b\": true}";
+    ajis_cache_options o = ajis_cache_options_default();
+    int stored = 0;
+    remove(k_side);
+
+    /* miss, then hit */
+    write_bytes(k_src, doc, strlen(doc));
+    TEST_ASSERT(load_check(doc, &o, &stored) == 0 && stored, "first load transcodes and stores");
+    TEST_ASSERT(file_size(k_side) > 64, "sidecar written");
+    TEST_ASSERT(load_check(doc, &o, NULL) == 1, "second load hits");
+    g_checks += 3;
+    printf("[PASS] miss then hit\n");
+
+    /* same length, different content: the hash notices */
+    const char *doc2 = "{\"name\": \"catalog\", \"items\": [1, 2.5, \"y\", hex\"00ff\", null], \"b\": true}";
+    write_bytes(k_src, doc2, strlen(doc2));
+    TEST_ASSERT(load_check(doc2, &o, &stored) == 0 && stored, "edited source misses");
+    TEST_ASSERT(load_check(doc2, &o, NULL) == 1, "and hits again after the rewrite");
+    g_checks += 2;
+    printf("[PASS] content hash\n");
+
+    /* other options miss */
+    ajis_cache_options canon = o;
+    canon.flags |= AJIS_CACHE_CANONICAL;
+    TEST_ASSERT(load_check(doc2, &canon, NULL) == 0, "canonical misses a document-order sidecar");
+    TEST_ASSERT(load_check(doc2, &canon, NULL) == 1, "canonical hits its own");
+    ajis_cache_options lex = canon;
+    lex.lexer.allow_multiline_strings = 1;
+    TEST_ASSERT(load_check(doc2, &lex, NULL) == 0, "lexer options are part of the key");
+    g_checks += 3;
+    printf("[PASS] options\n");
+
+    /* damaged sidecars */
+    TEST_ASSERT(load_check(doc2, &o, NULL) == 0, "rewrite");
+    flip(k_side, 20, 0x01);
+    TEST_ASSERT(load_check(doc2, &o, NULL) == 0, "damaged header misses");
+    ajis_cache_options verify = o;
+    verify.flags |= AJIS_CACHE_VERIFY;
+    TEST_ASSERT(load_check(doc2, &verify, NULL) == 1, "intact payload verifies");
+    flip(k_side, file_size(k_side) - 3, 0x20);  /* inside the last key */
+    TEST_ASSERT(load_check(doc2, &verify, NULL) == 0, "damaged payload fails verification");
+    write_bytes(k_side, "AJSC", 4);
+    TEST_ASSERT(load_check(doc2, &o, NULL) == 0, "truncated sidecar misses");
+    g_checks += 5;
+    printf("[PASS] damaged sidecars\n");
+
+    /* seek index kept with the value */
+    {
+        size_t cap = 64 + 2000 * 24;
+        char *big = (char *)malloc(cap);
+        size_t n = 0;
+        big[n++] = '{';
+        for (int i = 0; i < 2000; i++) n += (size_t)sprintf(big + n, "%s\"key%05d\": %d", i ? ", " : "", i, i * 3);
+        big[n++] = '}';
+        big[n] = 0;
+        write_bytes(k_src, big, n);
+
+        ajis_cache_options so = canon;
+        so.flags |= AJIS_CACHE_SEEK;
+        so.seek_stride = 16;
+        int seek_ok = 1;
+        for (int pass = 0; pass < 2; pass++) {
+            ajis_cached c;
+            TEST_ASSERT(ajis_cache_load(k_src, &so, &c, NULL) == AJIS_OK && c.hit == pass, "load with seek index");
+            seek_ok &= c.has_seek && c.seek.stride == 16 && c.seek.count == 2000 && (c.seek.flags & AUV_SEEK_SORTED_KEYS);
+            int found = 0;
+            auv_record v;
+            seek_ok &= auv_seek_find(&c.seek, c.auv, c.auv_length, (const uint8_t *)"key01234", 8, &found, &v, NULL) == AUV_OK &&
+                       found && v.tag == AUV_TAG_INT64 && auv_load_u64le(v.payload) == 1234 * 3;
+            ajis_cached_close(&c);
+        }
+        TEST_ASSERT(seek_ok, "seek index round-trips through the sidecar");
+        so.seek_stride = 32;
+        TEST_ASSERT(load_check(big, &so, NULL) == 0, "another stride misses");
+
+        /* scalar root: nothing to index */
+        write_bytes(k_src, "42", 2);
+        ajis_cached c;
+        TEST_ASSERT(ajis_cache_load(k_src, &so, &c, NULL) == AJIS_OK && !c.has_seek && c.stored, "scalar root");
+        ajis_cached_close(&c);
+        TEST_ASSERT(ajis_cache_load(k_src, &so, &c, NULL) == AJIS_OK && c.hit && !c.has_seek, "scalar root hits");
+        ajis_cached_close(&c);
+        free(big);
+        g_checks += 4;
+        printf("[PASS] seek index\n");
+    }
+
+    /* several threads miss on the same cold sidecar: each writes its own temp file */
+    {
+        size_t cap = 64 + 20000 * 24;
+        char *big = (char *)malloc(cap);
+        TEST_ASSERT(big != NULL, "out of memory");
+        size_t n = 0;
+        big[n++] = '[';
+        for (int i = 0; i < 20000; i++) n += (size_t)sprintf(big + n, "%s\"item%05d\"", i ? ", " : "", i);
+        big[n++] = ']';
+        big[n] = 0;
+        write_bytes(k_src, big, n);
+
+        Race r;
+        memset(&r, 0, sizeof(r));
+        uint8_t *want = transcode(big, 0, &r.want_len);
+        r.want = want;
+        int verified = 1;
+        for (int round = 0; round < 10 && !r.failed; round++) {
+            remove(k_side);
+            TEST_ASSERT(pthread_barrier_init(&r.start, NULL, RACERS) == 0, "barrier");
+            pthread_t th[RACERS];
+            for (int i = 0; i < RACERS; i++) TEST_ASSERT(pthread_create(&th[i], NULL, race_worker, &r) == 0, "pthread_create");
+            for (int i = 0; i < RACERS; i++) pthread_join(th[i], NULL);
+            pthread_barrier_destroy(&r.start);
+
+            ajis_cache_options verify = o;
+            verify.flags |= AJIS_CACHE_VERIFY;
+            ajis_cached c;
+            if (ajis_cache_load(k_src, &verify, &c, NULL) != AJIS_OK || !c.hit) verified = 0;
+            ajis_cached_close(&c);
+        }
+        TEST_ASSERT(!r.failed, "every racer gets the document");
+        TEST_ASSERT(r.stored > 0 && r.stored == r.missed, "every miss stores its own temp file");
+        TEST_ASSERT(verified, "the sidecar left behind is whole");
+        TEST_ASSERT(temp_files() == 0, "no temp files left behind");
+        free(want);
+        free(big);
+        g_checks += 4;
+        printf("[PASS] %d threads on a cold sidecar\n", RACERS);
+    }
+
+    /* read-only and unwritable locations still load */
+    remove(k_side);
+    write_bytes(k_src, doc, strlen(doc));
+    ajis_cache_options ro = o;
+    ro.flags |= AJIS_CACHE_READ_ONLY;
+    TEST_ASSERT(load_check(doc, &ro, &stored) == 0 && !stored && file_size(k_side) < 0, "read-only writes nothing");
+    ajis_cache_options elsewhere = o;
+    elsewhere.cache_path = "no/such/dir/x.auvc";
+    TEST_ASSERT(load_check(doc, &elsewhere, &stored) == 0 && !stored, "unwritable sidecar is not an error");
+    g_checks += 2;
+    printf("[PASS] sidecar not written\n");
+
+    /* errors */
+    {
+        ajis_cached c;
+        ajis_error err;
+        write_bytes(k_src, "{\"a\": 1,\n \"a\": 2}", 17);
+        TEST_ASSERT(ajis_cache_load(k_src, &o, &c, &err) == AJIS_ERR_DUPLICATE_KEY && err.location.line == 2 &&
+                        err.location.column == 2 && c.auv == NULL,
+                    "document error located in the source");
+        TEST_ASSERT(file_size(k_side) < 0, "no sidecar for a bad document");
+        TEST_ASSERT(ajis_cache_load("does/not/exist.ajis", &o, &c, &err) == AJIS_ERR_UNKNOWN && c.io_error == ENOENT,
+                    "missing source");
+        g_checks += 3;
+        printf("[PASS] errors\n");
+    }
+
+    remove(k_src);
+    remove(k_side);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
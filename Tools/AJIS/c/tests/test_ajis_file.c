@@ -0,0 +1,60 @@
+#include "../include/ajis_file.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static void write_file(const char *path, size_t len) {
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT(f != NULL, "cannot create temp file");
+    for (size_t i = 0; i < len; i++) fputc('a' + (int)(i % 26), f);
+    fclose(f);
+}
+
+static void check_size(const char *path, size_t len, ajis_file_buffer *scratch, int expect_mapped) {
+    write_file(path, len);
+
+    ajis_file_view v;
+    TEST_ASSERT(ajis_file_open(&v, path, scratch) == 0, "open");
+    TEST_ASSERT(v.length == len, "length");
+    for (size_t i = 0; i < len; i += 4093) {
+        TEST_ASSERT(v.data[i] == (uint8_t)('a' + (int)(i % 26)), "content");
+    }
+    for (size_t i = 0; i < AJIS_FILE_PADDING; i++) {
+        TEST_ASSERT(v.data[len + i] == 0, "zero padding after the last byte");
+    }
+    if (expect_mapped >= 0) {
+        TEST_ASSERT((v.map != NULL) == expect_mapped, "mmap vs buffered choice");
+    }
+    ajis_file_close(&v);
+    remove(path);
+    g_checks += 4;
+    printf("[PASS] size=%zu (%s)\n", len, expect_mapped > 0 ? "mapped" : expect_mapped == 0 ? "buffered" : "either");
+}
+
+int main(void) {
+    const char *path = "ajis_file_test.tmp";
+    ajis_file_buffer scratch;
+    ajis_file_buffer_init(&scratch);
+
+    check_size(path, 0, &scratch, 0);
+    check_size(path, 1, &scratch, 0);
+    check_size(path, 1000, &scratch, 0);
+    check_size(path, AJIS_FILE_MMAP_MIN + 100, &scratch, -1);   /* mapped where the page tail allows */
+    check_size(path, 4 * 1024 * 1024, &scratch, 0);             /* page multiple: no room for padding */
+    check_size(path, 4 * 1024 * 1024 - 10, &scratch, 0);        /* tail too short for the padding */
+    check_size(path, 3 * 1024 * 1024 + 777, &scratch, 1);
+    check_size(path, 200, &scratch, 0);                         /* reuses the grown scratch buffer */
+
+    ajis_file_view v;
+    TEST_ASSERT(ajis_file_open(&v, "does/not/exist.ajis", &scratch) != 0, "missing file reports errno");
+    TEST_ASSERT(ajis_file_open(&v, ".", &scratch) != 0, "directory rejected");
+    g_checks += 2;
+
+    ajis_file_buffer_free(&scratch);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
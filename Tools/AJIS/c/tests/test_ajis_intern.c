@@ -0,0 +1,371 @@
+#include "../include/ajis_auv.h"
+#include "../include/ajis_intern.h"
+#include "../include/ajis_string.h"
+#include "../include/ajis_validate.h"
+#include "test_common.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+#define U8(s) ((const uint8_t*)(s))
+
+static int unescape_eq(const char* raw, unsigned flags, const char* want, size_t want_len) {
+    uint8_t out[256];
+    size_t n = 0;
+    if (ajis_string_unescape(U8(raw), strlen(raw), flags, out, &n, NULL) != AJIS_OK) return 0;
+    return n == want_len && memcmp(out, want, n) == 0;
+}
+
+/* ---------------- Shared table workers ---------------- */
+
+#define VOCAB 300
+#define THREADS 4
+
+typedef struct Shared {
+    ajis_intern_table* table;
+    ajis_symbol seen[THREADS][VOCAB];
+    size_t hits[THREADS];
+    int failed;
+} Shared;
+
+typedef struct Job {
+    Shared* sh;
+    int id;
+} Job;
+
+static void* intern_worker(void* arg) {
+    Job* job = (Job*)arg;
+    Shared* sh = job->sh;
+    ajis_intern_cache* cache = (ajis_intern_cache*)malloc(sizeof(ajis_intern_cache));
+    if (!cache) {
+        sh->failed = 1;
+        return NULL;
+    }
+    ajis_intern_cache_init(cache, sh->table);
+
+    char key[32];
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < VOCAB; i++) {
+            int k = (i * 7 + job->id * 31 + round) % VOCAB;
+            int n = snprintf(key, sizeof(key), "field_%d", k);
+            ajis_symbol sym;
+            if (ajis_intern_cache_raw(cache, U8(key), (size_t)n, 0, &sym) != AJIS_OK) sh->failed = 1;
+            if (sh->seen[job->id][k] && sh->seen[job->id][k] != sym) sh->failed = 1;
+            sh->seen[job->id][k] = sym;
+        }
+    }
+    sh->hits[job->id] = cache->hits;
+    free(cache);
+    return NULL;
+}
+
+/* ---------------- Allocator that is not thread-safe ---------------- */
+
+/* malloc, counting calls that overlap another: the table must serialise them */
+typedef struct Exclusive {
+    int busy;
+    int overlaps;
+} Exclusive;
+
+static void enter(Exclusive* x) {
+    if (__atomic_exchange_n(&x->busy, 1, __ATOMIC_ACQUIRE)) __atomic_add_fetch(&x->overlaps, 1, __ATOMIC_RELAXED);
+    for (volatile int spin = 0; spin < 2000; spin++) {
+    }
+}
+
+static void leave(Exclusive* x) {
+    __atomic_store_n(&x->busy, 0, __ATOMIC_RELEASE);
+}
+
+static void* excl_alloc(void* ctx, size_t size) {
+    enter((Exclusive*)ctx);
+    void* p = malloc(size);
+    leave((Exclusive*)ctx);
+    return p;
+}
+
+static void* excl_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)old_size;
+    enter((Exclusive*)ctx);
+    void* p = realloc(ptr, new_size);
+    leave((Exclusive*)ctx);
+    return p;
+}
+
+static void excl_free(void* ctx, void* ptr, size_t size) {
+    (void)size;
+    enter((Exclusive*)ctx);
+    free(ptr);
+    leave((Exclusive*)ctx);
+}
+
+/* long escaped keys (their decoding needs a heap buffer) and rank tables, all at once */
+static void* scratch_worker(void* arg) {
+    Job* job = (Job*)arg;
+    Shared* sh = job->sh;
+    char key[400];
+    for (int round = 0; round < 300; round++) {
+        int k = (round * 13 + job->id * 7) % 50;
+        int n = snprintf(key, sizeof(key), "\\u0061%0320d", k);
+        ajis_symbol sym;
+        if (ajis_intern_raw(sh->table, U8(key), (size_t)n, 0, &sym) != AJIS_OK) sh->failed = 1;
+        uint32_t ranks[64];
+        if (round % 4 == 0 && ajis_intern_ranks(sh->table, ranks, 64) == 0) sh->failed = 1;
+    }
+    return NULL;
+}
+
+int main(void) {
+    /* unescape */
+    {
+        TEST_ASSERT(unescape_eq("plain", 0, "plain", 5), "plain");
+        TEST_ASSERT(unescape_eq("a\\\"b\\\\c\\/d", 0, "a\"b\\c/d", 7), "simple escapes");
+        TEST_ASSERT(unescape_eq("\\b\\f\\n\\r\\t", 0, "\b\f\n\r\t", 5), "control escapes");
+        TEST_ASSERT(unescape_eq("\\u0041\\u00e9\\u20AC", 0, "A\xC3\xA9\xE2\x82\xAC", 6), "\\u to UTF-8");
+        TEST_ASSERT(unescape_eq("\\uD83D\\uDE00", 0, "\xF0\x9F\x98\x80", 4), "surrogate pair");
+        TEST_ASSERT(unescape_eq("\\u0000", 0, "\0", 1), "NUL");
+        TEST_ASSERT(unescape_eq("C:\\Users\\Dir", AJIS_UNESCAPE_KEEP_UNKNOWN, "C:\\Users\\Dir", 12), "unknown kept");
+
+        size_t at = 0, n = 0;
+        uint8_t out[64];
+        TEST_ASSERT(ajis_string_unescape(U8("ab\\x"), 4, 0, out, &n, &at) == AJIS_ERR_INVALID_ESCAPE && at == 2, "unknown escape rejected");
+        TEST_ASSERT(ajis_string_unescape(U8("x\\uD800"), 7, 0, out, &n, &at) == AJIS_ERR_INVALID_ESCAPE && at == 1, "lone high surrogate");
+        TEST_ASSERT(ajis_string_unescape(U8("\\uDC00"), 6, 0, out, &n, &at) == AJIS_ERR_INVALID_ESCAPE, "lone low surrogate");
+        TEST_ASSERT(ajis_string_unescape(U8("\\u12"), 4, AJIS_UNESCAPE_KEEP_UNKNOWN, out, &n, &at) == AJIS_ERR_INVALID_ESCAPE, "short \\u");
+        TEST_ASSERT(ajis_string_unescape(U8("end\\"), 4, 0, out, &n, &at) == AJIS_ERR_INVALID_ESCAPE && at == 3, "trailing backslash");
+
+        char buf[] = "x\\ty\\u0041z";
+        TEST_ASSERT(ajis_string_unescape(U8(buf), strlen(buf), 0, (uint8_t*)buf, &n, NULL) == AJIS_OK &&
+                    n == 5 && memcmp(buf, "x\tyAz", 5) == 0, "in place");
+        TEST_ASSERT(ajis_string_is_plain(U8("abc"), 3) && !ajis_string_is_plain(U8("a\\n"), 3), "plain check");
+        g_checks += 14;
+        printf("[PASS] string unescape\n");
+    }
+
+    /* per-thread table */
+    {
+        ajis_intern_table t;
+        TEST_ASSERT(ajis_intern_init(&t, NULL, 0) == AJIS_OK, "init");
+
+        ajis_symbol a = ajis_intern_bytes(&t, U8("alpha"), 5);
+        ajis_symbol b = ajis_intern_bytes(&t, U8("beta"), 4);
+        TEST_ASSERT(a == 1 && b == 2, "dense symbols from 1");
+        TEST_ASSERT(ajis_intern_bytes(&t, U8("alpha"), 5) == a, "same key, same symbol");
+        TEST_ASSERT(ajis_intern_find(&t, U8("beta"), 4) == b && ajis_intern_find(&t, U8("gamma"), 5) == AJIS_SYMBOL_NONE, "find");
+
+        size_t len = 0;
+        const uint8_t* s = ajis_intern_str(&t, b, &len);
+        TEST_ASSERT(s && len == 4 && memcmp(s, "beta", 5) == 0, "str is NUL-terminated");
+        TEST_ASSERT(ajis_intern_str(&t, 0, NULL) == NULL && ajis_intern_str(&t, 99, NULL) == NULL, "unknown symbols");
+
+        /* raw spans: escapes are decoded before interning */
+        ajis_symbol r;
+        TEST_ASSERT(ajis_intern_raw(&t, U8("\\u0061lpha"), 10, 0, &r) == AJIS_OK && r == a, "escaped key matches plain");
+        TEST_ASSERT(ajis_intern_raw(&t, U8("al\\x"), 4, 0, &r) == AJIS_ERR_INVALID_ESCAPE && r == AJIS_SYMBOL_NONE, "bad escape");
+        TEST_ASSERT(ajis_intern_raw(&t, U8(""), 0, 0, &r) == AJIS_OK && ajis_intern_str(&t, r, &len) && len == 0, "empty key");
+
+        char longkey[600];
+        memset(longkey, 'k', sizeof(longkey));
+        memcpy(longkey + 500, "\\u0041", 6);
+        ajis_symbol l1, l2;
+        TEST_ASSERT(ajis_intern_raw(&t, U8(longkey), sizeof(longkey), 0, &l1) == AJIS_OK, "long escaped key");
+        longkey[500] = 'A';
+        memmove(longkey + 501, longkey + 506, sizeof(longkey) - 506);
+        TEST_ASSERT(ajis_intern_raw(&t, U8(longkey), sizeof(longkey) - 5, 0, &l2) == AJIS_OK && l1 == l2, "long key decoded");
+
+        /* many keys: index growth and several pages */
+        const int many = 100000;
+        char key[32];
+        int ok = 1;
+        uint32_t base = ajis_intern_count(&t);
+        for (int i = 0; i < many; i++) {
+            int n = snprintf(key, sizeof(key), "k%07d", (i * 7919) % many);
+            ajis_symbol sym = ajis_intern_bytes(&t, U8(key), (size_t)n);
+            if (sym != base + (uint32_t)i + 1) ok = 0;
+        }
+        TEST_ASSERT(ok && ajis_intern_count(&t) == base + (uint32_t)many, "100000 distinct keys");
+        for (int i = 0; i < many && ok; i++) {
+            int n = snprintf(key, sizeof(key), "k%07d", (i * 7919) % many);
+            const uint8_t* back = ajis_intern_str(&t, base + (uint32_t)i + 1, &len);
+            if (!back || len != (size_t)n || memcmp(back, key, len) != 0) ok = 0;
+            if (ajis_intern_find(&t, U8(key), (size_t)n) != base + (uint32_t)i + 1) ok = 0;
+        }
+        TEST_ASSERT(ok, "every symbol maps back");
+
+        /* ranks follow byte order */
+        size_t need = ajis_intern_ranks(&t, NULL, 0);
+        TEST_ASSERT(need == ajis_intern_count(&t) + 1u, "ranks size");
+        uint32_t* ranks = (uint32_t*)malloc(need * sizeof(uint32_t));
+        TEST_ASSERT(ranks && ajis_intern_ranks(&t, ranks, need) == need, "ranks");
+        int ordered = 1;
+        for (ajis_symbol x = 1; x < need && ordered; x += 97) {
+            for (ajis_symbol y = 1; y < need; y += 1009) {
+                size_t lx, ly;
+                const uint8_t* sx = ajis_intern_str(&t, x, &lx);
+                const uint8_t* sy = ajis_intern_str(&t, y, &ly);
+                size_t m = lx < ly ? lx : ly;
+                int c = m ? memcmp(sx, sy, m) : 0;
+                if (c == 0) c = (lx > ly) - (lx < ly);
+                int rc = (ranks[x] > ranks[y]) - (ranks[x] < ranks[y]);
+                if ((c > 0) - (c < 0) != rc) ordered = 0;
+            }
+        }
+        TEST_ASSERT(ordered && ranks[0] == 0, "rank order equals byte order");
+
+        /* a document's own symbols, repeats included: dense ranks in the same order */
+        ajis_symbol picked[] = {9000, 3, 77777, 3, 41, 9000, 3, 100000};
+        uint32_t sub[8];
+        memcpy(sub, picked, sizeof(sub));
+        TEST_ASSERT(ajis_intern_rank_symbols(&t, sub, 8) == AJIS_OK, "rank symbols");
+        uint32_t top = 0;
+        for (int i = 0; i < 8 && ordered; i++) {
+            if (sub[i] > top) top = sub[i];
+            for (int j = 0; j < 8; j++) {
+                int full = (ranks[picked[i]] > ranks[picked[j]]) - (ranks[picked[i]] < ranks[picked[j]]);
+                if ((sub[i] > sub[j]) - (sub[i] < sub[j]) != full) ordered = 0;
+            }
+        }
+        TEST_ASSERT(ordered && top == 5, "document ranks follow byte order");
+        free(ranks);
+
+        ajis_intern_destroy(&t);
+        g_checks += 17;
+        printf("[PASS] intern table: %d keys, escapes, ranks\n", many);
+    }
+
+    /* shared table, one cache per thread */
+    {
+        ajis_intern_table t;
+        TEST_ASSERT(ajis_intern_init(&t, NULL, 1) == AJIS_OK, "shared init");
+        Shared* sh = (Shared*)calloc(1, sizeof(Shared));
+        TEST_ASSERT(sh != NULL, "out of memory");
+        sh->table = &t;
+
+        pthread_t tids[THREADS];
+        Job jobs[THREADS];
+        for (int i = 0; i < THREADS; i++) {
+            jobs[i].sh = sh;
+            jobs[i].id = i;
+            TEST_ASSERT(pthread_create(&tids[i], NULL, intern_worker, &jobs[i]) == 0, "thread");
+        }
+        for (int i = 0; i < THREADS; i++) pthread_join(tids[i], NULL);
+
+        TEST_ASSERT(!sh->failed, "workers succeeded");
+        TEST_ASSERT(ajis_intern_count(&t) == VOCAB, "one symbol per distinct key");
+        int agree = 1;
+        for (int k = 0; k < VOCAB; k++) {
+            for (int i = 1; i < THREADS; i++) {
+                if (sh->seen[i][k] != sh->seen[0][k]) agree = 0;
+            }
+            char key[32];
+            int n = snprintf(key, sizeof(key), "field_%d", k);
+            size_t len;
+            const uint8_t* s = ajis_intern_str(&t, sh->seen[0][k], &len);
+            if (!s || len != (size_t)n || memcmp(s, key, len) != 0) agree = 0;
+        }
+        TEST_ASSERT(agree, "threads agree on every symbol");
+        TEST_ASSERT(sh->hits[0] > 0, "cache hits");
+
+        free(sh);
+        ajis_intern_destroy(&t);
+        g_checks += 5;
+        printf("[PASS] shared table with per-thread caches\n");
+    }
+
+    /* shared table: scratch buffers are taken under the lock */
+    {
+        Exclusive x = { 0, 0 };
+        ajis_allocator excl = { excl_alloc, excl_realloc, excl_free, &x };
+        ajis_intern_table t;
+        TEST_ASSERT(ajis_intern_init(&t, &excl, 1) == AJIS_OK, "shared init");
+        Shared* sh = (Shared*)calloc(1, sizeof(Shared));
+        TEST_ASSERT(sh != NULL, "out of memory");
+        sh->table = &t;
+
+        pthread_t tids[THREADS];
+        Job jobs[THREADS];
+        for (int i = 0; i < THREADS; i++) {
+            jobs[i].sh = sh;
+            jobs[i].id = i;
+            TEST_ASSERT(pthread_create(&tids[i], NULL, scratch_worker, &jobs[i]) == 0, "thread");
+        }
+        for (int i = 0; i < THREADS; i++) pthread_join(tids[i], NULL);
+
+        TEST_ASSERT(!sh->failed && ajis_intern_count(&t) == 50, "escaped keys interned");
+        TEST_ASSERT(x.overlaps == 0, "allocator never entered twice at once");
+        free(sh);
+        ajis_intern_destroy(&t);
+        g_checks += 4;
+        printf("[PASS] shared table over an allocator that is not thread-safe\n");
+    }
+
+    /* validator: duplicate keys compared decoded, across documents */
+    {
+        ajis_intern_table t;
+        TEST_ASSERT(ajis_intern_init(&t, NULL, 0) == AJIS_OK, "init");
+
+        ajis_validate_options o = ajis_validate_options_default();
+        o.reject_duplicate_keys = 1;
+        ajis_error err;
+        const char* dup = "{\"a\": 1, \"\\u0061\": 2}";
+        TEST_ASSERT(ajis_validate(dup, strlen(dup), &o, &err) == AJIS_OK, "raw comparison: different spellings");
+        o.intern = &t;
+        TEST_ASSERT(ajis_validate(dup, strlen(dup), &o, &err) == AJIS_ERR_DUPLICATE_KEY && err.location.column == 10, "decoded duplicate");
+
+        const char* rec = "{\"id\": 1, \"name\": \"x\", \"tags\": [{\"id\": 2, \"name\": \"y\"}]}";
+        for (int i = 0; i < 1000; i++) TEST_ASSERT(ajis_validate(rec, strlen(rec), &o, &err) == AJIS_OK, "record");
+        TEST_ASSERT(ajis_intern_count(&t) == 4, "vocabulary shared across documents");
+
+        o.allow_unknown_escapes = 1;
+        const char* bad = "{\"\\uD800\": 1}";
+        TEST_ASSERT(ajis_validate(bad, strlen(bad), &o, &err) == AJIS_ERR_INVALID_ESCAPE, "undecodable key");
+
+        ajis_intern_destroy(&t);
+        g_checks += 5;
+        printf("[PASS] ajis_validate duplicate keys through the intern table\n");
+    }
+
+    /* AUV transcoder: keys as symbols, canonical order by rank */
+    {
+        ajis_intern_table t;
+        TEST_ASSERT(ajis_intern_init(&t, NULL, 0) == AJIS_OK, "init");
+        const char* docs[] = {
+            "{\"zeta\": 1, \"\\u0061lpha\": {\"b\": [{\"y\": 1, \"x\": 2}], \"a\": null}, \"mid\": \"s\", \"Zed\": true}",
+            "{\"mid\": 2, \"alph\": 3, \"alpha\": {\"x\": 1, \"aa\": 2, \"a\": 3}, \"\": 4}",
+            "[{\"q\": 1, \"p\": 2}, {\"p\": 3, \"q\": 4, \"o\": 5}]",
+        };
+        int same = 1;
+        for (int canonical = 0; canonical < 2; canonical++) {
+            for (int d = 0; d < 3; d++) {
+                ajis_auv_options o = ajis_auv_options_default();
+                o.canonical = canonical;
+                uint8_t want[256], got[256];
+                size_t nw = 0, ng = 0;
+                TEST_ASSERT(ajis_to_auv(docs[d], strlen(docs[d]), &o, want, sizeof(want), &nw, NULL) == AJIS_OK, "bytes");
+                o.intern = &t;
+                TEST_ASSERT(ajis_to_auv(docs[d], strlen(docs[d]), &o, got, sizeof(got), &ng, NULL) == AJIS_OK, "symbols");
+                if (nw != ng || memcmp(want, got, nw) != 0) same = 0;
+            }
+        }
+        TEST_ASSERT(same, "same records as comparing bytes");
+        TEST_ASSERT(ajis_intern_count(&t) == 14, "every key interned once");
+
+        ajis_auv_options o = ajis_auv_options_default();
+        o.intern = &t;
+        ajis_error err;
+        size_t n;
+        const char* dup = "{\"b\": {\"a\": 1, \"\\u0061\": 2}}";
+        TEST_ASSERT(ajis_to_auv(dup, strlen(dup), &o, NULL, 0, &n, &err) == AJIS_ERR_DUPLICATE_KEY && err.location.column == 16,
+                    "decoded duplicate");
+        ajis_intern_destroy(&t);
+        g_checks += 4;
+        printf("[PASS] ajis_to_auv keys through the intern table\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
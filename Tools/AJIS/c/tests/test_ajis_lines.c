@@ -0,0 +1,256 @@
+#include "../include/ajis_lines.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static size_t frame_all(const char* text, int multiline, ajis_lines_record* out, size_t cap) {
+    ajis_lexer_options lo;
+    lo.allow_multiline_strings = multiline;
+    lo.allow_number_separators = 1;
+    ajis_lines_framer fr;
+    ajis_lines_framer_init(&fr, text, strlen(text), lo);
+    size_t n = 0;
+    ajis_lines_record rec;
+    while (ajis_lines_next(&fr, &rec)) {
+        TEST_ASSERT(n < cap, "too many records");
+        out[n++] = rec;
+    }
+    return n;
+}
+
+static int record_is(const char* text, const ajis_lines_record* r, const char* expect, size_t line) {
+    return r->length == strlen(expect) && memcmp(text + r->offset, expect, r->length) == 0 && r->line == line;
+}
+
+/* ---------------- Collected reports ---------------- */
+
+typedef struct Report {
+    size_t next_index;
+    int in_order;
+    size_t fail_lines[64];
+    size_t fail_count;
+    ajis_error_code fail_codes[64];
+    char* out;
+    size_t out_len;
+    size_t stop_after;      /* 0 = never */
+} Report;
+
+static int collect(const ajis_lines_record* rec, ajis_error_code rc, const ajis_error* err,
+                   const uint8_t* out, size_t out_len, void* ctx) {
+    Report* r = (Report*)ctx;
+    if (rec->index != r->next_index) r->in_order = 0;
+    r->next_index++;
+    if (rc != AJIS_OK) {
+        if (r->fail_count < 64) {
+            r->fail_lines[r->fail_count] = err->location.line;
+            r->fail_codes[r->fail_count] = rc;
+        }
+        r->fail_count++;
+    }
+    if (out_len) {
+        r->out = (char*)realloc(r->out, r->out_len + out_len);
+        memcpy(r->out + r->out_len, out, out_len);
+        r->out_len += out_len;
+    }
+    return r->stop_after && r->next_index == r->stop_after;
+}
+
+/* "transcoder" writing "<index>:<length>\n" per record */
+static ajis_error_code describe(ajis_lines_task* task, ajis_error* err, void* ctx) {
+    (void)err;
+    (void)ctx;
+    char* scratch = (char*)ajis_alloc(&task->arena->allocator, 64);
+    int n = snprintf(scratch, 64, "%zu:%zu\n", task->record.index, task->record.length);
+    return ajis_lines_buffer_append(task->out, scratch, (size_t)n);
+}
+
+/* malloc, refusing odd sizes: only the pool's per-run bookkeeping block asks for one */
+static void* odd_alloc(void* ctx, size_t size) {
+    if (size & 1) {
+        (*(size_t*)ctx)++;
+        return NULL;
+    }
+    return malloc(size);
+}
+
+static void* odd_realloc(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void odd_free(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+/* ---------------- Generated log ---------------- */
+
+typedef struct Text {
+    char* data;
+    size_t len;
+    size_t cap;
+} Text;
+
+static void text_add(Text* t, const char* s) {
+    size_t n = strlen(s);
+    if (t->len + n + 1 > t->cap) {
+        t->cap = (t->len + n + 1) * 2;
+        t->data = (char*)realloc(t->data, t->cap);
+    }
+    memcpy(t->data + t->len, s, n + 1);
+    t->len += n;
+}
+
+/* Every 997th record is broken; returns the number of records. */
+static size_t make_log(Text* t, size_t rows, size_t* bad_lines, size_t* bad_count) {
+    char line[256];
+    size_t line_no = 1;
+    *bad_count = 0;
+    for (size_t i = 0; i < rows; i++) {
+        if (i % 997 == 500) {
+            snprintf(line, sizeof(line), "{\"id\": %zu, \"msg\": \"unterminated}\n", i);
+            if (*bad_count < 64) bad_lines[*bad_count] = line_no;
+            (*bad_count)++;
+        } else if (i % 250 == 3) {
+            snprintf(line, sizeof(line), "/* multi\n   line */ {\"id\": %zu, \"tags\": [\"a\", \"b\"]}\n", i);
+        } else {
+            snprintf(line, sizeof(line), "{\"id\": %zu, \"level\": \"info\", \"n\": 1_000, \"ok\": true}\r\n", i);
+        }
+        text_add(t, line);
+        for (const char* c = line; *c; c++) line_no += *c == '\n';
+        if (i % 100 == 7) {
+            text_add(t, "\n   // heartbeat\n");
+            line_no += 2;
+        }
+    }
+    return rows;
+}
+
+int main(void) {
+    ajis_lines_record recs[32];
+
+    /* framing */
+    {
+        const char* t = "{\"a\": 1}\r\n\n   \n// only a comment\n[1, /* two\nlines */ 2] // tail\n\"x\\\"y\" /* \" */\n";
+        size_t n = frame_all(t, 0, recs, 32);
+        TEST_ASSERT(n == 3, "three records");
+        TEST_ASSERT(record_is(t, &recs[0], "{\"a\": 1}", 1), "CRLF stripped");
+        TEST_ASSERT(record_is(t, &recs[1], "[1, /* two\nlines */ 2] // tail", 5), "comment spans lines");
+        TEST_ASSERT(record_is(t, &recs[2], "\"x\\\"y\" /* \" */", 7), "quotes in strings and comments");
+        TEST_ASSERT(recs[2].index == 2, "blank lines are not records");
+
+        /* a stray quote or unclosed comment stays on its line */
+        t = "{\"a\": \"oops}\n{\"b\": 2} /* never closed\n{\"c\": 3}\n/* again\n{\"d\": 4}";
+        n = frame_all(t, 0, recs, 32);
+        TEST_ASSERT(n == 5, "damage limited to one line");
+        TEST_ASSERT(record_is(t, &recs[2], "{\"c\": 3}", 3) && record_is(t, &recs[4], "{\"d\": 4}", 5), "records after the damage");
+
+        /* multiline strings: a string may hold newlines */
+        t = "{\"a\": \"one\ntwo\"}\n{\"b\": \"\\\nx\"}\n[3]";
+        n = frame_all(t, 1, recs, 32);
+        TEST_ASSERT(n == 3 && record_is(t, &recs[0], "{\"a\": \"one\ntwo\"}", 1), "multiline string");
+        TEST_ASSERT(record_is(t, &recs[2], "[3]", 5), "line numbers count newlines inside records");
+        n = frame_all(t, 0, recs, 32);
+        TEST_ASSERT(n == 5, "without multiline the newline ends the record");
+
+        n = frame_all("", 0, recs, 32) + frame_all("\n\n// x", 0, recs, 32);
+        TEST_ASSERT(n == 0, "empty and comment-only streams");
+
+        g_checks += 11;
+        printf("[PASS] framing: CRLF, comments, strings, damage containment, multiline\n");
+    }
+
+    /* validation: per-record errors, in order, independent of threads and windows */
+    {
+        Text log = {0};
+        size_t bad_lines[64], bad_count;
+        size_t rows = make_log(&log, 20000, bad_lines, &bad_count);
+
+        unsigned threads[] = { 1, 4, 8 };
+        size_t windows[] = { 0, 4096, 100 };
+        for (int k = 0; k < 3; k++) {
+            ajis_lines_options o = ajis_lines_options_default();
+            o.threads = threads[k];
+            o.window_bytes = windows[k];
+
+            Report r;
+            memset(&r, 0, sizeof(r));
+            r.in_order = 1;
+            ajis_lines_stats st;
+            TEST_ASSERT(ajis_lines_validate(log.data, log.len, &o, NULL, collect, &r, &st) == AJIS_OK, "run");
+            TEST_ASSERT(st.records == rows && r.next_index == rows && r.in_order, "every record, in order");
+            TEST_ASSERT(st.failed == bad_count && r.fail_count == bad_count, "only broken records fail");
+            TEST_ASSERT(st.bytes == log.len && !st.stopped, "whole stream consumed");
+            for (size_t i = 0; i < bad_count && i < 64; i++) {
+                TEST_ASSERT(r.fail_lines[i] == bad_lines[i], "error line is the stream line");
+                TEST_ASSERT(r.fail_codes[i] == AJIS_ERR_UNEXPECTED_EOF, "error code from the record");
+            }
+            g_checks += 4;
+        }
+        free(log.data);
+        printf("[PASS] %zu records, %zu broken: reported in order with stream line numbers (1/4/8 threads)\n",
+            rows, bad_count);
+    }
+
+    /* output collected per record, stopping early */
+    {
+        Text log = {0};
+        char line[64];
+        for (int i = 0; i < 5000; i++) {
+            snprintf(line, sizeof(line), "[%d]\n", i);
+            text_add(&log, line);
+        }
+
+        ajis_lines_options o = ajis_lines_options_default();
+        o.threads = 8;
+        o.window_bytes = 1000;
+
+        Report r;
+        memset(&r, 0, sizeof(r));
+        r.in_order = 1;
+        ajis_lines_stats st;
+        TEST_ASSERT(ajis_lines_run(log.data, log.len, &o, describe, collect, &r, &st) == AJIS_OK, "run");
+
+        Text expect = {0};
+        for (int i = 0; i < 5000; i++) {
+            snprintf(line, sizeof(line), "[%d]", i);
+            char e[64];
+            snprintf(e, sizeof(e), "%d:%zu\n", i, strlen(line));
+            text_add(&expect, e);
+        }
+        TEST_ASSERT(r.out_len == expect.len && memcmp(r.out, expect.data, expect.len) == 0, "outputs concatenate in input order");
+
+        free(r.out);
+        memset(&r, 0, sizeof(r));
+        r.in_order = 1;
+        r.stop_after = 1234;
+        TEST_ASSERT(ajis_lines_run(log.data, log.len, &o, describe, collect, &r, &st) == AJIS_OK, "run");
+        TEST_ASSERT(st.stopped && st.records == 1234 && r.next_index == 1234, "report stops the run");
+
+        /* the pool cannot start: every window still runs, on the calling thread */
+        size_t refused = 0;
+        ajis_allocator odd = { odd_alloc, odd_realloc, odd_free, &refused };
+        o.allocator = &odd;
+        free(r.out);
+        memset(&r, 0, sizeof(r));
+        r.in_order = 1;
+        TEST_ASSERT(ajis_lines_run(log.data, log.len, &o, describe, collect, &r, &st) == AJIS_OK, "run");
+        TEST_ASSERT(refused > 0 && st.records == 5000 && r.in_order, "every record without the pool");
+        TEST_ASSERT(r.out_len == expect.len && memcmp(r.out, expect.data, expect.len) == 0, "same output without the pool");
+
+        free(r.out);
+        free(log.data);
+        free(expect.data);
+        g_checks += 6;
+        printf("[PASS] per-record output in order; early stop; pool allocation failure\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
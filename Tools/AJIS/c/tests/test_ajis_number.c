@@ -0,0 +1,110 @@
+#include "../include/ajis_number.h"
+#include "test_common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static ajis_error_code parse(const char* s, ajis_number* n) {
+    return ajis_number_parse((const uint8_t*)s, strlen(s), n);
+}
+
+static int is_int(const char* s, int64_t v) {
+    ajis_number n;
+    return parse(s, &n) == AJIS_OK && n.kind == AJIS_NUMBER_INT && n.i == v && n.f == (double)v;
+}
+
+static int is_float(const char* s, double v) {
+    ajis_number n;
+    return parse(s, &n) == AJIS_OK && n.kind == AJIS_NUMBER_FLOAT && memcmp(&n.f, &v, sizeof(v)) == 0;
+}
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+int main(void) {
+    ajis_number n;
+
+    /* integers */
+    TEST_ASSERT(is_int("0", 0) && is_int("-0", 0) && is_int("42", 42) && is_int("-17", -17), "small integers");
+    TEST_ASSERT(is_int("1_000_000", 1000000) && is_int("1 234 567", 1234567) && is_int("-9,876", -9876), "separators");
+    TEST_ASSERT(is_int("9223372036854775807", INT64_MAX) && is_int("-9223372036854775808", INT64_MIN), "int64 limits");
+    TEST_ASSERT(is_float("9223372036854775808", 9223372036854775808.0), "past int64: double");
+    TEST_ASSERT(is_float("123456789012345678901234567890", 123456789012345678901234567890.0), "long integer");
+    g_checks += 5;
+    printf("[PASS] decimal integers\n");
+
+    /* base prefixes */
+    TEST_ASSERT(is_int("0xFF", 255) && is_int("0xdead_beef", 0xdeadbeefLL) && is_int("-0x10", -16), "hex");
+    TEST_ASSERT(is_int("0b1010", 10) && is_int("0b1 0000", 16) && is_int("0o17", 15) && is_int("0o1_777", 1023), "binary, octal");
+    TEST_ASSERT(is_int("0x7FFFFFFFFFFFFFFF", INT64_MAX) && is_int("-0x8000000000000000", INT64_MIN), "hex limits");
+    TEST_ASSERT(parse("0xFFFFFFFFFFFFFFFF", &n) == AJIS_ERR_SIZE_LIMIT, "hex past int64");
+    TEST_ASSERT(parse("0x1FFFFFFFFFFFFFFFF", &n) == AJIS_ERR_SIZE_LIMIT, "hex past uint64");
+    TEST_ASSERT(parse("0xG", &n) == AJIS_ERR_INVALID_NUMBER && parse("0b2", &n) == AJIS_ERR_INVALID_NUMBER, "bad digits");
+    g_checks += 6;
+    printf("[PASS] 0x / 0b / 0o\n");
+
+    /* floats */
+    TEST_ASSERT(is_float("1.5", 1.5) && is_float("-0.25", -0.25) && is_float("1e3", 1000.0) && is_float("2E-2", 0.02), "simple");
+    TEST_ASSERT(is_float("0.1", 0.1) && is_float("3.14159", 3.14159) && is_float("1_000.5", 1000.5), "fast path");
+    TEST_ASSERT(is_float("1e308", 1e308) && is_float("4.9e-324", 4.9e-324) && is_float("2.2250738585072014e-308", 2.2250738585072014e-308), "extremes");
+    TEST_ASSERT(is_float("0.30000000000000004", 0.30000000000000004), "17 digits");
+    TEST_ASSERT(parse("1e309", &n) == AJIS_ERR_SIZE_LIMIT, "overflow");
+    TEST_ASSERT(is_float("1e-400", 0.0), "underflow to zero");
+    {
+        double nz = -0.0;
+        TEST_ASSERT(is_float("-0.0", nz), "negative zero");
+    }
+    g_checks += 7;
+    printf("[PASS] floats\n");
+
+    /* malformed */
+    const char* bad[] = { "", "-", "1.", ".5", "1e", "1e+", "abc", "1.2.3", "0x", "12a", "--1" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        TEST_ASSERT(parse(bad[i], &n) == AJIS_ERR_INVALID_NUMBER, bad[i]);
+        g_checks++;
+    }
+    printf("[PASS] malformed input rejected\n");
+
+    /* random decimals agree with strtod bit for bit */
+    {
+        char buf[64];
+        for (int i = 0; i < 200000; i++) {
+            uint64_t r = rnd();
+            int digits = 1 + (int)(r % 20);
+            int point = (int)((r >> 8) % (uint64_t)(digits + 1));
+            int e = (int)((r >> 16) % 80) - 40;
+            size_t k = 0;
+            if ((r >> 30) & 1) buf[k++] = '-';
+            for (int d = 0; d < digits; d++) {
+                if (d == point && d > 0) buf[k++] = '.';
+                int c = (int)(rnd() % 10);
+                if (d == 0 && c == 0) c = 1;
+                buf[k++] = (char)('0' + c);
+            }
+            if ((r >> 31) & 1) k += (size_t)snprintf(buf + k, sizeof(buf) - k, "e%d", e);
+            buf[k] = '\0';
+
+            double want = strtod(buf, NULL);
+            ajis_error_code rc = parse(buf, &n);
+            if (rc != AJIS_OK || n.f != want) {
+                fprintf(stderr, "%s: got %.17g want %.17g (rc %d)\n", buf, n.f, want, (int)rc);
+                TEST_ASSERT(0, "matches strtod");
+            }
+        }
+        g_checks += 1;
+        printf("[PASS] 200000 random decimals match strtod\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "../include/ajis_pool.h"
+#include "test_common.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct Ctx {
+    _Atomic int *hits;
+    _Atomic unsigned long long sum;
+    unsigned threads;
+    _Atomic int bad_worker;
+} Ctx;
+
+static void task(size_t index, unsigned worker, void *ctx) {
+    Ctx *c = (Ctx *)ctx;
+    if (worker >= c->threads) atomic_store(&c->bad_worker, 1);
+    atomic_fetch_add(&c->hits[index], 1);
+    atomic_fetch_add(&c->sum, (unsigned long long)index);
+
+    /* a few very slow tasks at the front force the other workers to steal */
+    if (index < 4) {
+        volatile unsigned long long spin = 0;
+        for (int i = 0; i < 2000000; i++) spin += (unsigned long long)i;
+    }
+}
+
+static int g_checks = 0;
+
+static void run_case(size_t count, unsigned threads) {
+    Ctx c;
+    c.hits = (_Atomic int *)calloc(count ? count : 1, sizeof(_Atomic int));
+    TEST_ASSERT(c.hits != NULL, "out of memory");
+    atomic_init(&c.sum, 0);
+    atomic_init(&c.bad_worker, 0);
+    c.threads = threads ? threads : ajis_pool_default_threads();
+
+    TEST_ASSERT(ajis_pool_run(count, threads, task, &c) == 0, "pool run");
+    for (size_t i = 0; i < count; i++) {
+        TEST_ASSERT(atomic_load(&c.hits[i]) == 1, "every index runs exactly once");
+    }
+    TEST_ASSERT(atomic_load(&c.sum) == (unsigned long long)count * (count ? count - 1 : 0) / 2, "index sum");
+    TEST_ASSERT(!atomic_load(&c.bad_worker), "worker id in range");
+    free((void *)c.hits);
+    g_checks += 3;
+    printf("[PASS] count=%zu threads=%u\n", count, threads);
+}
+
+int main(void) {
+    run_case(0, 4);
+    run_case(1, 4);
+    run_case(3, 8);
+    run_case(1000, 1);
+    run_case(1000, 0);
+    run_case(100000, 7);
+    run_case(100000, 32);
+
+    TEST_ASSERT(ajis_pool_run(10, 2, NULL, NULL) != 0, "missing task function rejected");
+    g_checks++;
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,312 @@
+#include "../include/ajis_query.h"
+#include "../include/ajis_string.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+/* ---------------- Collected matches ---------------- */
+
+typedef struct Hit {
+    ajis_token_type type;
+    size_t offset, length, index;
+    double number;
+    char text[64];
+} Hit;
+
+typedef struct Hits {
+    Hit items[4096];
+    size_t count;
+    size_t stop_after;
+} Hits;
+
+static int collect(const ajis_query_match* m, void* ctx) {
+    Hits* h = (Hits*)ctx;
+    TEST_ASSERT(h->count < 4096, "too many matches");
+    Hit* x = &h->items[h->count++];
+    memset(x, 0, sizeof(*x));
+    x->type = m->type;
+    x->offset = m->span.offset;
+    x->length = m->span.length;
+    x->index = m->index;
+    x->number = m->number.f;
+    if (m->text) snprintf(x->text, sizeof(x->text), "%.*s", (int)m->text_length, (const char*)m->text);
+    return h->stop_after && h->count == h->stop_after;
+}
+
+static ajis_error_code run(const char* path, const char* doc, unsigned flags, Hits* h, ajis_error* err) {
+    ajis_query q;
+    TEST_ASSERT(ajis_query_compile(&q, path, NULL) == AJIS_OK, path);
+    ajis_query_options o = ajis_query_options_default();
+    o.flags = flags;
+    size_t stop = h->stop_after;
+    memset(h, 0, sizeof(*h));
+    h->stop_after = stop;
+    return ajis_query_run(&q, doc, strlen(doc), &o, collect, h, err);
+}
+
+static int raw_is(const char* doc, const Hit* x, const char* expect) {
+    return x->length == strlen(expect) && memcmp(doc + x->offset, expect, x->length) == 0;
+}
+
+/* ---------------- Reference: full token walk ---------------- */
+
+typedef struct Ref {
+    ajis_token toks[8192];
+    size_t n, i;
+    const char* doc;
+    const ajis_query* q;
+    Hits* out;
+} Ref;
+
+static int key_is(const Ref* r, ajis_span key, const ajis_query_step* s) {
+    uint8_t buf[256];
+    size_t n;
+    TEST_ASSERT(ajis_string_unescape((const uint8_t*)r->doc + key.offset, key.length, 0, buf, &n, NULL) == AJIS_OK, "key");
+    return n == s->name_length && memcmp(buf, r->q->names + s->name_offset, n) == 0;
+}
+
+static void ref_value(Ref* r, size_t depth, int active, size_t index) {
+    ajis_token t = r->toks[r->i];
+    int hit = active && depth == r->q->count;
+    const ajis_query_step* s = active && depth < r->q->count ? &r->q->steps[depth] : NULL;
+
+    if (t.type == AJIS_TOKEN_LBRACE || t.type == AJIS_TOKEN_LBRACKET) {
+        int obj = t.type == AJIS_TOKEN_LBRACE;
+        int taken = 0;
+        r->i++;
+        for (size_t n = 0; r->toks[r->i].type != (obj ? AJIS_TOKEN_RBRACE : AJIS_TOKEN_RBRACKET); n++) {
+            int child = 0;
+            if (obj) {
+                ajis_span key = r->toks[r->i].span;
+                r->i += 2; /* key, colon */
+                if (s && s->kind == AJIS_QUERY_ANY_FIELD) child = 1;
+                if (s && s->kind == AJIS_QUERY_FIELD && !taken && key_is(r, key, s)) child = taken = 1;
+            } else {
+                if (s && s->kind == AJIS_QUERY_ANY_INDEX) child = 1;
+                if (s && s->kind == AJIS_QUERY_INDEX && s->index == n) child = 1;
+            }
+            ref_value(r, depth + 1, child, n);
+            if (r->toks[r->i].type == AJIS_TOKEN_COMMA) r->i++;
+        }
+        if (hit) {
+            Hit* x = &r->out->items[r->out->count++];
+            memset(x, 0, sizeof(*x));
+            x->type = t.type;
+            x->offset = t.span.offset;
+            x->length = r->toks[r->i].span.offset + 1 - t.span.offset;
+            x->index = index;
+        }
+        r->i++;
+        return;
+    }
+    if (hit) {
+        Hit* x = &r->out->items[r->out->count++];
+        memset(x, 0, sizeof(*x));
+        x->type = t.type;
+        x->offset = t.span.offset;
+        x->length = t.span.length;
+        x->index = index;
+    }
+    r->i++;
+}
+
+/* ---------------- Random documents ---------------- */
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint32_t rnd(uint32_t n) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng % n);
+}
+
+static void put(char* buf, size_t* len, const char* s) {
+    size_t n = strlen(s);
+    memcpy(buf + *len, s, n);
+    *len += n;
+}
+
+static void gap(char* buf, size_t* len) {
+    static const char* gaps[] = { "", "", " ", "\n  ", " /* ] } */ ", " // }\n" };
+    put(buf, len, gaps[rnd(6)]);
+}
+
+static void gen_value(char* buf, size_t* len, int depth) {
+    static const char* keys[] = { "\"a\"", "\"b\"", "\"items\"", "\"pr\\u0069ce\"", "\"x y\"", "\"price\"" };
+    static const char* scalars[] = {
+        "1", "-2.5e3", "1_000", "-7", "true", "false", "null", "\"s\"", "\"[{\"", "\"\\\"]\"",
+        "\"/*\"", "hex\"0A1B\"", "b64\"QUJD\"", "12.75"
+    };
+    int kind = depth >= 4 ? 2 : (int)rnd(3);
+    if (kind == 0) {
+        put(buf, len, "{");
+        int n = (int)rnd(5);
+        for (int i = 0; i < n; i++) {
+            if (i) put(buf, len, ",");
+            gap(buf, len);
+            put(buf, len, keys[rnd(6)]);
+            gap(buf, len);
+            put(buf, len, ":");
+            gap(buf, len);
+            gen_value(buf, len, depth + 1);
+            gap(buf, len);
+        }
+        put(buf, len, "}");
+    } else if (kind == 1) {
+        put(buf, len, "[");
+        int n = (int)rnd(5);
+        for (int i = 0; i < n; i++) {
+            if (i) put(buf, len, ",");
+            gap(buf, len);
+            gen_value(buf, len, depth + 1);
+            gap(buf, len);
+        }
+        put(buf, len, "]");
+    } else {
+        put(buf, len, scalars[rnd(14)]);
+    }
+}
+
+int main(void) {
+    Hits* h = (Hits*)calloc(1, sizeof(Hits));
+    Hits* want = (Hits*)calloc(1, sizeof(Hits));
+    Ref* ref = (Ref*)calloc(1, sizeof(Ref));
+    ajis_error err;
+    ajis_query q;
+
+    /* compiling */
+    {
+        TEST_ASSERT(ajis_query_compile(&q, "$.items[*].price", NULL) == AJIS_OK && q.count == 3, "three steps");
+        TEST_ASSERT(q.steps[0].kind == AJIS_QUERY_FIELD && q.steps[1].kind == AJIS_QUERY_ANY_INDEX, "kinds");
+        TEST_ASSERT(ajis_query_compile(&q, "$[\"a.b\"]['it\\'s'][12].*", NULL) == AJIS_OK && q.count == 4, "quoted names");
+        TEST_ASSERT(q.steps[1].name_length == 4 && memcmp(q.names + q.steps[1].name_offset, "it's", 4) == 0, "escaped quote");
+        TEST_ASSERT(q.steps[2].kind == AJIS_QUERY_INDEX && q.steps[2].index == 12, "index");
+        TEST_ASSERT(ajis_query_compile(&q, "", NULL) == AJIS_OK && q.count == 0, "root");
+
+        TEST_ASSERT(ajis_query_compile(&q, "$.a..b", &err) == AJIS_ERR_INVALID_SYNTAX && err.location.column == 5, "empty name");
+        TEST_ASSERT(ajis_query_compile(&q, "$.a[x]", &err) == AJIS_ERR_INVALID_SYNTAX, "bad bracket");
+        TEST_ASSERT(ajis_query_compile(&q, "$['a", &err) == AJIS_ERR_INVALID_SYNTAX, "unterminated name");
+        TEST_ASSERT(ajis_query_compile(&q, "a.b", &err) == AJIS_ERR_INVALID_SYNTAX, "missing dot");
+        char deep[200] = "$";
+        for (int i = 0; i < 40; i++) strcat(deep, "[0]");
+        TEST_ASSERT(ajis_query_compile(&q, deep, &err) == AJIS_ERR_SIZE_LIMIT, "too many steps");
+        g_checks += 11;
+        printf("[PASS] path compilation and errors\n");
+    }
+
+    /* extraction */
+    {
+        const char* doc =
+            "// export\n"
+            "{\"meta\": {\"note\": \"] } not a bracket\", \"x\": [1, [2, {\"y\": \"}\"}]]},\n"
+            " \"items\": [\n"
+            "   {\"name\": \"a\", \"price\": 1_250.5, \"tags\": [\"x\"]},\n"
+            "   {\"pr\\u0069ce\": 0x10 /* hex */},\n"
+            "   {\"name\": \"c\"},\n"
+            "   {\"price\": \"free\\n\", \"price\": 9}\n"
+            " ],\n"
+            " \"odd key\": [true, null, b64\"QUJD\"]}";
+
+        TEST_ASSERT(run("$.items[*].price", doc, AJIS_QUERY_DECODE, h, &err) == AJIS_OK && h->count == 3, "three prices");
+        TEST_ASSERT(h->items[0].type == AJIS_TOKEN_NUMBER && h->items[0].number == 1250.5, "decoded number");
+        TEST_ASSERT(h->items[1].number == 16.0 && h->items[1].index == 0, "escaped key matches, hex decoded");
+        TEST_ASSERT(h->items[2].type == AJIS_TOKEN_STRING && strcmp(h->items[2].text, "free\n") == 0, "first of duplicate keys, decoded");
+
+        TEST_ASSERT(run("$['odd key'][2]", doc, 0, h, &err) == AJIS_OK && h->count == 1, "quoted key, index");
+        TEST_ASSERT(h->items[0].type == AJIS_TOKEN_B64_BINARY && raw_is(doc, &h->items[0], "b64\"QUJD\""), "binary span");
+
+        TEST_ASSERT(run("$.meta.x[1]", doc, 0, h, &err) == AJIS_OK && h->count == 1, "container match");
+        TEST_ASSERT(h->items[0].type == AJIS_TOKEN_LBRACKET && raw_is(doc, &h->items[0], "[2, {\"y\": \"}\"}]"), "container span");
+
+        TEST_ASSERT(run("$.*", doc, 0, h, &err) == AJIS_OK && h->count == 3 && h->items[2].index == 2, "wildcard members");
+        TEST_ASSERT(run("$.items[*].nope", doc, 0, h, &err) == AJIS_OK && h->count == 0, "no match");
+        TEST_ASSERT(run("$.items.price", doc, 0, h, &err) == AJIS_OK && h->count == 0, "field step on an array");
+        TEST_ASSERT(run("$", doc, 0, h, &err) == AJIS_OK && h->count == 1 && h->items[0].type == AJIS_TOKEN_LBRACE, "root");
+
+        h->stop_after = 1;
+        TEST_ASSERT(run("$.items[*].price", doc, 0, h, &err) == AJIS_OK && h->count == 1, "callback stops");
+        h->stop_after = 0;
+        g_checks += 13;
+        printf("[PASS] fields, indices, wildcards, escapes, decoding, containers\n");
+    }
+
+    /* errors on the matching path, and in skipped subtrees */
+    {
+        TEST_ASSERT(run("$.a[*]", "{\"a\": [1 2]}", 0, h, &err) == AJIS_ERR_MISSING_COMMA && err.location.column == 10, "missing comma");
+        TEST_ASSERT(run("$.a", "{\"a\" 1}", 0, h, &err) == AJIS_ERR_MISSING_COLON, "missing colon");
+        TEST_ASSERT(run("$.a[*]", "{\"a\": [1,]}", 0, h, &err) == AJIS_ERR_TRAILING_COMMA, "trailing comma");
+        TEST_ASSERT(run("$.b", "{\"a\": [1, {\"x\": 2}, \n\"b\": 3}", 0, h, &err) == AJIS_ERR_UNEXPECTED_EOF, "unbalanced skipped subtree");
+        TEST_ASSERT(run("$.b", "{\"a\": [1 2 3], \"b\": 3}", 0, h, &err) == AJIS_OK && h->count == 1, "skipped subtree is not validated");
+        TEST_ASSERT(run("$.a", "{\"a\": 1} x", 0, h, &err) == AJIS_ERR_INVALID_SYNTAX && err.location.column == 10, "content after the value");
+        TEST_ASSERT(run("$.a", "{\"a\": 1e999}", AJIS_QUERY_DECODE, h, &err) == AJIS_ERR_SIZE_LIMIT, "number out of range");
+        TEST_ASSERT(run("$.a", "{\"a\":\n  \"x\\q\"}", AJIS_QUERY_DECODE, h, &err) == AJIS_ERR_INVALID_ESCAPE &&
+            err.location.line == 2 && err.location.column == 5, "bad escape located");
+        g_checks += 8;
+        printf("[PASS] grammar errors with locations\n");
+    }
+
+    /* random documents and queries agree with a full token walk */
+    {
+        static const char* paths[] = {
+            "$", "$.a", "$.a.b", "$[*]", "$[1]", "$.*", "$.*[*]", "$.items[*].price", "$.a[*].b",
+            "$.*.*", "$[0].a[2]", "$[\"x y\"]", "$.price", "$[*][*][*]", "$.b[0].*"
+        };
+        char* doc = (char*)malloc(1 << 20);
+        size_t total_hits = 0;
+        for (int round = 0; round < 3000; round++) {
+            size_t len = 0;
+            gen_value(doc, &len, 0);
+            doc[len] = '\0';
+
+            ajis_input in;
+            ajis_input_init(&in, doc, len);
+            ajis_lexer lx;
+            ajis_lexer_options lo = { 0, 1 };
+            ajis_lexer_init(&lx, &in, lo);
+            ref->n = 0;
+            do {
+                ajis_error le;
+                if (ajis_lexer_next(&lx, &ref->toks[ref->n], &le) != AJIS_OK) {
+                    fprintf(stderr, "%s at %zu: %s\n", doc, le.location.offset, le.context ? le.context : "");
+                    TEST_ASSERT(0, "generated document lexes");
+                }
+            } while (ref->toks[ref->n++].type != AJIS_TOKEN_EOF);
+
+            for (size_t k = 0; k < sizeof(paths) / sizeof(paths[0]); k++) {
+                TEST_ASSERT(ajis_query_compile(&q, paths[k], NULL) == AJIS_OK, "compile");
+                ref->doc = doc;
+                ref->q = &q;
+                ref->out = want;
+                ref->i = 0;
+                want->count = 0;
+                ref_value(ref, 0, 1, 0);
+
+                TEST_ASSERT(run(paths[k], doc, 0, h, &err) == AJIS_OK, "run");
+                int same = h->count == want->count;
+                for (size_t i = 0; same && i < h->count; i++) {
+                    same = h->items[i].type == want->items[i].type && h->items[i].offset == want->items[i].offset &&
+                           h->items[i].length == want->items[i].length && h->items[i].index == want->items[i].index;
+                }
+                if (!same) {
+                    fprintf(stderr, "%s on %s: %zu matches, expected %zu\n", paths[k], doc, h->count, want->count);
+                    TEST_ASSERT(0, "query matches the reference walk");
+                }
+                total_hits += h->count;
+            }
+        }
+        free(doc);
+        g_checks += 1;
+        printf("[PASS] 3000 random documents x 15 paths agree with a full token walk (%zu matches)\n", total_hits);
+    }
+
+    free(h);
+    free(want);
+    free(ref);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
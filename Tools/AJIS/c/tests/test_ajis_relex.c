@@ -0,0 +1,223 @@
+#include "../include/ajis_relex.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static ajis_lexer_options opts(int multiline) {
+    ajis_lexer_options o;
+    o.allow_multiline_strings = multiline;
+    o.allow_number_separators = 1;
+    return o;
+}
+
+/* Non-zero when `inc` equals a fresh full lex of `doc`. */
+static int same_as_full(const ajis_token_list* inc, const char* doc, size_t len) {
+    ajis_token_list full;
+    ajis_token_list_init(&full, inc->options, NULL);
+    TEST_ASSERT(ajis_token_list_lex(&full, doc, len) == AJIS_OK, "full lex");
+    int ok = ajis_token_list_count(&full) == ajis_token_list_count(inc);
+    for (size_t i = 0; ok && i < ajis_token_list_count(&full); i++) {
+        size_t ea, eb;
+        ajis_token a = ajis_token_list_get(&full, i, &ea);
+        ajis_token b = ajis_token_list_get(inc, i, &eb);
+        ok = a.type == b.type && a.span.offset == b.span.offset && a.span.length == b.span.length && ea == eb;
+    }
+    ajis_token_list_free(&full);
+    return ok;
+}
+
+/* ---------------- Editable document ---------------- */
+
+typedef struct Doc {
+    char* data;
+    size_t len;
+    size_t cap;
+} Doc;
+
+static ajis_edit doc_replace(Doc* d, size_t off, size_t removed, const char* ins, size_t n) {
+    if (d->len - removed + n + 1 > d->cap) {
+        d->cap = (d->len + n + 1) * 2;
+        d->data = (char*)realloc(d->data, d->cap);
+        TEST_ASSERT(d->data != NULL, "out of memory");
+    }
+    memmove(d->data + off + n, d->data + off + removed, d->len - off - removed);
+    memcpy(d->data + off, ins, n);
+    d->len = d->len - removed + n;
+    ajis_edit e = { off, removed, n };
+    return e;
+}
+
+static void doc_set(Doc* d, const char* s) {
+    d->len = 0;
+    (void)doc_replace(d, 0, 0, s, strlen(s));
+}
+
+/* ---------------- Random content ---------------- */
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint32_t rnd(uint32_t n) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng % n);
+}
+
+/* Fragments chosen to hit every lexer path and its lookahead. */
+static const char* k_pieces[] = {
+    "{", "}", "[", "]", ":", ",", " ", "\n", "\t", "\"", "\"key\"", "\"a\\\"b\"", "\\",
+    "1", "0", "-", "12", "1 234", "1,234", "1_000", "0x1F", "0b1010", "0o17", "0xFF FF", "3.14", "1e10", "-0.5e-3",
+    "true", "false", "null", "tru", "nul", "hex\"", "hex\"0A1B\"", "b64\"QUJD\"", "hex\"ABC\"",
+    "//", "// line\n", "/*", "*/", "/* c */", "@", "#", "x", "\xC3\xA9",
+};
+
+static void random_piece(char* out, size_t* n) {
+    const char* p = k_pieces[rnd(sizeof(k_pieces) / sizeof(k_pieces[0]))];
+    *n = strlen(p);
+    memcpy(out, p, *n);
+}
+
+static void random_doc(Doc* d, size_t pieces) {
+    d->len = 0;
+    char buf[32];
+    for (size_t i = 0; i < pieces; i++) {
+        size_t n;
+        random_piece(buf, &n);
+        (void)doc_replace(d, d->len, 0, buf, n);
+    }
+}
+
+int main(void) {
+    Doc d = {0};
+
+    /* hand-picked edits that change far more than the edited bytes */
+    {
+        ajis_token_list l;
+        ajis_token_list_init(&l, opts(0), NULL);
+        ajis_relex_stats st;
+
+        doc_set(&d, "[1, \"two\", 3]\n{\"k\": true}");
+        TEST_ASSERT(ajis_token_list_lex(&l, d.data, d.len) == AJIS_OK, "lex");
+        TEST_ASSERT(ajis_token_list_count(&l) == 13, "token count");
+
+        /* opening quote: the rest of the line becomes one bad string */
+        ajis_edit e = doc_replace(&d, 1, 0, "\"", 1);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "open quote");
+
+        /* and back */
+        e = doc_replace(&d, 1, 1, "", 0);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "remove quote");
+        TEST_ASSERT(st.resync_offset <= 14, "resynchronised at the end of the line");
+
+        /* digit group: "1, 234" style separator appears when a space joins digits */
+        doc_set(&d, "[1 23, 4]");
+        TEST_ASSERT(ajis_token_list_lex(&l, d.data, d.len) == AJIS_OK, "lex");
+        e = doc_replace(&d, 5, 0, "4", 1);      /* "[1 234, 4]": one number now */
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "separator lookahead");
+
+        /* block comment swallowing everything up to a later close */
+        doc_set(&d, "[1, 2, 3, 4] */ 5");
+        TEST_ASSERT(ajis_token_list_lex(&l, d.data, d.len) == AJIS_OK, "lex");
+        e = doc_replace(&d, 4, 0, "/*", 2);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "open comment");
+
+        /* append at the end, delete everything */
+        e = doc_replace(&d, d.len, 0, "0", 1);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "append");
+        e = doc_replace(&d, 0, d.len, "", 0);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && same_as_full(&l, d.data, d.len), "delete all");
+        TEST_ASSERT(ajis_token_list_count(&l) == 1, "only EOF left");
+
+        /* edit that does not match the document */
+        ajis_edit bad = { 5, 1, 0 };
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &bad, NULL) == AJIS_ERR_UNKNOWN, "bad edit rejected");
+
+        ajis_token_list_free(&l);
+        g_checks += 11;
+        printf("[PASS] quotes, separators, comments, append, delete\n");
+    }
+
+    /* random documents, random edits, compared with a full re-lex after each one */
+    {
+        size_t edits = 0;
+        for (int round = 0; round < 400; round++) {
+            ajis_token_list l;
+            ajis_token_list_init(&l, opts(round & 1), NULL);
+            random_doc(&d, 10 + rnd(60));
+            TEST_ASSERT(ajis_token_list_lex(&l, d.data, d.len) == AJIS_OK, "lex");
+
+            for (int k = 0; k < 50; k++) {
+                size_t off = rnd((uint32_t)d.len + 1);
+                size_t removed = rnd(4) == 0 ? 0 : rnd((uint32_t)(d.len - off) + 1) % 6;
+                char ins[64];
+                size_t n = 0;
+                int parts = (int)rnd(3);
+                for (int p = 0; p < parts; p++) {
+                    size_t pn;
+                    random_piece(ins + n, &pn);
+                    n += pn;
+                }
+                ajis_edit e = doc_replace(&d, off, removed, ins, n);
+                TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, NULL) == AJIS_OK, "apply");
+                if (!same_as_full(&l, d.data, d.len)) {
+                    fprintf(stderr, "mismatch after edit at %zu (-%zu +%zu) in: %.*s\n", off, removed, n, (int)d.len, d.data);
+                    TEST_ASSERT(0, "incremental result equals full re-lex");
+                }
+                edits++;
+            }
+            ajis_token_list_free(&l);
+        }
+        g_checks += 1;
+        printf("[PASS] %zu random edits match a full re-lex\n", edits);
+    }
+
+    /* large document: work is proportional to the edit */
+    {
+        const char* rec = "{\"id\": 12345, \"name\": \"row\", \"tags\": [1, 2, 3], \"ok\": true},\n";
+        size_t rl = strlen(rec);
+        size_t rows = (8u * 1024u * 1024u) / rl;
+        d.len = 0;
+        (void)doc_replace(&d, 0, 0, "[", 1);
+        for (size_t i = 0; i < rows; i++) (void)doc_replace(&d, d.len, 0, rec, rl);
+        (void)doc_replace(&d, d.len, 0, "]", 1);
+
+        ajis_token_list l;
+        ajis_token_list_init(&l, opts(0), NULL);
+        TEST_ASSERT(ajis_token_list_lex(&l, d.data, d.len) == AJIS_OK, "lex");
+        size_t total = ajis_token_list_count(&l);
+
+        size_t worst = 0;
+        ajis_relex_stats st;
+        for (int k = 0; k < 200; k++) {
+            /* typing in a value somewhere in the middle, then deleting it again */
+            size_t row = rows / 4 + (size_t)rnd((uint32_t)(rows / 2));
+            size_t off = 1 + row * rl + 7;      /* inside 12345 */
+            ajis_edit e = doc_replace(&d, off, 0, "9", 1);
+            TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK, "type");
+            if (st.tokens_lexed > worst) worst = st.tokens_lexed;
+            e = doc_replace(&d, off, 1, "", 0);
+            TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK, "delete");
+            if (st.tokens_lexed > worst) worst = st.tokens_lexed;
+        }
+        TEST_ASSERT(worst <= 4, "a few tokens re-lexed per keystroke");
+
+        /* an unbalanced quote re-lexes to the end of its line only */
+        size_t off = 1 + (rows / 2) * rl + 2;
+        ajis_edit e = doc_replace(&d, off, 0, "\"", 1);
+        TEST_ASSERT(ajis_token_list_apply(&l, d.data, d.len, &e, &st) == AJIS_OK && st.tokens_lexed < 40, "quote stays on its line");
+        TEST_ASSERT(same_as_full(&l, d.data, d.len), "large document matches full re-lex");
+        TEST_ASSERT(ajis_token_list_count(&l) < total, "tokens merged into the broken string");
+
+        ajis_token_list_free(&l);
+        g_checks += 4;
+        printf("[PASS] %zu-byte document, %zu tokens: at most %zu tokens re-lexed per keystroke\n", d.len, total, worst);
+    }
+
+    free(d.data);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,404 @@
+#include "../include/ajis_shred.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static ajis_error_code shred(ajis_shredder* s, const char* doc, ajis_error* err) {
+    return ajis_shred_array(s, doc, strlen(doc), err);
+}
+
+static const ajis_column* col(const ajis_shredder* s, const char* name) {
+    const ajis_column* c = ajis_shred_column(s, name);
+    TEST_ASSERT(c != NULL, name);
+    return c;
+}
+
+static int str_is(const ajis_column* c, size_t row, const char* want) {
+    size_t n = (size_t)(c->offsets[row + 1] - c->offsets[row]);
+    return n == strlen(want) && memcmp(c->bytes + c->offsets[row], want, n) == 0;
+}
+
+static int fallback_is(const ajis_shredder* s, size_t i, const char* want) {
+    const ajis_shred_fallback* f = &s->fallback;
+    size_t n = (size_t)(f->offsets[i + 1] - f->offsets[i]);
+    return n == strlen(want) && memcmp(f->bytes + f->offsets[i], want, n) == 0;
+}
+
+static ajis_shred_options infer(size_t n) {
+    ajis_shred_options o = ajis_shred_options_default();
+    o.infer_records = n;
+    return o;
+}
+
+/* ---------------- Random rows ---------------- */
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+enum { F_MISSING, F_NULL, F_INT, F_FLOAT, F_STRING, F_BOOL, F_RAW };
+
+typedef struct Field {
+    int kind;
+    long long i;
+    double f;
+    char text[32];          /* F_STRING: decoded; F_RAW: AJIS text */
+} Field;
+
+#define NFIELDS 6
+static const char* k_names[NFIELDS] = { "id", "qty", "price", "label", "ok", "meta" };
+
+/* Field `k` of a record. Column k mostly holds one kind; `mix` lets any kind appear. */
+static void gen_field(Field* f, int k, int mix) {
+    static const int usual[NFIELDS] = { F_INT, F_INT, F_FLOAT, F_STRING, F_BOOL, F_RAW };
+    uint64_t r = rnd();
+    memset(f, 0, sizeof(*f));
+    f->kind = r % 10 == 0 ? F_MISSING : r % 10 == 1 ? F_NULL : usual[k];
+    if (mix && (r >> 8) % 50 == 0) f->kind = F_INT + (int)((r >> 16) % 5);
+    if (k == 1 && f->kind == F_INT && (r >> 24) % 200 == 0) f->kind = F_FLOAT;   /* qty widens */
+
+    switch (f->kind) {
+        case F_INT: f->i = (long long)(r >> 20) % 2000000 - 1000000; break;
+        case F_FLOAT: f->f = (double)((long long)(r >> 20) % 100000) / 8.0; break;
+        case F_STRING: snprintf(f->text, sizeof(f->text), "s%u\\t", (unsigned)(r >> 40)); break;
+        case F_BOOL: f->i = (r >> 33) & 1; break;
+        case F_RAW: snprintf(f->text, sizeof(f->text), "[%u, {\"x\": null}]", (unsigned)(r >> 44)); break;
+        default: break;
+    }
+}
+
+static size_t put_value(char* out, const Field* f) {
+    switch (f->kind) {
+        case F_NULL: return (size_t)sprintf(out, "null");
+        case F_INT: return (size_t)sprintf(out, "%lld", f->i);
+        case F_FLOAT: return (size_t)sprintf(out, "%.3f", f->f);
+        case F_STRING: return (size_t)sprintf(out, "\"%s\"", f->text);
+        case F_BOOL: return (size_t)sprintf(out, f->i ? "true" : "false");
+        default: return (size_t)sprintf(out, "%s", f->text);
+    }
+}
+
+static size_t put_record(char* out, const Field* fields) {
+    size_t n = 0;
+    int first = 1;
+    out[n++] = '{';
+    for (int k = 0; k < NFIELDS; k++) {
+        if (fields[k].kind == F_MISSING) continue;
+        n += (size_t)sprintf(out + n, "%s\"%s\": ", first ? "" : ", ", k_names[k]);
+        n += put_value(out + n, &fields[k]);
+        first = 0;
+    }
+    out[n++] = '}';
+    return n;
+}
+
+/* Row `row` holds `fields` exactly. */
+static int row_matches(const ajis_shredder* s, size_t row, const Field* fields) {
+    for (int k = 0; k < NFIELDS; k++) {
+        const ajis_column* c = ajis_shred_column(s, k_names[k]);
+        const Field* f = &fields[k];
+        if (!c) {
+            if (f->kind != F_MISSING && f->kind != F_NULL) return 0;
+            continue;
+        }
+        int has = f->kind != F_MISSING && f->kind != F_NULL;
+        if (ajis_column_valid(c, row) != has) return 0;
+        if (!has) continue;
+        switch (c->type) {
+            case AJIS_COLUMN_INT64: if (f->kind != F_INT || c->values.i64[row] != f->i) return 0; break;
+            case AJIS_COLUMN_FLOAT64:
+                if (c->values.f64[row] != (f->kind == F_INT ? (double)f->i : f->f)) return 0;
+                break;
+            case AJIS_COLUMN_BOOL: if (f->kind != F_BOOL || c->values.boolean[row] != f->i) return 0; break;
+            case AJIS_COLUMN_STRING: {
+                char want[32];
+                size_t n = strlen(f->text) - 2;     /* "\t" decodes to one byte */
+                memcpy(want, f->text, n);
+                want[n] = '\t';
+                want[n + 1] = '\0';
+                if (f->kind != F_STRING || !str_is(c, row, want)) return 0;
+                break;
+            }
+            case AJIS_COLUMN_RAW: {
+                char want[64];
+                want[put_value(want, f)] = '\0';
+                if (!str_is(c, row, want)) return 0;
+                break;
+            }
+            default: return 0;
+        }
+    }
+    return 1;
+}
+
+/* Shreds `count` random records (as an array, or one by one) and checks every row and fallback. */
+static void random_run(size_t count, int mix, size_t infer_n, int one_by_one, const ajis_allocator* alloc) {
+    Field* fields = (Field*)malloc(count * NFIELDS * sizeof(Field));
+    size_t* starts = (size_t*)malloc((count + 1) * sizeof(size_t));
+    char* doc = (char*)malloc(count * 256 + 16);
+    size_t len = 0;
+    doc[len++] = '[';
+    for (size_t i = 0; i < count; i++) {
+        for (int k = 0; k < NFIELDS; k++) gen_field(&fields[i * NFIELDS + k], k, mix);
+        if (i) len += (size_t)sprintf(doc + len, ",\n");
+        starts[i] = len;
+        len += put_record(doc + len, &fields[i * NFIELDS]);
+    }
+    starts[count] = len;
+    doc[len++] = ']';
+
+    ajis_shred_options o = infer(infer_n);
+    o.allocator = alloc;
+    ajis_shredder s;
+    ajis_shredder_init(&s, &o);
+    if (one_by_one) {
+        for (size_t i = 0; i < count; i++) {
+            size_t n = (i + 1 < count ? starts[i + 1] - 2 : starts[count]) - starts[i];
+            TEST_ASSERT(ajis_shred_add(&s, doc + starts[i], n, NULL) == AJIS_OK, "add record");
+        }
+        TEST_ASSERT(ajis_shred_finish(&s) == AJIS_OK, "finish");
+    } else {
+        TEST_ASSERT(ajis_shred_array(&s, doc, len, NULL) == AJIS_OK, "shred random array");
+    }
+
+    TEST_ASSERT(s.records == count && s.rows + s.fallback.count == count, "every record placed");
+    size_t row = 0, fb = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (fb < s.fallback.count && s.fallback.records[fb] == i) {
+            size_t n = (size_t)(s.fallback.offsets[fb + 1] - s.fallback.offsets[fb]);
+            size_t want = (i + 1 < count ? starts[i + 1] - 2 : starts[count]) - starts[i];
+            TEST_ASSERT(n == want && memcmp(s.fallback.bytes + s.fallback.offsets[fb], doc + starts[i], n) == 0,
+                        "fallback keeps the record text");
+            fb++;
+        } else {
+            if (!row_matches(&s, row, &fields[i * NFIELDS])) {
+                fprintf(stderr, "record %zu (row %zu) differs\n", i, row);
+                TEST_ASSERT(0, "row matches its record");
+            }
+            row++;
+        }
+    }
+    TEST_ASSERT(row == s.rows && fb == s.fallback.count, "rows and fallbacks in record order");
+    if (!mix) TEST_ASSERT(s.fallback.count == 0, "uniform rows never fall back");
+
+    /* the null slots hold 0, so the sum needs no mask */
+    for (int k = 0; k < NFIELDS; k++) {
+        const ajis_column* c = ajis_shred_column(&s, k_names[k]);
+        if (!c || (c->type != AJIS_COLUMN_INT64 && c->type != AJIS_COLUMN_FLOAT64)) continue;
+        double want = 0;
+        size_t valid = 0;
+        for (size_t r = 0; r < s.rows; r++) {
+            if (!ajis_column_valid(c, r)) continue;
+            want += c->type == AJIS_COLUMN_INT64 ? (double)c->values.i64[r] : c->values.f64[r];
+            valid++;
+        }
+        TEST_ASSERT(ajis_column_sum(c, s.rows) == want, "sum over the column");
+        TEST_ASSERT(valid + c->null_count == s.rows, "null count");
+    }
+    if (mix && count > 1000) TEST_ASSERT(s.fallback.count > 0, "misfits fell back");
+
+    ajis_shredder_destroy(&s);
+    free(fields);
+    free(starts);
+    free(doc);
+}
+
+int main(void) {
+    ajis_error err;
+
+    /* schema inference */
+    {
+        const char* doc =
+            "[ {\"id\": 1, \"name\": \"a\", \"price\": 2, \"tags\": [\"x\"], \"ok\": true},\n"
+            "  {\"id\": 2, \"name\": \"b\\u00e9\", \"price\": 2.5, \"tags\": {}, \"ok\": false},\n"
+            "  // a comment between rows\n"
+            "  {\"name\": null, \"id\": 3, \"price\": null} ]";
+        ajis_shredder s;
+        ajis_shredder_init(&s, NULL);
+        TEST_ASSERT(shred(&s, doc, &err) == AJIS_OK, "shred rows");
+        TEST_ASSERT(s.rows == 3 && s.records == 3 && s.fallback.count == 0 && s.column_count == 5, "3 rows, 5 columns");
+        TEST_ASSERT(strcmp((const char*)s.columns[0].name, "id") == 0 && strcmp((const char*)s.columns[4].name, "ok") == 0,
+                    "columns in order of appearance");
+
+        const ajis_column* id = col(&s, "id");
+        TEST_ASSERT(id->type == AJIS_COLUMN_INT64 && id->values.i64[0] == 1 && id->values.i64[2] == 3 && id->null_count == 0, "int column");
+        const ajis_column* name = col(&s, "name");
+        TEST_ASSERT(name->type == AJIS_COLUMN_STRING && str_is(name, 0, "a") && str_is(name, 1, "b\xc3\xa9"), "string column, decoded");
+        TEST_ASSERT(!ajis_column_valid(name, 2) && str_is(name, 2, "") && name->null_count == 1, "null string");
+        const ajis_column* price = col(&s, "price");
+        TEST_ASSERT(price->type == AJIS_COLUMN_FLOAT64 && price->values.f64[0] == 2.0 && price->values.f64[1] == 2.5, "int + float: float");
+        const ajis_column* tags = col(&s, "tags");
+        TEST_ASSERT(tags->type == AJIS_COLUMN_RAW && str_is(tags, 0, "[\"x\"]") && str_is(tags, 1, "{}") && !ajis_column_valid(tags, 2),
+                    "containers kept as text; missing member");
+        const ajis_column* ok = col(&s, "ok");
+        TEST_ASSERT(ok->type == AJIS_COLUMN_BOOL && ok->values.boolean[0] == 1 && ok->values.boolean[1] == 0, "bool column");
+        TEST_ASSERT(ajis_column_sum(price, s.rows) == 4.5 && ajis_column_sum(id, s.rows) == 6.0, "sums");
+        ajis_shredder_destroy(&s);
+        g_checks += 10;
+        printf("[PASS] schema inference\n");
+    }
+
+    /* mixed scalars -> RAW; all-null -> NULL */
+    {
+        ajis_shredder s;
+        ajis_shredder_init(&s, NULL);
+        TEST_ASSERT(shred(&s, "[{\"v\": 1, \"n\": null}, {\"v\": \"one\"}, {\"v\": 0xFF}]", &err) == AJIS_OK, "shred mixed");
+        const ajis_column* v = col(&s, "v");
+        TEST_ASSERT(v->type == AJIS_COLUMN_RAW && str_is(v, 0, "1") && str_is(v, 1, "\"one\"") && str_is(v, 2, "0xFF"), "mixed: raw text");
+        TEST_ASSERT(col(&s, "n")->type == AJIS_COLUMN_NULL && col(&s, "n")->null_count == 3, "only nulls");
+        ajis_shredder_destroy(&s);
+        g_checks += 2;
+        printf("[PASS] mixed and null columns\n");
+    }
+
+    /* widening after inference */
+    {
+        ajis_shred_options o = infer(2);
+        ajis_shredder s;
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, "[{\"a\": 1, \"b\": null}, {\"a\": 2}, {\"a\": 3.5, \"b\": \"x\"}, {\"a\": 4, \"b\": \"y\"}]", &err) == AJIS_OK,
+                    "shred widening");
+        const ajis_column* a = col(&s, "a");
+        TEST_ASSERT(a->type == AJIS_COLUMN_FLOAT64 && a->values.f64[0] == 1.0 && a->values.f64[1] == 2.0 && a->values.f64[2] == 3.5 &&
+                        a->values.f64[3] == 4.0, "int64 widened to float64 in place");
+        const ajis_column* b = col(&s, "b");
+        TEST_ASSERT(b->type == AJIS_COLUMN_STRING && !ajis_column_valid(b, 0) && !ajis_column_valid(b, 1) && str_is(b, 2, "x") &&
+                        str_is(b, 3, "y"), "null column took the string type");
+        TEST_ASSERT(s.fallback.count == 0, "nothing fell back");
+        ajis_shredder_destroy(&s);
+
+        /* 2^53 + 1 has no double: the column stays INT64 and the float falls back */
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, "[{\"a\": 1}, {\"a\": 9007199254740993}, {\"a\": 3.5}, {\"a\": 4}]", &err) == AJIS_OK,
+                    "shred past 2^53");
+        a = col(&s, "a");
+        TEST_ASSERT(a->type == AJIS_COLUMN_INT64 && s.rows == 3 && a->values.i64[1] == 9007199254740993ll && a->values.i64[2] == 4,
+                    "int64 kept exact");
+        TEST_ASSERT(s.fallback.count == 1 && s.fallback.records[0] == 2 && fallback_is(&s, 0, "{\"a\": 3.5}"), "float fell back");
+        ajis_shredder_destroy(&s);
+
+        /* ... and the other way: into a FLOAT64 column, or inferred beside floats */
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, "[{\"a\": 1.5}, {\"a\": 2}, {\"a\": 9007199254740993}, {\"a\": 9007199254740992}]", &err) == AJIS_OK,
+                    "shred into float64");
+        a = col(&s, "a");
+        TEST_ASSERT(a->type == AJIS_COLUMN_FLOAT64 && s.rows == 3 && a->values.f64[2] == 9007199254740992.0 && s.fallback.count == 1 &&
+                        s.fallback.records[0] == 2, "inexact int fell back, 2^53 kept");
+        ajis_shredder_destroy(&s);
+        ajis_shredder_init(&s, NULL);
+        TEST_ASSERT(shred(&s, "[{\"a\": 1.5}, {\"a\": 9007199254740993}]", &err) == AJIS_OK, "shred inferring");
+        a = col(&s, "a");
+        TEST_ASSERT(a->type == AJIS_COLUMN_RAW && str_is(a, 1, "9007199254740993"), "int + float past 2^53: raw");
+        ajis_shredder_destroy(&s);
+        g_checks += 10;
+        printf("[PASS] widening, exact past 2^53\n");
+    }
+
+    /* fallback */
+    {
+        const char* doc =
+            "[{\"a\": 1, \"s\": \"x\"}, {\"a\": 2, \"s\": \"y\"},\n"
+            " {\"a\": \"two\", \"s\": \"z\"},\n"     /* string in an int column */
+            " {\"a\": 3, \"extra\": 1},\n"            /* member the schema lacks */
+            " {\"a\": 4, \"a\": 5},\n"                /* duplicate member */
+            " [1, 2],\n"                              /* not an object */
+            " {\"a\": 6}]";
+        ajis_shred_options o = infer(2);
+        ajis_shredder s;
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, doc, &err) == AJIS_OK, "shred with misfits");
+        TEST_ASSERT(s.rows == 3 && s.fallback.count == 4 && s.records == 7, "3 rows, 4 fallbacks");
+        TEST_ASSERT(s.fallback.records[0] == 2 && s.fallback.records[1] == 3 && s.fallback.records[2] == 4 && s.fallback.records[3] == 5,
+                    "fallback positions");
+        TEST_ASSERT(fallback_is(&s, 0, "{\"a\": \"two\", \"s\": \"z\"}") && fallback_is(&s, 3, "[1, 2]"), "fallback text");
+        TEST_ASSERT(col(&s, "a")->values.i64[2] == 6 && !ajis_column_valid(col(&s, "s"), 2), "rows skip the fallbacks");
+        ajis_shredder_destroy(&s);
+
+        o.flags = AJIS_SHRED_ADD_COLUMNS;
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, doc, &err) == AJIS_OK && s.fallback.count == 3, "shred adding columns");
+        const ajis_column* extra = col(&s, "extra");
+        TEST_ASSERT(extra->type == AJIS_COLUMN_INT64 && extra->null_count == 3 && ajis_column_valid(extra, 2) && extra->values.i64[2] == 1 &&
+                        !ajis_column_valid(extra, 3), "new column, null before");
+        ajis_shredder_destroy(&s);
+
+        o.max_columns = 2;
+        ajis_shredder_init(&s, &o);
+        TEST_ASSERT(shred(&s, doc, &err) == AJIS_OK && s.column_count == 2 && s.fallback.count == 4, "column limit");
+        ajis_shredder_destroy(&s);
+        g_checks += 8;
+        printf("[PASS] fallback blob\n");
+    }
+
+    /* escaped member names */
+    {
+        ajis_shredder s;
+        ajis_shredder_init(&s, NULL);
+        TEST_ASSERT(shred(&s, "[{\"a\\u0062\": 1}, {\"ab\": 2}]", &err) == AJIS_OK, "shred escaped keys");
+        TEST_ASSERT(s.column_count == 1 && s.rows == 2 && col(&s, "ab")->values.i64[1] == 2, "escaped and plain name match");
+        ajis_shredder_destroy(&s);
+        g_checks += 2;
+        printf("[PASS] escaped names\n");
+    }
+
+    /* errors */
+    {
+        struct { const char* doc; ajis_error_code code; uint32_t line, column; } cases[] = {
+            { "[{\"a\": 1},\n {\"a\": 2,}]", AJIS_ERR_TRAILING_COMMA, 2, 10 },
+            { "[{\"a\": 1}\n {\"a\": 2}]", AJIS_ERR_MISSING_COMMA, 2, 2 },
+            { "[{\"a\" 1}]", AJIS_ERR_MISSING_COLON, 1, 7 },
+            { "[{\"a\": \"\\q\"}]", AJIS_ERR_INVALID_ESCAPE, 1, 9 },
+            { "[{\"a\": [1, 2}]", AJIS_ERR_MISSING_COMMA, 1, 13 },
+            { "{\"a\": 1}", AJIS_ERR_INVALID_SYNTAX, 1, 1 },
+            { "[{\"a\": 1}] 2", AJIS_ERR_INVALID_SYNTAX, 1, 12 },
+            { "[{\"a\": 1}", AJIS_ERR_UNEXPECTED_EOF, 1, 10 },
+        };
+        for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+            ajis_shredder s;
+            ajis_shredder_init(&s, NULL);
+            ajis_error_code rc = shred(&s, cases[i].doc, &err);
+            if (rc != cases[i].code || err.location.line != cases[i].line || err.location.column != cases[i].column) {
+                fprintf(stderr, "%s: %d at %u:%u\n", cases[i].doc, (int)rc, err.location.line, err.location.column);
+            }
+            TEST_ASSERT(rc == cases[i].code && err.location.line == cases[i].line && err.location.column == cases[i].column,
+                        cases[i].doc);
+            ajis_shredder_destroy(&s);
+            g_checks++;
+        }
+
+        ajis_shredder s;
+        ajis_shredder_init(&s, NULL);
+        TEST_ASSERT(ajis_shred_add(&s, "{\"a\": 1} {", 10, &err) == AJIS_ERR_INVALID_SYNTAX && err.location.column == 10, "one value per record");
+        TEST_ASSERT(ajis_shred_add(&s, "  // only a comment", 19, &err) == AJIS_ERR_UNEXPECTED_EOF, "empty record");
+        TEST_ASSERT(ajis_shred_add(&s, "{\"a\": 1}", 8, &err) == AJIS_OK && ajis_shred_finish(&s) == AJIS_OK && s.records == 1,
+                    "failed records are not counted");
+        ajis_shredder_destroy(&s);
+        g_checks += 3;
+        printf("[PASS] errors located\n");
+    }
+
+    /* random rows: every row equals its record */
+    {
+        ajis_slab_pool pool;
+        ajis_slab_pool_init(&pool, NULL);
+        random_run(20000, 0, 1024, 0, NULL);
+        random_run(20000, 1, 64, 0, &pool.allocator);
+        random_run(5000, 1, 16, 1, NULL);
+        random_run(3, 1, 1024, 1, NULL);
+        ajis_slab_pool_destroy(&pool);
+        g_checks += 4;
+        printf("[PASS] random rows match their records\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include "../include/ajis_validate.h"
+#include "test_common.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static int g_checks = 0;
+
+/* ---------------- Helpers ---------------- */
+
+static ajis_error_code check(const char* src, const ajis_validate_options* o, ajis_error* err) {
+    return ajis_validate(src, strlen(src), o, err);
+}
+
+static void expect(const char* src, ajis_error_code code, uint32_t line, uint32_t column) {
+    ajis_validate_options o = ajis_validate_options_default();
+    o.reject_duplicate_keys = 1;
+    ajis_error err;
+    ajis_error_code rc = check(src, &o, &err);
+    if (rc != code || (code != AJIS_OK && (err.location.line != line || err.location.column != column))) {
+        fprintf(stderr, "  input: %s\n  got code=%d at %u:%u, want code=%d at %u:%u\n",
+            src, (int)rc, err.location.line, err.location.column, (int)code, line, column);
+        TEST_ASSERT(0, "unexpected validation result");
+    }
+    TEST_ASSERT(ajis_validate(src, strlen(src), &o, NULL) == code, "result must not depend on err being passed");
+    g_checks += 2;
+}
+
+/* Lex to EOF; returns 1 when the lexer accepts every token. */
+static int lexes(const char* data, size_t len, const ajis_lexer_options* lo) {
+    ajis_input in;
+    ajis_input_init(&in, data, len);
+    ajis_lexer lx;
+    ajis_lexer_init(&lx, &in, *lo);
+    for (;;) {
+        ajis_token tok;
+        ajis_error err;
+        if (ajis_lexer_next(&lx, &tok, &err) != AJIS_OK) return 0;
+        if (tok.type == AJIS_TOKEN_EOF) return 1;
+    }
+}
+
+/* ---------------- Test data tree ---------------- */
+
+typedef struct TreeStats {
+    int files;
+    int mutations;
+} TreeStats;
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint64_t rng_next(void) {
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return g_rng * 0x2545F4914F6CDD1Dull;
+}
+
+/*
+ * Random byte edits of a real file: whatever the validator accepts,
+ * the lexer must accept too (the validator never lets a bad literal
+ * through), and no input may crash it.
+ */
+static void mutate_and_compare(const TestBuffer* b, TreeStats* st) {
+    static const char alphabet[] = "{}[]:,\"\\ \n/*-0123456789.eExtfnul_";
+    ajis_validate_options o = ajis_validate_options_default();
+    o.allow_unknown_escapes = 1; /* lexer-equivalent literal rules */
+
+    char* copy = (char*)malloc(b->size + 1);
+    TEST_ASSERT(copy != NULL, "out of memory");
+    for (int round = 0; round < 40; round++) {
+        memcpy(copy, b->data, b->size);
+        int edits = 1 + (int)(rng_next() % 3);
+        for (int e = 0; e < edits; e++) {
+            size_t at = (size_t)(rng_next() % b->size);
+            copy[at] = alphabet[rng_next() % (sizeof(alphabet) - 1)];
+        }
+        size_t len = b->size - (size_t)(rng_next() % 2); /* sometimes truncate */
+        ajis_error err;
+        if (ajis_validate(copy, len, &o, &err) == AJIS_OK) {
+            TEST_ASSERT(lexes(copy, len, &o.lexer), "validator accepted input the lexer rejects");
+        } else {
+            TEST_ASSERT(err.location.offset <= len, "error offset inside the input");
+        }
+        st->mutations++;
+    }
+    free(copy);
+}
+
+static void run_file(const char* path, TreeStats* st) {
+    TestBuffer b = test_read_file(path);
+    TEST_ASSERT(b.data != NULL, "cannot read test file");
+    if (b.size == 0) {
+        test_free_buffer(&b);
+        return;
+    }
+
+    ajis_validate_options o = ajis_validate_options_default();
+    o.allow_unknown_escapes = 1;
+    ajis_error err;
+    ajis_error_code rc = ajis_validate(b.data, b.size, &o, &err);
+
+    if (strstr(path, "/valid/")) {
+        if (rc != AJIS_OK) fprintf(stderr, "  %s: code=%d at %u:%u\n", path, (int)rc, err.location.line, err.location.column);
+        TEST_ASSERT(rc == AJIS_OK, "valid file rejected");
+    } else if (strstr(path, "/invalid/")) {
+        /* parser_invalid/ holds grammar errors: strict escapes and duplicate keys apply */
+        o.allow_unknown_escapes = 0;
+        o.reject_duplicate_keys = 1;
+        if (ajis_validate(b.data, b.size, &o, &err) == AJIS_OK) fprintf(stderr, "  %s: accepted\n", path);
+        TEST_ASSERT(ajis_validate(b.data, b.size, &o, &err) != AJIS_OK, "invalid file accepted");
+    }
+    if (rc == AJIS_OK) TEST_ASSERT(lexes(b.data, b.size, &o.lexer), "validator and lexer disagree");
+
+    mutate_and_compare(&b, st);
+    st->files++;
+    g_checks += 2;
+    test_free_buffer(&b);
+}
+
+static void run_tree(const char* dir, TreeStats* st) {
+    DIR* d = opendir(dir);
+    TEST_ASSERT(d != NULL, "cannot open test data dir (run from Tools/AJIS/c)");
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+        struct stat sb;
+        if (stat(path, &sb) != 0) continue;
+        if (S_ISDIR(sb.st_mode)) run_tree(path, st);
+        else if (strlen(path) > 5 && strcmp(path + strlen(path) - 5, ".ajis") == 0) run_file(path, st);
+    }
+    closedir(d);
+}
+
+/* ---------------- Main ---------------- */
+
+int main(void) {
+    /* accepted documents */
+    expect("null", AJIS_OK, 0, 0);
+    expect("  [1, -2.5e3, \"a\\n\\u00e9\", true, false, null, {}, []]  ", AJIS_OK, 0, 0);
+    expect("{\"a\": {\"b\": [1, {\"c\": hex\"00FF\"}]}, \"d\": b64\"AQID\"}", AJIS_OK, 0, 0);
+    expect("// leading\n/* block */ [1 /* inner */, 2] // trailing", AJIS_OK, 0, 0);
+    expect("[1_000_000, 1,000, 0xFF_FF, 0b1010_1010, 0o17]", AJIS_OK, 0, 0);
+    expect("[1,2,3]", AJIS_OK, 0, 0);
+    expect("{\"a\": 1, \"b\": {\"a\": 2}}", AJIS_OK, 0, 0); /* same key in different objects */
+    printf("[PASS] accepted documents\n");
+
+    /* grammar errors: code and position */
+    expect("", AJIS_ERR_UNEXPECTED_EOF, 1, 1);
+    expect("[1, 2, 3", AJIS_ERR_UNEXPECTED_EOF, 1, 9);
+    expect("{\"key\": \"value\"", AJIS_ERR_UNEXPECTED_EOF, 1, 16);
+    expect("[1 2]", AJIS_ERR_MISSING_COMMA, 1, 4);
+    expect("[1, 2, 3,]", AJIS_ERR_TRAILING_COMMA, 1, 10);
+    expect("{\"a\": 1,}", AJIS_ERR_TRAILING_COMMA, 1, 9);
+    expect("[1,,2]", AJIS_ERR_INVALID_SYNTAX, 1, 4);
+    expect("[,1]", AJIS_ERR_INVALID_SYNTAX, 1, 2);
+    expect("{,}", AJIS_ERR_INVALID_SYNTAX, 1, 2);
+    expect("{\"key\" \"value\"}", AJIS_ERR_MISSING_COLON, 1, 8);
+    expect("{1: 2}", AJIS_ERR_INVALID_SYNTAX, 1, 2);
+    expect("[1}", AJIS_ERR_INVALID_SYNTAX, 1, 3);
+    expect("1 2", AJIS_ERR_INVALID_SYNTAX, 1, 3);
+    expect("{\"a\": 1, \"a\": 2}", AJIS_ERR_DUPLICATE_KEY, 1, 10);
+    expect("{\n  \"x\": [\n    1,\n    2\n  ]\n  \"y\": 3\n}", AJIS_ERR_MISSING_COMMA, 6, 3);
+    printf("[PASS] grammar errors\n");
+
+    /* literal errors agree with the lexer */
+    expect("\"invalid escape \\q\"", AJIS_ERR_INVALID_ESCAPE, 1, 17);
+    expect("\"incomplete \\u12\"", AJIS_ERR_INVALID_ESCAPE, 1, 13);
+    expect("\"unterminated", AJIS_ERR_UNEXPECTED_EOF, 1, 14);
+    expect("\"line\nbreak\"", AJIS_ERR_INVALID_STRING, 1, 6);
+    expect("[01]", AJIS_ERR_INVALID_NUMBER, 1, 2);
+    expect("[1.]", AJIS_ERR_INVALID_NUMBER, 1, 4);
+    expect("[1e+]", AJIS_ERR_INVALID_NUMBER, 1, 5);
+    expect("[0xG]", AJIS_ERR_INVALID_HEX, 1, 4);
+    expect("[hex\"ABC\"]", AJIS_ERR_INVALID_STRING, 1, 10);
+    expect("[truex]", AJIS_ERR_INVALID_TOKEN, 1, 2);
+    expect("[1] /* open", AJIS_ERR_UNTERMINATED_COMMENT, 1, 12);
+    expect("[@]", AJIS_ERR_INVALID_TOKEN, 1, 2);
+    printf("[PASS] literal errors\n");
+
+    /* options */
+    {
+        ajis_validate_options o = ajis_validate_options_default();
+        ajis_error err;
+        TEST_ASSERT(check("{\"a\": 1, \"a\": 2}", &o, &err) == AJIS_OK, "duplicates allowed by default");
+        o.allow_unknown_escapes = 1;
+        TEST_ASSERT(check("\"C:\\Users\\file\"", &o, &err) == AJIS_OK, "lenient escapes");
+        o.lexer.allow_multiline_strings = 1;
+        TEST_ASSERT(check("\"line\nbreak\"", &o, &err) == AJIS_OK, "multiline strings");
+        o.lexer.allow_number_separators = 0;
+        TEST_ASSERT(check("[1_000]", &o, &err) != AJIS_OK, "separators disabled");
+        TEST_ASSERT(check("[1 234]", &o, &err) == AJIS_ERR_MISSING_COMMA, "space is not a separator");
+        g_checks += 5;
+
+        char deep[1200];
+        for (int i = 0; i < 600; i++) { deep[i] = '['; deep[1199 - i] = ']'; }
+        o = ajis_validate_options_default();
+        TEST_ASSERT(ajis_validate(deep, 512, &o, &err) == AJIS_ERR_DEPTH_LIMIT && err.location.column == 257, "default depth 256");
+        o.max_depth = 600;
+        TEST_ASSERT(ajis_validate(deep, sizeof(deep), &o, &err) == AJIS_OK, "raised depth limit");
+        o.max_depth = 599;
+        TEST_ASSERT(ajis_validate(deep, sizeof(deep), &o, &err) == AJIS_ERR_DEPTH_LIMIT, "depth limit");
+        g_checks += 3;
+
+        /* many keys: forces the key table to grow */
+        o = ajis_validate_options_default();
+        o.reject_duplicate_keys = 1;
+        char* big = (char*)malloc(20000 * 16 + 16);
+        TEST_ASSERT(big != NULL, "out of memory");
+        size_t n = 0;
+        big[n++] = '{';
+        for (int i = 0; i < 20000; i++) n += (size_t)sprintf(big + n, "%s\"k%d\":%d", i ? "," : "", i, i);
+        big[n++] = '}';
+        TEST_ASSERT(ajis_validate(big, n, &o, &err) == AJIS_OK, "20000 distinct keys");
+        n--; /* drop '}' and repeat an early key */
+        n += (size_t)sprintf(big + n, ",\"k7\":1}");
+        TEST_ASSERT(ajis_validate(big, n, &o, &err) == AJIS_ERR_DUPLICATE_KEY, "repeated key found");
+        free(big);
+        g_checks += 2;
+        printf("[PASS] options\n");
+    }
+
+    TreeStats st = {0, 0};
+    run_tree("tests/test_data", &st);
+    TEST_ASSERT(st.files > 100, "test data tree not found");
+    printf("[PASS] test data tree: %d files, %d mutated inputs\n", st.files, st.mutations);
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
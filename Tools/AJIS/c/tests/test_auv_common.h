@@ -0,0 +1,60 @@
+#ifndef AJIS_TEST_AUV_COMMON_H
+#define AJIS_TEST_AUV_COMMON_H
+
+#include "../include/auv_wire.h"
+
+#include <string.h>
+
+/* ---------------- Tiny wire builder ---------------- */
+
+typedef struct Wire {
+    uint8_t data[1024];
+    size_t len;
+} Wire;
+
+static inline void w_record(Wire* w, auv_tag tag, const void* payload, size_t len) {
+    w->data[w->len++] = (uint8_t)tag;
+    w->len += auv_varuint_write(w->data + w->len, len);
+    memcpy(w->data + w->len, payload, len);
+    w->len += len;
+}
+
+static inline void w_u64(Wire* w, auv_tag tag, uint64_t v) {
+    uint8_t le[8];
+    for (int i = 0; i < 8; i++) le[i] = (uint8_t)(v >> (8 * i));
+    w_record(w, tag, le, 8);
+}
+
+static inline Wire v_null(void)            { Wire w = {{0}, 0}; w_record(&w, AUV_TAG_NULL, "", 0); return w; }
+static inline Wire v_bool(int b)           { Wire w = {{0}, 0}; uint8_t x = (uint8_t)b; w_record(&w, AUV_TAG_BOOL, &x, 1); return w; }
+static inline Wire v_int(int64_t v)        { Wire w = {{0}, 0}; w_u64(&w, AUV_TAG_INT64, (uint64_t)v); return w; }
+static inline Wire v_bits(uint64_t bits)   { Wire w = {{0}, 0}; w_u64(&w, AUV_TAG_FLOAT64, bits); return w; }
+static inline Wire v_str(const char* s, size_t n) { Wire w = {{0}, 0}; w_record(&w, AUV_TAG_STRING, s, n); return w; }
+static inline Wire v_bin(const char* s, size_t n) { Wire w = {{0}, 0}; w_record(&w, AUV_TAG_BINARY, s, n); return w; }
+
+static inline Wire v_dbl(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    return v_bits(bits);
+}
+
+static inline Wire v_char(uint32_t cp) {
+    Wire w = {{0}, 0};
+    uint8_t le[4] = { (uint8_t)cp, (uint8_t)(cp >> 8), (uint8_t)(cp >> 16), (uint8_t)(cp >> 24) };
+    w_record(&w, AUV_TAG_CHAR, le, 4);
+    return w;
+}
+
+/* Container from already-encoded children (for objects: key, value, key, value...) */
+static inline Wire v_container(auv_tag tag, const Wire* items, size_t count) {
+    Wire body = {{0}, 0};
+    for (size_t i = 0; i < count; i++) {
+        memcpy(body.data + body.len, items[i].data, items[i].len);
+        body.len += items[i].len;
+    }
+    Wire w = {{0}, 0};
+    w_record(&w, tag, body.data, body.len);
+    return w;
+}
+
+#endif
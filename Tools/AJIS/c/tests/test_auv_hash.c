@@ -0,0 +1,125 @@
+#include "../include/auv_hash.h"
+#include "test_common.h"
+#include "test_auv_common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static uint64_t hash_of(const Wire* w) {
+    uint64_t h = 0;
+    auv_error err;
+    TEST_ASSERT(auv_hash_value(w->data, w->len, 0, &h, &err) == AUV_OK, "auv_hash_value failed on a valid value");
+    return h;
+}
+
+static int equal_of(const Wire* a, const Wire* b, unsigned flags) {
+    int eq = -1;
+    auv_error err;
+    TEST_ASSERT(auv_equal(a->data, a->len, b->data, b->len, flags, &eq, &err) == AUV_OK, "auv_equal failed on valid values");
+    return eq;
+}
+
+static void expect_same(const Wire* a, const Wire* b, const char* what) {
+    TEST_ASSERT(equal_of(a, b, 0) == 1, what);
+    TEST_ASSERT(hash_of(a) == hash_of(b), what);
+    g_checks += 2;
+    printf("[PASS] same: %s\n", what);
+}
+
+static void expect_different(const Wire* a, const Wire* b, const char* what) {
+    TEST_ASSERT(equal_of(a, b, 0) == 0, what);
+    TEST_ASSERT(equal_of(a, b, AUV_EQ_CANONICAL) == 0, what);
+    TEST_ASSERT(hash_of(a) != hash_of(b), what);
+    g_checks += 3;
+    printf("[PASS] different: %s\n", what);
+}
+
+int main(void) {
+    /* frozen vectors: persisted hashes must never change */
+    TEST_ASSERT(auv_hash_bytes("", 0, 0) == 0x0409638ee2bde459ull, "frozen vector: empty");
+    TEST_ASSERT(auv_hash_bytes("abc", 3, 0) == 0x02a4f1d7cb516c72ull, "frozen vector: abc");
+    TEST_ASSERT(auv_hash_bytes("The quick brown fox jumps over the lazy dog, repeatedly and at length.", 70, 0)
+                == 0x269a904f676c9974ull, "frozen vector: 70 bytes");
+    TEST_ASSERT(auv_hash_bytes("a", 1, 0) != auv_hash_bytes("a", 1, 1), "seed must change the hash");
+    {
+        /* every length class (0, 1-3, 4-16, 17-48, >48) hashes differently from its neighbour */
+        char buf[130];
+        for (int i = 0; i < 130; i++) buf[i] = (char)('a' + i % 26);
+        for (size_t n = 1; n < sizeof(buf); n++) {
+            TEST_ASSERT(auv_hash_bytes(buf, n, 7) != auv_hash_bytes(buf, n - 1, 7), "length must affect the hash");
+        }
+        g_checks += (int)sizeof(buf);
+    }
+    printf("[PASS] byte hash basics\n");
+
+    /* scalars */
+    Wire pz = v_dbl(0.0), nz = v_dbl(-0.0);
+    expect_same(&pz, &nz, "+0.0 and -0.0");
+    Wire nan1 = v_bits(AUV_CANONICAL_NAN_BITS), nan2 = v_bits(0xFFF8000000000123ull);
+    expect_same(&nan1, &nan2, "NaN payloads");
+    Wire i1 = v_int(1), i2 = v_int(2), d1 = v_dbl(1.0);
+    expect_different(&i1, &i2, "int64 1 vs 2");
+    expect_different(&i1, &d1, "int64 1 vs float64 1.0 (different types)");
+    Wire s = v_str("abc", 3), b = v_bin("abc", 3);
+    expect_different(&s, &b, "string vs binary with same bytes");
+
+    /* arrays are ordered */
+    Wire e12[] = { v_int(1), v_int(2) };
+    Wire e21[] = { v_int(2), v_int(1) };
+    Wire a12 = v_container(AUV_TAG_ARRAY, e12, 2), a21 = v_container(AUV_TAG_ARRAY, e21, 2);
+    expect_different(&a12, &a21, "array order matters");
+    Wire ez[] = { v_int(1), v_dbl(-0.0) };
+    Wire ep[] = { v_int(1), v_dbl(0.0) };
+    Wire az = v_container(AUV_TAG_ARRAY, ez, 2), ap = v_container(AUV_TAG_ARRAY, ep, 2);
+    expect_same(&az, &ap, "nested signed zero");
+
+    /* objects are unordered */
+    Wire abc[] = { v_str("a", 1), v_int(1), v_str("b", 1), v_int(2), v_str("c", 1), v_int(3) };
+    Wire cab[] = { v_str("c", 1), v_int(3), v_str("a", 1), v_int(1), v_str("b", 1), v_int(2) };
+    Wire abd[] = { v_str("a", 1), v_int(1), v_str("b", 1), v_int(2), v_str("d", 1), v_int(3) };
+    Wire swap[] = { v_str("a", 1), v_int(2), v_str("b", 1), v_int(1), v_str("c", 1), v_int(3) };
+    Wire o_abc = v_container(AUV_TAG_OBJECT, abc, 6);
+    Wire o_cab = v_container(AUV_TAG_OBJECT, cab, 6);
+    Wire o_abd = v_container(AUV_TAG_OBJECT, abd, 6);
+    Wire o_swap = v_container(AUV_TAG_OBJECT, swap, 6);
+    expect_same(&o_abc, &o_cab, "object key order");
+    expect_different(&o_abc, &o_abd, "object key sets differ");
+    expect_different(&o_abc, &o_swap, "object values swapped between keys");
+
+    /* larger object to exercise the sorted lookup path */
+    {
+        Wire fwd[40], rev[40];
+        char names[20][3];
+        for (int i = 0; i < 20; i++) {
+            names[i][0] = 'k';
+            names[i][1] = (char)('A' + i);
+            fwd[2 * i] = v_str(names[i], 2);
+            fwd[2 * i + 1] = v_int(i);
+            rev[2 * (19 - i)] = v_str(names[i], 2);
+            rev[2 * (19 - i) + 1] = v_int(i);
+        }
+        Wire of = v_container(AUV_TAG_OBJECT, fwd, 40), orv = v_container(AUV_TAG_OBJECT, rev, 40);
+        expect_same(&of, &orv, "20-key object in reverse order");
+        TEST_ASSERT(equal_of(&of, &orv, AUV_EQ_CANONICAL) == 0, "canonical mode trusts key order");
+        g_checks++;
+    }
+
+    /* framing errors are reported */
+    {
+        Wire bad = v_int(5);
+        bad.len--; /* truncated payload */
+        uint64_t h;
+        int eq;
+        auv_error err;
+        TEST_ASSERT(auv_hash_value(bad.data, bad.len, 0, &h, &err) == AUV_ERR_TRUNCATED, "truncated value must be rejected");
+        TEST_ASSERT(auv_equal(bad.data, bad.len, i1.data, i1.len, 0, &eq, &err) == AUV_ERR_TRUNCATED, "truncated value must be rejected");
+        g_checks += 2;
+        printf("[PASS] error handling\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
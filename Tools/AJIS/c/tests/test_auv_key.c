@@ -0,0 +1,134 @@
+#include "../include/auv_key.h"
+#include "test_common.h"
+#include "test_auv_common.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/* ---------------- Checks ---------------- */
+
+typedef struct Key {
+    uint8_t data[1024];
+    size_t len;
+} Key;
+
+static Key key_of(const Wire* w) {
+    Key k;
+    auv_error err;
+    auv_error_code rc = auv_key_encode(w->data, w->len, k.data, sizeof(k.data), &k.len, &err);
+    TEST_ASSERT(rc == AUV_OK, "auv_key_encode failed on a valid value");
+    return k;
+}
+
+static int key_cmp(const Key* a, const Key* b) {
+    size_t n = a->len < b->len ? a->len : b->len;
+    int c = memcmp(a->data, b->data, n);
+    if (c != 0) return c;
+    return (a->len > b->len) - (a->len < b->len);
+}
+
+static int g_checks = 0;
+
+static void expect_ascending(const Wire* values, size_t count, const char* what) {
+    for (size_t i = 1; i < count; i++) {
+        Key a = key_of(&values[i - 1]);
+        Key b = key_of(&values[i]);
+        if (key_cmp(&a, &b) >= 0) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "%s: value %zu does not sort below value %zu", what, i - 1, i);
+            test_fail(msg, __FILE__, __LINE__);
+        }
+        g_checks++;
+    }
+    printf("[PASS] ordering: %s\n", what);
+}
+
+static void expect_equal(const Wire* a, const Wire* b, const char* what) {
+    Key ka = key_of(a);
+    Key kb = key_of(b);
+    TEST_ASSERT(key_cmp(&ka, &kb) == 0, what);
+    g_checks++;
+    printf("[PASS] equal: %s\n", what);
+}
+
+int main(void) {
+    /* type precedence + scalars */
+    Wire scalars[] = {
+        v_null(),
+        v_bool(0), v_bool(1),
+        v_int(INT64_MIN), v_int(-1), v_int(0), v_int(1), v_int(INT64_MAX),
+        v_dbl(-INFINITY), v_dbl(-1e300), v_dbl(-1.5), v_dbl(-1e-300), v_dbl(0.0), v_dbl(1e-300),
+        v_dbl(1.5), v_dbl(1e300), v_dbl(INFINITY), v_bits(AUV_CANONICAL_NAN_BITS),
+        v_char(0), v_char('A'), v_char(0x10FFFF),
+        v_str("", 0), v_str("\0", 1), v_str("\0\0", 2), v_str("a", 1), v_str("a\0", 2), v_str("ab", 2), v_str("b", 1),
+        v_bin("", 0), v_bin("\0", 1), v_bin("\xff", 1),
+    };
+    expect_ascending(scalars, sizeof(scalars) / sizeof(scalars[0]), "scalars and type precedence");
+
+    /* arrays: lexicographic by elements, shorter prefix first */
+    Wire n1[] = { v_null() };
+    Wire n2[] = { v_null(), v_null() };
+    Wire i1[] = { v_int(1) };
+    Wire i2[] = { v_int(2) };
+    Wire s1[] = { v_str("z", 1) };
+    Wire arrays[] = {
+        v_container(AUV_TAG_ARRAY, NULL, 0),
+        v_container(AUV_TAG_ARRAY, n1, 1),
+        v_container(AUV_TAG_ARRAY, n2, 2),
+        v_container(AUV_TAG_ARRAY, i1, 1),
+        v_container(AUV_TAG_ARRAY, i2, 1),
+        v_container(AUV_TAG_ARRAY, s1, 1),
+    };
+    expect_ascending(arrays, sizeof(arrays) / sizeof(arrays[0]), "arrays");
+
+    /* objects: key list first, then values in key order */
+    Wire a1[] = { v_str("a", 1), v_int(1) };
+    Wire a2[] = { v_str("a", 1), v_int(2) };
+    Wire ab[] = { v_str("a", 1), v_int(9), v_str("b", 1), v_int(0) };
+    Wire ba[] = { v_str("b", 1), v_int(0), v_str("a", 1), v_int(9) };
+    Wire b0[] = { v_str("b", 1), v_null() };
+    Wire objects[] = {
+        v_container(AUV_TAG_OBJECT, NULL, 0),
+        v_container(AUV_TAG_OBJECT, a1, 2),
+        v_container(AUV_TAG_OBJECT, a2, 2),
+        v_container(AUV_TAG_OBJECT, ab, 4),
+        v_container(AUV_TAG_OBJECT, b0, 2),
+    };
+    expect_ascending(objects, sizeof(objects) / sizeof(objects[0]), "objects");
+
+    /* nested values sort after every scalar and array sorts below object */
+    Wire mixed[] = { v_str("zz", 2), v_container(AUV_TAG_ARRAY, NULL, 0), v_container(AUV_TAG_OBJECT, NULL, 0) };
+    expect_ascending(mixed, 3, "containers after scalars");
+
+    /* semantic equalities */
+    Wire pz = v_dbl(0.0), nz = v_dbl(-0.0);
+    expect_equal(&pz, &nz, "+0.0 == -0.0");
+    Wire nan1 = v_bits(AUV_CANONICAL_NAN_BITS), nan2 = v_bits(0xFFF0000000000001ull);
+    expect_equal(&nan1, &nan2, "NaN payloads fold to canonical NaN");
+    Wire o_ab = v_container(AUV_TAG_OBJECT, ab, 4), o_ba = v_container(AUV_TAG_OBJECT, ba, 4);
+    expect_equal(&o_ab, &o_ba, "object key order does not matter");
+
+    /* errors */
+    {
+        Wire dup[] = { v_str("a", 1), v_int(1), v_str("a", 1), v_int(2) };
+        Wire o = v_container(AUV_TAG_OBJECT, dup, 4);
+        size_t len = 0;
+        auv_error err;
+        TEST_ASSERT(auv_key_encode(o.data, o.len, NULL, 0, &len, &err) == AUV_ERR_DUPLICATE_KEY, "duplicate key must be rejected");
+
+        Wire bad = v_int(5);
+        bad.data[1] = 7; /* wrong fixed length */
+        TEST_ASSERT(auv_key_encode(bad.data, bad.len, NULL, 0, &len, &err) != AUV_OK, "bad int64 length must be rejected");
+
+        Wire s = v_str("hello", 5);
+        uint8_t tiny[2];
+        TEST_ASSERT(auv_key_encode(s.data, s.len, tiny, sizeof(tiny), &len, &err) == AUV_ERR_BUFFER_TOO_SMALL, "small buffer must be reported");
+        TEST_ASSERT(len == 1 + 5 + 2, "required length must be reported");
+        g_checks += 4;
+        printf("[PASS] error handling\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
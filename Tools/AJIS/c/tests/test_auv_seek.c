@@ -0,0 +1,175 @@
+#include "../include/auv_seek.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* ---------------- Growable wire builder (large containers) ---------------- */
+
+typedef struct Big {
+    uint8_t* data;
+    size_t len;
+    size_t cap;
+} Big;
+
+static void big_put(Big* b, const void* p, size_t n) {
+    if (b->len + n > b->cap) {
+        b->cap = (b->cap + n) * 2;
+        b->data = (uint8_t*)realloc(b->data, b->cap);
+        TEST_ASSERT(b->data != NULL, "out of memory");
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void big_record(Big* b, auv_tag tag, const void* payload, size_t len) {
+    uint8_t hdr[11];
+    hdr[0] = (uint8_t)tag;
+    size_t h = 1 + auv_varuint_write(hdr + 1, len);
+    big_put(b, hdr, h);
+    big_put(b, payload, len);
+}
+
+static void big_int(Big* b, int64_t v) {
+    uint8_t le[8];
+    for (int i = 0; i < 8; i++) le[i] = (uint8_t)((uint64_t)v >> (8 * i));
+    big_record(b, AUV_TAG_INT64, le, 8);
+}
+
+static void key_name(char* out, size_t cap, int i) {
+    snprintf(out, cap, "key_%06d", i);
+}
+
+static Big wrap(auv_tag tag, Big* body) {
+    Big w = {0};
+    big_record(&w, tag, body->data, body->len);
+    free(body->data);
+    return w;
+}
+
+static int g_checks = 0;
+
+int main(void) {
+    auv_error err;
+
+    /* ---- array: at(i) ---- */
+    {
+        const int n = 100000;
+        Big body = {0};
+        for (int i = 0; i < n; i++) big_int(&body, (int64_t)i * 3);
+        Big arr = wrap(AUV_TAG_ARRAY, &body);
+
+        auv_seek_index idx;
+        TEST_ASSERT(auv_seek_build(arr.data, arr.len, 0, &idx, &err) == AUV_OK, "build array index");
+        TEST_ASSERT(idx.count == (uint64_t)n, "element count");
+        TEST_ASSERT(idx.sample_count == (uint64_t)(n + AUV_SEEK_DEFAULT_STRIDE - 1) / AUV_SEEK_DEFAULT_STRIDE, "sample count");
+
+        for (int i = 0; i < n; i += 997) {
+            auv_record r;
+            TEST_ASSERT(auv_seek_at(&idx, arr.data, arr.len, (uint64_t)i, &r, &err) == AUV_OK, "at(i)");
+            TEST_ASSERT(r.tag == AUV_TAG_INT64 && (int64_t)auv_load_u64le(r.payload) == (int64_t)i * 3, "at(i) value");
+            g_checks++;
+        }
+        auv_record r;
+        TEST_ASSERT(auv_seek_at(&idx, arr.data, arr.len, (uint64_t)n - 1, &r, &err) == AUV_OK, "last element");
+        TEST_ASSERT(auv_seek_at(&idx, arr.data, arr.len, (uint64_t)n, &r, &err) == AUV_ERR_OUT_OF_RANGE, "past the end");
+
+        /* persisted round trip */
+        size_t need = auv_seek_serialized_size(&idx), got = 0;
+        uint8_t* blob = (uint8_t*)malloc(need);
+        TEST_ASSERT(auv_seek_serialize(&idx, blob, need, &got, &err) == AUV_OK && got == need, "serialize");
+        auv_seek_index loaded;
+        TEST_ASSERT(auv_seek_load(blob, got, &loaded, &err) == AUV_OK, "load");
+        TEST_ASSERT(auv_seek_at(&loaded, arr.data, arr.len, 54321, &r, &err) == AUV_OK, "at(i) via loaded index");
+        TEST_ASSERT(auv_load_u64le(r.payload) == 54321 * 3, "loaded index value");
+
+        blob[need / 2] ^= 0x40;
+        TEST_ASSERT(auv_seek_load(blob, got, &loaded, &err) == AUV_ERR_INDEX_MISMATCH, "corruption detected");
+
+        /* index must refuse a different container */
+        Big other = {0};
+        big_int(&other, 1);
+        Big other_arr = wrap(AUV_TAG_ARRAY, &other);
+        TEST_ASSERT(auv_seek_at(&idx, other_arr.data, other_arr.len, 0, &r, &err) == AUV_ERR_INDEX_MISMATCH, "mismatch detected");
+
+        free(other_arr.data);
+        free(blob);
+        auv_seek_free(&idx);
+        free(arr.data);
+        g_checks += 8;
+        printf("[PASS] array at(i), persistence, mismatch detection\n");
+    }
+
+    /* ---- sorted object: find(key) ---- */
+    {
+        const int n = 5000;
+        Big body = {0};
+        char name[32];
+        for (int i = 0; i < n; i++) {
+            key_name(name, sizeof(name), i * 2); /* even numbers only, so odd probes miss */
+            big_record(&body, AUV_TAG_STRING, name, strlen(name));
+            big_int(&body, i);
+        }
+        Big obj = wrap(AUV_TAG_OBJECT, &body);
+
+        auv_seek_index idx;
+        TEST_ASSERT(auv_seek_build(obj.data, obj.len, 16, &idx, &err) == AUV_OK, "build object index");
+        TEST_ASSERT(idx.flags & AUV_SEEK_SORTED_KEYS, "sorted keys detected");
+
+        for (int i = 0; i < 2 * n; i++) {
+            int found = -1;
+            auv_record v;
+            key_name(name, sizeof(name), i);
+            TEST_ASSERT(auv_seek_find(&idx, obj.data, obj.len, (const uint8_t*)name, strlen(name), &found, &v, &err) == AUV_OK, "find");
+            if (i % 2 == 0) {
+                TEST_ASSERT(found == 1 && (int)auv_load_u64le(v.payload) == i / 2, "present key found with its value");
+            } else {
+                TEST_ASSERT(found == 0, "absent key not found");
+            }
+            g_checks++;
+        }
+        int found = -1;
+        auv_record v;
+        TEST_ASSERT(auv_seek_find(&idx, obj.data, obj.len, (const uint8_t*)"a", 1, &found, &v, &err) == AUV_OK && !found, "below first key");
+        TEST_ASSERT(auv_seek_find(&idx, obj.data, obj.len, (const uint8_t*)"zzz", 3, &found, &v, &err) == AUV_OK && !found, "above last key");
+
+        auv_record k;
+        TEST_ASSERT(auv_seek_key_at(&idx, obj.data, obj.len, 1234, &k, &err) == AUV_OK, "key_at");
+        key_name(name, sizeof(name), 2468);
+        TEST_ASSERT(k.length == strlen(name) && memcmp(k.payload, name, k.length) == 0, "key_at value");
+
+        auv_seek_free(&idx);
+        free(obj.data);
+        g_checks += 4;
+        printf("[PASS] sorted object find(key)\n");
+    }
+
+    /* ---- unsorted object: still correct, linear lookup ---- */
+    {
+        Big body = {0};
+        const char* keys[] = { "m", "b", "z", "a" };
+        for (int i = 0; i < 4; i++) {
+            big_record(&body, AUV_TAG_STRING, keys[i], 1);
+            big_int(&body, i);
+        }
+        Big obj = wrap(AUV_TAG_OBJECT, &body);
+
+        auv_seek_index idx;
+        TEST_ASSERT(auv_seek_build(obj.data, obj.len, 2, &idx, &err) == AUV_OK, "build unsorted object index");
+        TEST_ASSERT((idx.flags & AUV_SEEK_SORTED_KEYS) == 0, "unsorted keys detected");
+        for (int i = 0; i < 4; i++) {
+            int found = -1;
+            auv_record v;
+            TEST_ASSERT(auv_seek_find(&idx, obj.data, obj.len, (const uint8_t*)keys[i], 1, &found, &v, &err) == AUV_OK, "find");
+            TEST_ASSERT(found == 1 && (int)auv_load_u64le(v.payload) == i, "unsorted find value");
+            g_checks++;
+        }
+        auv_seek_free(&idx);
+        free(obj.data);
+        printf("[PASS] unsorted object find(key)\n");
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,571 @@
+/*
+ * AJIS lexer benchmark
+ *
+ * Generates deterministic corpora (one per workload kind), lexes each
+ * one repeatedly and reports throughput. On Linux, hardware counters
+ * (cycles, instructions, branch misses) are read via perf_event_open
+ * when the kernel allows it; otherwise those columns are reported as -1.
+ *
+ * With --validate the same corpora are checked by ajis_validate()
+ * (fused lexing + grammar, no tokens) instead of the token loop.
+ *
+ * Build (from Tools/AJIS/c):
+ *   gcc -O2 -pthread -I include src/ajis_lexer.c src/ajis_validate.c src/ajis_intern.c src/ajis_string.c src/ajis_alloc.c tests/test_data/benchmarks/bench_lexer.c -o bin/bench_lexer
+ *
+ * Typical use:
+ *   ./bin/bench_lexer --size 16 --format csv --out bench.csv
+ *   ./bin/bench_lexer --size 16 --baseline bench.csv --tolerance 5
+ */
+
+#define _GNU_SOURCE
+#include "../../../include/ajis_lexer.h"
+#include "../../../include/ajis_validate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* ---------------- Deterministic corpus generator ---------------- */
+
+typedef enum BenchKind {
+    KIND_NUMBERS,
+    KIND_STRINGS,
+    KIND_NESTED,
+    KIND_COMMENTS,
+    KIND_SEPARATORS,
+    KIND_BINARY,
+    KIND_COUNT
+} BenchKind;
+
+static const char* kind_name(BenchKind k) {
+    switch (k) {
+        case KIND_NUMBERS:    return "numbers";
+        case KIND_STRINGS:    return "strings";
+        case KIND_NESTED:     return "nested";
+        case KIND_COMMENTS:   return "comments";
+        case KIND_SEPARATORS: return "separators";
+        case KIND_BINARY:     return "binary";
+        default:              return "unknown";
+    }
+}
+
+typedef struct Corpus {
+    char*  data;
+    size_t len;
+    size_t cap;
+} Corpus;
+
+static void corpus_put(Corpus* c, const char* s, size_t n) {
+    if (c->len + n + 1 > c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 1 << 16;
+        while (cap < c->len + n + 1) cap *= 2;
+        char* p = (char*)realloc(c->data, cap);
+        if (!p) {
+            fprintf(stderr, "[BENCH] Out of memory generating corpus\n");
+            exit(2);
+        }
+        c->data = p;
+        c->cap = cap;
+    }
+    memcpy(c->data + c->len, s, n);
+    c->len += n;
+    c->data[c->len] = '\0';
+}
+
+static void corpus_puts(Corpus* c, const char* s) {
+    corpus_put(c, s, strlen(s));
+}
+
+/* xorshift64*: fixed seed -> identical corpus on every run and machine */
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rng_next(void) {
+    g_rng ^= g_rng >> 12;
+    g_rng ^= g_rng << 25;
+    g_rng ^= g_rng >> 27;
+    return g_rng * 0x2545F4914F6CDD1Dull;
+}
+
+static unsigned rng_below(unsigned n) {
+    return (unsigned)(rng_next() % n);
+}
+
+static void gen_number(Corpus* c) {
+    char buf[64];
+    switch (rng_below(5)) {
+        case 0: snprintf(buf, sizeof(buf), "%u", rng_below(1000000)); break;
+        case 1: snprintf(buf, sizeof(buf), "-%u.%03u", rng_below(100000), rng_below(1000)); break;
+        case 2: snprintf(buf, sizeof(buf), "%u.%ue%d", rng_below(10), rng_below(100000), (int)rng_below(600) - 300); break;
+        case 3: snprintf(buf, sizeof(buf), "0x%X", rng_below(0xFFFFFF)); break;
+        default: snprintf(buf, sizeof(buf), "0o%o", rng_below(0777777)); break;
+    }
+    corpus_puts(c, buf);
+}
+
+static void gen_separated_number(Corpus* c) {
+    char buf[64];
+    switch (rng_below(4)) {
+        case 0: snprintf(buf, sizeof(buf), "%u_%03u_%03u", 1 + rng_below(999), rng_below(1000), rng_below(1000)); break;
+        case 1: snprintf(buf, sizeof(buf), "%u %03u", 1 + rng_below(999), rng_below(1000)); break;
+        case 2: snprintf(buf, sizeof(buf), "0x%04X_%04X", rng_below(0x10000), rng_below(0x10000)); break;
+        default: snprintf(buf, sizeof(buf), "0b1010_%u%u%u%u", rng_below(2), rng_below(2), rng_below(2), rng_below(2)); break;
+    }
+    corpus_puts(c, buf);
+}
+
+static void gen_string(Corpus* c) {
+    static const char* pieces[] = { "lorem", "ipsum", " ", "\\n", "\\\"", "\\u00e9", "dolor", "\\\\", "\xc3\xa9t\xc3\xa9", "sit amet" };
+    corpus_puts(c, "\"");
+    unsigned n = 1 + rng_below(12);
+    for (unsigned i = 0; i < n; i++) corpus_puts(c, pieces[rng_below(sizeof(pieces) / sizeof(pieces[0]))]);
+    corpus_puts(c, "\"");
+}
+
+static void gen_binary(Corpus* c) {
+    static const char hex[] = "0123456789ABCDEF";
+    static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char buf[160];
+    unsigned n = 4 + rng_below(60);
+    if (rng_below(2)) {
+        size_t at = 0;
+        memcpy(buf, "hex\"", 4);
+        at = 4;
+        for (unsigned i = 0; i < n * 2; i++) buf[at++] = hex[rng_below(16)];
+        buf[at++] = '"';
+        corpus_put(c, buf, at);
+    } else {
+        size_t at = 0;
+        memcpy(buf, "b64\"", 4);
+        at = 4;
+        for (unsigned i = 0; i < n * 2; i++) buf[at++] = b64[rng_below(64)];
+        memcpy(buf + at, "==\"", 3);
+        at += 3;
+        corpus_put(c, buf, at);
+    }
+}
+
+static void gen_nested(Corpus* c, int depth) {
+    if (depth == 0) {
+        gen_number(c);
+        return;
+    }
+    if (rng_below(2)) {
+        corpus_puts(c, "[");
+        gen_nested(c, depth - 1);
+        corpus_puts(c, ",null,");
+        gen_nested(c, depth - 1 - (int)rng_below((unsigned)depth));
+        corpus_puts(c, "]");
+    } else {
+        corpus_puts(c, "{\"k\":");
+        gen_nested(c, depth - 1);
+        corpus_puts(c, "}");
+    }
+}
+
+static Corpus generate(BenchKind kind, size_t target) {
+    Corpus c = {0};
+    g_rng = 0x9E3779B97F4A7C15ull ^ (uint64_t)(kind + 1);
+
+    corpus_puts(&c, "[\n");
+    int first = 1;
+    while (c.len < target) {
+        if (!first) corpus_puts(&c, ",\n");
+        first = 0;
+
+        switch (kind) {
+            case KIND_NUMBERS:
+                for (int i = 0; i < 16; i++) {
+                    if (i) corpus_puts(&c, ", ");
+                    gen_number(&c);
+                }
+                break;
+            case KIND_STRINGS:
+                for (int i = 0; i < 8; i++) {
+                    if (i) corpus_puts(&c, ", ");
+                    gen_string(&c);
+                }
+                break;
+            case KIND_NESTED:
+                gen_nested(&c, 24 + (int)rng_below(40));
+                break;
+            case KIND_COMMENTS:
+                corpus_puts(&c, "// line comment describing the next record\n{ /* inline */ \"id\": ");
+                gen_number(&c);
+                corpus_puts(&c, ", /* a somewhat longer block comment\n   spanning two lines */ \"ok\": true }");
+                break;
+            case KIND_SEPARATORS:
+                for (int i = 0; i < 12; i++) {
+                    if (i) corpus_puts(&c, ", ");
+                    gen_separated_number(&c);
+                }
+                break;
+            case KIND_BINARY:
+                for (int i = 0; i < 6; i++) {
+                    if (i) corpus_puts(&c, ", ");
+                    gen_binary(&c);
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    corpus_puts(&c, "\n]\n");
+    return c;
+}
+
+/* ---------------- Hardware counters ---------------- */
+
+typedef struct Counters {
+    int    available;
+    double cycles;
+    double instructions;
+    double branch_misses;
+} Counters;
+
+#ifdef __linux__
+typedef struct PerfGroup {
+    int fd[3];
+    int ok;
+} PerfGroup;
+
+static int perf_open(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void perf_init(PerfGroup* g) {
+    g->ok = 0;
+    g->fd[0] = perf_open(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (g->fd[0] < 0) return;
+    g->fd[1] = perf_open(PERF_COUNT_HW_INSTRUCTIONS, g->fd[0]);
+    g->fd[2] = perf_open(PERF_COUNT_HW_BRANCH_MISSES, g->fd[0]);
+    if (g->fd[1] < 0 || g->fd[2] < 0) {
+        for (int i = 0; i < 3; i++) if (g->fd[i] >= 0) close(g->fd[i]);
+        return;
+    }
+    g->ok = 1;
+}
+
+static void perf_start(PerfGroup* g) {
+    if (!g->ok) return;
+    ioctl(g->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(g->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perf_stop(PerfGroup* g, Counters* out) {
+    out->available = 0;
+    if (!g->ok) return;
+    ioctl(g->fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    uint64_t buf[4];
+    if (read(g->fd[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) || buf[0] != 3) return;
+    out->available = 1;
+    out->cycles = (double)buf[1];
+    out->instructions = (double)buf[2];
+    out->branch_misses = (double)buf[3];
+}
+
+static void perf_close(PerfGroup* g) {
+    if (!g->ok) return;
+    for (int i = 0; i < 3; i++) close(g->fd[i]);
+}
+#endif
+
+/* ---------------- Measurement ---------------- */
+
+typedef struct BenchResult {
+    const char* kind;
+    size_t   bytes;
+    size_t   tokens;
+    int      iters;
+    double   best_ns;
+    double   mb_s;
+    double   tokens_s;
+    double   ns_token;
+    double   cycles_byte;      /* -1 when counters are unavailable */
+    double   instr_byte;
+    double   branch_miss_kb;   /* branch misses per KiB of input */
+} BenchResult;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int g_validate = 0;
+
+/* Validate-only run; the token count of the token loop is reported for comparability. */
+static size_t validate_all(const Corpus* c, size_t tokens) {
+    ajis_error err;
+    ajis_validate_options opt = ajis_validate_options_default();
+    if (ajis_validate(c->data, c->len, &opt, &err) != AJIS_OK) {
+        fprintf(stderr, "[BENCH] Validation error at %u:%u (%s)\n",
+            err.location.line, err.location.column, err.context ? err.context : "");
+        return 0;
+    }
+    return tokens;
+}
+
+/* Lex the whole corpus once; returns token count or 0 on lexer error. */
+static size_t lex_all(const Corpus* c) {
+    ajis_input in;
+    ajis_input_init(&in, c->data, c->len);
+
+    ajis_lexer lx;
+    ajis_lexer_options opt;
+    opt.allow_multiline_strings = 0;
+    opt.allow_number_separators = 1;
+    ajis_lexer_init(&lx, &in, opt);
+
+    size_t tokens = 0;
+    for (;;) {
+        ajis_token tok;
+        ajis_error err;
+        if (ajis_lexer_next(&lx, &tok, &err) != AJIS_OK) {
+            fprintf(stderr, "[BENCH] Lexer error at %u:%u (%s)\n",
+                err.location.line, err.location.column, err.context ? err.context : "");
+            return 0;
+        }
+        tokens++;
+        if (tok.type == AJIS_TOKEN_EOF) break;
+    }
+    return tokens;
+}
+
+static int run_kind(BenchKind kind, size_t target, int iters, BenchResult* r) {
+    Corpus c = generate(kind, target);
+
+    size_t tokens = lex_all(&c); /* warm-up + sanity check */
+    if (tokens != 0 && g_validate) tokens = validate_all(&c, tokens);
+    if (tokens == 0) {
+        free(c.data);
+        return 0;
+    }
+
+    double best = 0;
+    Counters best_ctr = {0, 0, 0, 0};
+#ifdef __linux__
+    PerfGroup pg;
+    perf_init(&pg);
+#endif
+
+    for (int i = 0; i < iters; i++) {
+        Counters ctr = {0, 0, 0, 0};
+#ifdef __linux__
+        perf_start(&pg);
+#endif
+        double t0 = now_ns();
+        size_t n = g_validate ? validate_all(&c, tokens) : lex_all(&c);
+        double t1 = now_ns();
+#ifdef __linux__
+        perf_stop(&pg, &ctr);
+#endif
+        if (n != tokens) {
+            fprintf(stderr, "[BENCH] Token count changed between runs\n");
+            free(c.data);
+            return 0;
+        }
+        if (i == 0 || t1 - t0 < best) {
+            best = t1 - t0;
+            best_ctr = ctr;
+        }
+    }
+#ifdef __linux__
+    perf_close(&pg);
+#endif
+
+    r->kind = kind_name(kind);
+    r->bytes = c.len;
+    r->tokens = tokens;
+    r->iters = iters;
+    r->best_ns = best;
+    r->mb_s = ((double)c.len / (1024.0 * 1024.0)) / (best / 1e9);
+    r->tokens_s = (double)tokens / (best / 1e9);
+    r->ns_token = best / (double)tokens;
+    if (best_ctr.available) {
+        r->cycles_byte = best_ctr.cycles / (double)c.len;
+        r->instr_byte = best_ctr.instructions / (double)c.len;
+        r->branch_miss_kb = best_ctr.branch_misses / ((double)c.len / 1024.0);
+    } else {
+        r->cycles_byte = r->instr_byte = r->branch_miss_kb = -1;
+    }
+
+    free(c.data);
+    return 1;
+}
+
+/* ---------------- Output ---------------- */
+
+static void write_csv(FILE* out, const BenchResult* rs, int n) {
+    fprintf(out, "kind,bytes,tokens,iters,best_ns,mb_s,tokens_s,ns_token,cycles_byte,instr_byte,branch_miss_kb\n");
+    for (int i = 0; i < n; i++) {
+        const BenchResult* r = &rs[i];
+        fprintf(out, "%s,%zu,%zu,%d,%.0f,%.2f,%.0f,%.3f,%.3f,%.3f,%.3f\n",
+            r->kind, r->bytes, r->tokens, r->iters, r->best_ns, r->mb_s, r->tokens_s,
+            r->ns_token, r->cycles_byte, r->instr_byte, r->branch_miss_kb);
+    }
+}
+
+static void write_ajis(FILE* out, const BenchResult* rs, int n) {
+    fprintf(out, "// AJIS lexer benchmark results (counters are -1 when unavailable)\n[\n");
+    for (int i = 0; i < n; i++) {
+        const BenchResult* r = &rs[i];
+        fprintf(out,
+            "  { \"kind\": \"%s\", \"bytes\": %zu, \"tokens\": %zu, \"iters\": %d, \"best_ns\": %.0f,\n"
+            "    \"mb_s\": %.2f, \"tokens_s\": %.0f, \"ns_token\": %.3f,\n"
+            "    \"cycles_byte\": %.3f, \"instr_byte\": %.3f, \"branch_miss_kb\": %.3f }%s\n",
+            r->kind, r->bytes, r->tokens, r->iters, r->best_ns, r->mb_s, r->tokens_s, r->ns_token,
+            r->cycles_byte, r->instr_byte, r->branch_miss_kb, i + 1 < n ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+/* ---------------- Baseline comparison ---------------- */
+
+/* Reads a CSV written by write_csv and compares MB/s per kind. Returns number of regressions. */
+static int compare_baseline(const char* path, const BenchResult* rs, int n, double tolerance_pct) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "[BENCH] Cannot open baseline: %s\n", path);
+        return -1;
+    }
+
+    int regressions = 0;
+    int matched = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char kind[64];
+        double mb_s = 0;
+        size_t bytes = 0, tokens = 0;
+        int iters = 0;
+        double best_ns = 0;
+        if (sscanf(line, "%63[^,],%zu,%zu,%d,%lf,%lf", kind, &bytes, &tokens, &iters, &best_ns, &mb_s) != 6) continue;
+
+        for (int i = 0; i < n; i++) {
+            if (strcmp(rs[i].kind, kind) != 0) continue;
+            matched++;
+            double delta = (rs[i].mb_s - mb_s) / mb_s * 100.0;
+            int bad = delta < -tolerance_pct;
+            printf("[%s] %-10s baseline %8.2f MB/s  now %8.2f MB/s  (%+.1f%%)\n",
+                bad ? "REGRESSION" : "OK", kind, mb_s, rs[i].mb_s, delta);
+            if (tokens != rs[i].tokens) {
+                printf("[NOTE] %-10s token count differs from baseline (%zu vs %zu): corpus or lexer changed\n",
+                    kind, tokens, rs[i].tokens);
+            }
+            regressions += bad;
+        }
+    }
+    fclose(f);
+
+    if (matched == 0) {
+        fprintf(stderr, "[BENCH] Baseline has no matching kinds: %s\n", path);
+        return -1;
+    }
+    return regressions;
+}
+
+/* ---------------- CLI ---------------- */
+
+static void usage(const char* exe) {
+    fprintf(stderr,
+        "AJIS lexer benchmark\n\n"
+        "Usage:\n"
+        "  %s [options]\n\n"
+        "Options:\n"
+        "  --kind K           numbers|strings|nested|comments|separators|binary|all (default all)\n"
+        "  --size MB          Corpus size per kind in MiB (default 8)\n"
+        "  --iters N          Timed iterations per kind, best is reported (default 5)\n"
+        "  --format F         csv|ajis (default csv)\n"
+        "  --out FILE         Write results to FILE instead of stdout\n"
+        "  --baseline FILE    Compare MB/s against a previous CSV run, exit 1 on regression\n"
+        "  --tolerance PCT    Allowed slowdown vs baseline in percent (default 5)\n"
+        "  --validate         Time ajis_validate() instead of the token loop\n"
+        "  -h, --help         Show help\n",
+        exe);
+}
+
+int main(int argc, char** argv) {
+    int only = -1;
+    double size_mb = 8;
+    int iters = 5;
+    int ajis_format = 0;
+    const char* out_path = NULL;
+    const char* baseline = NULL;
+    double tolerance = 5.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) { usage(argv[0]); return 0; }
+        if (strcmp(a, "--validate") == 0) { g_validate = 1; continue; }
+        if (!v) { usage(argv[0]); return 2; }
+
+        if (strcmp(a, "--kind") == 0) {
+            only = -1;
+            if (strcmp(v, "all") != 0) {
+                for (int k = 0; k < KIND_COUNT; k++) if (strcmp(v, kind_name((BenchKind)k)) == 0) only = k;
+                if (only < 0) { fprintf(stderr, "[BENCH] Unknown kind: %s\n", v); return 2; }
+            }
+        }
+        else if (strcmp(a, "--size") == 0) size_mb = atof(v);
+        else if (strcmp(a, "--iters") == 0) iters = atoi(v);
+        else if (strcmp(a, "--format") == 0) ajis_format = strcmp(v, "ajis") == 0;
+        else if (strcmp(a, "--out") == 0) out_path = v;
+        else if (strcmp(a, "--baseline") == 0) baseline = v;
+        else if (strcmp(a, "--tolerance") == 0) tolerance = atof(v);
+        else { usage(argv[0]); return 2; }
+        i++;
+    }
+    if (size_mb <= 0 || iters <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    size_t target = (size_t)(size_mb * 1024.0 * 1024.0);
+    BenchResult results[KIND_COUNT];
+    int n = 0;
+
+    for (int k = 0; k < KIND_COUNT; k++) {
+        if (only >= 0 && k != only) continue;
+        fprintf(stderr, "[BENCH] %s ...\n", kind_name((BenchKind)k));
+        if (!run_kind((BenchKind)k, target, iters, &results[n])) return 2;
+        n++;
+    }
+
+    FILE* out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "wb");
+        if (!out) {
+            fprintf(stderr, "[BENCH] Cannot write: %s\n", out_path);
+            return 2;
+        }
+    }
+    if (ajis_format) write_ajis(out, results, n);
+    else write_csv(out, results, n);
+    if (out != stdout) fclose(out);
+
+    if (baseline) {
+        int regressions = compare_baseline(baseline, results, n, tolerance);
+        if (regressions < 0) return 2;
+        printf("\n[SUMMARY] kinds=%d regressions=%d tolerance=%.1f%%\n", n, regressions, tolerance);
+        return regressions ? 1 : 0;
+    }
+    return 0;
+}
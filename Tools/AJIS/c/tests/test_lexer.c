@@ -86,6 +86,7 @@ static int read_file_all(const char* path, char** out_data, size_t* out_size) {
 typedef struct TestFilter {
     int dump;
     int show_errors;      /* --errors: show pretty error reports for expected failures */
+    int recover;          /* --recover: keep lexing after errors, report all of them */
 
     int run_all;          /* --all: traverse test_data */
     int only_valid;       /* --valid */
@@ -144,7 +145,20 @@ typedef struct TestStats {
     int skipped;
 } TestStats;
 
-static int run_one_file(const char* path, int dump, int show_errors, TestStats* st) {
+#define MAX_DIAGNOSTICS 64
+
+/* All collected diagnostics in recover mode, otherwise the first error. */
+static void print_errors(const char* path, const char* src, size_t src_len,
+                         const ajis_diagnostics* diag, const ajis_error* first) {
+    if (diag) {
+        fflush(stdout);
+        ajis_error_print_pretty_batch(stdout, path, src, src_len, diag->items, diag->count, ajis_diagnostics_dropped(diag));
+    } else {
+        ajis_error_print_pretty(stdout, path, src, src_len, first);
+    }
+}
+
+static int run_one_file(const char* path, int dump, int show_errors, int recover, TestStats* st) {
     int expect_fail = expect_fail_from_path(path);
 
     if (st) st->total++;
@@ -179,10 +193,25 @@ if (src_len == 0) {
     int saw_error = 0;
     ajis_error first_error = ajis_error_ok();
 
+    ajis_error diag_items[MAX_DIAGNOSTICS];
+    ajis_diagnostics diag;
+    ajis_diagnostics_init(&diag, diag_items, MAX_DIAGNOSTICS);
+
     for (;;) {
         ajis_token tok;
         ajis_error err = ajis_error_ok();
 
+        if (recover) {
+            /* one pass over the whole file, every error collected */
+            (void)ajis_lexer_next_recover(&lx, &tok, &diag);
+            if (dump) {
+                printf("%s: %s span(off=%zu,len=%zu)\n",
+                    path, tok_name(tok.type), tok.span.offset, tok.span.length);
+            }
+            if (tok.type == AJIS_TOKEN_EOF) break;
+            continue;
+        }
+
         ajis_error_code rc = ajis_lexer_next(&lx, &tok, &err);
         if (rc != AJIS_OK) {
             saw_error = 1;
@@ -203,6 +232,11 @@ if (src_len == 0) {
         if (tok.type == AJIS_TOKEN_EOF) break;
     }
 
+    if (recover && diag.total > 0) {
+        saw_error = 1;
+        first_error = diag.items[0];
+    }
+
     int ok = 0;
     if (!expect_fail) {
         ok = !saw_error;
@@ -217,7 +251,7 @@ if (src_len == 0) {
         /* If --errors is enabled and this was an expected failure, show the error */
         if (show_errors && expect_fail && saw_error) {
             printf("\n");
-            ajis_error_print_pretty(stdout, path, src, src_len, &first_error);
+            print_errors(path, src, src_len, recover ? &diag : NULL, &first_error);
             printf("\n");
         }
     } else {
@@ -227,7 +261,7 @@ if (src_len == 0) {
         /* For unexpected failures, always show the error */
         if (saw_error) {
             printf("\n");
-            ajis_error_print_pretty(stdout, path, src, src_len, &first_error);
+            print_errors(path, src, src_len, recover ? &diag : NULL, &first_error);
             printf("\n");
         }
     }
@@ -285,7 +319,7 @@ static void run_tree_recursive(const char* dir, const TestFilter* f, TestStats*
         if (!matches_category(path, f)) continue;
         if (!matches_validity(path, f)) continue;
 
-        run_one_file(path, f->dump, f->show_errors, st);
+        run_one_file(path, f->dump, f->show_errors, f->recover, st);
     }
 
     closedir(d);
@@ -311,6 +345,7 @@ static void usage(const char* exe) {
         "  --canonical        Only canonical category\n"
         "  --dump             Dump tokens + errors\n"
         "  --errors           Show pretty error reports for expected failures\n"
+        "  --recover          Keep lexing after errors and report every error in the file\n"
         "  -h, --help         Show help\n\n"
         "Examples:\n"
         "  %s tests/test_data/valid/numbers/n_basic_valid.ajis\n"
@@ -329,6 +364,7 @@ static int parse_args(int argc, char** argv, TestFilter* f) {
 
         if (strcmp(a, "--dump") == 0) f->dump = 1;
         else if (strcmp(a, "--errors") == 0) f->show_errors = 1;
+        else if (strcmp(a, "--recover") == 0) f->recover = 1;
         else if (strcmp(a, "--all") == 0) f->run_all = 1;
         else if (strcmp(a, "--valid") == 0) f->only_valid = 1;
         else if (strcmp(a, "--invalid") == 0) f->only_invalid = 1;
@@ -388,7 +424,7 @@ int main(int argc, char** argv) {
         printf("[TEST] File: %s\n", path);
         if (f.dump) printf("[TEST] Dump: ON\n");
 
-        run_one_file(path, f.dump, f.show_errors, &st);
+        run_one_file(path, f.dump, f.show_errors, f.recover, &st);
     }
 
    printf("\n[SUMMARY] total=%d passed=%d failed=%d skipped=%d\n",
@@ -0,0 +1,154 @@
+#include "../include/ajis_lexer.h"
+#include "../include/ajis_error_print.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+typedef struct Scan {
+    ajis_token_type types[64];
+    size_t ntok;            /* tokens seen (may exceed the stored 64) */
+    ajis_error items[64];
+    ajis_diagnostics diag;
+} Scan;
+
+static void scan(Scan* s, const char* src, size_t len, size_t capacity) {
+    ajis_input in;
+    ajis_input_init(&in, src, len);
+    ajis_lexer lx;
+    ajis_lexer_options opt;
+    opt.allow_multiline_strings = 0;
+    opt.allow_number_separators = 1;
+    ajis_lexer_init(&lx, &in, opt);
+
+    ajis_diagnostics_init(&s->diag, s->items, capacity);
+    s->ntok = 0;
+    size_t last_off = 0;
+    for (;;) {
+        ajis_token tok;
+        TEST_ASSERT(ajis_lexer_next_recover(&lx, &tok, &s->diag) == AJIS_OK, "recover never fails on valid arguments");
+        if (s->ntok < 64) s->types[s->ntok] = tok.type;
+        s->ntok++;
+        TEST_ASSERT(in.offset >= last_off, "input position never moves backwards");
+        TEST_ASSERT(s->ntok <= len + 1, "every call makes progress");
+        last_off = in.offset;
+        if (tok.type == AJIS_TOKEN_EOF) break;
+    }
+}
+
+static void expect_tokens(const Scan* s, const ajis_token_type* want, size_t n, const char* what) {
+    TEST_ASSERT(s->ntok == n, what);
+    for (size_t i = 0; i < n; i++) TEST_ASSERT(s->types[i] == want[i], what);
+    g_checks++;
+}
+
+int main(void) {
+    Scan s;
+
+    /* bad number and a stray byte: both reported, lexing continues */
+    {
+        const char* src = "[1, 01, \"ok\", @, 2]";
+        scan(&s, src, strlen(src), 64);
+        TEST_ASSERT(s.diag.total == 2, "two errors");
+        TEST_ASSERT(s.items[0].code == AJIS_ERR_INVALID_NUMBER && s.items[0].location.column == 5, "leading zero");
+        TEST_ASSERT(s.items[1].code == AJIS_ERR_INVALID_TOKEN && s.items[1].location.column == 15, "stray byte");
+        ajis_token_type want[] = {
+            AJIS_TOKEN_LBRACKET, AJIS_TOKEN_NUMBER, AJIS_TOKEN_COMMA, AJIS_TOKEN_INVALID, AJIS_TOKEN_COMMA,
+            AJIS_TOKEN_STRING, AJIS_TOKEN_COMMA, AJIS_TOKEN_INVALID, AJIS_TOKEN_COMMA, AJIS_TOKEN_NUMBER,
+            AJIS_TOKEN_RBRACKET, AJIS_TOKEN_EOF
+        };
+        expect_tokens(&s, want, sizeof(want) / sizeof(want[0]), "token stream after number/byte errors");
+        g_checks += 3;
+        printf("[PASS] numbers and stray bytes\n");
+    }
+
+    /* string broken by a newline resyncs at the newline; line numbers stay right */
+    {
+        const char* src = "[\"abc\n, 1, hex\"ABC\", 2,\n truex]";
+        scan(&s, src, strlen(src), 64);
+        TEST_ASSERT(s.diag.total == 3, "three errors");
+        TEST_ASSERT(s.items[0].code == AJIS_ERR_INVALID_STRING && s.items[0].location.line == 1, "newline in string");
+        TEST_ASSERT(s.items[1].code == AJIS_ERR_INVALID_STRING && s.items[1].location.line == 2, "odd hex literal");
+        TEST_ASSERT(s.items[2].code == AJIS_ERR_INVALID_TOKEN && s.items[2].location.line == 3 &&
+                    s.items[2].location.column == 2, "unknown identifier on line 3");
+        ajis_token_type want[] = {
+            AJIS_TOKEN_LBRACKET, AJIS_TOKEN_INVALID, AJIS_TOKEN_COMMA, AJIS_TOKEN_NUMBER, AJIS_TOKEN_COMMA,
+            AJIS_TOKEN_INVALID, AJIS_TOKEN_COMMA, AJIS_TOKEN_NUMBER, AJIS_TOKEN_COMMA, AJIS_TOKEN_INVALID,
+            AJIS_TOKEN_RBRACKET, AJIS_TOKEN_EOF
+        };
+        expect_tokens(&s, want, sizeof(want) / sizeof(want[0]), "token stream after string errors");
+        g_checks += 4;
+        printf("[PASS] strings and binary literals\n");
+    }
+
+    /* unterminated block comment consumes the rest */
+    {
+        const char* src = "[1, /* never closed";
+        scan(&s, src, strlen(src), 64);
+        TEST_ASSERT(s.diag.total == 1 && s.items[0].code == AJIS_ERR_UNTERMINATED_COMMENT, "comment error");
+        ajis_token_type want[] = { AJIS_TOKEN_LBRACKET, AJIS_TOKEN_NUMBER, AJIS_TOKEN_COMMA, AJIS_TOKEN_INVALID, AJIS_TOKEN_EOF };
+        expect_tokens(&s, want, sizeof(want) / sizeof(want[0]), "token stream after comment error");
+        g_checks++;
+        printf("[PASS] unterminated comment\n");
+    }
+
+    /* large input, one pass, bounded list */
+    {
+        const size_t rows = 200000;
+        const char* good = "{\"id\": 12345, \"name\": \"row\", \"ok\": true},\n";
+        const char* bad = "{\"id\": 0123, \"name\": \"row\", \"ok\": maybe},\n";
+        size_t gl = strlen(good), bl = strlen(bad);
+        char* big = (char*)malloc(rows * (gl > bl ? gl : bl) + 2);
+        TEST_ASSERT(big != NULL, "out of memory");
+        size_t n = 0, expected = 0;
+        big[n++] = '[';
+        for (size_t i = 0; i < rows; i++) {
+            if (i % 100 == 7) {
+                memcpy(big + n, bad, bl);
+                n += bl;
+                expected += 2;
+            } else {
+                memcpy(big + n, good, gl);
+                n += gl;
+            }
+        }
+        big[n++] = ']';
+
+        scan(&s, big, n, 10);
+        TEST_ASSERT(s.diag.total == expected, "every error counted in one pass");
+        TEST_ASSERT(s.diag.count == 10 && ajis_diagnostics_dropped(&s.diag) == expected - 10, "list is bounded");
+        TEST_ASSERT(s.items[0].location.line == 8 && s.items[1].location.line == 8, "first errors on line 8");
+
+        /* batch output equals the single reports joined by blank lines */
+        FILE* a = tmpfile();
+        FILE* b = tmpfile();
+        TEST_ASSERT(a && b, "tmpfile");
+        ajis_error_print_pretty_batch(a, "big.ajis", big, n, s.items, s.diag.count, 0);
+        for (size_t i = 0; i < s.diag.count; i++) {
+            if (i) fputc('\n', b);
+            ajis_error_print_pretty(b, "big.ajis", big, n, &s.items[i]);
+        }
+        long la = ftell(a), lb = ftell(b);
+        TEST_ASSERT(la == lb && la > 0, "batch output length");
+        char* ba = (char*)malloc((size_t)la);
+        char* bb = (char*)malloc((size_t)lb);
+        rewind(a);
+        rewind(b);
+        TEST_ASSERT(fread(ba, 1, (size_t)la, a) == (size_t)la && fread(bb, 1, (size_t)lb, b) == (size_t)lb, "read back");
+        TEST_ASSERT(memcmp(ba, bb, (size_t)la) == 0, "batch output matches single reports");
+        free(ba);
+        free(bb);
+        fclose(a);
+        fclose(b);
+
+        free(big);
+        g_checks += 5;
+        printf("[PASS] %zu errors in a %zu-byte input, bounded list, batch printing\n", expected, n);
+    }
+
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,401 @@
+/*
+ * ajis-validate: batch validator for large AJIS corpora
+ *
+ * Collects input paths (files, directories walked recursively, or a
+ * path list), then validates them on a work-stealing thread pool.
+ * Inputs are mmap'ed or read into a per-thread reusable buffer
+ * (see ajis_file.h), and each worker validates out of its own arena
+ * that is reset between files, so the steady state makes no system
+ * allocation per file. Each file produces one status line; a summary
+ * with aggregate throughput follows.
+ *
+ * With --lines every file is an AJIS-lines stream (one value per line,
+ * see ajis_lines.h): files are taken one at a time, the records of
+ * each are validated in parallel, and every bad record gets its own
+ * FAIL line, in input order.
+ *
+ * Build (from Tools/AJIS/c):
+ *   gcc -O2 -pthread -I include src/ajis_lexer.c src/ajis_validate.c src/ajis_intern.c src/ajis_string.c \
+ *       src/ajis_file.c src/ajis_pool.c src/ajis_alloc.c src/ajis_lines.c tools/ajis_validate.c -o bin/ajis-validate
+ */
+
+#define _DEFAULT_SOURCE
+#include "../include/ajis_file.h"
+#include "../include/ajis_lines.h"
+#include "../include/ajis_pool.h"
+#include "../include/ajis_validate.h"
+#include "../include/ajis_error_print.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/* ---------------- Path list ---------------- */
+
+typedef struct PathList {
+    char** items;
+    size_t count;
+    size_t cap;
+} PathList;
+
+static void paths_add(PathList* pl, const char* path) {
+    if (pl->count == pl->cap) {
+        size_t cap = pl->cap ? pl->cap * 2 : 1024;
+        char** p = (char**)realloc(pl->items, cap * sizeof(char*));
+        if (!p) {
+            fprintf(stderr, "[VALIDATE] Out of memory collecting paths\n");
+            exit(2);
+        }
+        pl->items = p;
+        pl->cap = cap;
+    }
+    size_t n = strlen(path);
+    char* copy = (char*)malloc(n + 1);
+    if (!copy) {
+        fprintf(stderr, "[VALIDATE] Out of memory collecting paths\n");
+        exit(2);
+    }
+    memcpy(copy, path, n + 1);
+    pl->items[pl->count++] = copy;
+}
+
+static void paths_free(PathList* pl) {
+    for (size_t i = 0; i < pl->count; i++) free(pl->items[i]);
+    free(pl->items);
+}
+
+static int ends_with(const char* s, const char* suffix) {
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && memcmp(s + n - m, suffix, m) == 0;
+}
+
+static void walk_dir(const char* dir, const char* ext, PathList* pl) {
+    DIR* d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "[VALIDATE] Cannot open dir: %s (%s)\n", dir, strerror(errno));
+        return;
+    }
+
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char* name = ent->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) continue;
+
+        char path[4096];
+        size_t dl = strlen(dir);
+        snprintf(path, sizeof(path), "%s%s%s", dir, (dl && dir[dl - 1] == '/') ? "" : "/", name);
+
+        /* d_type avoids one stat() per entry on most file systems */
+        int is_dir = 0, is_reg = 0;
+#ifdef DT_DIR
+        if (ent->d_type == DT_DIR) is_dir = 1;
+        else if (ent->d_type == DT_REG) is_reg = 1;
+        else
+#endif
+        {
+            struct stat st;
+            if (stat(path, &st) != 0) continue;
+            is_dir = S_ISDIR(st.st_mode);
+            is_reg = S_ISREG(st.st_mode);
+        }
+
+        if (is_dir) walk_dir(path, ext, pl);
+        else if (is_reg && ends_with(name, ext)) paths_add(pl, path);
+    }
+    closedir(d);
+}
+
+static int read_list(const char* list, PathList* pl) {
+    FILE* f = strcmp(list, "-") == 0 ? stdin : fopen(list, "rb");
+    if (!f) {
+        fprintf(stderr, "[VALIDATE] Cannot open list: %s (%s)\n", list, strerror(errno));
+        return 0;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        size_t n = strcspn(line, "\r\n");
+        line[n] = '\0';
+        if (n > 0) paths_add(pl, line);
+    }
+    if (f != stdin) fclose(f);
+    return 1;
+}
+
+/* ---------------- Validation ---------------- */
+
+typedef struct Options {
+    ajis_validate_options validate;
+    int quiet;          /* only report failures */
+    int lines;          /* files are AJIS-lines streams */
+    unsigned threads;
+} Options;
+
+/* ---------------- Workers ---------------- */
+
+#define OUT_CAP (64 * 1024)
+
+/* Per-worker state; aligned so counters of different workers do not share a line. */
+typedef struct Worker {
+    ajis_file_buffer scratch;
+    ajis_arena arena;
+    size_t files, bytes, valid, invalid, io_errors;
+    size_t out_len;
+    char out[OUT_CAP];
+} __attribute__((aligned(64))) Worker;
+
+typedef struct Run {
+    const PathList* paths;
+    const Options* opt;
+    Worker* workers;
+    pthread_mutex_t out_lock;
+} Run;
+
+static void flush_out(Run* run, Worker* w) {
+    if (w->out_len == 0) return;
+    pthread_mutex_lock(&run->out_lock);
+    fwrite(w->out, 1, w->out_len, stdout);
+    pthread_mutex_unlock(&run->out_lock);
+    w->out_len = 0;
+}
+
+static void emit(Run* run, Worker* w, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+static void emit(Run* run, Worker* w, const char* fmt, ...) {
+    char line[4352];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= sizeof(line)) n = (int)sizeof(line) - 1;
+    if (w->out_len + (size_t)n > OUT_CAP) flush_out(run, w);
+    memcpy(w->out + w->out_len, line, (size_t)n);
+    w->out_len += (size_t)n;
+}
+
+static void validate_one(size_t index, unsigned worker, void* ctx) {
+    Run* run = (Run*)ctx;
+    Worker* w = &run->workers[worker];
+    const char* path = run->paths->items[index];
+
+    w->files++;
+
+    ajis_file_view view;
+    int e = ajis_file_open(&view, path, &w->scratch);
+    if (e != 0) {
+        w->io_errors++;
+        emit(run, w, "ERROR %s: %s\n", path, strerror(e));
+        return;
+    }
+
+    ajis_validate_options vopt = run->opt->validate;
+    vopt.allocator = &w->arena.allocator;
+
+    ajis_error err = ajis_error_ok();
+    ajis_error_code rc = ajis_validate(view.data, view.length, &vopt, &err);
+    ajis_arena_reset(&w->arena);
+    w->bytes += view.length;
+
+    if (rc == AJIS_OK) {
+        w->valid++;
+        if (!run->opt->quiet) emit(run, w, "OK %s\n", path);
+    } else {
+        w->invalid++;
+        emit(run, w, "FAIL %s:%u:%u: %s%s%s\n", path,
+            err.location.line, err.location.column, ajis_error_code_name(rc),
+            err.context ? " - " : "", err.context ? err.context : "");
+    }
+    ajis_file_close(&view);
+}
+
+/* ---------------- AJIS-lines mode ---------------- */
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int report_record(const ajis_lines_record* rec, ajis_error_code rc, const ajis_error* err,
+                         const uint8_t* out, size_t out_len, void* ctx) {
+    (void)rec;
+    (void)out;
+    (void)out_len;
+    if (rc != AJIS_OK) {
+        printf("FAIL %s:%u:%u: %s%s%s\n", (const char*)ctx,
+            err->location.line, err->location.column, ajis_error_code_name(rc),
+            err->context ? " - " : "", err->context ? err->context : "");
+    }
+    return 0;
+}
+
+static int run_lines(const PathList* paths, const Options* opt) {
+    ajis_lines_options lo = ajis_lines_options_default();
+    lo.threads = opt->threads;
+    unsigned threads = opt->threads ? opt->threads : ajis_pool_default_threads();
+
+    ajis_file_buffer scratch;
+    ajis_file_buffer_init(&scratch);
+    size_t files = 0, records = 0, invalid = 0, io_errors = 0, bytes = 0;
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < paths->count; i++) {
+        const char* path = paths->items[i];
+        files++;
+
+        ajis_file_view view;
+        int e = ajis_file_open(&view, path, &scratch);
+        if (e != 0) {
+            io_errors++;
+            printf("ERROR %s: %s\n", path, strerror(e));
+            continue;
+        }
+
+        ajis_lines_stats st;
+        ajis_error_code rc = ajis_lines_validate(view.data, view.length, &lo, &opt->validate,
+            report_record, (void*)path, &st);
+        records += st.records;
+        invalid += st.failed;
+        bytes += view.length;
+        if (rc != AJIS_OK) {
+            io_errors++;
+            printf("ERROR %s: out of memory\n", path);
+        } else if (!opt->quiet && st.failed == 0) {
+            printf("OK %s (%zu records)\n", path, st.records);
+        }
+        ajis_file_close(&view);
+    }
+    double elapsed = now_sec() - t0;
+    ajis_file_buffer_free(&scratch);
+
+    if (elapsed <= 0) elapsed = 1e-9;
+    printf("\n[SUMMARY] files=%zu records=%zu invalid=%zu errors=%zu bytes=%zu threads=%u\n",
+        files, records, invalid, io_errors, bytes, threads);
+    printf("[SUMMARY] elapsed=%.3fs throughput=%.1f MB/s %.0f records/s\n",
+        elapsed, (double)bytes / (1024.0 * 1024.0) / elapsed, (double)records / elapsed);
+
+    return (invalid == 0 && io_errors == 0) ? 0 : 1;
+}
+
+/* ---------------- CLI ---------------- */
+
+static void usage(const char* exe) {
+    fprintf(stderr,
+        "AJIS batch validator\n\n"
+        "Usage:\n"
+        "  %s [options] <file|dir>...\n"
+        "  %s [options] --list <file|->\n\n"
+        "Options:\n"
+        "  --list FILE        Read paths (one per line) from FILE, '-' for stdin\n"
+        "  --ext EXT          Extension matched in directories (default .ajis, '' for all)\n"
+        "  --threads N        Worker threads (default: online CPUs)\n"
+        "  --strict           Disallow number separators\n"
+        "  --multiline        Allow multi-line strings\n"
+        "  --duplicates       Reject duplicate object keys\n"
+        "  --max-depth N      Nesting limit (default 256)\n"
+        "  --lenient-escapes  Accept unknown escapes such as \\U (lexer rules)\n"
+        "  --lines            Files hold one value per line (AJIS-lines); report each bad record\n"
+        "  --quiet            Print only FAIL/ERROR lines and the summary\n"
+        "  -h, --help         Show help\n\n"
+        "Output: one line per file (OK / FAIL path:line:col: reason / ERROR path: reason),\n"
+        "then [SUMMARY]. Exit status is 0 when every file is valid, 1 otherwise.\n",
+        exe, exe);
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.validate = ajis_validate_options_default();
+
+    const char* ext = ".ajis";
+    PathList paths = {0};
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(a, "-h") == 0 || strcmp(a, "--help") == 0) { usage(argv[0]); return 0; }
+        else if (strcmp(a, "--strict") == 0) opt.validate.lexer.allow_number_separators = 0;
+        else if (strcmp(a, "--multiline") == 0) opt.validate.lexer.allow_multiline_strings = 1;
+        else if (strcmp(a, "--duplicates") == 0) opt.validate.reject_duplicate_keys = 1;
+        else if (strcmp(a, "--lenient-escapes") == 0) opt.validate.allow_unknown_escapes = 1;
+        else if (strcmp(a, "--max-depth") == 0 && v) { opt.validate.max_depth = (uint32_t)atoi(v); i++; }
+        else if (strcmp(a, "--quiet") == 0) opt.quiet = 1;
+        else if (strcmp(a, "--lines") == 0) opt.lines = 1;
+        else if (strcmp(a, "--threads") == 0 && v) { opt.threads = (unsigned)atoi(v); i++; }
+        else if (strcmp(a, "--ext") == 0 && v) { ext = v; i++; }
+        else if (strcmp(a, "--list") == 0 && v) {
+            if (!read_list(v, &paths)) return 2;
+            i++;
+        }
+        else if (a[0] == '-' && a[1] == '-') { usage(argv[0]); return 2; }
+        else {
+            struct stat st;
+            if (stat(a, &st) == 0 && S_ISDIR(st.st_mode)) walk_dir(a, ext, &paths);
+            else paths_add(&paths, a); /* unreadable paths are reported as ERROR */
+        }
+    }
+    if (paths.count == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (opt.lines) {
+        int status = run_lines(&paths, &opt);
+        paths_free(&paths);
+        return status;
+    }
+
+    unsigned threads = opt.threads ? opt.threads : ajis_pool_default_threads();
+    Worker* workers = NULL;
+    if (posix_memalign((void**)&workers, 64, sizeof(Worker) * threads) != 0) {
+        fprintf(stderr, "[VALIDATE] Out of memory\n");
+        return 2;
+    }
+    for (unsigned t = 0; t < threads; t++) {
+        memset(&workers[t], 0, offsetof(Worker, out));
+        ajis_file_buffer_init(&workers[t].scratch);
+        ajis_arena_init(&workers[t].arena, NULL, 0);
+    }
+
+    Run run;
+    run.paths = &paths;
+    run.opt = &opt;
+    run.workers = workers;
+    pthread_mutex_init(&run.out_lock, NULL);
+
+    double t0 = now_sec();
+    int prc = ajis_pool_run(paths.count, threads, validate_one, &run);
+    double elapsed = now_sec() - t0;
+    if (prc != 0) fprintf(stderr, "[VALIDATE] Thread pool: %s\n", strerror(prc));
+
+    size_t files = 0, bytes = 0, valid = 0, invalid = 0, io_errors = 0;
+    for (unsigned t = 0; t < threads; t++) {
+        flush_out(&run, &workers[t]);
+        files += workers[t].files;
+        bytes += workers[t].bytes;
+        valid += workers[t].valid;
+        invalid += workers[t].invalid;
+        io_errors += workers[t].io_errors;
+        ajis_file_buffer_free(&workers[t].scratch);
+        ajis_arena_destroy(&workers[t].arena);
+    }
+    pthread_mutex_destroy(&run.out_lock);
+    free(workers);
+    paths_free(&paths);
+
+    if (elapsed <= 0) elapsed = 1e-9;
+    printf("\n[SUMMARY] files=%zu valid=%zu invalid=%zu errors=%zu bytes=%zu threads=%u\n",
+        files, valid, invalid, io_errors, bytes, threads);
+    printf("[SUMMARY] elapsed=%.3fs throughput=%.1f MB/s %.0f files/s\n",
+        elapsed, (double)bytes / (1024.0 * 1024.0) / elapsed, (double)files / elapsed);
+
+    return (invalid == 0 && io_errors == 0) ? 0 : 1;
+}
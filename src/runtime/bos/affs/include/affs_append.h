@@ -0,0 +1,115 @@
+#ifndef AFFS_APPEND_H
+#define AFFS_APPEND_H
+
+#include "affs_backend.h"
+#include "affs_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Group-commit appender for AfFS segments
+
+   Many writers append framed records (affs_record.h) to one
+   append-only region; a committer thread turns whatever has
+   accumulated into ONE write at the tail plus ONE flush, then
+   wakes every writer of that commit. While a commit is in flight
+   the next one fills a second staging buffer, so the flush rate,
+   not the record rate, bounds durable throughput.
+
+     submit   frame the record, reserve its offset (one short
+              lock), copy it into staging outside the lock
+     wait     block until the commit holding it is durable
+
+   `window_us` lets the committer wait for more records after the
+   first one arrives (more records per flush, more latency);
+   `max_batch_bytes` / `max_batch_records` close a commit early.
+   A failed write or flush fails its commit and every commit after
+   it: the appender stops, and the caller reopens at a verified tail.
+   ============================================================ */
+
+typedef struct affs_append_options {
+    uint32_t align;             /* record alignment; 0 = backend write_align */
+    uint32_t window_us;         /* 0 = commit as soon as the previous one lands */
+    size_t max_batch_bytes;     /* 0 = 4 MiB */
+    uint32_t max_batch_records; /* 0 = 65536 */
+    int no_flush;               /* 1: commits are written but not flushed */
+} affs_append_options;
+
+static inline affs_append_options affs_append_options_default(void) {
+    affs_append_options o;
+    o.align = 0;
+    o.window_us = 0;
+    o.max_batch_bytes = 0;
+    o.max_batch_records = 0;
+    o.no_flush = 0;
+    return o;
+}
+
+/* Completion handle of one submitted record. */
+typedef struct affs_append_ticket {
+    uint64_t commit;            /* commit sequence number */
+    uint64_t offset;            /* where the record starts */
+    uint64_t framed_length;
+    uint64_t submit_ns;
+} affs_append_ticket;
+
+#define AFFS_APPEND_HIST_BUCKETS 32
+
+typedef struct affs_append_stats {
+    uint64_t records;
+    uint64_t bytes;                 /* framed */
+    uint64_t commits;
+    uint64_t max_commit_records;
+    uint64_t commit_ns;             /* sum of write + flush time */
+    uint64_t wait_ns;               /* sum of submit-to-durable time over waited records */
+    uint64_t waited;
+    /* waited records by latency: bucket i counts [2^i, 2^(i+1)) microseconds, bucket 0 also < 1 us */
+    uint64_t latency_hist[AFFS_APPEND_HIST_BUCKETS];
+} affs_append_stats;
+
+typedef struct affs_appender affs_appender;
+
+/* Appends start at `tail`, which must be a multiple of the alignment. */
+affs_io_result affs_appender_open(affs_appender **out, affs_backend *b, uint64_t tail, const affs_append_options *opt);
+
+/* Commits what was submitted, stops the committer, frees the appender. */
+affs_io_result affs_appender_close(affs_appender *a);
+
+/* Queue one record; `h` is framed with payload_length = len. */
+affs_io_result affs_append_submit(affs_appender *a, const affs_record_header *h, const void *payload, size_t len,
+                                  affs_append_ticket *ticket);
+
+/* Block until the ticket's commit is durable (or failed). */
+affs_io_result affs_append_wait(affs_appender *a, const affs_append_ticket *ticket);
+
+/* Submit + wait; `offset` (may be NULL) receives the record offset. */
+affs_io_result affs_append(affs_appender *a, const affs_record_header *h, const void *payload, size_t len,
+                           uint64_t *offset);
+
+/* Block until everything submitted so far is durable. */
+affs_io_result affs_appender_sync(affs_appender *a);
+
+/* Next record offset (submitted, not necessarily durable). */
+uint64_t affs_appender_tail(affs_appender *a);
+
+void affs_appender_stats_get(affs_appender *a, affs_append_stats *out);
+
+/* Latency (us) below which `q` (0..1) of the waited records fell, from the histogram. */
+static inline uint64_t affs_append_stats_quantile_us(const affs_append_stats *s, double q) {
+    uint64_t total = 0, seen = 0;
+    for (int i = 0; i < AFFS_APPEND_HIST_BUCKETS; i++) total += s->latency_hist[i];
+    if (total == 0) return 0;
+    for (int i = 0; i < AFFS_APPEND_HIST_BUCKETS; i++) {
+        seen += s->latency_hist[i];
+        if ((double)seen >= q * (double)total) return (uint64_t)1 << (i + 1);
+    }
+    return (uint64_t)1 << AFFS_APPEND_HIST_BUCKETS;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_APPEND_H */
@@ -0,0 +1,148 @@
+#ifndef AFFS_BACKEND_H
+#define AFFS_BACKEND_H
+
+#include "affs_io.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AfFS file backend (Docs/AfFS/BackendIOLayer)
+
+   Reads and writes at explicit offsets of a store file, flush as
+   the durability barrier (fdatasync), geometry queries and one
+   affs_io_result per operation.
+
+   Batches are the fast path: affs_backend_submit() keeps up to
+   `queue_depth` requests in flight from a single calling thread.
+
+     io_uring    one io_uring_enter() submits new requests and
+                 reaps completions; short transfers and transient
+                 errors are resubmitted in the same loop. Each
+                 concurrent caller gets its own ring (up to
+                 AFFS_BACKEND_MAX_RINGS, created on first use).
+     threads     pread()/pwrite() on a pool started at open; the
+                 caller works the batch too. Used when io_uring is
+                 unavailable (old kernel, seccomp) or requested.
+
+   With AFFS_BACKEND_DIRECT the file is opened O_DIRECT; buffers,
+   offsets and lengths must then follow affs_geometry.mem_align
+   and .write_align (affs_buffer.h hands out such buffers). When
+   the filesystem refuses O_DIRECT the backend falls back to the
+   page cache and reports direct = 0.
+
+   Reads stop at end of file: that is Ok with fewer bytes. A
+   failure after some bytes is Partial, with the failure in
+   `cause`. Transient errors are retried up to `max_attempts`
+   submissions per request.
+   ============================================================ */
+
+#define AFFS_BACKEND_MAX_RINGS 8
+
+/* affs_backend_options.flags */
+#define AFFS_BACKEND_WRITE 0x1u     /* open read-write */
+#define AFFS_BACKEND_CREATE 0x2u    /* create when missing (implies WRITE) */
+#define AFFS_BACKEND_DIRECT 0x4u    /* bypass the page cache */
+#define AFFS_BACKEND_FULL_SYNC 0x8u /* flush with fsync() instead of fdatasync() */
+
+typedef enum affs_io_engine {
+    AFFS_ENGINE_AUTO = 0,       /* io_uring when the kernel allows it */
+    AFFS_ENGINE_URING,
+    AFFS_ENGINE_THREADS
+} affs_io_engine;
+
+typedef struct affs_backend_options {
+    unsigned flags;
+    affs_io_engine engine;
+    uint32_t queue_depth;       /* requests in flight per batch; 0 = 128 */
+    uint32_t threads;           /* fallback workers; 0 = 4 */
+    uint32_t max_attempts;      /* submissions per request; 0 = 3 */
+} affs_backend_options;
+
+static inline affs_backend_options affs_backend_options_default(void) {
+    affs_backend_options o;
+    o.flags = 0;
+    o.engine = AFFS_ENGINE_AUTO;
+    o.queue_depth = 0;
+    o.threads = 0;
+    o.max_attempts = 0;
+    return o;
+}
+
+typedef struct affs_geometry {
+    uint64_t size;              /* bytes, at the time of the query */
+    uint32_t read_align;        /* offset/length alignment: 1, or the direct I/O unit */
+    uint32_t write_align;
+    uint32_t mem_align;         /* buffer address alignment */
+    uint32_t optimal_io;        /* preferred transfer granule (st_blksize) */
+    uint32_t atomic_write;      /* largest untorn write, 0 if unknown */
+    int direct;                 /* O_DIRECT in effect */
+    uint64_t identity;          /* hash of device and inode (best effort) */
+} affs_geometry;
+
+/* Observability counters (section 7); hints, not canonical truth. */
+typedef struct affs_backend_stats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t read_errors;
+    uint64_t write_errors;
+    uint64_t retries;           /* submissions past the first, short transfers included */
+    uint64_t flushes;
+    uint64_t last_error_ns;     /* CLOCK_MONOTONIC, 0 if none */
+    uint64_t read_latency_ns;   /* sums: divide by reads / writes */
+    uint64_t write_latency_ns;
+} affs_backend_stats;
+
+#define AFFS_OP_READ 0u
+#define AFFS_OP_WRITE 1u
+
+typedef struct affs_io_request {
+    uint32_t op;                /* AFFS_OP_READ or AFFS_OP_WRITE */
+    void *buffer;
+    uint64_t offset;
+    size_t length;
+    affs_io_result result;      /* set by affs_backend_submit() */
+} affs_io_request;
+
+typedef struct affs_backend affs_backend;
+
+/* Open `path`; `*out` is NULL unless the result is Ok. `opt` may be NULL. */
+affs_io_result affs_backend_open(affs_backend **out, const char *path, const affs_backend_options *opt);
+
+void affs_backend_close(affs_backend *b);
+
+/* AFFS_ENGINE_URING or AFFS_ENGINE_THREADS. */
+affs_io_engine affs_backend_engine(const affs_backend *b);
+
+affs_io_result affs_backend_geometry(affs_backend *b, affs_geometry *out);
+
+affs_io_result affs_backend_read(affs_backend *b, uint64_t offset, void *buffer, size_t length);
+affs_io_result affs_backend_write(affs_backend *b, uint64_t offset, const void *buffer, size_t length);
+
+/* Durability barrier for every write completed before the call. */
+affs_io_result affs_backend_flush(affs_backend *b);
+
+/*
+ * Run all `count` requests and wait for them; each gets its own
+ * result. The returned summary has the sums of bytes and attempts,
+ * the batch wall time and the category and os_error of the first
+ * request (by index) that did not end Ok.
+ */
+affs_io_result affs_backend_submit(affs_backend *b, affs_io_request *reqs, size_t count);
+
+void affs_backend_stats_get(const affs_backend *b, affs_backend_stats *out);
+
+/* fsync the directory holding `path`, making a rename into it durable. Returns 0 or an errno. */
+int affs_backend_sync_parent(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_BACKEND_H */
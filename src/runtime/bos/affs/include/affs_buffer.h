@@ -0,0 +1,45 @@
+#ifndef AFFS_BUFFER_H
+#define AFFS_BUFFER_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Aligned I/O buffer pool
+
+   `count` buffers of `size` bytes carved from one aligned slab,
+   for O_DIRECT transfers (affs_geometry.mem_align) and to keep
+   hot I/O paths free of malloc. The free list is a lock-free
+   stack whose head packs (tag, index) into one 64-bit word, so
+   acquire and release are one CAS from any thread.
+   ============================================================ */
+
+typedef struct affs_buffer_pool {
+    uint8_t *slab;
+    size_t size;                /* per buffer, a multiple of align */
+    uint32_t count;
+    size_t align;
+    _Atomic uint32_t *next;     /* free-list links, count entries */
+    _Atomic uint64_t head;      /* (tag << 32) | (index + 1), 0 = empty */
+} affs_buffer_pool;
+
+/* Returns 0, EINVAL (align not a power of two, count 0) or ENOMEM. */
+int affs_buffer_pool_init(affs_buffer_pool *pool, uint32_t count, size_t size, size_t align);
+
+void affs_buffer_pool_destroy(affs_buffer_pool *pool);
+
+/* A free buffer, or NULL when all are in use. */
+void *affs_buffer_acquire(affs_buffer_pool *pool);
+
+void affs_buffer_release(affs_buffer_pool *pool, void *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_BUFFER_H */
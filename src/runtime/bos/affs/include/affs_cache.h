@@ -0,0 +1,100 @@
+#ifndef AFFS_CACHE_H
+#define AFFS_CACHE_H
+
+#include "affs_backend.h"
+#include "affs_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Segment block cache, per access profile
+   (StorageAccessProfiles section 4)
+
+   Fixed-size blocks of backend files, cached by (backend, block
+   number). Every read names the access profile of the segment it
+   reads, and the profile picks the behavior:
+
+     Point lookup,      S3-FIFO: a new block enters a small FIFO
+     Sequential append, (a tenth of the space); only blocks hit
+     unspecified        again there move on to the main FIFO, where
+                        a hit buys one more pass. Blocks evicted
+                        from the small FIFO are remembered as
+                        ghosts, and a ghost read again goes straight
+                        to main. A one-time sweep thus passes
+                        through the small FIFO only.
+     Range scan         as above, and a miss also reads the next
+                        `readahead` blocks in the same I/O
+     Bulk scan,         bypass: cached blocks are copied out (not
+     Streamed           promoted), missing ones are read around the
+                        cache and never inserted, so a nightly scan
+                        or a large object leaves the hot set alone
+
+   The cache is split into shards by block hash, each with its own
+   mutex, FIFOs and memory. A block being read is marked loading;
+   other readers of it wait for that one I/O. Counters are kept per
+   shard and profile, under the shard lock, and summed on demand.
+
+   Writes do not go through the cache: call affs_cache_invalidate()
+   for ranges written after they may have been cached, and
+   affs_cache_drop() before closing a backend.
+   ============================================================ */
+
+typedef struct affs_cache affs_cache;
+
+typedef struct affs_cache_options {
+    size_t capacity;            /* bytes; 0 = 256 MiB */
+    uint32_t block_size;        /* power of two, a multiple of the backends' read_align; 0 = 64 KiB */
+    unsigned shards;            /* 0 = 4 x online CPUs, power of two */
+    uint32_t readahead;         /* blocks read ahead for range scans; 0 = 4 */
+} affs_cache_options;
+
+static inline affs_cache_options affs_cache_options_default(void) {
+    affs_cache_options o;
+    o.capacity = 0;
+    o.block_size = 0;
+    o.shards = 0;
+    o.readahead = 0;
+    return o;
+}
+
+typedef struct affs_cache_stats {
+    uint64_t hits;              /* blocks served from the cache */
+    uint64_t misses;            /* blocks read from the backend */
+    uint64_t inserts;
+    uint64_t evictions;         /* blocks of this profile evicted */
+    uint64_t promotions;        /* small -> main FIFO */
+    uint64_t ghost_hits;        /* misses that went straight to main */
+    uint64_t readahead;         /* blocks read ahead */
+    uint64_t bypass_bytes;      /* bytes read around the cache */
+} affs_cache_stats;
+
+/* 0, EINVAL or ENOMEM. */
+int affs_cache_create(affs_cache **out, const affs_cache_options *opt);
+
+void affs_cache_destroy(affs_cache *c);
+
+/*
+ * Read [offset, offset + length) of `b` into `dst` through the cache.
+ * As affs_backend_read(): reads stop at end of file (Ok, fewer bytes).
+ */
+affs_io_result affs_cache_read(affs_cache *c, affs_backend *b, uint64_t offset, void *dst, size_t length, uint8_t profile);
+
+/* Forget cached blocks overlapping [offset, offset + length) of `b`. */
+void affs_cache_invalidate(affs_cache *c, affs_backend *b, uint64_t offset, uint64_t length);
+
+/* Forget every block of `b`. */
+void affs_cache_drop(affs_cache *c, affs_backend *b);
+
+/* Counters of one profile (AFFS_PROFILE_*). */
+void affs_cache_stats_get(affs_cache *c, uint8_t profile, affs_cache_stats *out);
+
+/* Bytes of cached blocks. */
+size_t affs_cache_resident(affs_cache *c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_CACHE_H */
@@ -0,0 +1,83 @@
+#ifndef AFFS_CHAIN_H
+#define AFFS_CHAIN_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Speculative record chains (shared by affs_rebuild, affs_scrub)
+
+   A parallel scan cuts a segment into chunks and starts each chunk
+   other than the first at its first aligned offset, before the true
+   record boundary arriving from the previous chunk is known. The
+   chain it follows visits every aligned position not strictly inside
+   a step it took, so once the boundary `b` is known:
+
+     b <= start              the chain was right
+     b >= stop               a record from an earlier chunk covers
+                             the whole chunk
+     b is a visited position both chains agree from `b` on; only the
+                             steps before it are dropped
+     otherwise               rescan the chunk from `b`
+
+   To tell the last two apart the first AFFS_CHAIN_PROBES steps of
+   the chain are kept; a `b` past them forces a rescan.
+   ============================================================ */
+
+#define AFFS_CHAIN_PROBES 64
+
+typedef struct affs_chain_probes {
+    uint64_t off[AFFS_CHAIN_PROBES];
+    uint64_t len[AFFS_CHAIN_PROBES];
+    uint8_t counted[AFFS_CHAIN_PROBES];     /* the step was counted as a record */
+    int n;
+} affs_chain_probes;
+
+typedef enum affs_chain_verdict {
+    AFFS_CHAIN_KEEP = 0,        /* b <= start */
+    AFFS_CHAIN_COVERED,         /* b >= stop */
+    AFFS_CHAIN_AGREE,           /* drop the steps before b */
+    AFFS_CHAIN_RESCAN
+} affs_chain_verdict;
+
+static inline void affs_chain_probes_reset(affs_chain_probes *p) {
+    p->n = 0;
+}
+
+/* Note one step of the chain (only the first AFFS_CHAIN_PROBES are kept). */
+static inline void affs_chain_probe(affs_chain_probes *p, uint64_t off, uint64_t len, int counted) {
+    if (p->n == AFFS_CHAIN_PROBES) return;
+    p->off[p->n] = off;
+    p->len[p->n] = len;
+    p->counted[p->n] = (uint8_t)counted;
+    p->n++;
+}
+
+/*
+ * Reconcile the chain started at `start`, which left the chunk at
+ * `stop`, with the true boundary `b`. On AGREE, `*dropped` counted
+ * steps of `*covered` bytes lie before `b`.
+ */
+static inline affs_chain_verdict affs_chain_reconcile(const affs_chain_probes *p, uint64_t start, uint64_t stop,
+                                                      uint64_t b, uint64_t *dropped, uint64_t *covered) {
+    *dropped = *covered = 0;
+    if (b <= start) return AFFS_CHAIN_KEEP;
+    if (b >= stop) return AFFS_CHAIN_COVERED;
+    uint64_t probed = p->n ? p->off[p->n - 1] + p->len[p->n - 1] : start;
+    if (p->n == AFFS_CHAIN_PROBES && b > probed) return AFFS_CHAIN_RESCAN;
+    for (int k = 0; k < p->n && p->off[k] < b; k++) {
+        if (b < p->off[k] + p->len[k]) return AFFS_CHAIN_RESCAN;
+        *covered += p->len[k];
+        *dropped += p->counted[k];
+    }
+    return AFFS_CHAIN_AGREE;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_CHAIN_H */
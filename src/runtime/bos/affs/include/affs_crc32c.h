@@ -0,0 +1,43 @@
+#ifndef AFFS_CRC32C_H
+#define AFFS_CRC32C_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   CRC32C (Castagnoli), the AfFS checksum (BinaryLayoutV1 3.2)
+
+   Reflected polynomial 0x82F63B78, initial value and final XOR
+   0xFFFFFFFF: the same value as ComputeCrc32C() of the .NET
+   runtime. Streaming: start from 0 and pass the previous result
+   to continue over the next bytes.
+
+   On x86-64 with SSE4.2 the crc32 instruction runs three
+   independent streams per block, merged with one PCLMULQDQ
+   multiply each (about 3x a single stream); elsewhere a
+   slicing-by-8 table. The choice is made once, at first use.
+   ============================================================ */
+
+uint32_t affs_crc32c(uint32_t crc, const void *data, size_t len);
+
+/*
+ * CRC of A||B from crc(A), crc(B) and the length of B, in O(log len2):
+ * checksum chunks in parallel, then merge in order.
+ */
+uint32_t affs_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* The portable slicing-by-8 path, whatever the CPU (cross-checks, benchmarks). */
+uint32_t affs_crc32c_sw(uint32_t crc, const void *data, size_t len);
+
+/* Name of the implementation affs_crc32c() uses here. */
+const char *affs_crc32c_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_CRC32C_H */
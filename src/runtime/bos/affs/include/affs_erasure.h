@@ -0,0 +1,84 @@
+#ifndef AFFS_ERASURE_H
+#define AFFS_ERASURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Erasure-coded redundancy: Reed-Solomon over GF(2^8)
+   (Redundancy section 3A)
+
+   A segment is cut into stripes of k data shards; m parity shards
+   are computed per stripe, and any k of the k + m shards give the
+   stripe back. The code is systematic (data shards are the segment
+   bytes unchanged) with a Cauchy parity matrix, so every k x k
+   submatrix of the generator is invertible. Field polynomial
+   x^8 + x^4 + x^3 + x^2 + 1 (0x11D).
+
+   Multiplying a buffer by a constant is vectorized, best first:
+     gfni     one GF2P8AFFINEQB per 32 bytes: the constant as an
+              8 x 8 bit matrix (AVX2 + GFNI)
+     avx2     split tables: two 16-entry PSHUFB lookups (low and
+              high nibble) per 32 bytes
+     ssse3    the same, 16 bytes at a time
+     portable the same tables, a byte at a time
+   Output shards are dot products over the k inputs, four at a time
+   so each input vector is loaded once per group, in 8 KiB column
+   chunks so the inputs stay in cache.
+
+   Shards carry no checksums of their own: a reconstructed stripe is
+   verified by the record CRCs of the segment bytes it holds
+   (affs_ec_verify()), exactly as a rebuild scan would read them.
+   ============================================================ */
+
+#define AFFS_EC_MAX_SHARDS 255      /* k + m */
+
+typedef struct affs_ec affs_ec;
+
+/* 0, EINVAL (k or m of 0, k + m above AFFS_EC_MAX_SHARDS) or ENOMEM. */
+int affs_ec_create(affs_ec **out, unsigned k, unsigned m);
+
+void affs_ec_destroy(affs_ec *ec);
+
+/* parity[0..m) from data[0..k), `len` bytes each. */
+void affs_ec_encode(const affs_ec *ec, const uint8_t *const *data, uint8_t *const *parity, size_t len);
+
+/*
+ * shards[0..k + m): data, then parity. Fills every shard whose
+ * present[i] is 0 from the others. 0, or EINVAL with fewer than k
+ * present.
+ */
+int affs_ec_reconstruct(const affs_ec *ec, uint8_t *const *shards, const uint8_t *present, size_t len);
+
+/* "gfni", "avx2", "ssse3" or "portable": the kernel in use. */
+const char *affs_ec_impl(void);
+
+/* Pick a kernel by name (tests, benchmarks). 0, EINVAL (unknown) or ENOTSUP (not on this CPU). */
+int affs_ec_set_impl(const char *name);
+
+/* ---------- verification by record CRCs ---------- */
+
+typedef struct affs_ec_verify_result {
+    uint64_t records;           /* valid records overlapping the range */
+    uint64_t bad;               /* records whose checksum fails */
+    uint64_t unverified;        /* bytes of the range in no valid record and not zero */
+} affs_ec_verify_result;
+
+/*
+ * Walk the records of p[0..len) from offset 0, which must be a record
+ * boundary, resyncing by `align` past invalid bytes as a rebuild scan
+ * does, and account for those overlapping [from, to). A rebuilt range
+ * is good when `bad` and `unverified` are both 0; `p` must reach past
+ * the last record that overlaps the range.
+ */
+void affs_ec_verify(const uint8_t *p, size_t len, uint32_t align, uint64_t from, uint64_t to, affs_ec_verify_result *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_ERASURE_H */
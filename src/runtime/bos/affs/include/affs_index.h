@@ -0,0 +1,87 @@
+#ifndef AFFS_INDEX_H
+#define AFFS_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "affs_object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   In-memory primary index: ObjectId -> LocationPointer
+
+   An open-addressing hash table in the Swiss-table style. Slots
+   come in groups of 16; each group has 16 control bytes (empty,
+   deleted, or 7 bits of the hash) that one SSE2 compare checks at
+   once, so a probe touches the control bytes of one group and
+   then, almost always, exactly the one slot that matches. A slot
+   is 40 bytes: the id, offset, length, 32-bit segment id, flags.
+
+   One writer, any number of lock-free readers:
+     - each group carries a sequence counter; readers retry a
+       group the writer changed under them (a seqlock per group),
+       so a lookup never sees a torn slot
+     - growing allocates a new table and copies a few groups on
+       every later write (or affs_index_maintain()); lookups check
+       the old table, then the new one, and skip copied groups
+     - a table is freed only after readers that could see it have
+       left (a two-phase reader epoch); the writer waits for those
+       in-flight lookups at the start and end of a resize, never
+       for a rehash
+
+   affs_index_get_batch() hashes a batch, prefetches every control
+   group, then every candidate slot, then compares: the misses of
+   one batch overlap instead of adding up.
+   ============================================================ */
+
+typedef struct affs_index affs_index;
+
+typedef struct affs_index_stats {
+    size_t count;               /* live entries */
+    size_t capacity;            /* slots, both tables while resizing */
+    size_t tombstones;          /* deleted slots not yet reused */
+    size_t migrating;           /* groups still to move to the new table */
+    size_t bytes;               /* table memory */
+    uint64_t resizes;
+} affs_index_stats;
+
+/* 0, or ENOMEM. `capacity` is a hint (entries), 0 for a small start. */
+int affs_index_create(affs_index **out, size_t capacity);
+
+/* No reader may be inside the index. */
+void affs_index_destroy(affs_index *ix);
+
+/* ---------- writer (one thread at a time) ---------- */
+
+/* Insert or replace. 0, EINVAL (segment id above 32 bits), or ENOMEM. */
+int affs_index_put(affs_index *ix, affs_object_id id, const affs_location *loc);
+
+/* 0, or ENOENT. */
+int affs_index_erase(affs_index *ix, affs_object_id id);
+
+/* Put entries as produced by affs_rebuild(); tombstone entries erase. */
+int affs_index_load(affs_index *ix, const affs_index_entry *entries, size_t count);
+
+/* Move up to `groups` groups of a running resize; returns groups left. */
+size_t affs_index_maintain(affs_index *ix, size_t groups);
+
+void affs_index_stats_get(affs_index *ix, affs_index_stats *out);
+
+/* ---------- readers (any thread, concurrently with the writer) ---------- */
+
+/* 1 and *loc filled if present, else 0. */
+int affs_index_get(affs_index *ix, affs_object_id id, affs_location *loc);
+
+/* found[i] = 1 and locs[i] filled for present ids; returns how many were found. */
+size_t affs_index_get_batch(affs_index *ix, const affs_object_id *ids, size_t n, affs_location *locs, uint8_t *found);
+
+size_t affs_index_count(affs_index *ix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_INDEX_H */
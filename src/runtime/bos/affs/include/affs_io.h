@@ -0,0 +1,121 @@
+#ifndef AFFS_IO_H
+#define AFFS_IO_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AfFS Backend I/O Outcomes (Docs/AfFS/BackendIOLayer, section 5)
+
+   Every backend operation returns a structured outcome instead of
+   a bare status: the category a higher layer decides on, the
+   bytes actually processed, the OS code behind it and how many
+   attempts it took. Categories match BackendOperationCategory of
+   the .NET runtime, in the same order.
+   ============================================================ */
+
+typedef enum affs_io_category {
+    AFFS_IO_OK = 0,
+    AFFS_IO_PARTIAL,            /* some bytes processed, then a failure */
+    AFFS_IO_TRANSIENT,          /* retry may succeed */
+    AFFS_IO_PERMANENT,          /* retry unlikely (bad sector, bad request) */
+    AFFS_IO_TIMEOUT,
+    AFFS_IO_ACCESS_DENIED,
+    AFFS_IO_OUT_OF_SPACE
+
+} affs_io_category;
+
+
+typedef struct affs_io_result {
+    affs_io_category category;
+    affs_io_category cause;     /* PARTIAL: what stopped it; otherwise == category */
+    uint64_t bytes;             /* bytes processed, also on failure */
+    int os_error;               /* errno, 0 if none */
+    uint32_t attempts;          /* submissions, internal retries included */
+    uint64_t latency_ns;        /* submit to completion, 0 if not measured */
+} affs_io_result;
+
+
+/* ============================================================
+   Helpers
+   ============================================================ */
+
+static inline affs_io_result affs_io_result_ok(void) {
+    affs_io_result r;
+    r.category = AFFS_IO_OK;
+    r.cause = AFFS_IO_OK;
+    r.bytes = 0;
+    r.os_error = 0;
+    r.attempts = 0;
+    r.latency_ns = 0;
+    return r;
+}
+
+/* Retry hint: a later attempt of the same request may succeed. */
+static inline int affs_io_retryable(affs_io_category c) {
+    return c == AFFS_IO_TRANSIENT || c == AFFS_IO_TIMEOUT;
+}
+
+/* Category of a failed call's errno; never AFFS_IO_OK. */
+static inline affs_io_category affs_io_category_from_errno(int e) {
+    switch (e) {
+        case EAGAIN:
+        case EINTR:
+        case EBUSY:
+        case ENOMEM:
+        case ENOBUFS:
+            return AFFS_IO_TRANSIENT;
+        case ETIMEDOUT:
+            return AFFS_IO_TIMEOUT;
+        case EACCES:
+        case EPERM:
+        case EROFS:
+            return AFFS_IO_ACCESS_DENIED;
+        case ENOSPC:
+        case EDQUOT:
+        case EFBIG:
+            return AFFS_IO_OUT_OF_SPACE;
+        default:
+            return AFFS_IO_PERMANENT;   /* EIO, EINVAL, EBADF, ... */
+    }
+}
+
+/* Failed outcome for a call that set `e`. */
+static inline affs_io_result affs_io_result_from_errno(int e) {
+    affs_io_result r = affs_io_result_ok();
+    r.category = r.cause = affs_io_category_from_errno(e);
+    r.os_error = e;
+    return r;
+}
+
+/* CLOCK_MONOTONIC in ns, the clock behind latency_ns. */
+static inline uint64_t affs_io_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline const char *affs_io_category_name(affs_io_category c) {
+    switch (c) {
+        case AFFS_IO_OK: return "Ok";
+        case AFFS_IO_PARTIAL: return "Partial";
+        case AFFS_IO_TRANSIENT: return "TransientError";
+        case AFFS_IO_PERMANENT: return "PermanentError";
+        case AFFS_IO_TIMEOUT: return "Timeout";
+        case AFFS_IO_ACCESS_DENIED: return "AccessDenied";
+        case AFFS_IO_OUT_OF_SPACE: return "OutOfSpace";
+        default: return "Unknown category";
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_IO_H */
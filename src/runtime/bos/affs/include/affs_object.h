@@ -0,0 +1,102 @@
+#ifndef AFFS_OBJECT_H
+#define AFFS_OBJECT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "affs_record.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AfFS objects and location pointers (Docs/AfFS/Indexes)
+
+   An object is a record of a data kind (Scalar, Row, Text, Blob)
+   whose payload starts with a fixed prefix naming it:
+
+     0  ObjectId   16   128-bit, little-endian (lo, then hi)
+    16  Sequence    8   log sequence number, grows per store
+    24  Flags       4   AFFS_OBJECT_*
+    28  Reserved    4   0
+    32  object bytes
+
+   The sequence orders versions of one ObjectId across segments:
+   the highest valid one is current ("last valid entry wins"), and
+   a tombstone version deletes it. A location pointer names the
+   record (offset of its header within the segment, payload length
+   including the prefix), so a reader can re-validate the header
+   and checksum without consulting anything else.
+   ============================================================ */
+
+#define AFFS_OBJECT_PREFIX_SIZE 32
+
+/* Object flags */
+#define AFFS_OBJECT_TOMBSTONE 0x1u  /* this version deletes the object */
+
+typedef struct affs_object_id {
+    uint64_t lo;
+    uint64_t hi;
+} affs_object_id;
+
+/* LocationPointer (section 2.1) */
+typedef struct affs_location {
+    uint64_t segment_id;
+    uint64_t offset;            /* record header, relative to the segment */
+    uint64_t length;            /* payload bytes (prefix included) */
+    uint32_t flags;             /* record flags (compression, encryption, ...) */
+} affs_location;
+
+/* One primary-index mapping and the version it came from. */
+typedef struct affs_index_entry {
+    affs_object_id id;
+    affs_location loc;
+    uint64_t sequence;
+    uint32_t object_flags;
+} affs_index_entry;
+
+/* Record kinds that carry objects. */
+static inline int affs_object_kind(uint8_t kind) {
+    return kind == AFFS_KIND_SCALAR || kind == AFFS_KIND_ROW || kind == AFFS_KIND_TEXT || kind == AFFS_KIND_BLOB;
+}
+
+static inline int affs_object_id_cmp(affs_object_id a, affs_object_id b) {
+    if (a.hi != b.hi) return a.hi < b.hi ? -1 : 1;
+    if (a.lo != b.lo) return a.lo < b.lo ? -1 : 1;
+    return 0;
+}
+
+static inline int affs_object_id_eq(affs_object_id a, affs_object_id b) {
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+static inline void affs_object_prefix_write(uint8_t out[AFFS_OBJECT_PREFIX_SIZE], affs_object_id id, uint64_t sequence,
+                                            uint32_t flags) {
+    uint64_t v[3] = { id.lo, id.hi, sequence };
+    for (int f = 0; f < 3; f++) {
+        for (int i = 0; i < 8; i++) out[f * 8 + i] = (uint8_t)(v[f] >> (8 * i));
+    }
+    for (int i = 0; i < 4; i++) out[24 + i] = (uint8_t)(flags >> (8 * i));
+    memset(out + 28, 0, 4);
+}
+
+static inline void affs_object_prefix_read(const uint8_t p[AFFS_OBJECT_PREFIX_SIZE], affs_object_id *id, uint64_t *sequence,
+                                           uint32_t *flags) {
+    uint64_t v[3] = { 0, 0, 0 };
+    for (int f = 0; f < 3; f++) {
+        for (int i = 7; i >= 0; i--) v[f] = (v[f] << 8) | p[f * 8 + i];
+    }
+    uint32_t fl = 0;
+    for (int i = 3; i >= 0; i--) fl = (fl << 8) | p[24 + i];
+    id->lo = v[0];
+    id->hi = v[1];
+    *sequence = v[2];
+    *flags = fl;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_OBJECT_H */
@@ -0,0 +1,106 @@
+#ifndef AFFS_POSTING_H
+#define AFFS_POSTING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Compressed posting lists (Indexes 4)
+
+   An immutable set of 32-bit object ordinals in roaring layout:
+   values are split by their high 16 bits into containers, and
+   each container holds the low 16 bits either as a sorted array
+   (up to 4096 values, 2 bytes each) or as a 65536-bit bitmap
+   (8 KiB, beyond 4096 values). Dense tags cost a bit per object,
+   sparse ones two bytes.
+
+   Set operations work container by container:
+     array  & array    SIMD block compare (8 x 8 values per step),
+                       or SIMD galloping when one side is over 32
+                       times longer: skip 8-value blocks of the
+                       long side, exponentially, then compare one
+                       block with a single instruction
+     array  & bitmap   bit tests
+     bitmap & bitmap   word AND + popcount (popcnt when present)
+   Unions and differences merge arrays and combine bitmap words;
+   a result of more than 4096 values becomes a bitmap, a bitmap
+   result of 4096 or fewer an array. affs_posting_and_many()
+   intersects the smallest lists first; affs_posting_or_many()
+   combines each container key of all lists in one pass.
+
+   For storage (sorted runs, Indexes 5.3) a list is encoded:
+   arrays as their first value and then the gaps - 1, bit-packed
+   in blocks of 128 with one width byte per block; bitmaps raw.
+
+   Encoded layout, little-endian:
+     0  Containers      4
+     .  per container:  Key 2, Cardinality - 1 2, then
+                        bitmap (cardinality > 4096): 8192 bytes
+                        array: First 2, then the gaps - 1 in
+                        blocks of 128 (the last one shorter):
+                        Width 1, ceil(n x Width / 8) bytes
+   ============================================================ */
+
+#define AFFS_POSTING_ARRAY_MAX 4096
+
+/*
+ * Zero-initialized is the empty list. The fields describe the
+ * layout for readers; lists are built by the functions below.
+ */
+typedef struct affs_posting {
+    uint64_t cardinality;
+    uint32_t containers;
+    uint16_t *keys;             /* high 16 bits, ascending */
+    uint32_t *cards;            /* values per container, 1..65536 */
+    uint32_t *offsets;          /* into pool, in uint16 units */
+    uint16_t *pool;             /* arrays, and 64-byte aligned bitmaps */
+    size_t pool_used;           /* uint16 units */
+} affs_posting;
+
+void affs_posting_free(affs_posting *p);
+
+/* 0 or ENOMEM. */
+int affs_posting_copy(affs_posting *out, const affs_posting *p);
+
+/* From ascending values without duplicates. 0, EINVAL (not ascending) or ENOMEM. */
+int affs_posting_from_sorted(affs_posting *out, const uint32_t *values, size_t n);
+
+/* Writes cardinality values, ascending. */
+void affs_posting_to_array(const affs_posting *p, uint32_t *out);
+
+int affs_posting_contains(const affs_posting *p, uint32_t value);
+
+/* Bytes held by the list. */
+size_t affs_posting_bytes(const affs_posting *p);
+
+/* out = a & b, a | b, a - b. 0 or ENOMEM; `out` must not alias an input. */
+int affs_posting_and(affs_posting *out, const affs_posting *a, const affs_posting *b);
+int affs_posting_or(affs_posting *out, const affs_posting *a, const affs_posting *b);
+int affs_posting_andnot(affs_posting *out, const affs_posting *a, const affs_posting *b);
+
+/* Intersection and union of n lists (n = 0: empty). 0 or ENOMEM. */
+int affs_posting_and_many(affs_posting *out, const affs_posting *const *lists, size_t n);
+int affs_posting_or_many(affs_posting *out, const affs_posting *const *lists, size_t n);
+
+/* ---------- encoding ---------- */
+
+size_t affs_posting_encoded_size(const affs_posting *p);
+
+/* Writes affs_posting_encoded_size() bytes. */
+void affs_posting_encode(const affs_posting *p, void *dst);
+
+/* 0, EBADMSG (malformed or truncated) or ENOMEM. */
+int affs_posting_decode(affs_posting *out, const void *src, size_t len);
+
+/* "popcnt" or "portable": the bitmap popcount in use. */
+const char *affs_posting_impl(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_POSTING_H */
@@ -0,0 +1,93 @@
+#ifndef AFFS_REBUILD_H
+#define AFFS_REBUILD_H
+
+#include "affs_backend.h"
+#include "affs_object.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Full rebuild of the primary index (Indexes 6.2)
+
+   Scans object segments with many threads and returns the
+   current ObjectId -> LocationPointer mapping, sorted by id.
+
+   Segments are cut into chunks that threads take from a shared
+   queue and read sequentially in large blocks. Every record is
+   validated (header, length, CRC32C streamed over the payload);
+   invalid or torn bytes are stepped over one alignment unit at a
+   time until a valid record follows (BinaryLayoutV1 section 9).
+   A chunk other than the first of its segment starts scanning
+   speculatively at its first aligned offset; the true record
+   boundary arriving from the previous chunk is checked against
+   that scan afterwards, and the chunk is rescanned from it in the
+   rare case (a payload containing framed records) they disagree.
+
+   Object versions are then partitioned by id range, and each
+   partition is merged on its own thread: highest sequence wins,
+   ties go to the later position; tombstones delete.
+
+   `end` is the segment's SegmentPositions entry from the pinned
+   checkpoint: records extending past it are not part of the
+   trusted state and are ignored.
+   ============================================================ */
+
+typedef struct affs_rebuild_segment {
+    affs_backend *backend;
+    uint64_t segment_id;
+    uint64_t base;              /* file offset of the segment; pointer offsets are relative to it */
+    uint64_t start;             /* first record, relative to base */
+    uint64_t end;               /* scan bound, relative to base; UINT64_MAX = end of file */
+    uint32_t align;             /* record alignment; 0 = backend write_align */
+} affs_rebuild_segment;
+
+typedef struct affs_rebuild_options {
+    unsigned threads;           /* 0 = online CPUs */
+    uint64_t chunk_bytes;       /* 0 = 64 MiB */
+    uint32_t read_bytes;        /* per read, 0 = 4 MiB */
+    int keep_tombstones;        /* 1: report deletions as entries with AFFS_OBJECT_TOMBSTONE */
+} affs_rebuild_options;
+
+static inline affs_rebuild_options affs_rebuild_options_default(void) {
+    affs_rebuild_options o;
+    o.threads = 0;
+    o.chunk_bytes = 0;
+    o.read_bytes = 0;
+    o.keep_tombstones = 0;
+    return o;
+}
+
+typedef struct affs_rebuild_stats {
+    uint64_t bytes_scanned;
+    uint64_t records;           /* valid records of any kind */
+    uint64_t versions;          /* object versions seen */
+    uint64_t superseded;        /* versions replaced by a later one */
+    uint64_t deleted;           /* objects whose last version is a tombstone */
+    uint64_t skipped_bytes;     /* invalid bytes stepped over */
+    uint64_t rescans;           /* chunks whose speculative start was wrong */
+    uint64_t scan_ns;
+    uint64_t merge_ns;
+} affs_rebuild_stats;
+
+typedef struct affs_rebuild_result {
+    affs_index_entry *entries;  /* sorted by id, one per live object */
+    size_t count;
+    affs_rebuild_stats stats;
+} affs_rebuild_result;
+
+/*
+ * Rebuild from `nsegs` segments. On a read error the scan stops and
+ * the error is returned; `out` is then left empty.
+ */
+affs_io_result affs_rebuild(const affs_rebuild_segment *segs, size_t nsegs, const affs_rebuild_options *opt,
+                            affs_rebuild_result *out);
+
+void affs_rebuild_result_free(affs_rebuild_result *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_REBUILD_H */
@@ -0,0 +1,108 @@
+#ifndef AFFS_RECORD_H
+#define AFFS_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   AfFS record framing (Docs/AfFS/BinaryLayoutV1, section 4)
+
+     0  Magic          4   "AFR1"
+     4  Version        1   1
+     5  RecordKind     1
+     6  SizeClass      1
+     7  AccessProfile  1
+     8  Flags          2
+    10  PayloadLength  8
+    18  Checksum       4   CRC32C of bytes 0..17 + payload
+    22  payload, then zero padding up to the write alignment
+
+   Little-endian, byte-compatible with RecordHeader of the .NET
+   runtime. The framed length (header + payload + padding) is a
+   multiple of the alignment, so records stay aligned back to back.
+   ============================================================ */
+
+#define AFFS_RECORD_HEADER_SIZE 22
+#define AFFS_RECORD_VERSION 1
+
+/* RecordKind (.NET RecordKind) */
+#define AFFS_KIND_UNINITIALIZED 0
+#define AFFS_KIND_STRUCTURAL 1
+#define AFFS_KIND_SCALAR 2
+#define AFFS_KIND_ROW 3
+#define AFFS_KIND_TEXT 4
+#define AFFS_KIND_BLOB 5
+#define AFFS_KIND_LOG 6
+
+/* AccessProfile (StorageAccessProfiles section 2) */
+#define AFFS_PROFILE_UNSPECIFIED 0
+#define AFFS_PROFILE_POINT_LOOKUP 1
+#define AFFS_PROFILE_RANGE_SCAN 2
+#define AFFS_PROFILE_SEQUENTIAL_APPEND 3
+#define AFFS_PROFILE_BULK_SCAN 4
+#define AFFS_PROFILE_STREAMED 5
+#define AFFS_PROFILE_COUNT 6
+
+typedef struct affs_record_header {
+    uint8_t kind;
+    uint8_t size_class;
+    uint8_t access_profile;
+    uint16_t flags;
+    uint64_t payload_length;
+    uint32_t checksum;          /* filled by affs_record_frame() and affs_record_check() */
+} affs_record_header;
+
+/* Why a record is invalid (section 9). */
+typedef enum affs_record_status {
+    AFFS_RECORD_OK = 0,
+    AFFS_RECORD_TRUNCATED,      /* header or payload runs past the bytes given */
+    AFFS_RECORD_BAD_MAGIC,
+    AFFS_RECORD_BAD_VERSION,
+    AFFS_RECORD_BAD_LENGTH,     /* payload length impossible for the region */
+    AFFS_RECORD_BAD_CHECKSUM
+
+} affs_record_status;
+
+/* Header + payload + padding to `align` (0 counts as 1); 0 on overflow. */
+static inline uint64_t affs_record_framed_size(uint64_t payload_length, uint32_t align) {
+    uint64_t a = align ? align : 1;
+    uint64_t n = AFFS_RECORD_HEADER_SIZE + payload_length;
+    if (n < payload_length || n > UINT64_MAX - (a - 1)) return 0;
+    return (n + a - 1) / a * a;
+}
+
+/*
+ * Frame one record into `out`, which must hold
+ * affs_record_framed_size(len, align) bytes. Sets h->payload_length
+ * and h->checksum; returns the framed size.
+ */
+size_t affs_record_frame(uint8_t *out, affs_record_header *h, const void *payload, size_t len, uint32_t align);
+
+/* Header bytes with the checksum field left as is (for streaming framers). */
+void affs_record_header_write(uint8_t out[AFFS_RECORD_HEADER_SIZE], const affs_record_header *h);
+
+/*
+ * Validate the record at the start of [p, p+avail): magic, version,
+ * length and checksum. Fills `h` (may be NULL) once the header parses;
+ * `framed` (may be NULL) receives the framed size for `align`.
+ */
+affs_record_status affs_record_check(const uint8_t *p, size_t avail, uint32_t align, affs_record_header *h, uint64_t *framed);
+
+/*
+ * affs_record_check() without the checksum: for scanners that stream
+ * a long payload through affs_crc32c() instead of holding it whole.
+ * Only the header bytes are needed.
+ */
+affs_record_status affs_record_parse(const uint8_t *p, size_t avail, uint32_t align, affs_record_header *h, uint64_t *framed);
+
+const char *affs_record_status_name(affs_record_status s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_RECORD_H */
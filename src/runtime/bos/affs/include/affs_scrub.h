@@ -0,0 +1,166 @@
+#ifndef AFFS_SCRUB_H
+#define AFFS_SCRUB_H
+
+#include "affs_backend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Verification pass over object segments (VerificationAndScubbing
+   sections 4-7), one copy or A against B
+
+   Segments are cut into ranges that worker threads take in order
+   and read sequentially in large blocks, validating every record
+   (header, length, CRC32C streamed over the payload). A range other
+   than the first of its segment starts at its first aligned offset
+   and is reconciled with the record boundary arriving from the
+   previous range, as affs_rebuild() does.
+
+   With two copies both are read at the same segment offsets, one
+   buffer each, and each record position is classified:
+
+     both valid, same length and checksum   verified
+     one valid                              REPAIRABLE from it
+     both valid, different                  MISMATCH (not provable)
+     neither valid                          DAMAGED (unrecoverable)
+
+   so the comparison never holds more than a read per copy and
+   worker. Findings are reported in segment order; the pass never
+   writes to the copies. Repair (appending the record from the
+   source copy, section 6) is left to the caller.
+
+   Foreground impact is bounded by a token bucket over the bytes
+   read, shared by all workers. When `foreground_p99` is given it is
+   polled every `probe_ns`: above `p99_target_ns` the rate is halved
+   (down to `min_rate`), below three quarters of it the rate grows
+   back by a sixteenth of `rate` per probe.
+
+   With `checkpoint_path` the pass saves the first unfinished range
+   and the totals before it (temporary file, fsync, rename) every
+   `checkpoint_ns` and when it stops; a later pass over the same
+   segments and options resumes there. Ranges past the checkpoint
+   are verified again, so their findings may be reported twice. A
+   finished pass removes the file.
+   ============================================================ */
+
+typedef struct affs_scrub_segment {
+    affs_backend *a;            /* copy A */
+    affs_backend *b;            /* copy B; NULL verifies A alone */
+    uint64_t segment_id;
+    uint64_t base_a;            /* file offset of the segment in each copy */
+    uint64_t base_b;
+    uint64_t start;             /* first record, relative to the segment */
+    uint64_t end;               /* relative; UINT64_MAX = end of the shorter copy */
+    uint32_t align;             /* record alignment; 0 = backend write_align */
+} affs_scrub_segment;
+
+typedef enum affs_scrub_finding {
+    AFFS_SCRUB_REPAIRABLE = 0,  /* `copy` lacks a record the other copy holds valid */
+    AFFS_SCRUB_MISMATCH,        /* both copies hold a valid record, not the same one */
+    AFFS_SCRUB_DAMAGED,         /* bytes no copy validates */
+    AFFS_SCRUB_UNREADABLE       /* a read of `copy` failed */
+} affs_scrub_finding;
+
+typedef struct affs_scrub_event {
+    affs_scrub_finding finding;
+    unsigned copy;              /* REPAIRABLE, UNREADABLE: 0 = A, 1 = B */
+    uint64_t segment_id;
+    uint64_t offset;            /* relative to the segment */
+    uint64_t length;            /* the record's framed size (MISMATCH: the longer); DAMAGED, UNREADABLE: the span */
+    affs_io_result io;          /* UNREADABLE */
+} affs_scrub_event;
+
+typedef void (*affs_scrub_event_fn)(void *ctx, const affs_scrub_event *e);
+
+/* Foreground read latency p99 over the last interval, in ns; 0 = no data. */
+typedef uint64_t (*affs_scrub_latency_fn)(void *ctx);
+
+typedef struct affs_scrub_options {
+    unsigned threads;           /* 0 = online CPUs */
+    uint64_t range_bytes;       /* 0 = 64 MiB */
+    uint32_t read_bytes;        /* per read and copy, 0 = 4 MiB */
+
+    uint64_t rate;              /* bytes read per second, both copies; 0 = unlimited */
+    uint64_t burst;             /* bucket size; 0 = 2 reads */
+    uint64_t min_rate;          /* backoff floor; 0 = 1 MiB/s */
+
+    affs_scrub_latency_fn foreground_p99;
+    void *latency_ctx;
+    uint64_t p99_target_ns;     /* 0 = 10 ms */
+    uint64_t probe_ns;          /* 0 = 250 ms */
+
+    const char *checkpoint_path;
+    uint64_t checkpoint_ns;     /* 0 = 10 s */
+
+    affs_scrub_event_fn on_event;   /* called under a lock, in segment order */
+    void *event_ctx;
+} affs_scrub_options;
+
+static inline affs_scrub_options affs_scrub_options_default(void) {
+    affs_scrub_options o;
+    o.threads = 0;
+    o.range_bytes = 0;
+    o.read_bytes = 0;
+    o.rate = 0;
+    o.burst = 0;
+    o.min_rate = 0;
+    o.foreground_p99 = NULL;
+    o.latency_ctx = NULL;
+    o.p99_target_ns = 0;
+    o.probe_ns = 0;
+    o.checkpoint_path = NULL;
+    o.checkpoint_ns = 0;
+    o.on_event = NULL;
+    o.event_ctx = NULL;
+    return o;
+}
+
+/* Totals over the pass, resumed parts included unless noted. */
+typedef struct affs_scrub_report {
+    uint64_t ranges;
+    uint64_t ranges_done;
+    uint64_t bytes_verified;    /* segment bytes behind finished ranges */
+    uint64_t records;           /* record positions verified */
+    uint64_t repairable;
+    uint64_t mismatches;
+    uint64_t damaged_bytes;
+    uint64_t unreadable_bytes;
+    uint64_t bytes_read;        /* this run: both copies, rescans included */
+    uint64_t rescans;           /* this run */
+    uint64_t backoffs;          /* this run: rate cuts */
+    uint64_t throttled_ns;      /* this run: worker time spent waiting for tokens */
+    uint64_t rate;              /* current rate, 0 = unlimited */
+    uint64_t elapsed_ns;        /* this run */
+    int resumed;                /* started from a checkpoint */
+    int complete;
+} affs_scrub_report;
+
+typedef struct affs_scrub affs_scrub;
+
+/* Checks the segments (geometry, alignment) and loads a matching checkpoint. */
+affs_io_result affs_scrub_create(affs_scrub **out, const affs_scrub_segment *segs, size_t nsegs,
+                                 const affs_scrub_options *opt);
+
+void affs_scrub_destroy(affs_scrub *s);
+
+/*
+ * Run the pass on the calling thread plus threads - 1 workers until
+ * every range is done or affs_scrub_cancel(). Findings are not
+ * errors: the result is Ok unless memory or the checkpoint file
+ * failed. `out` (may be NULL) receives the report.
+ */
+affs_io_result affs_scrub_run(affs_scrub *s, affs_scrub_report *out);
+
+/* From any thread: stop taking ranges, abandon the ones in progress, checkpoint. */
+void affs_scrub_cancel(affs_scrub *s);
+
+/* From any thread, during or after a run. */
+void affs_scrub_progress(affs_scrub *s, affs_scrub_report *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_SCRUB_H */
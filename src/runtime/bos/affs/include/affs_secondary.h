@@ -0,0 +1,115 @@
+#ifndef AFFS_SECONDARY_H
+#define AFFS_SECONDARY_H
+
+#include "affs_posting.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Secondary indexes: SecondaryKey -> ObjectIds (Indexes 4)
+
+   Keys are byte strings (a tag, a logical path, a content hash,
+   a timestamp bucket); each maps to a compressed posting list
+   (affs_posting.h). Lists hold 32-bit ordinals rather than
+   ObjectIds: the owner numbers object versions densely, in
+   index-log order, and keeps the ordinal -> ObjectId table.
+   Dense numbers are what lets a list spend a bit or two bytes per
+   object. A new version of an object gets a new ordinal and the
+   old one is removed; an ordinal is never added after its
+   removal.
+
+   Updates are append-only:
+     - affs_secondary_add() puts the ordinal in the key's small
+       sorted pending array; the merged list is left alone
+     - affs_secondary_remove() records the ordinal in a removed
+       set that every query subtracts
+     - a background merger folds a key's pending array into a new
+       list once it holds `merge_threshold` ordinals, and swaps the
+       list in; once `purge_threshold` ordinals are removed it
+       rewrites every list without them and forgets them
+
+   Queries read the merged lists and the pending arrays under a
+   shared lock, so they run alongside each other, appends and
+   merges. An intersection intersects the merged lists (smallest
+   first) and checks only the pending ordinals one by one.
+
+   Like every index, this is derivable state: it is rebuilt from
+   the objects, or loaded from sorted runs of encoded lists with
+   affs_secondary_load().
+   ============================================================ */
+
+typedef struct affs_secondary affs_secondary;
+
+typedef struct affs_secondary_options {
+    uint32_t merge_threshold;   /* pending ordinals of a key that start its merge; 0 = 1024 */
+    uint64_t purge_threshold;   /* removed ordinals that start a purge of all lists; 0 = 65536 */
+    int manual;                 /* 1 = no merger thread; call affs_secondary_merge() */
+} affs_secondary_options;
+
+static inline affs_secondary_options affs_secondary_options_default(void) {
+    affs_secondary_options o;
+    o.merge_threshold = 0;
+    o.purge_threshold = 0;
+    o.manual = 0;
+    return o;
+}
+
+typedef struct affs_secondary_key {
+    const void *data;
+    size_t len;
+} affs_secondary_key;
+
+typedef struct affs_secondary_stats {
+    size_t keys;
+    uint64_t merged;            /* ordinals in merged lists, over all keys */
+    uint64_t pending;           /* added, not yet merged */
+    uint64_t removed;           /* removed, not yet purged */
+    uint64_t merges;            /* lists rebuilt */
+    uint64_t purges;
+    size_t bytes;               /* lists, pending arrays and keys */
+} affs_secondary_stats;
+
+/* 0, or ENOMEM / the pthread_create() error. */
+int affs_secondary_create(affs_secondary **out, const affs_secondary_options *opt);
+
+/* Stops the merger; no other call may be running. */
+void affs_secondary_destroy(affs_secondary *ix);
+
+/* ---------- updates ---------- */
+
+/* 0 or ENOMEM. */
+int affs_secondary_add(affs_secondary *ix, const void *key, size_t len, uint32_t ordinal);
+
+/* The ordinal leaves every key. 0 or ENOMEM. */
+int affs_secondary_remove(affs_secondary *ix, uint32_t ordinal);
+
+/* Union `list` into the key's merged list (loading a sorted run). 0 or ENOMEM. */
+int affs_secondary_load(affs_secondary *ix, const void *key, size_t len, const affs_posting *list);
+
+/*
+ * Merge every pending array and removal now and purge removed
+ * ordinals from all lists: what the merger does in the background,
+ * for manual mode and before writing sorted runs. 0 or ENOMEM.
+ */
+int affs_secondary_merge(affs_secondary *ix);
+
+/* ---------- queries (any thread) ---------- */
+
+/* Ordinals of one key; an unknown key gives the empty list. 0 or ENOMEM. */
+int affs_secondary_find(affs_secondary *ix, const void *key, size_t len, affs_posting *out);
+
+/* Ordinals under every key (a tag filter: all tags). 0 or ENOMEM. */
+int affs_secondary_and(affs_secondary *ix, const affs_secondary_key *keys, size_t n, affs_posting *out);
+
+/* Ordinals under any key (any tag, or the buckets of a time range). 0 or ENOMEM. */
+int affs_secondary_or(affs_secondary *ix, const affs_secondary_key *keys, size_t n, affs_posting *out);
+
+void affs_secondary_stats_get(affs_secondary *ix, affs_secondary_stats *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_SECONDARY_H */
@@ -0,0 +1,111 @@
+#ifndef AFFS_SNAPSHOT_H
+#define AFFS_SNAPSHOT_H
+
+#include "affs_rebuild.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* ============================================================
+   Primary-index snapshot at a pinned checkpoint (Indexes 6.1)
+
+   An optional side file written next to a pinned checkpoint: the
+   primary index as of that checkpoint, sorted by ObjectId, with the
+   checkpoint's SegmentPositions. It is a cache, never truth (see
+   Checkpoints 2.2): a missing, stale or damaged snapshot is
+   dropped and the index rebuilt from the segments.
+
+   Layout, little-endian:
+
+     0  Magic           4   "AFIX"
+     4  Version         2   1
+     6  EntrySize       2   48
+     8  CheckpointId    8
+    16  LogPosition     8   PrimaryIndexLogPosition of the checkpoint
+    24  EntryCount      8
+    32  SegmentCount    4
+    36  BodyCrc         4   CRC32C of everything after the header
+    40  Reserved       20   0
+    60  HeaderCrc       4   CRC32C of bytes 0..59
+    64  SegmentPositions: SegmentCount x (SegmentId 8, Position 8),
+        by segment id, zero-padded to a multiple of 64
+     .  Entries: EntryCount x 48, by ObjectId (hi, then lo):
+          0 IdLo 8, 8 IdHi 8, 16 Offset 8, 24 Length 8,
+         32 Sequence 8, 40 SegmentId 4, 44 Flags 4
+
+   Fixed-size sorted entries make the file usable in place: it is
+   mapped, not parsed, and affs_snapshot_find() binary-searches the
+   mapping. Startup maps the snapshot and scans only the segment
+   bytes written after the checkpoint (affs_snapshot_recover()).
+   ============================================================ */
+
+#define AFFS_SNAPSHOT_HEADER_SIZE 64
+#define AFFS_SNAPSHOT_ENTRY_SIZE 48
+
+/* Open flags */
+#define AFFS_SNAPSHOT_VERIFY 0x1u   /* check BodyCrc (reads the whole file once) */
+
+typedef struct affs_segment_position {
+    uint64_t segment_id;
+    uint64_t position;          /* end of the last valid record, relative to the segment */
+} affs_segment_position;
+
+typedef struct affs_snapshot affs_snapshot;
+
+typedef struct affs_snapshot_info {
+    uint64_t checkpoint_id;
+    uint64_t log_position;
+    uint64_t count;
+    uint32_t segments;
+    uint64_t bytes;             /* file size */
+} affs_snapshot_info;
+
+/*
+ * Write a snapshot to `path` atomically (temporary file, fsync,
+ * rename). `entries` must be sorted by id without duplicates, as
+ * affs_rebuild() and affs_snapshot_recover() return them; tombstone
+ * entries are left out. Segment ids must fit in 32 bits.
+ */
+affs_io_result affs_snapshot_write(const char *path, uint64_t checkpoint_id, uint64_t log_position,
+                                   const affs_segment_position *positions, size_t npositions,
+                                   const affs_index_entry *entries, size_t count);
+
+/*
+ * Map a snapshot. The header is always checked; the body with
+ * AFFS_SNAPSHOT_VERIFY. A damaged file fails with PERMANENT and
+ * os_error EBADMSG. The caller compares the checkpoint id with the
+ * pinned checkpoint it recovers from.
+ */
+affs_io_result affs_snapshot_open(affs_snapshot **out, const char *path, uint32_t flags);
+
+void affs_snapshot_close(affs_snapshot *s);
+
+void affs_snapshot_info_get(const affs_snapshot *s, affs_snapshot_info *out);
+
+/* Checkpoint position of a segment; 0 if the snapshot does not know it. */
+uint64_t affs_snapshot_position(const affs_snapshot *s, uint64_t segment_id);
+
+/* Entry i (0 <= i < count). */
+void affs_snapshot_entry(const affs_snapshot *s, uint64_t i, affs_index_entry *out);
+
+/* 1 and *out filled if `id` is in the snapshot, else 0. */
+int affs_snapshot_find(const affs_snapshot *s, affs_object_id id, affs_index_entry *out);
+
+/*
+ * The index now: the snapshot plus the segment tails. Each segment
+ * is scanned from its checkpoint position (from `start` if the
+ * snapshot does not know the segment) to `end`, and what the tail
+ * holds replaces the snapshot's entry (higher sequence wins, the
+ * tail on a tie; tombstones delete). `out` is sorted by id like an
+ * affs_rebuild() result; its stats describe the tail scan, with the
+ * snapshot entries the tail replaced counted as superseded.
+ */
+affs_io_result affs_snapshot_recover(const affs_snapshot *s, const affs_rebuild_segment *segs, size_t nsegs,
+                                     const affs_rebuild_options *opt, affs_rebuild_result *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AFFS_SNAPSHOT_H */
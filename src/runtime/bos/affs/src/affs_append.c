@@ -0,0 +1,314 @@
+#define _GNU_SOURCE
+#include "../include/affs_append.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_BATCH_BYTES (4u * 1024u * 1024u)
+#define DEFAULT_BATCH_RECORDS 65536u
+#define MIN_BUFFER_ALIGN 64
+
+/* ---------- types ---------- */
+
+/* One commit being filled by writers or written by the committer. */
+typedef struct stage {
+    uint8_t *buf;
+    size_t cap;
+    size_t used;
+    uint32_t records;
+    uint64_t offset;            /* file offset of buf[0] */
+    uint64_t seq;               /* commit sequence number */
+    uint64_t first_ns;          /* first reservation */
+    _Atomic uint32_t copying;   /* reservations not yet copied in */
+} stage;
+
+struct affs_appender {
+    affs_backend *b;
+    uint32_t align;
+    size_t mem_align;
+    uint32_t window_us;
+    size_t max_bytes;
+    uint32_t max_records;
+    int no_flush;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work;        /* committer: records arrived, a stage filled up, stop */
+    pthread_cond_t space;       /* writers: the filling stage was taken */
+    pthread_cond_t durable;     /* waiters: a commit landed or failed */
+    pthread_t thread;
+
+    stage st[2];
+    int fill;                   /* stage writers reserve in */
+    unsigned blocked;           /* writers waiting for space */
+    uint64_t tail;
+    uint64_t durable_seq;       /* commits <= this are durable */
+    uint64_t failed_seq;        /* first failed commit, 0 = none */
+    affs_io_result failure;
+    int stopping;
+
+    affs_append_stats stats;
+};
+
+/* ---------- helpers ---------- */
+
+static uint8_t *buffer_alloc(size_t align, size_t size) {
+    void *p = NULL;
+    return posix_memalign(&p, align, size) == 0 ? (uint8_t *)p : NULL;
+}
+
+static int failed_for(const affs_appender *a, uint64_t seq) {
+    return a->failed_seq != 0 && a->failed_seq <= seq;
+}
+
+static void wait_copies(stage *s) {
+    while (atomic_load_explicit(&s->copying, memory_order_acquire) != 0) sched_yield();
+}
+
+/* ---------- committer ---------- */
+
+static void *committer_main(void *arg) {
+    affs_appender *a = (affs_appender *)arg;
+    pthread_mutex_lock(&a->lock);
+    for (;;) {
+        stage *s = &a->st[a->fill];
+        while (!a->stopping && (s->used == 0 || a->failed_seq)) pthread_cond_wait(&a->work, &a->lock);
+        if (s->used == 0 || a->failed_seq) break;   /* stopping with nothing to commit */
+
+        if (a->window_us && !a->stopping) {
+            uint64_t deadline = s->first_ns + (uint64_t)a->window_us * 1000u;
+            struct timespec ts = { (time_t)(deadline / 1000000000u), (long)(deadline % 1000000000u) };
+            while (!a->stopping && !a->blocked && s->records < a->max_records && affs_io_now_ns() < deadline) {
+                if (pthread_cond_timedwait(&a->work, &a->lock, &ts) == ETIMEDOUT) break;
+            }
+        }
+
+        /* take the stage; writers move on to the other one */
+        a->fill ^= 1;
+        stage *next = &a->st[a->fill];
+        next->used = 0;
+        next->records = 0;
+        next->seq = s->seq + 1;
+        pthread_cond_broadcast(&a->space);
+        pthread_mutex_unlock(&a->lock);
+
+        wait_copies(s);
+        uint64_t t = affs_io_now_ns();
+        affs_io_result r = affs_backend_write(a->b, s->offset, s->buf, s->used);
+        if (r.category == AFFS_IO_OK && r.bytes != s->used) r = affs_io_result_from_errno(ENOSPC);
+        if (r.category == AFFS_IO_OK && !a->no_flush) r = affs_backend_flush(a->b);
+        t = affs_io_now_ns() - t;
+
+        pthread_mutex_lock(&a->lock);
+        a->stats.commits++;
+        a->stats.records += s->records;
+        a->stats.bytes += s->used;
+        a->stats.commit_ns += t;
+        if (s->records > a->stats.max_commit_records) a->stats.max_commit_records = s->records;
+        if (r.category == AFFS_IO_OK) {
+            a->durable_seq = s->seq;
+        } else {
+            a->failed_seq = s->seq;
+            a->failure = r;
+            pthread_cond_broadcast(&a->space);
+        }
+        pthread_cond_broadcast(&a->durable);
+    }
+    pthread_mutex_unlock(&a->lock);
+    return NULL;
+}
+
+/* ---------- public API ---------- */
+
+affs_io_result affs_appender_open(affs_appender **out, affs_backend *b, uint64_t tail, const affs_append_options *opt) {
+    if (!out) return affs_io_result_from_errno(EINVAL);
+    *out = NULL;
+    if (!b) return affs_io_result_from_errno(EINVAL);
+    affs_append_options o = opt ? *opt : affs_append_options_default();
+
+    affs_geometry g;
+    affs_io_result r = affs_backend_geometry(b, &g);
+    if (r.category != AFFS_IO_OK) return r;
+    uint32_t align = o.align ? o.align : (g.write_align ? g.write_align : 1);
+    if (align % (g.write_align ? g.write_align : 1) != 0 || tail % align != 0) return affs_io_result_from_errno(EINVAL);
+
+    affs_appender *a = (affs_appender *)calloc(1, sizeof(affs_appender));
+    if (!a) return affs_io_result_from_errno(ENOMEM);
+    a->b = b;
+    a->align = align;
+    a->mem_align = g.mem_align > MIN_BUFFER_ALIGN ? g.mem_align : MIN_BUFFER_ALIGN;
+    a->window_us = o.window_us;
+    a->max_bytes = o.max_batch_bytes ? o.max_batch_bytes : DEFAULT_BATCH_BYTES;
+    a->max_bytes = (a->max_bytes + align - 1) / align * align;
+    a->max_records = o.max_batch_records ? o.max_batch_records : DEFAULT_BATCH_RECORDS;
+    a->no_flush = o.no_flush;
+    a->tail = tail;
+    a->st[0].seq = 1;
+    for (int i = 0; i < 2; i++) {
+        a->st[i].cap = a->max_bytes;
+        a->st[i].buf = buffer_alloc(a->mem_align, a->max_bytes);
+        atomic_init(&a->st[i].copying, 0);
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_mutex_init(&a->lock, NULL);
+    pthread_cond_init(&a->work, &ca);
+    pthread_cond_init(&a->space, NULL);
+    pthread_cond_init(&a->durable, NULL);
+    pthread_condattr_destroy(&ca);
+
+    int e = (a->st[0].buf && a->st[1].buf) ? pthread_create(&a->thread, NULL, committer_main, a) : ENOMEM;
+    if (e != 0) {
+        free(a->st[0].buf);
+        free(a->st[1].buf);
+        pthread_mutex_destroy(&a->lock);
+        pthread_cond_destroy(&a->work);
+        pthread_cond_destroy(&a->space);
+        pthread_cond_destroy(&a->durable);
+        free(a);
+        return affs_io_result_from_errno(e);
+    }
+    *out = a;
+    return affs_io_result_ok();
+}
+
+affs_io_result affs_appender_close(affs_appender *a) {
+    if (!a) return affs_io_result_ok();
+    pthread_mutex_lock(&a->lock);
+    a->stopping = 1;
+    pthread_cond_broadcast(&a->work);
+    pthread_cond_broadcast(&a->space);
+    pthread_mutex_unlock(&a->lock);
+    pthread_join(a->thread, NULL);
+
+    affs_io_result r = a->failed_seq ? a->failure : affs_io_result_ok();
+    for (int i = 0; i < 2; i++) {
+        wait_copies(&a->st[i]);
+        free(a->st[i].buf);
+    }
+    pthread_mutex_destroy(&a->lock);
+    pthread_cond_destroy(&a->work);
+    pthread_cond_destroy(&a->space);
+    pthread_cond_destroy(&a->durable);
+    free(a);
+    return r;
+}
+
+affs_io_result affs_append_submit(affs_appender *a, const affs_record_header *h, const void *payload, size_t len,
+                                  affs_append_ticket *ticket) {
+    uint64_t framed = affs_record_framed_size(len, a->align);
+    if (framed == 0 || framed > SIZE_MAX) return affs_io_result_from_errno(EFBIG);
+    uint64_t t = affs_io_now_ns();
+
+    pthread_mutex_lock(&a->lock);
+    stage *s;
+    for (;;) {
+        if (a->failed_seq) {
+            affs_io_result r = a->failure;
+            pthread_mutex_unlock(&a->lock);
+            return r;
+        }
+        if (a->stopping) {
+            pthread_mutex_unlock(&a->lock);
+            return affs_io_result_from_errno(ESHUTDOWN);
+        }
+        s = &a->st[a->fill];
+        if (s->records < a->max_records && s->used + framed <= s->cap) break;
+        if (s->used == 0) {
+            /* a record larger than the batch: grow this (empty, so unshared) buffer */
+            uint8_t *p = buffer_alloc(a->mem_align, (size_t)framed);
+            if (!p) {
+                pthread_mutex_unlock(&a->lock);
+                return affs_io_result_from_errno(ENOMEM);
+            }
+            free(s->buf);
+            s->buf = p;
+            s->cap = (size_t)framed;
+            break;
+        }
+        a->blocked++;
+        pthread_cond_signal(&a->work);
+        pthread_cond_wait(&a->space, &a->lock);
+        a->blocked--;
+    }
+
+    if (s->used == 0) {
+        s->offset = a->tail;
+        s->first_ns = t;
+        pthread_cond_signal(&a->work);
+    } else if (s->records + 1 >= a->max_records || s->used + framed >= a->max_bytes) {
+        pthread_cond_signal(&a->work);
+    }
+    size_t at = s->used;
+    s->used += (size_t)framed;
+    s->records++;
+    a->tail += framed;
+    atomic_fetch_add_explicit(&s->copying, 1, memory_order_relaxed);
+    affs_append_ticket tk = { s->seq, s->offset + at, framed, t };
+    pthread_mutex_unlock(&a->lock);
+
+    /* the buffer cannot move or be written while `copying` is held */
+    affs_record_header hh = *h;
+    affs_record_frame(s->buf + at, &hh, payload, len, a->align);
+    atomic_fetch_sub_explicit(&s->copying, 1, memory_order_release);
+
+    if (ticket) *ticket = tk;
+    affs_io_result r = affs_io_result_ok();
+    r.bytes = framed;
+    return r;
+}
+
+affs_io_result affs_append_wait(affs_appender *a, const affs_append_ticket *ticket) {
+    pthread_mutex_lock(&a->lock);
+    while (a->durable_seq < ticket->commit && !failed_for(a, ticket->commit)) pthread_cond_wait(&a->durable, &a->lock);
+    affs_io_result r = failed_for(a, ticket->commit) ? a->failure : affs_io_result_ok();
+    uint64_t t = affs_io_now_ns() - ticket->submit_ns;
+    a->stats.waited++;
+    a->stats.wait_ns += t;
+    int bucket = 0;
+    for (uint64_t us = t / 1000u; us > 1 && bucket < AFFS_APPEND_HIST_BUCKETS - 1; us >>= 1) bucket++;
+    a->stats.latency_hist[bucket]++;
+    pthread_mutex_unlock(&a->lock);
+    if (r.category == AFFS_IO_OK) r.bytes = ticket->framed_length;
+    r.latency_ns = t;
+    return r;
+}
+
+affs_io_result affs_append(affs_appender *a, const affs_record_header *h, const void *payload, size_t len,
+                           uint64_t *offset) {
+    affs_append_ticket t;
+    affs_io_result r = affs_append_submit(a, h, payload, len, &t);
+    if (r.category != AFFS_IO_OK) return r;
+    if (offset) *offset = t.offset;
+    return affs_append_wait(a, &t);
+}
+
+affs_io_result affs_appender_sync(affs_appender *a) {
+    pthread_mutex_lock(&a->lock);
+    const stage *s = &a->st[a->fill];
+    uint64_t target = s->used ? s->seq : s->seq - 1;
+    pthread_cond_signal(&a->work);
+    while (a->durable_seq < target && !failed_for(a, target)) pthread_cond_wait(&a->durable, &a->lock);
+    affs_io_result r = failed_for(a, target) ? a->failure : affs_io_result_ok();
+    pthread_mutex_unlock(&a->lock);
+    return r;
+}
+
+uint64_t affs_appender_tail(affs_appender *a) {
+    pthread_mutex_lock(&a->lock);
+    uint64_t t = a->tail;
+    pthread_mutex_unlock(&a->lock);
+    return t;
+}
+
+void affs_appender_stats_get(affs_appender *a, affs_append_stats *out) {
+    pthread_mutex_lock(&a->lock);
+    *out = a->stats;
+    pthread_mutex_unlock(&a->lock);
+}
@@ -0,0 +1,650 @@
+#define _GNU_SOURCE
+#include "../include/affs_backend.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <linux/fs.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_QUEUE_DEPTH 128
+#define DEFAULT_THREADS 4
+#define DEFAULT_MAX_ATTEMPTS 3
+#define MAX_TRANSFER (1u << 30)     /* per submission; the rest is resubmitted */
+
+/* ---------- types ---------- */
+
+typedef struct ring {
+    pthread_mutex_t lock;
+    int fd;                         /* -1 until created */
+    int failed;                     /* creation failed: do not retry */
+    unsigned entries;
+
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    size_t *queue;                  /* requests waiting for a submission (circular) */
+    uint32_t *fails;                /* failed submissions per request */
+    size_t cap;
+} ring;
+
+typedef struct batch {
+    affs_io_request *reqs;
+    size_t count;
+    _Atomic size_t next;
+} batch;
+
+struct affs_backend {
+    int fd;
+    unsigned flags;
+    int direct;
+    affs_io_engine engine;
+    uint32_t depth;
+    uint32_t max_attempts;
+    uint32_t dio_offset_align;
+    uint32_t dio_mem_align;
+
+    ring rings[AFFS_BACKEND_MAX_RINGS];
+
+    /* fallback pool */
+    pthread_t *workers;
+    unsigned worker_count;
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_wake;
+    pthread_cond_t pool_idle;
+    pthread_mutex_t submit_lock;    /* one pool batch at a time */
+    batch *current;
+    uint64_t generation;
+    unsigned busy;                  /* workers inside `current` */
+    int stopping;
+
+    _Atomic uint64_t st_reads, st_writes, st_read_bytes, st_write_bytes;
+    _Atomic uint64_t st_read_errors, st_write_errors, st_retries, st_flushes;
+    _Atomic uint64_t st_last_error_ns, st_read_latency_ns, st_write_latency_ns;
+};
+
+/* ---------- helpers ---------- */
+
+static void begin(affs_io_request *r) {
+    r->result = affs_io_result_ok();
+    r->result.latency_ns = affs_io_now_ns();    /* start time until settle() */
+}
+
+/* Final outcome of `r` once it stopped with errno `e` (0 = done). */
+static void settle(affs_backend *b, affs_io_request *r, int e) {
+    affs_io_result *res = &r->result;
+    uint64_t t = affs_io_now_ns();
+    res->latency_ns = t - res->latency_ns;
+    if (e) {
+        res->cause = affs_io_category_from_errno(e);
+        res->category = res->bytes ? AFFS_IO_PARTIAL : res->cause;
+        res->os_error = e;
+        atomic_store_explicit(&b->st_last_error_ns, t, memory_order_relaxed);
+    }
+    int w = r->op == AFFS_OP_WRITE;
+    atomic_fetch_add_explicit(w ? &b->st_writes : &b->st_reads, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(w ? &b->st_write_bytes : &b->st_read_bytes, res->bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(w ? &b->st_write_latency_ns : &b->st_read_latency_ns, res->latency_ns, memory_order_relaxed);
+    if (e) atomic_fetch_add_explicit(w ? &b->st_write_errors : &b->st_read_errors, 1, memory_order_relaxed);
+    if (res->attempts > 1) atomic_fetch_add_explicit(&b->st_retries, res->attempts - 1, memory_order_relaxed);
+}
+
+/* pread()/pwrite() until done, end of file, or a failure past the retry budget. */
+static void run_sync(affs_backend *b, affs_io_request *r) {
+    begin(r);
+    uint32_t fails = 0;
+    int e = 0;
+    uint8_t *p = (uint8_t *)r->buffer;
+    while (r->result.bytes < r->length) {
+        size_t left = r->length - (size_t)r->result.bytes;
+        if (left > MAX_TRANSFER) left = MAX_TRANSFER;
+        off_t at = (off_t)(r->offset + r->result.bytes);
+        r->result.attempts++;
+        ssize_t n = r->op == AFFS_OP_WRITE ? pwrite(b->fd, p + r->result.bytes, left, at)
+                                           : pread(b->fd, p + r->result.bytes, left, at);
+        if (n > 0) {
+            r->result.bytes += (uint64_t)n;
+            continue;
+        }
+        if (n == 0) {
+            if (r->op == AFFS_OP_READ) break;   /* end of file */
+            e = EIO;
+        } else {
+            e = errno;
+        }
+        if (affs_io_retryable(affs_io_category_from_errno(e)) && ++fails < b->max_attempts) {
+            e = 0;
+            continue;
+        }
+        break;
+    }
+    settle(b, r, e);
+}
+
+/* ---------- io_uring ---------- */
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, NULL, 0);
+}
+
+static void ring_unmap(ring *r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_size);
+    if (r->cq_map && r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_size);
+    if (r->sq_map) munmap(r->sq_map, r->sq_map_size);
+    if (r->fd >= 0) close(r->fd);
+    r->sqes = NULL;
+    r->sq_map = r->cq_map = NULL;
+    r->fd = -1;
+}
+
+/* Returns 0 or an errno value. */
+static int ring_create(ring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = sys_setup(entries, &p);
+    if (fd < 0) return errno;
+    r->fd = fd;
+    r->entries = p.sq_entries;
+
+    r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && r->cq_map_size > r->sq_map_size) r->sq_map_size = r->cq_map_size;
+
+    void *sq = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) goto fail;
+    r->sq_map = sq;
+    void *cq = sq;
+    if (!single) {
+        cq = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) goto fail;
+    }
+    r->cq_map = cq;
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) goto fail;
+    r->sqes = (struct io_uring_sqe *)sqes;
+
+    uint8_t *s = (uint8_t *)sq, *c = (uint8_t *)cq;
+    r->sq_head = (unsigned *)(s + p.sq_off.head);
+    r->sq_tail = (unsigned *)(s + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(s + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(s + p.sq_off.array);
+    r->cq_head = (unsigned *)(c + p.cq_off.head);
+    r->cq_tail = (unsigned *)(c + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(c + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(c + p.cq_off.cqes);
+    for (unsigned i = 0; i < p.sq_entries; i++) r->sq_array[i] = i;    /* SQE i sits in slot i */
+    return 0;
+
+fail: {
+        int e = errno;
+        ring_unmap(r);
+        return e;
+    }
+}
+
+static int ring_reserve(ring *r, size_t n) {
+    if (n <= r->cap) return 1;
+    size_t *q = (size_t *)realloc(r->queue, n * sizeof(size_t));
+    if (!q) return 0;
+    r->queue = q;
+    uint32_t *f = (uint32_t *)realloc(r->fails, n * sizeof(uint32_t));
+    if (!f) return 0;
+    r->fails = f;
+    r->cap = n;
+    return 1;
+}
+
+/* A ring for this batch, locked; NULL when none can be had. */
+static ring *ring_acquire(affs_backend *b) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < AFFS_BACKEND_MAX_RINGS; i++) {
+            ring *r = &b->rings[i];
+            if (pthread_mutex_trylock(&r->lock) != 0) continue;
+            if (r->fd < 0 && !r->failed && pass == 1) r->failed = ring_create(r, b->depth) != 0;
+            if (r->fd >= 0) return r;
+            pthread_mutex_unlock(&r->lock);
+        }
+    }
+    /* all busy: wait for the first one */
+    pthread_mutex_lock(&b->rings[0].lock);
+    return &b->rings[0];
+}
+
+static void prep(struct io_uring_sqe *sqe, int fd, affs_io_request *r, size_t index) {
+    size_t left = r->length - (size_t)r->result.bytes;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = r->op == AFFS_OP_WRITE ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)((uint8_t *)r->buffer + r->result.bytes);
+    sqe->len = (uint32_t)(left > MAX_TRANSFER ? MAX_TRANSFER : left);
+    sqe->off = r->offset + r->result.bytes;
+    sqe->user_data = index;
+}
+
+static void ring_run(affs_backend *b, ring *r, affs_io_request *reqs, size_t n) {
+    size_t qhead = 0, queued = 0, left = 0;
+    for (size_t i = 0; i < n; i++) {
+        begin(&reqs[i]);
+        r->fails[i] = 0;
+        if (reqs[i].length == 0) {
+            settle(b, &reqs[i], 0);
+        } else {
+            r->queue[queued++] = i;
+            left++;
+        }
+    }
+
+    unsigned inflight = 0, limit = b->depth < r->entries ? b->depth : r->entries;
+    while (left) {
+        /* fill free submission slots */
+        unsigned tail = *r->sq_tail;
+        unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        while (queued && inflight < limit && tail - head < r->entries) {
+            size_t i = r->queue[qhead];
+            qhead = qhead + 1 == n ? 0 : qhead + 1;
+            queued--;
+            reqs[i].result.attempts++;
+            prep(&r->sqes[tail & *r->sq_mask], b->fd, &reqs[i], i);
+            tail++;
+            inflight++;
+        }
+        __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+        unsigned pending = tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        if (sys_enter(r->fd, pending, 1, IORING_ENTER_GETEVENTS) < 0) {
+            int e = errno;
+            if (e != EINTR && e != EAGAIN && e != EBUSY) {
+                /* ring unusable: take back unconsumed entries, wait out what the kernel
+                   holds, finish the rest with pread/pwrite */
+                unsigned sh = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+                for (unsigned s = sh; s != tail; s++, inflight--) {
+                    r->queue[(qhead + queued++) % n] = (size_t)r->sqes[s & *r->sq_mask].user_data;
+                }
+                while (inflight) {
+                    unsigned ch = *r->cq_head;
+                    unsigned ct = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+                    if (ch == ct) {
+                        sched_yield();
+                        continue;
+                    }
+                    inflight -= ct - ch;
+                    /* results of these are discarded: redo them synchronously */
+                    for (; ch != ct; ch++) r->queue[(qhead + queued++) % n] = (size_t)r->cqes[ch & *r->cq_mask].user_data;
+                    __atomic_store_n(r->cq_head, ch, __ATOMIC_RELEASE);
+                }
+                ring_unmap(r);
+                r->failed = 1;
+                for (; queued; queued--, qhead = (qhead + 1) % n) {
+                    affs_io_request *q = &reqs[r->queue[qhead]];
+                    affs_io_result keep = q->result;
+                    run_sync(b, q);
+                    q->result.attempts += keep.attempts;
+                }
+                return;
+            }
+        }
+
+        /* reap */
+        unsigned ch = *r->cq_head;
+        unsigned ct = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        for (; ch != ct; ch++) {
+            struct io_uring_cqe *cqe = &r->cqes[ch & *r->cq_mask];
+            size_t i = (size_t)cqe->user_data;
+            int res = cqe->res;
+            affs_io_request *q = &reqs[i];
+            inflight--;
+
+            int e = 0, again = 0;
+            if (res > 0) {
+                q->result.bytes += (uint64_t)res;
+                again = q->result.bytes < q->length;
+            } else if (res == 0) {
+                if (q->op == AFFS_OP_WRITE) e = EIO;    /* else: end of file */
+            } else {
+                e = -res;
+            }
+            if (e && affs_io_retryable(affs_io_category_from_errno(e)) && ++r->fails[i] < b->max_attempts) {
+                e = 0;
+                again = 1;
+            }
+            if (again) {
+                r->queue[(qhead + queued++) % n] = i;
+            } else {
+                settle(b, q, e);
+                left--;
+            }
+        }
+        __atomic_store_n(r->cq_head, ch, __ATOMIC_RELEASE);
+    }
+}
+
+/* ---------- thread pool ---------- */
+
+static void batch_work(affs_backend *b, batch *bt) {
+    size_t i;
+    while ((i = atomic_fetch_add_explicit(&bt->next, 1, memory_order_relaxed)) < bt->count) run_sync(b, &bt->reqs[i]);
+}
+
+static void *worker_main(void *arg) {
+    affs_backend *b = (affs_backend *)arg;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&b->pool_lock);
+    for (;;) {
+        while (!b->stopping && (!b->current || b->generation == seen)) pthread_cond_wait(&b->pool_wake, &b->pool_lock);
+        if (b->stopping) break;
+        batch *bt = b->current;
+        seen = b->generation;
+        b->busy++;
+        pthread_mutex_unlock(&b->pool_lock);
+
+        batch_work(b, bt);
+
+        pthread_mutex_lock(&b->pool_lock);
+        if (--b->busy == 0) pthread_cond_broadcast(&b->pool_idle);
+    }
+    pthread_mutex_unlock(&b->pool_lock);
+    return NULL;
+}
+
+static void pool_run(affs_backend *b, affs_io_request *reqs, size_t n) {
+    batch bt;
+    bt.reqs = reqs;
+    bt.count = n;
+    atomic_init(&bt.next, 0);
+
+    pthread_mutex_lock(&b->submit_lock);
+    if (b->worker_count && n > 1) {
+        pthread_mutex_lock(&b->pool_lock);
+        b->current = &bt;
+        b->generation++;
+        pthread_cond_broadcast(&b->pool_wake);
+        pthread_mutex_unlock(&b->pool_lock);
+    }
+
+    batch_work(b, &bt);
+
+    if (b->worker_count && n > 1) {
+        /* no worker may still hold `bt` once we return */
+        pthread_mutex_lock(&b->pool_lock);
+        b->current = NULL;
+        while (b->busy) pthread_cond_wait(&b->pool_idle, &b->pool_lock);
+        pthread_mutex_unlock(&b->pool_lock);
+    }
+    pthread_mutex_unlock(&b->submit_lock);
+}
+
+static void pool_start(affs_backend *b, unsigned threads) {
+    b->workers = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (!b->workers) return;
+    /* the caller works too, so `threads` requests run at once with threads - 1 workers */
+    for (unsigned i = 0; i + 1 < threads; i++) {
+        if (pthread_create(&b->workers[b->worker_count], NULL, worker_main, b) != 0) break;
+        b->worker_count++;
+    }
+}
+
+static void pool_stop(affs_backend *b) {
+    pthread_mutex_lock(&b->pool_lock);
+    b->stopping = 1;
+    pthread_cond_broadcast(&b->pool_wake);
+    pthread_mutex_unlock(&b->pool_lock);
+    for (unsigned i = 0; i < b->worker_count; i++) pthread_join(b->workers[i], NULL);
+    free(b->workers);
+    b->workers = NULL;
+    b->worker_count = 0;
+}
+
+/* ---------- geometry ---------- */
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/* Direct I/O alignment of the open file; 0 when the kernel does not say. */
+static void dio_alignment(affs_backend *b, const struct stat *st) {
+    b->dio_offset_align = 0;
+    b->dio_mem_align = 0;
+    if (S_ISBLK(st->st_mode)) {
+        int ss = 0;
+        if (ioctl(b->fd, BLKSSZGET, &ss) == 0 && ss > 0) b->dio_offset_align = b->dio_mem_align = (uint32_t)ss;
+        return;
+    }
+#ifdef STATX_DIOALIGN
+    struct statx sx;
+    if (statx(b->fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &sx) == 0 && (sx.stx_mask & STATX_DIOALIGN)) {
+        b->dio_offset_align = sx.stx_dio_offset_align;
+        b->dio_mem_align = sx.stx_dio_mem_align;
+    }
+#endif
+}
+
+/* ---------- public API ---------- */
+
+affs_io_result affs_backend_open(affs_backend **out, const char *path, const affs_backend_options *opt) {
+    if (!out) return affs_io_result_from_errno(EINVAL);
+    *out = NULL;
+    if (!path) return affs_io_result_from_errno(EINVAL);
+    affs_backend_options o = opt ? *opt : affs_backend_options_default();
+    if (o.flags & AFFS_BACKEND_CREATE) o.flags |= AFFS_BACKEND_WRITE;
+
+    affs_backend *b = (affs_backend *)calloc(1, sizeof(affs_backend));
+    if (!b) return affs_io_result_from_errno(ENOMEM);
+    b->flags = o.flags;
+    b->depth = o.queue_depth ? o.queue_depth : DEFAULT_QUEUE_DEPTH;
+    b->max_attempts = o.max_attempts ? o.max_attempts : DEFAULT_MAX_ATTEMPTS;
+    for (int i = 0; i < AFFS_BACKEND_MAX_RINGS; i++) {
+        pthread_mutex_init(&b->rings[i].lock, NULL);
+        b->rings[i].fd = -1;
+    }
+    pthread_mutex_init(&b->pool_lock, NULL);
+    pthread_mutex_init(&b->submit_lock, NULL);
+    pthread_cond_init(&b->pool_wake, NULL);
+    pthread_cond_init(&b->pool_idle, NULL);
+
+    int mode = O_CLOEXEC | ((o.flags & AFFS_BACKEND_WRITE) ? O_RDWR : O_RDONLY) | ((o.flags & AFFS_BACKEND_CREATE) ? O_CREAT : 0);
+    b->fd = -1;
+    if (o.flags & AFFS_BACKEND_DIRECT) {
+        b->fd = open(path, mode | O_DIRECT, 0644);
+        b->direct = b->fd >= 0;
+    }
+    if (b->fd < 0 && (!(o.flags & AFFS_BACKEND_DIRECT) || errno == EINVAL)) b->fd = open(path, mode, 0644);
+    if (b->fd < 0) {
+        affs_io_result r = affs_io_result_from_errno(errno);
+        affs_backend_close(b);
+        return r;
+    }
+
+    struct stat st;
+    if (fstat(b->fd, &st) != 0) {
+        affs_io_result r = affs_io_result_from_errno(errno);
+        affs_backend_close(b);
+        return r;
+    }
+    dio_alignment(b, &st);
+    if (b->direct && !b->dio_offset_align) {
+        /* no reported unit: the common logical block size is the safe choice */
+        b->dio_offset_align = 4096;
+        b->dio_mem_align = 4096;
+    }
+
+    b->engine = o.engine == AFFS_ENGINE_THREADS ? AFFS_ENGINE_THREADS : AFFS_ENGINE_URING;
+    if (b->engine == AFFS_ENGINE_URING) {
+        int e = ring_create(&b->rings[0], b->depth);
+        if (e != 0) {
+            if (o.engine == AFFS_ENGINE_URING) {
+                affs_backend_close(b);
+                return affs_io_result_from_errno(e);
+            }
+            b->rings[0].failed = 1;
+            b->engine = AFFS_ENGINE_THREADS;
+        }
+    }
+    if (b->engine == AFFS_ENGINE_THREADS) pool_start(b, o.threads ? o.threads : DEFAULT_THREADS);
+
+    *out = b;
+    return affs_io_result_ok();
+}
+
+void affs_backend_close(affs_backend *b) {
+    if (!b) return;
+    if (b->workers) pool_stop(b);
+    for (int i = 0; i < AFFS_BACKEND_MAX_RINGS; i++) {
+        ring_unmap(&b->rings[i]);
+        free(b->rings[i].queue);
+        free(b->rings[i].fails);
+        pthread_mutex_destroy(&b->rings[i].lock);
+    }
+    pthread_mutex_destroy(&b->pool_lock);
+    pthread_mutex_destroy(&b->submit_lock);
+    pthread_cond_destroy(&b->pool_wake);
+    pthread_cond_destroy(&b->pool_idle);
+    if (b->fd >= 0) close(b->fd);
+    free(b);
+}
+
+affs_io_engine affs_backend_engine(const affs_backend *b) {
+    return b->engine;
+}
+
+affs_io_result affs_backend_geometry(affs_backend *b, affs_geometry *out) {
+    memset(out, 0, sizeof(*out));
+    struct stat st;
+    if (fstat(b->fd, &st) != 0) return affs_io_result_from_errno(errno);
+
+    out->size = (uint64_t)st.st_size;
+    out->optimal_io = (uint32_t)st.st_blksize;
+    if (S_ISBLK(st.st_mode)) {
+        uint64_t bytes = 0;
+        int pbs = 0;
+        if (ioctl(b->fd, BLKGETSIZE64, &bytes) == 0) out->size = bytes;
+        /* a physical sector is written whole or not at all */
+        if (ioctl(b->fd, BLKPBSZGET, &pbs) == 0 && pbs > 0) out->atomic_write = (uint32_t)pbs;
+    }
+    out->direct = b->direct;
+    out->read_align = out->write_align = b->direct ? b->dio_offset_align : 1;
+    out->mem_align = b->direct ? b->dio_mem_align : 1;
+    out->identity = mix64((uint64_t)st.st_dev ^ mix64((uint64_t)st.st_ino));
+    return affs_io_result_ok();
+}
+
+affs_io_result affs_backend_read(affs_backend *b, uint64_t offset, void *buffer, size_t length) {
+    affs_io_request r = { AFFS_OP_READ, buffer, offset, length, { 0 } };
+    run_sync(b, &r);
+    return r.result;
+}
+
+affs_io_result affs_backend_write(affs_backend *b, uint64_t offset, const void *buffer, size_t length) {
+    affs_io_request r = { AFFS_OP_WRITE, (void *)buffer, offset, length, { 0 } };
+    run_sync(b, &r);
+    return r.result;
+}
+
+affs_io_result affs_backend_flush(affs_backend *b) {
+    uint64_t t = affs_io_now_ns();
+    affs_io_result r = affs_io_result_ok();
+    int rc;
+    do {
+        r.attempts++;
+        rc = (b->flags & AFFS_BACKEND_FULL_SYNC) ? fsync(b->fd) : fdatasync(b->fd);
+    } while (rc != 0 && errno == EINTR && r.attempts < b->max_attempts);
+    if (rc != 0) {
+        /* durability not guaranteed: say so (EIO here may mean lost writes) */
+        int e = errno;
+        r = affs_io_result_from_errno(e);
+        atomic_store_explicit(&b->st_last_error_ns, affs_io_now_ns(), memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&b->st_flushes, 1, memory_order_relaxed);
+    r.latency_ns = affs_io_now_ns() - t;
+    return r;
+}
+
+affs_io_result affs_backend_submit(affs_backend *b, affs_io_request *reqs, size_t count) {
+    uint64_t t = affs_io_now_ns();
+    if (!reqs && count) return affs_io_result_from_errno(EINVAL);
+
+    ring *r = NULL;
+    if (b->engine == AFFS_ENGINE_URING) {
+        r = ring_acquire(b);
+        if (r->fd < 0 || !ring_reserve(r, count)) {
+            pthread_mutex_unlock(&r->lock);
+            r = NULL;
+        }
+    }
+    if (r) {
+        ring_run(b, r, reqs, count);
+        pthread_mutex_unlock(&r->lock);
+    } else if (b->engine == AFFS_ENGINE_THREADS) {
+        pool_run(b, reqs, count);
+    } else {
+        for (size_t i = 0; i < count; i++) run_sync(b, &reqs[i]);
+    }
+
+    affs_io_result sum = affs_io_result_ok();
+    for (size_t i = 0; i < count; i++) {
+        const affs_io_result *q = &reqs[i].result;
+        sum.bytes += q->bytes;
+        sum.attempts += q->attempts;
+        if (q->category != AFFS_IO_OK && sum.category == AFFS_IO_OK) {
+            sum.category = q->category;
+            sum.cause = q->cause;
+            sum.os_error = q->os_error;
+        }
+    }
+    sum.latency_ns = affs_io_now_ns() - t;
+    return sum;
+}
+
+void affs_backend_stats_get(const affs_backend *b, affs_backend_stats *out) {
+    affs_backend *m = (affs_backend *)b;
+    out->reads = atomic_load_explicit(&m->st_reads, memory_order_relaxed);
+    out->writes = atomic_load_explicit(&m->st_writes, memory_order_relaxed);
+    out->read_bytes = atomic_load_explicit(&m->st_read_bytes, memory_order_relaxed);
+    out->write_bytes = atomic_load_explicit(&m->st_write_bytes, memory_order_relaxed);
+    out->read_errors = atomic_load_explicit(&m->st_read_errors, memory_order_relaxed);
+    out->write_errors = atomic_load_explicit(&m->st_write_errors, memory_order_relaxed);
+    out->retries = atomic_load_explicit(&m->st_retries, memory_order_relaxed);
+    out->flushes = atomic_load_explicit(&m->st_flushes, memory_order_relaxed);
+    out->last_error_ns = atomic_load_explicit(&m->st_last_error_ns, memory_order_relaxed);
+    out->read_latency_ns = atomic_load_explicit(&m->st_read_latency_ns, memory_order_relaxed);
+    out->write_latency_ns = atomic_load_explicit(&m->st_write_latency_ns, memory_order_relaxed);
+}
+
+int affs_backend_sync_parent(const char *path) {
+    char *copy = strdup(path);
+    if (!copy) return ENOMEM;
+    int fd = open(dirname(copy), O_RDONLY | O_DIRECTORY);
+    free(copy);
+    if (fd < 0) return errno;
+    int e = fsync(fd) != 0 ? errno : 0;
+    close(fd);
+    return e;
+}
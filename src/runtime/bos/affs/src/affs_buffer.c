@@ -0,0 +1,63 @@
+#define _POSIX_C_SOURCE 200809L
+#include "../include/affs_buffer.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+int affs_buffer_pool_init(affs_buffer_pool *pool, uint32_t count, size_t size, size_t align) {
+    memset(pool, 0, sizeof(*pool));
+    if (count == 0 || align == 0 || (align & (align - 1)) != 0 || align < sizeof(void *)) return EINVAL;
+    size = (size + align - 1) & ~(align - 1);
+    if (size == 0 || size > SIZE_MAX / count) return EINVAL;
+
+    void *slab = NULL;
+    if (posix_memalign(&slab, align, size * count) != 0) return ENOMEM;
+    pool->next = (_Atomic uint32_t *)malloc(sizeof(*pool->next) * count);
+    if (!pool->next) {
+        free(slab);
+        return ENOMEM;
+    }
+    pool->slab = (uint8_t *)slab;
+    pool->size = size;
+    pool->count = count;
+    pool->align = align;
+    for (uint32_t i = 0; i < count; i++) atomic_init(&pool->next[i], i + 1 < count ? i + 2 : 0);  /* index + 1, 0 = end */
+    atomic_init(&pool->head, 1);
+    return 0;
+}
+
+void affs_buffer_pool_destroy(affs_buffer_pool *pool) {
+    if (!pool) return;
+    free(pool->slab);
+    free((void *)pool->next);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void *affs_buffer_acquire(affs_buffer_pool *pool) {
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    for (;;) {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) return NULL;
+        uint64_t tag = (head >> 32) + 1;
+        uint64_t next = (tag << 32) | atomic_load_explicit(&pool->next[top - 1], memory_order_relaxed);
+        if (atomic_compare_exchange_weak_explicit(&pool->head, &head, next, memory_order_acquire,
+                                                  memory_order_acquire)) {
+            return pool->slab + (size_t)(top - 1) * pool->size;
+        }
+    }
+}
+
+void affs_buffer_release(affs_buffer_pool *pool, void *buffer) {
+    if (!buffer) return;
+    uint32_t index = (uint32_t)(((uint8_t *)buffer - pool->slab) / pool->size);
+    uint64_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    for (;;) {
+        atomic_store_explicit(&pool->next[index], (uint32_t)head, memory_order_relaxed);
+        uint64_t tag = (head >> 32) + 1;
+        if (atomic_compare_exchange_weak_explicit(&pool->head, &head, (tag << 32) | (index + 1),
+                                                  memory_order_release, memory_order_relaxed)) {
+            return;
+        }
+    }
+}
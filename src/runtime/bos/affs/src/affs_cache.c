@@ -0,0 +1,642 @@
+#define _GNU_SOURCE
+#include "../include/affs_cache.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_CAPACITY (256u << 20)
+#define DEFAULT_BLOCK (64u << 10)
+#define DEFAULT_READAHEAD 4
+#define MAX_READAHEAD 64
+#define SMALL_PERCENT 10        /* of a shard's blocks */
+#define MAX_FREQ 3
+#define BUFFER_ALIGN 4096
+#define BYPASS_RUN (4u << 20)   /* largest read around the cache */
+#define NIL UINT32_MAX
+
+/* ---------- types ---------- */
+
+enum { Q_NONE = 0, Q_SMALL, Q_MAIN, Q_GHOST };
+
+typedef struct entry {
+    uintptr_t backend;
+    uint64_t block;
+    uint32_t hnext;             /* hash chain, or the free list */
+    uint32_t prev, next;        /* FIFO links: prev is newer */
+    uint32_t mem;               /* block memory, NIL for a ghost */
+    uint32_t valid;             /* bytes present (short at end of file) */
+    uint32_t next_in;           /* end of the last read: reading on from it is not a new access */
+    uint8_t queue;
+    uint8_t freq;
+    uint8_t loading;
+    uint8_t stale;              /* invalidated while loading: drop when done */
+    uint8_t profile;
+} entry;
+
+typedef struct fifo {
+    uint32_t head, tail;        /* newest, oldest */
+    uint32_t n;
+} fifo;
+
+typedef struct shard {
+    _Alignas(64) pthread_mutex_t lock;
+    pthread_cond_t loaded;
+    entry *e;
+    uint32_t *buckets;
+    uint32_t mask;
+    uint32_t free_entry;
+    uint8_t *mem;
+    uint32_t *free_mem;
+    uint32_t nfree_mem;
+    uint32_t blocks;
+    uint32_t small_target;
+    uint32_t ghost_target;
+    fifo small, main, ghost;
+    affs_cache_stats stats[AFFS_PROFILE_COUNT];
+} shard;
+
+struct affs_cache {
+    shard *shards;
+    unsigned nshards;
+    uint32_t block_size;
+    unsigned shift;
+    uint32_t readahead;
+};
+
+/* ---------- helpers ---------- */
+
+static inline uint64_t key_hash(uintptr_t b, uint64_t block) {
+    uint64_t h = (uint64_t)b ^ (block * 0x9E3779B97F4A7C15ull);
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline shard *shard_of(affs_cache *c, uint64_t h) {
+    return &c->shards[h & (c->nshards - 1)];
+}
+
+static inline uint8_t *block_mem(const affs_cache *c, shard *sh, uint32_t m) {
+    return sh->mem + (size_t)m * c->block_size;
+}
+
+static inline affs_cache_stats *stats_of(shard *sh, uint8_t profile) {
+    return &sh->stats[profile < AFFS_PROFILE_COUNT ? profile : AFFS_PROFILE_UNSPECIFIED];
+}
+
+static inline int bypass_profile(uint8_t profile) {
+    return profile == AFFS_PROFILE_BULK_SCAN || profile == AFFS_PROFILE_STREAMED;
+}
+
+/* ---------- FIFOs and the hash (shard locked) ---------- */
+
+static fifo *fifo_of(shard *sh, uint8_t q) {
+    return q == Q_SMALL ? &sh->small : q == Q_MAIN ? &sh->main : &sh->ghost;
+}
+
+static void fifo_push(shard *sh, uint8_t q, uint32_t i) {
+    fifo *f = fifo_of(sh, q);
+    entry *e = &sh->e[i];
+    e->queue = q;
+    e->prev = NIL;
+    e->next = f->head;
+    if (f->head != NIL) sh->e[f->head].prev = i;
+    else f->tail = i;
+    f->head = i;
+    f->n++;
+}
+
+static void fifo_remove(shard *sh, uint32_t i) {
+    entry *e = &sh->e[i];
+    fifo *f = fifo_of(sh, e->queue);
+    if (e->prev != NIL) sh->e[e->prev].next = e->next;
+    else f->head = e->next;
+    if (e->next != NIL) sh->e[e->next].prev = e->prev;
+    else f->tail = e->prev;
+    f->n--;
+    e->queue = Q_NONE;
+}
+
+static uint32_t *bucket_of(shard *sh, uintptr_t b, uint64_t block) {
+    return &sh->buckets[(key_hash(b, block) >> 20) & sh->mask];
+}
+
+static uint32_t find(shard *sh, uintptr_t b, uint64_t block) {
+    for (uint32_t i = *bucket_of(sh, b, block); i != NIL; i = sh->e[i].hnext) {
+        if (sh->e[i].backend == b && sh->e[i].block == block) return i;
+    }
+    return NIL;
+}
+
+static void hash_insert(shard *sh, uint32_t i) {
+    uint32_t *head = bucket_of(sh, sh->e[i].backend, sh->e[i].block);
+    sh->e[i].hnext = *head;
+    *head = i;
+}
+
+static void hash_remove(shard *sh, uint32_t i) {
+    uint32_t *p = bucket_of(sh, sh->e[i].backend, sh->e[i].block);
+    while (*p != i) p = &sh->e[*p].hnext;
+    *p = sh->e[i].hnext;
+}
+
+/* Unlink entry i everywhere and return it (and its memory) to the free lists. */
+static void release(shard *sh, uint32_t i) {
+    entry *e = &sh->e[i];
+    if (e->queue != Q_NONE) fifo_remove(sh, i);
+    hash_remove(sh, i);
+    if (e->mem != NIL) sh->free_mem[sh->nfree_mem++] = e->mem;
+    e->mem = NIL;
+    e->hnext = sh->free_entry;
+    sh->free_entry = i;
+}
+
+static void ghost_trim(shard *sh, uint32_t keep) {
+    while (sh->ghost.n > keep) release(sh, sh->ghost.tail);
+}
+
+/*
+ * S3-FIFO eviction: free one block of memory. The small FIFO is
+ * worked while it holds more than its share, else main. Loading
+ * blocks are skipped. Returns the freed block or NIL.
+ */
+static uint32_t evict_one(shard *sh) {
+    for (uint32_t rounds = 0; rounds < 4 * sh->blocks; rounds++) {
+        int from_small = sh->small.n > 0 && (sh->small.n > sh->small_target || sh->main.n == 0);
+        if (!from_small && sh->main.n == 0) return NIL;
+        uint32_t i = from_small ? sh->small.tail : sh->main.tail;
+        entry *e = &sh->e[i];
+        fifo_remove(sh, i);
+        if (e->loading) {
+            fifo_push(sh, from_small ? Q_SMALL : Q_MAIN, i);
+            continue;
+        }
+        if (from_small) {
+            if (e->freq > 0) {
+                e->freq = 0;
+                fifo_push(sh, Q_MAIN, i);
+                stats_of(sh, e->profile)->promotions++;
+                continue;
+            }
+            uint32_t m = e->mem;
+            e->mem = NIL;
+            stats_of(sh, e->profile)->evictions++;
+            fifo_push(sh, Q_GHOST, i);
+            ghost_trim(sh, sh->ghost_target);
+            return m;
+        }
+        if (e->freq > 0) {
+            e->freq--;
+            fifo_push(sh, Q_MAIN, i);
+            continue;
+        }
+        uint32_t m = e->mem;
+        e->mem = NIL;
+        stats_of(sh, e->profile)->evictions++;
+        release(sh, i);
+        return m;
+    }
+    return NIL;
+}
+
+static uint32_t take_mem(shard *sh) {
+    if (sh->nfree_mem) return sh->free_mem[--sh->nfree_mem];
+    return evict_one(sh);
+}
+
+static uint32_t take_entry(shard *sh) {
+    if (sh->free_entry == NIL && sh->ghost.n) release(sh, sh->ghost.tail);
+    uint32_t i = sh->free_entry;
+    if (i != NIL) sh->free_entry = sh->e[i].hnext;
+    return i;
+}
+
+/* ---------- loading ---------- */
+
+enum { CLAIM_PRESENT, CLAIM_LOADING, CLAIM_OWNED, CLAIM_FULL };
+
+/*
+ * Make `block` of `b` a loading entry owned by the caller, unless it
+ * is cached or being loaded already. Shard locked.
+ */
+static int claim(shard *sh, uintptr_t b, uint64_t block, uint8_t profile, uint32_t *out) {
+    uint32_t i = find(sh, b, block);
+    if (i != NIL && sh->e[i].queue != Q_GHOST) {
+        *out = i;
+        return sh->e[i].loading ? CLAIM_LOADING : CLAIM_PRESENT;
+    }
+    uint32_t m = take_mem(sh);
+    if (m == NIL) return CLAIM_FULL;
+    i = find(sh, b, block);         /* eviction may have trimmed the ghost */
+    if (i != NIL) {
+        fifo_remove(sh, i);         /* a ghost read again: straight to main */
+        stats_of(sh, profile)->ghost_hits++;
+        fifo_push(sh, Q_MAIN, i);
+    } else {
+        i = take_entry(sh);
+        if (i == NIL) {
+            sh->free_mem[sh->nfree_mem++] = m;
+            return CLAIM_FULL;
+        }
+        sh->e[i].backend = b;
+        sh->e[i].block = block;
+        hash_insert(sh, i);
+        fifo_push(sh, Q_SMALL, i);
+    }
+    entry *e = &sh->e[i];
+    e->mem = m;
+    e->valid = 0;
+    e->next_in = 0;
+    e->freq = 0;
+    e->loading = 1;
+    e->stale = 0;
+    e->profile = profile;
+    stats_of(sh, profile)->inserts++;
+    *out = i;
+    return CLAIM_OWNED;
+}
+
+/* Publish a loaded block (or drop it on failure) and wake its waiters. */
+static void finish(shard *sh, uint32_t i, const affs_io_result *r) {
+    entry *e = &sh->e[i];
+    e->loading = 0;
+    if (r->category != AFFS_IO_OK || r->bytes == 0 || e->stale) release(sh, i);    /* nothing past end of file */
+    else e->valid = (uint32_t)r->bytes;
+    pthread_cond_broadcast(&sh->loaded);
+}
+
+/* Copy out of a present block; 0 if it does not cover the range (a short end-of-file block). */
+static int copy_out(affs_cache *c, shard *sh, uint32_t i, uint32_t in, void *dst, uint32_t n, size_t *got, int touch) {
+    entry *e = &sh->e[i];
+    if (in + n > e->valid) return 0;
+    memcpy(dst, block_mem(c, sh, e->mem) + in, n);
+    if (touch && in < e->next_in && e->freq < MAX_FREQ) e->freq++;
+    if (touch) e->next_in = in + n;
+    *got = n;
+    return 1;
+}
+
+/* Read blocks [block, block + count) of `b` around the cache into `buf`. */
+static affs_io_result read_around(affs_cache *c, affs_backend *b, uint64_t block, uint32_t count, uint8_t *buf) {
+    return affs_backend_read(b, block << c->shift, buf, (size_t)count * c->block_size);
+}
+
+/*
+ * One block through the cache. On a miss the caller's thread reads
+ * it, plus (range scans) up to `readahead` following blocks in the
+ * same batch.
+ */
+static affs_io_result cached_block(affs_cache *c, affs_backend *b, uint64_t block, uint32_t in, uint8_t *dst, uint32_t n,
+                                   uint8_t profile, size_t *got) {
+    uintptr_t key = (uintptr_t)b;
+    shard *sh = shard_of(c, key_hash(key, block));
+    *got = 0;
+    pthread_mutex_lock(&sh->lock);
+    for (;;) {
+        uint32_t i;
+        int st = claim(sh, key, block, profile, &i);
+        if (st == CLAIM_LOADING) {
+            pthread_cond_wait(&sh->loaded, &sh->lock);
+            continue;
+        }
+        if (st == CLAIM_PRESENT) {
+            if (copy_out(c, sh, i, in, dst, n, got, 1)) {
+                stats_of(sh, profile)->hits++;
+                pthread_mutex_unlock(&sh->lock);
+                return affs_io_result_ok();
+            }
+            release(sh, i);         /* a short end-of-file block the file has outgrown */
+            continue;
+        }
+        if (st == CLAIM_FULL) {     /* everything is loading: read around */
+            pthread_mutex_unlock(&sh->lock);
+            uint8_t *tmp = NULL;
+            if (posix_memalign((void **)&tmp, BUFFER_ALIGN, c->block_size) != 0) {
+                affs_io_result r = affs_io_result_ok();
+                r.category = r.cause = AFFS_IO_TRANSIENT;
+                r.os_error = ENOMEM;
+                return r;
+            }
+            affs_io_result r = read_around(c, b, block, 1, tmp);
+            if (r.category == AFFS_IO_OK) {
+                *got = r.bytes > in ? (size_t)r.bytes - in : 0;
+                if (*got > n) *got = n;
+                memcpy(dst, tmp + in, *got);
+            }
+            free(tmp);
+            pthread_mutex_lock(&sh->lock);
+            stats_of(sh, profile)->misses++;
+            stats_of(sh, profile)->bypass_bytes += *got;
+            pthread_mutex_unlock(&sh->lock);
+            return r;
+        }
+
+        /* owned: load it, with read-ahead for range scans */
+        affs_io_request reqs[1 + MAX_READAHEAD];
+        shard *owner[1 + MAX_READAHEAD];
+        uint32_t idx[1 + MAX_READAHEAD];
+        uint32_t nreq = 1;
+        reqs[0].op = AFFS_OP_READ;
+        reqs[0].buffer = block_mem(c, sh, sh->e[i].mem);
+        reqs[0].offset = block << c->shift;
+        reqs[0].length = c->block_size;
+        owner[0] = sh;
+        idx[0] = i;
+        stats_of(sh, profile)->misses++;
+        pthread_mutex_unlock(&sh->lock);
+        uint32_t ahead = profile == AFFS_PROFILE_RANGE_SCAN ? c->readahead : 0;
+        for (uint32_t k = 1; k <= ahead; k++) {
+            shard *s2 = shard_of(c, key_hash(key, block + k));
+            uint32_t j;
+            pthread_mutex_lock(&s2->lock);
+            if (claim(s2, key, block + k, profile, &j) == CLAIM_OWNED) {
+                reqs[nreq].op = AFFS_OP_READ;
+                reqs[nreq].buffer = block_mem(c, s2, s2->e[j].mem);
+                reqs[nreq].offset = (block + k) << c->shift;
+                reqs[nreq].length = c->block_size;
+                owner[nreq] = s2;
+                idx[nreq++] = j;
+                stats_of(s2, profile)->readahead++;
+            }
+            pthread_mutex_unlock(&s2->lock);
+        }
+        affs_io_result r = nreq == 1 ? affs_backend_read(b, reqs[0].offset, reqs[0].buffer, reqs[0].length)
+                                     : affs_backend_submit(b, reqs, nreq);
+        if (nreq == 1) reqs[0].result = r;
+        for (uint32_t k = nreq; k-- > 1;) {
+            pthread_mutex_lock(&owner[k]->lock);
+            finish(owner[k], idx[k], &reqs[k].result);
+            pthread_mutex_unlock(&owner[k]->lock);
+        }
+        r = reqs[0].result;
+        pthread_mutex_lock(&sh->lock);
+        if (r.category == AFFS_IO_OK) {
+            entry *e = &sh->e[i];
+            e->valid = (uint32_t)r.bytes;
+            *got = r.bytes > in ? (size_t)r.bytes - in : 0;
+            if (*got > n) *got = n;
+            memcpy(dst, block_mem(c, sh, e->mem) + in, *got);
+            e->next_in = in + (uint32_t)*got;
+        }
+        finish(sh, i, &r);
+        pthread_mutex_unlock(&sh->lock);
+        r.bytes = *got;
+        return r;
+    }
+}
+
+/* Bulk and streamed reads: take what is cached, read the rest around the cache. */
+static affs_io_result bypass_read(affs_cache *c, affs_backend *b, uint64_t offset, uint8_t *dst, size_t length, uint8_t profile,
+                                  size_t *done) {
+    uintptr_t key = (uintptr_t)b;
+    uint8_t *bounce = NULL;
+    affs_io_result r = affs_io_result_ok();
+    *done = 0;
+    while (*done < length) {
+        uint64_t pos = offset + *done, block = pos >> c->shift;
+        uint32_t in = (uint32_t)(pos & (c->block_size - 1));
+        uint32_t n = c->block_size - in;
+        if (n > length - *done) n = (uint32_t)(length - *done);
+
+        shard *sh = shard_of(c, key_hash(key, block));
+        pthread_mutex_lock(&sh->lock);
+        uint32_t i = find(sh, key, block);
+        size_t got = 0;
+        int hit = i != NIL && sh->e[i].queue != Q_GHOST && !sh->e[i].loading && copy_out(c, sh, i, in, dst + *done, n, &got, 0);
+        if (hit) stats_of(sh, profile)->hits++;
+        pthread_mutex_unlock(&sh->lock);
+        if (hit) {
+            *done += got;
+            continue;
+        }
+
+        /* a run of uncached blocks, read in one go */
+        uint64_t want = (uint64_t)in + (length - *done);
+        uint32_t count = (uint32_t)((want + c->block_size - 1) >> c->shift), max = BYPASS_RUN >> c->shift;
+        if (count > max) count = max ? max : 1;
+        for (uint32_t k = 1; k < count; k++) {
+            shard *s2 = shard_of(c, key_hash(key, block + k));
+            pthread_mutex_lock(&s2->lock);
+            uint32_t j = find(s2, key, block + k);
+            int cached = j != NIL && s2->e[j].queue != Q_GHOST;
+            pthread_mutex_unlock(&s2->lock);
+            if (cached) {
+                count = k;
+                break;
+            }
+        }
+        size_t span = (size_t)count * c->block_size;
+        uint8_t *target = dst + *done;
+        int direct = in == 0 && ((uintptr_t)target & (BUFFER_ALIGN - 1)) == 0 && length - *done >= span;
+        if (!direct) {
+            if (!bounce && posix_memalign((void **)&bounce, BUFFER_ALIGN, BYPASS_RUN > c->block_size ? BYPASS_RUN : c->block_size) != 0) {
+                bounce = NULL;
+                r.category = r.cause = AFFS_IO_TRANSIENT;
+                r.os_error = ENOMEM;
+                break;
+            }
+            target = bounce;
+        }
+        r = read_around(c, b, block, count, target);
+        if (r.category != AFFS_IO_OK) break;
+        size_t avail = r.bytes > in ? (size_t)r.bytes - in : 0;
+        size_t take = length - *done < avail ? length - *done : avail;
+        if (!direct) memcpy(dst + *done, bounce + in, take);
+        *done += take;
+        pthread_mutex_lock(&sh->lock);
+        stats_of(sh, profile)->misses += count;
+        stats_of(sh, profile)->bypass_bytes += take;
+        pthread_mutex_unlock(&sh->lock);
+        if (r.bytes < span) break;  /* end of file */
+    }
+    free(bounce);
+    return r;
+}
+
+/* ---------- public API ---------- */
+
+static void shard_free(shard *sh) {
+    free(sh->e);
+    free(sh->buckets);
+    free(sh->mem);
+    free(sh->free_mem);
+    pthread_mutex_destroy(&sh->lock);
+    pthread_cond_destroy(&sh->loaded);
+}
+
+static int shard_init(shard *sh, uint32_t blocks, uint32_t block_size) {
+    memset(sh, 0, sizeof(*sh));
+    sh->blocks = blocks;
+    sh->small_target = blocks * SMALL_PERCENT / 100;
+    if (sh->small_target == 0) sh->small_target = 1;
+    sh->ghost_target = blocks - sh->small_target;
+    uint32_t entries = blocks + sh->ghost_target + 1;
+    uint32_t nb = 1;
+    while (nb < entries) nb *= 2;
+    sh->mask = nb - 1;
+    sh->e = (entry *)calloc(entries, sizeof(entry));
+    sh->buckets = (uint32_t *)malloc(nb * sizeof(uint32_t));
+    sh->free_mem = (uint32_t *)malloc(blocks * sizeof(uint32_t));
+    if (posix_memalign((void **)&sh->mem, BUFFER_ALIGN, (size_t)blocks * block_size) != 0) sh->mem = NULL;
+    pthread_mutex_init(&sh->lock, NULL);
+    pthread_cond_init(&sh->loaded, NULL);
+    if (!sh->e || !sh->buckets || !sh->free_mem || !sh->mem) {
+        shard_free(sh);
+        return ENOMEM;
+    }
+    memset(sh->buckets, 0xFF, nb * sizeof(uint32_t));
+    for (uint32_t i = 0; i < entries; i++) {
+        sh->e[i].hnext = i + 1 < entries ? i + 1 : NIL;
+        sh->e[i].mem = NIL;
+    }
+    sh->free_entry = 0;
+    for (uint32_t m = 0; m < blocks; m++) sh->free_mem[m] = blocks - 1 - m;
+    sh->nfree_mem = blocks;
+    sh->small.head = sh->small.tail = NIL;
+    sh->main.head = sh->main.tail = NIL;
+    sh->ghost.head = sh->ghost.tail = NIL;
+    return 0;
+}
+
+int affs_cache_create(affs_cache **out, const affs_cache_options *opt) {
+    if (!out) return EINVAL;
+    *out = NULL;
+    affs_cache_options o = opt ? *opt : affs_cache_options_default();
+    size_t capacity = o.capacity ? o.capacity : DEFAULT_CAPACITY;
+    uint32_t bs = o.block_size ? o.block_size : DEFAULT_BLOCK;
+    if ((bs & (bs - 1)) != 0 || bs < 512) return EINVAL;
+    unsigned shards = o.shards;
+    if (shards == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        shards = 4 * (unsigned)(n > 0 ? n : 1);
+        while (shards & (shards - 1)) shards &= shards - 1;
+    }
+    if ((shards & (shards - 1)) != 0) return EINVAL;
+    while (shards > 1 && capacity / bs / shards < 8) shards /= 2;   /* a few blocks per shard at least */
+    uint64_t blocks = capacity / bs / shards;
+    if (blocks < 2 || blocks > UINT32_MAX / 4) return EINVAL;
+
+    affs_cache *c = (affs_cache *)calloc(1, sizeof(affs_cache));
+    if (!c) return ENOMEM;
+    if (posix_memalign((void **)&c->shards, 64, shards * sizeof(shard)) != 0) {
+        free(c);
+        return ENOMEM;
+    }
+    c->block_size = bs;
+    while ((1u << c->shift) < bs) c->shift++;
+    c->readahead = o.readahead ? o.readahead : DEFAULT_READAHEAD;
+    if (c->readahead > MAX_READAHEAD) c->readahead = MAX_READAHEAD;
+    for (unsigned s = 0; s < shards; s++) {
+        if (shard_init(&c->shards[s], (uint32_t)blocks, bs) != 0) {
+            c->nshards = s;
+            affs_cache_destroy(c);
+            return ENOMEM;
+        }
+    }
+    c->nshards = shards;
+    *out = c;
+    return 0;
+}
+
+void affs_cache_destroy(affs_cache *c) {
+    if (!c) return;
+    for (unsigned s = 0; s < c->nshards; s++) shard_free(&c->shards[s]);
+    free(c->shards);
+    free(c);
+}
+
+affs_io_result affs_cache_read(affs_cache *c, affs_backend *b, uint64_t offset, void *dst, size_t length, uint8_t profile) {
+    affs_io_result r = affs_io_result_ok();
+    if (!c || !b || (length && !dst)) {
+        r.category = r.cause = AFFS_IO_PERMANENT;
+        r.os_error = EINVAL;
+        return r;
+    }
+    size_t done = 0;
+    if (bypass_profile(profile)) {
+        r = bypass_read(c, b, offset, (uint8_t *)dst, length, profile, &done);
+    } else {
+        while (done < length) {
+            uint64_t pos = offset + done;
+            uint32_t in = (uint32_t)(pos & (c->block_size - 1));
+            uint32_t n = c->block_size - in;
+            if (n > length - done) n = (uint32_t)(length - done);
+            size_t got;
+            r = cached_block(c, b, pos >> c->shift, in, (uint8_t *)dst + done, n, profile, &got);
+            if (r.category != AFFS_IO_OK) break;
+            done += got;
+            if (got < n) break;     /* end of file */
+        }
+    }
+    if (r.category != AFFS_IO_OK && done) {
+        r.cause = r.category;
+        r.category = AFFS_IO_PARTIAL;
+    }
+    r.bytes = done;
+    return r;
+}
+
+void affs_cache_invalidate(affs_cache *c, affs_backend *b, uint64_t offset, uint64_t length) {
+    if (!length) return;
+    uintptr_t key = (uintptr_t)b;
+    uint64_t first = offset >> c->shift, last = (offset + length - 1) >> c->shift;
+    for (uint64_t block = first; block <= last; block++) {
+        shard *sh = shard_of(c, key_hash(key, block));
+        pthread_mutex_lock(&sh->lock);
+        uint32_t i = find(sh, key, block);
+        if (i != NIL) {
+            if (sh->e[i].loading) sh->e[i].stale = 1;
+            else release(sh, i);
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+void affs_cache_drop(affs_cache *c, affs_backend *b) {
+    uintptr_t key = (uintptr_t)b;
+    for (unsigned s = 0; s < c->nshards; s++) {
+        shard *sh = &c->shards[s];
+        pthread_mutex_lock(&sh->lock);
+        uint32_t entries = sh->blocks + sh->ghost_target + 1;
+        for (uint32_t i = 0; i < entries; i++) {
+            entry *e = &sh->e[i];
+            if (e->backend != key || e->queue == Q_NONE) continue;
+            if (e->loading) e->stale = 1;
+            else release(sh, i);
+        }
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+void affs_cache_stats_get(affs_cache *c, uint8_t profile, affs_cache_stats *out) {
+    memset(out, 0, sizeof(*out));
+    if (profile >= AFFS_PROFILE_COUNT) return;
+    for (unsigned s = 0; s < c->nshards; s++) {
+        shard *sh = &c->shards[s];
+        pthread_mutex_lock(&sh->lock);
+        const affs_cache_stats *x = &sh->stats[profile];
+        out->hits += x->hits;
+        out->misses += x->misses;
+        out->inserts += x->inserts;
+        out->evictions += x->evictions;
+        out->promotions += x->promotions;
+        out->ghost_hits += x->ghost_hits;
+        out->readahead += x->readahead;
+        out->bypass_bytes += x->bypass_bytes;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
+
+size_t affs_cache_resident(affs_cache *c) {
+    size_t blocks = 0;
+    for (unsigned s = 0; s < c->nshards; s++) {
+        pthread_mutex_lock(&c->shards[s].lock);
+        blocks += c->shards[s].blocks - c->shards[s].nfree_mem;
+        pthread_mutex_unlock(&c->shards[s].lock);
+    }
+    return blocks * c->block_size;
+}
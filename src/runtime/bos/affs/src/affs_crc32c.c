@@ -0,0 +1,213 @@
+#include "../include/affs_crc32c.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AFFS_CRC_X86 1
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#define POLY 0x82F63B78u
+
+/* Block sizes of the three interleaved streams (bytes per stream). */
+#define LONG_BLOCK 8192
+#define SHORT_BLOCK 256
+
+/* ---------- GF(2) arithmetic (reflected, bit 31 = x^0) ---------- */
+
+static uint32_t multmodp(uint32_t a, uint32_t b) {
+    uint32_t m = 1u << 31, p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+static uint32_t g_x2n[32];     /* x^(2^k) mod P */
+
+/* x^(n * 2^k) mod P */
+static uint32_t x2nmodp(uint64_t n, unsigned k) {
+    uint32_t p = 1u << 31;
+    while (n) {
+        if (n & 1) p = multmodp(g_x2n[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+/* ---------- slicing-by-8 ---------- */
+
+static uint32_t g_table[8][256];
+
+static uint32_t sw_crc(uint32_t c, const uint8_t *p, size_t len) {
+    while (len && ((uintptr_t)p & 7)) {
+        c = (c >> 8) ^ g_table[0][(c ^ *p++) & 0xFF];
+        len--;
+    }
+    while (len >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        w = __builtin_bswap64(w);
+#endif
+        w ^= c;
+        c = g_table[7][w & 0xFF] ^ g_table[6][(w >> 8) & 0xFF] ^ g_table[5][(w >> 16) & 0xFF] ^
+            g_table[4][(w >> 24) & 0xFF] ^ g_table[3][(w >> 32) & 0xFF] ^ g_table[2][(w >> 40) & 0xFF] ^
+            g_table[1][(w >> 48) & 0xFF] ^ g_table[0][w >> 56];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) c = (c >> 8) ^ g_table[0][(c ^ *p++) & 0xFF];
+    return c;
+}
+
+/* ---------- SSE4.2 crc32, three streams ---------- */
+
+#ifdef AFFS_CRC_X86
+
+/*
+ * The three streams of a block are independent CRCs (the crc32
+ * instruction has latency 3 and throughput 1); they are merged by
+ * shifting the first two over the bytes that follow them:
+ * c * x^(8n) mod P. With PCLMULQDQ that is one carry-less multiply
+ * by x^(8n-33) and one crc32 reduction; without it, multmodp().
+ */
+static uint32_t g_k_long[2], g_k_short[2];    /* clmul constants: shift by 1 and 2 blocks */
+static uint32_t g_x_long[2], g_x_short[2];    /* plain x^(8n) for multmodp */
+
+__attribute__((target("sse4.2,pclmul"))) static uint32_t shift_clmul(uint32_t c, uint32_t k) {
+    __m128i r = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)c), _mm_cvtsi32_si128((int)k), 0);
+    return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(r));
+}
+
+__attribute__((target("sse4.2"))) static inline uint64_t load64(const uint8_t *p) {
+    uint64_t w;
+    memcpy(&w, p, 8);
+    return w;
+}
+
+#define HW_BODY(SHIFT)                                                                                   \
+    uint64_t c = crc;                                                                                    \
+    while (len && ((uintptr_t)p & 7)) {                                                                  \
+        c = _mm_crc32_u8((uint32_t)c, *p++);                                                             \
+        len--;                                                                                           \
+    }                                                                                                    \
+    while (len >= 3 * LONG_BLOCK) {                                                                      \
+        uint64_t c1 = 0, c2 = 0;                                                                         \
+        const uint8_t *end = p + LONG_BLOCK;                                                             \
+        do {                                                                                             \
+            c = _mm_crc32_u64(c, load64(p));                                                             \
+            c1 = _mm_crc32_u64(c1, load64(p + LONG_BLOCK));                                              \
+            c2 = _mm_crc32_u64(c2, load64(p + 2 * LONG_BLOCK));                                          \
+            p += 8;                                                                                      \
+        } while (p < end);                                                                               \
+        c = SHIFT((uint32_t)c, long, 1) ^ SHIFT((uint32_t)c1, long, 0) ^ c2;                             \
+        p += 2 * LONG_BLOCK;                                                                             \
+        len -= 3 * LONG_BLOCK;                                                                           \
+    }                                                                                                    \
+    while (len >= 3 * SHORT_BLOCK) {                                                                     \
+        uint64_t c1 = 0, c2 = 0;                                                                         \
+        const uint8_t *end = p + SHORT_BLOCK;                                                            \
+        do {                                                                                             \
+            c = _mm_crc32_u64(c, load64(p));                                                             \
+            c1 = _mm_crc32_u64(c1, load64(p + SHORT_BLOCK));                                             \
+            c2 = _mm_crc32_u64(c2, load64(p + 2 * SHORT_BLOCK));                                         \
+            p += 8;                                                                                      \
+        } while (p < end);                                                                               \
+        c = SHIFT((uint32_t)c, short, 1) ^ SHIFT((uint32_t)c1, short, 0) ^ c2;                           \
+        p += 2 * SHORT_BLOCK;                                                                            \
+        len -= 3 * SHORT_BLOCK;                                                                          \
+    }                                                                                                    \
+    while (len >= 8) {                                                                                   \
+        c = _mm_crc32_u64(c, load64(p));                                                                 \
+        p += 8;                                                                                          \
+        len -= 8;                                                                                        \
+    }                                                                                                    \
+    while (len--) c = _mm_crc32_u8((uint32_t)c, *p++);                                                   \
+    return (uint32_t)c;
+
+#define SHIFT_CLMUL(c, size, two) shift_clmul((c), g_k_##size[two])
+#define SHIFT_SOFT(c, size, two) multmodp(g_x_##size[two], (c))
+
+__attribute__((target("sse4.2,pclmul"))) static uint32_t hw_crc_clmul(uint32_t crc, const uint8_t *p, size_t len) {
+    HW_BODY(SHIFT_CLMUL)
+}
+
+__attribute__((target("sse4.2"))) static uint32_t hw_crc(uint32_t crc, const uint8_t *p, size_t len) {
+    HW_BODY(SHIFT_SOFT)
+}
+
+#endif
+
+/* ---------- dispatch ---------- */
+
+static uint32_t (*g_impl)(uint32_t, const uint8_t *, size_t) = sw_crc;
+static const char *g_impl_name = "slicing-by-8";
+
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (POLY & (0u - (c & 1)));
+        g_table[0][i] = c;
+    }
+    for (int t = 1; t < 8; t++) {
+        for (int i = 0; i < 256; i++) g_table[t][i] = (g_table[t - 1][i] >> 8) ^ g_table[0][g_table[t - 1][i] & 0xFF];
+    }
+    uint32_t p = 1u << 30;     /* x^1 */
+    for (int k = 0; k < 32; k++) {
+        g_x2n[k] = p;
+        p = multmodp(p, p);
+    }
+
+#ifdef AFFS_CRC_X86
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse4.2")) return;
+    for (int two = 0; two < 2; two++) {
+        uint64_t lb = (uint64_t)LONG_BLOCK * (two + 1), sb = (uint64_t)SHORT_BLOCK * (two + 1);
+        g_x_long[two] = x2nmodp(8 * lb, 0);
+        g_x_short[two] = x2nmodp(8 * sb, 0);
+        /* clmul yields x*A*B, the crc32 reduction multiplies by x^32: pre-divide by x^33 */
+        g_k_long[two] = x2nmodp(8 * lb - 33, 0);
+        g_k_short[two] = x2nmodp(8 * sb - 33, 0);
+    }
+    if (__builtin_cpu_supports("pclmul")) {
+        g_impl = hw_crc_clmul;
+        g_impl_name = "sse4.2 x3 + pclmul";
+    } else {
+        g_impl = hw_crc;
+        g_impl_name = "sse4.2 x3";
+    }
+#endif
+}
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+/* ---------- public API ---------- */
+
+uint32_t affs_crc32c(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&g_once, crc_init);
+    return ~g_impl(~crc, (const uint8_t *)data, len);
+}
+
+uint32_t affs_crc32c_sw(uint32_t crc, const void *data, size_t len) {
+    pthread_once(&g_once, crc_init);
+    return ~sw_crc(~crc, (const uint8_t *)data, len);
+}
+
+uint32_t affs_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2) {
+    pthread_once(&g_once, crc_init);
+    return multmodp(x2nmodp(len2, 3), crc1) ^ crc2;
+}
+
+const char *affs_crc32c_impl(void) {
+    pthread_once(&g_once, crc_init);
+    return g_impl_name;
+}
@@ -0,0 +1,404 @@
+#define _GNU_SOURCE
+#include "../include/affs_erasure.h"
+#include "../include/affs_record.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AFFS_EC_X86 1
+#include <immintrin.h>
+#endif
+
+#define POLY 0x11D
+#define CHUNK 8192
+
+/* ---------- GF(2^8) ---------- */
+
+static uint8_t g_exp[512];
+static uint8_t g_log[256];
+
+static inline uint8_t gf_mul(uint8_t a, uint8_t b) {
+    return a && b ? g_exp[g_log[a] + g_log[b]] : 0;
+}
+
+static inline uint8_t gf_inv(uint8_t a) {
+    return g_exp[255 - g_log[a]];
+}
+
+/* Multiplication by one constant, in the form of every kernel. */
+typedef struct coef {
+    uint8_t lo[16];             /* c * x for x < 16 */
+    uint8_t hi[16];             /* c * (x << 4) */
+    uint64_t affine;            /* GF2P8AFFINEQB matrix: byte 7 - i selects the bits feeding output bit i */
+} coef;
+
+static void coef_init(coef *t, uint8_t c) {
+    for (int x = 0; x < 16; x++) {
+        t->lo[x] = gf_mul(c, (uint8_t)x);
+        t->hi[x] = gf_mul(c, (uint8_t)(x << 4));
+    }
+    t->affine = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t row = 0;
+        for (int j = 0; j < 8; j++) row |= (uint8_t)(((gf_mul(c, (uint8_t)(1u << j)) >> i) & 1) << j);
+        t->affine |= (uint64_t)row << (8 * (7 - i));
+    }
+}
+
+/*
+ * Gauss-Jordan inverse of the n x n matrix a (destroyed) into inv;
+ * 0 if singular, which a Cauchy generator never is.
+ */
+static int gf_invert(uint8_t *a, uint8_t *inv, unsigned n) {
+    memset(inv, 0, (size_t)n * n);
+    for (unsigned i = 0; i < n; i++) inv[i * n + i] = 1;
+    for (unsigned c = 0; c < n; c++) {
+        unsigned p = c;
+        while (p < n && a[p * n + c] == 0) p++;
+        if (p == n) return 0;
+        if (p != c) {
+            for (unsigned j = 0; j < n; j++) {
+                uint8_t t = a[c * n + j];
+                a[c * n + j] = a[p * n + j];
+                a[p * n + j] = t;
+                t = inv[c * n + j];
+                inv[c * n + j] = inv[p * n + j];
+                inv[p * n + j] = t;
+            }
+        }
+        uint8_t s = gf_inv(a[c * n + c]);
+        for (unsigned j = 0; j < n; j++) {
+            a[c * n + j] = gf_mul(a[c * n + j], s);
+            inv[c * n + j] = gf_mul(inv[c * n + j], s);
+        }
+        for (unsigned r = 0; r < n; r++) {
+            uint8_t f = a[r * n + c];
+            if (r == c || f == 0) continue;
+            for (unsigned j = 0; j < n; j++) {
+                a[r * n + j] ^= gf_mul(f, a[c * n + j]);
+                inv[r * n + j] ^= gf_mul(f, inv[c * n + j]);
+            }
+        }
+    }
+    return 1;
+}
+
+/*
+ * ---------- kernels ----------
+ * dst[r][off..off+len) = sum over s of rows[r * n + s] * src[s][off..off+len)
+ * for r < nd <= GROUP: every input vector is loaded once for up to four
+ * outputs, each kept in its own accumulator.
+ */
+
+#define GROUP 4
+
+typedef void (*dot_fn)(uint8_t *const *dst, size_t nd, const uint8_t *const *src, const coef *rows, size_t n, size_t off,
+                       size_t len);
+
+static void dot_portable(uint8_t *const *dst, size_t nd, const uint8_t *const *src, const coef *rows, size_t n, size_t off,
+                         size_t len) {
+    for (size_t r = 0; r < nd; r++) {
+        const coef *row = rows + r * n;
+        uint8_t *out = dst[r] + off;
+        memset(out, 0, len);
+        for (size_t s = 0; s < n; s++) {
+            const uint8_t *in = src[s] + off;
+            for (size_t i = 0; i < len; i++) out[i] ^= (uint8_t)(row[s].lo[in[i] & 15] ^ row[s].hi[in[i] >> 4]);
+        }
+    }
+}
+
+#ifdef AFFS_EC_X86
+/* Split tables: the low and high nibble each index a 16-entry product table. */
+#define SPLIT_BODY(W, vec, load, store, bcast, set1, and_, xor_, srli, shuffle, zero)                      \
+    const vec nib = set1(0x0F);                                                                            \
+    size_t i = off, end = off + len;                                                                       \
+    for (; i + W <= end; i += W) {                                                                         \
+        vec acc[GROUP];                                                                                    \
+        for (size_t r = 0; r < ND; r++) acc[r] = zero();                                                   \
+        for (size_t s = 0; s < n; s++) {                                                                   \
+            vec v = load((const vec *)(const void *)(src[s] + i));                                         \
+            vec vl = and_(v, nib), vh = and_(srli(v, 4), nib);                                             \
+            for (size_t r = 0; r < ND; r++) {                                                              \
+                const coef *c = &rows[r * n + s];                                                          \
+                acc[r] = xor_(acc[r], xor_(shuffle(bcast(c->lo), vl), shuffle(bcast(c->hi), vh)));         \
+            }                                                                                              \
+        }                                                                                                  \
+        for (size_t r = 0; r < ND; r++) store((vec *)(void *)(dst[r] + i), acc[r]);                        \
+    }                                                                                                      \
+    if (i < end) dot_portable(dst, ND, src, rows, n, i, end - i);
+
+#define LOAD128(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define BCAST256(p) _mm256_broadcastsi128_si256(LOAD128(p))
+
+__attribute__((target("ssse3"), always_inline)) static inline void ssse3_n(uint8_t *const *dst, const size_t ND,
+                                                                           const uint8_t *const *src, const coef *rows,
+                                                                           size_t n, size_t off, size_t len) {
+    SPLIT_BODY(16, __m128i, _mm_loadu_si128, _mm_storeu_si128, LOAD128, _mm_set1_epi8, _mm_and_si128, _mm_xor_si128,
+               _mm_srli_epi64, _mm_shuffle_epi8, _mm_setzero_si128)
+}
+
+__attribute__((target("avx2"), always_inline)) static inline void avx2_n(uint8_t *const *dst, const size_t ND,
+                                                                         const uint8_t *const *src, const coef *rows,
+                                                                         size_t n, size_t off, size_t len) {
+    SPLIT_BODY(32, __m256i, _mm256_loadu_si256, _mm256_storeu_si256, BCAST256, _mm256_set1_epi8, _mm256_and_si256,
+               _mm256_xor_si256, _mm256_srli_epi64, _mm256_shuffle_epi8, _mm256_setzero_si256)
+}
+
+/* One affine transform per product: the constant as an 8 x 8 bit matrix. */
+__attribute__((target("gfni,avx2"), always_inline)) static inline void gfni_n(uint8_t *const *dst, const size_t ND,
+                                                                              const uint8_t *const *src, const coef *rows,
+                                                                              size_t n, size_t off, size_t len) {
+    size_t i = off, end = off + len;
+    for (; i + 32 <= end; i += 32) {
+        __m256i acc[GROUP];
+        for (size_t r = 0; r < ND; r++) acc[r] = _mm256_setzero_si256();
+        for (size_t s = 0; s < n; s++) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)(src[s] + i));
+            for (size_t r = 0; r < ND; r++) {
+                __m256i a = _mm256_set1_epi64x((long long)rows[r * n + s].affine);
+                acc[r] = _mm256_xor_si256(acc[r], _mm256_gf2p8affine_epi64_epi8(v, a, 0));
+            }
+        }
+        for (size_t r = 0; r < ND; r++) _mm256_storeu_si256((__m256i *)(void *)(dst[r] + i), acc[r]);
+    }
+    if (i < end) dot_portable(dst, ND, src, rows, n, i, end - i);
+}
+
+/* A constant group size, so each width gets its accumulators in registers. */
+#define DISPATCH(name, body, isa)                                                                                  \
+    __attribute__((target(isa))) static void name   (uint8_t *const *dst, size_t nd, const uint8_t *const *src,    \
+                                                     const coef *rows, size_t n, size_t off, size_t len) {         \
+        switch (nd) {                                                                                              \
+        case 1: body(dst, 1, src, rows, n, off, len); break;                                                       \
+        case 2: body(dst, 2, src, rows, n, off, len); break;                                                       \
+        case 3: body(dst, 3, src, rows, n, off, len); break;                                                       \
+        default: body(dst, 4, src, rows, n, off, len); break;                                                      \
+        }                                                                                                          \
+    }
+
+DISPATCH(dot_ssse3, ssse3_n, "ssse3")
+DISPATCH(dot_avx2, avx2_n, "avx2")
+DISPATCH(dot_gfni, gfni_n, "gfni,avx2")
+#endif
+
+typedef struct kernel {
+    const char *name;
+    dot_fn fn;
+    int (*usable)(void);
+} kernel;
+
+static int always(void) {
+    return 1;
+}
+
+#ifdef AFFS_EC_X86
+static int has_ssse3(void) {
+    return __builtin_cpu_supports("ssse3");
+}
+
+static int has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+static int has_gfni(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("gfni");
+}
+#endif
+
+/* Best first. */
+static const kernel g_kernels[] = {
+#ifdef AFFS_EC_X86
+    { "gfni", dot_gfni, has_gfni },
+    { "avx2", dot_avx2, has_avx2 },
+    { "ssse3", dot_ssse3, has_ssse3 },
+#endif
+    { "portable", dot_portable, always },
+};
+
+static const kernel *g_kernel = &g_kernels[sizeof(g_kernels) / sizeof(g_kernels[0]) - 1];
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void ec_init(void) {
+    unsigned x = 1;
+    for (int i = 0; i < 255; i++) {
+        g_exp[i] = (uint8_t)x;
+        g_log[x] = (uint8_t)i;
+        x <<= 1;
+        if (x & 0x100) x ^= POLY;
+    }
+    for (int i = 255; i < 512; i++) g_exp[i] = g_exp[i - 255];
+#ifdef AFFS_EC_X86
+    __builtin_cpu_init();
+#endif
+    for (size_t i = 0; i < sizeof(g_kernels) / sizeof(g_kernels[0]); i++) {
+        if (g_kernels[i].usable()) {
+            g_kernel = &g_kernels[i];
+            break;
+        }
+    }
+}
+
+/* Column chunks, outputs four at a time: the inputs of a chunk stay in cache across the groups. */
+static void dot_rows(uint8_t *const *dst, size_t ndst, const uint8_t *const *src, size_t nsrc, const coef *rows, size_t len) {
+    dot_fn f = g_kernel->fn;
+    for (size_t off = 0; off < len; off += CHUNK) {
+        size_t n = len - off < CHUNK ? len - off : CHUNK;
+        for (size_t r = 0; r < ndst; r += GROUP) {
+            size_t g = ndst - r < GROUP ? ndst - r : GROUP;
+            f(dst + r, g, src, rows + r * nsrc, nsrc, off, n);
+        }
+    }
+}
+
+/* ---------- code ---------- */
+
+struct affs_ec {
+    unsigned k, m;
+    uint8_t *parity;            /* m x k Cauchy rows: 1 / ((k + i) ^ j) */
+    coef *enc;                  /* the same, as kernel tables */
+};
+
+int affs_ec_create(affs_ec **out, unsigned k, unsigned m) {
+    pthread_once(&g_once, ec_init);
+    if (k == 0 || m == 0 || k + m > AFFS_EC_MAX_SHARDS) return EINVAL;
+    affs_ec *ec = (affs_ec *)calloc(1, sizeof(affs_ec));
+    if (!ec) return ENOMEM;
+    ec->k = k;
+    ec->m = m;
+    ec->parity = (uint8_t *)malloc((size_t)m * k);
+    ec->enc = (coef *)malloc((size_t)m * k * sizeof(coef));
+    if (!ec->parity || !ec->enc) {
+        affs_ec_destroy(ec);
+        return ENOMEM;
+    }
+    for (unsigned i = 0; i < m; i++) {
+        for (unsigned j = 0; j < k; j++) {
+            ec->parity[i * k + j] = gf_inv((uint8_t)((k + i) ^ j));
+            coef_init(&ec->enc[i * k + j], ec->parity[i * k + j]);
+        }
+    }
+    *out = ec;
+    return 0;
+}
+
+void affs_ec_destroy(affs_ec *ec) {
+    if (!ec) return;
+    free(ec->parity);
+    free(ec->enc);
+    free(ec);
+}
+
+void affs_ec_encode(const affs_ec *ec, const uint8_t *const *data, uint8_t *const *parity, size_t len) {
+    dot_rows(parity, ec->m, data, ec->k, ec->enc, len);
+}
+
+int affs_ec_reconstruct(const affs_ec *ec, uint8_t *const *shards, const uint8_t *present, size_t len) {
+    unsigned k = ec->k, n = ec->k + ec->m;
+    unsigned chosen[AFFS_EC_MAX_SHARDS], lost_data[AFFS_EC_MAX_SHARDS], lost_parity[AFFS_EC_MAX_SHARDS];
+    unsigned nc = 0, nd = 0, np = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (present[i]) {
+            if (nc < k) chosen[nc++] = i;
+        } else if (i < k) {
+            lost_data[nd++] = i;
+        } else {
+            lost_parity[np++] = i - k;
+        }
+    }
+    if (nc < k) return EINVAL;
+
+    const uint8_t *src[AFFS_EC_MAX_SHARDS];
+    uint8_t *dst[AFFS_EC_MAX_SHARDS];
+    if (nd) {
+        /* the generator rows of k present shards, inverted: row j rebuilds data shard j */
+        uint8_t *a = (uint8_t *)malloc((size_t)k * k * 2);
+        coef *rows = (coef *)malloc((size_t)nd * k * sizeof(coef));
+        if (!a || !rows) {
+            free(a);
+            free(rows);
+            return ENOMEM;
+        }
+        uint8_t *inv = a + (size_t)k * k;
+        for (unsigned r = 0; r < k; r++) {
+            if (chosen[r] < k) {
+                memset(a + (size_t)r * k, 0, k);
+                a[(size_t)r * k + chosen[r]] = 1;
+            } else {
+                memcpy(a + (size_t)r * k, ec->parity + (size_t)(chosen[r] - k) * k, k);
+            }
+            src[r] = shards[chosen[r]];
+        }
+        gf_invert(a, inv, k);
+        for (unsigned t = 0; t < nd; t++) {
+            for (unsigned c = 0; c < k; c++) coef_init(&rows[t * k + c], inv[(size_t)lost_data[t] * k + c]);
+            dst[t] = shards[lost_data[t]];
+        }
+        dot_rows(dst, nd, src, k, rows, len);
+        free(a);
+        free(rows);
+    }
+    if (np) {
+        coef *rows = (coef *)malloc((size_t)np * k * sizeof(coef));
+        if (!rows) return ENOMEM;
+        for (unsigned t = 0; t < np; t++) {
+            memcpy(rows + (size_t)t * k, ec->enc + (size_t)lost_parity[t] * k, k * sizeof(coef));
+            dst[t] = shards[k + lost_parity[t]];
+        }
+        for (unsigned j = 0; j < k; j++) src[j] = shards[j];
+        dot_rows(dst, np, src, k, rows, len);
+        free(rows);
+    }
+    return 0;
+}
+
+const char *affs_ec_impl(void) {
+    pthread_once(&g_once, ec_init);
+    return g_kernel->name;
+}
+
+int affs_ec_set_impl(const char *name) {
+    pthread_once(&g_once, ec_init);
+    for (size_t i = 0; i < sizeof(g_kernels) / sizeof(g_kernels[0]); i++) {
+        if (strcmp(g_kernels[i].name, name) != 0) continue;
+        if (!g_kernels[i].usable()) return ENOTSUP;
+        g_kernel = &g_kernels[i];
+        return 0;
+    }
+    return EINVAL;
+}
+
+/* ---------- verification ---------- */
+
+static uint64_t nonzero_overlap(const uint8_t *p, uint64_t a, uint64_t b, uint64_t from, uint64_t to) {
+    uint64_t lo = a > from ? a : from, hi = b < to ? b : to;
+    if (lo >= hi) return 0;
+    for (uint64_t i = lo; i < hi; i++) {
+        if (p[i]) return hi - lo;
+    }
+    return 0;
+}
+
+void affs_ec_verify(const uint8_t *p, size_t len, uint32_t align, uint64_t from, uint64_t to, affs_ec_verify_result *out) {
+    memset(out, 0, sizeof(*out));
+    uint64_t step = align ? align : 1;
+    if (to > len) to = len;
+    uint64_t pos = 0;
+    while (pos < to) {
+        affs_record_header h;
+        uint64_t framed = 0;
+        affs_record_status st = affs_record_check(p + pos, len - pos, align, &h, &framed);
+        if (st == AFFS_RECORD_OK) {
+            if (pos + framed > from) out->records++;
+            pos += framed;
+            continue;
+        }
+        if (st == AFFS_RECORD_BAD_CHECKSUM && pos + framed > from) out->bad++;
+        uint64_t next = pos + step < len ? pos + step : len;
+        out->unverified += nonzero_overlap(p, pos, next, from, to);
+        pos = next;
+    }
+}
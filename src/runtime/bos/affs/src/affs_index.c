@@ -0,0 +1,563 @@
+#define _GNU_SOURCE
+#include "../include/affs_index.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define GROUP 16
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+#define MIN_GROUPS 1
+#define MIGRATE_STEP 8          /* groups moved per write while resizing */
+#define BATCH 16
+#define STRIPES 64              /* reader counters per epoch parity */
+#define HUGE_BYTES (2u << 20)
+
+/* ---------- types ---------- */
+
+/* Control bytes of one group and its seqlock; two per cache line. */
+typedef struct group_meta {
+    _Atomic uint64_t ctrl[2];
+    _Atomic uint32_t seq;       /* odd while the writer changes the group */
+    uint32_t pad[3];
+} group_meta;
+
+/* lo, hi, offset, length, segment | flags << 32 */
+typedef struct slot {
+    _Atomic uint64_t w[5];
+} slot;
+
+typedef struct table {
+    group_meta *meta;
+    slot *slots;
+    size_t groups;              /* power of two */
+    size_t mask;
+    size_t used;                /* full slots (writer only) */
+    size_t deleted;
+    _Atomic size_t migrated;    /* groups below it have moved to the next table */
+} table;
+
+/* What readers see: immutable once published. */
+typedef struct view {
+    table *cur;
+    table *old;                 /* being emptied into cur, or NULL */
+} view;
+
+typedef struct reader_count {
+    _Atomic uint64_t n;
+    char pad[56];
+} reader_count;
+
+struct affs_index {
+    reader_count readers[2][STRIPES];
+    _Atomic(view *) view;
+    _Atomic uint64_t epoch;
+    _Atomic size_t count;
+    uint64_t resizes;
+};
+
+static _Atomic unsigned g_next_stripe;
+static _Thread_local unsigned t_stripe = UINT_MAX;
+
+/* ---------- helpers ---------- */
+
+static inline uint64_t hash_id(affs_object_id id) {
+    uint64_t h = id.lo + id.hi * 0xC2B2AE3D27D4EB4Full;     /* a sum: structured ids must not cancel out */
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+/* Bit i set where control byte i equals b. */
+static inline unsigned match_byte(uint64_t c0, uint64_t c1, uint8_t b) {
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_set_epi64x((long long)c1, (long long)c0);
+    return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)b)));
+#else
+    unsigned m = 0;
+    for (int i = 0; i < 8; i++) {
+        if ((uint8_t)(c0 >> (8 * i)) == b) m |= 1u << i;
+        if ((uint8_t)(c1 >> (8 * i)) == b) m |= 1u << (i + 8);
+    }
+    return m;
+#endif
+}
+
+/* Bit i set where control byte i is empty or deleted (high bit). */
+static inline unsigned match_free(uint64_t c0, uint64_t c1) {
+#if defined(__SSE2__)
+    return (unsigned)_mm_movemask_epi8(_mm_set_epi64x((long long)c1, (long long)c0));
+#else
+    unsigned m = 0;
+    for (int i = 0; i < 8; i++) {
+        if ((c0 >> (8 * i + 7)) & 1) m |= 1u << i;
+        if ((c1 >> (8 * i + 7)) & 1) m |= 1u << (i + 8);
+    }
+    return m;
+#endif
+}
+
+static inline void cpu_relax(void) {
+#if defined(__SSE2__)
+    _mm_pause();
+#endif
+}
+
+static inline void prefetch(const void *p) {
+    __builtin_prefetch(p, 0, 3);
+}
+
+/* ---------- tables ---------- */
+
+/*
+ * Large arrays go on 2 MiB boundaries and ask for huge pages: random
+ * probes into a big table otherwise pay a TLB miss on top of each
+ * cache miss.
+ */
+static void *table_alloc(size_t bytes) {
+    void *p = NULL;
+    if (bytes < HUGE_BYTES) return posix_memalign(&p, 64, bytes) == 0 ? p : NULL;
+    if (posix_memalign(&p, HUGE_BYTES, bytes) != 0) return NULL;
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+static table *table_new(size_t groups) {
+    table *t = (table *)calloc(1, sizeof(table));
+    if (!t) return NULL;
+    void *m = table_alloc(groups * sizeof(group_meta));
+    void *s = table_alloc(groups * GROUP * sizeof(slot));
+    if (!m || !s) {
+        free(m);
+        free(s);
+        free(t);
+        return NULL;
+    }
+    t->meta = (group_meta *)m;
+    t->slots = (slot *)s;
+    t->groups = groups;
+    t->mask = groups - 1;
+    for (size_t g = 0; g < groups; g++) {
+        atomic_init(&t->meta[g].ctrl[0], 0x8080808080808080ull);
+        atomic_init(&t->meta[g].ctrl[1], 0x8080808080808080ull);
+        atomic_init(&t->meta[g].seq, 0);
+    }
+    return t;
+}
+
+static void table_free(table *t) {
+    if (!t) return;
+    free(t->meta);
+    free(t->slots);
+    free(t);
+}
+
+static size_t groups_for(size_t entries) {
+    size_t g = MIN_GROUPS;
+    while (g * GROUP * 7 / 8 < entries) g *= 2;
+    return g;
+}
+
+static inline void load_ctrl(const group_meta *m, uint64_t *c0, uint64_t *c1) {
+    *c0 = atomic_load_explicit(&m->ctrl[0], memory_order_relaxed);
+    *c1 = atomic_load_explicit(&m->ctrl[1], memory_order_relaxed);
+}
+
+static inline int slot_is(const slot *s, affs_object_id id) {
+    return atomic_load_explicit(&s->w[0], memory_order_relaxed) == id.lo &&
+           atomic_load_explicit(&s->w[1], memory_order_relaxed) == id.hi;
+}
+
+static inline void slot_read(const slot *s, affs_location *loc) {
+    uint64_t w4 = atomic_load_explicit(&s->w[4], memory_order_relaxed);
+    loc->offset = atomic_load_explicit(&s->w[2], memory_order_relaxed);
+    loc->length = atomic_load_explicit(&s->w[3], memory_order_relaxed);
+    loc->segment_id = (uint32_t)w4;
+    loc->flags = (uint32_t)(w4 >> 32);
+}
+
+/* Reader lookup in one table: per-group seqlock, retry on change. */
+static int table_get(const table *t, affs_object_id id, uint64_t h, affs_location *loc) {
+    uint8_t h2 = (uint8_t)(h & 0x7F);
+    size_t g = (size_t)(h >> 7) & t->mask;
+    for (size_t step = 1; step <= t->groups; step++) {
+        const group_meta *m = &t->meta[g];
+        for (;;) {
+            uint32_t s1 = atomic_load_explicit(&m->seq, memory_order_acquire);
+            if (s1 & 1) {
+                cpu_relax();
+                continue;
+            }
+            uint64_t c0, c1;
+            load_ctrl(m, &c0, &c1);
+            unsigned match = match_byte(c0, c1, h2);
+            int found = 0;
+            while (match) {
+                const slot *s = &t->slots[g * GROUP + (size_t)__builtin_ctz(match)];
+                if (slot_is(s, id)) {
+                    slot_read(s, loc);
+                    found = 1;
+                    break;
+                }
+                match &= match - 1;
+            }
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&m->seq, memory_order_relaxed) != s1) continue;
+            /* a moved group is the next table's business */
+            if (found) return g >= atomic_load_explicit(&t->migrated, memory_order_acquire);
+            if (match_byte(c0, c1, CTRL_EMPTY)) return 0;
+            break;
+        }
+        g = (g + step) & t->mask;
+    }
+    return 0;
+}
+
+/* Writer lookup: position of `id` (moved groups excluded), or SIZE_MAX. */
+static size_t table_find(const table *t, affs_object_id id, uint64_t h) {
+    uint8_t h2 = (uint8_t)(h & 0x7F);
+    size_t g = (size_t)(h >> 7) & t->mask;
+    for (size_t step = 1; step <= t->groups; step++) {
+        uint64_t c0, c1;
+        load_ctrl(&t->meta[g], &c0, &c1);
+        for (unsigned match = match_byte(c0, c1, h2); match; match &= match - 1) {
+            size_t i = g * GROUP + (size_t)__builtin_ctz(match);
+            if (slot_is(&t->slots[i], id)) return g >= atomic_load_explicit(&t->migrated, memory_order_relaxed) ? i : SIZE_MAX;
+        }
+        if (match_byte(c0, c1, CTRL_EMPTY)) return SIZE_MAX;
+        g = (g + step) & t->mask;
+    }
+    return SIZE_MAX;
+}
+
+static inline void write_begin(group_meta *m) {
+    uint32_t s = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static inline void write_end(group_meta *m) {
+    uint32_t s = atomic_load_explicit(&m->seq, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, s + 1, memory_order_release);
+}
+
+static inline void set_ctrl(group_meta *m, unsigned i, uint8_t v) {
+    _Atomic uint64_t *w = &m->ctrl[i / 8];
+    unsigned sh = (i % 8) * 8;
+    uint64_t x = atomic_load_explicit(w, memory_order_relaxed);
+    atomic_store_explicit(w, (x & ~(0xFFull << sh)) | ((uint64_t)v << sh), memory_order_relaxed);
+}
+
+static inline void slot_write(slot *s, affs_object_id id, const affs_location *loc) {
+    atomic_store_explicit(&s->w[0], id.lo, memory_order_relaxed);
+    atomic_store_explicit(&s->w[1], id.hi, memory_order_relaxed);
+    atomic_store_explicit(&s->w[2], loc->offset, memory_order_relaxed);
+    atomic_store_explicit(&s->w[3], loc->length, memory_order_relaxed);
+    atomic_store_explicit(&s->w[4], (uint64_t)(uint32_t)loc->segment_id | ((uint64_t)loc->flags << 32), memory_order_relaxed);
+}
+
+/* Replace the location at slot index i. */
+static void table_update(table *t, size_t i, const affs_location *loc) {
+    group_meta *m = &t->meta[i / GROUP];
+    slot *s = &t->slots[i];
+    write_begin(m);
+    atomic_store_explicit(&s->w[2], loc->offset, memory_order_relaxed);
+    atomic_store_explicit(&s->w[3], loc->length, memory_order_relaxed);
+    atomic_store_explicit(&s->w[4], (uint64_t)(uint32_t)loc->segment_id | ((uint64_t)loc->flags << 32), memory_order_relaxed);
+    write_end(m);
+}
+
+/* Insert an id known to be absent; the table has a free slot. */
+static void table_insert(table *t, affs_object_id id, uint64_t h, const affs_location *loc) {
+    size_t g = (size_t)(h >> 7) & t->mask;
+    for (size_t step = 1;; step++) {
+        group_meta *m = &t->meta[g];
+        uint64_t c0, c1;
+        load_ctrl(m, &c0, &c1);
+        unsigned free_mask = match_free(c0, c1);
+        if (free_mask) {
+            unsigned i = (unsigned)__builtin_ctz(free_mask);
+            if (match_byte(c0, c1, CTRL_DELETED) & (1u << i)) t->deleted--;
+            write_begin(m);
+            slot_write(&t->slots[g * GROUP + i], id, loc);
+            set_ctrl(m, i, (uint8_t)(h & 0x7F));
+            write_end(m);
+            t->used++;
+            return;
+        }
+        g = (g + step) & t->mask;
+    }
+}
+
+static void table_remove(table *t, size_t i) {
+    group_meta *m = &t->meta[i / GROUP];
+    write_begin(m);
+    set_ctrl(m, (unsigned)(i % GROUP), CTRL_DELETED);
+    write_end(m);
+    t->used--;
+    t->deleted++;
+}
+
+/* ---------- reader epochs ---------- */
+
+static unsigned stripe(void) {
+    if (t_stripe == UINT_MAX) t_stripe = atomic_fetch_add(&g_next_stripe, 1) % STRIPES;
+    return t_stripe;
+}
+
+/* Enter a read section; returns the parity to leave with. */
+static unsigned read_enter(affs_index *ix, unsigned s) {
+    for (;;) {
+        unsigned e = (unsigned)(atomic_load(&ix->epoch) & 1);
+        atomic_fetch_add(&ix->readers[e][s].n, 1);
+        if ((atomic_load(&ix->epoch) & 1) == e) return e;
+        atomic_fetch_sub(&ix->readers[e][s].n, 1);
+    }
+}
+
+static void read_leave(affs_index *ix, unsigned e, unsigned s) {
+    atomic_fetch_sub_explicit(&ix->readers[e][s].n, 1, memory_order_release);
+}
+
+/* Wait until no reader can still hold a view published before now. */
+static void synchronize(affs_index *ix) {
+    unsigned e = (unsigned)(atomic_fetch_add(&ix->epoch, 1) & 1);
+    for (unsigned s = 0; s < STRIPES; s++) {
+        while (atomic_load_explicit(&ix->readers[e][s].n, memory_order_acquire) != 0) sched_yield();
+    }
+}
+
+/* Publish {cur, old}; the previous view is freed once unreachable. */
+static int publish(affs_index *ix, table *cur, table *old) {
+    view *v = (view *)malloc(sizeof(view));
+    if (!v) return ENOMEM;
+    v->cur = cur;
+    v->old = old;
+    view *prev = atomic_exchange(&ix->view, v);
+    synchronize(ix);
+    free(prev);
+    return 0;
+}
+
+/* ---------- resizing ---------- */
+
+/*
+ * Copy old groups into the current table, then advance `migrated`
+ * past them. The old table itself is left as it is, so its probe
+ * sequences still end where they used to; readers that find an id
+ * in a moved group look it up in the current table instead.
+ */
+static size_t migrate(affs_index *ix, size_t groups) {
+    view *v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    table *old = v->old, *cur = v->cur;
+    if (!old) return 0;
+    size_t g = atomic_load_explicit(&old->migrated, memory_order_relaxed);
+    for (; groups && g < old->groups; groups--, g++) {
+        uint64_t c0, c1;
+        load_ctrl(&old->meta[g], &c0, &c1);
+        for (unsigned full = ~match_free(c0, c1) & 0xFFFFu; full; full &= full - 1) {
+            const slot *s = &old->slots[g * GROUP + (size_t)__builtin_ctz(full)];
+            affs_object_id id = { atomic_load_explicit(&s->w[0], memory_order_relaxed),
+                                  atomic_load_explicit(&s->w[1], memory_order_relaxed) };
+            affs_location loc;
+            slot_read(s, &loc);
+            table_insert(cur, id, hash_id(id), &loc);
+        }
+        atomic_store_explicit(&old->migrated, g + 1, memory_order_release);
+    }
+    if (g < old->groups) return old->groups - g;
+    if (publish(ix, cur, NULL) != 0) return 1;      /* retried on the next write */
+    table_free(old);
+    return 0;
+}
+
+/* Make room for one more entry in the current table. */
+static int reserve_one(affs_index *ix) {
+    view *v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    if (v->old) migrate(ix, MIGRATE_STEP);
+    v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    table *t = v->cur;
+    if ((t->used + t->deleted + 1) * 8 <= t->groups * GROUP * 7) return 0;
+    if (v->old && migrate(ix, SIZE_MAX) != 0) return ENOMEM;
+    /* mostly tombstones: rehash at the same size */
+    size_t groups = t->used * 2 < t->groups * GROUP ? t->groups : t->groups * 2;
+    if (groups == t->groups && groups_for(t->used + 1) > groups) groups *= 2;
+    table *n = table_new(groups);
+    if (!n) return ENOMEM;
+    if (publish(ix, n, t) != 0) {
+        table_free(n);
+        return ENOMEM;
+    }
+    ix->resizes++;
+    migrate(ix, MIGRATE_STEP);
+    return 0;
+}
+
+/* ---------- public API ---------- */
+
+int affs_index_create(affs_index **out, size_t capacity) {
+    if (!out) return EINVAL;
+    *out = NULL;
+    void *p = NULL;
+    if (posix_memalign(&p, 64, sizeof(affs_index)) != 0) return ENOMEM;
+    affs_index *ix = (affs_index *)p;
+    memset(ix, 0, sizeof(*ix));
+    table *t = table_new(groups_for(capacity));
+    view *v = (view *)malloc(sizeof(view));
+    if (!t || !v) {
+        table_free(t);
+        free(v);
+        free(ix);
+        return ENOMEM;
+    }
+    v->cur = t;
+    v->old = NULL;
+    atomic_init(&ix->view, v);
+    *out = ix;
+    return 0;
+}
+
+void affs_index_destroy(affs_index *ix) {
+    if (!ix) return;
+    view *v = atomic_load(&ix->view);
+    table_free(v->cur);
+    table_free(v->old);
+    free(v);
+    free(ix);
+}
+
+int affs_index_put(affs_index *ix, affs_object_id id, const affs_location *loc) {
+    if (loc->segment_id > UINT32_MAX) return EINVAL;
+    int e = reserve_one(ix);
+    if (e) return e;
+    uint64_t h = hash_id(id);
+    view *v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    size_t i = table_find(v->cur, id, h);
+    if (i != SIZE_MAX) {
+        table_update(v->cur, i, loc);
+        return 0;
+    }
+    size_t j = v->old ? table_find(v->old, id, h) : SIZE_MAX;
+    table_insert(v->cur, id, h, loc);
+    if (j != SIZE_MAX) table_remove(v->old, j);     /* moved: visible in cur before it leaves old */
+    else atomic_fetch_add_explicit(&ix->count, 1, memory_order_relaxed);
+    return 0;
+}
+
+int affs_index_erase(affs_index *ix, affs_object_id id) {
+    uint64_t h = hash_id(id);
+    view *v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    int found = 0;
+    table *tabs[2] = { v->old, v->cur };
+    for (int k = 0; k < 2; k++) {
+        if (!tabs[k]) continue;
+        size_t i = table_find(tabs[k], id, h);
+        if (i != SIZE_MAX) {
+            table_remove(tabs[k], i);
+            found = 1;
+        }
+    }
+    if (!found) return ENOENT;
+    atomic_fetch_sub_explicit(&ix->count, 1, memory_order_relaxed);
+    if (v->old) migrate(ix, MIGRATE_STEP);
+    return 0;
+}
+
+int affs_index_load(affs_index *ix, const affs_index_entry *entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i].object_flags & AFFS_OBJECT_TOMBSTONE) {
+            affs_index_erase(ix, entries[i].id);
+            continue;
+        }
+        int e = affs_index_put(ix, entries[i].id, &entries[i].loc);
+        if (e) return e;
+    }
+    return 0;
+}
+
+size_t affs_index_maintain(affs_index *ix, size_t groups) {
+    return migrate(ix, groups);
+}
+
+int affs_index_get(affs_index *ix, affs_object_id id, affs_location *loc) {
+    unsigned s = stripe();
+    unsigned e = read_enter(ix, s);
+    const view *v = atomic_load_explicit(&ix->view, memory_order_acquire);
+    uint64_t h = hash_id(id);
+    int found = (v->old && table_get(v->old, id, h, loc)) || table_get(v->cur, id, h, loc);
+    read_leave(ix, e, s);
+    return found;
+}
+
+size_t affs_index_get_batch(affs_index *ix, const affs_object_id *ids, size_t n, affs_location *locs, uint8_t *found) {
+    unsigned s = stripe();
+    unsigned e = read_enter(ix, s);
+    const view *v = atomic_load_explicit(&ix->view, memory_order_acquire);
+    size_t hits = 0;
+    for (size_t base = 0; base < n; base += BATCH) {
+        size_t m = n - base < BATCH ? n - base : BATCH;
+        uint64_t h[BATCH];
+        /* stage 1: control groups */
+        for (size_t i = 0; i < m; i++) {
+            h[i] = hash_id(ids[base + i]);
+            prefetch(&v->cur->meta[(size_t)(h[i] >> 7) & v->cur->mask]);
+            if (v->old) prefetch(&v->old->meta[(size_t)(h[i] >> 7) & v->old->mask]);
+        }
+        /* stage 2: the slots their control bytes point at */
+        for (size_t i = 0; i < m; i++) {
+            const table *ts[2] = { v->cur, v->old };
+            for (int k = 0; k < 2 && ts[k]; k++) {
+                size_t g = (size_t)(h[i] >> 7) & ts[k]->mask;
+                uint64_t c0, c1;
+                load_ctrl(&ts[k]->meta[g], &c0, &c1);
+                unsigned match = match_byte(c0, c1, (uint8_t)(h[i] & 0x7F));
+                if (match) {
+                    const slot *sl = &ts[k]->slots[g * GROUP + (size_t)__builtin_ctz(match)];
+                    prefetch(sl);
+                    prefetch((const char *)sl + sizeof(slot) - 1);
+                }
+            }
+        }
+        /* stage 3: compare */
+        for (size_t i = 0; i < m; i++) {
+            affs_location *loc = &locs[base + i];
+            int f = (v->old && table_get(v->old, ids[base + i], h[i], loc)) || table_get(v->cur, ids[base + i], h[i], loc);
+            found[base + i] = (uint8_t)f;
+            hits += (size_t)f;
+        }
+    }
+    read_leave(ix, e, s);
+    return hits;
+}
+
+size_t affs_index_count(affs_index *ix) {
+    return atomic_load_explicit(&ix->count, memory_order_relaxed);
+}
+
+void affs_index_stats_get(affs_index *ix, affs_index_stats *out) {
+    view *v = atomic_load_explicit(&ix->view, memory_order_relaxed);
+    memset(out, 0, sizeof(*out));
+    out->count = affs_index_count(ix);
+    const table *ts[2] = { v->cur, v->old };
+    for (int k = 0; k < 2 && ts[k]; k++) {
+        out->capacity += ts[k]->groups * GROUP;
+        out->tombstones += ts[k]->deleted;
+        out->bytes += ts[k]->groups * (sizeof(group_meta) + GROUP * sizeof(slot));
+    }
+    if (v->old) out->migrating = v->old->groups - atomic_load_explicit(&v->old->migrated, memory_order_relaxed);
+    out->resizes = ix->resizes;
+}
@@ -0,0 +1,811 @@
+#define _GNU_SOURCE
+#include "../include/affs_posting.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define AFFS_POSTING_X86 1
+#endif
+
+#define ARRAY_MAX AFFS_POSTING_ARRAY_MAX
+#define BITMAP_U16 4096         /* 65536 bits in uint16 units */
+#define BITMAP_WORDS 1024
+#define BITMAP_ALIGN 32         /* uint16 units: 64 bytes */
+#define BITMAP_ROOM (BITMAP_U16 + BITMAP_ALIGN)
+#define GALLOP_RATIO 32
+#define PACK_BLOCK 128
+
+enum { OP_AND, OP_OR, OP_ANDNOT };
+
+/* ---------- little-endian fields ---------- */
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void put64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t get64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+/* ---------- bitmap kernels, with and without popcnt ---------- */
+
+static inline uint64_t word_op(uint64_t a, uint64_t b, int op) {
+    return op == OP_AND ? a & b : op == OP_OR ? a | b : a & ~b;
+}
+
+#define BITMAP_KERNELS(name, attr)                                                                 \
+    attr static uint32_t name##_count(const uint64_t *a, const uint64_t *b, int op) {             \
+        uint32_t n = 0;                                                                            \
+        for (int i = 0; i < BITMAP_WORDS; i++) n += (uint32_t)__builtin_popcountll(word_op(a[i], b[i], op)); \
+        return n;                                                                                  \
+    }                                                                                              \
+    attr static void name##_store(uint64_t *o, const uint64_t *a, const uint64_t *b, int op) {    \
+        for (int i = 0; i < BITMAP_WORDS; i++) o[i] = word_op(a[i], b[i], op);                     \
+    }                                                                                              \
+    /* Set bits as values, four per step: up to 3 junk values past the end. */                    \
+    attr static uint32_t name##_extract(uint16_t *o, const uint64_t *a, const uint64_t *b, int op) { \
+        uint32_t k = 0;                                                                            \
+        for (uint32_t w = 0; w < BITMAP_WORDS; w++) {                                              \
+            uint64_t v = word_op(a[w], b[w], op);                                                  \
+            uint32_t n = (uint32_t)__builtin_popcountll(v);                                        \
+            for (uint32_t i = 0; i < n; i += 4) {                                                  \
+                for (int u = 0; u < 4; u++) {                                                      \
+                    o[k + i + u] = (uint16_t)(w * 64 + (uint32_t)__builtin_ctzll(v | 1ull << 63)); \
+                    v &= v - 1;                                                                    \
+                }                                                                                  \
+            }                                                                                      \
+            k += n;                                                                                \
+        }                                                                                          \
+        return k;                                                                                  \
+    }
+
+BITMAP_KERNELS(sw, )
+#ifdef AFFS_POSTING_X86
+BITMAP_KERNELS(hw, __attribute__((target("popcnt"))))
+#endif
+
+static uint32_t (*g_count)(const uint64_t *, const uint64_t *, int) = sw_count;
+static void (*g_store)(uint64_t *, const uint64_t *, const uint64_t *, int) = sw_store;
+static uint32_t (*g_extract)(uint16_t *, const uint64_t *, const uint64_t *, int) = sw_extract;
+static const char *g_impl_name = "portable";
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void kernels_init(void) {
+#ifdef AFFS_POSTING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("popcnt")) {
+        g_count = hw_count;
+        g_store = hw_store;
+        g_extract = hw_extract;
+        g_impl_name = "popcnt";
+    }
+#endif
+}
+
+static inline const uint64_t *bits(const affs_posting *p, uint32_t i) {
+    return (const uint64_t *)(const void *)(p->pool + p->offsets[i]);
+}
+
+static inline int is_bitmap(uint32_t card) {
+    return card > ARRAY_MAX;
+}
+
+/* Pool space a container of `card` values may take, padding included. */
+static inline size_t room(uint32_t card) {
+    return is_bitmap(card) ? BITMAP_ROOM : card;
+}
+
+/* ---------- building ---------- */
+
+/* One allocation: the pool (64-byte aligned), then cards, offsets, keys. */
+static int list_alloc(affs_posting *p, uint32_t containers, size_t pool) {
+    memset(p, 0, sizeof(*p));
+    if (containers == 0) return 0;
+    size_t pool_bytes = (pool * 2 + 63) & ~(size_t)63;
+    void *m;
+    if (posix_memalign(&m, 64, pool_bytes + (size_t)containers * 10) != 0) return ENOMEM;
+    p->pool = (uint16_t *)m;
+    p->cards = (uint32_t *)(void *)((uint8_t *)m + pool_bytes);
+    p->offsets = p->cards + containers;
+    p->keys = (uint16_t *)(void *)(p->offsets + containers);
+    return 0;
+}
+
+/* Where the next container's values go. */
+static inline uint16_t *slot_begin(affs_posting *p, int bitmap) {
+    if (bitmap) p->pool_used = (p->pool_used + BITMAP_ALIGN - 1) & ~(size_t)(BITMAP_ALIGN - 1);
+    return p->pool + p->pool_used;
+}
+
+static inline void slot_commit(affs_posting *p, uint16_t key, uint32_t card, uint16_t *at) {
+    if (card == 0) return;
+    uint32_t i = p->containers++;
+    p->keys[i] = key;
+    p->cards[i] = card;
+    p->offsets[i] = (uint32_t)(at - p->pool);
+    p->pool_used = p->offsets[i] + (is_bitmap(card) ? BITMAP_U16 : card);
+    p->cardinality += card;
+}
+
+static void copy_container(affs_posting *o, const affs_posting *p, uint32_t i) {
+    uint32_t card = p->cards[i];
+    uint16_t *at = slot_begin(o, is_bitmap(card));
+    memcpy(at, p->pool + p->offsets[i], (is_bitmap(card) ? BITMAP_U16 : card) * sizeof(uint16_t));
+    slot_commit(o, p->keys[i], card, at);
+}
+
+/* A bitmap of `n` set bits, stored as a bitmap or as an array. */
+static void emit_bits(affs_posting *o, uint16_t key, const uint64_t *b, uint32_t n) {
+    if (n == 0) return;
+    if (is_bitmap(n)) {
+        uint16_t *at = slot_begin(o, 1);
+        memcpy(at, b, BITMAP_U16 * sizeof(uint16_t));
+        slot_commit(o, key, n, at);
+        return;
+    }
+    uint16_t *at = slot_begin(o, 0);
+    slot_commit(o, key, g_extract(at, b, b, OP_AND), at);
+}
+
+/* a op b for two bitmap containers: counted first, stored in the form the count asks for. */
+static void emit_bitmap_op(affs_posting *o, uint16_t key, const uint64_t *a, const uint64_t *b, int op) {
+    uint32_t n = g_count(a, b, op);
+    if (n == 0) return;
+    if (is_bitmap(n)) {
+        uint16_t *at = slot_begin(o, 1);
+        g_store((uint64_t *)(void *)at, a, b, op);
+        slot_commit(o, key, n, at);
+        return;
+    }
+    uint16_t *at = slot_begin(o, 0);
+    slot_commit(o, key, g_extract(at, a, b, op), at);
+}
+
+static inline int bit_test(const uint64_t *b, uint16_t v) {
+    return (int)(b[v >> 6] >> (v & 63)) & 1;
+}
+
+/* ---------- arrays ---------- */
+
+#if defined(__SSE2__)
+#define ROT16(v, n) _mm_or_si128(_mm_srli_si128(v, 2 * (n)), _mm_slli_si128(v, 16 - 2 * (n)))
+#endif
+
+/*
+ * First block of 8 values at l[j + 8t] whose last value is >= x,
+ * galloping over block ends; the start of the < 8 value tail if none.
+ */
+static uint32_t block_gallop(const uint16_t *l, uint32_t j, uint32_t n, uint16_t x) {
+    uint32_t blocks = (n - j) / 8;
+    if (blocks == 0 || l[j + 7] >= x) return j;
+    uint32_t lo = 0, hi, step = 1;     /* block lo ends below x */
+    for (;;) {
+        hi = lo + step;
+        if (hi >= blocks || l[j + 8 * hi + 7] >= x) break;
+        lo = hi;
+        step <<= 1;
+    }
+    if (hi > blocks) hi = blocks;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (l[j + 8 * mid + 7] < x) lo = mid;
+        else hi = mid;
+    }
+    return j + 8 * hi;
+}
+
+/* 1 if x is in the 8 values at b. */
+static inline int block_has(const uint16_t *b, uint16_t x) {
+#if defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)b);
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_set1_epi16((short)x))) != 0;
+#else
+    for (int i = 0; i < 8; i++) {
+        if (b[i] == x) return 1;
+    }
+    return 0;
+#endif
+}
+
+/* Membership of x in l[j..n), moving j forward; x ascending across calls. */
+static inline int gallop_has(const uint16_t *l, uint32_t *j, uint32_t n, uint16_t x) {
+    uint32_t p = block_gallop(l, *j, n, x);
+    *j = p;
+    if (p + 8 <= n) return block_has(l + p, x);
+    while (p < n && l[p] < x) p++;
+    *j = p;
+    return p < n && l[p] == x;
+}
+
+static uint32_t and_arrays(const uint16_t *a, uint32_t na, const uint16_t *b, uint32_t nb, uint16_t *out) {
+    if (na > nb) {
+        const uint16_t *t = a;
+        a = b;
+        b = t;
+        uint32_t tn = na;
+        na = nb;
+        nb = tn;
+    }
+    uint32_t i = 0, j = 0, k = 0;
+    if ((uint64_t)na * GALLOP_RATIO < nb) {
+        for (; i < na; i++) {
+            if (gallop_has(b, &j, nb, a[i])) out[k++] = a[i];
+        }
+        return k;
+    }
+#if defined(__SSE2__)
+    /* all 8 x 8 pairs of two blocks: 8 compares against rotations of b */
+    while (i + 8 <= na && j + 8 <= nb) {
+        __m128i va = _mm_loadu_si128((const __m128i *)(const void *)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i *)(const void *)(b + j));
+        __m128i m = _mm_cmpeq_epi16(va, vb);
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 1)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 2)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 3)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 4)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 5)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 6)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(va, ROT16(vb, 7)));
+        for (unsigned f = (unsigned)_mm_movemask_epi8(m) & 0x5555u; f; f &= f - 1) out[k++] = a[i + (__builtin_ctz(f) >> 1)];
+        uint16_t amax = a[i + 7], bmax = b[j + 7];
+        if (amax <= bmax) i += 8;
+        if (bmax <= amax) j += 8;
+    }
+#endif
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            out[k++] = a[i];
+            i++;
+            j++;
+        }
+    }
+    return k;
+}
+
+static uint32_t or_arrays(const uint16_t *a, uint32_t na, const uint16_t *b, uint32_t nb, uint16_t *out) {
+    uint32_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) out[k++] = a[i++];
+        else if (a[i] > b[j]) out[k++] = b[j++];
+        else {
+            out[k++] = a[i++];
+            j++;
+        }
+    }
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+    return k;
+}
+
+static uint32_t andnot_arrays(const uint16_t *a, uint32_t na, const uint16_t *b, uint32_t nb, uint16_t *out) {
+    uint32_t i = 0, j = 0, k = 0;
+    if ((uint64_t)na * GALLOP_RATIO < nb) {
+        for (; i < na; i++) {
+            if (!gallop_has(b, &j, nb, a[i])) out[k++] = a[i];
+        }
+        return k;
+    }
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) out[k++] = a[i++];
+        else if (a[i] > b[j]) j++;
+        else {
+            i++;
+            j++;
+        }
+    }
+    while (i < na) out[k++] = a[i++];
+    return k;
+}
+
+/* ---------- public API ---------- */
+
+const char *affs_posting_impl(void) {
+    pthread_once(&g_once, kernels_init);
+    return g_impl_name;
+}
+
+void affs_posting_free(affs_posting *p) {
+    if (!p) return;
+    free(p->pool);
+    memset(p, 0, sizeof(*p));
+}
+
+size_t affs_posting_bytes(const affs_posting *p) {
+    return p->containers ? ((p->pool_used * 2 + 63) & ~(size_t)63) + (size_t)p->containers * 10 : 0;
+}
+
+int affs_posting_copy(affs_posting *out, const affs_posting *p) {
+    if (list_alloc(out, p->containers, p->pool_used) != 0) return ENOMEM;
+    if (!p->containers) return 0;
+    memcpy(out->pool, p->pool, p->pool_used * sizeof(uint16_t));
+    memcpy(out->keys, p->keys, p->containers * sizeof(uint16_t));
+    memcpy(out->cards, p->cards, p->containers * sizeof(uint32_t));
+    memcpy(out->offsets, p->offsets, p->containers * sizeof(uint32_t));
+    out->containers = p->containers;
+    out->pool_used = p->pool_used;
+    out->cardinality = p->cardinality;
+    return 0;
+}
+
+int affs_posting_from_sorted(affs_posting *out, const uint32_t *values, size_t n) {
+    memset(out, 0, sizeof(*out));
+    uint32_t containers = 0;
+    size_t pool = 0;
+    for (size_t i = 0; i < n;) {
+        if (i && values[i] <= values[i - 1]) return EINVAL;
+        size_t e = i + 1;
+        while (e < n && values[e] >> 16 == values[i] >> 16) {
+            if (values[e] <= values[e - 1]) return EINVAL;
+            e++;
+        }
+        containers++;
+        pool += room((uint32_t)(e - i));
+        i = e;
+    }
+    if (list_alloc(out, containers, pool) != 0) return ENOMEM;
+    for (size_t i = 0; i < n;) {
+        size_t e = i + 1;
+        while (e < n && values[e] >> 16 == values[i] >> 16) e++;
+        uint32_t card = (uint32_t)(e - i);
+        uint16_t *at = slot_begin(out, is_bitmap(card));
+        if (is_bitmap(card)) {
+            uint64_t *b = (uint64_t *)(void *)at;
+            memset(b, 0, BITMAP_U16 * sizeof(uint16_t));
+            for (size_t k = i; k < e; k++) b[(values[k] & 0xFFFF) >> 6] |= 1ull << (values[k] & 63);
+        } else {
+            for (size_t k = i; k < e; k++) at[k - i] = (uint16_t)values[k];
+        }
+        slot_commit(out, (uint16_t)(values[i] >> 16), card, at);
+        i = e;
+    }
+    return 0;
+}
+
+void affs_posting_to_array(const affs_posting *p, uint32_t *out) {
+    size_t k = 0;
+    for (uint32_t i = 0; i < p->containers; i++) {
+        uint32_t hi = (uint32_t)p->keys[i] << 16;
+        if (is_bitmap(p->cards[i])) {
+            const uint64_t *b = bits(p, i);
+            for (uint32_t w = 0; w < BITMAP_WORDS; w++) {
+                for (uint64_t v = b[w]; v; v &= v - 1) out[k++] = hi | (w * 64 + (uint32_t)__builtin_ctzll(v));
+            }
+        } else {
+            const uint16_t *a = p->pool + p->offsets[i];
+            for (uint32_t j = 0; j < p->cards[i]; j++) out[k++] = hi | a[j];
+        }
+    }
+}
+
+static int find_key(const affs_posting *p, uint16_t key, uint32_t *at) {
+    uint32_t lo = 0, hi = p->containers;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (p->keys[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    *at = lo;
+    return lo < p->containers && p->keys[lo] == key;
+}
+
+int affs_posting_contains(const affs_posting *p, uint32_t value) {
+    uint32_t i;
+    if (!find_key(p, (uint16_t)(value >> 16), &i)) return 0;
+    uint16_t low = (uint16_t)value;
+    if (is_bitmap(p->cards[i])) return bit_test(bits(p, i), low);
+    const uint16_t *a = p->pool + p->offsets[i];
+    uint32_t lo = 0, hi = p->cards[i];
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (a[mid] < low) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < p->cards[i] && a[lo] == low;
+}
+
+/* ---------- intersection ---------- */
+
+static void and_container(affs_posting *o, const affs_posting *a, uint32_t i, const affs_posting *b, uint32_t j) {
+    uint16_t key = a->keys[i];
+    uint32_t ca = a->cards[i], cb = b->cards[j];
+    if (is_bitmap(ca) && is_bitmap(cb)) {
+        emit_bitmap_op(o, key, bits(a, i), bits(b, j), OP_AND);
+        return;
+    }
+    uint16_t *at = slot_begin(o, 0);
+    if (!is_bitmap(ca) && !is_bitmap(cb)) {
+        slot_commit(o, key, and_arrays(a->pool + a->offsets[i], ca, b->pool + b->offsets[j], cb, at), at);
+        return;
+    }
+    if (is_bitmap(ca)) {
+        const affs_posting *t = a;
+        a = b;
+        b = t;
+        uint32_t ti = i;
+        i = j;
+        j = ti;
+    }
+    const uint16_t *arr = a->pool + a->offsets[i];
+    const uint64_t *bm = bits(b, j);
+    uint32_t k = 0;
+    for (uint32_t x = 0; x < a->cards[i]; x++) {
+        at[k] = arr[x];
+        k += (uint32_t)bit_test(bm, arr[x]);
+    }
+    slot_commit(o, key, k, at);
+}
+
+int affs_posting_and(affs_posting *out, const affs_posting *a, const affs_posting *b) {
+    pthread_once(&g_once, kernels_init);
+    uint32_t containers = a->containers < b->containers ? a->containers : b->containers;
+    size_t pool = (a->pool_used < b->pool_used ? a->pool_used : b->pool_used) + (size_t)containers * BITMAP_ALIGN;
+    if (list_alloc(out, containers, pool) != 0) return ENOMEM;
+    uint32_t i = 0, j = 0;
+    while (i < a->containers && j < b->containers) {
+        if (a->keys[i] < b->keys[j]) i++;
+        else if (a->keys[i] > b->keys[j]) j++;
+        else and_container(out, a, i++, b, j++);
+    }
+    if (out->containers == 0) affs_posting_free(out);
+    return 0;
+}
+
+static int by_cardinality(const void *x, const void *y) {
+    const affs_posting *a = *(const affs_posting *const *)x, *b = *(const affs_posting *const *)y;
+    return a->cardinality < b->cardinality ? -1 : a->cardinality > b->cardinality;
+}
+
+int affs_posting_and_many(affs_posting *out, const affs_posting *const *lists, size_t n) {
+    memset(out, 0, sizeof(*out));
+    if (n == 0) return 0;
+    if (n == 1) return affs_posting_copy(out, lists[0]);
+    const affs_posting **s = (const affs_posting **)malloc(n * sizeof(*s));
+    if (!s) return ENOMEM;
+    memcpy(s, lists, n * sizeof(*s));
+    qsort(s, n, sizeof(*s), by_cardinality);
+    affs_posting acc;
+    int e = affs_posting_and(&acc, s[0], s[1]);
+    for (size_t i = 2; e == 0 && i < n && acc.cardinality; i++) {
+        affs_posting next;
+        e = affs_posting_and(&next, &acc, s[i]);
+        affs_posting_free(&acc);
+        acc = next;
+    }
+    free(s);
+    if (e == 0) *out = acc;
+    return e;
+}
+
+/* ---------- union ---------- */
+
+typedef struct member {
+    uint16_t key;
+    uint32_t list, index;
+} member;
+
+static int by_key(const void *x, const void *y) {
+    const member *a = (const member *)x, *b = (const member *)y;
+    if (a->key != b->key) return a->key < b->key ? -1 : 1;
+    return a->list < b->list ? -1 : a->list > b->list;
+}
+
+/* The union of the containers m[0..n) of one key. */
+static void or_group(affs_posting *o, const affs_posting *const *lists, const member *m, size_t n, uint64_t *acc,
+                     uint16_t *tmp) {
+    uint16_t key = m[0].key;
+    if (n == 1) {
+        copy_container(o, lists[m[0].list], m[0].index);
+        return;
+    }
+    uint64_t total = 0;
+    int any_bitmap = 0;
+    for (size_t g = 0; g < n; g++) {
+        uint32_t c = lists[m[g].list]->cards[m[g].index];
+        total += c;
+        any_bitmap |= is_bitmap(c);
+    }
+    if (!any_bitmap && total <= ARRAY_MAX) {
+        /* merge the arrays: into the slot, through tmp */
+        uint16_t *at = slot_begin(o, 0);
+        const affs_posting *p = lists[m[0].list];
+        uint32_t k = p->cards[m[0].index];
+        memcpy(at, p->pool + p->offsets[m[0].index], k * sizeof(uint16_t));
+        for (size_t g = 1; g < n; g++) {
+            p = lists[m[g].list];
+            uint32_t t = or_arrays(at, k, p->pool + p->offsets[m[g].index], p->cards[m[g].index], tmp);
+            memcpy(at, tmp, t * sizeof(uint16_t));
+            k = t;
+        }
+        slot_commit(o, key, k, at);
+        return;
+    }
+    memset(acc, 0, BITMAP_U16 * sizeof(uint16_t));
+    for (size_t g = 0; g < n; g++) {
+        const affs_posting *p = lists[m[g].list];
+        uint32_t i = m[g].index;
+        if (is_bitmap(p->cards[i])) {
+            g_store(acc, acc, bits(p, i), OP_OR);
+        } else {
+            const uint16_t *a = p->pool + p->offsets[i];
+            for (uint32_t x = 0; x < p->cards[i]; x++) acc[a[x] >> 6] |= 1ull << (a[x] & 63);
+        }
+    }
+    emit_bits(o, key, acc, g_count(acc, acc, OP_AND));
+}
+
+int affs_posting_or_many(affs_posting *out, const affs_posting *const *lists, size_t n) {
+    pthread_once(&g_once, kernels_init);
+    memset(out, 0, sizeof(*out));
+    size_t members = 0, pool = 0;
+    for (size_t l = 0; l < n; l++) {
+        members += lists[l]->containers;
+        pool += lists[l]->pool_used + (size_t)lists[l]->containers * BITMAP_ALIGN;
+    }
+    if (members == 0) return 0;
+    member *m = (member *)malloc(members * sizeof(member));
+    uint64_t *acc = NULL;
+    uint16_t *tmp = (uint16_t *)malloc(ARRAY_MAX * sizeof(uint16_t));
+    if (!m || !tmp || posix_memalign((void **)&acc, 64, BITMAP_U16 * sizeof(uint16_t)) != 0) {
+        free(m);
+        free(tmp);
+        return ENOMEM;
+    }
+    size_t k = 0;
+    for (size_t l = 0; l < n; l++) {
+        for (uint32_t i = 0; i < lists[l]->containers; i++) {
+            m[k].key = lists[l]->keys[i];
+            m[k].list = (uint32_t)l;
+            m[k].index = i;
+            k++;
+        }
+    }
+    qsort(m, members, sizeof(member), by_key);
+    uint32_t keys = 0;
+    for (size_t g = 0; g < members; g++) keys += (g == 0 || m[g].key != m[g - 1].key);
+    int e = list_alloc(out, keys, pool);
+    for (size_t g = 0; e == 0 && g < members;) {
+        size_t end = g + 1;
+        while (end < members && m[end].key == m[g].key) end++;
+        or_group(out, lists, m + g, end - g, acc, tmp);
+        g = end;
+    }
+    free(m);
+    free(tmp);
+    free(acc);
+    return e;
+}
+
+int affs_posting_or(affs_posting *out, const affs_posting *a, const affs_posting *b) {
+    const affs_posting *l[2] = { a, b };
+    return affs_posting_or_many(out, l, 2);
+}
+
+/* ---------- difference ---------- */
+
+int affs_posting_andnot(affs_posting *out, const affs_posting *a, const affs_posting *b) {
+    pthread_once(&g_once, kernels_init);
+    if (list_alloc(out, a->containers, a->pool_used + (size_t)a->containers * BITMAP_ALIGN) != 0) return ENOMEM;
+    uint64_t *acc = NULL;
+    uint32_t j = 0;
+    int e = 0;
+    for (uint32_t i = 0; i < a->containers; i++) {
+        uint16_t key = a->keys[i];
+        while (j < b->containers && b->keys[j] < key) j++;
+        if (j == b->containers || b->keys[j] != key) {
+            copy_container(out, a, i);
+            continue;
+        }
+        uint32_t ca = a->cards[i], cb = b->cards[j];
+        if (is_bitmap(ca) && is_bitmap(cb)) {
+            emit_bitmap_op(out, key, bits(a, i), bits(b, j), OP_ANDNOT);
+        } else if (is_bitmap(ca)) {
+            if (!acc && posix_memalign((void **)&acc, 64, BITMAP_U16 * sizeof(uint16_t)) != 0) {
+                e = ENOMEM;
+                break;
+            }
+            memcpy(acc, bits(a, i), BITMAP_U16 * sizeof(uint16_t));
+            const uint16_t *r = b->pool + b->offsets[j];
+            uint32_t n = ca;
+            for (uint32_t x = 0; x < cb; x++) {
+                uint64_t bit = 1ull << (r[x] & 63);
+                n -= (uint32_t)((acc[r[x] >> 6] & bit) != 0);
+                acc[r[x] >> 6] &= ~bit;
+            }
+            emit_bits(out, key, acc, n);
+        } else {
+            const uint16_t *arr = a->pool + a->offsets[i];
+            uint16_t *at = slot_begin(out, 0);
+            uint32_t k = 0;
+            if (is_bitmap(cb)) {
+                const uint64_t *bm = bits(b, j);
+                for (uint32_t x = 0; x < ca; x++) {
+                    at[k] = arr[x];
+                    k += (uint32_t)!bit_test(bm, arr[x]);
+                }
+            } else {
+                k = andnot_arrays(arr, ca, b->pool + b->offsets[j], cb, at);
+            }
+            slot_commit(out, key, k, at);
+        }
+    }
+    free(acc);
+    if (e != 0 || out->containers == 0) affs_posting_free(out);
+    return e;
+}
+
+/* ---------- encoding ---------- */
+
+static inline unsigned width_of(uint32_t v) {
+    return v ? 32u - (unsigned)__builtin_clz(v) : 0;
+}
+
+/* Width of the gaps - 1 of a[first..first + m], m gaps. */
+static unsigned block_width(const uint16_t *a, uint32_t first, uint32_t m) {
+    uint32_t any = 0;
+    for (uint32_t g = 0; g < m; g++) any |= (uint32_t)(a[first + g + 1] - a[first + g] - 1);
+    return width_of(any);
+}
+
+size_t affs_posting_encoded_size(const affs_posting *p) {
+    size_t n = 4;
+    for (uint32_t i = 0; i < p->containers; i++) {
+        uint32_t card = p->cards[i];
+        n += 4;
+        if (is_bitmap(card)) {
+            n += BITMAP_U16 * 2;
+            continue;
+        }
+        const uint16_t *a = p->pool + p->offsets[i];
+        n += 2;
+        for (uint32_t first = 0; first + 1 < card; first += PACK_BLOCK) {
+            uint32_t m = card - 1 - first < PACK_BLOCK ? card - 1 - first : PACK_BLOCK;
+            n += 1 + (m * block_width(a, first, m) + 7) / 8;
+        }
+    }
+    return n;
+}
+
+void affs_posting_encode(const affs_posting *p, void *dst) {
+    uint8_t *o = (uint8_t *)dst;
+    put32(o, p->containers);
+    o += 4;
+    for (uint32_t i = 0; i < p->containers; i++) {
+        uint32_t card = p->cards[i];
+        put16(o, p->keys[i]);
+        put16(o + 2, (uint16_t)(card - 1));
+        o += 4;
+        if (is_bitmap(card)) {
+            const uint64_t *b = bits(p, i);
+            for (uint32_t w = 0; w < BITMAP_WORDS; w++, o += 8) put64(o, b[w]);
+            continue;
+        }
+        const uint16_t *a = p->pool + p->offsets[i];
+        put16(o, a[0]);
+        o += 2;
+        for (uint32_t first = 0; first + 1 < card; first += PACK_BLOCK) {
+            uint32_t m = card - 1 - first < PACK_BLOCK ? card - 1 - first : PACK_BLOCK;
+            unsigned w = block_width(a, first, m);
+            *o++ = (uint8_t)w;
+            uint64_t bitbuf = 0;
+            unsigned have = 0;
+            for (uint32_t g = 0; g < m; g++) {
+                bitbuf |= (uint64_t)(uint16_t)(a[first + g + 1] - a[first + g] - 1) << have;
+                for (have += w; have >= 8; have -= 8, bitbuf >>= 8) *o++ = (uint8_t)bitbuf;
+            }
+            if (have) *o++ = (uint8_t)bitbuf;
+        }
+    }
+}
+
+int affs_posting_decode(affs_posting *out, const void *src, size_t len) {
+    const uint8_t *s = (const uint8_t *)src;
+    memset(out, 0, sizeof(*out));
+    if (len < 4) return EBADMSG;
+    uint32_t n = get32(s);
+    if (n > 65536) return EBADMSG;
+
+    /* framing first: sizes and key order, to size the allocation */
+    size_t at = 4, pool = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (len - at < 4) return EBADMSG;
+        uint32_t card = (uint32_t)get16(s + at + 2) + 1;
+        at += 4;
+        pool += room(card);
+        if (is_bitmap(card)) {
+            if (len - at < BITMAP_U16 * 2) return EBADMSG;
+            at += BITMAP_U16 * 2;
+            continue;
+        }
+        if (len - at < 2) return EBADMSG;
+        at += 2;
+        for (uint32_t first = 0; first + 1 < card; first += PACK_BLOCK) {
+            uint32_t m = card - 1 - first < PACK_BLOCK ? card - 1 - first : PACK_BLOCK;
+            if (at >= len || s[at] > 16) return EBADMSG;
+            size_t bytes = (m * s[at] + 7) / 8;
+            at++;
+            if (len - at < bytes) return EBADMSG;
+            at += bytes;
+        }
+    }
+    if (at != len) return EBADMSG;
+    if (list_alloc(out, n, pool) != 0) return ENOMEM;
+
+    /* values */
+    at = 4;
+    int prev = -1;
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t key = get16(s + at);
+        uint32_t card = (uint32_t)get16(s + at + 2) + 1;
+        at += 4;
+        if ((int)key <= prev) goto bad;
+        prev = key;
+        if (is_bitmap(card)) {
+            uint64_t *b = (uint64_t *)(void *)slot_begin(out, 1);
+            uint32_t count = 0;
+            for (uint32_t w = 0; w < BITMAP_WORDS; w++, at += 8) {
+                b[w] = get64(s + at);
+                count += (uint32_t)__builtin_popcountll(b[w]);
+            }
+            if (count != card) goto bad;
+            slot_commit(out, key, card, (uint16_t *)(void *)b);
+            continue;
+        }
+        uint16_t *a = slot_begin(out, 0);
+        uint32_t v = get16(s + at), k = 0;
+        at += 2;
+        a[k++] = (uint16_t)v;
+        for (uint32_t first = 0; first + 1 < card; first += PACK_BLOCK) {
+            uint32_t m = card - 1 - first < PACK_BLOCK ? card - 1 - first : PACK_BLOCK;
+            unsigned w = s[at++];
+            const uint8_t *q = s + at;
+            uint64_t bitbuf = 0;
+            unsigned have = 0;
+            for (uint32_t g = 0; g < m; g++) {
+                for (; have < w; have += 8) bitbuf |= (uint64_t)*q++ << have;
+                v += (uint32_t)(bitbuf & ((1u << w) - 1)) + 1;
+                bitbuf >>= w;
+                have -= w;
+                if (v > 0xFFFF) goto bad;
+                a[k++] = (uint16_t)v;
+            }
+            at += (m * w + 7) / 8;
+        }
+        slot_commit(out, key, card, a);
+    }
+    return 0;
+
+bad:
+    affs_posting_free(out);
+    return EBADMSG;
+}
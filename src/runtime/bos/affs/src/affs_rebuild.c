@@ -0,0 +1,532 @@
+#define _GNU_SOURCE
+#include "../include/affs_rebuild.h"
+#include "../include/affs_chain.h"
+#include "../include/affs_crc32c.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_CHUNK (64ull * 1024 * 1024)
+#define DEFAULT_READ (4u * 1024 * 1024)
+#define MIN_READ (64u * 1024)
+#define MIN_BUFFER_ALIGN 4096
+#define SAMPLES_PER_BUCKET 64
+#define CHECKED_BYTES 18        /* header bytes covered by the checksum */
+
+/* ---------- types ---------- */
+
+typedef struct seg_info {
+    const affs_rebuild_segment *s;
+    uint64_t start;             /* absolute */
+    uint64_t limit;             /* absolute scan bound */
+    uint32_t align;
+    uint32_t read_align;
+} seg_info;
+
+typedef struct chunk {
+    size_t seg;
+    uint64_t start, end;        /* absolute; chains start in [start, end) */
+    uint64_t stop;              /* first chain position at or past `end` */
+
+    affs_index_entry *e;        /* object versions in offset order */
+    size_t n, cap;
+    size_t first;               /* entries before it came from a wrong speculative start */
+
+    affs_chain_probes probes;   /* to check its speculative start */
+
+    uint64_t records, skipped;
+    affs_io_result err;
+} chunk;
+
+typedef struct reader {
+    const seg_info *si;
+    uint8_t *buf;
+    size_t cap;
+    uint64_t at;                /* absolute offset of buf[0] */
+    size_t len;
+    uint64_t until;             /* reads stop here unless a record runs on */
+    uint64_t scanned;
+    affs_io_result err;
+} reader;
+
+typedef struct rebuild rebuild;
+typedef void (*task_fn)(rebuild *rb, size_t i, reader *r);
+
+struct rebuild {
+    seg_info *segs;
+    chunk *chunks;
+    size_t nchunks;
+    unsigned threads;
+    size_t read_bytes;
+    int keep_tombstones;
+
+    /* parallel_for */
+    task_fn task;
+    size_t tasks;
+    _Atomic size_t next;
+    _Atomic uint64_t scanned;
+
+    /* merge */
+    affs_object_id *splitters;  /* buckets - 1 */
+    size_t buckets;
+    size_t *counts;             /* [chunk][bucket]: entries, then write positions */
+    size_t *bucket_start;       /* buckets + 1 */
+    size_t *bucket_kept;
+    affs_index_entry *tmp;
+    _Atomic uint64_t superseded;
+    _Atomic uint64_t deleted;
+};
+
+/* ---------- helpers ---------- */
+
+static uint64_t round_up(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+static void *worker_main(void *arg) {
+    rebuild *rb = (rebuild *)arg;
+    reader r;
+    memset(&r, 0, sizeof(r));
+    r.cap = rb->read_bytes;
+    for (;;) {
+        size_t i = atomic_fetch_add(&rb->next, 1);
+        if (i >= rb->tasks) break;
+        rb->task(rb, i, &r);
+    }
+    atomic_fetch_add(&rb->scanned, r.scanned);
+    free(r.buf);
+    return NULL;
+}
+
+/* Run task(i) for i in [0, n) on up to rb->threads threads (the caller is one of them). */
+static void parallel_for(rebuild *rb, size_t n, task_fn task) {
+    rb->task = task;
+    rb->tasks = n;
+    atomic_store(&rb->next, 0);
+    size_t extra = rb->threads > 1 ? rb->threads - 1 : 0;
+    if (extra > n) extra = n;
+    pthread_t *th = extra ? (pthread_t *)malloc(extra * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    while (th && started < extra && pthread_create(&th[started], NULL, worker_main, rb) == 0) started++;
+    worker_main(rb);
+    for (size_t t = 0; t < started; t++) pthread_join(th[t], NULL);
+    free(th);
+}
+
+/* ---------- reading ---------- */
+
+/*
+ * Make [pos, pos + want) visible, as much as the buffer and the scan
+ * bound allow; *avail receives the visible bytes from pos (0 at the
+ * bound or end of file). `contig` asks for all `want` bytes at once.
+ */
+static const uint8_t *view(reader *r, uint64_t pos, uint64_t want, int contig, size_t *avail) {
+    const seg_info *si = r->si;
+    if (want > si->limit - pos) want = si->limit - pos;
+    if (pos < r->at || pos >= r->at + r->len || (contig && pos + want > r->at + r->len)) {
+        uint64_t start = pos / si->read_align * si->read_align;
+        uint64_t end = pos + want > r->until ? pos + want : r->until;
+        uint64_t len = round_up((end < si->limit ? end : si->limit) - start, si->read_align);
+        if (len > r->cap) len = r->cap;
+        affs_io_result res = affs_backend_read(si->s->backend, start, r->buf, (size_t)len);
+        if (res.category != AFFS_IO_OK) {
+            r->err = res;
+            r->len = 0;
+            *avail = 0;
+            return NULL;
+        }
+        r->at = start;
+        r->len = (size_t)res.bytes;
+        r->scanned += res.bytes;
+    }
+    uint64_t have = pos < r->at + r->len ? r->at + r->len - pos : 0;
+    *avail = (size_t)(have < want ? have : want);
+    return r->buf + (pos - r->at);
+}
+
+/* ---------- scanning ---------- */
+
+static int push_entry(chunk *c, const affs_index_entry *e) {
+    if (c->n == c->cap) {
+        size_t cap = c->cap ? c->cap * 2 : 1024;
+        affs_index_entry *p = (affs_index_entry *)realloc(c->e, cap * sizeof(affs_index_entry));
+        if (!p) return 0;
+        c->e = p;
+        c->cap = cap;
+    }
+    c->e[c->n++] = *e;
+    return 1;
+}
+
+/*
+ * Validate the record at `p`; on success return its framed size and,
+ * for an object record, fill `e`. 0 = no valid record here.
+ */
+static uint64_t check_record(reader *r, uint64_t p, affs_index_entry *e, int *object) {
+    const seg_info *si = r->si;
+    size_t avail;
+    const uint8_t *h = view(r, p, AFFS_RECORD_HEADER_SIZE, 1, &avail);
+    if (!h || avail < AFFS_RECORD_HEADER_SIZE) return 0;
+    affs_record_header hd;
+    uint64_t framed;
+    if (affs_record_parse(h, avail, si->align, &hd, &framed) != AFFS_RECORD_OK) return 0;
+    if (framed > si->limit - p) return 0;
+
+    *object = affs_object_kind(hd.kind) && hd.payload_length >= AFFS_OBJECT_PREFIX_SIZE;
+    uint8_t prefix[AFFS_OBJECT_PREFIX_SIZE];
+    size_t have_prefix = 0;
+    uint32_t crc = affs_crc32c(0, h, CHECKED_BYTES);
+    uint64_t q = p + AFFS_RECORD_HEADER_SIZE, left = hd.payload_length;
+    while (left) {
+        const uint8_t *d = view(r, q, left, 0, &avail);
+        if (!d || avail == 0) return 0;
+        if (*object && have_prefix < AFFS_OBJECT_PREFIX_SIZE) {
+            size_t n = AFFS_OBJECT_PREFIX_SIZE - have_prefix < avail ? AFFS_OBJECT_PREFIX_SIZE - have_prefix : avail;
+            memcpy(prefix + have_prefix, d, n);
+            have_prefix += n;
+        }
+        crc = affs_crc32c(crc, d, avail);
+        q += avail;
+        left -= avail;
+    }
+    if (crc != hd.checksum) return 0;
+
+    if (*object) {
+        affs_object_prefix_read(prefix, &e->id, &e->sequence, &e->object_flags);
+        e->loc.segment_id = si->s->segment_id;
+        e->loc.offset = p - si->s->base;
+        e->loc.length = hd.payload_length;
+        e->loc.flags = hd.flags;
+    }
+    return framed;
+}
+
+/* Follow the record chain from `from` until it leaves the chunk. */
+static void scan_chain(chunk *c, uint64_t from, reader *r) {
+    const seg_info *si = r->si;
+    uint64_t p = from;
+    r->until = c->end;
+    while (p < c->end && r->err.category == AFFS_IO_OK) {
+        affs_index_entry e;
+        int object = 0;
+        uint64_t framed = si->limit - p >= AFFS_RECORD_HEADER_SIZE ? check_record(r, p, &e, &object) : 0;
+        if (r->err.category != AFFS_IO_OK) break;
+        if (framed == 0) {
+            p += si->align;
+            c->skipped += si->align;
+            continue;
+        }
+        affs_chain_probe(&c->probes, p, framed, 1);
+        c->records++;
+        if (object && !push_entry(c, &e)) {
+            c->err = affs_io_result_from_errno(ENOMEM);
+            return;
+        }
+        p += framed;
+    }
+    if (r->err.category != AFFS_IO_OK) c->err = r->err;
+    c->stop = p;
+}
+
+static void reset_chunk(chunk *c) {
+    c->n = c->first = 0;
+    affs_chain_probes_reset(&c->probes);
+    c->records = c->skipped = 0;
+}
+
+static int reader_buffer(reader *r) {
+    void *p = NULL;
+    if (!r->buf && posix_memalign(&p, MIN_BUFFER_ALIGN, r->cap) == 0) r->buf = (uint8_t *)p;
+    return r->buf != NULL;
+}
+
+static void scan_task(rebuild *rb, size_t i, reader *r) {
+    chunk *c = &rb->chunks[i];
+    if (!reader_buffer(r)) {
+        c->err = affs_io_result_from_errno(ENOMEM);
+        return;
+    }
+    r->si = &rb->segs[c->seg];
+    r->len = 0;
+    r->err = affs_io_result_ok();
+    scan_chain(c, c->start, r);
+}
+
+/*
+ * `b` is the true record boundary arriving from the previous chunk
+ * (affs_chain.h). Returns 1 if the chunk was rescanned.
+ */
+static int reconcile(rebuild *rb, chunk *c, uint64_t b, reader *r) {
+    uint64_t dropped, covered;
+    switch (affs_chain_reconcile(&c->probes, c->start, c->stop, b, &dropped, &covered)) {
+        case AFFS_CHAIN_KEEP:
+            return 0;
+        case AFFS_CHAIN_COVERED:
+            c->n = c->first = 0;
+            c->records = 0;
+            c->skipped = 0;
+            c->stop = b;
+            return 0;
+        case AFFS_CHAIN_AGREE:
+            while (c->first < c->n && c->e[c->first].loc.offset + rb->segs[c->seg].s->base < b) c->first++;
+            c->records -= dropped;
+            c->skipped -= (b - c->start) - covered;
+            return 0;
+        case AFFS_CHAIN_RESCAN:
+            break;
+    }
+    reset_chunk(c);
+    r->si = &rb->segs[c->seg];
+    r->len = 0;
+    r->err = affs_io_result_ok();
+    scan_chain(c, b, r);
+    return 1;
+}
+
+/* ---------- merging ---------- */
+
+static int entry_order(const void *pa, const void *pb) {
+    const affs_index_entry *a = (const affs_index_entry *)pa, *b = (const affs_index_entry *)pb;
+    int c = affs_object_id_cmp(a->id, b->id);
+    if (c) return c;
+    /* newest first: sequence, then position */
+    if (a->sequence != b->sequence) return a->sequence > b->sequence ? -1 : 1;
+    if (a->loc.segment_id != b->loc.segment_id) return a->loc.segment_id > b->loc.segment_id ? -1 : 1;
+    if (a->loc.offset != b->loc.offset) return a->loc.offset > b->loc.offset ? -1 : 1;
+    return 0;
+}
+
+static int id_order(const void *pa, const void *pb) {
+    return affs_object_id_cmp(*(const affs_object_id *)pa, *(const affs_object_id *)pb);
+}
+
+static size_t bucket_of(const rebuild *rb, affs_object_id id) {
+    size_t lo = 0, hi = rb->buckets - 1;     /* number of splitters <= id */
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (affs_object_id_cmp(rb->splitters[mid], id) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void count_task(rebuild *rb, size_t i, reader *r) {
+    (void)r;
+    const chunk *c = &rb->chunks[i];
+    size_t *cnt = rb->counts + i * rb->buckets;
+    for (size_t k = c->first; k < c->n; k++) cnt[bucket_of(rb, c->e[k].id)]++;
+}
+
+static void scatter_task(rebuild *rb, size_t i, reader *r) {
+    (void)r;
+    chunk *c = &rb->chunks[i];
+    size_t *pos = rb->counts + i * rb->buckets;
+    for (size_t k = c->first; k < c->n; k++) rb->tmp[pos[bucket_of(rb, c->e[k].id)]++] = c->e[k];
+    free(c->e);
+    c->e = NULL;
+}
+
+static void merge_task(rebuild *rb, size_t b, reader *r) {
+    (void)r;
+    affs_index_entry *e = rb->tmp + rb->bucket_start[b];
+    size_t n = rb->bucket_start[b + 1] - rb->bucket_start[b], kept = 0;
+    uint64_t superseded = 0, deleted = 0;
+    qsort(e, n, sizeof(affs_index_entry), entry_order);
+    for (size_t k = 0; k < n;) {
+        size_t j = k + 1;
+        while (j < n && affs_object_id_eq(e[j].id, e[k].id)) j++;
+        superseded += j - k - 1;
+        if (e[k].object_flags & AFFS_OBJECT_TOMBSTONE) deleted++;
+        if (!(e[k].object_flags & AFFS_OBJECT_TOMBSTONE) || rb->keep_tombstones) e[kept++] = e[k];
+        k = j;
+    }
+    rb->bucket_kept[b] = kept;
+    atomic_fetch_add(&rb->superseded, superseded);
+    atomic_fetch_add(&rb->deleted, deleted);
+}
+
+/* Sample-sort the surviving versions by id, then keep the newest per id. */
+static affs_io_result merge(rebuild *rb, affs_rebuild_result *out) {
+    size_t total = 0;
+    for (size_t i = 0; i < rb->nchunks; i++) total += rb->chunks[i].n - rb->chunks[i].first;
+    if (total == 0) return affs_io_result_ok();
+
+    rb->buckets = rb->threads > 1 ? rb->threads * 4 : 1;
+    if (rb->buckets > total) rb->buckets = total;
+    size_t nsamples = rb->buckets > 1 ? rb->buckets * SAMPLES_PER_BUCKET : 0;
+    if (nsamples > total) nsamples = total;
+    affs_object_id *samples = (affs_object_id *)malloc((nsamples ? nsamples : 1) * sizeof(affs_object_id));
+    rb->splitters = (affs_object_id *)malloc(rb->buckets * sizeof(affs_object_id));
+    rb->counts = (size_t *)calloc(rb->nchunks * rb->buckets, sizeof(size_t));
+    rb->bucket_start = (size_t *)calloc(rb->buckets + 1, sizeof(size_t));
+    rb->bucket_kept = (size_t *)calloc(rb->buckets, sizeof(size_t));
+    rb->tmp = (affs_index_entry *)malloc(total * sizeof(affs_index_entry));
+    if (!samples || !rb->splitters || !rb->counts || !rb->bucket_start || !rb->bucket_kept || !rb->tmp) {
+        free(samples);
+        return affs_io_result_from_errno(ENOMEM);
+    }
+
+    /* evenly spaced samples -> bucket splitters */
+    size_t seen = 0, taken = 0;
+    for (size_t i = 0; i < rb->nchunks && taken < nsamples; i++) {
+        const chunk *c = &rb->chunks[i];
+        for (size_t k = c->first; k < c->n && taken < nsamples; k++, seen++) {
+            if (seen * nsamples / total >= taken) samples[taken++] = c->e[k].id;
+        }
+    }
+    qsort(samples, taken, sizeof(affs_object_id), id_order);
+    for (size_t b = 0; b + 1 < rb->buckets; b++) rb->splitters[b] = samples[(b + 1) * taken / rb->buckets];
+    free(samples);
+
+    parallel_for(rb, rb->nchunks, count_task);
+    size_t at = 0;
+    for (size_t b = 0; b < rb->buckets; b++) {
+        rb->bucket_start[b] = at;
+        for (size_t i = 0; i < rb->nchunks; i++) {
+            size_t n = rb->counts[i * rb->buckets + b];
+            rb->counts[i * rb->buckets + b] = at;
+            at += n;
+        }
+    }
+    rb->bucket_start[rb->buckets] = at;
+    parallel_for(rb, rb->nchunks, scatter_task);
+    parallel_for(rb, rb->buckets, merge_task);
+
+    size_t kept = 0;
+    for (size_t b = 0; b < rb->buckets; b++) {
+        memmove(rb->tmp + kept, rb->tmp + rb->bucket_start[b], rb->bucket_kept[b] * sizeof(affs_index_entry));
+        kept += rb->bucket_kept[b];
+    }
+    affs_index_entry *e = kept ? (affs_index_entry *)realloc(rb->tmp, kept * sizeof(affs_index_entry)) : NULL;
+    if (kept && !e) e = rb->tmp;
+    if (!kept) free(rb->tmp);
+    rb->tmp = NULL;
+    out->entries = e;
+    out->count = kept;
+    out->stats.superseded = atomic_load(&rb->superseded);
+    out->stats.deleted = atomic_load(&rb->deleted);
+    return affs_io_result_ok();
+}
+
+/* ---------- public API ---------- */
+
+affs_io_result affs_rebuild(const affs_rebuild_segment *segs, size_t nsegs, const affs_rebuild_options *opt,
+                            affs_rebuild_result *out) {
+    if (!out || (nsegs && !segs)) return affs_io_result_from_errno(EINVAL);
+    memset(out, 0, sizeof(*out));
+    affs_rebuild_options o = opt ? *opt : affs_rebuild_options_default();
+    uint64_t t0 = affs_io_now_ns();
+
+    rebuild rb;
+    memset(&rb, 0, sizeof(rb));
+    rb.keep_tombstones = o.keep_tombstones;
+    rb.threads = o.threads;
+    if (rb.threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        rb.threads = n > 0 ? (unsigned)n : 1;
+    }
+    rb.segs = (seg_info *)calloc(nsegs ? nsegs : 1, sizeof(seg_info));
+    if (!rb.segs) return affs_io_result_from_errno(ENOMEM);
+
+    /* segment bounds and chunking */
+    uint64_t chunk_bytes = o.chunk_bytes ? o.chunk_bytes : DEFAULT_CHUNK;
+    uint64_t max_align = 1;
+    size_t nchunks = 0;
+    affs_io_result res = affs_io_result_ok();
+    for (size_t s = 0; s < nsegs; s++) {
+        seg_info *si = &rb.segs[s];
+        affs_geometry g;
+        if (!segs[s].backend) res = affs_io_result_from_errno(EINVAL);
+        else res = affs_backend_geometry(segs[s].backend, &g);
+        if (res.category != AFFS_IO_OK) break;
+        si->s = &segs[s];
+        si->align = segs[s].align ? segs[s].align : (g.write_align ? g.write_align : 1);
+        si->read_align = g.read_align ? g.read_align : 1;
+        if (si->read_align > max_align) max_align = si->read_align;
+        if (g.mem_align > MIN_BUFFER_ALIGN || si->read_align > MIN_BUFFER_ALIGN) {
+            res = affs_io_result_from_errno(EINVAL);
+            break;
+        }
+        uint64_t size = g.size > segs[s].base ? g.size - segs[s].base : 0;
+        uint64_t end = segs[s].end < size ? segs[s].end : size;
+        si->start = segs[s].base + segs[s].start;
+        si->limit = segs[s].base + (end > segs[s].start ? end : segs[s].start);
+        uint64_t step = round_up(chunk_bytes, si->align);
+        nchunks += (size_t)((si->limit - si->start + step - 1) / step);
+    }
+    rb.read_bytes = (size_t)round_up(o.read_bytes ? o.read_bytes : DEFAULT_READ, max_align);
+    if (rb.read_bytes < MIN_READ) rb.read_bytes = MIN_READ;
+    rb.chunks = res.category == AFFS_IO_OK ? (chunk *)calloc(nchunks ? nchunks : 1, sizeof(chunk)) : NULL;
+    if (res.category == AFFS_IO_OK && !rb.chunks) res = affs_io_result_from_errno(ENOMEM);
+    if (res.category != AFFS_IO_OK) {
+        free(rb.segs);
+        return res;
+    }
+    for (size_t s = 0, k = 0; s < nsegs; s++) {
+        const seg_info *si = &rb.segs[s];
+        uint64_t step = round_up(chunk_bytes, si->align);
+        for (uint64_t at = si->start; at < si->limit; at += step, k++) {
+            rb.chunks[k].seg = s;
+            rb.chunks[k].start = at;
+            rb.chunks[k].end = si->limit - at > step ? at + step : si->limit;
+            rb.chunks[k].err = affs_io_result_ok();
+        }
+    }
+    rb.nchunks = nchunks;
+
+    /* scan in parallel, then fix the speculative starts in order */
+    parallel_for(&rb, nchunks, scan_task);
+    reader r;
+    memset(&r, 0, sizeof(r));
+    for (size_t i = 0; i < nchunks && res.category == AFFS_IO_OK; i++) {
+        if (rb.chunks[i].err.category != AFFS_IO_OK) res = rb.chunks[i].err;
+    }
+    r.cap = rb.read_bytes;
+    if (res.category == AFFS_IO_OK && !reader_buffer(&r)) res = affs_io_result_from_errno(ENOMEM);
+    for (size_t i = 0; i < nchunks && res.category == AFFS_IO_OK; i++) {
+        chunk *c = &rb.chunks[i];
+        if (i == 0 || rb.chunks[i - 1].seg != c->seg) continue;
+        out->stats.rescans += (uint64_t)reconcile(&rb, c, rb.chunks[i - 1].stop, &r);
+        if (c->err.category != AFFS_IO_OK) res = c->err;
+    }
+    free(r.buf);
+    atomic_fetch_add(&rb.scanned, r.scanned);
+
+    uint64_t t1 = affs_io_now_ns();
+    out->stats.scan_ns = t1 - t0;
+    out->stats.bytes_scanned = atomic_load(&rb.scanned);
+    for (size_t i = 0; i < nchunks; i++) {
+        out->stats.records += rb.chunks[i].records;
+        out->stats.skipped_bytes += rb.chunks[i].skipped;
+        out->stats.versions += rb.chunks[i].n - rb.chunks[i].first;
+    }
+    if (res.category == AFFS_IO_OK) res = merge(&rb, out);
+    out->stats.merge_ns = affs_io_now_ns() - t1;
+
+    for (size_t i = 0; i < nchunks; i++) free(rb.chunks[i].e);
+    free(rb.chunks);
+    free(rb.segs);
+    free(rb.splitters);
+    free(rb.counts);
+    free(rb.bucket_start);
+    free(rb.bucket_kept);
+    free(rb.tmp);
+    if (res.category != AFFS_IO_OK) {
+        affs_rebuild_stats st = out->stats;
+        affs_rebuild_result_free(out);
+        out->stats = st;
+    }
+    return res;
+}
+
+void affs_rebuild_result_free(affs_rebuild_result *r) {
+    if (!r) return;
+    free(r->entries);
+    r->entries = NULL;
+    r->count = 0;
+}
@@ -0,0 +1,87 @@
+#include "../include/affs_record.h"
+#include "../include/affs_crc32c.h"
+
+#include <string.h>
+
+#define CHECKED_BYTES 18    /* header bytes covered by the checksum */
+
+/* ---------- helpers ---------- */
+
+static void store_le(uint8_t *p, uint64_t v, int n) {
+    for (int i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t load_le(const uint8_t *p, int n) {
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+/* ---------- public API ---------- */
+
+void affs_record_header_write(uint8_t out[AFFS_RECORD_HEADER_SIZE], const affs_record_header *h) {
+    memcpy(out, "AFR1", 4);
+    out[4] = AFFS_RECORD_VERSION;
+    out[5] = h->kind;
+    out[6] = h->size_class;
+    out[7] = h->access_profile;
+    store_le(out + 8, h->flags, 2);
+    store_le(out + 10, h->payload_length, 8);
+    store_le(out + 18, h->checksum, 4);
+}
+
+size_t affs_record_frame(uint8_t *out, affs_record_header *h, const void *payload, size_t len, uint32_t align) {
+    size_t framed = (size_t)affs_record_framed_size(len, align);
+    h->payload_length = len;
+    affs_record_header_write(out, h);
+    if (len) memcpy(out + AFFS_RECORD_HEADER_SIZE, payload, len);
+    h->checksum = affs_crc32c(affs_crc32c(0, out, CHECKED_BYTES), out + AFFS_RECORD_HEADER_SIZE, len);
+    store_le(out + 18, h->checksum, 4);
+    memset(out + AFFS_RECORD_HEADER_SIZE + len, 0, framed - AFFS_RECORD_HEADER_SIZE - len);
+    return framed;
+}
+
+affs_record_status affs_record_parse(const uint8_t *p, size_t avail, uint32_t align, affs_record_header *h,
+                                     uint64_t *framed) {
+    if (avail < AFFS_RECORD_HEADER_SIZE) return AFFS_RECORD_TRUNCATED;
+    if (memcmp(p, "AFR1", 4) != 0) return AFFS_RECORD_BAD_MAGIC;
+    if (p[4] != AFFS_RECORD_VERSION) return AFFS_RECORD_BAD_VERSION;
+
+    affs_record_header r;
+    r.kind = p[5];
+    r.size_class = p[6];
+    r.access_profile = p[7];
+    r.flags = (uint16_t)load_le(p + 8, 2);
+    r.payload_length = load_le(p + 10, 8);
+    r.checksum = (uint32_t)load_le(p + 18, 4);
+    if (h) *h = r;
+
+    uint64_t size = affs_record_framed_size(r.payload_length, align);
+    if (size == 0) return AFFS_RECORD_BAD_LENGTH;
+    if (framed) *framed = size;
+    return AFFS_RECORD_OK;
+}
+
+affs_record_status affs_record_check(const uint8_t *p, size_t avail, uint32_t align, affs_record_header *h,
+                                     uint64_t *framed) {
+    affs_record_header r;
+    affs_record_status st = affs_record_parse(p, avail, align, &r, framed);
+    if (h && (st == AFFS_RECORD_OK || st == AFFS_RECORD_BAD_LENGTH)) *h = r;
+    if (st != AFFS_RECORD_OK) return st;
+    if (r.payload_length > avail - AFFS_RECORD_HEADER_SIZE) return AFFS_RECORD_TRUNCATED;
+
+    uint32_t crc = affs_crc32c(affs_crc32c(0, p, CHECKED_BYTES), p + AFFS_RECORD_HEADER_SIZE, (size_t)r.payload_length);
+    return crc == r.checksum ? AFFS_RECORD_OK : AFFS_RECORD_BAD_CHECKSUM;
+}
+
+const char *affs_record_status_name(affs_record_status s) {
+    switch (s) {
+        case AFFS_RECORD_OK: return "Ok";
+        case AFFS_RECORD_TRUNCATED: return "Truncated";
+        case AFFS_RECORD_BAD_MAGIC: return "Bad magic";
+        case AFFS_RECORD_BAD_VERSION: return "Unsupported version";
+        case AFFS_RECORD_BAD_LENGTH: return "Bad payload length";
+        case AFFS_RECORD_BAD_CHECKSUM: return "Checksum mismatch";
+        default: return "Unknown status";
+    }
+}
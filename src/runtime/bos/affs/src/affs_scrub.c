@@ -0,0 +1,785 @@
+#define _GNU_SOURCE
+#include "../include/affs_scrub.h"
+#include "../include/affs_chain.h"
+#include "../include/affs_crc32c.h"
+#include "../include/affs_record.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RANGE (64ull * 1024 * 1024)
+#define DEFAULT_READ (4u * 1024 * 1024)
+#define MIN_READ (64u * 1024)
+#define MIN_BUFFER_ALIGN 4096
+#define DEFAULT_MIN_RATE (1ull << 20)
+#define DEFAULT_P99_TARGET 10000000ull
+#define DEFAULT_PROBE 250000000ull
+#define DEFAULT_CHECKPOINT 10000000000ull
+#define MAX_SLEEP 50000000ull   /* token waits are sliced so cancel stays prompt */
+#define CHECKED_BYTES 18        /* header bytes covered by the checksum */
+
+#define CHECKPOINT_SIZE 128
+#define CHECKPOINT_VERSION 1
+
+/* ---------- types ---------- */
+
+typedef struct seg_info {
+    affs_scrub_segment s;
+    uint64_t start, limit;      /* relative to the segment */
+    uint32_t align;
+    uint32_t read_align[2];
+} seg_info;
+
+enum { TODO = 0, SCANNED, ABANDONED };
+
+typedef struct range {
+    size_t seg;
+    uint64_t start, end;        /* relative; chains start in [start, end) */
+    uint64_t stop;              /* first chain position at or past `end` */
+    int state;
+
+    affs_chain_probes probes;   /* to check its speculative start */
+
+    uint64_t records;
+    affs_scrub_event *ev;
+    size_t nev, cap;
+} range;
+
+typedef struct reader {
+    affs_backend *backend;
+    uint64_t base;
+    uint32_t read_align;
+    uint8_t *buf;
+    size_t cap;
+    uint64_t at;                /* absolute offset of buf[0] */
+    size_t len;
+    uint64_t until;             /* absolute: reads stop here unless a record runs on */
+    uint64_t bad_from, bad_to;  /* absolute: the last region that failed to read */
+} reader;
+
+typedef struct worker {
+    reader r[2];
+} worker;
+
+enum { CHECK_VALID = 0, CHECK_INVALID, CHECK_UNREADABLE };
+
+typedef struct totals {
+    uint64_t bytes_verified;
+    uint64_t records;
+    uint64_t repairable;
+    uint64_t mismatches;
+    uint64_t damaged_bytes;
+    uint64_t unreadable_bytes;
+} totals;
+
+struct affs_scrub {
+    seg_info *segs;
+    size_t nsegs;
+    range *ranges;
+    size_t nranges;
+    affs_scrub_options o;
+    size_t read_bytes;
+    uint64_t plan;              /* hash of segments and ranges: a checkpoint must match it */
+
+    /* work */
+    _Atomic size_t next;
+    _Atomic int cancel;
+    _Atomic int err;            /* errno that stopped the run */
+
+    /* finishing, in range order */
+    pthread_mutex_t fin;
+    size_t watermark;           /* ranges before it are finished */
+    uint64_t boundary;          /* `stop` of range watermark - 1 */
+    totals t;
+    uint64_t last_checkpoint_ns;
+    int resumed;
+    affs_scrub_event held;      /* damage that may continue in the next range */
+    int has_held;
+
+    /* token bucket and backoff */
+    pthread_mutex_t bucket;
+    double tokens;
+    uint64_t refill_ns;
+    uint64_t rate;
+    uint64_t next_probe_ns;
+    uint64_t window_bytes, window_ns;
+
+    /* this run */
+    _Atomic uint64_t bytes_read;
+    _Atomic uint64_t rescans;
+    _Atomic uint64_t backoffs;
+    _Atomic uint64_t throttled_ns;
+    uint64_t run_start_ns, run_ns;
+    _Atomic int running;
+};
+
+/* ---------- helpers ---------- */
+
+static uint64_t round_up(uint64_t v, uint64_t a) {
+    return (v + a - 1) / a * a;
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void put64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+static inline uint64_t get64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+static uint64_t fnv(uint64_t h, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (uint8_t)(v >> (8 * i));
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+static void stop_run(affs_scrub *sc, int e) {
+    int none = 0;
+    atomic_compare_exchange_strong(&sc->err, &none, e);
+    atomic_store(&sc->cancel, 1);
+}
+
+/* ---------- token bucket ---------- */
+
+/* Called with the bucket lock held, at most once per probe_ns. */
+static void probe_latency(affs_scrub *sc, uint64_t now) {
+    uint64_t p99 = sc->o.foreground_p99(sc->o.latency_ctx);
+    uint64_t measured = now > sc->window_ns ? (uint64_t)((double)sc->window_bytes * 1e9 / (double)(now - sc->window_ns)) : 0;
+    sc->window_bytes = 0;
+    sc->window_ns = now;
+    sc->next_probe_ns = now + sc->o.probe_ns;
+    if (p99 == 0) return;
+    if (p99 > sc->o.p99_target_ns) {
+        uint64_t from = sc->rate ? sc->rate : measured;
+        sc->rate = from / 2 > sc->o.min_rate ? from / 2 : sc->o.min_rate;
+        if (sc->tokens > 0) sc->tokens = 0;
+        atomic_fetch_add(&sc->backoffs, 1);
+    } else if (p99 < sc->o.p99_target_ns / 4 * 3 && sc->rate) {
+        if (sc->o.rate) {
+            sc->rate += sc->o.rate / 16;
+            if (sc->rate > sc->o.rate) sc->rate = sc->o.rate;
+        } else {
+            /* unlimited by configuration: back to unlimited once the limit stops binding */
+            sc->rate += sc->rate / 4 + 1;
+            if (sc->rate > 2 * measured) sc->rate = 0;
+        }
+    }
+}
+
+/* Take `bytes` from the bucket, sleeping off any debt. */
+static void throttle(affs_scrub *sc, uint64_t bytes) {
+    uint64_t wait = 0;
+    pthread_mutex_lock(&sc->bucket);
+    uint64_t now = affs_io_now_ns();
+    if (sc->o.foreground_p99 && now >= sc->next_probe_ns) probe_latency(sc, now);
+    sc->window_bytes += bytes;
+    if (sc->rate) {
+        double add = (double)(now - sc->refill_ns) * (double)sc->rate / 1e9;
+        sc->tokens = sc->tokens + add < (double)sc->o.burst ? sc->tokens + add : (double)sc->o.burst;
+        sc->tokens -= (double)bytes;
+        if (sc->tokens < 0) wait = (uint64_t)(-sc->tokens * 1e9 / (double)sc->rate);
+    }
+    sc->refill_ns = now;
+    pthread_mutex_unlock(&sc->bucket);
+
+    uint64_t slept = 0;
+    while (slept < wait && !atomic_load(&sc->cancel)) {
+        uint64_t d = wait - slept < MAX_SLEEP ? wait - slept : MAX_SLEEP;
+        struct timespec ts = { (time_t)(d / 1000000000ull), (long)(d % 1000000000ull) };
+        nanosleep(&ts, NULL);
+        slept += d;
+    }
+    if (slept) atomic_fetch_add(&sc->throttled_ns, slept);
+}
+
+/* ---------- events ---------- */
+
+static void push_event(affs_scrub *sc, range *rg, const affs_scrub_event *e) {
+    if (rg->nev) {
+        /* adjacent damage, or adjacent unreadable regions of one copy, extend the last event */
+        affs_scrub_event *l = &rg->ev[rg->nev - 1];
+        if ((e->finding == AFFS_SCRUB_DAMAGED || e->finding == AFFS_SCRUB_UNREADABLE) && l->finding == e->finding &&
+            l->copy == e->copy && l->offset + l->length == e->offset) {
+            l->length += e->length;
+            return;
+        }
+    }
+    if (rg->nev == rg->cap) {
+        size_t cap = rg->cap ? rg->cap * 2 : 16;
+        affs_scrub_event *p = (affs_scrub_event *)realloc(rg->ev, cap * sizeof(affs_scrub_event));
+        if (!p) {
+            stop_run(sc, ENOMEM);
+            return;
+        }
+        rg->ev = p;
+        rg->cap = cap;
+    }
+    rg->ev[rg->nev++] = *e;
+}
+
+static void add_event(affs_scrub *sc, range *rg, affs_scrub_finding f, unsigned copy, uint64_t off, uint64_t len) {
+    affs_scrub_event e;
+    memset(&e, 0, sizeof(e));
+    e.finding = f;
+    e.copy = copy;
+    e.segment_id = sc->segs[rg->seg].s.segment_id;
+    e.offset = off;
+    e.length = len;
+    e.io = affs_io_result_ok();
+    push_event(sc, rg, &e);
+}
+
+/* ---------- reading ---------- */
+
+static int reader_buffer(reader *r, size_t cap) {
+    void *p = NULL;
+    r->cap = cap;
+    if (!r->buf && posix_memalign(&p, MIN_BUFFER_ALIGN, cap) == 0) r->buf = (uint8_t *)p;
+    return r->buf != NULL;
+}
+
+static void reader_bind(reader *r, const seg_info *si, unsigned copy) {
+    affs_backend *b = copy ? si->s.b : si->s.a;
+    uint64_t base = copy ? si->s.base_b : si->s.base_a;
+    if (r->backend != b) {
+        /* the buffer and the failed region are in file offsets: still good for another segment of the same file */
+        r->len = 0;
+        r->bad_from = r->bad_to = 0;
+    }
+    r->backend = b;
+    r->base = base;
+    r->read_align = si->read_align[copy];
+}
+
+/*
+ * Make [pos, pos + want) (relative) visible, as much as the buffer
+ * and the segment limit allow; *avail receives the visible bytes. A
+ * failed read is retried as one MIN_READ block; if that fails too the
+ * block is reported unreadable and NULL returned with *bad set.
+ */
+static const uint8_t *view(affs_scrub *sc, range *rg, reader *r, unsigned copy, uint64_t pos, uint64_t want, int contig,
+                           size_t *avail, int *bad) {
+    const seg_info *si = &sc->segs[rg->seg];
+    uint64_t abs = r->base + pos, limit = r->base + si->limit;
+    *avail = 0;
+    *bad = 0;
+    if (want > limit - abs) want = limit - abs;
+    if (abs >= r->bad_from && abs < r->bad_to) {
+        *bad = 1;
+        return NULL;
+    }
+    if (abs < r->at || abs >= r->at + r->len || (contig && abs + want > r->at + r->len)) {
+        uint64_t start = abs / r->read_align * r->read_align;
+        uint64_t end = abs + want > r->until ? abs + want : r->until;
+        uint64_t len = round_up((end < limit ? end : limit) - start, r->read_align);
+        if (len > r->cap) len = r->cap;
+        throttle(sc, len);
+        affs_io_result res = affs_backend_read(r->backend, start, r->buf, (size_t)len);
+        atomic_fetch_add(&sc->bytes_read, res.bytes);
+        if (res.category != AFFS_IO_OK && len > MIN_READ) {
+            len = round_up(MIN_READ, r->read_align);
+            res = affs_backend_read(r->backend, start, r->buf, (size_t)len);
+            atomic_fetch_add(&sc->bytes_read, res.bytes);
+        }
+        if (res.category != AFFS_IO_OK) {
+            r->len = 0;
+            r->bad_from = start;
+            r->bad_to = start + len < limit ? start + len : limit;
+            affs_scrub_event e;
+            memset(&e, 0, sizeof(e));
+            e.finding = AFFS_SCRUB_UNREADABLE;
+            e.copy = copy;
+            e.segment_id = si->s.segment_id;
+            e.offset = (start > r->base ? start : r->base) - r->base;
+            e.length = r->bad_to - r->base - e.offset;
+            e.io = res;
+            push_event(sc, rg, &e);
+            *bad = 1;
+            return NULL;
+        }
+        r->at = start;
+        r->len = (size_t)res.bytes;
+    }
+    uint64_t have = abs < r->at + r->len ? r->at + r->len - abs : 0;
+    *avail = (size_t)(have < want ? have : want);
+    return r->buf + (abs - r->at);
+}
+
+/* Validate the record at `p` of one copy, streaming the checksum over its payload. */
+static int check_record(affs_scrub *sc, range *rg, reader *r, unsigned copy, uint64_t p, uint64_t *framed, uint32_t *crc_out) {
+    const seg_info *si = &sc->segs[rg->seg];
+    size_t avail;
+    int bad;
+    if (si->limit - p < AFFS_RECORD_HEADER_SIZE) return CHECK_INVALID;
+    const uint8_t *h = view(sc, rg, r, copy, p, AFFS_RECORD_HEADER_SIZE, 1, &avail, &bad);
+    if (bad) return CHECK_UNREADABLE;
+    if (!h || avail < AFFS_RECORD_HEADER_SIZE) return CHECK_INVALID;
+    affs_record_header hd;
+    if (affs_record_parse(h, avail, si->align, &hd, framed) != AFFS_RECORD_OK) return CHECK_INVALID;
+    if (*framed > si->limit - p) return CHECK_INVALID;
+    uint32_t crc = affs_crc32c(0, h, CHECKED_BYTES);
+    uint64_t q = p + AFFS_RECORD_HEADER_SIZE, left = hd.payload_length;
+    while (left) {
+        const uint8_t *d = view(sc, rg, r, copy, q, left, 0, &avail, &bad);
+        if (bad) return CHECK_UNREADABLE;
+        if (!d || avail == 0) return CHECK_INVALID;
+        crc = affs_crc32c(crc, d, avail);
+        q += avail;
+        left -= avail;
+    }
+    if (crc != hd.checksum) return CHECK_INVALID;
+    *crc_out = crc;
+    return CHECK_VALID;
+}
+
+/* ---------- scanning ---------- */
+
+static void probe(range *rg, uint64_t p, uint64_t len, int counted) {
+    if (counted) rg->records++;
+    affs_chain_probe(&rg->probes, p, len, counted);
+}
+
+/* Follow the record chain from `from` until it leaves the range; 0 if cancelled. */
+static int scan_chain(affs_scrub *sc, worker *w, range *rg, uint64_t from) {
+    const seg_info *si = &sc->segs[rg->seg];
+    unsigned copies = si->s.b ? 2 : 1;
+    for (unsigned c = 0; c < copies; c++) {
+        reader_bind(&w->r[c], si, c);
+        w->r[c].until = w->r[c].base + rg->end;
+    }
+    uint64_t p = from;
+    while (p < rg->end) {
+        if (atomic_load(&sc->cancel)) return 0;
+        uint64_t framed[2] = { 0, 0 };
+        uint32_t crc[2] = { 0, 0 };
+        int st[2] = { CHECK_INVALID, CHECK_INVALID };
+        for (unsigned c = 0; c < copies; c++) st[c] = check_record(sc, rg, &w->r[c], c, p, &framed[c], &crc[c]);
+
+        if (copies == 1) {
+            if (st[0] == CHECK_VALID) {
+                probe(rg, p, framed[0], 1);
+                p += framed[0];
+                continue;
+            }
+        } else if (st[0] == CHECK_VALID && st[1] == CHECK_VALID) {
+            int same = framed[0] == framed[1] && crc[0] == crc[1];
+            uint64_t len = framed[0] > framed[1] ? framed[0] : framed[1];
+            if (!same) add_event(sc, rg, AFFS_SCRUB_MISMATCH, 0, p, len);
+            probe(rg, p, len, same);
+            p += len;
+            continue;
+        } else if (st[0] == CHECK_VALID || st[1] == CHECK_VALID) {
+            unsigned good = st[0] == CHECK_VALID ? 0 : 1;
+            add_event(sc, rg, AFFS_SCRUB_REPAIRABLE, 1 - good, p, framed[good]);
+            probe(rg, p, framed[good], 1);
+            p += framed[good];
+            continue;
+        }
+        /* no copy validates; unreadable bytes are already reported as such */
+        int readable = st[0] == CHECK_INVALID || (copies == 2 && st[1] == CHECK_INVALID);
+        if (readable) add_event(sc, rg, AFFS_SCRUB_DAMAGED, 0, p, si->limit - p < si->align ? si->limit - p : si->align);
+        p += si->align;
+    }
+    rg->stop = p;
+    return 1;
+}
+
+static void reset_range(range *rg) {
+    affs_chain_probes_reset(&rg->probes);
+    rg->records = 0;
+    rg->nev = 0;
+}
+
+/*
+ * `b` is the true record boundary arriving from the previous range
+ * (affs_chain.h). Returns 0 if a rescan was cancelled.
+ */
+static int reconcile(affs_scrub *sc, worker *w, range *rg, uint64_t b) {
+    uint64_t dropped, covered;
+    switch (affs_chain_reconcile(&rg->probes, rg->start, rg->stop, b, &dropped, &covered)) {
+        case AFFS_CHAIN_KEEP:
+            break;
+        case AFFS_CHAIN_COVERED:
+            reset_range(rg);
+            rg->stop = b;
+            return 1;
+        case AFFS_CHAIN_AGREE:
+            rg->records -= dropped;
+            break;
+        case AFFS_CHAIN_RESCAN:
+            reset_range(rg);
+            atomic_fetch_add(&sc->rescans, 1);
+            if (!scan_chain(sc, w, rg, b)) return 0;
+            break;
+    }
+    /* keep what lies in [b, stop): ranges report disjoint spans */
+    size_t kept = 0;
+    for (size_t i = 0; i < rg->nev; i++) {
+        affs_scrub_event e = rg->ev[i];
+        uint64_t end = e.offset + e.length;
+        if (e.finding == AFFS_SCRUB_DAMAGED || e.finding == AFFS_SCRUB_UNREADABLE) {
+            if (e.offset < b) e.offset = b;
+            if (end > rg->stop) end = rg->stop;
+            if (end <= e.offset) continue;
+            e.length = end - e.offset;
+        } else if (e.offset < b) {
+            continue;
+        }
+        rg->ev[kept++] = e;
+    }
+    rg->nev = kept;
+    return 1;
+}
+
+/* ---------- checkpoint ---------- */
+
+/*
+ * Layout, little-endian:
+ *    0 Magic "AFSC" 4, 4 Version 2, 6 Reserved 2, 8 Plan 8,
+ *   16 NextRange 8, 24 Boundary 8, 32 BytesVerified 8, 40 Records 8,
+ *   48 Repairable 8, 56 Mismatches 8, 64 DamagedBytes 8,
+ *   72 UnreadableBytes 8, 80 Reserved 44, 124 Crc 4 (CRC32C of 0..123)
+ */
+static void checkpoint_encode(const affs_scrub *sc, uint8_t *h) {
+    memset(h, 0, CHECKPOINT_SIZE);
+    memcpy(h, "AFSC", 4);
+    h[4] = CHECKPOINT_VERSION;
+    put64(h + 8, sc->plan);
+    put64(h + 16, sc->watermark);
+    put64(h + 24, sc->boundary);
+    put64(h + 32, sc->t.bytes_verified);
+    put64(h + 40, sc->t.records);
+    put64(h + 48, sc->t.repairable);
+    put64(h + 56, sc->t.mismatches);
+    put64(h + 64, sc->t.damaged_bytes);
+    put64(h + 72, sc->t.unreadable_bytes);
+    put32(h + 124, affs_crc32c(0, h, 124));
+}
+
+/* Temporary file, fsync, rename. Called with `fin` held. */
+static int checkpoint_write(affs_scrub *sc) {
+    const char *path = sc->o.checkpoint_path;
+    uint8_t h[CHECKPOINT_SIZE];
+    checkpoint_encode(sc, h);
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + 5);
+    if (!tmp) return ENOMEM;
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+    int e = 0, fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) e = errno;
+    size_t done = 0;
+    while (!e && done < sizeof(h)) {
+        ssize_t n = pwrite(fd, h + done, sizeof(h) - done, (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) e = n < 0 ? errno : EIO;
+        else done += (size_t)n;
+    }
+    if (!e && fsync(fd) != 0) e = errno;
+    if (fd >= 0) close(fd);
+    if (!e && rename(tmp, path) != 0) e = errno;
+    if (!e) e = affs_backend_sync_parent(path);
+    if (e) unlink(tmp);
+    free(tmp);
+    sc->last_checkpoint_ns = affs_io_now_ns();
+    return e;
+}
+
+/* A missing, damaged or foreign checkpoint is ignored: the pass starts over. */
+static void checkpoint_load(affs_scrub *sc) {
+    int fd = open(sc->o.checkpoint_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+    uint8_t h[CHECKPOINT_SIZE];
+    ssize_t n = pread(fd, h, sizeof(h), 0);
+    close(fd);
+    if (n != (ssize_t)sizeof(h) || memcmp(h, "AFSC", 4) != 0 || h[4] != CHECKPOINT_VERSION ||
+        get32(h + 124) != affs_crc32c(0, h, 124) || get64(h + 8) != sc->plan || get64(h + 16) > sc->nranges)
+        return;
+    sc->watermark = (size_t)get64(h + 16);
+    sc->boundary = get64(h + 24);
+    sc->t.bytes_verified = get64(h + 32);
+    sc->t.records = get64(h + 40);
+    sc->t.repairable = get64(h + 48);
+    sc->t.mismatches = get64(h + 56);
+    sc->t.damaged_bytes = get64(h + 64);
+    sc->t.unreadable_bytes = get64(h + 72);
+    sc->resumed = 1;
+}
+
+/* ---------- finishing ---------- */
+
+static void flush_held(affs_scrub *sc) {
+    if (sc->has_held && sc->o.on_event) sc->o.on_event(sc->o.event_ctx, &sc->held);
+    sc->has_held = 0;
+}
+
+/* Damaged or unreadable spans continuing across range boundaries are reported once. */
+static void report(affs_scrub *sc, const affs_scrub_event *e) {
+    affs_scrub_event *h = &sc->held;
+    int span = e->finding == AFFS_SCRUB_DAMAGED || e->finding == AFFS_SCRUB_UNREADABLE;
+    if (span && sc->has_held && h->finding == e->finding && h->copy == e->copy && h->segment_id == e->segment_id &&
+        h->offset + h->length == e->offset) {
+        h->length += e->length;
+        return;
+    }
+    flush_held(sc);
+    if (span) {
+        *h = *e;
+        sc->has_held = 1;
+    } else if (sc->o.on_event) {
+        sc->o.on_event(sc->o.event_ctx, e);
+    }
+}
+
+/* Reconcile range watermark, report it and move past it. Called with `fin` held. */
+static int finish_next(affs_scrub *sc, worker *w) {
+    range *rg = &sc->ranges[sc->watermark];
+    int first = sc->watermark == 0 || sc->ranges[sc->watermark - 1].seg != rg->seg;
+    if (!reconcile(sc, w, rg, first ? rg->start : sc->boundary)) return 0;
+    if (atomic_load(&sc->err)) return 0;
+    for (size_t i = 0; i < rg->nev; i++) {
+        const affs_scrub_event *e = &rg->ev[i];
+        switch (e->finding) {
+        case AFFS_SCRUB_REPAIRABLE: sc->t.repairable++; break;
+        case AFFS_SCRUB_MISMATCH: sc->t.mismatches++; break;
+        case AFFS_SCRUB_DAMAGED: sc->t.damaged_bytes += e->length; break;
+        case AFFS_SCRUB_UNREADABLE: sc->t.unreadable_bytes += e->length; break;
+        }
+        report(sc, e);
+    }
+    sc->t.records += rg->records;
+    sc->t.bytes_verified += rg->end - rg->start;
+    sc->boundary = rg->stop;
+    sc->watermark++;
+    if (sc->watermark == sc->nranges || sc->ranges[sc->watermark].seg != rg->seg) flush_held(sc);
+    free(rg->ev);
+    rg->ev = NULL;
+    rg->nev = rg->cap = 0;
+    return 1;
+}
+
+static void range_done(affs_scrub *sc, worker *w, size_t i, int scanned) {
+    pthread_mutex_lock(&sc->fin);
+    sc->ranges[i].state = scanned ? SCANNED : ABANDONED;
+    while (sc->watermark < sc->nranges && sc->ranges[sc->watermark].state == SCANNED && finish_next(sc, w)) {
+    }
+    if (sc->o.checkpoint_path && affs_io_now_ns() - sc->last_checkpoint_ns >= sc->o.checkpoint_ns) {
+        int e = checkpoint_write(sc);
+        if (e) stop_run(sc, e);
+    }
+    pthread_mutex_unlock(&sc->fin);
+}
+
+static void *worker_main(void *arg) {
+    affs_scrub *sc = (affs_scrub *)arg;
+    worker w;
+    memset(&w, 0, sizeof(w));
+    if (!reader_buffer(&w.r[0], sc->read_bytes) || !reader_buffer(&w.r[1], sc->read_bytes)) stop_run(sc, ENOMEM);
+    while (!atomic_load(&sc->cancel)) {
+        size_t i = atomic_fetch_add(&sc->next, 1);
+        if (i >= sc->nranges) break;
+        range *rg = &sc->ranges[i];
+        range_done(sc, &w, i, scan_chain(sc, &w, rg, rg->start));
+    }
+    free(w.r[0].buf);
+    free(w.r[1].buf);
+    return NULL;
+}
+
+/* ---------- public API ---------- */
+
+affs_io_result affs_scrub_create(affs_scrub **out, const affs_scrub_segment *segs, size_t nsegs,
+                                 const affs_scrub_options *opt) {
+    if (!out || (nsegs && !segs)) return affs_io_result_from_errno(EINVAL);
+    *out = NULL;
+    affs_scrub *sc = (affs_scrub *)calloc(1, sizeof(affs_scrub));
+    if (!sc) return affs_io_result_from_errno(ENOMEM);
+    sc->o = opt ? *opt : affs_scrub_options_default();
+    if (sc->o.threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        sc->o.threads = n > 0 ? (unsigned)n : 1;
+    }
+    if (!sc->o.range_bytes) sc->o.range_bytes = DEFAULT_RANGE;
+    if (!sc->o.min_rate) sc->o.min_rate = DEFAULT_MIN_RATE;
+    if (!sc->o.p99_target_ns) sc->o.p99_target_ns = DEFAULT_P99_TARGET;
+    if (!sc->o.probe_ns) sc->o.probe_ns = DEFAULT_PROBE;
+    if (!sc->o.checkpoint_ns) sc->o.checkpoint_ns = DEFAULT_CHECKPOINT;
+    pthread_mutex_init(&sc->fin, NULL);
+    pthread_mutex_init(&sc->bucket, NULL);
+    sc->segs = (seg_info *)calloc(nsegs ? nsegs : 1, sizeof(seg_info));
+    if (!sc->segs) {
+        affs_scrub_destroy(sc);
+        return affs_io_result_from_errno(ENOMEM);
+    }
+    sc->nsegs = nsegs;
+
+    /* segment bounds and ranges */
+    uint64_t max_align = 1;
+    size_t nranges = 0;
+    affs_io_result res = affs_io_result_ok();
+    sc->plan = fnv(0xCBF29CE484222325ull, sc->o.range_bytes);
+    for (size_t s = 0; s < nsegs && res.category == AFFS_IO_OK; s++) {
+        seg_info *si = &sc->segs[s];
+        si->s = segs[s];
+        if (!segs[s].a) res = affs_io_result_from_errno(EINVAL);
+        uint64_t end = segs[s].end;
+        for (unsigned c = 0; c < 2 && res.category == AFFS_IO_OK; c++) {
+            affs_backend *b = c ? segs[s].b : segs[s].a;
+            uint64_t base = c ? segs[s].base_b : segs[s].base_a;
+            if (!b) continue;
+            affs_geometry g;
+            res = affs_backend_geometry(b, &g);
+            if (res.category != AFFS_IO_OK) break;
+            if (g.mem_align > MIN_BUFFER_ALIGN || g.read_align > MIN_BUFFER_ALIGN) res = affs_io_result_from_errno(EINVAL);
+            if (c == 0) si->align = segs[s].align ? segs[s].align : (g.write_align ? g.write_align : 1);
+            si->read_align[c] = g.read_align ? g.read_align : 1;
+            if (si->read_align[c] > max_align) max_align = si->read_align[c];
+            uint64_t size = g.size > base ? g.size - base : 0;
+            if (end > size) end = size;
+        }
+        if (res.category != AFFS_IO_OK) break;
+        si->start = segs[s].start;
+        si->limit = end > segs[s].start ? end : segs[s].start;
+        uint64_t step = round_up(sc->o.range_bytes, si->align);
+        nranges += (size_t)((si->limit - si->start + step - 1) / step);
+        sc->plan = fnv(fnv(fnv(fnv(sc->plan, segs[s].segment_id), si->start), si->limit), si->align << 1 | (segs[s].b != NULL));
+    }
+    sc->read_bytes = (size_t)round_up(sc->o.read_bytes ? sc->o.read_bytes : DEFAULT_READ, max_align);
+    if (sc->read_bytes < MIN_READ) sc->read_bytes = MIN_READ;
+    if (!sc->o.burst) sc->o.burst = 2 * (uint64_t)sc->read_bytes;
+    if (res.category == AFFS_IO_OK) {
+        sc->ranges = (range *)calloc(nranges ? nranges : 1, sizeof(range));
+        if (!sc->ranges) res = affs_io_result_from_errno(ENOMEM);
+    }
+    if (res.category != AFFS_IO_OK) {
+        affs_scrub_destroy(sc);
+        return res;
+    }
+    for (size_t s = 0, k = 0; s < nsegs; s++) {
+        const seg_info *si = &sc->segs[s];
+        uint64_t step = round_up(sc->o.range_bytes, si->align);
+        for (uint64_t at = si->start; at < si->limit; at += step, k++) {
+            sc->ranges[k].seg = s;
+            sc->ranges[k].start = at;
+            sc->ranges[k].end = si->limit - at > step ? at + step : si->limit;
+        }
+    }
+    sc->nranges = nranges;
+    sc->plan = fnv(sc->plan, nranges);
+    if (sc->o.checkpoint_path) checkpoint_load(sc);
+    sc->rate = sc->o.rate;
+    sc->tokens = (double)sc->o.burst;
+    *out = sc;
+    return affs_io_result_ok();
+}
+
+void affs_scrub_destroy(affs_scrub *s) {
+    if (!s) return;
+    for (size_t i = 0; i < s->nranges; i++) free(s->ranges[i].ev);
+    free(s->ranges);
+    free(s->segs);
+    pthread_mutex_destroy(&s->fin);
+    pthread_mutex_destroy(&s->bucket);
+    free(s);
+}
+
+affs_io_result affs_scrub_run(affs_scrub *s, affs_scrub_report *out) {
+    if (!s) return affs_io_result_from_errno(EINVAL);
+    uint64_t t0 = affs_io_now_ns();
+    pthread_mutex_lock(&s->fin);
+    for (size_t i = s->watermark; i < s->nranges; i++) {
+        reset_range(&s->ranges[i]);
+        s->ranges[i].state = TODO;
+    }
+    s->last_checkpoint_ns = t0;
+    s->run_start_ns = t0;
+    atomic_store(&s->running, 1);
+    pthread_mutex_unlock(&s->fin);
+    atomic_store(&s->next, s->watermark);
+    atomic_store(&s->cancel, 0);
+    atomic_store(&s->err, 0);
+    atomic_store(&s->bytes_read, 0);
+    atomic_store(&s->rescans, 0);
+    atomic_store(&s->backoffs, 0);
+    atomic_store(&s->throttled_ns, 0);
+    pthread_mutex_lock(&s->bucket);
+    s->refill_ns = s->window_ns = t0;
+    s->window_bytes = 0;
+    s->next_probe_ns = t0 + s->o.probe_ns;
+    pthread_mutex_unlock(&s->bucket);
+
+    size_t extra = s->o.threads > 1 ? s->o.threads - 1 : 0;
+    if (extra > s->nranges - s->watermark) extra = s->nranges - s->watermark;
+    pthread_t *th = extra ? (pthread_t *)malloc(extra * sizeof(pthread_t)) : NULL;
+    size_t started = 0;
+    while (th && started < extra && pthread_create(&th[started], NULL, worker_main, s) == 0) started++;
+    worker_main(s);
+    for (size_t t = 0; t < started; t++) pthread_join(th[t], NULL);
+    free(th);
+
+    int e = atomic_load(&s->err);
+    pthread_mutex_lock(&s->fin);
+    flush_held(s);
+    if (s->o.checkpoint_path) {
+        if (s->watermark == s->nranges) {
+            if (unlink(s->o.checkpoint_path) != 0 && errno != ENOENT && !e) e = errno;
+        } else {
+            int ce = checkpoint_write(s);
+            if (!e) e = ce;
+        }
+    }
+    s->run_ns = affs_io_now_ns() - t0;
+    atomic_store(&s->running, 0);
+    pthread_mutex_unlock(&s->fin);
+    if (out) affs_scrub_progress(s, out);
+    return e ? affs_io_result_from_errno(e) : affs_io_result_ok();
+}
+
+void affs_scrub_cancel(affs_scrub *s) {
+    if (s) atomic_store(&s->cancel, 1);
+}
+
+void affs_scrub_progress(affs_scrub *s, affs_scrub_report *out) {
+    memset(out, 0, sizeof(*out));
+    pthread_mutex_lock(&s->fin);
+    out->ranges = s->nranges;
+    out->ranges_done = s->watermark;
+    out->bytes_verified = s->t.bytes_verified;
+    out->records = s->t.records;
+    out->repairable = s->t.repairable;
+    out->mismatches = s->t.mismatches;
+    out->damaged_bytes = s->t.damaged_bytes;
+    out->unreadable_bytes = s->t.unreadable_bytes;
+    out->resumed = s->resumed;
+    out->complete = s->watermark == s->nranges;
+    out->elapsed_ns = atomic_load(&s->running) ? affs_io_now_ns() - s->run_start_ns : s->run_ns;
+    pthread_mutex_unlock(&s->fin);
+    pthread_mutex_lock(&s->bucket);
+    out->rate = s->rate;
+    pthread_mutex_unlock(&s->bucket);
+    out->bytes_read = atomic_load(&s->bytes_read);
+    out->rescans = atomic_load(&s->rescans);
+    out->backoffs = atomic_load(&s->backoffs);
+    out->throttled_ns = atomic_load(&s->throttled_ns);
+}
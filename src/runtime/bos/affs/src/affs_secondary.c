@@ -0,0 +1,590 @@
+#define _GNU_SOURCE
+#include "../include/affs_secondary.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MERGE_THRESHOLD 1024
+#define DEFAULT_PURGE_THRESHOLD 65536
+#define MIN_BUCKETS 64
+
+/* ---------- types ---------- */
+
+/* Ascending ordinals without duplicates. */
+typedef struct vec32 {
+    uint32_t *v;
+    uint32_t n, cap;
+} vec32;
+
+typedef struct key_entry {
+    struct key_entry *hnext;
+    uint64_t hash;
+    affs_posting base;          /* merged; replaced only by the merger */
+    vec32 pending;              /* added since, not in base */
+    int queued;                 /* on the dirty list */
+    uint32_t len;
+    uint8_t key[];
+} key_entry;
+
+struct affs_secondary {
+    /* Key table, pending arrays, dirty list, removed set: appends and
+       swaps take it exclusively, queries shared. */
+    pthread_rwlock_t lock;
+    key_entry **buckets;
+    size_t nbuckets, nkeys;
+    key_entry **dirty;
+    size_t ndirty, dirty_cap;
+    affs_posting removed;       /* merged removals; replaced only by the merger */
+    vec32 rpending;             /* removals since */
+    uint64_t merges, purges;
+
+    uint32_t merge_threshold;
+    uint64_t purge_threshold;
+    pthread_mutex_t merging;    /* one merger at a time */
+
+    int manual;
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    int work, stopping;
+    pthread_t thread;
+};
+
+/* ---------- helpers ---------- */
+
+static uint64_t hash_key(const uint8_t *p, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ (uint64_t)len;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p, len);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 29;
+    h *= 0xFF51AFD7ED558CCDull;
+    return h ^ (h >> 32);
+}
+
+static int vec_find(const vec32 *a, uint32_t x, uint32_t *at) {
+    uint32_t lo = 0, hi = a->n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (a->v[mid] < x) lo = mid + 1;
+        else hi = mid;
+    }
+    *at = lo;
+    return lo < a->n && a->v[lo] == x;
+}
+
+/* Ordinals mostly arrive ascending: appending is the common case. */
+static int vec_insert(vec32 *a, uint32_t x) {
+    uint32_t at = a->n;
+    if (a->n && a->v[a->n - 1] >= x && vec_find(a, x, &at)) return 0;
+    if (a->n == a->cap) {
+        uint32_t cap = a->cap ? a->cap * 2 : 4;
+        uint32_t *v = (uint32_t *)realloc(a->v, (size_t)cap * sizeof(uint32_t));
+        if (!v) return ENOMEM;
+        a->v = v;
+        a->cap = cap;
+    }
+    memmove(a->v + at + 1, a->v + at, (size_t)(a->n - at) * sizeof(uint32_t));
+    a->v[at] = x;
+    a->n++;
+    return 0;
+}
+
+/* Drop the ascending values s[0..n) from a. */
+static void vec_subtract(vec32 *a, const uint32_t *s, uint32_t n) {
+    uint32_t i = 0, j = 0, k = 0;
+    while (i < a->n) {
+        while (j < n && s[j] < a->v[i]) j++;
+        if (j < n && s[j] == a->v[i]) i++;
+        else a->v[k++] = a->v[i++];
+    }
+    a->n = k;
+    if (k == 0) {
+        free(a->v);
+        memset(a, 0, sizeof(*a));
+    }
+}
+
+/* Under the lock. */
+static key_entry *lookup(const affs_secondary *ix, const void *key, size_t len, uint64_t h) {
+    for (key_entry *k = ix->buckets[h & (ix->nbuckets - 1)]; k; k = k->hnext) {
+        if (k->hash == h && k->len == len && memcmp(k->key, key, len) == 0) return k;
+    }
+    return NULL;
+}
+
+/* Under the exclusive lock. */
+static key_entry *lookup_or_insert(affs_secondary *ix, const void *key, size_t len) {
+    uint64_t h = hash_key((const uint8_t *)key, len);
+    key_entry *k = lookup(ix, key, len, h);
+    if (k) return k;
+    if (len > UINT32_MAX) return NULL;
+    if (ix->nkeys >= ix->nbuckets) {
+        size_t nb = ix->nbuckets * 2;
+        key_entry **b = (key_entry **)calloc(nb, sizeof(key_entry *));
+        if (!b) return NULL;
+        for (size_t i = 0; i < ix->nbuckets; i++) {
+            for (key_entry *e = ix->buckets[i], *next; e; e = next) {
+                next = e->hnext;
+                e->hnext = b[e->hash & (nb - 1)];
+                b[e->hash & (nb - 1)] = e;
+            }
+        }
+        free(ix->buckets);
+        ix->buckets = b;
+        ix->nbuckets = nb;
+    }
+    k = (key_entry *)calloc(1, sizeof(key_entry) + len);
+    if (!k) return NULL;
+    k->hash = h;
+    k->len = (uint32_t)len;
+    memcpy(k->key, key, len);
+    k->hnext = ix->buckets[h & (ix->nbuckets - 1)];
+    ix->buckets[h & (ix->nbuckets - 1)] = k;
+    ix->nkeys++;
+    return k;
+}
+
+/* Under the exclusive lock. */
+static void mark_dirty(affs_secondary *ix, key_entry *k, int *wake) {
+    if (k->queued || k->pending.n < ix->merge_threshold) return;
+    if (ix->ndirty == ix->dirty_cap) {
+        size_t cap = ix->dirty_cap ? ix->dirty_cap * 2 : 16;
+        key_entry **d = (key_entry **)realloc(ix->dirty, cap * sizeof(key_entry *));
+        if (!d) return;     /* merged by the next affs_secondary_merge() */
+        ix->dirty = d;
+        ix->dirty_cap = cap;
+    }
+    ix->dirty[ix->ndirty++] = k;
+    k->queued = 1;
+    *wake = 1;
+}
+
+static void wake_merger(affs_secondary *ix) {
+    if (ix->manual) return;
+    pthread_mutex_lock(&ix->wake_lock);
+    ix->work = 1;
+    pthread_cond_signal(&ix->wake);
+    pthread_mutex_unlock(&ix->wake_lock);
+}
+
+/* Copy of a pending array, taken under the shared lock. */
+static int snapshot(affs_secondary *ix, const vec32 *a, uint32_t **out, uint32_t *n) {
+    pthread_rwlock_rdlock(&ix->lock);
+    *n = a->n;
+    *out = NULL;
+    if (*n && !(*out = (uint32_t *)malloc((size_t)*n * sizeof(uint32_t)))) {
+        pthread_rwlock_unlock(&ix->lock);
+        return ENOMEM;
+    }
+    if (*n) memcpy(*out, a->v, (size_t)*n * sizeof(uint32_t));
+    pthread_rwlock_unlock(&ix->lock);
+    return 0;
+}
+
+/* ---------- merging (holding `merging`) ---------- */
+
+/* base = (base | pending) - drop, built outside the lock and swapped in. */
+static int merge_key(affs_secondary *ix, key_entry *k, const affs_posting *drop) {
+    uint32_t *snap, n;
+    if (snapshot(ix, &k->pending, &snap, &n) != 0) return ENOMEM;
+    int dropping = drop && drop->cardinality && (k->base.cardinality || n);
+    if (n == 0 && !dropping) return 0;
+
+    affs_posting add, u, next;
+    int e = affs_posting_from_sorted(&add, snap, n);
+    if (e == 0) {
+        e = affs_posting_or(&u, &k->base, &add);
+        affs_posting_free(&add);
+    }
+    if (e == 0 && dropping) {
+        e = affs_posting_andnot(&next, &u, drop);
+        affs_posting_free(&u);
+    } else if (e == 0) {
+        next = u;
+    }
+    if (e != 0) {
+        free(snap);
+        return e;
+    }
+
+    pthread_rwlock_wrlock(&ix->lock);
+    affs_posting old = k->base;
+    k->base = next;
+    vec_subtract(&k->pending, snap, n);
+    ix->merges++;
+    pthread_rwlock_unlock(&ix->lock);
+    affs_posting_free(&old);
+    free(snap);
+    return 0;
+}
+
+static int fold_removed(affs_secondary *ix) {
+    uint32_t *snap, n;
+    if (snapshot(ix, &ix->rpending, &snap, &n) != 0) return ENOMEM;
+    if (n == 0) return 0;
+    affs_posting add, next;
+    int e = affs_posting_from_sorted(&add, snap, n);
+    if (e == 0) {
+        e = affs_posting_or(&next, &ix->removed, &add);
+        affs_posting_free(&add);
+    }
+    if (e == 0) {
+        pthread_rwlock_wrlock(&ix->lock);
+        affs_posting old = ix->removed;
+        ix->removed = next;
+        vec_subtract(&ix->rpending, snap, n);
+        pthread_rwlock_unlock(&ix->lock);
+        affs_posting_free(&old);
+    }
+    free(snap);
+    return e;
+}
+
+/* Every key, taken under the shared lock (keys are never freed before destroy). */
+static key_entry **all_keys(affs_secondary *ix, size_t *n) {
+    pthread_rwlock_rdlock(&ix->lock);
+    key_entry **v = (key_entry **)malloc((ix->nkeys ? ix->nkeys : 1) * sizeof(key_entry *));
+    size_t k = 0;
+    if (v) {
+        for (size_t i = 0; i < ix->nbuckets; i++) {
+            for (key_entry *e = ix->buckets[i]; e; e = e->hnext) v[k++] = e;
+        }
+    }
+    pthread_rwlock_unlock(&ix->lock);
+    *n = k;
+    return v;
+}
+
+/*
+ * Rewrite every list without the removed set, then forget it. The
+ * set is taken before any pending array: an ordinal added and then
+ * removed is either in the list being rewritten or in the snapshot
+ * of its pending array, and is dropped with it.
+ */
+static int purge(affs_secondary *ix) {
+    int e = fold_removed(ix);
+    if (e != 0 || ix->removed.cardinality == 0) return e;
+    size_t n;
+    key_entry **keys = all_keys(ix, &n);
+    if (!keys) return ENOMEM;
+    for (size_t i = 0; e == 0 && i < n; i++) e = merge_key(ix, keys[i], &ix->removed);
+    free(keys);
+    if (e != 0) return e;   /* still subtracted by queries; retried on the next purge */
+
+    pthread_rwlock_wrlock(&ix->lock);
+    affs_posting old = ix->removed;
+    memset(&ix->removed, 0, sizeof(ix->removed));
+    ix->purges++;
+    pthread_rwlock_unlock(&ix->lock);
+    affs_posting_free(&old);
+    return 0;
+}
+
+static void merge_dirty(affs_secondary *ix) {
+    pthread_mutex_lock(&ix->merging);
+    pthread_rwlock_wrlock(&ix->lock);
+    key_entry **dirty = ix->dirty;
+    size_t n = ix->ndirty;
+    for (size_t i = 0; i < n; i++) dirty[i]->queued = 0;
+    ix->dirty = NULL;
+    ix->ndirty = ix->dirty_cap = 0;
+    int removals = ix->rpending.n >= ix->merge_threshold;
+    pthread_rwlock_unlock(&ix->lock);
+
+    for (size_t i = 0; i < n; i++) merge_key(ix, dirty[i], NULL);
+    free(dirty);
+    if (removals) fold_removed(ix);
+    if (ix->removed.cardinality >= ix->purge_threshold) purge(ix);
+    pthread_mutex_unlock(&ix->merging);
+}
+
+static void *merger_main(void *arg) {
+    affs_secondary *ix = (affs_secondary *)arg;
+    pthread_mutex_lock(&ix->wake_lock);
+    for (;;) {
+        while (!ix->work && !ix->stopping) pthread_cond_wait(&ix->wake, &ix->wake_lock);
+        if (ix->stopping) break;
+        ix->work = 0;
+        pthread_mutex_unlock(&ix->wake_lock);
+        merge_dirty(ix);
+        pthread_mutex_lock(&ix->wake_lock);
+    }
+    pthread_mutex_unlock(&ix->wake_lock);
+    return NULL;
+}
+
+/* ---------- queries (holding the shared lock) ---------- */
+
+static int replace(affs_posting *r, int e, affs_posting *next) {
+    if (e != 0) return e;
+    affs_posting_free(r);
+    *r = *next;
+    return 0;
+}
+
+static int subtract_removed(affs_secondary *ix, affs_posting *r) {
+    affs_posting t;
+    int e = 0;
+    if (ix->removed.cardinality && r->cardinality) e = replace(r, affs_posting_andnot(&t, r, &ix->removed), &t);
+    if (e == 0 && ix->rpending.n && r->cardinality) {
+        affs_posting p;
+        e = affs_posting_from_sorted(&p, ix->rpending.v, ix->rpending.n);
+        if (e == 0) {
+            e = replace(r, affs_posting_andnot(&t, r, &p), &t);
+            affs_posting_free(&p);
+        }
+    }
+    return e;
+}
+
+static int cmp_u32(const void *x, const void *y) {
+    uint32_t a = *(const uint32_t *)x, b = *(const uint32_t *)y;
+    return a < b ? -1 : a > b;
+}
+
+/*
+ * The pending ordinals of any key that every key holds, merged or
+ * pending: the part of an intersection the merged lists miss.
+ */
+static int pending_matches(key_entry *const *ks, size_t n, affs_posting *out) {
+    memset(out, 0, sizeof(*out));
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++) total += ks[i]->pending.n;
+    if (total == 0) return 0;
+    uint32_t *c = (uint32_t *)malloc(total * sizeof(uint32_t));
+    if (!c) return ENOMEM;
+    size_t m = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ks[i]->pending.n) memcpy(c + m, ks[i]->pending.v, (size_t)ks[i]->pending.n * sizeof(uint32_t));
+        m += ks[i]->pending.n;
+    }
+    qsort(c, m, sizeof(uint32_t), cmp_u32);
+    size_t k = 0;
+    for (size_t i = 0; i < m; i++) {
+        if (k && c[k - 1] == c[i]) continue;
+        int all = 1;
+        for (size_t j = 0; all && j < n; j++) {
+            uint32_t at;
+            all = vec_find(&ks[j]->pending, c[i], &at) || affs_posting_contains(&ks[j]->base, c[i]);
+        }
+        if (all) c[k++] = c[i];
+    }
+    int e = affs_posting_from_sorted(out, c, k);
+    free(c);
+    return e;
+}
+
+/* ---------- public API ---------- */
+
+int affs_secondary_create(affs_secondary **out, const affs_secondary_options *opt) {
+    affs_secondary_options o = opt ? *opt : affs_secondary_options_default();
+    affs_secondary *ix = (affs_secondary *)calloc(1, sizeof(affs_secondary));
+    if (!ix) return ENOMEM;
+    ix->nbuckets = MIN_BUCKETS;
+    ix->buckets = (key_entry **)calloc(ix->nbuckets, sizeof(key_entry *));
+    if (!ix->buckets) {
+        free(ix);
+        return ENOMEM;
+    }
+    ix->merge_threshold = o.merge_threshold ? o.merge_threshold : DEFAULT_MERGE_THRESHOLD;
+    ix->purge_threshold = o.purge_threshold ? o.purge_threshold : DEFAULT_PURGE_THRESHOLD;
+    ix->manual = o.manual;
+    pthread_rwlock_init(&ix->lock, NULL);
+    pthread_mutex_init(&ix->merging, NULL);
+    pthread_mutex_init(&ix->wake_lock, NULL);
+    pthread_cond_init(&ix->wake, NULL);
+    int e = ix->manual ? 0 : pthread_create(&ix->thread, NULL, merger_main, ix);
+    if (e != 0) {
+        ix->manual = 1;
+        affs_secondary_destroy(ix);
+        return e;
+    }
+    *out = ix;
+    return 0;
+}
+
+void affs_secondary_destroy(affs_secondary *ix) {
+    if (!ix) return;
+    if (!ix->manual) {
+        pthread_mutex_lock(&ix->wake_lock);
+        ix->stopping = 1;
+        pthread_cond_signal(&ix->wake);
+        pthread_mutex_unlock(&ix->wake_lock);
+        pthread_join(ix->thread, NULL);
+    }
+    for (size_t i = 0; i < ix->nbuckets; i++) {
+        for (key_entry *k = ix->buckets[i], *next; k; k = next) {
+            next = k->hnext;
+            affs_posting_free(&k->base);
+            free(k->pending.v);
+            free(k);
+        }
+    }
+    free(ix->buckets);
+    free(ix->dirty);
+    affs_posting_free(&ix->removed);
+    free(ix->rpending.v);
+    pthread_rwlock_destroy(&ix->lock);
+    pthread_mutex_destroy(&ix->merging);
+    pthread_mutex_destroy(&ix->wake_lock);
+    pthread_cond_destroy(&ix->wake);
+    free(ix);
+}
+
+int affs_secondary_add(affs_secondary *ix, const void *key, size_t len, uint32_t ordinal) {
+    int wake = 0;
+    pthread_rwlock_wrlock(&ix->lock);
+    key_entry *k = lookup_or_insert(ix, key, len);
+    int e = k ? vec_insert(&k->pending, ordinal) : ENOMEM;
+    if (e == 0) mark_dirty(ix, k, &wake);
+    pthread_rwlock_unlock(&ix->lock);
+    if (wake) wake_merger(ix);
+    return e;
+}
+
+int affs_secondary_remove(affs_secondary *ix, uint32_t ordinal) {
+    pthread_rwlock_wrlock(&ix->lock);
+    int e = vec_insert(&ix->rpending, ordinal);
+    int wake = e == 0 && ix->rpending.n == ix->merge_threshold;
+    pthread_rwlock_unlock(&ix->lock);
+    if (wake) wake_merger(ix);
+    return e;
+}
+
+int affs_secondary_load(affs_secondary *ix, const void *key, size_t len, const affs_posting *list) {
+    pthread_mutex_lock(&ix->merging);
+    pthread_rwlock_wrlock(&ix->lock);
+    key_entry *k = lookup_or_insert(ix, key, len);
+    pthread_rwlock_unlock(&ix->lock);
+    affs_posting next;
+    int e = k ? affs_posting_or(&next, &k->base, list) : ENOMEM;
+    if (e == 0) {
+        pthread_rwlock_wrlock(&ix->lock);
+        affs_posting old = k->base;
+        k->base = next;
+        pthread_rwlock_unlock(&ix->lock);
+        affs_posting_free(&old);
+    }
+    pthread_mutex_unlock(&ix->merging);
+    return e;
+}
+
+int affs_secondary_merge(affs_secondary *ix) {
+    pthread_mutex_lock(&ix->merging);
+    pthread_rwlock_wrlock(&ix->lock);
+    for (size_t i = 0; i < ix->ndirty; i++) ix->dirty[i]->queued = 0;
+    ix->ndirty = 0;
+    pthread_rwlock_unlock(&ix->lock);
+
+    int e = fold_removed(ix);
+    if (e == 0 && ix->removed.cardinality) {
+        e = purge(ix);      /* merges every key on the way */
+    } else if (e == 0) {
+        size_t n;
+        key_entry **keys = all_keys(ix, &n);
+        if (!keys) e = ENOMEM;
+        for (size_t i = 0; e == 0 && i < n; i++) e = merge_key(ix, keys[i], NULL);
+        free(keys);
+    }
+    pthread_mutex_unlock(&ix->merging);
+    return e;
+}
+
+int affs_secondary_find(affs_secondary *ix, const void *key, size_t len, affs_posting *out) {
+    affs_secondary_key k = { key, len };
+    return affs_secondary_or(ix, &k, 1, out);
+}
+
+int affs_secondary_and(affs_secondary *ix, const affs_secondary_key *keys, size_t n, affs_posting *out) {
+    memset(out, 0, sizeof(*out));
+    if (n == 0) return 0;
+    key_entry **ks = (key_entry **)malloc(n * sizeof(key_entry *));
+    const affs_posting **bases = (const affs_posting **)malloc(n * sizeof(affs_posting *));
+    if (!ks || !bases) {
+        free(ks);
+        free(bases);
+        return ENOMEM;
+    }
+    int e = 0;
+    pthread_rwlock_rdlock(&ix->lock);
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        ks[i] = lookup(ix, keys[i].data, keys[i].len, hash_key((const uint8_t *)keys[i].data, keys[i].len));
+        if (!ks[i]) break;
+        bases[i] = &ks[i]->base;
+        found++;
+    }
+    if (found == n) {
+        affs_posting p, t;
+        e = affs_posting_and_many(out, bases, n);
+        if (e == 0) e = pending_matches(ks, n, &p);
+        if (e == 0 && p.cardinality) {
+            e = replace(out, affs_posting_or(&t, out, &p), &t);
+            affs_posting_free(&p);
+        }
+        if (e == 0) e = subtract_removed(ix, out);
+    }
+    pthread_rwlock_unlock(&ix->lock);
+    free(ks);
+    free(bases);
+    if (e != 0) affs_posting_free(out);
+    return e;
+}
+
+int affs_secondary_or(affs_secondary *ix, const affs_secondary_key *keys, size_t n, affs_posting *out) {
+    memset(out, 0, sizeof(*out));
+    if (n == 0) return 0;
+    const affs_posting **lists = (const affs_posting **)malloc(2 * n * sizeof(affs_posting *));
+    affs_posting *pend = (affs_posting *)calloc(n, sizeof(affs_posting));
+    if (!lists || !pend) {
+        free(lists);
+        free(pend);
+        return ENOMEM;
+    }
+    int e = 0;
+    size_t m = 0, np = 0;
+    pthread_rwlock_rdlock(&ix->lock);
+    for (size_t i = 0; e == 0 && i < n; i++) {
+        key_entry *k = lookup(ix, keys[i].data, keys[i].len, hash_key((const uint8_t *)keys[i].data, keys[i].len));
+        if (!k) continue;
+        lists[m++] = &k->base;
+        if (k->pending.n) {
+            e = affs_posting_from_sorted(&pend[np], k->pending.v, k->pending.n);
+            if (e == 0) lists[m++] = &pend[np++];
+        }
+    }
+    if (e == 0) e = affs_posting_or_many(out, lists, m);
+    if (e == 0) e = subtract_removed(ix, out);
+    pthread_rwlock_unlock(&ix->lock);
+    for (size_t i = 0; i < np; i++) affs_posting_free(&pend[i]);
+    free(pend);
+    free(lists);
+    if (e != 0) affs_posting_free(out);
+    return e;
+}
+
+void affs_secondary_stats_get(affs_secondary *ix, affs_secondary_stats *out) {
+    memset(out, 0, sizeof(*out));
+    pthread_rwlock_rdlock(&ix->lock);
+    out->keys = ix->nkeys;
+    out->bytes = ix->nbuckets * sizeof(key_entry *) + affs_posting_bytes(&ix->removed) + ix->rpending.cap * sizeof(uint32_t);
+    for (size_t i = 0; i < ix->nbuckets; i++) {
+        for (key_entry *k = ix->buckets[i]; k; k = k->hnext) {
+            out->merged += k->base.cardinality;
+            out->pending += k->pending.n;
+            out->bytes += sizeof(key_entry) + k->len + affs_posting_bytes(&k->base) + k->pending.cap * sizeof(uint32_t);
+        }
+    }
+    out->removed = ix->removed.cardinality + ix->rpending.n;
+    out->merges = ix->merges;
+    out->purges = ix->purges;
+    pthread_rwlock_unlock(&ix->lock);
+}
@@ -0,0 +1,368 @@
+#define _GNU_SOURCE
+#include "../include/affs_snapshot.h"
+#include "../include/affs_crc32c.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VERSION 1
+#define POSITION_SIZE 16
+#define WRITE_BUFFER (1u << 20)
+
+struct affs_snapshot {
+    const uint8_t *map;
+    size_t size;
+    const uint8_t *positions;
+    const uint8_t *entries;
+    affs_snapshot_info info;
+};
+
+/* ---------- helpers ---------- */
+
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put32(uint8_t *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static inline void put64(uint8_t *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/* Loads from the mapping: plain loads on a little-endian host. */
+static inline uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static inline uint32_t get32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+static inline uint64_t get64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static size_t positions_bytes(uint32_t n) {
+    return ((size_t)n * POSITION_SIZE + 63) / 64 * 64;
+}
+
+static void encode_entry(uint8_t *p, const affs_index_entry *e) {
+    put64(p, e->id.lo);
+    put64(p + 8, e->id.hi);
+    put64(p + 16, e->loc.offset);
+    put64(p + 24, e->loc.length);
+    put64(p + 32, e->sequence);
+    put32(p + 40, (uint32_t)e->loc.segment_id);
+    put32(p + 44, e->loc.flags);
+}
+
+static void decode_entry(const uint8_t *p, affs_index_entry *e) {
+    e->id.lo = get64(p);
+    e->id.hi = get64(p + 8);
+    e->loc.offset = get64(p + 16);
+    e->loc.length = get64(p + 24);
+    e->sequence = get64(p + 32);
+    e->loc.segment_id = get32(p + 40);
+    e->loc.flags = get32(p + 44);
+    e->object_flags = 0;
+}
+
+/* ---------- writing ---------- */
+
+typedef struct out_file {
+    int fd;
+    uint8_t *buf;
+    size_t used;
+    uint64_t at;
+    uint32_t crc;
+    int err;
+} out_file;
+
+/* Everything flushed past the header is body: BodyCrc follows it. */
+static void out_flush(out_file *o) {
+    if (o->at >= AFFS_SNAPSHOT_HEADER_SIZE) o->crc = affs_crc32c(o->crc, o->buf, o->used);
+    size_t done = 0;
+    while (!o->err && done < o->used) {
+        ssize_t n = pwrite(o->fd, o->buf + done, o->used - done, (off_t)(o->at + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) o->err = n < 0 ? errno : EIO;
+        else done += (size_t)n;
+    }
+    o->at += o->used;
+    o->used = 0;
+}
+
+static uint8_t *out_reserve(out_file *o, size_t n) {
+    if (o->used + n > WRITE_BUFFER) out_flush(o);
+    uint8_t *p = o->buf + o->used;
+    o->used += n;
+    return p;
+}
+
+affs_io_result affs_snapshot_write(const char *path, uint64_t checkpoint_id, uint64_t log_position,
+                                   const affs_segment_position *positions, size_t npositions,
+                                   const affs_index_entry *entries, size_t count) {
+    if (!path || (npositions && !positions) || (count && !entries) || npositions > UINT32_MAX) return affs_io_result_from_errno(EINVAL);
+    uint64_t live = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i && affs_object_id_cmp(entries[i - 1].id, entries[i].id) >= 0) return affs_io_result_from_errno(EINVAL);
+        if (entries[i].loc.segment_id > UINT32_MAX) return affs_io_result_from_errno(EINVAL);
+        live += !(entries[i].object_flags & AFFS_OBJECT_TOMBSTONE);
+    }
+    affs_segment_position *pos = (affs_segment_position *)malloc((npositions ? npositions : 1) * sizeof(*pos));
+    if (!pos) return affs_io_result_from_errno(ENOMEM);
+    memcpy(pos, positions, npositions * sizeof(*pos));
+    for (size_t i = 1; i < npositions; i++) {          /* few segments: insertion sort */
+        affs_segment_position p = pos[i];
+        size_t j = i;
+        for (; j && pos[j - 1].segment_id > p.segment_id; j--) pos[j] = pos[j - 1];
+        pos[j] = p;
+    }
+
+    size_t plen = strlen(path);
+    char *tmp = (char *)malloc(plen + 5);
+    out_file o = { -1, (uint8_t *)malloc(WRITE_BUFFER), 0, AFFS_SNAPSHOT_HEADER_SIZE, 0, 0 };
+    if (!tmp || !o.buf) {
+        free(pos);
+        free(tmp);
+        free(o.buf);
+        return affs_io_result_from_errno(ENOMEM);
+    }
+    memcpy(tmp, path, plen);
+    memcpy(tmp + plen, ".tmp", 5);
+    o.fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (o.fd < 0) o.err = errno;
+
+    /* body first, header (with both checksums) last */
+    for (size_t i = 0; i < npositions && !o.err; i++) {
+        uint8_t *p = out_reserve(&o, POSITION_SIZE);
+        put64(p, pos[i].segment_id);
+        put64(p + 8, pos[i].position);
+    }
+    size_t pad = positions_bytes((uint32_t)npositions) - npositions * POSITION_SIZE;
+    if (pad && !o.err) {
+        uint8_t *p = out_reserve(&o, pad);
+        memset(p, 0, pad);
+    }
+    for (size_t i = 0; i < count && !o.err; i++) {
+        if (entries[i].object_flags & AFFS_OBJECT_TOMBSTONE) continue;
+        uint8_t *p = out_reserve(&o, AFFS_SNAPSHOT_ENTRY_SIZE);
+        encode_entry(p, &entries[i]);
+    }
+    out_flush(&o);
+
+    uint8_t h[AFFS_SNAPSHOT_HEADER_SIZE];
+    memset(h, 0, sizeof(h));
+    memcpy(h, "AFIX", 4);
+    put16(h + 4, VERSION);
+    put16(h + 6, AFFS_SNAPSHOT_ENTRY_SIZE);
+    put64(h + 8, checkpoint_id);
+    put64(h + 16, log_position);
+    put64(h + 24, live);
+    put32(h + 32, (uint32_t)npositions);
+    put32(h + 36, o.crc);
+    put32(h + 60, affs_crc32c(0, h, 60));
+    if (!o.err) {
+        o.used = sizeof(h);
+        o.at = 0;
+        memcpy(o.buf, h, sizeof(h));
+        out_flush(&o);
+    }
+    if (!o.err && fsync(o.fd) != 0) o.err = errno;
+    if (o.fd >= 0) close(o.fd);
+    if (!o.err && rename(tmp, path) != 0) o.err = errno;
+    if (!o.err) o.err = affs_backend_sync_parent(path);
+    if (o.err) unlink(tmp);
+
+    affs_io_result r = o.err ? affs_io_result_from_errno(o.err) : affs_io_result_ok();
+    if (!o.err) r.bytes = AFFS_SNAPSHOT_HEADER_SIZE + positions_bytes((uint32_t)npositions) + live * AFFS_SNAPSHOT_ENTRY_SIZE;
+    free(pos);
+    free(tmp);
+    free(o.buf);
+    return r;
+}
+
+/* ---------- reading ---------- */
+
+affs_io_result affs_snapshot_open(affs_snapshot **out, const char *path, uint32_t flags) {
+    if (!out || !path) return affs_io_result_from_errno(EINVAL);
+    *out = NULL;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return affs_io_result_from_errno(errno);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int e = errno;
+        close(fd);
+        return affs_io_result_from_errno(e);
+    }
+    size_t size = (size_t)st.st_size;
+    if (size < AFFS_SNAPSHOT_HEADER_SIZE) {
+        close(fd);
+        return affs_io_result_from_errno(EBADMSG);
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    int e = map == MAP_FAILED ? errno : 0;
+    close(fd);
+    if (e) return affs_io_result_from_errno(e);
+    const uint8_t *h = (const uint8_t *)map;
+
+    affs_snapshot_info info;
+    info.checkpoint_id = get64(h + 8);
+    info.log_position = get64(h + 16);
+    info.count = get64(h + 24);
+    info.segments = get32(h + 32);
+    info.bytes = size;
+    size_t body = positions_bytes(info.segments);
+    int ok = memcmp(h, "AFIX", 4) == 0 && get16(h + 4) == VERSION && get16(h + 6) == AFFS_SNAPSHOT_ENTRY_SIZE &&
+             get32(h + 60) == affs_crc32c(0, h, 60) && info.count <= (size - AFFS_SNAPSHOT_HEADER_SIZE) / AFFS_SNAPSHOT_ENTRY_SIZE &&
+             size == AFFS_SNAPSHOT_HEADER_SIZE + body + info.count * AFFS_SNAPSHOT_ENTRY_SIZE;
+    if (ok && (flags & AFFS_SNAPSHOT_VERIFY)) {
+        madvise(map, size, MADV_SEQUENTIAL);
+        ok = affs_crc32c(0, h + AFFS_SNAPSHOT_HEADER_SIZE, size - AFFS_SNAPSHOT_HEADER_SIZE) == get32(h + 36);
+        madvise(map, size, MADV_RANDOM);
+    }
+    affs_snapshot *s = ok ? (affs_snapshot *)calloc(1, sizeof(affs_snapshot)) : NULL;
+    if (!s) {
+        munmap(map, size);
+        return affs_io_result_from_errno(ok ? ENOMEM : EBADMSG);
+    }
+    s->map = h;
+    s->size = size;
+    s->positions = h + AFFS_SNAPSHOT_HEADER_SIZE;
+    s->entries = s->positions + body;
+    s->info = info;
+    *out = s;
+    affs_io_result r = affs_io_result_ok();
+    r.bytes = size;
+    return r;
+}
+
+void affs_snapshot_close(affs_snapshot *s) {
+    if (!s) return;
+    munmap((void *)s->map, s->size);
+    free(s);
+}
+
+void affs_snapshot_info_get(const affs_snapshot *s, affs_snapshot_info *out) {
+    *out = s->info;
+}
+
+uint64_t affs_snapshot_position(const affs_snapshot *s, uint64_t segment_id) {
+    for (uint32_t i = 0; i < s->info.segments; i++) {
+        const uint8_t *p = s->positions + (size_t)i * POSITION_SIZE;
+        if (get64(p) == segment_id) return get64(p + 8);
+    }
+    return 0;
+}
+
+void affs_snapshot_entry(const affs_snapshot *s, uint64_t i, affs_index_entry *out) {
+    decode_entry(s->entries + i * AFFS_SNAPSHOT_ENTRY_SIZE, out);
+}
+
+int affs_snapshot_find(const affs_snapshot *s, affs_object_id id, affs_index_entry *out) {
+    uint64_t lo = 0, hi = s->info.count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        const uint8_t *p = s->entries + mid * AFFS_SNAPSHOT_ENTRY_SIZE;
+        affs_object_id m = { get64(p), get64(p + 8) };
+        int c = affs_object_id_cmp(m, id);
+        if (c == 0) {
+            decode_entry(p, out);
+            return 1;
+        }
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+/* ---------- recovery ---------- */
+
+affs_io_result affs_snapshot_recover(const affs_snapshot *s, const affs_rebuild_segment *segs, size_t nsegs,
+                                     const affs_rebuild_options *opt, affs_rebuild_result *out) {
+    if (!s || !out || (nsegs && !segs)) return affs_io_result_from_errno(EINVAL);
+    memset(out, 0, sizeof(*out));
+    affs_rebuild_segment *tails = (affs_rebuild_segment *)malloc((nsegs ? nsegs : 1) * sizeof(*tails));
+    if (!tails) return affs_io_result_from_errno(ENOMEM);
+    for (size_t i = 0; i < nsegs; i++) {
+        tails[i] = segs[i];
+        uint64_t p = affs_snapshot_position(s, segs[i].segment_id);
+        if (p > tails[i].start) tails[i].start = p;
+    }
+    affs_rebuild_options o = opt ? *opt : affs_rebuild_options_default();
+    int keep = o.keep_tombstones;
+    o.keep_tombstones = 1;      /* a tail tombstone must still hide the snapshot's entry */
+    affs_rebuild_result tail;
+    affs_io_result r = affs_rebuild(tails, nsegs, &o, &tail);
+    free(tails);
+    if (r.category != AFFS_IO_OK) {
+        out->stats = tail.stats;
+        return r;
+    }
+
+    uint64_t t0 = affs_io_now_ns();
+    size_t cap = (size_t)s->info.count + tail.count;
+    affs_index_entry *e = (affs_index_entry *)malloc((cap ? cap : 1) * sizeof(affs_index_entry));
+    if (!e) {
+        out->stats = tail.stats;
+        affs_rebuild_result_free(&tail);
+        return affs_io_result_from_errno(ENOMEM);
+    }
+    madvise((void *)s->map, s->size, MADV_SEQUENTIAL);
+    uint64_t i = 0, replaced = 0;
+    size_t j = 0, n = 0;
+    while (i < s->info.count || j < tail.count) {
+        affs_index_entry a;
+        if (i < s->info.count) affs_snapshot_entry(s, i, &a);
+        int c = i == s->info.count ? 1 : j == tail.count ? -1 : affs_object_id_cmp(a.id, tail.entries[j].id);
+        const affs_index_entry *pick;
+        if (c < 0) {
+            pick = &a;
+            i++;
+        } else if (c > 0) {
+            pick = &tail.entries[j++];
+        } else {
+            pick = tail.entries[j].sequence >= a.sequence ? &tail.entries[j] : &a;
+            replaced++;
+            i++;
+            j++;
+        }
+        if (!(pick->object_flags & AFFS_OBJECT_TOMBSTONE) || keep) e[n++] = *pick;
+    }
+    madvise((void *)s->map, s->size, MADV_RANDOM);
+    affs_rebuild_result_free(&tail);
+
+    if (n == 0) {
+        free(e);
+        e = NULL;
+    } else if (n < cap) {
+        affs_index_entry *shrunk = (affs_index_entry *)realloc(e, n * sizeof(affs_index_entry));
+        if (shrunk) e = shrunk;
+    }
+    out->entries = e;
+    out->count = n;
+    out->stats = tail.stats;
+    out->stats.superseded += replaced;
+    out->stats.merge_ns += affs_io_now_ns() - t0;
+    return affs_io_result_ok();
+}
@@ -0,0 +1,257 @@
+#define _GNU_SOURCE
+#include "../include/affs_append.h"
+#include "../include/affs_crc32c.h"
+#include "test_common.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static const char *k_path = "affs_append_test.store";
+
+#define WRITERS 8
+#define PER_WRITER 500
+
+static affs_backend *open_store(int flags, int fresh) {
+    if (fresh) remove(k_path);
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = flags;
+    affs_backend *b = NULL;
+    affs_io_result r = affs_backend_open(&b, k_path, &o);
+    TEST_ASSERT(r.category == AFFS_IO_OK && b, "open backend");
+    return b;
+}
+
+/* Payload of record `seq` of writer `w`: its identity, then filler. */
+static size_t make_payload(uint8_t *p, int w, int seq) {
+    size_t len = 8 + (size_t)((w * 131 + seq * 17) % 300);
+    memcpy(p, &w, 4);
+    memcpy(p + 4, &seq, 4);
+    for (size_t i = 8; i < len; i++) p[i] = (uint8_t)(w + seq + i);
+    return len;
+}
+
+/* Read [0, size) back and check every record: valid, back to back, each writer in order. */
+static int scan_store(affs_backend *b, uint64_t size, uint32_t align, int writers, int per_writer) {
+    void *mem = NULL;
+    posix_memalign(&mem, 4096, (size_t)size);   /* O_DIRECT reads want aligned buffers */
+    uint8_t *data = (uint8_t *)mem;
+    affs_io_result r = affs_backend_read(b, 0, data, (size_t)size);
+    int ok = r.category == AFFS_IO_OK && r.bytes == size;
+    int *next = (int *)calloc((size_t)writers, sizeof(int));
+    uint64_t at = 0;
+    int count = 0;
+    while (ok && at < size) {
+        affs_record_header h;
+        uint64_t framed = 0;
+        if (affs_record_check(data + at, (size_t)(size - at), align, &h, &framed) != AFFS_RECORD_OK) {
+            ok = 0;
+            break;
+        }
+        int w, seq;
+        memcpy(&w, data + at + AFFS_RECORD_HEADER_SIZE, 4);
+        memcpy(&seq, data + at + AFFS_RECORD_HEADER_SIZE + 4, 4);
+        uint8_t expect[512];
+        size_t len = make_payload(expect, w, seq);
+        ok = w >= 0 && w < writers && seq == next[w]++ && h.kind == AFFS_KIND_LOG && h.payload_length == len &&
+             memcmp(expect, data + at + AFFS_RECORD_HEADER_SIZE, len) == 0 && framed % align == 0;
+        at += framed;
+        count++;
+    }
+    ok &= at == size && count == writers * per_writer;
+    free(next);
+    free(data);
+    return ok;
+}
+
+typedef struct writer_job {
+    affs_appender *a;
+    int w;
+    int ok;
+} writer_job;
+
+static void *writer_run(void *arg) {
+    writer_job *j = (writer_job *)arg;
+    affs_record_header h = { AFFS_KIND_LOG, 0, 0, 0, 0, 0 };
+    uint8_t p[512];
+    j->ok = 1;
+    for (int s = 0; s < PER_WRITER; s++) {
+        size_t len = make_payload(p, j->w, s);
+        uint64_t off;
+        affs_io_result r = affs_append(j->a, &h, p, len, &off);
+        j->ok &= r.category == AFFS_IO_OK && r.bytes == affs_record_framed_size(len, 64) && off % 64 == 0;
+    }
+    return NULL;
+}
+
+static void concurrent(uint32_t window_us, const char *name) {
+    affs_backend *b = open_store(AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE, 1);
+    affs_append_options o = affs_append_options_default();
+    o.align = 64;
+    o.window_us = window_us;
+    affs_appender *a;
+    TEST_ASSERT(affs_appender_open(&a, b, 0, &o).category == AFFS_IO_OK, "open appender");
+
+    writer_job jobs[WRITERS];
+    pthread_t th[WRITERS];
+    for (int i = 0; i < WRITERS; i++) {
+        jobs[i].a = a;
+        jobs[i].w = i;
+        pthread_create(&th[i], NULL, writer_run, &jobs[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < WRITERS; i++) {
+        pthread_join(th[i], NULL);
+        ok &= jobs[i].ok;
+    }
+    TEST_ASSERT(ok, "every append durable");
+
+    affs_append_stats s;
+    affs_appender_stats_get(a, &s);
+    uint64_t tail = affs_appender_tail(a);
+    TEST_ASSERT(s.records == WRITERS * PER_WRITER && s.waited == s.records && s.bytes == tail, "stats count every record");
+    TEST_ASSERT(s.commits < s.records && s.max_commit_records > 1, "records share commits");
+    uint64_t hist = 0;
+    for (int i = 0; i < AFFS_APPEND_HIST_BUCKETS; i++) hist += s.latency_hist[i];
+    TEST_ASSERT(hist == s.waited && affs_append_stats_quantile_us(&s, 0.5) <= affs_append_stats_quantile_us(&s, 0.99),
+                "latency histogram");
+    TEST_ASSERT(affs_appender_close(a).category == AFFS_IO_OK, "close");
+    TEST_ASSERT(scan_store(b, tail, 64, WRITERS, PER_WRITER), "records valid, contiguous, in writer order");
+    affs_backend_close(b);
+    g_checks += 6;
+    printf("[PASS] concurrent appends (%s): %llu records in %llu commits\n", name, (unsigned long long)s.records,
+           (unsigned long long)s.commits);
+}
+
+/* submit without waiting; small batches force several commits; sync covers them all */
+static void pipelined(void) {
+    affs_backend *b = open_store(AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE, 1);
+    affs_append_options o = affs_append_options_default();
+    o.align = 64;
+    o.max_batch_bytes = 4096;
+    o.max_batch_records = 10;
+    affs_appender *a;
+    affs_appender_open(&a, b, 0, &o);
+    affs_record_header h = { AFFS_KIND_LOG, 0, 0, 0, 0, 0 };
+    uint8_t p[512];
+    affs_append_ticket t[PER_WRITER];
+    int ok = 1;
+    for (int s = 0; s < PER_WRITER; s++) {
+        size_t len = make_payload(p, 0, s);
+        ok &= affs_append_submit(a, &h, p, len, &t[s]).category == AFFS_IO_OK;
+        ok &= s == 0 || (t[s].offset == t[s - 1].offset + t[s - 1].framed_length && t[s].commit >= t[s - 1].commit);
+    }
+    TEST_ASSERT(ok, "tickets contiguous, commits ordered");
+    TEST_ASSERT(affs_appender_sync(a).category == AFFS_IO_OK, "sync");
+    TEST_ASSERT(affs_append_wait(a, &t[PER_WRITER - 1]).category == AFFS_IO_OK, "wait after sync returns at once");
+
+    /* a record larger than the batch limit goes alone */
+    uint8_t *big = (uint8_t *)calloc(1, 10000);
+    uint64_t off;
+    TEST_ASSERT(affs_append(a, &h, big, 10000, &off).category == AFFS_IO_OK && off == t[PER_WRITER - 1].offset + t[PER_WRITER - 1].framed_length,
+                "oversized record");
+    free(big);
+
+    affs_append_stats s;
+    affs_appender_stats_get(a, &s);
+    TEST_ASSERT(s.max_commit_records <= 10 && s.commits >= PER_WRITER / 10, "batch limits close commits");
+    affs_appender_close(a);
+    affs_backend_close(b);
+    g_checks += 5;
+    printf("[PASS] pipelined submits\n");
+}
+
+/* 4 KiB records through O_DIRECT (page cache where unsupported) */
+static void direct(void) {
+    affs_backend *b = open_store(AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE | AFFS_BACKEND_DIRECT, 1);
+    affs_geometry g;
+    affs_backend_geometry(b, &g);
+    affs_append_options o = affs_append_options_default();
+    o.align = 4096;
+    affs_appender *a;
+    TEST_ASSERT(affs_appender_open(&a, b, 100, &o).category != AFFS_IO_OK, "unaligned tail rejected");
+    o.align = g.write_align > 1 ? g.write_align / 2 : 0;
+    if (o.align) TEST_ASSERT(affs_appender_open(&a, b, 0, &o).category != AFFS_IO_OK, "alignment below the device's rejected");
+    o.align = 4096;
+    TEST_ASSERT(affs_appender_open(&a, b, 0, &o).category == AFFS_IO_OK, "open aligned");
+    affs_record_header h = { AFFS_KIND_LOG, 0, 0, 0, 0, 0 };
+    uint8_t p[512];
+    int ok = 1;
+    for (int s = 0; s < 50; s++) {
+        size_t len = make_payload(p, 0, s);
+        uint64_t off;
+        ok &= affs_append(a, &h, p, len, &off).category == AFFS_IO_OK && off == (uint64_t)s * 4096;
+    }
+    TEST_ASSERT(ok && affs_appender_close(a).category == AFFS_IO_OK, "direct appends");
+    TEST_ASSERT(scan_store(b, 50 * 4096, 4096, 1, 50), "direct records valid");
+    affs_backend_close(b);
+    g_checks += 5;
+    printf("[PASS] aligned appends (%s)\n", g.direct ? "O_DIRECT" : "page cache");
+}
+
+/* a failed commit fails its waiters and everything after it */
+static void failure(void) {
+    affs_backend *b = open_store(AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE, 1);
+    affs_backend_close(b);
+    b = open_store(0, 0);     /* read-only: every commit write fails */
+    affs_appender *a;
+    affs_appender_open(&a, b, 0, NULL);
+    affs_record_header h = { AFFS_KIND_LOG, 0, 0, 0, 0, 0 };
+    affs_io_result r = affs_append(a, &h, "x", 1, NULL);
+    TEST_ASSERT(r.category != AFFS_IO_OK && r.os_error != 0, "failed commit reported to its writer");
+    r = affs_append(a, &h, "y", 1, NULL);
+    TEST_ASSERT(r.category != AFFS_IO_OK, "later appends fail too");
+    TEST_ASSERT(affs_appender_sync(a).category != AFFS_IO_OK && affs_appender_close(a).category != AFFS_IO_OK,
+                "sync and close report the failure");
+    affs_backend_close(b);
+    g_checks += 3;
+    printf("[PASS] commit failure\n");
+}
+
+int main(void) {
+    /* CRC32C check value (RFC 3720) and streaming */
+    TEST_ASSERT(affs_crc32c(0, "123456789", 9) == 0xE3069283u, "crc32c check value");
+    TEST_ASSERT(affs_crc32c(affs_crc32c(0, "1234", 4), "56789", 5) == 0xE3069283u, "crc32c streams");
+    g_checks += 2;
+
+    /* framing */
+    {
+        uint8_t buf[256];
+        affs_record_header h = { AFFS_KIND_BLOB, 3, 2, 0x0102, 0, 0 };
+        size_t n = affs_record_frame(buf, &h, "payload", 7, 64);
+        affs_record_header back;
+        uint64_t framed;
+        TEST_ASSERT(n == 64 && h.payload_length == 7 && memcmp(buf, "AFR1", 4) == 0 && buf[4] == 1, "frame layout");
+        TEST_ASSERT(affs_record_check(buf, n, 64, &back, &framed) == AFFS_RECORD_OK && framed == 64 && back.kind == AFFS_KIND_BLOB &&
+                        back.size_class == 3 && back.access_profile == 2 && back.flags == 0x0102 && back.checksum == h.checksum,
+                    "frame round trip");
+        buf[25] ^= 1;
+        TEST_ASSERT(affs_record_check(buf, n, 64, NULL, NULL) == AFFS_RECORD_BAD_CHECKSUM, "payload damage detected");
+        buf[25] ^= 1;
+        buf[9] ^= 1;
+        TEST_ASSERT(affs_record_check(buf, n, 64, NULL, NULL) == AFFS_RECORD_BAD_CHECKSUM, "header damage detected");
+        buf[9] ^= 1;
+        TEST_ASSERT(affs_record_check(buf, 25, 64, NULL, NULL) == AFFS_RECORD_TRUNCATED &&
+                        affs_record_check(buf, 10, 64, NULL, NULL) == AFFS_RECORD_TRUNCATED,
+                    "truncation detected");
+        buf[0] = 'X';
+        TEST_ASSERT(affs_record_check(buf, n, 64, NULL, NULL) == AFFS_RECORD_BAD_MAGIC, "magic checked");
+        TEST_ASSERT(affs_record_framed_size(UINT64_MAX - 10, 64) == 0 && affs_record_framed_size(0, 0) == AFFS_RECORD_HEADER_SIZE,
+                    "framed size bounds");
+        g_checks += 7;
+        printf("[PASS] record framing\n");
+    }
+
+    concurrent(0, "no window");
+    concurrent(200, "200 us window");
+    pipelined();
+    direct();
+    failure();
+
+    remove(k_path);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
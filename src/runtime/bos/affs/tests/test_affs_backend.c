@@ -0,0 +1,294 @@
+#include "../include/affs_backend.h"
+#include "../include/affs_buffer.h"
+#include "test_common.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static const char *k_path = "affs_backend_test.store";
+
+#define BLOCK 65536
+#define BLOCKS 64
+
+static uint8_t pattern(uint64_t at) {
+    return (uint8_t)((at * 2654435761u) >> 13);
+}
+
+static void fill(uint8_t *p, uint64_t at, size_t len) {
+    for (size_t i = 0; i < len; i++) p[i] = pattern(at + i);
+}
+
+static int same(const uint8_t *p, uint64_t at, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] != pattern(at + i)) return 0;
+    }
+    return 1;
+}
+
+/* Batched writes in shuffled order, a barrier, batched reads back. */
+static void round_trip(affs_io_engine engine, const char *name) {
+    remove(k_path);
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_CREATE;
+    o.engine = engine;
+    o.queue_depth = 16;
+    affs_backend *b;
+    affs_io_result r = affs_backend_open(&b, k_path, &o);
+    TEST_ASSERT(r.category == AFFS_IO_OK && b, "open");
+    TEST_ASSERT(affs_backend_engine(b) == engine, "engine as requested");
+
+    uint8_t *data = (uint8_t *)malloc((size_t)BLOCK * BLOCKS);
+    affs_io_request reqs[BLOCKS];
+    for (int i = 0; i < BLOCKS; i++) {
+        int k = (i * 37) % BLOCKS;   /* 37 is coprime with 64: a permutation */
+        uint8_t *p = data + (size_t)k * BLOCK;
+        fill(p, (uint64_t)k * BLOCK, BLOCK);
+        reqs[i].op = AFFS_OP_WRITE;
+        reqs[i].buffer = p;
+        reqs[i].offset = (uint64_t)k * BLOCK;
+        reqs[i].length = BLOCK;
+    }
+    r = affs_backend_submit(b, reqs, BLOCKS);
+    int each = 1;
+    for (int i = 0; i < BLOCKS; i++) each &= reqs[i].result.category == AFFS_IO_OK && reqs[i].result.bytes == BLOCK;
+    TEST_ASSERT(r.category == AFFS_IO_OK && r.bytes == (uint64_t)BLOCK * BLOCKS && each, "batched writes");
+    TEST_ASSERT(affs_backend_flush(b).category == AFFS_IO_OK, "flush");
+
+    affs_geometry g;
+    TEST_ASSERT(affs_backend_geometry(b, &g).category == AFFS_IO_OK && g.size == (uint64_t)BLOCK * BLOCKS, "size");
+
+    /* read back in 4 KiB pieces, one extra request straddling the end */
+    memset(data, 0, (size_t)BLOCK * BLOCKS);
+    size_t n = (size_t)BLOCK * BLOCKS / 4096;
+    affs_io_request *rd = (affs_io_request *)calloc(n + 2, sizeof(affs_io_request));
+    for (size_t i = 0; i < n; i++) {
+        rd[i].op = AFFS_OP_READ;
+        rd[i].buffer = data + i * 4096;
+        rd[i].offset = i * 4096;
+        rd[i].length = 4096;
+    }
+    uint8_t tail[8192];
+    rd[n].op = AFFS_OP_READ;
+    rd[n].buffer = tail;
+    rd[n].offset = (uint64_t)BLOCK * BLOCKS - 100;
+    rd[n].length = sizeof(tail);
+    rd[n + 1] = rd[n];
+    rd[n + 1].offset = (uint64_t)BLOCK * BLOCKS + 4096;
+    r = affs_backend_submit(b, rd, n + 2);
+    TEST_ASSERT(r.category == AFFS_IO_OK && same(data, 0, (size_t)BLOCK * BLOCKS), "batched reads");
+    TEST_ASSERT(rd[n].result.category == AFFS_IO_OK && rd[n].result.bytes == 100 && same(tail, rd[n].offset, 100),
+                "read at the end of file is Ok and short");
+    TEST_ASSERT(rd[n + 1].result.category == AFFS_IO_OK && rd[n + 1].result.bytes == 0, "read past the end");
+
+    /* one bad request fails alone */
+    rd[3].buffer = NULL;
+    r = affs_backend_submit(b, rd, 8);
+    int others = 1;
+    for (int i = 0; i < 8; i++) others &= i == 3 || (rd[i].result.category == AFFS_IO_OK && rd[i].result.bytes == 4096);
+    TEST_ASSERT(r.category == AFFS_IO_PERMANENT && r.os_error == EFAULT && rd[3].result.category == AFFS_IO_PERMANENT &&
+                    rd[3].result.bytes == 0 && others,
+                "failed request reported on its own");
+
+    affs_backend_stats st;
+    affs_backend_stats_get(b, &st);
+    TEST_ASSERT(st.writes == BLOCKS && st.write_bytes == (uint64_t)BLOCK * BLOCKS && st.flushes == 1 && st.read_errors == 1 &&
+                    st.last_error_ns != 0,
+                "stats");
+
+    free(rd);
+    free(data);
+    affs_backend_close(b);
+    g_checks += 10;
+    printf("[PASS] round trip (%s)\n", name);
+}
+
+typedef struct job {
+    affs_backend *b;
+    int id;
+    int ok;
+} job;
+
+static void *job_run(void *arg) {
+    job *j = (job *)arg;
+    uint8_t buf[16][4096];
+    affs_io_request reqs[16];
+    j->ok = 1;
+    for (int round = 0; round < 50; round++) {
+        for (int i = 0; i < 16; i++) {
+            uint64_t at = ((uint64_t)(j->id * 16 + i) * 4096);
+            fill(buf[i], at + (uint64_t)round, 4096);
+            reqs[i].op = AFFS_OP_WRITE;
+            reqs[i].buffer = buf[i];
+            reqs[i].offset = at;
+            reqs[i].length = 4096;
+        }
+        j->ok &= affs_backend_submit(j->b, reqs, 16).category == AFFS_IO_OK;
+        for (int i = 0; i < 16; i++) {
+            memset(buf[i], 0, 4096);
+            reqs[i].op = AFFS_OP_READ;
+        }
+        j->ok &= affs_backend_submit(j->b, reqs, 16).category == AFFS_IO_OK;
+        for (int i = 0; i < 16; i++) j->ok &= same(buf[i], reqs[i].offset + (uint64_t)round, 4096);
+    }
+    return NULL;
+}
+
+static void concurrent(affs_io_engine engine, const char *name) {
+    remove(k_path);
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_CREATE;
+    o.engine = engine;
+    affs_backend *b;
+    TEST_ASSERT(affs_backend_open(&b, k_path, &o).category == AFFS_IO_OK, "open");
+    job jobs[6];
+    pthread_t th[6];
+    for (int i = 0; i < 6; i++) {
+        jobs[i].b = b;
+        jobs[i].id = i;
+        pthread_create(&th[i], NULL, job_run, &jobs[i]);
+    }
+    int ok = 1;
+    for (int i = 0; i < 6; i++) {
+        pthread_join(th[i], NULL);
+        ok &= jobs[i].ok;
+    }
+    TEST_ASSERT(ok, "concurrent batches on one backend");
+    affs_backend_close(b);
+    g_checks += 1;
+    printf("[PASS] concurrent submitters (%s)\n", name);
+}
+
+static void direct_io(void) {
+    remove(k_path);
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_CREATE | AFFS_BACKEND_DIRECT;
+    affs_backend *b;
+    TEST_ASSERT(affs_backend_open(&b, k_path, &o).category == AFFS_IO_OK, "open O_DIRECT (or its fallback)");
+    affs_geometry g;
+    affs_backend_geometry(b, &g);
+    if (g.direct) {
+        TEST_ASSERT(g.write_align >= 512 && (g.write_align & (g.write_align - 1)) == 0 && g.mem_align >= 1, "direct alignment");
+    } else {
+        TEST_ASSERT(g.write_align == 1 && g.mem_align == 1, "page-cache fallback");
+    }
+
+    affs_buffer_pool pool;
+    size_t align = g.mem_align > 64 ? g.mem_align : 64;
+    size_t unit = g.write_align > 4096 ? g.write_align : 4096;
+    TEST_ASSERT(affs_buffer_pool_init(&pool, 8, unit, align) == 0, "buffer pool");
+    affs_io_request reqs[8];
+    for (int i = 0; i < 8; i++) {
+        uint8_t *p = (uint8_t *)affs_buffer_acquire(&pool);
+        TEST_ASSERT(p && ((uintptr_t)p % align) == 0, "aligned buffer");
+        fill(p, (uint64_t)i * unit, unit);
+        reqs[i].op = AFFS_OP_WRITE;
+        reqs[i].buffer = p;
+        reqs[i].offset = (uint64_t)i * unit;
+        reqs[i].length = unit;
+    }
+    TEST_ASSERT(affs_buffer_acquire(&pool) == NULL, "pool exhausted");
+    TEST_ASSERT(affs_backend_submit(b, reqs, 8).category == AFFS_IO_OK, "aligned writes");
+    for (int i = 0; i < 8; i++) {
+        memset(reqs[i].buffer, 0, unit);
+        reqs[i].op = AFFS_OP_READ;
+    }
+    int ok = affs_backend_submit(b, reqs, 8).category == AFFS_IO_OK;
+    for (int i = 0; i < 8; i++) {
+        ok &= same((const uint8_t *)reqs[i].buffer, reqs[i].offset, unit);
+        affs_buffer_release(&pool, reqs[i].buffer);
+    }
+    TEST_ASSERT(ok, "aligned reads");
+    TEST_ASSERT(affs_buffer_acquire(&pool) != NULL, "released buffers come back");
+    affs_buffer_pool_destroy(&pool);
+    affs_backend_close(b);
+    g_checks += 7;
+    printf("[PASS] direct I/O (%s)\n", g.direct ? "O_DIRECT" : "not supported here, page cache");
+}
+
+typedef struct pool_job {
+    affs_buffer_pool *pool;
+    int ok;
+} pool_job;
+
+static void *pool_run(void *arg) {
+    pool_job *j = (pool_job *)arg;
+    j->ok = 1;
+    for (int i = 0; i < 100000; i++) {
+        uint8_t *p = (uint8_t *)affs_buffer_acquire(j->pool);
+        if (!p) continue;
+        p[0] = (uint8_t)i;      /* exclusive while held */
+        p[1] = (uint8_t)~i;
+        j->ok &= p[0] == (uint8_t)i && p[1] == (uint8_t)~i;
+        affs_buffer_release(j->pool, p);
+    }
+    return NULL;
+}
+
+int main(void) {
+    round_trip(AFFS_ENGINE_THREADS, "threads");
+    affs_backend_options probe = affs_backend_options_default();
+    probe.flags = AFFS_BACKEND_CREATE;
+    probe.engine = AFFS_ENGINE_URING;
+    affs_backend *b;
+    if (affs_backend_open(&b, k_path, &probe).category == AFFS_IO_OK) {
+        affs_backend_close(b);
+        round_trip(AFFS_ENGINE_URING, "io_uring");
+        concurrent(AFFS_ENGINE_URING, "io_uring");
+    } else {
+        printf("[SKIP] io_uring not available\n");
+    }
+    concurrent(AFFS_ENGINE_THREADS, "threads");
+    direct_io();
+
+    /* outcomes */
+    affs_io_result r = affs_backend_open(&b, "does/not/exist.store", NULL);
+    TEST_ASSERT(r.category == AFFS_IO_PERMANENT && r.os_error == ENOENT && b == NULL, "missing store");
+    TEST_ASSERT(affs_backend_open(&b, k_path, NULL).category == AFFS_IO_OK, "read-only open");
+    uint8_t x = 1;
+    r = affs_backend_write(b, 0, &x, 1);
+    TEST_ASSERT(r.category == AFFS_IO_PERMANENT && r.os_error == EBADF && r.bytes == 0 && r.attempts == 1, "write to a read-only backend");
+    affs_backend_close(b);
+    TEST_ASSERT(affs_io_category_from_errno(ENOSPC) == AFFS_IO_OUT_OF_SPACE && affs_io_category_from_errno(EACCES) == AFFS_IO_ACCESS_DENIED &&
+                    affs_io_category_from_errno(EAGAIN) == AFFS_IO_TRANSIENT && affs_io_category_from_errno(ETIMEDOUT) == AFFS_IO_TIMEOUT &&
+                    affs_io_category_from_errno(EIO) == AFFS_IO_PERMANENT,
+                "errno categories");
+    TEST_ASSERT(affs_io_retryable(AFFS_IO_TRANSIENT) && !affs_io_retryable(AFFS_IO_PARTIAL) &&
+                    strcmp(affs_io_category_name(AFFS_IO_OUT_OF_SPACE), "OutOfSpace") == 0,
+                "retry hints and names");
+    g_checks += 5;
+    printf("[PASS] outcomes\n");
+
+    /* buffer pool under contention */
+    {
+        affs_buffer_pool pool;
+        TEST_ASSERT(affs_buffer_pool_init(&pool, 3, 100, 4096) == 0 && pool.size == 4096, "pool rounds sizes up");
+        affs_buffer_pool_destroy(&pool);
+        TEST_ASSERT(affs_buffer_pool_init(&pool, 3, 100, 3000) == EINVAL, "alignment must be a power of two");
+        affs_buffer_pool_init(&pool, 3, 64, 64);
+        pool_job jobs[4];
+        pthread_t th[4];
+        for (int i = 0; i < 4; i++) {
+            jobs[i].pool = &pool;
+            pthread_create(&th[i], NULL, pool_run, &jobs[i]);
+        }
+        int ok = 1;
+        for (int i = 0; i < 4; i++) {
+            pthread_join(th[i], NULL);
+            ok &= jobs[i].ok;
+        }
+        int held = 0;
+        while (affs_buffer_acquire(&pool)) held++;
+        TEST_ASSERT(ok && held == 3, "no buffer lost or shared");
+        affs_buffer_pool_destroy(&pool);
+        g_checks += 3;
+        printf("[PASS] buffer pool\n");
+    }
+
+    remove(k_path);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include "../include/affs_cache.h"
+#include "test_common.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static const char *k_path = "affs_cache_test.store";
+
+#define BLOCK (64u * 1024)
+#define FILE_BLOCKS 1000
+#define FILE_TAIL 1000          /* the last block is short */
+#define FILE_SIZE ((uint64_t)(FILE_BLOCKS - 1) * BLOCK + FILE_TAIL)
+#define THREADS 8
+
+static uint8_t byte_at(uint64_t x, uint8_t gen) {
+    return (uint8_t)(((x * 2654435761u) >> 11) + gen);
+}
+
+static void fill(uint8_t *p, uint64_t offset, size_t n, uint8_t gen) {
+    for (size_t i = 0; i < n; i++) p[i] = byte_at(offset + i, gen);
+}
+
+static int check(const uint8_t *p, uint64_t offset, size_t n, uint8_t gen) {
+    for (size_t i = 0; i < n; i++) {
+        if (p[i] != byte_at(offset + i, gen)) return 0;
+    }
+    return 1;
+}
+
+static affs_backend *make_store(void) {
+    remove(k_path);
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE;
+    affs_backend *b;
+    TEST_ASSERT(affs_backend_open(&b, k_path, &o).category == AFFS_IO_OK, "open store");
+    uint8_t *buf = (uint8_t *)malloc(1 << 20);
+    for (uint64_t at = 0; at < FILE_SIZE; at += 1 << 20) {
+        size_t n = FILE_SIZE - at < (1 << 20) ? (size_t)(FILE_SIZE - at) : (1 << 20);
+        fill(buf, at, n, 0);
+        affs_backend_write(b, at, buf, n);
+    }
+    free(buf);
+    return b;
+}
+
+static affs_cache *make_cache(size_t blocks, unsigned shards) {
+    affs_cache_options o = affs_cache_options_default();
+    o.capacity = blocks * BLOCK;
+    o.block_size = BLOCK;
+    o.shards = shards;
+    affs_cache *c;
+    TEST_ASSERT(affs_cache_create(&c, &o) == 0, "create cache");
+    return c;
+}
+
+/* Read whole block k with a profile; 1 if the data is right. */
+static int read_block(affs_cache *c, affs_backend *b, uint64_t k, uint8_t profile) {
+    static uint8_t buf[BLOCK];
+    affs_io_result r = affs_cache_read(c, b, k * BLOCK, buf, BLOCK, profile);
+    size_t expect = k == FILE_BLOCKS - 1 ? FILE_TAIL : BLOCK;
+    return r.category == AFFS_IO_OK && r.bytes == expect && check(buf, k * BLOCK, expect, 0);
+}
+
+/* ---------- correctness ---------- */
+
+static void test_reads(affs_backend *b) {
+    affs_cache *c = make_cache(32, 4);
+    uint8_t *buf = (uint8_t *)malloc(600 * 1024);
+    uint64_t x = 12345;
+    int ok = 1;
+    for (int i = 0; i < 3000; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t off = (x >> 20) % (FILE_SIZE + 5000);
+        size_t len = (size_t)((x >> 8) % (i % 10 == 0 ? 600 * 1024 : 9000)) + 1;
+        uint8_t profile = (uint8_t)(i % AFFS_PROFILE_COUNT);
+        affs_io_result r = affs_cache_read(c, b, off, buf, len, profile);
+        uint64_t expect = off >= FILE_SIZE ? 0 : (off + len > FILE_SIZE ? FILE_SIZE - off : len);
+        ok &= r.category == AFFS_IO_OK && r.bytes == expect && check(buf, off, (size_t)expect, 0);
+    }
+    TEST_ASSERT(ok, "random reads of every profile return the file's bytes, short at end of file");
+    TEST_ASSERT(affs_cache_resident(c) <= 32 * BLOCK, "resident bytes bounded by capacity");
+    g_checks += 2;
+    free(buf);
+    affs_cache_destroy(c);
+    printf("[PASS] random reads\n");
+}
+
+/* ---------- policy ---------- */
+
+static void test_scan_resistance(affs_backend *b) {
+    enum { HOT = 20 };
+    affs_cache *c = make_cache(64, 1);
+    affs_cache_stats st, bulk;
+    int ok = 1;
+
+    /* a hot set, read a few times: it settles in the main FIFO */
+    for (int round = 0; round < 3; round++) {
+        for (uint64_t k = 0; k < HOT; k++) ok &= read_block(c, b, k * 7, AFFS_PROFILE_POINT_LOOKUP);
+    }
+    /* a one-time sweep of point-lookup blocks, eight times the cache */
+    for (uint64_t k = 200; k < 200 + 8 * 64; k++) ok &= read_block(c, b, k, AFFS_PROFILE_POINT_LOOKUP);
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    uint64_t hits0 = st.hits;
+    for (uint64_t k = 0; k < HOT; k++) ok &= read_block(c, b, k * 7, AFFS_PROFILE_POINT_LOOKUP);
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    TEST_ASSERT(ok && st.hits - hits0 == HOT, "the hot set survives a one-time sweep (S3-FIFO)");
+    TEST_ASSERT(st.promotions >= HOT && st.evictions >= 8 * 64 - 64, "sweep blocks left through the small FIFO");
+
+    /* a bulk scan of the whole file: no inserts, hot set intact */
+    size_t resident = affs_cache_resident(c);
+    for (uint64_t k = 0; k < FILE_BLOCKS; k++) ok &= read_block(c, b, k, AFFS_PROFILE_BULK_SCAN);
+    affs_cache_stats_get(c, AFFS_PROFILE_BULK_SCAN, &bulk);
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    hits0 = st.hits;
+    for (uint64_t k = 0; k < HOT; k++) ok &= read_block(c, b, k * 7, AFFS_PROFILE_POINT_LOOKUP);
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    TEST_ASSERT(ok && bulk.inserts == 0 && bulk.hits >= HOT && bulk.bypass_bytes > 0 && affs_cache_resident(c) == resident,
+                "bulk scans bypass the cache and use what it holds");
+    TEST_ASSERT(st.hits - hits0 == HOT, "the hot set survives a bulk scan");
+
+    /* a ghost: evicted from the small FIFO, read again -> main */
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    uint64_t ghosts0 = st.ghost_hits;
+    ok &= read_block(c, b, 650, AFFS_PROFILE_POINT_LOOKUP);   /* evicted late in the sweep */
+    affs_cache_stats_get(c, AFFS_PROFILE_POINT_LOOKUP, &st);
+    TEST_ASSERT(ok && st.ghost_hits == ghosts0 + 1, "a recently evicted block comes back as a ghost hit");
+    g_checks += 5;
+    affs_cache_destroy(c);
+    printf("[PASS] scan resistance: hot set kept through sweep and bulk scan\n");
+}
+
+static void test_readahead(affs_backend *b) {
+    affs_cache *c = make_cache(64, 2);
+    uint8_t buf[4096];
+    int ok = 1;
+    for (uint64_t at = 0; at < 40 * BLOCK; at += sizeof(buf)) {
+        affs_io_result r = affs_cache_read(c, b, at, buf, sizeof(buf), AFFS_PROFILE_RANGE_SCAN);
+        ok &= r.category == AFFS_IO_OK && check(buf, at, sizeof(buf), 0);
+    }
+    affs_cache_stats st;
+    affs_cache_stats_get(c, AFFS_PROFILE_RANGE_SCAN, &st);
+    TEST_ASSERT(ok && st.misses == 8 && st.readahead == 32, "range scans read 4 blocks ahead per miss");
+    TEST_ASSERT(st.promotions == 0, "reading through a block is one access");
+    g_checks += 2;
+    affs_cache_destroy(c);
+    printf("[PASS] range-scan read-ahead\n");
+}
+
+static void test_invalidate(affs_backend *b) {
+    affs_cache *c = make_cache(16, 1);
+    uint8_t buf[BLOCK];
+    int ok = read_block(c, b, 3, AFFS_PROFILE_POINT_LOOKUP);
+    fill(buf, 3 * BLOCK + 100, 500, 9);
+    affs_backend_write(b, 3 * BLOCK + 100, buf, 500);
+    affs_cache_invalidate(c, b, 3 * BLOCK + 100, 500);
+    affs_cache_read(c, b, 3 * BLOCK + 100, buf, 500, AFFS_PROFILE_POINT_LOOKUP);
+    ok &= check(buf, 3 * BLOCK + 100, 500, 9);
+    fill(buf, 3 * BLOCK + 100, 500, 0);
+    affs_backend_write(b, 3 * BLOCK + 100, buf, 500);
+    affs_cache_drop(c, b);
+    ok &= affs_cache_resident(c) == 0 && read_block(c, b, 3, AFFS_PROFILE_POINT_LOOKUP);
+
+    /* the short last block is re-read once the file has grown */
+    ok &= read_block(c, b, FILE_BLOCKS - 1, AFFS_PROFILE_POINT_LOOKUP);
+    fill(buf, FILE_SIZE, 3000, 0);
+    affs_backend_write(b, FILE_SIZE, buf, 3000);
+    affs_io_result r = affs_cache_read(c, b, FILE_SIZE - 10, buf, 1000, AFFS_PROFILE_POINT_LOOKUP);
+    ok &= r.bytes == 1000 && check(buf, FILE_SIZE - 10, 1000, 0);
+    TEST_ASSERT(ok, "invalidate, drop and a growing last block");
+    g_checks++;
+    affs_cache_destroy(c);
+    printf("[PASS] invalidation\n");
+}
+
+/* ---------- threads ---------- */
+
+typedef struct worker_arg {
+    affs_cache *c;
+    affs_backend *b;
+    int id;
+    int ok;
+} worker_arg;
+
+static void *worker(void *p) {
+    worker_arg *a = (worker_arg *)p;
+    uint8_t *buf = (uint8_t *)malloc(3 * BLOCK);
+    uint64_t x = (uint64_t)a->id * 977 + 1;
+    a->ok = 1;
+    for (int i = 0; i < 3000; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t off = (x >> 24) % (i % 2 ? 64 * BLOCK : FILE_SIZE - 3 * BLOCK);   /* a shared hot region */
+        size_t len = (size_t)((x >> 4) % (2 * BLOCK)) + 1;
+        affs_io_result r = affs_cache_read(a->c, a->b, off, buf, len, (uint8_t)((x >> 40) % AFFS_PROFILE_COUNT));
+        a->ok &= r.category == AFFS_IO_OK && r.bytes == len && check(buf, off, len, 0);
+    }
+    free(buf);
+    return NULL;
+}
+
+static void test_threads(affs_backend *b) {
+    affs_cache *c = make_cache(48, 4);
+    pthread_t th[THREADS];
+    worker_arg args[THREADS];
+    for (int t = 0; t < THREADS; t++) {
+        args[t] = (worker_arg){ c, b, t, 0 };
+        pthread_create(&th[t], NULL, worker, &args[t]);
+    }
+    int ok = 1;
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(th[t], NULL);
+        ok &= args[t].ok;
+    }
+    uint64_t hits = 0, misses = 0;
+    for (uint8_t p = 0; p < AFFS_PROFILE_COUNT; p++) {
+        affs_cache_stats st;
+        affs_cache_stats_get(c, p, &st);
+        hits += st.hits;
+        misses += st.misses;
+    }
+    TEST_ASSERT(ok, "concurrent readers of all profiles get the file's bytes");
+    TEST_ASSERT(hits > 0 && misses > 0, "counters from every shard");
+    g_checks += 2;
+    affs_cache_destroy(c);
+    printf("[PASS] %d threads: %llu hits, %llu misses\n", THREADS, (unsigned long long)hits, (unsigned long long)misses);
+}
+
+int main(void) {
+    affs_backend *b = make_store();
+    test_reads(b);
+    test_scan_resistance(b);
+    test_readahead(b);
+    test_threads(b);
+    affs_backend_close(b);
+
+    /* direct I/O: block reads and reads around the cache stay aligned */
+    affs_backend_options bo = affs_backend_options_default();
+    bo.flags = AFFS_BACKEND_DIRECT;
+    TEST_ASSERT(affs_backend_open(&b, k_path, &bo).category == AFFS_IO_OK, "open direct");
+    test_reads(b);
+    affs_backend_close(b);
+
+    bo.flags = AFFS_BACKEND_WRITE;
+    TEST_ASSERT(affs_backend_open(&b, k_path, &bo).category == AFFS_IO_OK, "reopen");
+    test_invalidate(b);
+    affs_cache_options o = affs_cache_options_default();
+    o.block_size = 3000;
+    affs_cache *c;
+    TEST_ASSERT(affs_cache_create(&c, &o) == EINVAL, "block size must be a power of two");
+    g_checks++;
+    affs_backend_close(b);
+    remove(k_path);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
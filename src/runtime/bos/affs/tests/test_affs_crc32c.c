@@ -0,0 +1,97 @@
+#include "../include/affs_crc32c.h"
+#include "test_common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+/* Bit-at-a-time reference. */
+static uint32_t reference(uint32_t crc, const uint8_t *p, size_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t next_rand(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+int main(void) {
+    printf("[INFO] crc32c implementation: %s\n", affs_crc32c_impl());
+
+    /* known values (RFC 3720 B.4 and the check value) */
+    {
+        uint8_t buf[32];
+        TEST_ASSERT(affs_crc32c(0, "123456789", 9) == 0xE3069283u && affs_crc32c_sw(0, "123456789", 9) == 0xE3069283u,
+                    "check value");
+        memset(buf, 0, 32);
+        TEST_ASSERT(affs_crc32c(0, buf, 32) == 0x8A9136AAu, "32 zero bytes");
+        memset(buf, 0xFF, 32);
+        TEST_ASSERT(affs_crc32c(0, buf, 32) == 0x62A8AB43u, "32 0xFF bytes");
+        for (int i = 0; i < 32; i++) buf[i] = (uint8_t)i;
+        TEST_ASSERT(affs_crc32c(0, buf, 32) == 0x46DD794Eu, "32 incrementing bytes");
+        TEST_ASSERT(affs_crc32c(0, NULL, 0) == 0 && affs_crc32c(0x12345678u, buf, 0) == 0x12345678u, "empty input");
+        g_checks += 5;
+        printf("[PASS] known values\n");
+    }
+
+    /* every path (bytes, words, short and long blocks) at every alignment */
+    size_t max = 3 * 8192 * 2 + 3 * 256 + 100;
+    uint8_t *data = (uint8_t *)malloc(max + 8);
+    for (size_t i = 0; i < max + 8; i++) data[i] = (uint8_t)next_rand();
+    {
+        static const size_t lens[] = { 1, 7, 8, 9, 63, 767, 768, 769, 1000, 24575, 24576, 24577, 3 * 8192 * 2 + 3 * 256 + 100 };
+        int ok = 1;
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+            for (int a = 0; a < 8; a++) {
+                uint32_t want = reference(0, data + a, lens[l]);
+                ok &= affs_crc32c(0, data + a, lens[l]) == want && affs_crc32c_sw(0, data + a, lens[l]) == want;
+            }
+        }
+        for (int i = 0; i < 200; i++) {
+            size_t a = next_rand() % 8, n = next_rand() % max;
+            ok &= affs_crc32c(0, data + a, n) == reference(0, data + a, n);
+        }
+        TEST_ASSERT(ok, "all lengths and alignments match the reference");
+        g_checks++;
+        printf("[PASS] paths and alignments\n");
+    }
+
+    /* streaming and combine */
+    {
+        uint32_t whole = affs_crc32c(0, data, max);
+        int ok = 1;
+        for (int i = 0; i < 100; i++) {
+            size_t cut = next_rand() % (max + 1);
+            uint32_t a = affs_crc32c(0, data, cut);
+            ok &= affs_crc32c(a, data + cut, max - cut) == whole;
+            ok &= affs_crc32c_combine(a, affs_crc32c(0, data + cut, max - cut), max - cut) == whole;
+        }
+        TEST_ASSERT(ok, "streaming and combine over random cuts");
+
+        /* chunks checksummed independently, merged in order */
+        uint32_t merged = 0;
+        for (size_t at = 0; at < max; at += 4096) {
+            size_t n = max - at < 4096 ? max - at : 4096;
+            merged = affs_crc32c_combine(merged, affs_crc32c(0, data + at, n), n);
+        }
+        TEST_ASSERT(merged == whole, "chunked merge");
+        TEST_ASSERT(affs_crc32c_combine(whole, 0, 0) == whole, "combine with empty");
+        g_checks += 3;
+        printf("[PASS] streaming and combine\n");
+    }
+
+    free(data);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
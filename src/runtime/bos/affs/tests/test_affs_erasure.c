@@ -0,0 +1,256 @@
+#include "../include/affs_erasure.h"
+#include "../include/affs_record.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int g_checks = 0;
+
+#define ALIGN 64
+#define SHARD (16u * 1024)
+#define SEGMENT (3u * 1024 * 1024)
+
+static const char *k_impls[] = { "gfni", "avx2", "ssse3", "portable" };
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef struct stripe {
+    unsigned k, m;
+    size_t len;
+    uint8_t *mem;
+    uint8_t *shard[AFFS_EC_MAX_SHARDS];
+} stripe;
+
+static void stripe_init(stripe *s, unsigned k, unsigned m, size_t len) {
+    s->k = k;
+    s->m = m;
+    s->len = len;
+    s->mem = (uint8_t *)malloc((k + m) * len);
+    for (unsigned i = 0; i < k + m; i++) s->shard[i] = s->mem + i * len;
+    for (size_t i = 0; i < k * len; i++) s->mem[i] = (uint8_t)rnd();
+}
+
+/* ---------- tests ---------- */
+
+static void test_kernels_agree(void) {
+    stripe s;
+    stripe_init(&s, 10, 4, 100003);     /* not a multiple of any vector width */
+    affs_ec *ec;
+    TEST_ASSERT(affs_ec_create(&ec, 10, 4) == 0, "create");
+    const char *best = affs_ec_impl();
+    TEST_ASSERT(affs_ec_set_impl("portable") == 0, "portable");
+    affs_ec_encode(ec, (const uint8_t *const *)s.shard, s.shard + 10, s.len);
+    uint8_t *ref = (uint8_t *)malloc(4 * s.len);
+    memcpy(ref, s.shard[10], 4 * s.len);
+    int ok = 1, tried = 0;
+    for (size_t i = 0; i < sizeof(k_impls) / sizeof(k_impls[0]); i++) {
+        if (affs_ec_set_impl(k_impls[i]) != 0) continue;
+        memset(s.shard[10], 0, 4 * s.len);
+        affs_ec_encode(ec, (const uint8_t *const *)s.shard, s.shard + 10, s.len);
+        ok &= memcmp(ref, s.shard[10], 4 * s.len) == 0;
+        tried++;
+    }
+    TEST_ASSERT(ok, "every kernel computes the same parity");
+    TEST_ASSERT(affs_ec_set_impl("neon") == EINVAL, "unknown kernel");
+    affs_ec_set_impl(best);
+    g_checks += 3;
+    printf("[PASS] %d kernels agree (best: %s)\n", tried, best);
+    free(ref);
+    free(s.mem);
+    affs_ec_destroy(ec);
+}
+
+static void test_reconstruct(void) {
+    static const unsigned shapes[][2] = { { 1, 1 }, { 4, 2 }, { 6, 3 }, { 10, 4 }, { 17, 3 }, { 200, 55 } };
+    int ok = 1;
+    for (size_t t = 0; t < sizeof(shapes) / sizeof(shapes[0]); t++) {
+        unsigned k = shapes[t][0], m = shapes[t][1];
+        stripe s;
+        stripe_init(&s, k, m, 4099);
+        affs_ec *ec;
+        TEST_ASSERT(affs_ec_create(&ec, k, m) == 0, "create");
+        affs_ec_encode(ec, (const uint8_t *const *)s.shard, s.shard + k, s.len);
+        uint8_t *orig = (uint8_t *)malloc((k + m) * s.len);
+        memcpy(orig, s.mem, (k + m) * s.len);
+        for (int round = 0; round < 20; round++) {
+            uint8_t present[AFFS_EC_MAX_SHARDS];
+            memset(present, 1, k + m);
+            unsigned lose = 1 + (unsigned)(rnd() % m);
+            for (unsigned l = 0; l < lose;) {
+                unsigned i = (unsigned)(rnd() % (k + m));
+                if (!present[i]) continue;
+                present[i] = 0;
+                memset(s.shard[i], 0xA5, s.len);
+                l++;
+            }
+            ok &= affs_ec_reconstruct(ec, s.shard, present, s.len) == 0 && memcmp(orig, s.mem, (k + m) * s.len) == 0;
+        }
+        /* one more than m: not recoverable */
+        uint8_t present[AFFS_EC_MAX_SHARDS];
+        memset(present, 1, k + m);
+        memset(present, 0, m + 1 < k + m ? m + 1 : k + m);
+        ok &= affs_ec_reconstruct(ec, s.shard, present, s.len) == EINVAL;
+        free(orig);
+        free(s.mem);
+        affs_ec_destroy(ec);
+    }
+    TEST_ASSERT(ok, "any k of k + m shards rebuild the stripe");
+
+    /* every loss pattern of a 4 + 2 stripe */
+    stripe s;
+    stripe_init(&s, 4, 2, 1000);
+    affs_ec *ec;
+    affs_ec_create(&ec, 4, 2);
+    affs_ec_encode(ec, (const uint8_t *const *)s.shard, s.shard + 4, s.len);
+    uint8_t orig[6 * 1000];
+    memcpy(orig, s.mem, sizeof(orig));
+    for (unsigned mask = 0; mask < 64; mask++) {
+        if (__builtin_popcount(mask) > 2) continue;
+        uint8_t present[6];
+        for (unsigned i = 0; i < 6; i++) {
+            present[i] = !(mask >> i & 1);
+            if (!present[i]) memset(s.shard[i], 0, s.len);
+        }
+        ok &= affs_ec_reconstruct(ec, s.shard, present, s.len) == 0 && memcmp(orig, s.mem, sizeof(orig)) == 0;
+    }
+    TEST_ASSERT(ok, "every loss of up to 2 of 4 + 2");
+    affs_ec *bad;
+    TEST_ASSERT(affs_ec_create(&bad, 0, 2) == EINVAL && affs_ec_create(&bad, 4, 0) == EINVAL &&
+                    affs_ec_create(&bad, 200, 56) == EINVAL,
+                "bad shapes");
+    g_checks += 3;
+    free(s.mem);
+    affs_ec_destroy(ec);
+    printf("[PASS] reconstruction\n");
+}
+
+/* A segment of framed records, zero past the last one, protected 6 + 3 in 16 KiB shards. */
+static void test_segment_verified(void) {
+    const unsigned k = 6, m = 3;
+    const size_t stripe_bytes = (size_t)k * SHARD;
+    uint8_t *seg = (uint8_t *)calloc(1, SEGMENT);
+    size_t used = 0;
+    uint8_t payload[9000];
+    for (;;) {
+        size_t len = 1 + (size_t)(rnd() % sizeof(payload));
+        if (used + affs_record_framed_size(len, ALIGN) > SEGMENT - 5 * ALIGN) break;
+        for (size_t i = 0; i < len; i++) payload[i] = (uint8_t)rnd();
+        affs_record_header h = { AFFS_KIND_BLOB, 0, 0, 0, 0, 0 };
+        used += affs_record_frame(seg + used, &h, payload, len, ALIGN);
+    }
+    size_t stripes = SEGMENT / stripe_bytes;
+    uint8_t *parity = (uint8_t *)malloc(stripes * m * SHARD);
+    affs_ec *ec;
+    affs_ec_create(&ec, k, m);
+    for (size_t s = 0; s < stripes; s++) {
+        uint8_t *shards[9];
+        for (unsigned i = 0; i < k; i++) shards[i] = seg + s * stripe_bytes + i * SHARD;
+        for (unsigned i = 0; i < m; i++) shards[k + i] = parity + (s * m + i) * SHARD;
+        affs_ec_encode(ec, (const uint8_t *const *)shards, shards + k, SHARD);
+    }
+    uint8_t *orig = (uint8_t *)malloc(SEGMENT);
+    memcpy(orig, seg, SEGMENT);
+
+    /* device 2 is lost: shard 2 of every stripe */
+    int ok = 1;
+    uint64_t records = 0;
+    for (size_t s = 0; s < stripes; s++) {
+        uint8_t *shards[9];
+        uint8_t present[9] = { 1, 1, 0, 1, 1, 1, 1, 1, 1 };
+        for (unsigned i = 0; i < k; i++) shards[i] = seg + s * stripe_bytes + i * SHARD;
+        for (unsigned i = 0; i < m; i++) shards[k + i] = parity + (s * m + i) * SHARD;
+        memset(shards[2], 0, SHARD);
+        ok &= affs_ec_reconstruct(ec, shards, present, SHARD) == 0;
+    }
+    for (size_t s = 0; s < stripes; s++) {
+        affs_ec_verify_result v;
+        uint64_t from = s * stripe_bytes + 2 * SHARD;
+        affs_ec_verify(seg, SEGMENT, ALIGN, from, from + SHARD, &v);
+        ok &= v.bad == 0 && v.unverified == 0;
+        records += v.records;
+    }
+    TEST_ASSERT(ok && records > 0 && memcmp(seg, orig, SEGMENT) == 0, "lost shards rebuilt, records verify");
+
+    /* a silently damaged survivor poisons the rebuild; the record CRCs say so */
+    size_t s = 1;
+    seg[s * stripe_bytes + 4 * SHARD + 777] ^= 0x40;
+    uint8_t *shards[9];
+    uint8_t present[9] = { 1, 1, 0, 1, 1, 1, 1, 1, 1 };
+    for (unsigned i = 0; i < k; i++) shards[i] = seg + s * stripe_bytes + i * SHARD;
+    for (unsigned i = 0; i < m; i++) shards[k + i] = parity + (s * m + i) * SHARD;
+    memset(shards[2], 0, SHARD);
+    affs_ec_reconstruct(ec, shards, present, SHARD);
+    affs_ec_verify_result v;
+    affs_ec_verify(seg, SEGMENT, ALIGN, s * stripe_bytes + 2 * SHARD, s * stripe_bytes + 3 * SHARD, &v);
+    TEST_ASSERT(v.bad > 0 || v.unverified > 0, "rebuild from a damaged shard fails verification");
+
+    /* the damaged shard is found the same way, dropped, and rebuilt from the rest */
+    affs_ec_verify(seg, SEGMENT, ALIGN, s * stripe_bytes + 4 * SHARD, s * stripe_bytes + 5 * SHARD, &v);
+    TEST_ASSERT(v.bad > 0, "damaged shard caught by its record CRCs");
+    uint8_t present2[9] = { 1, 1, 0, 1, 0, 1, 1, 1, 1 };
+    TEST_ASSERT(affs_ec_reconstruct(ec, shards, present2, SHARD) == 0 && memcmp(seg, orig, SEGMENT) == 0,
+                "two lost shards of one stripe rebuilt");
+    affs_ec_verify(seg, SEGMENT, ALIGN, 0, SEGMENT, &v);
+    TEST_ASSERT(v.bad == 0 && v.unverified == 0, "whole segment verifies");
+    g_checks += 5;
+    printf("[PASS] segment: %zu stripes of 6 + 3, %llu records verified after losing a device\n", stripes,
+           (unsigned long long)records);
+
+    free(orig);
+    free(parity);
+    free(seg);
+    affs_ec_destroy(ec);
+}
+
+static void report_throughput(void) {
+    const unsigned k = 10, m = 4;
+    const size_t len = 1u << 20;
+    stripe s;
+    stripe_init(&s, k, m, len);
+    affs_ec *ec;
+    affs_ec_create(&ec, k, m);
+    const char *best = affs_ec_impl();
+    for (size_t i = 0; i < sizeof(k_impls) / sizeof(k_impls[0]); i++) {
+        if (affs_ec_set_impl(k_impls[i]) != 0) continue;
+        int rounds = strcmp(k_impls[i], "portable") == 0 ? 2 : 20;
+        double t = now_s();
+        for (int r = 0; r < rounds; r++) affs_ec_encode(ec, (const uint8_t *const *)s.shard, s.shard + k, len);
+        double enc = (double)k * len * rounds / (now_s() - t) / 1e9;
+        uint8_t present[14];
+        memset(present, 1, sizeof(present));
+        present[0] = present[3] = present[7] = present[11] = 0;
+        t = now_s();
+        for (int r = 0; r < rounds; r++) affs_ec_reconstruct(ec, s.shard, present, len);
+        double rec = (double)k * len * rounds / (now_s() - t) / 1e9;
+        printf("       %-8s 10 + 4: encode %.2f GB/s, rebuild 4 lost %.2f GB/s\n", k_impls[i], enc, rec);
+    }
+    affs_ec_set_impl(best);
+    free(s.mem);
+    affs_ec_destroy(ec);
+}
+
+int main(void) {
+    test_kernels_agree();
+    test_reconstruct();
+    test_segment_verified();
+    report_throughput();
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include "../include/affs_index.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+#define KEYS 20000
+#define READERS 4
+#define STREAM 200000
+
+static uint64_t g_rng = 0x2545F4914F6CDD1Dull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+static affs_object_id object_id(uint64_t k) {
+    affs_object_id id = { k * 0x9E3779B97F4A7C15ull + 1, k };
+    return id;
+}
+
+/* A location whose fields all derive from (k, version): a torn read fails check_loc(). */
+static affs_location make_loc(uint64_t k, uint64_t version) {
+    affs_location l;
+    l.segment_id = (uint32_t)(k * 31 + version);
+    l.offset = (k << 20) + version * 64;
+    l.length = (uint32_t)(l.offset ^ l.segment_id);
+    l.flags = (uint32_t)(version & 0xFFFF);
+    return l;
+}
+
+static int check_loc(uint64_t k, const affs_location *l) {
+    uint64_t version = (l->offset - (k << 20)) / 64;
+    affs_location e = make_loc(k, version);
+    return e.segment_id == l->segment_id && e.offset == l->offset && e.length == l->length && e.flags == l->flags;
+}
+
+static int same_loc(const affs_location *a, const affs_location *b) {
+    return a->segment_id == b->segment_id && a->offset == b->offset && a->length == b->length && a->flags == b->flags;
+}
+
+/* ---------- model ---------- */
+
+static uint64_t g_version[KEYS];  /* 0: absent */
+
+static int matches_model(affs_index *ix) {
+    size_t live = 0;
+    for (uint64_t k = 0; k < KEYS; k++) {
+        affs_location l;
+        int f = affs_index_get(ix, object_id(k), &l);
+        if (f != (g_version[k] != 0)) return 0;
+        if (f) {
+            affs_location e = make_loc(k, g_version[k]);
+            if (!same_loc(&l, &e)) return 0;
+            live++;
+        }
+    }
+    return affs_index_count(ix) == live;
+}
+
+static void test_model(void) {
+    affs_index *ix;
+    TEST_ASSERT(affs_index_create(&ix, 0) == 0, "create");
+    int ok = 1;
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 60000; i++) {
+            uint64_t k = rnd() % KEYS;
+            if (rnd() % 4 == 0) {
+                int e = affs_index_erase(ix, object_id(k));
+                ok &= e == (g_version[k] ? 0 : ENOENT);
+                g_version[k] = 0;
+            } else {
+                g_version[k]++;
+                affs_location l = make_loc(k, g_version[k]);
+                ok &= affs_index_put(ix, object_id(k), &l) == 0;
+            }
+        }
+        ok &= matches_model(ix);
+    }
+    affs_index_stats st;
+    affs_index_stats_get(ix, &st);
+    TEST_ASSERT(ok, "index matches the model across resizes and erasures");
+    TEST_ASSERT(st.resizes > 5 && st.count == affs_index_count(ix), "grew from a small start");
+    g_checks += 2;
+
+    /* erase everything, refill: tombstones are rehashed away, not grown over */
+    size_t cap = st.capacity;
+    for (int round = 0; round < 4; round++) {
+        for (uint64_t k = 0; k < KEYS; k++) {
+            if (g_version[k]) affs_index_erase(ix, object_id(k));
+            g_version[k] = 0;
+        }
+        for (uint64_t k = 0; k < KEYS; k++) {
+            uint64_t j = k + (uint64_t)(round + 1) * KEYS;  /* fresh ids each round */
+            affs_location l = make_loc(j, 1);
+            ok &= affs_index_put(ix, object_id(j), &l) == 0;
+        }
+        for (uint64_t k = 0; k < KEYS; k++) affs_index_erase(ix, object_id(k + (uint64_t)(round + 1) * KEYS));
+    }
+    while (affs_index_maintain(ix, 64)) {
+    }
+    affs_index_stats_get(ix, &st);
+    TEST_ASSERT(ok && st.count == 0 && st.migrating == 0 && st.capacity <= cap * 2, "churn does not grow the table");
+    affs_location bad = make_loc(1, 1);
+    bad.segment_id = 1ull << 32;
+    TEST_ASSERT(affs_index_put(ix, object_id(1), &bad) == EINVAL, "segment id beyond 32 bits");
+    g_checks += 2;
+    affs_index_destroy(ix);
+    printf("[PASS] model: %llu resizes\n", (unsigned long long)st.resizes);
+}
+
+/* ---------- batches, load ---------- */
+
+static void test_batch_and_load(void) {
+    enum { N = 50000 };
+    affs_index_entry *e = (affs_index_entry *)calloc(N, sizeof(*e));
+    for (uint64_t k = 0; k < N; k++) {
+        e[k].id = object_id(k);
+        e[k].loc = make_loc(k, 3);
+        e[k].sequence = k;
+        e[k].object_flags = k % 10 == 0 ? AFFS_OBJECT_TOMBSTONE : 0;
+    }
+    affs_index *ix;
+    TEST_ASSERT(affs_index_create(&ix, N) == 0, "create sized");
+    TEST_ASSERT(affs_index_load(ix, e, N) == 0, "load");
+    TEST_ASSERT(affs_index_count(ix) == N - N / 10, "tombstones not loaded");
+
+    enum { Q = 1000 };
+    affs_object_id ids[Q];
+    affs_location locs[Q];
+    uint8_t found[Q];
+    int ok = 1;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < Q; i++) ids[i] = object_id(rnd() % (N + N / 4));  /* some misses */
+        size_t hits = affs_index_get_batch(ix, ids, Q, locs, found), n = 0;
+        for (int i = 0; i < Q; i++) {
+            affs_location l;
+            int f = affs_index_get(ix, ids[i], &l);
+            ok &= f == found[i] && (!f || same_loc(&l, &locs[i]));
+            n += (size_t)f;
+        }
+        ok &= n == hits;
+    }
+    TEST_ASSERT(ok, "batched lookups agree with single ones");
+    g_checks += 4;
+    affs_index_destroy(ix);
+    free(e);
+    printf("[PASS] batch lookups and load\n");
+}
+
+/* ---------- one writer, lock-free readers ---------- */
+
+typedef struct shared {
+    affs_index *ix;
+    _Atomic uint64_t published;  /* keys [0, published) are present */
+    _Atomic int stop;
+    _Atomic uint64_t lookups, torn, missing;
+} shared;
+
+static void *reader(void *arg) {
+    shared *sh = (shared *)arg;
+    uint64_t x = (uint64_t)(uintptr_t)&x | 1, n = 0;
+    affs_object_id ids[32];
+    affs_location locs[32];
+    uint8_t found[32];
+    while (!atomic_load(&sh->stop)) {
+        uint64_t top = atomic_load(&sh->published);
+        if (!top) continue;
+        for (int i = 0; i < 32; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            ids[i] = object_id(x % top);
+        }
+        if (n & 1) {
+            affs_index_get_batch(sh->ix, ids, 32, locs, found);
+        } else {
+            for (int i = 0; i < 32; i++) found[i] = (uint8_t)affs_index_get(sh->ix, ids[i], &locs[i]);
+        }
+        for (int i = 0; i < 32; i++) {
+            if (!found[i]) atomic_fetch_add(&sh->missing, 1);
+            else if (!check_loc(ids[i].hi, &locs[i])) atomic_fetch_add(&sh->torn, 1);
+        }
+        n++;
+    }
+    atomic_fetch_add(&sh->lookups, n * 32);
+    return NULL;
+}
+
+static void test_concurrent(void) {
+    shared sh;
+    memset(&sh, 0, sizeof(sh));
+    TEST_ASSERT(affs_index_create(&sh.ix, 0) == 0, "create");
+    pthread_t th[READERS];
+    for (int i = 0; i < READERS; i++) pthread_create(&th[i], NULL, reader, &sh);
+
+    /* inserts through many resizes, with updates of published keys between them */
+    int ok = 1;
+    for (uint64_t k = 0; k < STREAM; k++) {
+        affs_location l = make_loc(k, 1);
+        ok &= affs_index_put(sh.ix, object_id(k), &l) == 0;
+        atomic_store(&sh.published, k + 1);
+        uint64_t u = rnd() % (k + 1);
+        l = make_loc(u, 2 + k);
+        ok &= affs_index_put(sh.ix, object_id(u), &l) == 0;
+    }
+    atomic_store(&sh.stop, 1);
+    for (int i = 0; i < READERS; i++) pthread_join(th[i], NULL);
+
+    affs_index_stats st;
+    affs_index_stats_get(sh.ix, &st);
+    TEST_ASSERT(ok && affs_index_count(sh.ix) == STREAM, "writer");
+    TEST_ASSERT(atomic_load(&sh.torn) == 0, "no torn location read");
+    TEST_ASSERT(atomic_load(&sh.missing) == 0, "published keys always found, also mid-resize");
+    TEST_ASSERT(st.resizes > 10, "resizes happened under the readers");
+    g_checks += 4;
+    affs_index_destroy(sh.ix);
+    printf("[PASS] concurrent readers: %llu lookups during %llu resizes\n", (unsigned long long)atomic_load(&sh.lookups),
+           (unsigned long long)st.resizes);
+}
+
+int main(void) {
+    test_model();
+    test_batch_and_load();
+    test_concurrent();
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,239 @@
+#include "../include/affs_posting.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+#define RANGE_CONTAINERS 24
+#define SETS 40
+#define ROUNDS 2000
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+/* ---------- model: sorted arrays ---------- */
+
+typedef struct set {
+    uint32_t *v;
+    size_t n;
+} set;
+
+/* Each container gets its own density: empty, a few, arrays, either side of 4096, bitmaps, full. */
+static set make_set(void) {
+    set s = { (uint32_t *)malloc((size_t)RANGE_CONTAINERS * 65536 * sizeof(uint32_t)), 0 };
+    static const uint32_t per_million[] = { 0, 0, 30, 1000, 40000, 62500, 62520, 300000, 900000, 1000000 };
+    for (uint32_t c = 0; c < RANGE_CONTAINERS; c++) {
+        uint32_t d = per_million[rnd() % (sizeof(per_million) / sizeof(per_million[0]))];
+        for (uint32_t low = 0; low < 65536; low++) {
+            if (rnd() % 1000000 < d) s.v[s.n++] = c << 16 | low;
+        }
+    }
+    return s;
+}
+
+static set model_op(const set *a, const set *b, char op) {
+    set r = { (uint32_t *)malloc((a->n + b->n + 1) * sizeof(uint32_t)), 0 };
+    size_t i = 0, j = 0;
+    while (i < a->n || j < b->n) {
+        int in_a = i < a->n && (j >= b->n || a->v[i] <= b->v[j]);
+        int in_b = j < b->n && (i >= a->n || b->v[j] <= a->v[i]);
+        uint32_t x = in_a ? a->v[i] : b->v[j];
+        if ((op == '&' && in_a && in_b) || op == '|' || (op == '-' && in_a && !in_b)) r.v[r.n++] = x;
+        i += (size_t)in_a;
+        j += (size_t)in_b;
+    }
+    return r;
+}
+
+static int same(const affs_posting *p, const set *s) {
+    if (p->cardinality != s->n) return 0;
+    uint32_t *v = (uint32_t *)malloc((s->n + 1) * sizeof(uint32_t));
+    affs_posting_to_array(p, v);
+    int ok = s->n == 0 || memcmp(v, s->v, s->n * sizeof(uint32_t)) == 0;
+    free(v);
+    for (uint32_t i = 0; ok && i < p->containers; i++) {
+        ok &= (i == 0 || p->keys[i] > p->keys[i - 1]) && p->cards[i] > 0;
+        if (p->cards[i] > AFFS_POSTING_ARRAY_MAX) ok &= ((uintptr_t)(p->pool + p->offsets[i]) & 63) == 0;
+    }
+    return ok;
+}
+
+/* ---------- tests ---------- */
+
+static void test_set_operations(void) {
+    set sets[SETS];
+    affs_posting lists[SETS];
+    for (int i = 0; i < SETS; i++) {
+        sets[i] = make_set();
+        /* a few sparse lists, to gallop against the dense ones */
+        if (i % 8 == 7) {
+            size_t k = 0;
+            for (size_t j = 0; j < sets[i].n; j += 97) sets[i].v[k++] = sets[i].v[j];
+            sets[i].n = k;
+        }
+        TEST_ASSERT(affs_posting_from_sorted(&lists[i], sets[i].v, sets[i].n) == 0, "build");
+        TEST_ASSERT(same(&lists[i], &sets[i]), "built list holds the set");
+    }
+    g_checks += 2;
+
+    int ok = 1;
+    for (int r = 0; r < ROUNDS / 10; r++) {
+        int a = (int)(rnd() % SETS), b = (int)(rnd() % SETS);
+        static const char ops[] = "&|-";
+        for (int o = 0; o < 3; o++) {
+            affs_posting p;
+            int e = ops[o] == '&'   ? affs_posting_and(&p, &lists[a], &lists[b])
+                    : ops[o] == '|' ? affs_posting_or(&p, &lists[a], &lists[b])
+                                    : affs_posting_andnot(&p, &lists[a], &lists[b]);
+            set m = model_op(&sets[a], &sets[b], ops[o]);
+            ok &= e == 0 && same(&p, &m);
+            affs_posting_free(&p);
+            free(m.v);
+        }
+    }
+    TEST_ASSERT(ok, "and, or, andnot match the model");
+
+    for (int r = 0; r < 40; r++) {
+        const affs_posting *pick[5];
+        set m_and = { NULL, 0 }, m_or = { NULL, 0 };
+        size_t n = 1 + rnd() % 5;
+        for (size_t i = 0; i < n; i++) {
+            int k = (int)(rnd() % SETS);
+            pick[i] = &lists[k];
+            if (i == 0) {
+                m_and = model_op(&sets[k], &sets[k], '&');
+                m_or = model_op(&sets[k], &sets[k], '|');
+                continue;
+            }
+            set t = model_op(&m_and, &sets[k], '&');
+            free(m_and.v);
+            m_and = t;
+            t = model_op(&m_or, &sets[k], '|');
+            free(m_or.v);
+            m_or = t;
+        }
+        affs_posting pa, po;
+        ok &= affs_posting_and_many(&pa, pick, n) == 0 && same(&pa, &m_and);
+        ok &= affs_posting_or_many(&po, pick, n) == 0 && same(&po, &m_or);
+        affs_posting_free(&pa);
+        affs_posting_free(&po);
+        free(m_and.v);
+        free(m_or.v);
+    }
+    TEST_ASSERT(ok, "and_many, or_many match the model");
+
+    for (int r = 0; r < ROUNDS; r++) {
+        int a = (int)(rnd() % SETS);
+        uint32_t x = (uint32_t)(rnd() % ((uint64_t)RANGE_CONTAINERS << 16));
+        if (sets[a].n && r % 2) x = sets[a].v[rnd() % sets[a].n];
+        int in = 0;
+        for (size_t lo = 0, hi = sets[a].n; lo < hi;) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (sets[a].v[mid] == x) {
+                in = 1;
+                break;
+            }
+            if (sets[a].v[mid] < x) lo = mid + 1;
+            else hi = mid;
+        }
+        ok &= affs_posting_contains(&lists[a], x) == in;
+    }
+    TEST_ASSERT(ok, "contains");
+
+    affs_posting empty = { 0, 0, NULL, NULL, NULL, NULL, 0 }, p;
+    ok &= affs_posting_and(&p, &lists[0], &empty) == 0 && p.cardinality == 0;
+    ok &= affs_posting_or(&p, &empty, &lists[1]) == 0 && same(&p, &sets[1]);
+    affs_posting_free(&p);
+    ok &= affs_posting_andnot(&p, &lists[2], &lists[2]) == 0 && p.cardinality == 0 && p.pool == NULL;
+    ok &= affs_posting_and_many(&p, NULL, 0) == 0 && p.cardinality == 0;
+    TEST_ASSERT(ok, "empty lists");
+    g_checks += 4;
+    printf("[PASS] set operations over %d lists (%s)\n", SETS, affs_posting_impl());
+
+    /* encoding */
+    ok = 1;
+    size_t raw = 0, packed = 0;
+    for (int i = 0; i < SETS; i++) {
+        size_t n = affs_posting_encoded_size(&lists[i]);
+        uint8_t *buf = (uint8_t *)malloc(n);
+        affs_posting_encode(&lists[i], buf);
+        affs_posting d;
+        ok &= affs_posting_decode(&d, buf, n) == 0 && same(&d, &sets[i]);
+        affs_posting_free(&d);
+        raw += affs_posting_bytes(&lists[i]);
+        packed += n;
+        free(buf);
+    }
+    TEST_ASSERT(ok, "encode/decode round trip");
+    g_checks++;
+    printf("[PASS] encoding: %zu bytes in memory, %zu encoded\n", raw, packed);
+
+    for (int i = 0; i < SETS; i++) {
+        affs_posting_free(&lists[i]);
+        free(sets[i].v);
+    }
+}
+
+static void test_bad_input(void) {
+    uint32_t v[] = { 1, 5, 5 };
+    affs_posting p;
+    TEST_ASSERT(affs_posting_from_sorted(&p, v, 3) == EINVAL, "duplicate values");
+    uint32_t w[] = { 70000, 3 };
+    TEST_ASSERT(affs_posting_from_sorted(&p, w, 2) == EINVAL, "descending values");
+
+    /* key 2: three values, stored gaps - 1 of 9 and 0; key 5: one value */
+    uint32_t ok_vals[] = { 0x20000 | 10, 0x20000 | 20, 0x20000 | 21, 0x50000 | 7 };
+    TEST_ASSERT(affs_posting_from_sorted(&p, ok_vals, 4) == 0, "build");
+    size_t n = affs_posting_encoded_size(&p);
+    uint8_t *buf = (uint8_t *)malloc(n + 1);
+    affs_posting_encode(&p, buf);
+    affs_posting d;
+    TEST_ASSERT(affs_posting_decode(&d, buf, n - 1) == EBADMSG, "truncated");
+    TEST_ASSERT(affs_posting_decode(&d, buf, n) == 0 && d.cardinality == 4, "intact");
+    affs_posting_free(&d);
+    buf[n] = 0;
+    TEST_ASSERT(affs_posting_decode(&d, buf, n + 1) == EBADMSG, "trailing bytes");
+    buf[4 + 4 + 2] = 17;      /* width of the first block */
+    TEST_ASSERT(affs_posting_decode(&d, buf, n) == EBADMSG, "width beyond 16");
+    affs_posting_encode(&p, buf);
+    buf[4 + 8] = 2;           /* second container's key: not above the first */
+    TEST_ASSERT(affs_posting_decode(&d, buf, n) == EBADMSG, "keys out of order");
+    affs_posting_encode(&p, buf);
+    buf[4 + 4] = 0xFA;        /* first value 65530, + 10 overflows the container */
+    buf[4 + 5] = 0xFF;
+    TEST_ASSERT(affs_posting_decode(&d, buf, n) == EBADMSG, "value beyond 65535");
+    free(buf);
+    affs_posting_free(&p);
+
+    /* bitmap container whose cardinality does not match its bits */
+    uint32_t *dense = (uint32_t *)malloc(5000 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < 5000; i++) dense[i] = i * 3;
+    TEST_ASSERT(affs_posting_from_sorted(&p, dense, 5000) == 0 && p.containers == 1, "one bitmap");
+    n = affs_posting_encoded_size(&p);
+    buf = (uint8_t *)malloc(n);
+    affs_posting_encode(&p, buf);
+    buf[4 + 4 + 100] ^= 0x10;
+    TEST_ASSERT(affs_posting_decode(&d, buf, n) == EBADMSG, "bitmap count mismatch");
+    free(buf);
+    free(dense);
+    affs_posting_free(&p);
+    g_checks += 10;
+    printf("[PASS] malformed input rejected\n");
+}
+
+int main(void) {
+    test_set_operations();
+    test_bad_input();
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,440 @@
+#include "../include/affs_scrub.h"
+#include "../include/affs_record.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static int g_checks = 0;
+
+static const char *k_path_a = "affs_scrub_test.a";
+static const char *k_path_b = "affs_scrub_test.b";
+static const char *k_checkpoint = "affs_scrub_test.ckpt";
+
+#define ALIGN 64
+#define RECORDS 1500
+#define MAX_EVENTS 64
+/* each copy has its own layout: the segments sit at other offsets */
+#define SEG1_A (4u * 1024 * 1024)
+#define SEG0_B 8192u
+#define SEG1_B (5u * 1024 * 1024)
+
+static uint64_t g_rng = 0x243F6A8885A308D3ull;
+
+static uint64_t rnd(void) {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return g_rng;
+}
+
+/* ---------- building the copies ---------- */
+
+typedef struct image {
+    uint8_t *data;
+    size_t len, cap;
+} image;
+
+static size_t put(image *im, uint8_t kind, const uint8_t *payload, size_t len) {
+    size_t framed = (size_t)affs_record_framed_size(len, ALIGN);
+    if (im->len + framed > im->cap) {
+        im->cap = (im->len + framed) * 2;
+        im->data = (uint8_t *)realloc(im->data, im->cap);
+        TEST_ASSERT(im->data != NULL, "out of memory");
+    }
+    affs_record_header h = { kind, 1, 0, 0, 0, 0 };
+    affs_record_frame(im->data + im->len, &h, payload, len, ALIGN);
+    size_t at = im->len;
+    im->len += framed;
+    return at;
+}
+
+static void put_random(image *im, size_t len, size_t *at, size_t *framed) {
+    uint8_t *p = (uint8_t *)malloc(len);
+    TEST_ASSERT(p != NULL, "out of memory");
+    for (size_t i = 0; i < len; i++) p[i] = (uint8_t)rnd();
+    *at = put(im, AFFS_KIND_BLOB, p, len);
+    *framed = (size_t)affs_record_framed_size(len, ALIGN);
+    free(p);
+}
+
+typedef struct expected {
+    affs_scrub_event ev[MAX_EVENTS];
+    size_t n;
+    uint64_t records;           /* record positions of the store */
+} expected;
+
+static void expect(expected *x, affs_scrub_finding f, unsigned copy, uint64_t seg, uint64_t off, uint64_t len) {
+    affs_scrub_event *e = &x->ev[x->n++];
+    memset(e, 0, sizeof(*e));
+    e->finding = f;
+    e->copy = copy;
+    e->segment_id = seg;
+    e->offset = off;
+    e->length = len;
+}
+
+/*
+ * Two segments of records, random payloads mostly small, a few over
+ * a range long, and a blob whose payload is itself framed records.
+ * Then, per segment: a record damaged in A, one in B, one in both,
+ * and one B holds valid but different.
+ */
+static void build_store(expected *x, uint64_t *end0, uint64_t *end1) {
+    image seg[2] = { { NULL, 0, 0 }, { NULL, 0, 0 } };
+    size_t at[2][RECORDS], framed[2][RECORDS];
+    for (int s = 0; s < 2; s++) {
+        for (int i = 0; i < RECORDS; i++) {
+            size_t len = i % 300 == 150 ? 150000 + (size_t)(rnd() % 100000) : 1 + (size_t)(rnd() % 2000);
+            if (i == 700) {
+                image inner = { NULL, 0, 0 };
+                size_t a, f;
+                put(&inner, AFFS_KIND_UNINITIALIZED, NULL, 0);
+                inner.len = ALIGN - AFFS_RECORD_HEADER_SIZE;       /* inner records land aligned in the file */
+                memset(inner.data, 0, inner.len);
+                for (int k = 0; k < 400; k++) put_random(&inner, 1 + (size_t)(rnd() % 500), &a, &f);
+                /* the last one's padding runs past the blob: a chain inside it overshoots the true boundary */
+                at[s][i] = put(&seg[s], AFFS_KIND_STRUCTURAL, inner.data, inner.len - 10);
+                framed[s][i] = (size_t)affs_record_framed_size(inner.len - 10, ALIGN);
+                free(inner.data);
+                continue;
+            }
+            put_random(&seg[s], len, &at[s][i], &framed[s][i]);
+        }
+    }
+    *end0 = seg[0].len;
+    *end1 = seg[1].len;
+    x->records = 2 * RECORDS;
+
+    uint8_t *b[2] = { (uint8_t *)malloc(seg[0].len), (uint8_t *)malloc(seg[1].len) };
+    TEST_ASSERT(b[0] != NULL && b[1] != NULL, "out of memory");
+    memcpy(b[0], seg[0].data, seg[0].len);
+    memcpy(b[1], seg[1].data, seg[1].len);
+    x->n = 0;
+    for (int s = 0; s < 2; s++) {
+        static const int picks[2][4] = { { 40, 150, 900, 1200 }, { 450, 3, 1050, 1499 } };
+        const int *k = picks[s];
+        uint64_t id = 10 + (uint64_t)s;
+        seg[s].data[at[s][k[0]] + AFFS_RECORD_HEADER_SIZE] ^= 0x01;
+        b[s][at[s][k[1]] + AFFS_RECORD_HEADER_SIZE + 7] ^= 0x80;
+        seg[s].data[at[s][k[2]] + AFFS_RECORD_HEADER_SIZE + 1] ^= 0x10;
+        b[s][at[s][k[2]] + AFFS_RECORD_HEADER_SIZE + 1] ^= 0x20;
+        /* B: another record of the same length */
+        affs_record_header h;
+        uint64_t f;
+        affs_record_check(b[s] + at[s][k[3]], framed[s][k[3]], ALIGN, &h, &f);
+        uint8_t *p = (uint8_t *)malloc(h.payload_length);
+        TEST_ASSERT(p != NULL, "out of memory");
+        for (size_t i = 0; i < h.payload_length; i++) p[i] = (uint8_t)rnd();
+        affs_record_frame(b[s] + at[s][k[3]], &h, p, h.payload_length, ALIGN);
+        free(p);
+
+        int order[4] = { 0, 1, 2, 3 };
+        for (int i = 0; i < 4; i++) {
+            for (int j = i + 1; j < 4; j++) {
+                if (k[order[j]] < k[order[i]]) {
+                    int t = order[i];
+                    order[i] = order[j];
+                    order[j] = t;
+                }
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            int w = order[i];
+            static const affs_scrub_finding f4[4] = { AFFS_SCRUB_REPAIRABLE, AFFS_SCRUB_REPAIRABLE, AFFS_SCRUB_DAMAGED,
+                                                      AFFS_SCRUB_MISMATCH };
+            expect(x, f4[w], w == 1 ? 1 : 0, id, at[s][k[w]], framed[s][k[w]]);
+        }
+        x->records -= 2;        /* damaged in both, and the mismatch */
+    }
+
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE;
+    affs_backend *fa, *fb;
+    remove(k_path_a);
+    remove(k_path_b);
+    TEST_ASSERT(seg[0].len < SEG1_A && SEG0_B + seg[0].len < SEG1_B, "segments fit");
+    affs_backend_open(&fa, k_path_a, &o);
+    affs_backend_open(&fb, k_path_b, &o);
+    affs_backend_write(fa, 0, seg[0].data, seg[0].len);
+    affs_backend_write(fa, SEG1_A, seg[1].data, seg[1].len);
+    affs_backend_write(fb, SEG0_B, b[0], seg[0].len);
+    affs_backend_write(fb, SEG1_B, b[1], seg[1].len);
+    affs_backend_close(fa);
+    affs_backend_close(fb);
+    for (int s = 0; s < 2; s++) {
+        free(seg[s].data);
+        free(b[s]);
+    }
+}
+
+/* ---------- running ---------- */
+
+typedef struct collected {
+    affs_scrub_event ev[4 * MAX_EVENTS];
+    size_t n;
+} collected;
+
+static void on_event(void *ctx, const affs_scrub_event *e) {
+    collected *c = (collected *)ctx;
+    if (c->n < sizeof(c->ev) / sizeof(c->ev[0])) c->ev[c->n++] = *e;
+}
+
+static int same_events(const collected *c, const affs_scrub_event *ev, size_t n) {
+    if (c->n != n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        const affs_scrub_event *a = &c->ev[i], *b = &ev[i];
+        if (a->finding != b->finding || a->copy != b->copy || a->segment_id != b->segment_id || a->offset != b->offset ||
+            a->length != b->length)
+            return 0;
+    }
+    return 1;
+}
+
+typedef struct store {
+    affs_backend *a, *b;
+    affs_scrub_segment segs[2];
+} store;
+
+static void open_store(store *st, uint64_t end0, uint64_t end1, int both) {
+    affs_backend_options o = affs_backend_options_default();
+    affs_backend_open(&st->a, k_path_a, &o);
+    st->b = NULL;
+    if (both) affs_backend_open(&st->b, k_path_b, &o);
+    affs_scrub_segment s0 = { st->a, st->b, 10, 0, SEG0_B, 0, end0, ALIGN };
+    affs_scrub_segment s1 = { st->a, st->b, 11, SEG1_A, SEG1_B, 0, end1, ALIGN };
+    st->segs[0] = s0;
+    st->segs[1] = s1;
+}
+
+static void close_store(store *st) {
+    affs_backend_close(st->a);
+    if (st->b) affs_backend_close(st->b);
+}
+
+static affs_scrub_report run(store *st, affs_scrub_options *o, collected *c) {
+    affs_scrub *sc;
+    affs_scrub_report r;
+    memset(&r, 0, sizeof(r));
+    c->n = 0;
+    o->on_event = on_event;
+    o->event_ctx = c;
+    TEST_ASSERT(affs_scrub_create(&sc, st->segs, 2, o).category == AFFS_IO_OK, "create");
+    TEST_ASSERT(affs_scrub_run(sc, &r).category == AFFS_IO_OK, "run");
+    affs_scrub_destroy(sc);
+    return r;
+}
+
+/* ---------- tests ---------- */
+
+static void test_compare(const expected *x, uint64_t end0, uint64_t end1) {
+    store st;
+    open_store(&st, end0, end1, 1);
+    collected c;
+    affs_scrub_options o = affs_scrub_options_default();
+    o.threads = 1;
+    o.range_bytes = 1ull << 30;
+    affs_scrub_report ref = run(&st, &o, &c);
+    TEST_ASSERT(ref.complete && ref.ranges == 2 && ref.rescans == 0, "one range per segment");
+    TEST_ASSERT(same_events(&c, x->ev, x->n), "every difference found, in segment order");
+    TEST_ASSERT(ref.records == x->records && ref.repairable == 4 && ref.mismatches == 2 && ref.damaged_bytes > 0,
+                "totals");
+    TEST_ASSERT(ref.bytes_verified == end0 + end1 && ref.bytes_read >= 2 * (end0 + end1), "both copies read");
+    g_checks += 4;
+    printf("[PASS] A/B comparison: %llu records, %zu findings\n", (unsigned long long)ref.records, c.n);
+
+    /* small ranges on several threads: starts inside long records and inside the framed blob */
+    int ok = 1;
+    uint64_t rescans = 0;
+    static const uint64_t ranges[] = { 40 * 1024, 100 * 1024, 333 * 1024 };
+    for (int r = 0; r < 3; r++) {
+        for (unsigned t = 1; t <= 4; t *= 2) {
+            o.threads = t;
+            o.range_bytes = ranges[r];
+            o.read_bytes = 64 * 1024;
+            affs_scrub_report rep = run(&st, &o, &c);
+            ok &= rep.complete && same_events(&c, x->ev, x->n) && rep.records == ref.records &&
+                  rep.damaged_bytes == ref.damaged_bytes && rep.bytes_verified == ref.bytes_verified;
+            rescans += rep.rescans;
+        }
+    }
+    TEST_ASSERT(ok, "parallel passes report the same as one sequential pass");
+    TEST_ASSERT(rescans > 0, "a speculative start was caught and rescanned");
+    g_checks += 2;
+    printf("[PASS] parallel ranges (%llu rescans)\n", (unsigned long long)rescans);
+    close_store(&st);
+
+    /* A alone: its damaged records, nothing about B */
+    open_store(&st, end0, end1, 0);
+    o = affs_scrub_options_default();
+    o.threads = 2;
+    o.range_bytes = 64 * 1024;
+    affs_scrub_report one = run(&st, &o, &c);
+    ok = one.complete && one.repairable == 0 && one.mismatches == 0 && one.records == x->records && c.n == 4;
+    for (size_t i = 0, j = 0; i < x->n; i++) {
+        const affs_scrub_event *e = &x->ev[i];
+        int damaged_in_a = (e->finding == AFFS_SCRUB_REPAIRABLE && e->copy == 0) || e->finding == AFFS_SCRUB_DAMAGED;
+        if (!damaged_in_a) continue;
+        ok &= j < c.n && c.ev[j].finding == AFFS_SCRUB_DAMAGED && c.ev[j].offset == e->offset && c.ev[j].length == e->length;
+        j++;
+    }
+    TEST_ASSERT(ok, "single copy: damage only");
+    g_checks++;
+    printf("[PASS] single copy\n");
+    close_store(&st);
+}
+
+static uint64_t g_probe_calls;
+
+static uint64_t fake_p99(void *ctx) {
+    (void)ctx;
+    return ++g_probe_calls <= 3 ? 50000000ull : 1000000ull;
+}
+
+static void test_throttle(const expected *x, uint64_t end0, uint64_t end1) {
+    store st;
+    open_store(&st, end0, end1, 1);
+    collected c;
+    affs_scrub_options o = affs_scrub_options_default();
+    o.threads = 2;
+    o.range_bytes = 256 * 1024;
+    o.read_bytes = 64 * 1024;
+    o.rate = 24ull << 20;
+    affs_scrub_report r = run(&st, &o, &c);
+    double floor_s = (double)(r.bytes_read - 2 * 64 * 1024) / (double)o.rate;
+    TEST_ASSERT(r.complete && same_events(&c, x->ev, x->n), "throttled pass complete");
+    TEST_ASSERT((double)r.elapsed_ns / 1e9 >= floor_s * 0.95 && r.throttled_ns > 0, "rate held");
+    printf("[PASS] token bucket: %.1f MiB in %.2f s at %.0f MiB/s\n", (double)r.bytes_read / 1048576.0,
+           (double)r.elapsed_ns / 1e9, (double)o.rate / 1048576.0);
+
+    /* foreground p99 over target three times: the rate is halved each time, then recovers */
+    o.foreground_p99 = fake_p99;
+    o.p99_target_ns = 10000000ull;
+    o.probe_ns = 20000000ull;
+    o.min_rate = 2ull << 20;
+    g_probe_calls = 0;
+    r = run(&st, &o, &c);
+    TEST_ASSERT(r.complete && same_events(&c, x->ev, x->n), "adaptive pass complete");
+    TEST_ASSERT(r.backoffs == 3 && g_probe_calls > 3 && r.rate > o.rate / 8 && r.rate <= o.rate, "backed off, recovered");
+    g_checks += 4;
+    printf("[PASS] adaptive backoff: %llu cuts over %llu probes, %.2f s, ended at %.0f MiB/s\n",
+           (unsigned long long)r.backoffs, (unsigned long long)g_probe_calls, (double)r.elapsed_ns / 1e9,
+           (double)r.rate / 1048576.0);
+    close_store(&st);
+}
+
+typedef struct bg {
+    affs_scrub *sc;
+    affs_scrub_report r;
+    affs_io_result res;
+} bg;
+
+static void *bg_main(void *arg) {
+    bg *b = (bg *)arg;
+    b->res = affs_scrub_run(b->sc, &b->r);
+    return NULL;
+}
+
+/* Start a throttled pass and cancel it once a few ranges are done. */
+static affs_scrub_report interrupted(store *st, affs_scrub_options *o, collected *c) {
+    bg b;
+    memset(&b, 0, sizeof(b));
+    c->n = 0;
+    o->on_event = on_event;
+    o->event_ctx = c;
+    TEST_ASSERT(affs_scrub_create(&b.sc, st->segs, 2, o).category == AFFS_IO_OK, "create");
+    pthread_t t;
+    pthread_create(&t, NULL, bg_main, &b);
+    for (;;) {
+        affs_scrub_report p;
+        affs_scrub_progress(b.sc, &p);
+        if (p.ranges_done >= 6) break;
+        struct timespec ts = { 0, 2000000 };
+        nanosleep(&ts, NULL);
+    }
+    affs_scrub_cancel(b.sc);
+    pthread_join(t, NULL);
+    TEST_ASSERT(b.res.category == AFFS_IO_OK, "cancelled run");
+    affs_scrub_destroy(b.sc);
+    return b.r;
+}
+
+static void test_resume(const expected *x, uint64_t end0, uint64_t end1) {
+    store st;
+    open_store(&st, end0, end1, 1);
+    collected c;
+    affs_scrub_options o = affs_scrub_options_default();
+    o.threads = 2;
+    o.range_bytes = 128 * 1024;
+    o.read_bytes = 64 * 1024;
+    affs_scrub_report full = run(&st, &o, &c);
+    o.rate = 16ull << 20;
+    o.checkpoint_path = k_checkpoint;
+    o.checkpoint_ns = 1000000ull;
+    remove(k_checkpoint);
+
+    affs_scrub_report first = interrupted(&st, &o, &c);
+    TEST_ASSERT(!first.complete && first.ranges_done >= 6 && first.ranges_done < first.ranges &&
+                    access(k_checkpoint, F_OK) == 0,
+                "cancelled with a checkpoint");
+
+    o.rate = 0;
+    affs_scrub_report second = run(&st, &o, &c);
+    TEST_ASSERT(second.resumed && second.complete && access(k_checkpoint, F_OK) != 0, "resumed, finished, checkpoint gone");
+    TEST_ASSERT(second.records == x->records && second.repairable == 4 && second.mismatches == 2 &&
+                    second.bytes_verified == end0 + end1,
+                "resumed totals match a full pass");
+    TEST_ASSERT(second.bytes_read < full.bytes_read, "finished ranges not read again");
+
+    /* a checkpoint of other ranges, or a damaged one, is not used */
+    o.rate = 16ull << 20;
+    interrupted(&st, &o, &c);
+    o.rate = 0;
+    o.range_bytes = 96 * 1024;
+    affs_scrub_report other = run(&st, &o, &c);
+    TEST_ASSERT(!other.resumed && other.complete && other.records == x->records, "other plan: full pass");
+    o.range_bytes = 128 * 1024;
+    o.rate = 16ull << 20;
+    interrupted(&st, &o, &c);
+    FILE *f = fopen(k_checkpoint, "r+b");
+    fseek(f, 40, SEEK_SET);
+    fputc(0x5A, f);
+    fclose(f);
+    o.rate = 0;
+    affs_scrub_report damaged = run(&st, &o, &c);
+    TEST_ASSERT(!damaged.resumed && damaged.complete && same_events(&c, x->ev, x->n), "damaged checkpoint: full pass");
+    g_checks += 6;
+    printf("[PASS] cancel at %llu of %llu ranges, resume\n", (unsigned long long)first.ranges_done,
+           (unsigned long long)first.ranges);
+
+    affs_scrub *sc;
+    affs_scrub_segment bad = st.segs[0];
+    bad.a = NULL;
+    affs_io_result res = affs_scrub_create(&sc, &bad, 1, NULL);
+    TEST_ASSERT(res.category != AFFS_IO_OK && res.os_error == EINVAL && sc == NULL, "no copy A");
+    TEST_ASSERT(affs_scrub_create(&sc, NULL, 0, NULL).category == AFFS_IO_OK, "no segments");
+    affs_scrub_report r;
+    TEST_ASSERT(affs_scrub_run(sc, &r).category == AFFS_IO_OK && r.complete && r.ranges == 0, "nothing to do");
+    affs_scrub_destroy(sc);
+    g_checks += 3;
+    close_store(&st);
+}
+
+int main(void) {
+    static expected x;
+    uint64_t end0, end1;
+    build_store(&x, &end0, &end1);
+    test_compare(&x, end0, end1);
+    test_throttle(&x, end0, end1);
+    test_resume(&x, end0, end1);
+    remove(k_path_a);
+    remove(k_path_b);
+    remove(k_checkpoint);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "../include/affs_secondary.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+#define OBJECTS 300000
+#define READERS 3
+
+/* Ordinal x carries tag "m<d>" for every d in {2, 3, 5, 7} dividing x. */
+static const uint32_t k_div[] = { 2, 3, 5, 7 };
+static const char *k_tags[] = { "m2", "m3", "m5", "m7" };
+
+static affs_secondary_key tag(int i) {
+    affs_secondary_key k = { k_tags[i], 2 };
+    return k;
+}
+
+static int removed(uint32_t x) {
+    return x % 11 == 0;
+}
+
+/* Ascending ordinals below `limit` divisible by every divisor in `mask`, or by any when `any`. */
+static uint32_t *model(unsigned mask, int any, uint32_t limit, int with_removed, size_t *n) {
+    uint32_t *v = (uint32_t *)malloc((size_t)limit * sizeof(uint32_t) + 4);
+    size_t k = 0;
+    for (uint32_t x = 0; x < limit; x++) {
+        int hit = !any;
+        for (int d = 0; d < 4; d++) {
+            if (!(mask >> d & 1)) continue;
+            if (any) hit |= x % k_div[d] == 0;
+            else hit &= x % k_div[d] == 0;
+        }
+        if (hit && (with_removed || !removed(x))) v[k++] = x;
+    }
+    *n = k;
+    return v;
+}
+
+static int matches(const affs_posting *p, const uint32_t *v, size_t n) {
+    if (p->cardinality != n) return 0;
+    uint32_t *got = (uint32_t *)malloc(n * sizeof(uint32_t) + 4);
+    affs_posting_to_array(p, got);
+    int ok = n == 0 || memcmp(got, v, n * sizeof(uint32_t)) == 0;
+    free(got);
+    return ok;
+}
+
+static int query(affs_secondary *ix, unsigned mask, int any, affs_posting *out) {
+    affs_secondary_key keys[4];
+    size_t n = 0;
+    for (int d = 0; d < 4; d++) {
+        if (mask >> d & 1) keys[n++] = tag(d);
+    }
+    return any ? affs_secondary_or(ix, keys, n, out) : affs_secondary_and(ix, keys, n, out);
+}
+
+static int all_queries_match(affs_secondary *ix, uint32_t limit, int with_removed) {
+    int ok = 1;
+    for (unsigned mask = 1; mask < 16; mask++) {
+        for (int any = 0; any < 2; any++) {
+            size_t n;
+            uint32_t *v = model(mask, any, limit, with_removed, &n);
+            affs_posting p;
+            ok &= query(ix, mask, any, &p) == 0 && matches(&p, v, n);
+            affs_posting_free(&p);
+            free(v);
+        }
+    }
+    return ok;
+}
+
+static void add_object(affs_secondary *ix, uint32_t x) {
+    for (int d = 0; d < 4; d++) {
+        if (x % k_div[d] == 0) TEST_ASSERT(affs_secondary_add(ix, k_tags[d], 2, x) == 0, "add");
+    }
+}
+
+/* ---------- tests ---------- */
+
+static void test_manual(void) {
+    affs_secondary_options o = affs_secondary_options_default();
+    o.manual = 1;
+    o.merge_threshold = 64;
+    affs_secondary *ix;
+    TEST_ASSERT(affs_secondary_create(&ix, &o) == 0, "create");
+
+    /* the first half from sorted runs, the rest appended */
+    uint32_t half = OBJECTS / 2;
+    for (int d = 0; d < 4; d++) {
+        size_t n;
+        uint32_t *v = model(1u << d, 0, half, 1, &n);
+        affs_posting run, dec;
+        TEST_ASSERT(affs_posting_from_sorted(&run, v, n) == 0, "run");
+        size_t bytes = affs_posting_encoded_size(&run);
+        uint8_t *buf = (uint8_t *)malloc(bytes);
+        affs_posting_encode(&run, buf);
+        TEST_ASSERT(affs_posting_decode(&dec, buf, bytes) == 0, "decode run");
+        TEST_ASSERT(affs_secondary_load(ix, k_tags[d], 2, &dec) == 0, "load");
+        affs_posting_free(&run);
+        affs_posting_free(&dec);
+        free(buf);
+        free(v);
+    }
+    /* out of order, and some twice */
+    for (uint32_t x = OBJECTS; x-- > half;) add_object(ix, x);
+    for (uint32_t x = half; x < half + 1000; x++) add_object(ix, x);
+    TEST_ASSERT(all_queries_match(ix, OBJECTS, 1), "loaded + pending");
+
+    for (uint32_t x = 0; x < OBJECTS; x += 11) TEST_ASSERT(affs_secondary_remove(ix, x) == 0, "remove");
+    TEST_ASSERT(all_queries_match(ix, OBJECTS, 0), "removals subtracted");
+
+    affs_secondary_stats st;
+    affs_secondary_stats_get(ix, &st);
+    TEST_ASSERT(st.keys == 4 && st.pending > 0 && st.removed == (OBJECTS + 10) / 11, "before merge");
+    TEST_ASSERT(affs_secondary_merge(ix) == 0, "merge");
+    affs_secondary_stats_get(ix, &st);
+    TEST_ASSERT(st.pending == 0 && st.removed == 0 && st.purges == 1, "merged and purged");
+    TEST_ASSERT(all_queries_match(ix, OBJECTS, 0), "after merge");
+
+    affs_posting p;
+    TEST_ASSERT(affs_secondary_find(ix, "m4", 2, &p) == 0 && p.cardinality == 0, "unknown key");
+    affs_secondary_key unknown[2] = { tag(0), { "zz", 2 } };
+    TEST_ASSERT(affs_secondary_and(ix, unknown, 2, &p) == 0 && p.cardinality == 0, "and with an unknown key");
+    size_t n;
+    uint32_t *v = model(1, 1, OBJECTS, 0, &n);
+    TEST_ASSERT(affs_secondary_or(ix, unknown, 2, &p) == 0 && matches(&p, v, n), "or with an unknown key");
+    affs_posting_free(&p);
+    free(v);
+
+    /* many small keys: content hashes of new objects, one each */
+    for (uint32_t x = 0; x < 20000; x++) {
+        uint8_t h[32];
+        memset(h, 0, sizeof(h));
+        memcpy(h, &x, sizeof(x));
+        TEST_ASSERT(affs_secondary_add(ix, h, sizeof(h), OBJECTS + x) == 0, "hash key");
+    }
+    int ok = 1;
+    for (uint32_t x = 0; x < 20000; x += 7) {
+        uint8_t h[32];
+        memset(h, 0, sizeof(h));
+        memcpy(h, &x, sizeof(x));
+        ok &= affs_secondary_find(ix, h, sizeof(h), &p) == 0 && p.cardinality == 1 && affs_posting_contains(&p, OBJECTS + x);
+        affs_posting_free(&p);
+    }
+    TEST_ASSERT(ok, "hash keys");
+    affs_secondary_stats_get(ix, &st);
+    TEST_ASSERT(st.keys == 20004, "key count");
+    g_checks += 11;
+    affs_secondary_destroy(ix);
+    printf("[PASS] manual merge: loads, appends, removals, %zu keys\n", st.keys);
+}
+
+/* a key that never had a base: its first merge is also the purge */
+static void test_pending_only(void) {
+    affs_secondary_options o = affs_secondary_options_default();
+    o.manual = 1;
+    affs_secondary *ix;
+    TEST_ASSERT(affs_secondary_create(&ix, &o) == 0, "create");
+    TEST_ASSERT(affs_secondary_add(ix, "k", 1, 5) == 0 && affs_secondary_add(ix, "k", 1, 9) == 0, "add");
+    TEST_ASSERT(affs_secondary_remove(ix, 5) == 0, "remove");
+    TEST_ASSERT(affs_secondary_merge(ix) == 0, "merge");
+    affs_secondary_stats st;
+    affs_secondary_stats_get(ix, &st);
+    affs_posting p;
+    TEST_ASSERT(st.pending == 0 && st.removed == 0 && st.purges == 1, "merged and purged");
+    TEST_ASSERT(affs_secondary_find(ix, "k", 1, &p) == 0 && p.cardinality == 1 && affs_posting_contains(&p, 9),
+                "removed ordinal stays removed");
+    affs_posting_free(&p);
+    g_checks += 6;
+    affs_secondary_destroy(ix);
+    printf("[PASS] pending-only key: removal survives the merge\n");
+}
+
+/* ---------- background merging under concurrent queries ---------- */
+
+typedef struct shared {
+    affs_secondary *ix;
+    _Atomic uint32_t written;   /* ordinals below are fully added */
+    _Atomic int done;
+    _Atomic int bad;
+    _Atomic uint64_t queries;
+} shared;
+
+static void *reader_main(void *arg) {
+    shared *s = (shared *)arg;
+    uint64_t seed = (uint64_t)(uintptr_t)arg ^ 0x9E37u;
+    uint32_t *buf = (uint32_t *)malloc(OBJECTS * sizeof(uint32_t));
+    while (!atomic_load(&s->done)) {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        unsigned mask = 1 + (unsigned)(seed >> 40) % 15;
+        int any = (int)(seed >> 20) & 1;
+        uint32_t before = atomic_load(&s->written);
+        affs_posting p;
+        if (query(s->ix, mask, any, &p) != 0) {
+            atomic_store(&s->bad, 1);
+            break;
+        }
+        affs_posting_to_array(&p, buf);
+        /* every result belongs; everything written before the query is there, removals included */
+        size_t n;
+        uint32_t *v = model(mask, any, before, 0, &n);
+        size_t j = 0;
+        for (size_t i = 0; i < p.cardinality; i++) {
+            uint32_t x = buf[i];
+            int hit = !any;
+            for (int d = 0; d < 4; d++) {
+                if (!(mask >> d & 1)) continue;
+                if (any) hit |= x % k_div[d] == 0;
+                else hit &= x % k_div[d] == 0;
+            }
+            if (!hit || (removed(x) && x < before)) atomic_store(&s->bad, 1);
+            if (j < n && v[j] == x) j++;
+        }
+        if (j != n) atomic_store(&s->bad, 1);
+        free(v);
+        affs_posting_free(&p);
+        atomic_fetch_add(&s->queries, 1);
+    }
+    free(buf);
+    return NULL;
+}
+
+static void test_background(void) {
+    affs_secondary_options o = affs_secondary_options_default();
+    o.merge_threshold = 256;
+    o.purge_threshold = 2000;
+    shared s;
+    memset(&s, 0, sizeof(s));
+    TEST_ASSERT(affs_secondary_create(&s.ix, &o) == 0, "create");
+    pthread_t r[READERS];
+    for (int i = 0; i < READERS; i++) pthread_create(&r[i], NULL, reader_main, &s);
+    for (uint32_t x = 0; x < OBJECTS; x++) {
+        add_object(s.ix, x);
+        if (removed(x)) TEST_ASSERT(affs_secondary_remove(s.ix, x) == 0, "remove");
+        atomic_store(&s.written, x + 1);
+    }
+    atomic_store(&s.done, 1);
+    for (int i = 0; i < READERS; i++) pthread_join(r[i], NULL);
+    TEST_ASSERT(!atomic_load(&s.bad), "queries during merges see whole, valid results");
+
+    affs_secondary_stats st;
+    affs_secondary_stats_get(s.ix, &st);
+    TEST_ASSERT(st.merges > 0 && st.purges > 0, "the merger ran");
+    TEST_ASSERT(all_queries_match(s.ix, OBJECTS, 0), "final state");
+    g_checks += 3;
+    printf("[PASS] background merge: %llu queries alongside, %llu merges, %llu purges, %zu bytes\n",
+           (unsigned long long)atomic_load(&s.queries), (unsigned long long)st.merges, (unsigned long long)st.purges,
+           st.bytes);
+    affs_secondary_destroy(s.ix);
+}
+
+int main(void) {
+    test_manual();
+    test_pending_only();
+    test_background();
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}
@@ -0,0 +1,224 @@
+#include "../include/affs_snapshot.h"
+#include "test_common.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int g_checks = 0;
+
+static const char *k_store = "affs_snapshot_test.store";
+static const char *k_snap = "affs_snapshot_test.afix";
+static const char *k_bad = "affs_snapshot_test_bad.afix";
+
+#define ALIGN 64
+#define OBJECTS 3000
+#define SEG_SIZE (4u * 1024 * 1024)
+
+/* ---------- building segments ---------- */
+
+typedef struct image {
+    uint8_t *data;
+    size_t len, cap;
+} image;
+
+static uint64_t g_seq = 1;
+
+static affs_object_id object_id(int k) {
+    affs_object_id id = { (uint64_t)k * 0x9E3779B97F4A7C15ull, (uint64_t)k };
+    return id;
+}
+
+static void put_object(image *im, int k, uint64_t seq, int tombstone) {
+    uint8_t p[200];
+    affs_object_prefix_write(p, object_id(k), seq, tombstone ? AFFS_OBJECT_TOMBSTONE : 0);
+    size_t len = AFFS_OBJECT_PREFIX_SIZE + (size_t)(k * 7 + seq) % 150;
+    memset(p + AFFS_OBJECT_PREFIX_SIZE, (int)k, len - AFFS_OBJECT_PREFIX_SIZE);
+    size_t framed = (size_t)affs_record_framed_size(len, ALIGN);
+    if (im->len + framed > im->cap) {
+        im->cap = (im->len + framed) * 2;
+        im->data = (uint8_t *)realloc(im->data, im->cap);
+    }
+    affs_record_header h = { (uint8_t)(k % 2 ? AFFS_KIND_ROW : AFFS_KIND_TEXT), 1, 0, 0, 0, 0 };
+    affs_record_frame(im->data + im->len, &h, p, len, ALIGN);
+    im->len += framed;
+}
+
+/* Segments 10, 11 and 12 live in one file, SEG_SIZE apart. */
+static void store_write(image *segs) {
+    affs_backend_options o = affs_backend_options_default();
+    o.flags = AFFS_BACKEND_WRITE | AFFS_BACKEND_CREATE;
+    affs_backend *b;
+    TEST_ASSERT(affs_backend_open(&b, k_store, &o).category == AFFS_IO_OK, "open store for writing");
+    for (int s = 0; s < 3; s++) {
+        TEST_ASSERT(segs[s].len < SEG_SIZE, "segment fits");
+        if (segs[s].len) affs_backend_write(b, (uint64_t)s * SEG_SIZE, segs[s].data, segs[s].len);
+    }
+    affs_backend_close(b);
+}
+
+/* Bounded by what was written, as the current SegmentPositions would be. */
+static void segments(affs_backend *b, const image *im, affs_rebuild_segment *out) {
+    for (int s = 0; s < 3; s++) {
+        affs_rebuild_segment seg = { b, 10 + (uint64_t)s, (uint64_t)s * SEG_SIZE, 0, im[s].len, ALIGN };
+        out[s] = seg;
+    }
+}
+
+static int same_entries(const affs_rebuild_result *a, const affs_rebuild_result *b) {
+    if (a->count != b->count) return 0;
+    for (size_t i = 0; i < a->count; i++) {
+        const affs_index_entry *x = &a->entries[i], *y = &b->entries[i];
+        if (!affs_object_id_eq(x->id, y->id) || x->sequence != y->sequence || x->loc.segment_id != y->loc.segment_id ||
+            x->loc.offset != y->loc.offset || x->loc.length != y->loc.length || x->loc.flags != y->loc.flags)
+            return 0;
+    }
+    return 1;
+}
+
+static affs_rebuild_result full_rebuild(const image *im) {
+    affs_backend_options o = affs_backend_options_default();
+    affs_backend *b;
+    affs_backend_open(&b, k_store, &o);
+    affs_rebuild_segment segs[3];
+    segments(b, im, segs);
+    affs_rebuild_result r;
+    TEST_ASSERT(affs_rebuild(segs, 3, NULL, &r).category == AFFS_IO_OK, "full rebuild");
+    affs_backend_close(b);
+    return r;
+}
+
+static void copy_file(const char *from, const char *to, size_t truncate_to, long flip_at) {
+    FILE *f = fopen(from, "rb");
+    fseek(f, 0, SEEK_END);
+    size_t n = (size_t)ftell(f);
+    rewind(f);
+    uint8_t *d = (uint8_t *)malloc(n);
+    TEST_ASSERT(fread(d, 1, n, f) == n, "read snapshot");
+    fclose(f);
+    if (flip_at >= 0) d[flip_at] ^= 0x01;
+    f = fopen(to, "wb");
+    fwrite(d, 1, truncate_to < n ? truncate_to : n, f);
+    fclose(f);
+    free(d);
+}
+
+int main(void) {
+    remove(k_store);
+    image segs[3] = { { NULL, 0, 0 }, { NULL, 0, 0 }, { NULL, 0, 0 } };
+
+    /* the store at the checkpoint: segments 10 and 11 */
+    for (int k = 0; k < OBJECTS; k++) put_object(&segs[0], k, g_seq++, 0);
+    for (int k = 0; k < OBJECTS; k += 3) put_object(&segs[1], k, g_seq++, k % 9 == 0);
+    store_write(segs);
+    affs_segment_position pos[2] = { { 11, segs[1].len }, { 10, segs[0].len } };
+    affs_rebuild_result at_checkpoint = full_rebuild(segs);
+
+    affs_io_result w = affs_snapshot_write(k_snap, 7, 1234, pos, 2, at_checkpoint.entries, at_checkpoint.count);
+    TEST_ASSERT(w.category == AFFS_IO_OK, "write snapshot");
+    TEST_ASSERT(w.bytes == AFFS_SNAPSHOT_HEADER_SIZE + 64 + at_checkpoint.count * AFFS_SNAPSHOT_ENTRY_SIZE, "snapshot size");
+    g_checks += 2;
+
+    affs_snapshot *s;
+    TEST_ASSERT(affs_snapshot_open(&s, k_snap, AFFS_SNAPSHOT_VERIFY).category == AFFS_IO_OK, "open snapshot");
+    affs_snapshot_info info;
+    affs_snapshot_info_get(s, &info);
+    TEST_ASSERT(info.checkpoint_id == 7 && info.log_position == 1234 && info.count == at_checkpoint.count && info.segments == 2,
+                "header fields");
+    TEST_ASSERT(affs_snapshot_position(s, 10) == segs[0].len && affs_snapshot_position(s, 11) == segs[1].len &&
+                    affs_snapshot_position(s, 12) == 0,
+                "segment positions");
+    int ok = 1;
+    for (size_t i = 0; i < at_checkpoint.count; i++) {
+        affs_index_entry e, f;
+        affs_snapshot_entry(s, i, &e);
+        ok &= affs_snapshot_find(s, at_checkpoint.entries[i].id, &f) && affs_object_id_eq(e.id, f.id) &&
+              e.loc.offset == at_checkpoint.entries[i].loc.offset && e.sequence == at_checkpoint.entries[i].sequence;
+    }
+    affs_index_entry miss;
+    ok &= !affs_snapshot_find(s, object_id(OBJECTS + 1), &miss) && !affs_snapshot_find(s, object_id(9), &miss);
+    TEST_ASSERT(ok, "lookups in the mapped snapshot");
+    g_checks += 4;
+    printf("[PASS] write and map: %llu entries, %llu bytes\n", (unsigned long long)info.count, (unsigned long long)info.bytes);
+
+    /* the log tail: newer versions, deletions, a new segment, a late write of an older version */
+    for (int k = 0; k < OBJECTS; k += 7) put_object(&segs[0], k, g_seq++, 0);
+    for (int k = 0; k < OBJECTS; k += 11) put_object(&segs[1], k, g_seq++, 1);
+    for (int k = OBJECTS - 500; k < OBJECTS + 500; k++) put_object(&segs[2], k, g_seq++, 0);
+    put_object(&segs[0], 1, 1, 0);     /* older than the snapshot's version of 1: loses */
+    store_write(segs);
+    affs_rebuild_result now = full_rebuild(segs);
+    {
+        affs_backend_options o = affs_backend_options_default();
+        affs_backend *b;
+        affs_backend_open(&b, k_store, &o);
+        affs_rebuild_segment tail[3];
+        segments(b, segs, tail);
+        affs_rebuild_options ro = affs_rebuild_options_default();
+        ro.threads = 2;
+        affs_rebuild_result r;
+        TEST_ASSERT(affs_snapshot_recover(s, tail, 3, &ro, &r).category == AFFS_IO_OK, "recover");
+        TEST_ASSERT(same_entries(&r, &now), "snapshot + tail == full rebuild");
+        TEST_ASSERT(r.stats.bytes_scanned <= segs[0].len + segs[1].len + segs[2].len - pos[0].position - pos[1].position,
+                    "only the tails were read");
+        TEST_ASSERT(r.stats.superseded > 0 && r.count < at_checkpoint.count + 500, "tail replaced and deleted entries");
+        g_checks += 4;
+        printf("[PASS] recover: %zu entries, %llu tail bytes scanned\n", r.count, (unsigned long long)r.stats.bytes_scanned);
+
+        /* the recovered index becomes the next checkpoint's snapshot */
+        affs_segment_position next[3] = { { 10, segs[0].len }, { 11, segs[1].len }, { 12, segs[2].len } };
+        affs_snapshot *s2;
+        affs_rebuild_result r2;
+        TEST_ASSERT(affs_snapshot_write(k_snap, 8, 2000, next, 3, r.entries, r.count).category == AFFS_IO_OK, "rewrite");
+        TEST_ASSERT(affs_snapshot_open(&s2, k_snap, AFFS_SNAPSHOT_VERIFY).category == AFFS_IO_OK, "reopen");
+        TEST_ASSERT(affs_snapshot_recover(s2, tail, 3, &ro, &r2).category == AFFS_IO_OK && same_entries(&r2, &now) &&
+                        r2.stats.versions == 0,
+                    "empty tail");
+        g_checks += 3;
+        affs_snapshot_close(s2);
+        affs_rebuild_result_free(&r);
+        affs_rebuild_result_free(&r2);
+        affs_backend_close(b);
+    }
+    affs_snapshot_close(s);   /* still mapped the replaced file: fine */
+
+    /* damage */
+    {
+        affs_snapshot *d;
+        copy_file(k_snap, k_bad, SIZE_MAX, AFFS_SNAPSHOT_HEADER_SIZE + 64 + 100);
+        TEST_ASSERT(affs_snapshot_open(&d, k_bad, 0).category == AFFS_IO_OK, "entry damage passes the header check");
+        affs_snapshot_close(d);
+        affs_io_result r = affs_snapshot_open(&d, k_bad, AFFS_SNAPSHOT_VERIFY);
+        TEST_ASSERT(r.category == AFFS_IO_PERMANENT && r.os_error == EBADMSG && !d, "entry damage caught by BodyCrc");
+        copy_file(k_snap, k_bad, SIZE_MAX, 20);
+        TEST_ASSERT(affs_snapshot_open(&d, k_bad, 0).os_error == EBADMSG, "header damage");
+        copy_file(k_snap, k_bad, 1000, -1);
+        TEST_ASSERT(affs_snapshot_open(&d, k_bad, 0).os_error == EBADMSG, "truncated");
+        TEST_ASSERT(affs_snapshot_open(&d, "affs_snapshot_test_missing.afix", 0).os_error == ENOENT, "missing");
+        g_checks += 5;
+        printf("[PASS] damaged snapshots rejected\n");
+    }
+
+    /* bad input */
+    {
+        affs_index_entry e[2];
+        memset(e, 0, sizeof(e));
+        e[0].id = object_id(2);
+        e[1].id = object_id(1);
+        TEST_ASSERT(affs_snapshot_write(k_bad, 1, 0, NULL, 0, e, 2).os_error == EINVAL, "unsorted entries");
+        e[1].id = object_id(3);
+        e[1].loc.segment_id = 1ull << 32;
+        TEST_ASSERT(affs_snapshot_write(k_bad, 1, 0, NULL, 0, e, 2).os_error == EINVAL, "segment id beyond 32 bits");
+        g_checks += 2;
+    }
+
+    affs_rebuild_result_free(&at_checkpoint);
+    affs_rebuild_result_free(&now);
+    for (int i = 0; i < 3; i++) free(segs[i].data);
+    remove(k_store);
+    remove(k_snap);
+    remove(k_bad);
+    printf("\n[SUMMARY] checks=%d failed=0\n", g_checks);
+    return 0;
+}